@@ -11,20 +11,55 @@
 #define PIN_DSSP3120_RX   16
 #define DSSP3120_BAUD     115200
 
+#ifndef DSSP3120_LINES
+#define DSSP3120_LINES    4     // lecturas completas a la espera de taskIO
+#endif
+
 namespace DSSP3120
 {
     void begin();
 
     /**
      * @brief Lee del bus RS485, detecta el prefijo IN/OUT y limpia el código.
-     * @param outRaw String donde se guarda el UID formateado o el código leído sin prefijo.
+     *        Sin memoria dinámica: línea y código van en buffers fijos.
+     * @param outCode Buffer donde se guarda el código normalizado ('\0' final).
+     * @param cap Capacidad de outCode (QR_CODE_MAX basta para cualquier formato).
      * @param direccion Devuelve 1 si es Entrada (IN:), 2 si es Salida (OUT:).
      * @param kindOut Puntero al campo donde se guardará el tipo de QR detectado.
+     * @param machineOut Torno RS485 del carril: id escrito antes del prefijo
+     *        ("3IN:...") o, sin él, el torno por defecto del bus.
      * @return true si se ha completado una lectura válida.
      */
-    bool readLine_parsed(String &outRaw, int &direccion, QRKind *kindOut);
+    bool readLine_parsed(char *outCode, size_t cap, int &direccion, QRKind *kindOut, uint8_t *machineOut = nullptr);
 
     void flushInput();
+
+    // La recepción va por eventos del UART: cada línea completa se encola y
+    // la tarea suscrita recibe xTaskNotifyGive() (esperar con ulTaskNotifyTake)
+    void subscribe(TaskHandle_t task);
+
+    // --- Latencia de cada lectura (desde la llegada de sus primeros bytes) ---
+    enum ScanMark : uint8_t
+    {
+        SCAN_DECIDED = 0, // respuesta de validación (backend o índice local)
+        SCAN_GATE,        // orden de apertura entregada al torno/relé
+        SCAN_END          // ciclo cerrado sin apertura (denegado o sin respuesta)
+    };
+    void markScan(ScanMark m); // desde taskIO; sin lectura en curso no hace nada
+
+    struct ScanStats {
+        uint32_t lines = 0;          // líneas completas recibidas
+        uint32_t dropped = 0;        // descartadas con la cola llena
+        uint32_t lastLineUs = 0;     // primer byte → fin de línea
+        uint32_t lastParsedUs = 0;   // primer byte → código clasificado en taskIO
+        uint32_t lastDecisionUs = 0; // primer byte → respuesta de validación
+        uint32_t lastGateUs = 0;     // primer byte → orden de apertura
+        uint32_t maxParsedUs = 0;
+        uint32_t maxDecisionUs = 0;
+        uint32_t maxGateUs = 0;
+    };
+    ScanStats scanStats();
+    String scanStatsJson();
 }
 
 #endif // DSSP3120_HPP
\ No newline at end of file
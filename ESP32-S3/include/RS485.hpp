@@ -4,12 +4,89 @@
 
 #define MACHINE_ID 0x01  // ajusta aquí el ID de máquina (1..99) según tu configuración
 
+// Tornos en el mismo bus (multi-drop). El primero es el torno por defecto
+// (getStatus() sin id). Ej.: -DRS485_MACHINES="{1,2,3}"
+#ifndef RS485_MACHINES
+#define RS485_MACHINES    { MACHINE_ID }
+#endif
+#ifndef RS485_MAX_MACHINES
+#define RS485_MAX_MACHINES 8
+#endif
+#ifndef RS485_POLL_MS
+#define RS485_POLL_MS     250   // cada torno se consulta una vez por periodo (con más de uno)
+#endif
+#ifndef RS485_POLL_SINGLE
+#define RS485_POLL_SINGLE 0     // 1: sondear también con un solo torno
+#endif
+#ifndef RS485_OFFLINE_MS
+#define RS485_OFFLINE_MS  2000  // sin tramas de un torno durante este tiempo → desconectado
+#endif
+
 #define PIN_RS485_RX      41
 #define PIN_RS485_TX      42  
 #define RS485_BAUD        19200
 
+// Control de dirección DE/RE opcional: el UART lo mueve por hardware (RTS en
+// modo RS485 half-duplex). -1 = transceptor con conmutación automática.
+#ifndef PIN_RS485_DE
+#define PIN_RS485_DE      -1
+#endif
+
+// ======= Planificador de transmisión =======
+// Las órdenes se encolan y salen al bus respetando los tiempos del torno con
+// marcas de tiempo (nunca con delay): nadie se queda bloqueado enviando.
+#ifndef RS485_TXQ_LEN
+#define RS485_TXQ_LEN        8     // tramas en espera
+#endif
+#ifndef RS485_CMD_GAP_MS
+#define RS485_CMD_GAP_MS     15    // silencio mínimo entre el fin de una trama y la siguiente
+#endif
+#ifndef RS485_RESP_WAIT_MS
+#define RS485_RESP_WAIT_MS   40    // tras una consulta de estado, bus reservado para la respuesta
+#endif
+#ifndef RS485_TURNAROUND_US
+#define RS485_TURNAROUND_US  1000  // margen tras el último byte recibido antes de volver a transmitir
+#endif
+
+// ======= Transacciones (orden → confirmación) =======
+// Cada orden se da por confirmada con una trama de estado 0x7F nueva de la
+// misma máquina que la refleje: eco en commandExecStatus o, en las órdenes
+// de puerta, la puerta distinta de como estaba al enviarla. El torno también
+// manda tramas por su cuenta, así que una cualquiera no basta. Si no llega
+// respuesta, se pregunta de nuevo (0x10); si responde sin reflejarla, se
+// repite la orden; con espera creciente.
+#ifndef RS485_ACK_TIMEOUT_MS
+#define RS485_ACK_TIMEOUT_MS 60    // espera de la trama de estado tras transmitir
+#endif
+#ifndef RS485_MAX_ATTEMPTS
+#define RS485_MAX_ATTEMPTS   3     // transmisiones por transacción
+#endif
+#ifndef RS485_RETRY_BASE_MS
+#define RS485_RETRY_BASE_MS  20    // espera antes del reintento n: base << (n-1)
+#endif
+#ifndef RS485_RETRY_MAX_MS
+#define RS485_RETRY_MAX_MS   200
+#endif
+#ifndef RS485_ACK_EXEC_ECHO
+#define RS485_ACK_EXEC_ECHO  1     // 0: cualquier trama confirma (firmware de torno sin eco)
+#endif
+#ifndef RS485_MAX_SUBS
+#define RS485_MAX_SUBS       4     // tareas avisadas de cambios de estado
+#endif
+#ifndef RS485_PARAM_WAIT_MS
+#define RS485_PARAM_WAIT_MS  600   // espera máxima de setParam()/readParam()
+#endif
+#ifndef RS485_PARAM_PIPELINE
+#define RS485_PARAM_PIPELINE 4     // escrituras de syncParams() en la cola a la vez (< RS485_TXQ_LEN)
+#endif
+// Orden de lectura de parámetro (d0 = menú, valor en el primer byte libre de
+// la respuesta). Con 0 no se lee nada: lo escrito queda como supuesto y
+// readParam() no da ningún valor por bueno.
+#ifndef RS485_CMD_PARAM_READ
+#define RS485_CMD_PARAM_READ 0x97
+#endif
+
 // ======= Config/log =======
-static uint8_t txBuf[8];
 static uint8_t rxBuf[18];
 
 
@@ -27,7 +104,9 @@ struct StatusFrame {
   uint8_t  infrared = 0;
   uint8_t  cmdExec = 0;
   uint8_t  vcc = 0;
-  uint32_t lastMs = 0;
+  uint32_t lastMs = 0;    // millis() de recepción de la trama
+  uint32_t changeMs = 0;  // millis() del último cambio de contadores/puerta/fallo/alarma
+  uint32_t seq = 0;       // nº de trama recibida (0 = aún ninguna)
 };
 
 // --- Setup / control ---
@@ -35,39 +114,126 @@ void begin();
 void setDebug(bool on);
 
 // --- Ciclo ---
+// La recepción va por eventos del UART; poll() solo hace falta si se quiere
+// vaciar el FIFO en el acto (seguro desde cualquier tarea).
 void poll();
 
 // --- Estado ---
+// Última trama completa, sin bloqueos ni lecturas a medias (seqlock).
+// Sin id: el torno por defecto (el primero de RS485_MACHINES).
 StatusFrame getStatus();
+StatusFrame getStatus(uint8_t m);
+bool online(uint8_t m);
+
+// --- Tornos del bus ---
+bool addMachine(uint8_t id); // alta en caliente (begin() ya da de alta RS485_MACHINES)
+uint8_t machineCount();
+uint8_t machineAt(uint8_t idx);
+String busStatsJson(); // {"unknown_frames":N,"machines":[{...},...]}
+
+// La tarea recibe xTaskNotifyGive() cuando cambian contadores, puerta, fallo
+// o alarma de cualquier torno (esperar con ulTaskNotifyTake)
+bool subscribe(TaskHandle_t task);
+
+struct TxStats {
+  uint32_t queued = 0;     // transacciones aceptadas
+  uint32_t sent = 0;       // tramas escritas en el bus (órdenes y consultas)
+  uint32_t dropped = 0;    // sin hueco libre
+  uint32_t coalesced = 0;  // consultas de estado repetidas que ya estaban en cola
+  uint32_t acked = 0;      // confirmadas por el torno
+  uint32_t retries = 0;
+  uint32_t failed = 0;     // sin confirmación tras RS485_MAX_ATTEMPTS
+  uint32_t lastWaitUs = 0; // de encolar a transmitir
+  uint32_t maxWaitUs = 0;
+  uint32_t lastAckUs = 0;  // de encolar a confirmar
+  uint32_t maxAckUs = 0;
+  uint8_t  depth = 0;
+};
+TxStats txStats();
+String txStatsJson();
+
+// --- Transacciones ---
+// Cada orden devuelve un Txn (0 = no aceptada) con el que consultar el
+// resultado más tarde sin bloquear, o esperarlo con un plazo. Los huecos de
+// resultado se reciclan: un Txn antiguo acaba dando TXN_UNKNOWN.
+typedef uint16_t Txn;
+static const Txn TXN_NONE = 0;
+
+enum TxnStatus : uint8_t {
+  TXN_PENDING = 0,   // en cola o esperando confirmación
+  TXN_OK,            // el torno respondió reflejando la orden
+  TXN_NO_ACK,        // ninguna respuesta tras los reintentos
+  TXN_NOT_EXECUTED,  // responde pero commandExecStatus no refleja la orden
+  TXN_REJECTED,      // no se pudo encolar (cola llena o UART sin iniciar)
+  TXN_UNKNOWN        // Txn inválido o ya reciclado
+};
+
+struct TxnResult {
+  TxnStatus   status = TXN_UNKNOWN;
+  uint8_t     cmd = 0;
+  uint8_t     attempts = 0;   // envío inicial + reintentos
+  uint8_t     spare[2] = {0, 0}; // bytes 15-16 de la respuesta
+  uint32_t    latencyUs = 0;  // de encolar a confirmar
+  StatusFrame frame;          // trama que confirmó la orden
+};
+
+Txn submit(uint8_t machine, uint8_t cmd, uint8_t d0, uint8_t d1, uint8_t d2);
+TxnStatus peek(Txn t, TxnResult* out = nullptr); // no bloquea
+TxnResult wait(Txn t, uint32_t timeoutMs);       // atiende el bus mientras espera
+const char* txnStatusName(TxnStatus st);
 
 // --- Comandos RS485 (ajusta MACHINE_ID en tu config) ---
-void queryDeviceStatus(uint8_t m);  
-void resetLeftCount   (uint8_t m);
-void resetRightCount  (uint8_t m);
-void resetDevice      (uint8_t m);
+Txn queryDeviceStatus(uint8_t m);
+Txn resetLeftCount   (uint8_t m);
+Txn resetRightCount  (uint8_t m);
+Txn resetDevice      (uint8_t m);
 
-void leftOpen         (uint8_t m, uint8_t p);
-void leftAlwaysOpen   (uint8_t m);
+Txn leftOpen         (uint8_t m, uint8_t p);
+Txn leftAlwaysOpen   (uint8_t m);
 
-void rightOpen        (uint8_t m, uint8_t p);
-void rightAlwaysOpen  (uint8_t m);
+Txn rightOpen        (uint8_t m, uint8_t p);
+Txn rightAlwaysOpen  (uint8_t m);
 
-void openGateAlways   (uint8_t m);
-void closeGate        (uint8_t m);
+Txn openGateAlways   (uint8_t m);
+Txn closeGate        (uint8_t m);
 
-void forbiddenLeftPassage    (uint8_t m);
-void forbiddenRightPassage   (uint8_t m);
-void disablePassageRestriccion(uint8_t m);
+Txn forbiddenLeftPassage    (uint8_t m);
+Txn forbiddenRightPassage   (uint8_t m);
+Txn disablePassageRestriccion(uint8_t m);
 
 // Función genérica (útil para comandos no mapeados específicamente)
 // La añadimos inline o en cpp para flexibilidad en el json
-void sendCustomCmd(uint8_t machine, uint8_t cmd, uint8_t d0, uint8_t d1);
+Txn sendCustomCmd(uint8_t machine, uint8_t cmd, uint8_t d0, uint8_t d1);
 
-// Parámetros
+// Parámetros: esperan la confirmación del torno (hasta RS485_PARAM_WAIT_MS)
 bool setParam(uint8_t m, uint8_t menu, uint8_t value);
 
 // --- Helpers web para parámetros ---
 bool writeParam(uint8_t id, uint8_t value);
 bool readParam(uint8_t id, uint8_t& value);
 
+// --- Sincronización de parámetros (MACHINE_ID) ---
+// Copia en sombra de lo que tiene el torno, por menú: leído del torno o
+// supuesto (NVS al arrancar con seedParams, o escrito y aún sin leer). Así
+// guardar un parámetro cuesta una sola transacción y no los 37.
+struct ParamSyncResult {
+  uint8_t  changed = 0;   // menús distintos de la sombra (o desconocidos)
+  uint8_t  written = 0;   // escrituras confirmadas por el torno
+  uint8_t  verified = 0;  // leídos de vuelta con el valor pedido (RS485_CMD_PARAM_READ)
+  uint8_t  failed = 0;    // sin confirmar, o con otro valor al leerlos
+  uint8_t  firstFailed = 0xFF; // menú del primer fallo
+  uint32_t ms = 0;
+  bool ok() const { return failed == 0; }
+};
+
+// Valores que se suponen en el torno para los menús 0..n-1 (no pisa los confirmados)
+void seedParams(const uint8_t* values, uint8_t n);
+
+// Escribe solo los menús 0..n-1 que difieren de la sombra, con hasta
+// RS485_PARAM_PIPELINE órdenes en la cola a la vez y sin esperar a cada una
+// para encolar la siguiente. Con RS485_CMD_PARAM_READ además los lee de
+// vuelta. Lo que falla o no termina en 'timeoutMs' (plazo total) sale de la
+// sombra y se vuelve a escribir en la siguiente llamada.
+ParamSyncResult syncParams(const uint8_t* want, uint8_t n, uint32_t timeoutMs);
+
 } // namespace RS485
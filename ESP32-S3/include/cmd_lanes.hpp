@@ -0,0 +1,69 @@
+#ifndef CMD_LANES_HPP
+#define CMD_LANES_HPP
+
+#pragma once
+#include <Arduino.h>
+#include "types.hpp"
+
+// ============================================================================
+// Cola IO → NET con carriles de prioridad (sustituye al antiguo qToNet)
+//  - CRÍTICO:   CMD_VALIDATE_IN / CMD_VALIDATE_OUT (visitante esperando)
+//  - NORMAL:    CMD_PASS_IN / CMD_PASS_OUT / CMD_PASS_OK / CMD_PASS_TIMEOUT
+//  - BEST EFFORT: CMD_FAIL_REPORT, telemetría y latido (CMD_HEARTBEAT)
+// cmdPop() siempre saca del carril más prioritario no vacío; dentro de cada
+// carril se respeta el orden de llegada. Los latidos no ocupan hueco: se
+// quedan en una marca que se fusiona si ya había uno pendiente.
+// ============================================================================
+
+#ifndef CMD_LANE_CRIT_LEN
+#define CMD_LANE_CRIT_LEN 4
+#endif
+#ifndef CMD_LANE_NORMAL_LEN
+#define CMD_LANE_NORMAL_LEN 10
+#endif
+#ifndef CMD_LANE_BE_LEN
+#define CMD_LANE_BE_LEN 6
+#endif
+
+enum CmdLane : uint8_t
+{
+  LANE_CRITICA = 0,
+  LANE_NORMAL,
+  LANE_BEST_EFFORT,
+  LANE_COUNT
+};
+
+// Histogramas: profundidad del carril al encolar y espera hasta salir
+#define CMD_HIST_BUCKETS 6
+// Profundidad: 0 | 1 | 2 | 3-4 | 5-8 | >8
+// Espera (ms): <10 | <50 | <200 | <1000 | <5000 | >=5000
+
+struct CmdLaneStats
+{
+  uint32_t pushed;
+  uint32_t dropped;   // carril lleno
+  uint32_t coalesced; // latidos fusionados (solo LANE_BEST_EFFORT)
+  uint32_t maxWaitMs;
+  uint32_t depthHist[CMD_HIST_BUCKETS];
+  uint32_t waitHist[CMD_HIST_BUCKETS];
+};
+
+bool cmdLanesBegin(); // crea las colas (setup, antes de lanzar las tareas)
+
+CmdLane cmdLaneOf(CmdType type);
+
+// Encola en el carril que corresponde a msg.type (desde taskIO)
+bool cmdPush(const CmdMsg &msg, TickType_t wait);
+
+// Pide un latido /status; si ya había uno pendiente se fusiona
+void cmdRequestHeartbeat();
+
+// Saca el siguiente comando por prioridad, mirando solo los carriles hasta
+// 'hasta' (el latido solo con LANE_BEST_EFFORT). No bloquea.
+bool cmdPop(CmdMsg &out, CmdLane hasta = LANE_BEST_EFFORT);
+
+uint32_t cmdLanesDepth(); // total pendiente (incluye el latido)
+CmdLaneStats cmdLaneStats(CmdLane lane);
+String cmdLanesStatsJson(); // {"critica":{...},"normal":{...},"best_effort":{...}}
+
+#endif // CMD_LANES_HPP
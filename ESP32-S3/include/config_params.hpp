@@ -1,7 +1,12 @@
 #pragma once
 #include <Arduino.h>
 
-struct TornoParams {
+// Es también el registro que se guarda en NVS (un solo blob, ver
+// config_store.hpp). Los parámetros nuevos se añaden al final; un cambio
+// incompatible sube PARAMS_SCHEMA y se migra en config_params.cpp.
+#define PARAMS_SCHEMA 1
+
+struct __attribute__((packed)) TornoParams {
     uint16_t machineId;      // 0
     uint8_t  openingMode;    // 1
     uint16_t waitTime;       // 2
@@ -41,10 +46,19 @@ struct TornoParams {
     uint8_t  lightSlave;     // 36
 };
 
-bool paramsBegin();
+#define PARAMS_COUNT 37 // menús 0..36 del torno
+
+// Valor que sale al bus para cada menú (índice = menú, byte bajo del campo,
+// como RS485::setParam)
+void paramsToBus(const TornoParams& p, uint8_t out[PARAMS_COUNT]);
+
+bool paramsBegin(); // abre la NVS y carga el registro (migra el formato por claves)
 TornoParams paramsLoad();
 bool paramsSave(const TornoParams& p);
 
+// Registro vigente en RAM, sin copia
+const TornoParams& paramsView();
+
 // Aplica los parámetros cargados a tus variables uint individuales
 void paramsApplyToGlobals(const TornoParams& p);
 void paramsEnsureDefaults();
\ No newline at end of file
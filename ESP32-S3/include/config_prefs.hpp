@@ -2,6 +2,7 @@
 #include <Arduino.h>
 #include <IPAddress.h>
 
+// Copia editable (páginas de configuración)
 struct TornoConfig {
   String deviceId;   // nombrePlaca  -> DEVICE_ID
   uint8_t mac[6];      // MAC en binario (6 bytes)
@@ -14,7 +15,7 @@ struct TornoConfig {
   uint8_t modoPasillo;
   uint8_t modoApertura;
   uint8_t sentidoApertura;
-  uint32_t entradasTotales; 
+  uint32_t entradasTotales;
   uint32_t salidasTotales;
 
   uint8_t conexionRed;
@@ -22,13 +23,43 @@ struct TornoConfig {
   String ip, gw, mask, dns1, dns2; // como texto
 };
 
+// Registro tal y como se guarda en NVS (un solo blob, ver config_store.hpp).
+// Los campos nuevos se añaden al final (se rellenan con el default al leer
+// un registro más corto); un cambio incompatible sube CFG_SCHEMA y se migra
+// en config_prefs.cpp.
+#define CFG_SCHEMA 1
 
-bool cfgBegin();
+struct __attribute__((packed)) CfgRecord {
+  char deviceId[32];
+  uint8_t mac[6];
+  char wifiSSID[33];
+  char wifiPass[65];
+  char urlBase[160];
+  char urlActualiza[160];
+
+  uint8_t modoPasillo;
+  uint8_t modoApertura;
+  uint8_t sentidoApertura;
+  uint32_t entradasTotales;
+  uint32_t salidasTotales;
+
+  uint8_t conexionRed;
+  uint8_t modoRed;
+  uint8_t ip[4], gw[4], mask[4], dns1[4], dns2[4]; // binario, sin pasar por texto
+
+  uint32_t defaultsSig; // firma de los defaults del firmware que lo escribió
+};
+
+
+bool cfgBegin(); // abre la NVS y carga el registro (migra el formato por claves)
 TornoConfig cfgLoad();
 bool cfgSave(const TornoConfig& c);
 
+// Registro vigente en RAM, sin copia
+const CfgRecord& cfgView();
+
 // aplica config a las variables globales de definiciones.cpp
-void cfgApplyToGlobals(const TornoConfig& c);
+void cfgApplyToGlobals(const CfgRecord& r);
 void cfgEnsureFirmwareDefaults();
 
 
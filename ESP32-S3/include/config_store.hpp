@@ -0,0 +1,53 @@
+#ifndef CONFIG_STORE_HPP
+#define CONFIG_STORE_HPP
+
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+
+// ============================================================================
+// Registro de configuración binario en NVS con dos copias (A/B)
+//  - Cada commit es un único putBytes() de cabecera + datos en la ranura que
+//    NO tiene el registro vigente: un corte a mitad deja la otra intacta y
+//    nunca queda una configuración mezclada
+//  - Cabecera con magic, versión de esquema, longitud, secuencia y CRC-32;
+//    al cargar gana la copia válida con la secuencia más alta
+//  - Si el esquema guardado es otro, el llamador migra (config_prefs.cpp,
+//    config_params.cpp) y vuelve a hacer commit
+//  - Solo usa Preferences: se puede probar en el host con una NVS simulada
+// ============================================================================
+
+#ifndef CFG_STORE_MAX
+#define CFG_STORE_MAX 1024 // datos máximos de un registro (sin cabecera)
+#endif
+
+struct __attribute__((packed)) CfgStoreHdr
+{
+  uint32_t magic;
+  uint16_t schema; // versión del esquema de los datos
+  uint16_t len;    // bytes de datos tras la cabecera
+  uint32_t seq;    // crece con cada commit
+  uint32_t crc;    // CRC-32 de la cabecera (hasta crc) y los datos
+};
+
+struct CfgStore
+{
+  Preferences *prefs;
+  uint32_t magic;
+  uint32_t seq;       // secuencia del registro vigente (0 = ninguno)
+  uint8_t slot;       // ranura del registro vigente (0 = A, 1 = B)
+  uint32_t commits;
+  uint32_t badSlots;  // copias descartadas al cargar (CRC, magic o tamaño)
+};
+
+void cfgStoreInit(CfgStore &s, Preferences &prefs, uint32_t magic);
+
+// Copia en 'out' (hasta 'cap' bytes) los datos de la copia válida más
+// reciente y devuelve cuántos bytes se guardaron, que pueden no coincidir
+// con 'cap' si el esquema cambió. -1 si no hay ninguna copia válida.
+int cfgStoreLoad(CfgStore &s, void *out, size_t cap, uint16_t &schema);
+
+// Escribe el registro en la otra ranura con un único putBytes
+bool cfgStoreCommit(CfgStore &s, uint16_t schema, const void *data, size_t len);
+
+#endif // CONFIG_STORE_HPP
@@ -107,6 +107,9 @@
 
     // =================== Flags de control del ciclo ===================
     extern int actualizarFlag; // 1 => iniciar OTA
+    extern uint32_t otaSlotS;     // 310: segundos hasta la franja de actualización
+    extern uint32_t otaVentanaS;  // 310: duración de la franja (0 = por defecto)
+    extern volatile StateIO estadoIO; // estado de taskIO (ST_IDLE = sin lectura ni paso)
     extern int restartFlag;    // 1 => reset
     extern int activaConecta;  // habilita /status periódico
     extern bool errorNotificado; // si ya se notificó error al backend en este ciclo
@@ -120,7 +123,6 @@
 
     // =================== Buffers JSON compartidos ===================
     extern String outputInicio, outputEstado, outputTicket, outputPaso, outputReportFailure;
-    extern String estadoRecibido, ticketRecibido, pasoRecibido;
 
     // =================== Métricas/errores/auxiliares ===================
     extern unsigned long inicioServidor, finServidor; // medir latencia HTTP
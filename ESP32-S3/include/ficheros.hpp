@@ -7,6 +7,31 @@
 #include <LittleFS.h>
 #include <pgmspace.h>
 
+#ifndef PAGES_MANIFEST_PATH
+#define PAGES_MANIFEST_PATH "/pages.man" // hash y tamaño de cada página escrita
+#endif
+
+struct WebPagesStats
+{
+  uint32_t written;      // páginas reescritas en este arranque
+  uint32_t skipped;      // páginas que ya estaban al día
+  uint32_t bytesWritten; // bytes escritos en LittleFS en este arranque
+  uint32_t bytesTotal;   // bytes de todas las páginas embebidas
+  uint32_t bootUs;       // duración de ensureWebPagesInLittleFS()
+};
+
+// Vuelca a LittleFS solo las páginas embebidas que han cambiado desde el
+// último arranque (según el manifiesto) o que faltan
 bool ensureWebPagesInLittleFS(bool formatOnFail);
 
+// La copia de la página en LittleFS sigue siendo la del firmware (mismo hash
+// y tamaño que en el manifiesto). Se comprueba leyendo el fichero la primera
+// vez y tras cada webPageChanged(); false si no es una página embebida.
+bool webPageIsStock(const char *path);
+// Avisa de que el fichero se ha sustituido o borrado (subida desde /upload_fs)
+void webPageChanged(const char *path);
+
+WebPagesStats webPagesStats();
+String webPagesStatsJson();
+
 #endif // FICHEROS_HPP
\ No newline at end of file
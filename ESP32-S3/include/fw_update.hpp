@@ -0,0 +1,58 @@
+#ifndef FW_UPDATE_HPP
+#define FW_UPDATE_HPP
+
+#pragma once
+#include <Arduino.h>
+
+// ============================================================================
+// Escritura de firmware directa a la partición OTA (sin copia en LittleFS)
+//  - Los datos llegan en trozos de cualquier tamaño (subida multipart,
+//    descarga HTTP) y se agrupan en bloques de FW_BLOCK (un sector de
+//    flash) antes de pasar a Update.write
+//  - SHA-256 incremental de la imagen mientras se escribe; si se indica el
+//    esperado y no coincide, se aborta antes de cambiar la partición de
+//    arranque
+//  - Una sola actualización a la vez (bloque estático)
+// ============================================================================
+
+#ifndef FW_BLOCK
+#define FW_BLOCK 4096 // sector de flash
+#endif
+
+// size = 0: tamaño desconocido (hasta llenar la partición)
+bool fwUpdateBegin(size_t size = 0);
+bool fwUpdateWrite(const uint8_t *data, size_t len);
+
+// Cierra la imagen y la marca para el siguiente arranque. 'sha256Hex'
+// (64 caracteres, nullptr o "" = sin comprobar) se compara antes.
+bool fwUpdateEnd(const char *sha256Hex = nullptr);
+void fwUpdateAbort();
+
+bool fwUpdateActive();
+size_t fwUpdateWritten();
+const char *fwUpdateError();         // motivo del último fallo
+void fwUpdateDigestHex(char out[65]); // SHA-256 de lo escrito (tras fwUpdateEnd)
+
+// ===== Imagen en ejecución (base de las imágenes diferenciales) =============
+bool fwRunningRead(uint32_t offset, uint8_t *buf, size_t len);
+bool fwRunningSha256(size_t len, uint8_t out[32]); // de los primeros 'len' bytes
+
+// ===== Validación tras actualizar (vuelta atrás) ============================
+// Una imagen recién instalada arranca "a prueba": se confirma cuando el
+// backend responde. Si no lo hace en FW_VERIFY_MS con enlace (sin red no se
+// puede juzgar), o si se reinicia FW_VERIFY_BOOTS veces sin confirmarse, se
+// vuelve a la partición anterior.
+// Con el bootloader compilado con CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE
+// además se usa su estado PENDING_VERIFY (cubre cuelgues antes de setup).
+#ifndef FW_VERIFY_MS
+#define FW_VERIFY_MS 600000UL // 10 min de enlace para hablar con el backend
+#endif
+#ifndef FW_VERIFY_BOOTS
+#define FW_VERIFY_BOOTS 3 // arranques sin confirmar antes de volver atrás
+#endif
+
+void fwUpdateBootCheck();           // setup, lo antes posible
+bool fwUpdatePendingVerify();       // la imagen en ejecución aún no está confirmada
+void fwUpdateVerifyLoop(bool conRed, bool sano); // taskNet: confirma si 'sano'; revierte al vencer el plazo
+
+#endif // FW_UPDATE_HPP
@@ -3,6 +3,7 @@
 
 #pragma once
 #include <Arduino.h>
+#include "http_parser.hpp"
 
 // ============================================================================
 // Cliente HTTP sobre W5500 (solo HTTP claro). Provee:
@@ -16,12 +17,33 @@
 #ifndef HTTP_TIMEOUT_MS
 #define HTTP_TIMEOUT_MS 2000 // timeout de socket por operación
 #endif
+#ifndef HTTP_CONNECT_TIMEOUT_MS
+#define HTTP_CONNECT_TIMEOUT_MS 1000 // tope del connect() TCP (es la única fase que bloquea)
+#endif
 #ifndef HTTP_READ_TIMEOUT_MS
 #define HTTP_READ_TIMEOUT_MS 1500 // timeout acumulado lectura cruda
 #endif
 #ifndef HTTP_MAX_BYTES
 #define HTTP_MAX_BYTES 32768 // tope de lectura cruda (seguridad)
 #endif
+#ifndef HTTP_RESP_BUF_SIZE
+#define HTTP_RESP_BUF_SIZE 2048 // cuerpo máximo de las respuestas JSON del backend
+#endif
+#ifndef HTTP_KEEPALIVE_IDLE_MS
+#define HTTP_KEEPALIVE_IDLE_MS 15000 // cierre de la conexión persistente tras este tiempo ociosa
+#endif
+
+// ===== Pool keep-alive (una conexión persistente por transporte) ============
+struct HttpPoolStats
+{
+  uint32_t connects;   // conexiones TCP nuevas
+  uint32_t reuses;     // peticiones servidas sobre una conexión ya abierta
+  uint32_t reconnects; // conexiones reutilizadas que estaban medio cerradas y se rehicieron
+  uint32_t expired;    // conexiones cerradas por superar HTTP_KEEPALIVE_IDLE_MS
+};
+
+HttpPoolStats httpPoolStats();
+void httpPoolReset(); // cierra las conexiones persistentes (p.ej. al caer el enlace)
 
 // ============ Funciones “raw” (útiles para sincronía de hora por Date) ======
 bool httpGetRaw(const char *host, uint16_t port, const char *path,
@@ -38,14 +60,132 @@ void postTicket();    // POST /validateQR
 void postPaso();      // POST /validatePass
 void reportFailure(); // POST /reportFailure
 
+// ===================== Motor asíncrono (se avanza desde taskNet) =============
+// Las mismas peticiones que la API de arriba, pero encoladas: httpSubmit()
+// serializa el payload en el momento y vuelve enseguida; httpPoll() avanza la
+// petición activa (conectar → enviar → recibir) sin esperar al backend. Al
+// terminar se aplica la respuesta igual que en la versión bloqueante
+// (descifra*, iniciOk, g_validateOutcome...) y se llama a 'done'.
+#ifndef HTTP_ASYNC_QUEUE_LEN
+#define HTTP_ASYNC_QUEUE_LEN 6 // peticiones en cola + en vuelo
+#endif
+#ifndef HTTP_ASYNC_DEADLINE_MS
+#define HTTP_ASYNC_DEADLINE_MS 4000 // plazo por defecto desde que se encola
+#endif
+
+enum HttpReqKind : uint8_t
+{
+  REQ_INICIO = 0, // /inicio
+  REQ_ESTADO,     // /status
+  REQ_TICKET,     // /validateQR
+  REQ_PASO,       // /validatePass
+  REQ_FAILURE,    // /reportFailure
+  REQ_ENTRADAS,   // /entries (texto plano, cuerpo por trozos a un callback)
+  REQ_PENDIENTES  // /entries/pending (text/plain, cuerpo de postPendientesBloque)
+};
+
+typedef void (*HttpDoneCb)(HttpReqKind kind, bool ok);
+
+struct HttpAsyncStats
+{
+  uint32_t submitted;
+  uint32_t completed; // respuesta 2xx aplicada
+  uint32_t failed;    // error de red o status no 2xx
+  uint32_t timedOut;  // plazo vencido (en cola o en vuelo)
+  uint32_t rejected;  // cola llena
+  uint32_t maxLatencyMs;
+};
+
+bool httpSubmit(HttpReqKind kind, HttpDoneCb done = nullptr,
+                uint32_t deadlineMs = HTTP_ASYNC_DEADLINE_MS); // false si la cola está llena
+// Igual, pero el cuerpo se entrega a onBody según llega (respuestas grandes)
+bool httpSubmitStream(HttpReqKind kind, HttpBodyCb onBody, void *ctx,
+                      HttpDoneCb done, uint32_t deadlineMs);
+void httpPoll();                                              // llamar en cada vuelta de taskNet
+bool httpPending(HttpReqKind kind);                           // hay una petición de ese tipo sin terminar
+bool httpIdle();                                              // nada en cola ni en vuelo
+HttpAsyncStats httpAsyncStats();
+
 bool getEntradas(String &outTexto);           // POST /entries (texto plano)
-bool postPendientesBloque(const String &txt); // POST /entries/pending (text/plain)
+// POST /entries/pending (text/plain) por el motor asíncrono: false si la cola
+// está llena; el resultado llega a 'done'
+bool postPendientesBloque(const String &txt, HttpDoneCb done);
 
 bool linkUp();
 bool netOk();
 
 
 // =============================== OTA por HTTP ================================
-void actualiza(); // Descarga .bin por HTTP y hace Update
+// actualiza() arranca la descarga de urlActualiza (solo http://) y vuelve;
+// otaPoll() la avanza desde taskNet por tramos de OTA_POLL_MS y solo con el
+// torno en reposo (con paso en curso no se escribe en flash). El servidor
+// puede devolver el .bin tal cual o un contenedor comprimido o diferencial
+// contra la imagen en ejecución (ota_delta.hpp, scripts/ota_pack.py); el
+// equipo anuncia X-Firmware-Version y X-Firmware-Accept. Si la conexión se
+// corta se reanuda con Range desde el último byte decodificado. Instalada la
+// imagen se reinicia en reposo y arranca a prueba (fwUpdateVerifyLoop).
+#ifndef OTA_POLL_MS
+#define OTA_POLL_MS 20 // tope por vuelta de taskNet
+#endif
+#ifndef OTA_STALL_MS
+#define OTA_STALL_MS 15000 // sin datos: se corta y se reanuda
+#endif
+#ifndef OTA_RETRY_MS
+#define OTA_RETRY_MS 5000 // espera antes de reconectar
+#endif
+#ifndef OTA_MAX_RETRIES
+#define OTA_MAX_RETRIES 8 // cortes seguidos sin avanzar antes de abandonar
+#endif
+#ifndef OTA_FAIL_HOLD_MS
+#define OTA_FAIL_HOLD_MS 600000UL // tras abandonar, el 310 del backend no la relanza hasta pasado esto
+#endif
+
+// Despliegue escalonado: el 310 puede traer "slot" (segundos hasta la franja
+// asignada) y "window" (duración de la franja). La descarga empieza dentro
+// de la franja y solo con el torno en reposo; si la franja pasa sin poder
+// empezar se descarta y el latido lo anuncia (fase "missed") para que el
+// backend asigne otra. El latido lleva además disponibilidad, carga y avance
+// (bloque "ota" de serializaEstado) para que el backend nunca deje sin servicio los dos
+// carriles de un torno a la vez.
+#ifndef OTA_SLOT_WINDOW_S
+#define OTA_SLOT_WINDOW_S 300 // franja por defecto si el 310 no trae "window"
+#endif
+#ifndef OTA_SLOT_MAX_S
+#define OTA_SLOT_MAX_S 86400 // franjas más lejanas se recortan a esto
+#endif
+
+struct OtaStats
+{
+  uint32_t wireBytes;  // cuerpo recibido (lo que pasa por la red)
+  uint32_t imageBytes; // imagen escrita en la partición
+  uint32_t imageSize;  // tamaño de la imagen destino (0 hasta leer la cabecera)
+  uint32_t baseBytes;  // de ella, copiada de la imagen en ejecución
+  uint32_t connects;
+  uint32_t resumes;    // reanudaciones con Range
+  uint32_t failures;   // descargas abandonadas
+  uint32_t lastFailMs;
+  uint32_t slotsMissed; // franjas que pasaron sin poder empezar
+  uint8_t kind;        // OtaKind de la última descarga
+  bool active;
+  const char *lastError;
+};
+
+void actualiza();            // arranca la descarga (no bloquea)
+void otaPoll(bool enReposo); // llamar en cada vuelta de taskNet
+bool otaActive();
+OtaStats otaStats();
+String otaStatsJson();
+
+// Franja del backend (status 310): la descarga arranca en otaPoll() entre
+// 'esperaS' y 'esperaS + ventanaS' segundos desde ahora (ventanaS = 0 →
+// OTA_SLOT_WINDOW_S). Sustituye a una franja anterior aún sin empezar.
+void otaProgramar(uint32_t esperaS, uint32_t ventanaS);
+// "idle" | "slot" | "download" | "reboot" | "verify" | "missed" | "failed"
+const char *otaFase();
+// Se puede pedir una actualización ahora (nada en curso ni a prueba y sin
+// fallo reciente)
+bool otaDisponible();
+// Segundos hasta la franja programada (0 si ya está abierta, -1 sin franja)
+int32_t otaSlotEnS();
 
 #endif // HTTP_HPP
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef HTTP_PARSER_HPP
+#define HTTP_PARSER_HPP
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// Parser incremental de respuestas HTTP/1.1 (sin memoria dinámica)
+//  - Se alimenta con bloques tal y como llegan del socket (httpParserFeed)
+//  - Status line, cabeceras, Content-Length, chunked y "hasta cierre"
+//  - El cuerpo se copia a un buffer del llamante (terminado en '\0') o se
+//    entrega a un callback, sin Strings intermedios
+//  - No depende de Arduino: se puede compilar y probar en el host
+// ============================================================================
+
+#ifndef HTTP_PARSER_LINE
+#define HTTP_PARSER_LINE 192 // status line / cabecera / tamaño de chunk (se trunca lo que sobre)
+#endif
+
+// Cabecera recibida (nombre y valor ya recortados, terminados en '\0')
+typedef void (*HttpHeaderCb)(void *ctx, const char *name, const char *value);
+// Trozo de cuerpo recibido. Devolver false aborta el parseo.
+typedef bool (*HttpBodyCb)(void *ctx, const uint8_t *data, size_t len);
+
+enum HttpParseState : uint8_t
+{
+  HP_STATUS = 0,  // esperando "HTTP/1.x NNN ..."
+  HP_HEADERS,     // cabeceras hasta línea vacía
+  HP_BODY_LEN,    // cuerpo con Content-Length
+  HP_BODY_EOF,    // cuerpo sin longitud: termina al cerrar el servidor
+  HP_CHUNK_SIZE,  // línea "<hex>[;ext]"
+  HP_CHUNK_DATA,  // datos del chunk
+  HP_CHUNK_CRLF,  // CRLF tras los datos del chunk
+  HP_TRAILERS,    // cabeceras finales tras el chunk 0
+  HP_DONE,
+  HP_ERROR
+};
+
+struct HttpRespParser
+{
+  // --- Resultado ---
+  int status;           // código HTTP (0 si aún no se ha leído)
+  bool keepAlive;       // HTTP/1.1 sin "Connection: close"
+  bool chunked;         // Transfer-Encoding: chunked
+  bool hasLength;       // llegó Content-Length
+  bool overflow;        // el cuerpo no cupo en 'buf' (se descarta el exceso)
+  size_t contentLength; // valor de Content-Length
+  size_t bodyLen;       // bytes de cuerpo recibidos (aunque no cupieran)
+  size_t rawBytes;      // bytes totales consumidos del socket
+
+  // --- Destino ---
+  char *buf;       // buffer del llamante (puede ser nullptr si se usa onBody)
+  size_t cap;      // capacidad de 'buf' incluyendo el '\0'
+  HttpBodyCb onBody;
+  HttpHeaderCb onHeader;
+  void *ctx;
+
+  // --- Interno ---
+  HttpParseState state;
+  size_t remaining; // bytes pendientes del cuerpo o del chunk actual
+  uint16_t lineLen;
+  char line[HTTP_PARSER_LINE];
+};
+
+// Cuerpo a buffer fijo (se termina siempre en '\0')
+void httpParserInit(HttpRespParser &p, char *buf, size_t cap);
+// Cuerpo entregado por trozos a un callback
+void httpParserInitSink(HttpRespParser &p, HttpBodyCb onBody, void *ctx);
+
+// Vuelve al estado inicial conservando el destino (buffer o callbacks)
+void httpParserReset(HttpRespParser &p);
+
+// Consume 'len' bytes. Devuelve los consumidos (menos de 'len' solo si la
+// respuesta terminó o hubo error; lo sobrante pertenece a la siguiente).
+size_t httpParserFeed(HttpRespParser &p, const uint8_t *data, size_t len);
+
+// El servidor cerró la conexión. Devuelve true si la respuesta quedó completa.
+bool httpParserFinish(HttpRespParser &p);
+
+static inline bool httpParserDone(const HttpRespParser &p) { return p.state == HP_DONE; }
+static inline bool httpParserFailed(const HttpRespParser &p) { return p.state == HP_ERROR; }
+
+#endif // HTTP_PARSER_HPP
@@ -22,10 +22,10 @@ void serializaQR();            // → outputTicket (incluye ultimoTicket)
 void serializaPaso();          // → outputPaso   (incluye ultimoPaso)
 void serializaReportFailure(); // → outputInicio (reutilizado)
 
-// ---- Deserializadores (llenan estado desde *Recibido) ----
-void descifraEstado();
-void descifraQR();
-void descifraPaso();
+// ---- Deserializadores (leen el cuerpo HTTP directamente del buffer de http.cpp) ----
+void descifraEstado(const char *json, size_t len);
+void descifraQR(const char *json, size_t len);
+void descifraPaso(const char *json, size_t len);
 
 void resetCycleReady();
 // ============================================================================
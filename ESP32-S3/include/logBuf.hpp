@@ -1,34 +1,72 @@
 #pragma once
 #include <Arduino.h>
 
+// ============================================================================
+// Registro de logs en RAM sin bloqueos y con formateo diferido
+//  - logbuf_pushf() no formatea: guarda marca de tiempo, puntero al formato
+//    y los argumentos en crudo (las cadenas %s se copian) en un anillo de
+//    registros binarios de tamaño fijo
+//  - Varios productores (cualquier tarea) reservan hueco con un contador
+//    atómico; no hay sección crítica ni se deshabilitan interrupciones
+//  - El texto se genera solo al leer (/logs_data, en streaming)
+//  - El formato debe ser un literal (se guarda el puntero, no una copia)
+// ============================================================================
+
 // Ajustes
 #ifndef LOGBUF_CAP
-#define LOGBUF_CAP 200          // nº de líneas en RAM
+#define LOGBUF_CAP 256          // nº de registros en RAM (potencia de 2)
 #endif
 
 #ifndef LOGBUF_LINE
-#define LOGBUF_LINE 160         // tamaño max por línea
+#define LOGBUF_LINE 160         // tamaño max por línea ya formateada
+#endif
+
+#ifndef LOGBUF_ARGS
+#define LOGBUF_ARGS 8           // palabras de 32 bits para argumentos (64 bits/double ocupan 2)
 #endif
 
-struct LogEntry {
-  uint32_t id;
-  uint32_t ms;
-  char msg[LOGBUF_LINE];
-};
+#ifndef LOGBUF_STR
+#define LOGBUF_STR 128          // bytes para las cadenas %s de un registro (se truncan; máx. 255)
+#endif
+
+#ifndef LOGBUF_JSON_ITEMS
+#define LOGBUF_JSON_ITEMS 64    // registros por respuesta de /logs_data
+#endif
+
+#ifndef LOGBUF_JSON_CHUNK
+#define LOGBUF_JSON_CHUNK 512   // bloque de salida del JSON en streaming
+#endif
+
+#ifndef LOGBUF_ALWAYS_ON
+#define LOGBUF_ALWAYS_ON 1      // el coste por log es bajo: se registra aunque no haya sesión
+#endif
 
 // Inicializa el buffer (llamar una vez en setup)
 void logbuf_begin();
 
-// Habilita/deshabilita el logging (para evitar overhead cuando nadie mira)
+// Habilita/deshabilita el logging (con LOGBUF_ALWAYS_ON no se desactiva)
 void logbuf_enable(bool on);
 bool logbuf_enabled();
 
 // Limpia el buffer (RAM)
 void logbuf_clear();
 
-// Push “printf-style”
+// Push “printf-style” (formato literal; %d %u %x %c %ld %lld %f %p %s, '*' incluido)
 void logbuf_pushf(const char* fmt, ...);
 
-// Devuelve JSON con items nuevos desde `since`.
-// `outNext` te devuelve el último id disponible (cursor).
-String logbuf_get_json_since(uint32_t since, uint32_t& outNext);
+// Trozo de salida (devolver false interrumpe el envío)
+typedef bool (*LogBufSink)(void *ctx, const uint8_t *data, size_t len);
+
+// Hay algo que entregar tras `since` (barato; para esperas largas)
+bool logbuf_has_since(uint32_t since);
+
+// Escribe {"items":[{"id","ms","msg"},...],"next":cursor} con los registros
+// tras `since`, leídos del anillo sin copia global y enviados a `sink` en
+// bloques de LOGBUF_JSON_CHUNK. false si el sink cortó el envío.
+bool logbuf_stream_json(uint32_t since, LogBufSink sink, void *ctx,
+                        uint16_t maxItems = LOGBUF_JSON_ITEMS);
+
+// Siguiente registro tras `cursor`, ya formateado en `line` (para volcados;
+// ignora logbuf_clear()). Avanza el cursor; false si no hay nada nuevo.
+// Lo que se pisó antes de leerlo se salta.
+bool logbuf_next(uint32_t& cursor, uint32_t& ms, char* line, size_t cap);
@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+
+// ============================================================================
+// Copia persistente de los logs (sobrevive a reinicios, OTA y watchdog)
+//  - taskNet drena logbuf y formatea cada línea ("<ms> <texto>\n") en un
+//    anillo en RTC RAM que no se borra al reiniciar (RTC_NOINIT)
+//  - Lo acumulado se añade por lotes a segmentos de LittleFS con rotación
+//    acotada, y solo con el torno en reposo: nunca se escribe en flash en el
+//    camino lectura → validación → apertura
+//  - Al arrancar, lo que quedó en RTC sin volcar se escribe primero, seguido
+//    de una marca con el motivo del reinicio
+//  - La descarga recorre los segmentos por trozos (sin cargarlos en RAM)
+// ============================================================================
+
+#ifndef LOGSPOOL_DIR
+#define LOGSPOOL_DIR "/logs"
+#endif
+#ifndef LOGSPOOL_SEG_BYTES
+#define LOGSPOOL_SEG_BYTES 16384 // tamaño de cada segmento antes de rotar
+#endif
+#ifndef LOGSPOOL_MAX_SEGS
+#define LOGSPOOL_MAX_SEGS 8 // tope en flash; al llenarse se borra el más antiguo
+#endif
+#ifndef LOGSPOOL_RTC_BYTES
+#define LOGSPOOL_RTC_BYTES 3072 // anillo en RTC RAM (lo último antes de un reinicio)
+#endif
+#ifndef LOGSPOOL_BATCH
+#define LOGSPOOL_BATCH 2048 // bytes pendientes que disparan la escritura
+#endif
+#ifndef LOGSPOOL_FLUSH_MS
+#define LOGSPOOL_FLUSH_MS 120000UL // antigüedad máxima de lo pendiente
+#endif
+
+struct LogSpoolStats
+{
+  uint32_t segments;  // segmentos en LittleFS
+  uint32_t bytes;     // bytes en LittleFS
+  uint32_t pending;   // bytes en RTC aún sin volcar
+  uint32_t lost;      // bytes descartados por llenarse el anillo RTC sin poder volcar
+  uint32_t flushes;   // lotes escritos
+  uint32_t deferred;  // lotes aplazados por torno ocupado
+  uint32_t errors;    // fallos de escritura en LittleFS (se reintenta)
+  uint32_t lastFlushMs;
+  uint32_t boots;     // arranques registrados en RTC desde el último encendido
+};
+
+// Trozo de la descarga. Devolver false la interrumpe.
+typedef bool (*LogSpoolSink)(void *ctx, const uint8_t *data, size_t len);
+
+bool logspool_begin();             // setup, tras montar LittleFS
+void logspool_loop(bool enReposo); // taskNet: drena logbuf; escribe en flash solo en reposo
+
+uint32_t logspool_size();          // bytes de la descarga completa
+bool logspool_stream(LogSpoolSink sink, void *ctx); // segmentos + lo pendiente en RTC
+
+LogSpoolStats logspool_stats();
+String logspool_stats_json();
@@ -0,0 +1,75 @@
+#ifndef MULTIPART_HPP
+#define MULTIPART_HPP
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// Parser incremental de multipart/form-data (sin memoria dinámica)
+//  - Se alimenta con los bloques tal y como llegan del socket
+//  - Entrega las cabeceras de cada parte y después su contenido por trozos
+//    grandes, hasta el siguiente "\r\n--<boundary>"
+//  - El marcador se busca con Boyer-Moore-Horspool sobre una ventana fija:
+//    se salta hasta markerLen bytes por comparación y solo se retienen los
+//    últimos markerLen-1 bytes por si el marcador queda partido entre bloques
+//  - El epílogo tras "--<boundary>--" se ignora
+//  - No depende de Arduino: se puede compilar y probar en el host
+// ============================================================================
+
+#ifndef MULTIPART_BOUNDARY_MAX
+#define MULTIPART_BOUNDARY_MAX 72 // RFC 2046: hasta 70 caracteres
+#endif
+#ifndef MULTIPART_HDR_MAX
+#define MULTIPART_HDR_MAX 384 // cabeceras de la parte (Content-Disposition, Content-Type)
+#endif
+#ifndef MULTIPART_WINDOW
+#define MULTIPART_WINDOW 1024 // ventana de búsqueda; onData recibe hasta esto menos el marcador
+#endif
+
+// Cabeceras de la parte (terminadas en '\0'). Devolver false descarta su contenido.
+typedef bool (*MultipartPartCb)(void *ctx, const char *headers);
+// Trozo del contenido de la parte. Devolver false aborta el parseo.
+typedef bool (*MultipartDataCb)(void *ctx, const uint8_t *data, size_t len);
+
+enum MultipartState : uint8_t
+{
+  MP_PREAMBLE = 0, // hasta el primer "--<boundary>"
+  MP_BOUNDARY_LINE, // resto de la línea del boundary ("--" = fin del cuerpo)
+  MP_HEADERS,       // cabeceras de la parte hasta línea vacía
+  MP_DATA,          // contenido hasta "\r\n--<boundary>"
+  MP_DONE,
+  MP_ERROR
+};
+
+struct MultipartParser
+{
+  MultipartState state;
+  bool discard;     // onPart rechazó la parte
+  uint8_t markerLen;
+  uint8_t parts;    // partes vistas
+  char marker[MULTIPART_BOUNDARY_MAX + 4]; // "\r\n--" + boundary
+  uint8_t skip[256]; // desplazamientos BMH por último byte de la ventana
+  uint16_t hdrLen;
+  char hdr[MULTIPART_HDR_MAX];
+  uint16_t winLen;
+  uint16_t scanFrom; // antes de aquí ya se buscó sin éxito
+  uint8_t win[MULTIPART_WINDOW];
+  size_t dataBytes; // contenido entregado (todas las partes)
+
+  MultipartPartCb onPart;
+  MultipartDataCb onData;
+  void *ctx;
+};
+
+// 'boundary' tal y como viene en Content-Type (sin los "--"). false si no cabe.
+bool multipartInit(MultipartParser &p, const char *boundary, size_t boundaryLen,
+                   MultipartPartCb onPart, MultipartDataCb onData, void *ctx);
+
+// Consume 'len' bytes. Devuelve los consumidos (todo, salvo error).
+size_t multipartFeed(MultipartParser &p, const uint8_t *data, size_t len);
+
+static inline bool multipartDone(const MultipartParser &p) { return p.state == MP_DONE; }
+static inline bool multipartFailed(const MultipartParser &p) { return p.state == MP_ERROR; }
+
+#endif // MULTIPART_HPP
@@ -0,0 +1,126 @@
+#ifndef OTA_DELTA_HPP
+#define OTA_DELTA_HPP
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// Decodificador incremental de imágenes OTA comprimidas o diferenciales
+//  - Se alimenta con el cuerpo HTTP tal y como llega (otaDecFeed) y entrega
+//    la imagen reconstruida por trozos a un callback (fwUpdateWrite)
+//  - Contenedor "MEOT" (lo genera scripts/ota_pack.py):
+//      cabecera de OTA_HDR_LEN bytes (little endian)
+//        0  "MEOT"         4  versión (1)      5  tipo (OTA_LZ / OTA_DELTA)
+//        6  ventana (u16)  8  tamaño destino   12 tamaño base
+//        16 SHA-256 destino                    48 SHA-256 base
+//      seguido de operaciones (argumentos en varint LEB128):
+//        OP_LIT  n, n bytes        bytes literales
+//        OP_COPY dist, n           repetir lo ya generado (ventana en RAM)
+//        OP_BASE delta, n          copiar de la imagen en ejecución; el
+//                                  origen es el final de la copia anterior
+//                                  más 'delta' (zigzag)
+//        OP_END
+//  - Un .bin sin contenedor (primer byte 0xE9) pasa tal cual (OTA_RAW)
+//  - Cada llamada genera como mucho OTA_DEC_STEP bytes: una copia larga de
+//    la base se reparte entre vueltas de taskNet
+//  - No depende de Arduino: se puede compilar y probar en el host
+// ============================================================================
+
+#ifndef OTA_WINDOW
+#define OTA_WINDOW 4096 // historial para OP_COPY (el contenedor no puede pedir más)
+#endif
+#ifndef OTA_DEC_STEP
+#define OTA_DEC_STEP 4096 // bytes generados como máximo por llamada
+#endif
+
+#define OTA_MAGIC "MEOT"
+#define OTA_HDR_LEN 80
+#define OTA_IMAGE_MAGIC 0xE9 // primer byte de una imagen de aplicación ESP32
+
+enum OtaKind : uint8_t
+{
+  OTA_RAW = 0,   // .bin sin contenedor
+  OTA_LZ = 1,    // comprimida (LIT + COPY)
+  OTA_DELTA = 2  // diferencial contra la imagen en ejecución (LIT + COPY + BASE)
+};
+
+enum OtaOp : uint8_t
+{
+  OP_END = 0,
+  OP_LIT = 1,
+  OP_COPY = 2,
+  OP_BASE = 3
+};
+
+enum OtaDecState : uint8_t
+{
+  OD_HEADER = 0, // acumulando la cabecera
+  OD_RAW,        // imagen sin contenedor: todo pasa tal cual
+  OD_OP,         // esperando código de operación
+  OD_ARGS,       // leyendo varints
+  OD_LIT,        // copiando literales de la entrada
+  OD_EXEC,       // COPY/BASE en curso (no consume entrada)
+  OD_DONE,
+  OD_ERROR
+};
+
+struct OtaImageInfo
+{
+  uint8_t kind;
+  uint16_t window;
+  uint32_t targetSize; // 0 en OTA_RAW (lo da Content-Length)
+  uint32_t baseSize;
+  uint8_t targetSha[32];
+  uint8_t baseSha[32];
+};
+
+// Cabecera leída: devolver false rechaza la imagen (p.ej. base distinta)
+typedef bool (*OtaHeaderCb)(void *ctx, const OtaImageInfo &info);
+// Trozo de imagen reconstruida. Devolver false aborta.
+typedef bool (*OtaOutCb)(void *ctx, const uint8_t *data, size_t len);
+// Lectura de la imagen base (la que está en ejecución)
+typedef bool (*OtaBaseCb)(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
+
+struct OtaDecoder
+{
+  // --- Resultado ---
+  OtaImageInfo info;
+  uint32_t inBytes;  // bytes de entrada consumidos (offset para reanudar)
+  uint32_t outBytes; // bytes de imagen generados
+  uint32_t baseBytes; // de ellos, copiados de la imagen base
+  const char *error;
+
+  // --- Destino ---
+  OtaHeaderCb onHeader;
+  OtaOutCb onOut;
+  OtaBaseCb onBase;
+  void *ctx;
+
+  // --- Interno ---
+  OtaDecState state;
+  uint8_t op;
+  uint8_t argIdx;
+  uint8_t shift;
+  uint32_t args[2];
+  uint32_t remaining; // literales o bytes de copia pendientes
+  uint32_t src;       // origen de la copia en curso (distancia o offset base)
+  uint32_t baseNext;  // fin de la última OP_BASE
+  uint16_t hdrLen;
+  uint8_t hdr[OTA_HDR_LEN];
+  uint8_t win[OTA_WINDOW]; // últimos bytes generados (anillo)
+};
+
+void otaDecInit(OtaDecoder &d, OtaHeaderCb onHeader, OtaOutCb onOut, OtaBaseCb onBase, void *ctx);
+
+// Consume hasta 'len' bytes y devuelve los consumidos. Puede devolver menos
+// (incluso 0) si alcanzó OTA_DEC_STEP: volver a llamar con lo que sobra
+// (o con len = 0 mientras otaDecBusy) para continuar.
+size_t otaDecFeed(OtaDecoder &d, const uint8_t *data, size_t len);
+
+// Hay una copia a medias que no necesita más entrada
+static inline bool otaDecBusy(const OtaDecoder &d) { return d.state == OD_EXEC; }
+static inline bool otaDecDone(const OtaDecoder &d) { return d.state == OD_DONE; }
+static inline bool otaDecFailed(const OtaDecoder &d) { return d.state == OD_ERROR; }
+
+#endif // OTA_DELTA_HPP
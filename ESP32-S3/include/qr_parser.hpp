@@ -0,0 +1,62 @@
+#ifndef QR_PARSER_HPP
+#define QR_PARSER_HPP
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "types.hpp"
+
+// ============================================================================
+// Ensamblado de líneas del lector y clasificación de QR (sin memoria dinámica)
+//  - Los bytes del UART se acumulan en un buffer fijo hasta CR/LF
+//  - Prefijo "IN:"/"OUT:" (con id de torno opcional delante, "3IN:...") y
+//    formatos ODOO/TEC/MAGE reconocidos en una pasada sobre spans (puntero +
+//    longitud), sin Strings intermedios
+//  - El código normalizado se escribe en un buffer del llamante
+//  - No depende de Arduino: se puede compilar y probar en el host
+// ============================================================================
+
+#ifndef QR_LINE_MAX
+#define QR_LINE_MAX 256 // línea más larga aceptada (si se supera se descarta lo acumulado)
+#endif
+#ifndef QR_CODE_MAX
+#define QR_CODE_MAX 128 // código normalizado con '\0' (= CmdMsg::payload)
+#endif
+
+// Trozo de texto no terminado en '\0'
+struct QrSpan
+{
+  const char *p;
+  size_t n;
+};
+
+struct QrLineAsm
+{
+  char buf[QR_LINE_MAX + 1];
+  uint16_t len;
+};
+
+// Resultado de separar el prefijo de la línea
+struct QrScan
+{
+  int direccion;   // 1 = "IN:", 2 = "OUT:", 0 = sin prefijo
+  uint8_t machine; // id escrito antes del prefijo (0 si no hay o no es válido)
+  QrSpan body;     // lo que sigue al prefijo, sin normalizar
+};
+
+void qrLineReset(QrLineAsm &a);
+
+// Añade un byte del lector. Devuelve true al cerrar una línea no vacía:
+// 'line' apunta a a.buf ya recortado (válido hasta el siguiente byte)
+bool qrLineFeed(QrLineAsm &a, uint8_t b, QrSpan &line);
+
+// Busca "IN:" (o, si no está, "OUT:") y el id de torno que lo precede
+bool qrSplitPrefix(QrSpan line, QrScan &out);
+
+// Normaliza el código (comillas, URL de Odoo/TEC, localizador MAGE) y lo
+// escribe en 'out' terminado en '\0'. QR_UNKNOWN si no encaja o no cabe.
+QRKind qrNormalize(QrSpan body, char *out, size_t cap);
+
+bool qrEquals(QrSpan s, const char *lit);
+
+#endif // QR_PARSER_HPP
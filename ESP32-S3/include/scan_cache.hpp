@@ -0,0 +1,60 @@
+#ifndef SCAN_CACHE_HPP
+#define SCAN_CACHE_HPP
+
+#pragma once
+#include <Arduino.h>
+#include "types.hpp"
+
+// ============================================================================
+// Caché de lecturas repetidas delante de la validación
+//  - Un QR que se queda delante del lector repite la misma línea una y otra
+//    vez: cada repetición dentro de la ventana se resuelve en local con el
+//    último resultado, sin ocupar la cola ni el backend
+//  - Clave: hash FNV-1a del código normalizado + dirección
+//  - Un código rechazado (VDENIED) se sigue rechazando en local durante
+//    SCAN_REJECT_MS; los errores/plazos vencidos no se guardan
+//  - Una autorización cuenta desde que se decidió (no se alarga con las
+//    repeticiones) y se olvida si el ciclo acaba sin paso (CMD_PASS_TIMEOUT)
+//  - Tabla fija con reemplazo del más antiguo; solo la usa taskIO
+// ============================================================================
+
+#ifndef SCAN_CACHE_LEN
+#define SCAN_CACHE_LEN 16
+#endif
+#ifndef SCAN_DEDUP_MS
+#define SCAN_DEDUP_MS 10000UL // repetición de un código autorizado (> PASO_TIMEOUT)
+#endif
+#ifndef SCAN_NOT_YET_MS
+#define SCAN_NOT_YET_MS 5000UL // "aún no es su hora": ventana corta, puede cambiar
+#endif
+#ifndef SCAN_REJECT_MS
+#define SCAN_REJECT_MS 60000UL // código rechazado por el backend o el índice local
+#endif
+
+struct ScanCacheStats
+{
+  uint32_t hits;     // repeticiones resueltas en local
+  uint32_t rejects;  // de ellas, rechazos repetidos
+  uint32_t misses;   // lecturas que siguen a validación
+  uint32_t stored;   // resultados guardados
+};
+
+uint32_t scanCacheKey(const char *code, int direccion); // nunca 0
+
+// true si la lectura se repite dentro de su ventana; 'outcome' es el
+// resultado guardado (ValidateOutcome). La ventana de un rechazo se renueva
+// con cada repetición; la de una autorización, no.
+bool scanCacheLookup(uint32_t key, uint8_t &outcome);
+
+// Resultado de la validación de 'key' (ValidateOutcome); VERROR/VNONE no se guardan
+void scanCacheStore(uint32_t key, uint8_t outcome);
+
+// Quita 'key' (autorización que no terminó en paso: la siguiente lectura se valida)
+void scanCacheForget(uint32_t key);
+
+void scanCacheClear();
+
+ScanCacheStats scanCacheStats();
+String scanCacheStatsJson();
+
+#endif // SCAN_CACHE_HPP
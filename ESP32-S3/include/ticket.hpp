@@ -5,33 +5,122 @@
 #include <Arduino.h>
 #include <LittleFS.h>
 #include <Ethernet.h>
-#include <map>
 
 #include "time.hpp"
 #include "http.hpp"
 #include "definiciones.hpp"
 
-
+// ============================================================================
+// Caché local de entradas para validar sin esperar al backend
+//  - Descarga periódica de POST /entries ("OK\n<code>:HH:MM;[pasos]\n...") por
+//    trozos; también acepta el formato v1 "<code>:<pasos>:HH:MM:SS"
+//  - Índice binario ordenado de registros de ancho fijo (hash 64 bits del
+//    código + minuto del día + pasos), búsqueda binaria en PSRAM o, si no hay PSRAM,
+//    directamente sobre el fichero de LittleFS
+//  - Marcas de consumo en un bitset (1 bit por entrada) persistido en diferido
+//  - Lo validado en local se apunta en un diario binario por segmentos
+//    (tramas con CRC) y se confirma al backend por bloques acotados
+//  - Todo se usa desde taskNet (no hay accesos concurrentes)
+// ============================================================================
 
 #ifndef MARGEN_ANTICIPACION_S
 #define MARGEN_ANTICIPACION_S 1200UL
 #endif
 
-struct TicketInfo {
-  int      pasos;
-  uint32_t segundosEntrada; // HH:MM -> segs del día
+#ifndef TICKETS_MAX
+#define TICKETS_MAX 60000 // capacidad máxima del índice
+#endif
+#ifndef TICKETS_REFRESH_MS
+#define TICKETS_REFRESH_MS (10UL * 60UL * 1000UL) // descarga periódica de /entries
+#endif
+#ifndef TICKETS_RETRY_MS
+#define TICKETS_RETRY_MS 60000UL // reintento si la descarga falla
+#endif
+#ifndef TICKETS_DOWNLOAD_MS
+#define TICKETS_DOWNLOAD_MS 60000UL // plazo de la descarga completa
+#endif
+
+#ifndef TICKETS_IDX_PATH
+#define TICKETS_IDX_PATH "/tickets.idx"
+#endif
+#ifndef TICKETS_USED_PATH
+#define TICKETS_USED_PATH "/tickets.used"
+#endif
+
+// Diario de validaciones locales pendientes de confirmar (/entries/pending)
+#ifndef JOURNAL_DIR
+#define JOURNAL_DIR "/pend"
+#endif
+#ifndef JOURNAL_CURSOR_PATH
+#define JOURNAL_CURSOR_PATH "/pend.cur"
+#endif
+#ifndef JOURNAL_SEG_BYTES
+#define JOURNAL_SEG_BYTES 4096 // tamaño de cada segmento antes de rotar
+#endif
+#ifndef JOURNAL_MAX_SEGS
+#define JOURNAL_MAX_SEGS 64 // tope del diario; al llenarse se descarta el segmento más antiguo
+#endif
+#ifndef JOURNAL_BATCH
+#define JOURNAL_BATCH 32 // entradas por POST a /entries/pending
+#endif
+#ifndef JOURNAL_SYNC_MS
+#define JOURNAL_SYNC_MS 5000 // espera tras vaciar el diario o tras un bloque fallido
+#endif
+#ifndef JOURNAL_CODE_MAX
+#define JOURNAL_CODE_MAX 48 // longitud máxima del código guardado
+#endif
+
+enum TicketCheck : uint8_t
+{
+  TICKET_OK = 1,        // válido: queda marcado como consumido
+  TICKET_AUN_NO = 2,    // aún no es su franja
+  TICKET_NO_EXISTE = 3, // no está en el índice (lo decide el backend)
+  TICKET_YA_USADO = 4   // consumido antes en este torno
 };
 
-extern std::map<String, TicketInfo> ticketsLocales;
-extern int  countTickets;
-extern const int numMaxTickets;
+struct TicketsStats
+{
+  uint32_t count;      // entradas en el índice
+  uint32_t consumed;   // marcadas como usadas
+  uint32_t dropped;    // descartadas en la última carga (formato o capacidad)
+  uint32_t lookups;
+  uint32_t hits;
+  uint32_t lastLookupUs;
+  uint32_t maxLookupUs;
+  uint32_t loadedMs;   // millis() de la última carga correcta
+  bool inPsram;        // índice residente en PSRAM (si no, búsqueda en LittleFS)
+};
+
+struct PendientesStats
+{
+  uint32_t pending;     // entradas sin confirmar
+  uint32_t segments;    // segmentos en LittleFS
+  uint32_t appended;    // añadidas desde el arranque
+  uint32_t acked;       // confirmadas por el backend
+  uint32_t batches;     // bloques enviados con éxito
+  uint32_t failedPosts;
+  uint32_t lost;        // descartadas por diario lleno o error de escritura
+};
+
+bool ticketsBegin();        // carga índice y marcas desde LittleFS (setup)
+bool ticketsDisponibles();  // hay índice cargado
+bool ticketsDescargar();    // encola la descarga asíncrona de /entries
+bool ticketsDescargando();
+bool ticketsToca();         // ya toca refrescar el índice (o reintentar)
+void ticketsLoop();         // persistencia diferida de las marcas de consumo
+
+// TicketCheck; con TICKET_OK deja en 'pasos' las personas que entran con el código
+int verificarTicket(const String &codigoTicket, uint8_t *pasos = nullptr);
 
-bool cargarTicketsDesdeTextoPlano(const String& textoPlano);
-bool descargarTicketsLocales();
+TicketsStats ticketsStats();
+String ticketsStatsJson();
 
-int  verificarTicket(const String& codigoTicket); // 1 OK, 2 aún no, 3 no existe
-void guardarTicketPendiente(const String& ticketCode, int pasosTotales);
+bool pendientesBegin(); // abre el diario, recupera el cursor e importa /pendientes.txt (setup)
+void guardarTicketPendiente(const String &ticketCode, int pasosTotales);
 bool hayTicketsPendientes();
-bool reenviarTicketsPendientesComoBloque();
+bool pendientesToca();                      // hay pendientes, nada en vuelo y ya toca enviar
+bool pendientesEnviando();                  // un bloque esperando respuesta
+bool reenviarTicketsPendientesComoBloque(); // encola un bloque de como mucho JOURNAL_BATCH
+PendientesStats pendientesStats();
 
 #endif // TICKET_HPP
\ No newline at end of file
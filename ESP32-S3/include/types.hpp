@@ -34,7 +34,8 @@ enum CmdType {
   CMD_RESTART,
   CMD_ABORT,
   CMD_UPDATE,
-  CMD_FAIL_REPORT
+  CMD_FAIL_REPORT,
+  CMD_HEARTBEAT   // latido /status (carril best-effort, se fusiona)
 };
 
 // Resultado de la validación online (validateQR)
@@ -73,6 +74,7 @@ typedef struct
 {
   CmdType type;
   char payload[128];
+  uint8_t maquina; // torno del bus del ciclo (validación y pasos)
 } CmdMsg;
 
 
@@ -81,6 +83,7 @@ struct ServerReply {
     bool autorizado;
     int pasosTotales;
     int direccion; // 1: Entrada, 2: Salida
+    uint8_t resultado; // ValidateOutcome (VERROR si no hubo respuesta)
 };
 
 
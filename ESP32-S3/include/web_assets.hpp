@@ -0,0 +1,53 @@
+#ifndef WEB_ASSETS_HPP
+#define WEB_ASSETS_HPP
+
+#pragma once
+#include <Arduino.h>
+
+// ============================================================================
+// Páginas estáticas precomprimidas (gzip) embebidas en el firmware
+//  - Las genera scripts/web_assets.py en include/web_assets_gz.h al compilar
+//  - Se sirven con Content-Encoding: gzip, ETag y Cache-Control; si el
+//    navegador revalida con el mismo ETag se responde 304 sin cuerpo
+//  - Si el cliente no acepta gzip se sigue sirviendo la copia de LittleFS
+//  - Si esa copia ya no es la del firmware (subida desde /upload_fs) se
+//    sirve la de LittleFS: la versión gzip solo vale mientras coincida con
+//    el manifiesto de páginas (ficheros.hpp)
+// ============================================================================
+
+#ifndef WEB_ASSET_CACHE_CONTROL
+#define WEB_ASSET_CACHE_CONTROL "private, no-cache" // siempre revalida (páginas tras login)
+#endif
+
+struct WebAsset
+{
+  const char *path;        // ruta servida ("/menu.html")
+  const char *contentType;
+  const uint8_t *gz;       // PROGMEM
+  size_t gzLen;
+  size_t rawLen;           // tamaño sin comprimir (estadísticas)
+  const char *etag;        // con comillas
+};
+
+struct WebAssetsStats
+{
+  uint32_t served;       // respuestas 200 gzip
+  uint32_t notModified;  // respuestas 304
+  uint32_t bytesSent;    // bytes gzip enviados
+  uint32_t bytesSaved;   // frente a enviar la página sin comprimir
+  uint32_t overridden;   // peticiones de una página sustituida en LittleFS
+};
+
+// nullptr si la ruta no tiene versión precomprimida o se ha sustituido en LittleFS
+const WebAsset *webAssetFind(const String &path);
+
+bool webAcceptsGzip(const String &acceptEncoding);
+bool webEtagMatches(const WebAsset *a, const String &ifNoneMatch);
+
+// Contabilidad de lo servido (la llaman los dos servidores)
+void webAssetServed(const WebAsset *a, bool notModified);
+
+WebAssetsStats webAssetsStats();
+String webAssetsStatsJson();
+
+#endif // WEB_ASSETS_HPP
@@ -13,10 +13,62 @@
 #include "logBuf.hpp"
 #include "config_params.hpp"
 #include "RS485.hpp"
+#include "DSSP3120.hpp"
+#include "scan_cache.hpp"
+#include "logSpool.hpp"
 #include "rele.hpp"
+#include "cmd_lanes.hpp"
+#include "ticket.hpp"
+#include "ficheros.hpp"
+#include "web_assets.hpp"
+#include "web_template.hpp"
+#include "multipart.hpp"
+#include "fw_update.hpp"
+#include "http.hpp"
 
-// Atiende a los clientes HTTP (llamar desde tu task/loop)
+// ================= Servidor Ethernet (varias conexiones) =================
+#ifndef WEB_ETH_MAX_CONN
+#define WEB_ETH_MAX_CONN 4 // conexiones simultáneas (el W5500 tiene 8 sockets)
+#endif
+#ifndef WEB_ETH_LINE_MAX
+#define WEB_ETH_LINE_MAX 256 // línea de petición / cabecera
+#endif
+#ifndef WEB_ETH_BODY_MAX
+#define WEB_ETH_BODY_MAX 2048 // cuerpo de formulario; más grande → 413
+#endif
+#ifndef WEB_ETH_IDLE_MS
+#define WEB_ETH_IDLE_MS 5000UL // sin datos de una conexión → se cierra
+#endif
+#ifndef WEB_ETH_UPLOAD_IDLE_MS
+#define WEB_ETH_UPLOAD_IDLE_MS 15000UL // ídem durante una subida
+#endif
+#ifndef WEB_ETH_LOGS_WAIT_MS
+#define WEB_ETH_LOGS_WAIT_MS 20000UL // espera máxima de /logs_data?wait= (long-poll)
+#endif
+#ifndef WEB_ETH_READ_CHUNK
+#define WEB_ETH_READ_CHUNK 256 // bytes por lectura del socket
+#endif
+#ifndef WEB_ETH_PUMP_BYTES
+#define WEB_ETH_PUMP_BYTES 1024 // tope por conexión y vuelta (ninguna acapara el bucle)
+#endif
+#ifndef WEB_ETH_UPLOAD_PUMP_BYTES
+#define WEB_ETH_UPLOAD_PUMP_BYTES 4096 // ídem para el cuerpo de una subida (un sector por vuelta)
+#endif
+
+struct WebEthStats
+{
+  uint32_t accepted;
+  uint32_t rejected; // sin hueco libre (503)
+  uint32_t timeouts;
+  uint32_t longPolls; // /logs_data aparcados esperando logs
+  uint8_t active;
+  uint8_t maxActive;
+};
+
+// Atiende a los clientes HTTP (llamar desde tu task/loop; no bloquea)
 void webHandleClient();
+WebEthStats webEthStats();
+String webEthStatsJson();
 
 // ================= Rutas públicas =================
 // Login / menú
@@ -31,6 +83,7 @@ void handleReiniciarDispositivo(EthernetClient &client);
 
 // Firmware OTA
 void handleFirmwarePage(EthernetClient &client);
+void handleDownloadFirmware(EthernetClient &client);
 
 // LittleFS (página + upload)
 void handleFsPage(EthernetClient &client);
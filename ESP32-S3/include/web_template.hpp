@@ -0,0 +1,37 @@
+#ifndef WEB_TEMPLATE_HPP
+#define WEB_TEMPLATE_HPP
+
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+
+// ============================================================================
+// Plantillas HTML por streaming
+//  - Lee el fichero por bloques fijos y sustituye los marcadores {{NOMBRE}}
+//    a medida que pasan, sin cargar la página entera en un String
+//  - Lo generado se agrupa en un buffer pequeño y se entrega a un callback
+//    (socket Ethernet o sendContent del WebServer)
+//  - Memoria: dos bloques de TPL_CHUNK en la pila, independiente del tamaño
+//    de la página. Marcadores desconocidos se copian tal cual.
+// ============================================================================
+
+#ifndef TPL_CHUNK
+#define TPL_CHUNK 256 // bytes leídos del fichero / agrupados antes de escribir
+#endif
+#ifndef TPL_NAME_MAX
+#define TPL_NAME_MAX 32 // longitud máxima de NOMBRE en {{NOMBRE}}
+#endif
+
+struct TplVar
+{
+  const char *name;  // sin llaves: "DEVICE_ID"
+  const char *value; // ya escapado si hace falta
+};
+
+// Recibe cada trozo de salida. Devolver false corta el render (cliente caído).
+typedef bool (*TplSink)(void *ctx, const uint8_t *data, size_t len);
+
+// Devuelve los bytes generados (se detiene si el sink devuelve false)
+size_t tplRender(File &file, const TplVar *vars, size_t nVars, TplSink sink, void *ctx);
+
+#endif // WEB_TEMPLATE_HPP
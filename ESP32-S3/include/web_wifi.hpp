@@ -15,8 +15,18 @@
 #include "config_params.hpp"
 #include "config_prefs.hpp"
 #include "RS485.hpp"
+#include "DSSP3120.hpp"
+#include "scan_cache.hpp"
+#include "logSpool.hpp"
+#include "fw_update.hpp"
+#include "http.hpp"
 #include "rele.hpp"
 #include "logBuf.hpp"
+#include "cmd_lanes.hpp"
+#include "ticket.hpp"
+#include "ficheros.hpp"
+#include "web_assets.hpp"
+#include "web_template.hpp"
 
 // Objeto global del servidor (útil si necesitas acceder a él desde main)
 extern WebServer serverWiFi;
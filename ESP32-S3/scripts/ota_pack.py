@@ -0,0 +1,218 @@
+# Empaqueta un firmware (.bin) en el contenedor "MEOT" que descarga
+# actualiza() (ver include/ota_delta.hpp):
+#
+#   python scripts/ota_pack.py nuevo.bin nuevo.meot
+#       → imagen comprimida (LZ con ventana de OTA_WINDOW bytes)
+#   python scripts/ota_pack.py nuevo.bin nuevo_desde_3.0.meot --base ME012_3.0.bin
+#       → imagen diferencial: lo que no cambia se copia de la imagen que el
+#         equipo ya tiene en ejecución (debe ser exactamente ese .bin)
+#
+# Antes de escribir reconstruye la imagen con un decodificador equivalente
+# al del equipo y comprueba el SHA-256; si no coincide no genera nada.
+
+import argparse
+import hashlib
+import struct
+import sys
+
+MAGIC = b"MEOT"
+VERSION = 1
+KIND_LZ = 1
+KIND_DELTA = 2
+
+OP_END = 0
+OP_LIT = 1
+OP_COPY = 2
+OP_BASE = 3
+
+WINDOW = 4096       # igual o menor que OTA_WINDOW del equipo
+BASE_KEY = 16       # bytes para buscar coincidencias en la base
+BASE_STRIDE = 4     # la base se indexa cada 4 bytes (se extiende hacia atrás)
+BASE_CANDIDATES = 4
+MIN_BASE = 8        # coincidencias más cortas salen como literales
+MIN_COPY = 6
+MAX_LIT = 1 << 16
+
+
+def varint(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return out
+
+
+def zigzag(n):
+    return n * 2 if n >= 0 else -n * 2 - 1
+
+
+def match_len(a, i, b, j, limit):
+    n = 0
+    while n + 64 <= limit and a[i + n:i + n + 64] == b[j + n:j + n + 64]:
+        n += 64
+    while n < limit and a[i + n] == b[j + n]:
+        n += 1
+    return n
+
+
+def index_base(base):
+    idx = {}
+    for p in range(0, len(base) - BASE_KEY + 1, BASE_STRIDE):
+        lst = idx.setdefault(base[p:p + BASE_KEY], [])
+        if len(lst) < BASE_CANDIDATES:
+            lst.append(p)
+    return idx
+
+
+def encode(target, base=None):
+    out = bytearray()
+    n = len(target)
+    bidx = index_base(base) if base else {}
+    last = {}           # clave de 4 bytes → última posición en la imagen
+    base_next = 0       # fin de la última copia de la base
+    lit = 0             # inicio de los literales pendientes
+    i = 0
+
+    def flush(upto):
+        p = lit
+        while p < upto:
+            k = min(upto - p, MAX_LIT)
+            out.append(OP_LIT)
+            out.extend(varint(k))
+            out.extend(target[p:p + k])
+            p += k
+
+    while i < n:
+        best_len, best_kind, best_src = 0, None, 0
+
+        if bidx and i + BASE_KEY <= n:
+            for b in bidx.get(target[i:i + BASE_KEY], ()):
+                # Preferir la continuación de la copia anterior
+                l = match_len(target, i, base, b, min(n - i, len(base) - b))
+                if l > best_len or (l == best_len and b == base_next):
+                    best_len, best_kind, best_src = l, OP_BASE, b
+            if best_kind == OP_BASE:
+                # Hacia atrás, sobre los literales pendientes
+                while i > lit and best_src > 0 and target[i - 1] == base[best_src - 1]:
+                    i -= 1
+                    best_src -= 1
+                    best_len += 1
+
+        if i + 4 <= n:
+            key = target[i:i + 4]
+            p = last.get(key)
+            if p is not None and 0 < i - p <= WINDOW:
+                l = match_len(target, i, target, p, n - i)
+                if l > best_len:
+                    best_len, best_kind, best_src = l, OP_COPY, i - p
+            last[key] = i
+
+        if (best_kind == OP_BASE and best_len >= MIN_BASE) or \
+           (best_kind == OP_COPY and best_len >= MIN_COPY):
+            flush(i)
+            out.append(best_kind)
+            if best_kind == OP_BASE:
+                out.extend(varint(zigzag(best_src - base_next)))
+                base_next = best_src + best_len
+            else:
+                out.extend(varint(best_src))
+            out.extend(varint(best_len))
+            end = i + best_len
+            for q in range(i + 1, min(end, n - 3)):
+                last[target[q:q + 4]] = q
+            i = lit = end
+        else:
+            i += 1
+
+    flush(n)
+    out.append(OP_END)
+    return out
+
+
+def header(kind, target, base):
+    return (MAGIC + struct.pack("<BBHII", VERSION, kind, WINDOW, len(target), len(base) if base else 0)
+            + hashlib.sha256(target).digest()
+            + (hashlib.sha256(base).digest() if base else bytes(32)))
+
+
+# Decodificador de referencia (misma lógica que src/ota_delta.cpp)
+def decode(blob, base=None):
+    if blob[:4] != MAGIC:
+        raise ValueError("sin cabecera MEOT")
+    _, kind, window, size, base_size = struct.unpack_from("<BBHII", blob, 4)
+    if kind == KIND_DELTA and (base is None or hashlib.sha256(base[:base_size]).digest() != blob[48:80]):
+        raise ValueError("la base no coincide")
+    out = bytearray()
+    pos = 80
+    base_next = 0
+
+    def arg():
+        nonlocal pos
+        v, s = 0, 0
+        while True:
+            b = blob[pos]
+            pos += 1
+            v |= (b & 0x7F) << s
+            s += 7
+            if not b & 0x80:
+                return v
+
+    while True:
+        op = blob[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_LIT:
+            k = arg()
+            out += blob[pos:pos + k]
+            pos += k
+        elif op == OP_COPY:
+            dist, k = arg(), arg()
+            if not 0 < dist <= min(window, len(out)):
+                raise ValueError("distancia inválida")
+            for _ in range(k):
+                out.append(out[-dist])
+        elif op == OP_BASE:
+            z, k = arg(), arg()
+            off = base_next + ((z >> 1) if not z & 1 else -((z + 1) >> 1))
+            out += base[off:off + k]
+            base_next = off + k
+        else:
+            raise ValueError("operación desconocida")
+    if len(out) != size or hashlib.sha256(out).digest() != blob[16:48]:
+        raise ValueError("la imagen reconstruida no coincide")
+    return bytes(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Empaqueta un firmware en el contenedor MEOT")
+    ap.add_argument("firmware", help=".bin nuevo")
+    ap.add_argument("salida", help="fichero .meot a generar")
+    ap.add_argument("--base", help=".bin que el equipo tiene en ejecución (imagen diferencial)")
+    args = ap.parse_args()
+
+    target = open(args.firmware, "rb").read()
+    base = open(args.base, "rb").read() if args.base else None
+    if not target or target[0] != 0xE9:
+        sys.exit("%s no parece una imagen de ESP32" % args.firmware)
+
+    kind = KIND_DELTA if base else KIND_LZ
+    blob = bytes(header(kind, target, base) + encode(target, base))
+    try:
+        decode(blob, base)
+    except ValueError as e:
+        sys.exit("[ota_pack] verificación fallida: %s" % e)
+
+    with open(args.salida, "wb") as f:
+        f.write(blob)
+    print("[ota_pack] %s %s: %u → %u bytes (%.1f%%) sha256 %s"
+          % ("delta" if base else "lz", args.salida, len(target), len(blob),
+             100.0 * len(blob) / len(target), hashlib.sha256(target).hexdigest()))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,258 @@
+# Genera test/native/test_qr_parser/qr_corpus.h a partir de las muestras de
+# QR/ (en la raíz del repositorio): decodifica cada SVG y anota el tipo y el
+# código normalizado que debe sacar qrNormalize().
+#
+#   python scripts/qr_corpus.py            → regenera la cabecera
+#   python scripts/qr_corpus.py --list     → solo muestra lo decodificado
+#
+# Decodificador mínimo para los SVG que hay en QR/: un <rect> de 100x100 por
+# módulo oscuro (translate + scale) y los tres patrones de posición dibujados
+# aparte. Sin corrección de errores: lee los datos tal cual, así que una
+# muestra dañada sale como error y no se escribe nada.
+
+import os
+import re
+import sys
+import urllib.parse
+
+# Carpeta de QR/ → tipo (QRKind)
+KINDS = {
+    "MAGE": "QR_MAGE",
+    "POS_ODOO": "QR_ODOO",
+    "TEC": "QR_TEC",
+}
+
+OUT_REL = os.path.join("test", "native", "test_qr_parser", "qr_corpus.h")
+
+# Bloques de datos por versión y nivel: [(nº bloques, bytes de datos por bloque)]
+EC_BLOCKS = {
+    1: {"L": [(1, 19)], "M": [(1, 16)], "Q": [(1, 13)], "H": [(1, 9)]},
+    2: {"L": [(1, 34)], "M": [(1, 28)], "Q": [(1, 22)], "H": [(1, 16)]},
+    3: {"L": [(1, 55)], "M": [(1, 44)], "Q": [(2, 17)], "H": [(2, 13)]},
+    4: {"L": [(1, 80)], "M": [(2, 32)], "Q": [(2, 24)], "H": [(4, 9)]},
+    5: {"L": [(1, 108)], "M": [(2, 43)], "Q": [(2, 15), (2, 16)], "H": [(2, 11), (2, 12)]},
+    6: {"L": [(2, 68)], "M": [(4, 27)], "Q": [(4, 19)], "H": [(4, 15)]},
+    7: {"L": [(2, 78)], "M": [(4, 31)], "Q": [(2, 14), (4, 15)], "H": [(4, 13), (1, 14)]},
+}
+ALIGN = {1: [], 2: [6, 18], 3: [6, 22], 4: [6, 26], 5: [6, 30], 6: [6, 34], 7: [6, 22, 38]}
+LEVELS = {1: "L", 0: "M", 3: "Q", 2: "H"}
+MASKS = [
+    lambda x, y: (x + y) % 2 == 0,
+    lambda x, y: y % 2 == 0,
+    lambda x, y: x % 3 == 0,
+    lambda x, y: (x + y) % 3 == 0,
+    lambda x, y: (x // 3 + y // 2) % 2 == 0,
+    lambda x, y: x * y % 2 + x * y % 3 == 0,
+    lambda x, y: (x * y % 2 + x * y % 3) % 2 == 0,
+    lambda x, y: ((x + y) % 2 + x * y % 3) % 2 == 0,
+]
+ALNUM = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:"
+
+
+def format_codes():
+    codes = {}
+    for d in range(32):
+        rem = d
+        for _ in range(10):
+            rem = (rem << 1) ^ ((rem >> 9) * 0x537)
+        codes[((d << 10) | rem) ^ 0x5412] = d
+    return codes
+
+
+def svg_modules(svg):
+    width = int(re.search(r'width="(\d+)px"', svg).group(1))
+    margin = int(re.search(r'<g transform="translate\((\d+),\d+\)">', svg).group(1))
+    cells = re.findall(
+        r'translate\(([\d.]+),([\d.]+)\) scale\(([\d.]+),[\d.]+\)"><g transform=""[^>]*>\s*<rect width="100" height="100"/>', svg)
+    if not cells:
+        raise ValueError("sin módulos")
+    unit = float(cells[0][2]) * 100
+    n = round((width - 2 * margin) / unit)
+    grid = [[0] * n for _ in range(n)]
+    for x, y, _ in cells:
+        grid[round(float(y) / unit)][round(float(x) / unit)] = 1
+    # Patrones de posición (van como <path>): se ponen a mano
+    for fx, fy in ((0, 0), (n - 7, 0), (0, n - 7)):
+        for dy in range(7):
+            for dx in range(7):
+                grid[fy + dy][fx + dx] = 0 if max(abs(dx - 3), abs(dy - 3)) == 2 else 1
+    return grid, n
+
+
+def function_modules(n, version):
+    fn = [[False] * n for _ in range(n)]
+
+    def mark(x0, y0, w, h):
+        for y in range(max(y0, 0), min(y0 + h, n)):
+            for x in range(max(x0, 0), min(x0 + w, n)):
+                fn[y][x] = True
+
+    mark(0, 0, 9, 9)
+    mark(n - 8, 0, 8, 9)
+    mark(0, n - 8, 9, 8)
+    mark(6, 0, 1, n)
+    mark(0, 6, n, 1)
+    al = ALIGN[version]
+    last = len(al) - 1
+    for i, cy in enumerate(al):
+        for j, cx in enumerate(al):
+            if (i, j) in ((0, 0), (0, last), (last, 0)):
+                continue
+            mark(cx - 2, cy - 2, 5, 5)
+    if version >= 7:
+        mark(n - 11, 0, 3, 6)
+        mark(0, n - 11, 6, 3)
+    return fn
+
+
+def decode(svg):
+    grid, n = svg_modules(svg)
+    version = (n - 17) // 4
+    if version not in EC_BLOCKS:
+        raise ValueError("versión %d no soportada" % version)
+
+    bits = 0
+    for i in range(6):
+        bits |= grid[i][8] << i
+    bits |= grid[7][8] << 6
+    bits |= grid[8][8] << 7
+    bits |= grid[8][7] << 8
+    for i in range(9, 15):
+        bits |= grid[8][14 - i] << i
+    codes = format_codes()
+    best = min(codes, key=lambda c: bin(c ^ bits).count("1"))
+    if bin(best ^ bits).count("1") > 3:
+        raise ValueError("información de formato ilegible")
+    level = LEVELS[codes[best] >> 3]
+    mask = MASKS[codes[best] & 7]
+
+    # Zigzag de dos columnas desde abajo a la derecha, saltando la de tiempos
+    fn = function_modules(n, version)
+    raw = []
+    right = n - 1
+    while right >= 1:
+        if right == 6:
+            right = 5
+        up = ((right + 1) & 2) == 0
+        for v in range(n):
+            y = n - 1 - v if up else v
+            for x in (right, right - 1):
+                if not fn[y][x]:
+                    raw.append(grid[y][x] ^ (1 if mask(x, y) else 0))
+        right -= 2
+    words = [int("".join(map(str, raw[i:i + 8])), 2) for i in range(0, len(raw) // 8 * 8, 8)]
+
+    # Desentrelazado de los bloques de datos
+    blocks = []
+    for count, size in EC_BLOCKS[version][level]:
+        blocks += [(size, []) for _ in range(count)]
+    k = 0
+    for i in range(max(b[0] for b in blocks)):
+        for size, data in blocks:
+            if i < size:
+                data.append(words[k])
+                k += 1
+    stream = "".join("%08d" % int(bin(w)[2:]) for _, data in blocks for w in data)
+
+    pos = 0
+
+    def take(nbits):
+        nonlocal pos
+        v = int(stream[pos:pos + nbits], 2)
+        pos += nbits
+        return v
+
+    out = ""
+    while pos + 4 <= len(stream):
+        mode = take(4)
+        if mode == 0:
+            break
+        if mode == 4:  # bytes
+            out += bytes(take(8) for _ in range(take(8))).decode("utf-8")
+        elif mode == 1:  # numérico
+            left = take(10)
+            while left >= 3:
+                out += "%03d" % take(10)
+                left -= 3
+            if left == 2:
+                out += "%02d" % take(7)
+            elif left == 1:
+                out += "%d" % take(4)
+        elif mode == 2:  # alfanumérico
+            left = take(9)
+            while left >= 2:
+                v = take(11)
+                out += ALNUM[v // 45] + ALNUM[v % 45]
+                left -= 2
+            if left:
+                out += ALNUM[take(6)]
+        else:
+            raise ValueError("modo %d no soportado" % mode)
+    return out
+
+
+# Lo que debe escribir qrNormalize() para cada tipo
+def normalized(kind, text):
+    if kind == "QR_MAGE":
+        return text
+    query = urllib.parse.parse_qs(urllib.parse.urlsplit(text).query)
+    if kind == "QR_ODOO":
+        return query["access_token"][0]
+    return "ticket_id=%s&event_id=%s" % (query["ticket_id"][0], query["event_id"][0])
+
+
+def c_str(s):
+    return '"' + s.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def collect(qr_dir):
+    samples = []
+    for folder in sorted(KINDS):
+        d = os.path.join(qr_dir, folder)
+        for name in sorted(os.listdir(d)):
+            if not name.endswith(".svg"):
+                continue
+            with open(os.path.join(d, name), "r", encoding="utf-8") as f:
+                text = decode(f.read())
+            kind = KINDS[folder]
+            samples.append((folder + "/" + name, kind, text, normalized(kind, text)))
+    return samples
+
+
+def build(project_dir, list_only=False):
+    qr_dir = os.path.join(os.path.dirname(project_dir), "QR")
+    samples = collect(qr_dir)
+    if list_only:
+        for s in samples:
+            print("%-55s %-8s %s" % (s[0], s[1], s[2]))
+        return samples
+
+    lines = [
+        "// Generado por scripts/qr_corpus.py a partir de QR/*.svg: no editar a mano.",
+        "// Texto que lee el lector de cada muestra, su tipo y el código normalizado.",
+        "#pragma once",
+        "",
+        "struct QrSample",
+        "{",
+        "  const char *file;",
+        "  QRKind kind;",
+        "  const char *text;",
+        "  const char *code;",
+        "};",
+        "",
+        "static const QrSample QR_CORPUS[] = {",
+    ]
+    for name, kind, text, code in samples:
+        lines.append("    {%s, %s,\n     %s,\n     %s}," % (c_str(name), kind, c_str(text), c_str(code)))
+    lines += ["};", ""]
+    content = "\n".join(lines)
+
+    out_path = os.path.join(project_dir, OUT_REL)
+    with open(out_path, "w", encoding="utf-8", newline="\r\n") as f:
+        f.write(content)
+    print("%s: %d muestras" % (OUT_REL, len(samples)))
+    return samples
+
+
+if __name__ == "__main__":
+    build(os.path.dirname(os.path.dirname(os.path.abspath(sys.argv[0]))), "--list" in sys.argv[1:])
@@ -0,0 +1,149 @@
+# Genera include/web_assets_gz.h a partir de las páginas embebidas en
+# src/ficheros.cpp: las minimiza, las comprime con gzip y calcula su ETag.
+#
+#  - Desde PlatformIO se ejecuta antes de compilar (extra_scripts = pre:...)
+#  - Desde el host:  python scripts/web_assets.py  → genera y muestra el
+#    informe de tamaños y tiempos de transferencia por página
+#
+# Solo se incluyen las páginas que se sirven tal cual; las que llevan
+# marcadores ({{...}}, VERSION_FIRMWARE) se siguen rellenando en el equipo.
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+# Página embebida (array en ficheros.cpp) → ruta que piden los servidores web
+ASSETS = [
+    ("HTML_MENU", "/menu.html"),
+    ("HTML_PARAMS", "/params.html"),
+    ("HTML_LOGS", "/logs.html"),
+    ("HTML_REINICIAR", "/reiniciar.html"),
+    ("HTML_FICHEROS", "/upload_fs.html"),
+]
+
+# Velocidades útiles aproximadas para el informe (bytes/s)
+LINKS = [
+    ("W5500", 600 * 1024),
+    ("WiFi", 1200 * 1024),
+]
+
+OUT_NAME = "web_assets_gz.h"
+
+
+def extract_pages(src):
+    pat = re.compile(r'static const char (\w+)\[\] PROGMEM = R"HTML\((.*?)\)HTML";', re.S)
+    return {m.group(1): m.group(2) for m in pat.finditer(src)}
+
+
+def minify(html):
+    # Conservador: quita sangrías, líneas vacías y comentarios de línea
+    # completa. Se mantienen los saltos de línea (JS sin ';' y literales).
+    out = []
+    in_script = False
+    in_comment = False
+    for line in html.split("\n"):
+        s = line.strip()
+        low = s.lower()
+        if in_comment:
+            if "-->" in s:
+                in_comment = False
+            continue
+        if s.startswith("<!--"):
+            if "-->" not in s:
+                in_comment = True
+            continue
+        if "<script" in low:
+            in_script = True
+        if "</script" in low:
+            in_script = False
+        if not s:
+            continue
+        if in_script and s.startswith("//"):
+            continue
+        out.append(s)
+    return "\n".join(out)
+
+
+def c_array(name, data):
+    lines = []
+    for i in range(0, len(data), 20):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 20]) + ",")
+    return "static const uint8_t %s[] PROGMEM = {\n%s\n};\n" % (name, "\n".join(lines))
+
+
+def build(project_dir, quiet=False):
+    src_path = os.path.join(project_dir, "src", "ficheros.cpp")
+    out_path = os.path.join(project_dir, "include", OUT_NAME)
+
+    with open(src_path, "r", encoding="utf-8") as f:
+        pages = extract_pages(f.read().replace("\r\n", "\n"))
+
+    parts = [
+        "// Generado por scripts/web_assets.py a partir de src/ficheros.cpp. NO EDITAR.\n",
+        "#pragma once\n",
+        "#include <pgmspace.h>\n",
+        "#include \"web_assets.hpp\"\n\n",
+    ]
+    table = []
+    report = []
+    for var, path in ASSETS:
+        if var not in pages:
+            print("[web_assets] AVISO: no se encuentra %s en ficheros.cpp" % var)
+            continue
+        raw = pages[var].encode("utf-8")
+        mini = minify(pages[var]).encode("utf-8")
+        gz = gzip.compress(mini, compresslevel=9, mtime=0)
+        etag = '"%s"' % hashlib.sha1(gz).hexdigest()[:16]
+
+        arr = "WEBGZ_" + var[len("HTML_"):]
+        parts.append(c_array(arr, gz))
+        table.append('    {"%s", "text/html; charset=utf-8", %s, sizeof(%s), %u, "\\"%s\\""},'
+                     % (path, arr, arr, len(raw), etag.strip('"')))
+        report.append((path, len(raw), len(mini), len(gz)))
+
+    parts.append("\nstatic const WebAsset WEB_ASSETS_GZ[] = {\n%s\n};\n" % "\n".join(table))
+    content = "".join(parts)
+
+    # Solo se reescribe si cambia: no fuerza recompilar en cada build
+    old = None
+    if os.path.exists(out_path):
+        with open(out_path, "r", encoding="utf-8") as f:
+            old = f.read()
+    if old != content:
+        with open(out_path, "w", encoding="utf-8", newline="\n") as f:
+            f.write(content)
+
+    if not quiet:
+        print_report(report)
+    return report
+
+
+def print_report(report):
+    hdr = "%-18s %8s %8s %8s %6s" % ("pagina", "original", "minim.", "gzip", "%")
+    for name, _ in LINKS:
+        hdr += " %9s %9s" % (name + " ms", "gz ms")
+    print(hdr)
+    tot = [0, 0, 0]
+    for path, raw, mini, gz in report:
+        tot[0] += raw
+        tot[1] += mini
+        tot[2] += gz
+        row = "%-18s %8u %8u %8u %5.1f%%" % (path, raw, mini, gz, 100.0 * gz / raw)
+        for _, bps in LINKS:
+            row += " %9.1f %9.1f" % (1000.0 * raw / bps, 1000.0 * gz / bps)
+        print(row)
+    if tot[0]:
+        row = "%-18s %8u %8u %8u %5.1f%%" % ("TOTAL", tot[0], tot[1], tot[2], 100.0 * tot[2] / tot[0])
+        for _, bps in LINKS:
+            row += " %9.1f %9.1f" % (1000.0 * tot[0] / bps, 1000.0 * tot[2] / bps)
+        print(row)
+
+
+try:
+    Import("env")  # noqa: F821 (PlatformIO)
+    build(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        build(os.path.dirname(os.path.dirname(os.path.abspath(sys.argv[0]))))
@@ -4,103 +4,108 @@
 #include "logBuf.hpp"
 #include "RS485.hpp"
 #include "rele.hpp"
+#include "qr_parser.hpp"
 
 static HardwareSerial *g_uart = &Serial1;
 
 // ============================================================================
-// 1. Helpers de parseo 
+// Recepción por eventos del UART
+//  - El evento de recepción del driver (FIFO lleno o silencio de 2
+//    caracteres) ensambla las líneas en cuanto llegan los bytes
+//  - Cada línea completa va a una cola fija y despierta a taskIO, que ya no
+//    depende de su ciclo de 50 ms para verla
+//  - Cola, ensamblador y estadísticas se protegen con g_mux (el evento del
+//    UART, taskIO y flushInput() desde taskNet)
 // ============================================================================
 
-static inline bool isAllDigits(const String &s)
+struct PendingLine
 {
-  if (s.length() == 0) return false;
-  for (size_t i = 0; i < s.length(); ++i)
-  {
-    if (!isDigit((unsigned char)s[i])) return false;
-  }
-  return true;
-}
+  char text[QR_LINE_MAX + 1];
+  uint16_t len;
+  uint32_t rxUs;  // micros() al llegar los primeros bytes
+  uint32_t eolUs; // micros() al cerrarse la línea
+};
 
-static inline bool isValidTokenChar(char c) 
-{
-  return (c >= '0' && c <= '9') ||
-         (c >= 'a' && c <= 'f') ||
-         (c >= 'A' && c <= 'F') ||
-         (c == '-');
-}
+static portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
+static QrLineAsm g_line;                        // línea en curso (buffer fijo)
+static uint32_t g_lineRxUs = 0;                 // llegada del primer byte de g_line
+static PendingLine g_lines[DSSP3120_LINES];
+static uint8_t g_lineHead = 0;
+static uint8_t g_lineCount = 0;
+static TaskHandle_t g_sub = nullptr;
+static DSSP3120::ScanStats g_scanStats;
+static uint32_t g_scanRxUs = 0; // lectura cuyo ciclo está en curso (0 = ninguna)
 
-static bool isTokenOdoo_Flexible(String s) 
+static void onUartRx()
 {
-  s.trim();
-  if (s.length() < 10) return false; 
-  
-  for (size_t i = 0; i < s.length(); ++i) {
-    if (!isValidTokenChar(s[i])) return false;
-  }
-  return true;
-}
-
-static String getQueryParam(const String &url, const char *key)
-{
-  const int q = url.indexOf('?');
-  const String query = (q >= 0) ? url.substring(q + 1) : url;
-  const String ks = String(key) + "=";
-  int pos = query.indexOf(ks);
-  if (pos < 0) return "";
-  
-  pos += ks.length();
-  const int amp = query.indexOf('&', pos);
-  String res = (amp >= 0) ? query.substring(pos, amp) : query.substring(pos);
-  res.trim();
-  return res;
-}
-
-static QRKind parse_qr_normalizado(const String &raw, String &outCode)
-{
-  String s = raw;
-  s.trim();
-
-  if (s.length() >= 2) {
-    if ((s.startsWith("\"") && s.endsWith("\"")) || (s.startsWith("'") && s.endsWith("'"))) {
-      s.remove(0, 1);
-      s.remove(s.length() - 1);
-      s.trim();
-    }
-  }
+  uint8_t chunk[64];
+  size_t n;
+  while ((n = g_uart->read(chunk, sizeof(chunk))) > 0)
+  {
+    const uint32_t now = micros();
+    bool completed = false;
 
-  if (s.indexOf("tpv.museoelder.es") >= 0) {
-    const String token = getQueryParam(s, "access_token");
-    if (isTokenOdoo_Flexible(token)) {
-      outCode = token;
-      return QR_ODOO;
+    portENTER_CRITICAL(&g_mux);
+    for (size_t i = 0; i < n; ++i)
+    {
+      const uint16_t before = g_line.len;
+      QrSpan line;
+      if (qrLineFeed(g_line, chunk[i], line))
+      {
+        g_scanStats.lines++;
+        if (g_lineCount >= DSSP3120_LINES)
+        {
+          g_scanStats.dropped++;
+          continue;
+        }
+        PendingLine &p = g_lines[(g_lineHead + g_lineCount) % DSSP3120_LINES];
+        memcpy(p.text, line.p, line.n);
+        p.text[line.n] = '\0';
+        p.len = (uint16_t)line.n;
+        p.rxUs = g_lineRxUs;
+        p.eolUs = now;
+        g_lineCount++;
+        completed = true;
+      }
+      else if (before == 0 && g_line.len > 0)
+        g_lineRxUs = now;
     }
-  }
+    portEXIT_CRITICAL(&g_mux);
 
-  if (s.indexOf("wptpv.museoelder.es") >= 0) {
-    const String tid = getQueryParam(s, "ticket_id");
-    const String eid = getQueryParam(s, "event_id");
-    if (tid.length() > 0 && eid.length() > 0 && isAllDigits(tid) && isAllDigits(eid)) {
-      outCode = "ticket_id=" + tid + "&event_id=" + eid;
-      return QR_TEC;
-    }
+    if (completed && g_sub)
+      xTaskNotifyGive(g_sub);
   }
+}
 
-  if (s.length() >= 17 && s.length() <= 20 && isAllDigits(s)) {
-    outCode = s;
-    return QR_MAGE;
+static bool popLine(PendingLine &out)
+{
+  bool ok = false;
+  portENTER_CRITICAL(&g_mux);
+  if (g_lineCount > 0)
+  {
+    out = g_lines[g_lineHead];
+    g_lineHead = (uint8_t)((g_lineHead + 1) % DSSP3120_LINES);
+    g_lineCount--;
+    ok = true;
   }
-
-  return QR_UNKNOWN;
+  portEXIT_CRITICAL(&g_mux);
+  return ok;
 }
 
 // ============================================================================
-// 2. API DSSP3120 (Todo unificado en una sola función)
+// API DSSP3120 (Todo unificado en una sola función)
 // ============================================================================
 namespace DSSP3120 {
 
 void begin()
 {
   Serial1.begin(DSSP3120_BAUD, SERIAL_8N1, PIN_DSSP3120_RX, PIN_DSSP3120_TX);
+  qrLineReset(g_line);
+
+  // Una lectura llega de golpe: el silencio tras el CR/LF (2 caracteres)
+  // dispara el evento sin esperar a que se llene el FIFO
+  Serial1.setRxTimeout(2);
+  Serial1.onReceive(onUartRx, false);
   
   if (debugSerie) {
     Serial.println(F("[SETUP][DSSP3120] begin() OK"));
@@ -108,118 +113,164 @@ void begin()
   }
 }
 
+// Id de torno escrito antes del prefijo (p. ej. "3IN:..."); si no hay, el
+// torno por defecto del bus
+static uint8_t machineOrDefault(uint8_t tagged)
+{
+  if (tagged)
+    return tagged;
+  const uint8_t def = RS485::machineAt(0);
+  return def ? def : MACHINE_ID;
+}
+
 // ÚNICA FUNCIÓN QUE SE LLAMA DESDE EL MAIN
-bool readLine_parsed(String &outCode, int &direccion, QRKind *kindOut)
+bool readLine_parsed(char *outCode, size_t cap, int &direccion, QRKind *kindOut, uint8_t *machineOut)
 {
-  static String buffer = "";
   if (!g_uart) return false;
 
-  while (g_uart->available() > 0)
+  PendingLine pending;
+  while (popLine(pending))
   {
-    uint8_t byteIn = g_uart->read();
-
-    // Ignoramos basura
-    if (byteIn == 0x00 || byteIn == 0xFF) continue; 
+    const QrSpan line = {pending.text, pending.len};
 
-    // Al detectar un salto de línea (Fin de lectura del código)
-    if (byteIn == 0x0D || byteIn == 0x0A)
-    {
-      if (buffer.length() > 0)
-      {
-        String rawData = buffer;
-        buffer = ""; // Reseteamos buffer para la siguiente tarjeta
-        rawData.trim();
+    if (debugSerie) Serial.printf("[DSSP3120] Línea recibida: '%.*s'\n", (int)line.n, line.p);
+    logbuf_pushf("[DSSP3120] Línea recibida: '%.*s'", (int)line.n, line.p);
 
-        if (rawData.length() == 0) continue;
+    // =====================================================
+    // PASO A: DETERMINAR LA DIRECCIÓN (IN / OUT)
+    // =====================================================
+    QrScan scan;
+    if (!qrSplitPrefix(line, scan)) {
+      direccion = 0; // Si no tiene IN ni OUT, lo descartamos
+      if (debugSerie) Serial.println("[DSSP3120] Prefijo no detectado, ignorando.");
+      logbuf_pushf("[DSSP3120] Prefijo no detectado, ignorando.");
+      continue;
+    }
+    direccion = scan.direccion;
+    const uint8_t maquina = machineOrDefault(scan.machine);
 
-        if (debugSerie) {
-          Serial.print("[DSSP3120] Línea recibida: '");
-          Serial.print(rawData);
-          Serial.println("'");
-        }
-        logbuf_pushf("[DSSP3120] Línea recibida: '%s'", rawData.c_str());
-
-        // =====================================================
-        // PASO A: DETERMINAR LA DIRECCIÓN (IN / OUT)
-        // =====================================================
-        if (rawData.indexOf("IN:") != -1) {
-          direccion = 1;
-          rawData = rawData.substring(rawData.indexOf("IN:") + 3);
-        } 
-        else if (rawData.indexOf("OUT:") != -1) {
-          direccion = 2;
-          rawData = rawData.substring(rawData.indexOf("OUT:") + 4);
-        } 
-        else {
-          direccion = 0; // Si no tiene IN ni OUT, lo descartamos
-          if (debugSerie) Serial.println("[DSSP3120] Prefijo no detectado, ignorando.");
-          logbuf_pushf("[DSSP3120] Prefijo no detectado, ignorando.");
-          return false;
-        }
+    // =====================================================
+    // PASO B: COMPROBAR LA LLAVE MAESTRA (BACKDOOR)
+    // =====================================================
+    if (qrEquals(scan.body, "ELDER_QUALICARD11")) 
+    {
+      logbuf_pushf("[DSSP3120] Llave maestra recibida. Abriendo torno directamente.");
+      if (debugSerie) Serial.printf("[DSSP3120] Llave maestra. Dir: %d | Modo: %d\n", direccion, modoApertura);
 
-        // =====================================================
-        // PASO B: COMPROBAR LA LLAVE MAESTRA (BACKDOOR)
-        // =====================================================
-        if (rawData == "ELDER_QUALICARD11") 
-        {
-          logbuf_pushf("[DSSP3120] Llave maestra recibida. Abriendo torno directamente.");
-          if (debugSerie) Serial.printf("[DSSP3120] Llave maestra. Dir: %d | Modo: %d\n", direccion, modoApertura);
-
-          // Si usamos Relés
-          if (modoApertura == 1) 
-          {
-            if (direccion == 1) { // Entrada
-              rele::openEntry();
-              entradasTotales++;
-            } else {              // Salida
-              rele::openExit();
-              salidasTotales++;
-            }
-          }
-          // Si usamos el bus RS485 del torno
-          else 
-          {
-            if (direccion == 1) { // Entrada
-              if (sentidoApertura == 0) RS485::leftOpen(MACHINE_ID, 1);
-              else RS485::rightOpen(MACHINE_ID, 1);
-            } else {              // Salida
-              if (sentidoApertura == 0) RS485::rightOpen(MACHINE_ID, 1);
-              else RS485::leftOpen(MACHINE_ID, 1);
-            }
-          }
-          
-          // Devolvemos FALSE para que el 'main.cpp' no lo mande a validar a la nube
-          return false; 
+      // Si usamos Relés
+      if (modoApertura == 1) 
+      {
+        if (direccion == 1) { // Entrada
+          rele::openEntry();
+          entradasTotales++;
+        } else {              // Salida
+          rele::openExit();
+          salidasTotales++;
         }
-
-        // =====================================================
-        // PASO C: NORMALIZAR TICKET Y ENVIAR AL MAIN
-        // =====================================================
-        const QRKind k = parse_qr_normalizado(rawData, outCode);
-        
-        if (k == QR_UNKNOWN) {
-          if (debugSerie) Serial.println(F("[DSSP3120] QR Desconocido o No Válido"));
-          logbuf_pushf("[DSSP3120] QR Desconocido: %s", rawData.c_str());
-          return false;
+      }
+      // Si usamos el bus RS485 del torno
+      else 
+      {
+        if (direccion == 1) { // Entrada
+          if (sentidoApertura == 0) RS485::leftOpen(maquina, 1);
+          else RS485::rightOpen(maquina, 1);
+        } else {              // Salida
+          if (sentidoApertura == 0) RS485::rightOpen(maquina, 1);
+          else RS485::leftOpen(maquina, 1);
         }
-
-        if (kindOut) *kindOut = k;
-        return true; // Devolvemos TRUE para que 'main.cpp' lo valide en el servidor
       }
+      
+      // No se devuelve al 'main.cpp' para que no lo mande a validar a la nube
+      continue; 
     }
-    // Llenamos el buffer con caracteres normales
-    else if (byteIn >= 32 && byteIn <= 126)
-    { 
-      buffer += (char)byteIn;
-      if (buffer.length() > 256) buffer = ""; // Protección anti-cuelgues
+
+    // =====================================================
+    // PASO C: NORMALIZAR TICKET Y ENVIAR AL MAIN
+    // =====================================================
+    const QRKind k = qrNormalize(scan.body, outCode, cap);
+    
+    if (k == QR_UNKNOWN) {
+      if (debugSerie) Serial.println(F("[DSSP3120] QR Desconocido o No Válido"));
+      logbuf_pushf("[DSSP3120] QR Desconocido: %.*s", (int)scan.body.n, scan.body.p);
+      continue;
     }
+
+    if (kindOut) *kindOut = k;
+    if (machineOut) *machineOut = maquina;
+
+    const uint32_t parsedUs = micros() - pending.rxUs;
+    portENTER_CRITICAL(&g_mux);
+    g_scanRxUs = pending.rxUs ? pending.rxUs : 1;
+    g_scanStats.lastLineUs = pending.eolUs - pending.rxUs;
+    g_scanStats.lastParsedUs = parsedUs;
+    if (parsedUs > g_scanStats.maxParsedUs) g_scanStats.maxParsedUs = parsedUs;
+    g_scanStats.lastDecisionUs = 0;
+    g_scanStats.lastGateUs = 0;
+    portEXIT_CRITICAL(&g_mux);
+    return true; // Devolvemos TRUE para que 'main.cpp' lo valide en el servidor
   }
   return false;
 }
 
 void flushInput() {
   if (!g_uart) return;
-  while (g_uart->available() > 0) g_uart->read();
+  portENTER_CRITICAL(&g_mux);
+  qrLineReset(g_line);
+  g_lineHead = 0;
+  g_lineCount = 0;
+  portEXIT_CRITICAL(&g_mux);
+}
+
+void subscribe(TaskHandle_t task)
+{
+  g_sub = task;
+}
+
+void markScan(ScanMark m)
+{
+  const uint32_t now = micros();
+  portENTER_CRITICAL(&g_mux);
+  if (g_scanRxUs != 0)
+  {
+    const uint32_t us = now - g_scanRxUs;
+    if (m == SCAN_DECIDED)
+    {
+      g_scanStats.lastDecisionUs = us;
+      if (us > g_scanStats.maxDecisionUs) g_scanStats.maxDecisionUs = us;
+    }
+    else if (m == SCAN_GATE)
+    {
+      g_scanStats.lastGateUs = us;
+      if (us > g_scanStats.maxGateUs) g_scanStats.maxGateUs = us;
+    }
+    if (m != SCAN_DECIDED)
+      g_scanRxUs = 0;
+  }
+  portEXIT_CRITICAL(&g_mux);
+}
+
+ScanStats scanStats()
+{
+  portENTER_CRITICAL(&g_mux);
+  ScanStats st = g_scanStats;
+  portEXIT_CRITICAL(&g_mux);
+  return st;
+}
+
+String scanStatsJson()
+{
+  const ScanStats st = scanStats();
+  String json = "{\"lines\":" + String(st.lines);
+  json += ",\"dropped\":" + String(st.dropped);
+  json += ",\"last_line_us\":" + String(st.lastLineUs);
+  json += ",\"last_parsed_us\":" + String(st.lastParsedUs);
+  json += ",\"last_decision_us\":" + String(st.lastDecisionUs);
+  json += ",\"last_gate_us\":" + String(st.lastGateUs);
+  json += ",\"max_parsed_us\":" + String(st.maxParsedUs);
+  json += ",\"max_decision_us\":" + String(st.maxDecisionUs);
+  json += ",\"max_gate_us\":" + String(st.maxGateUs);
+  json += "}";
+  return json;
 }
 
 } // namespace DSSP3120
\ No newline at end of file
@@ -2,6 +2,10 @@
 #include "definiciones.hpp"
 #include "logBuf.hpp"
 
+#include <driver/uart.h>
+#include <esp_timer.h>
+#include <atomic>
+
 // Definición de variable global para el puntero serial
 static HardwareSerial *r_uart = nullptr;
 
@@ -33,7 +37,7 @@ namespace RS485
   }
 
   // Construye CMD: 7E 00 <machine> <cmd> <d0> <d1> <d2> <chk>
-  static void buildCmd(uint8_t machine, uint8_t cmd, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t out[8])
+  static void buildCmd(uint8_t machine, uint8_t cmd, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t out[8], bool log = true)
   {
     out[0] = 0x7E;
     out[1] = 0x00;
@@ -44,6 +48,9 @@ namespace RS485
     out[6] = d2;
     out[7] = checksum7(out, 7);
 
+    if (!log) // sondeos de confirmación: no llenan el log
+      return;
+
     if (debugSerie)
     {
       Serial.print(F("[RS485] BUILD CMD: "));
@@ -55,30 +62,489 @@ namespace RS485
     logbuf_pushf("[RS485] BUILD CMD: 0x%02X", cmd);
   }
 
-  // Envía el contenido del buffer txBuf
-  static void sendTx()
+  // ======= Motor de transacciones =======
+  // Maestro único en half-duplex: una transacción en vuelo y el resto en una
+  // cola FIFO. Cualquier tarea puede encolar; la primera trama sale en el acto
+  // si el bus está libre y el resto de plazos los dispara un esp_timer.
+  // write() solo llena el FIFO del UART: no se espera al último bit.
+  //
+  //   orden ──hueco──► consulta 0x10 ──► trama 0x7F que refleja la orden → TXN_OK
+  //     └── sin respuesta: nueva consulta / responde sin reflejarla: repite orden
+  //
+  // Una trama espontánea que ya refleje la orden antes de la consulta también
+  // vale; una que no la refleje no dice nada (puede ser anterior a ejecutarla).
+
+  enum TxnSlotState : uint8_t
+  {
+    SLOT_FREE = 0,
+    SLOT_QUEUED,
+    SLOT_ACTIVE,
+    SLOT_DONE
+  };
+
+  struct TxnSlot
+  {
+    uint8_t frame[8];
+    TxnSlotState state;
+    uint16_t gen; // se incrementa al reciclar (invalida Txn antiguos); 12 bits en el Txn
+    uint8_t maxAttempts;
+    uint32_t enqUs;
+    uint32_t doneSeq; // orden de finalización (se recicla el más antiguo)
+    TxnResult res;
+  };
+
+  enum TxnPhase : uint8_t
+  {
+    PH_SEND = 0, // esperando bus para transmitir
+    PH_ACK       // esperando la trama de estado
+  };
+
+  static TxnSlot g_slots[RS485_TXQ_LEN];
+  static uint8_t g_order[RS485_TXQ_LEN]; // cola FIFO de índices de hueco
+  static uint8_t g_qHead = 0;
+  static uint8_t g_qCount = 0;
+  static uint32_t g_doneSeq = 0;
+
+  static int8_t g_cur = -1;           // hueco en vuelo
+  static TxnPhase g_phase = PH_SEND;
+  static bool g_sendProbe = false;    // lo próximo a transmitir es una consulta 0x10
+  static bool g_cmdSent = false;      // la orden ya salió al menos una vez
+  static bool g_sawFrame = false;     // respondió a la consulta, pero sin reflejar la orden
+  static uint8_t g_gateBefore = 0;    // puerta del torno al enviar la orden
+  static bool g_gateKnown = false;
+  static uint32_t g_cmdEndUs = 0;     // fin en el cable de la última transmisión de la orden
+  static uint32_t g_nextUs = 0;       // no transmitir antes de esto (espera de reintento)
+  static uint32_t g_ackDeadlineUs = 0;
+
+  static bool g_txBusy = false;    // una tarea está escribiendo en el UART
+  static bool g_rxBusy = false;    // una tarea está leyendo el UART (poll)
+  static uint32_t g_busFreeUs = 0; // micros() a partir del cual se puede transmitir
+  static TxStats g_txStats;
+  static esp_timer_handle_t g_txTimer = nullptr;
+  static portMUX_TYPE g_txMux = portMUX_INITIALIZER_UNLOCKED;
+
+  // Duración en el cable de 'bytes' a 8N1 (10 bits por byte)
+  static inline uint32_t wireUs(uint32_t bytes)
+  {
+    return (bytes * 10UL * 1000000UL) / RS485_BAUD;
+  }
+
+  static inline bool reached(uint32_t nowUs, uint32_t atUs)
+  {
+    return (int32_t)(nowUs - atUs) >= 0;
+  }
+
+  static inline uint32_t laterOf(uint32_t a, uint32_t b)
+  {
+    return ((int32_t)(a - b) >= 0) ? a : b;
+  }
+
+  static inline Txn makeTxn(uint8_t slot, uint16_t gen)
+  {
+    return (Txn)((((uint16_t)gen + 1) << 4) | slot); // nunca 0
+  }
+
+  static TxnSlot *slotOf(Txn t)
+  {
+    const uint8_t idx = t & 0x0F;
+    if (t == TXN_NONE || idx >= RS485_TXQ_LEN)
+      return nullptr;
+    TxnSlot &s = g_slots[idx];
+    if (s.state == SLOT_FREE || makeTxn(idx, s.gen) != t)
+      return nullptr;
+    return &s;
+  }
+
+  static bool lastGate(uint8_t id, uint8_t &gate); // tornos del bus (más abajo)
+
+  // Órdenes de puerta: su efecto se ve en GateStatus aunque no haya eco
+  static inline bool isGateCmd(uint8_t cmd)
+  {
+    return cmd >= 0x80 && cmd <= 0x84;
+  }
+
+  // ¿La trama refleja la orden en curso? Con g_txMux tomado
+  static bool reflectsCmd(const TxnSlot &s, const uint8_t *frame)
+  {
+    const uint8_t cmd = s.frame[3];
+    if (cmd == 0x10 || !RS485_ACK_EXEC_ECHO || frame[13] == cmd)
+      return true;
+    return isGateCmd(cmd) && g_gateKnown && frame[4] != g_gateBefore;
+  }
+
+  static void decodeFrame(const uint8_t *b, StatusFrame &st)
+  {
+    st.valid = true;
+    st.version = b[1];
+    st.machine = b[2];
+    st.fault = b[3];
+    st.gate = b[4];
+    st.alarm = b[5];
+    st.leftCount = ((uint32_t)b[6] << 16) | ((uint32_t)b[7] << 8) | (uint32_t)b[8];
+    st.rightCount = ((uint32_t)b[9] << 16) | ((uint32_t)b[10] << 8) | (uint32_t)b[11];
+    st.infrared = b[12];
+    st.cmdExec = b[13];
+    st.vcc = b[14];
+    st.lastMs = millis();
+  }
+
+  // Con g_txMux tomado
+  static void finishCurrent(TxnStatus status, const uint8_t *reply, uint32_t nowUs)
+  {
+    TxnSlot &s = g_slots[g_cur];
+    s.res.status = status;
+    s.res.latencyUs = nowUs - s.enqUs;
+    if (reply)
+    {
+      decodeFrame(reply, s.res.frame);
+      s.res.spare[0] = reply[15];
+      s.res.spare[1] = reply[16];
+    }
+    s.state = SLOT_DONE;
+    s.doneSeq = ++g_doneSeq;
+    g_cur = -1;
+
+    if (status == TXN_OK)
+    {
+      g_txStats.acked++;
+      g_txStats.lastAckUs = s.res.latencyUs;
+      if (s.res.latencyUs > g_txStats.maxAckUs)
+        g_txStats.maxAckUs = s.res.latencyUs;
+    }
+    else if (s.maxAttempts > 1) // un torno apagado ya se ve en rs485_bus
+      g_txStats.failed++;
+  }
+
+  static void armTxTimer(int32_t inUs)
+  {
+    if (!g_txTimer)
+      return;
+    esp_timer_stop(g_txTimer); // puede no estar armado
+    esp_timer_start_once(g_txTimer, inUs > 0 ? (uint64_t)inUs : 1);
+  }
+
+  static void txPump()
   {
     if (!r_uart)
+      return;
+
+    uint8_t frame[8];
+    bool doSend = false;
+    bool failed = false;
+    uint8_t failedCmd = 0;
+    int32_t armUs = -1;
+
+    portENTER_CRITICAL(&g_txMux);
+    if (g_txBusy)
+    {
+      portEXIT_CRITICAL(&g_txMux);
+      return;
+    }
+    const uint32_t now = (uint32_t)micros();
+
+    // 1) Venció la espera de confirmación: reintento o fallo
+    if (g_cur >= 0 && g_phase == PH_ACK && reached(now, g_ackDeadlineUs))
+    {
+      TxnSlot &s = g_slots[g_cur];
+      if (s.res.attempts >= s.maxAttempts)
+      {
+        failed = (s.maxAttempts > 1); // los sondeos sin respuesta no se registran
+        failedCmd = s.frame[3];
+        finishCurrent(g_sawFrame ? TXN_NOT_EXECUTED : TXN_NO_ACK, nullptr, now);
+      }
+      else
+      {
+        uint32_t backoffMs = (uint32_t)RS485_RETRY_BASE_MS << (s.res.attempts - 1);
+        if (backoffMs > RS485_RETRY_MAX_MS)
+          backoffMs = RS485_RETRY_MAX_MS;
+        // Si el torno contesta pero no la ejecutó, se repite la orden; si no
+        // contesta, basta con volver a preguntar (no se duplica una apertura)
+        g_sendProbe = g_cmdSent && !g_sawFrame && s.frame[3] != 0x10;
+        g_nextUs = now + backoffMs * 1000UL;
+        g_phase = PH_SEND;
+        s.res.attempts++;
+        g_txStats.retries++;
+      }
+    }
+
+    // 2) Siguiente transacción de la cola
+    if (g_cur < 0 && g_qCount > 0)
+    {
+      g_cur = (int8_t)g_order[g_qHead];
+      g_qHead = (uint8_t)((g_qHead + 1) % RS485_TXQ_LEN);
+      g_qCount--;
+      g_slots[g_cur].state = SLOT_ACTIVE;
+      g_phase = PH_SEND;
+      g_sendProbe = false;
+      g_cmdSent = false;
+      g_sawFrame = false;
+      g_nextUs = now;
+    }
+
+    // 3) Transmitir si toca
+    if (g_cur >= 0 && g_phase == PH_SEND)
+    {
+      const uint32_t at = laterOf(g_nextUs, g_busFreeUs);
+      if (!reached(now, at))
+        armUs = (int32_t)(at - now);
+      else
+      {
+        TxnSlot &s = g_slots[g_cur];
+        if (g_sendProbe)
+          buildCmd(s.frame[2], 0x10, 0x00, 0x00, 0x00, frame, false);
+        else
+          memcpy(frame, s.frame, 8);
+        doSend = true;
+        g_txBusy = true;
+      }
+    }
+    else if (g_cur >= 0 && g_phase == PH_ACK)
+      armUs = (int32_t)(g_ackDeadlineUs - now);
+    portEXIT_CRITICAL(&g_txMux);
+
+    if (failed)
     {
       if (debugSerie)
-        Serial.println(F("[RS485] ERROR: UART no inicializado"));
+        Serial.printf("[RS485] Orden 0x%02X sin confirmar tras %d intentos\n", failedCmd, RS485_MAX_ATTEMPTS);
+      logbuf_pushf("[RS485] Orden 0x%02X sin confirmar", failedCmd);
+    }
+
+    if (!doSend)
+    {
+      if (armUs >= 0)
+        armTxTimer(armUs);
       return;
     }
 
-    // --- CORRECCIÓN 3: Comentamos la limpieza agresiva ---
-    // A veces esto borra respuestas entrantes si el loop es rápido.
-    // while (r_uart->available()) (void)r_uart->read();
+    // Puerta antes de la primera transmisión de la orden, para reconocer
+    // su efecto en las tramas que lleguen después
+    uint8_t gate = 0;
+    const bool gateKnown = !g_sendProbe && isGateCmd(frame[3]) && lastGate(frame[2], gate);
 
-    // Escribir al bus
-    r_uart->write(txBuf, 8);
+    r_uart->write(frame, 8);
+    const uint32_t t = (uint32_t)micros();
+    const uint32_t endUs = t + wireUs(8);
+    const bool isQuery = (frame[3] == 0x10);
 
-    // Esperar a que el hardware termine de transmitir bits
-    r_uart->flush();
+    portENTER_CRITICAL(&g_txMux);
+    TxnSlot &s = g_slots[g_cur];
+    g_txStats.sent++;
+    if (!g_cmdSent)
+    {
+      g_gateBefore = gate;
+      g_gateKnown = gateKnown;
+      s.res.attempts = 1;
+      g_txStats.lastWaitUs = t - s.enqUs;
+      if (g_txStats.lastWaitUs > g_txStats.maxWaitUs)
+        g_txStats.maxWaitUs = g_txStats.lastWaitUs;
+    }
+    if (!g_sendProbe)
+    {
+      // La propia orden: a partir de aquí vale una respuesta
+      g_cmdSent = true;
+      g_cmdEndUs = endUs;
+      g_sawFrame = false;
+    }
+
+    if (isQuery)
+    {
+      // Consulta (propia o de sondeo): bus reservado para la respuesta
+      g_phase = PH_ACK;
+      g_ackDeadlineUs = endUs + RS485_ACK_TIMEOUT_MS * 1000UL;
+      g_busFreeUs = endUs + RS485_RESP_WAIT_MS * 1000UL;
+      armUs = (int32_t)(g_ackDeadlineUs - t);
+    }
+    else
+    {
+      // Orden: tras el hueco mínimo se pregunta el estado para confirmarla
+      g_phase = PH_SEND;
+      g_sendProbe = true;
+      g_busFreeUs = endUs + RS485_CMD_GAP_MS * 1000UL;
+      g_nextUs = g_busFreeUs;
+      armUs = (int32_t)(g_busFreeUs - t);
+    }
+    g_txBusy = false;
+    portEXIT_CRITICAL(&g_txMux);
+
+    armTxTimer(armUs);
+  }
+
+  static void txTimerCb(void *)
+  {
+    txPump();
+  }
+
+  // Llega tráfico del torno: no transmitir encima y, si es una trama de estado
+  // de la máquina en curso posterior a la orden que la refleja, confirmarla
+  static void busActivity(const uint8_t *frame)
+  {
+    const uint32_t now = (uint32_t)micros();
+    const uint32_t free = now + RS485_TURNAROUND_US;
+    bool resolved = false;
+
+    portENTER_CRITICAL(&g_txMux);
+    if (frame && g_cur >= 0 && g_cmdSent && reached(now, g_cmdEndUs))
+    {
+      const TxnSlot &s = g_slots[g_cur];
+      if (frame[2] == s.frame[2])
+      {
+        if (reflectsCmd(s, frame))
+        {
+          finishCurrent(TXN_OK, frame, now);
+          // Se respeta también el hueco mínimo desde la última orden
+          g_busFreeUs = laterOf(free, g_cmdEndUs + RS485_CMD_GAP_MS * 1000UL);
+          resolved = true;
+        }
+        else if (g_phase == PH_ACK)
+          g_sawFrame = true; // contestó a la consulta sin ejecutarla: se repetirá
+      }
+    }
+    if (!resolved && !reached(g_busFreeUs, free))
+      g_busFreeUs = free;
+    portEXIT_CRITICAL(&g_txMux);
+
+    if (resolved)
+      txPump();
+  }
+
+  static Txn txEnqueue(const uint8_t frame[8], uint8_t maxAttempts = RS485_MAX_ATTEMPTS)
+  {
+    if (!r_uart)
+    {
+      if (debugSerie)
+        Serial.println(F("[RS485] ERROR: UART no inicializado"));
+      return TXN_NONE;
+    }
+
+    Txn t = TXN_NONE;
+    portENTER_CRITICAL(&g_txMux);
+    if (frame[3] == 0x10)
+    {
+      // Ya hay una consulta de estado a esa máquina esperando: se comparte
+      for (uint8_t i = 0; i < g_qCount; i++)
+      {
+        const uint8_t idx = g_order[(g_qHead + i) % RS485_TXQ_LEN];
+        const TxnSlot &q = g_slots[idx];
+        if (q.frame[3] == 0x10 && q.frame[2] == frame[2])
+        {
+          t = makeTxn(idx, q.gen);
+          g_txStats.coalesced++;
+          break;
+        }
+      }
+    }
+
+    if (t == TXN_NONE && g_qCount < RS485_TXQ_LEN)
+    {
+      // Hueco libre o, si no, el resultado terminado más antiguo
+      int8_t pick = -1;
+      for (uint8_t i = 0; i < RS485_TXQ_LEN; i++)
+      {
+        const TxnSlot &c = g_slots[i];
+        if (c.state == SLOT_FREE)
+        {
+          pick = (int8_t)i;
+          break;
+        }
+        if (c.state == SLOT_DONE && (pick < 0 || (int32_t)(c.doneSeq - g_slots[pick].doneSeq) < 0))
+          pick = (int8_t)i;
+      }
+      if (pick >= 0)
+      {
+        TxnSlot &s = g_slots[pick];
+        s.gen = (uint16_t)((s.gen + 1) % 0x0FFF); // un Txn solo se repite tras 4095 reciclajes del hueco
+        memcpy(s.frame, frame, 8);
+        s.maxAttempts = maxAttempts;
+        s.state = SLOT_QUEUED;
+        s.enqUs = (uint32_t)micros();
+        s.res = TxnResult();
+        s.res.status = TXN_PENDING;
+        s.res.cmd = frame[3];
+        g_order[(g_qHead + g_qCount) % RS485_TXQ_LEN] = (uint8_t)pick;
+        g_qCount++;
+        g_txStats.queued++;
+        t = makeTxn((uint8_t)pick, s.gen);
+      }
+    }
+    if (t == TXN_NONE)
+      g_txStats.dropped++;
+    portEXIT_CRITICAL(&g_txMux);
+
+    if (t == TXN_NONE)
+    {
+      if (debugSerie)
+        Serial.printf("[RS485] Cola TX llena, orden 0x%02X descartada\n", frame[3]);
+      logbuf_pushf("[RS485] Cola TX llena, orden 0x%02X descartada", frame[3]);
+      return TXN_NONE;
+    }
+
+    txPump();
+    return t;
+  }
+
+  Txn submit(uint8_t machine, uint8_t cmd, uint8_t d0, uint8_t d1, uint8_t d2)
+  {
+    uint8_t frame[8];
+    buildCmd(machine, cmd, d0, d1, d2, frame);
+    return txEnqueue(frame);
+  }
+
+  TxnStatus peek(Txn t, TxnResult *out)
+  {
+    TxnStatus st = TXN_UNKNOWN;
+    portENTER_CRITICAL(&g_txMux);
+    const TxnSlot *s = slotOf(t);
+    if (s)
+    {
+      st = s->res.status;
+      if (out)
+        *out = s->res;
+    }
+    portEXIT_CRITICAL(&g_txMux);
+    if (!s)
+    {
+      st = (t == TXN_NONE) ? TXN_REJECTED : TXN_UNKNOWN;
+      if (out)
+      {
+        *out = TxnResult();
+        out->status = st;
+      }
+    }
+    return st;
+  }
+
+  TxnResult wait(Txn t, uint32_t timeoutMs)
+  {
+    TxnResult r;
+    const uint32_t t0 = millis();
+    for (;;)
+    {
+      poll(); // la respuesta puede estar ya en el UART
+      if (peek(t, &r) != TXN_PENDING)
+        return r;
+      if (millis() - t0 >= timeoutMs)
+        return r; // sigue TXN_PENDING: el motor la terminará por su cuenta
+      vTaskDelay(pdMS_TO_TICKS(2));
+    }
+  }
 
-    // --- CORRECCIÓN 1: EL DELAY FALTANTE ---
-    // El código original tenía delay(200). RS485 necesita tiempo de turnaround.
-    // 50ms suele ser suficiente, pero pon 200 si sigue fallando.
-    delay(50);
+  const char *txnStatusName(TxnStatus st)
+  {
+    switch (st)
+    {
+    case TXN_PENDING:
+      return "pending";
+    case TXN_OK:
+      return "ok";
+    case TXN_NO_ACK:
+      return "no_ack";
+    case TXN_NOT_EXECUTED:
+      return "not_executed";
+    case TXN_REJECTED:
+      return "rejected";
+    default:
+      return "unknown";
+    }
   }
 
 // ======= API de comandos =======
@@ -87,122 +553,447 @@ namespace RS485
 #define MACHINE_ID 0x01
 #endif
 
-  void queryDeviceStatus(uint8_t m)
+  Txn queryDeviceStatus(uint8_t m)
   {
-    buildCmd(m, 0x10, 0x00, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x10, 0x00, 0x00, 0x00);
   }
 
-  void resetLeftCount(uint8_t m)
+  Txn resetLeftCount(uint8_t m)
   {
-    buildCmd(m, 0x20, 0x00, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x20, 0x00, 0x00, 0x00);
   }
-  void resetRightCount(uint8_t m)
+  Txn resetRightCount(uint8_t m)
   {
-    buildCmd(m, 0x21, 0x00, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x21, 0x00, 0x00, 0x00);
   }
-  void resetDevice(uint8_t m)
+  Txn resetDevice(uint8_t m)
   {
-    buildCmd(m, 0x35, 0x60, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x35, 0x60, 0x00, 0x00);
   }
 
-  void leftOpen(uint8_t m, uint8_t p)
+  Txn leftOpen(uint8_t m, uint8_t p)
   {
-    buildCmd(m, 0x80, p, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x80, p, 0x00, 0x00);
   }
-  void leftAlwaysOpen(uint8_t m)
+  Txn leftAlwaysOpen(uint8_t m)
   {
-    buildCmd(m, 0x81, 0x01, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x81, 0x01, 0x00, 0x00);
   }
 
-  void rightOpen(uint8_t m, uint8_t p)
+  Txn rightOpen(uint8_t m, uint8_t p)
   {
-    buildCmd(m, 0x82, p, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x82, p, 0x00, 0x00);
   }
-  void rightAlwaysOpen(uint8_t m)
+  Txn rightAlwaysOpen(uint8_t m)
   {
-    buildCmd(m, 0x83, 0x01, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x83, 0x01, 0x00, 0x00);
   }
 
-  void openGateAlways(uint8_t m)
+  Txn openGateAlways(uint8_t m)
   {
-    buildCmd(m, 0x83, 0x00, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x83, 0x00, 0x00, 0x00);
   }
-  void closeGate(uint8_t m)
+  Txn closeGate(uint8_t m)
   {
-    buildCmd(m, 0x84, 0x00, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x84, 0x00, 0x00, 0x00);
   }
 
-  void forbiddenLeftPassage(uint8_t m)
+  Txn forbiddenLeftPassage(uint8_t m)
   {
-    buildCmd(m, 0x88, 0x00, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x88, 0x00, 0x00, 0x00);
   }
-  void forbiddenRightPassage(uint8_t m)
+  Txn forbiddenRightPassage(uint8_t m)
   {
-    buildCmd(m, 0x89, 0x00, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x89, 0x00, 0x00, 0x00);
   }
-  void disablePassageRestriccion(uint8_t m)
+  Txn disablePassageRestriccion(uint8_t m)
   {
-    buildCmd(m, 0x8F, 0x00, 0x00, 0x00, txBuf);
-    sendTx();
+    return submit(m, 0x8F, 0x00, 0x00, 0x00);
   }
 
   // Implementación de CustomCmd
-  void sendCustomCmd(uint8_t machine, uint8_t cmd, uint8_t d0, uint8_t d1)
+  Txn sendCustomCmd(uint8_t machine, uint8_t cmd, uint8_t d0, uint8_t d1)
+  {
+    return submit(machine, cmd, d0, d1, 0x00);
+  }
+
+  // Últimos valores de parámetro confirmados por el torno (índice = menú)
+  static uint8_t g_paramVal[64];
+  static uint64_t g_paramKnown = 0;
+
+  static void rememberParam(uint8_t menu, uint8_t value)
   {
-    buildCmd(machine, cmd, d0, d1, 0x00, txBuf);
-    sendTx();
+    if (menu >= 64)
+      return;
+    portENTER_CRITICAL(&g_txMux);
+    g_paramVal[menu] = value;
+    g_paramKnown |= (1ULL << menu);
+    portEXIT_CRITICAL(&g_txMux);
   }
 
+  static void supposeParam(uint8_t menu, uint8_t value); // sincronización (más abajo)
+
+  // La confirmación de la escritura solo dice que el torno ejecutó la orden,
+  // no con qué valor: queda como supuesto hasta leerlo de vuelta
   bool setParam(uint8_t m, uint8_t menu, uint8_t value)
   {
-    buildCmd(m, 0x96, menu, value, 0x00, txBuf);
-    sendTx();
+    const TxnResult r = wait(submit(m, 0x96, menu, value, 0x00), RS485_PARAM_WAIT_MS);
+    if (r.status != TXN_OK)
+    {
+      logbuf_pushf("[RS485] Parámetro %u=%u: %s", menu, value, txnStatusName(r.status));
+      return false;
+    }
+    supposeParam(menu, value);
     return true;
   }
 
   // Helpers web
   bool writeParam(uint8_t id, uint8_t value)
   {
-    setParam(MACHINE_ID, id, value);
+    return setParam(MACHINE_ID, id, value);
+  }
+  bool readParam(uint8_t id, uint8_t &value)
+  {
+#if RS485_CMD_PARAM_READ
+    const TxnResult r = wait(submit(MACHINE_ID, RS485_CMD_PARAM_READ, id, 0x00, 0x00), RS485_PARAM_WAIT_MS);
+    if (r.status != TXN_OK)
+      return false;
+    value = r.spare[0];
+    rememberParam(id, value);
     return true;
+#else
+    if (id >= 64)
+      return false;
+    portENTER_CRITICAL(&g_txMux);
+    const bool known = (g_paramKnown >> id) & 1ULL;
+    if (known)
+      value = g_paramVal[id];
+    portEXIT_CRITICAL(&g_txMux);
+    return known;
+#endif
+  }
+
+  // ======= Sincronización de parámetros =======
+  // La sombra es g_paramVal: g_paramKnown marca lo leído del torno y
+  // g_paramSeeded lo supuesto (valor guardado en la NVS al arrancar, o
+  // escritura confirmada aún sin leer de vuelta). Ambos evitan reescribir un
+  // menú igual; readParam() solo da por bueno lo primero.
+  static uint64_t g_paramSeeded = 0;
+
+  struct ParamStats
+  {
+    uint32_t syncs = 0;
+    uint32_t writes = 0;     // escrituras lanzadas
+    uint32_t skipped = 0;    // menús iguales a la sombra (sin transacción)
+    uint32_t failed = 0;
+    uint32_t verifyFail = 0; // leídos de vuelta con otro valor
+    uint32_t lastMs = 0;
+  };
+  static ParamStats g_paramStats;
+
+  static void forgetParam(uint8_t menu)
+  {
+    if (menu >= 64)
+      return;
+    portENTER_CRITICAL(&g_txMux);
+    g_paramKnown &= ~(1ULL << menu);
+    g_paramSeeded &= ~(1ULL << menu);
+    portEXIT_CRITICAL(&g_txMux);
+  }
+
+  static void supposeParam(uint8_t menu, uint8_t value)
+  {
+    if (menu >= 64)
+      return;
+    portENTER_CRITICAL(&g_txMux);
+    g_paramVal[menu] = value;
+    g_paramKnown &= ~(1ULL << menu);
+    g_paramSeeded |= (1ULL << menu);
+    portEXIT_CRITICAL(&g_txMux);
+  }
+
+  void seedParams(const uint8_t *values, uint8_t n)
+  {
+    portENTER_CRITICAL(&g_txMux);
+    for (uint8_t i = 0; i < n && i < 64; i++)
+    {
+      if ((g_paramKnown >> i) & 1ULL)
+        continue;
+      g_paramVal[i] = values[i];
+      g_paramSeeded |= (1ULL << i);
+    }
+    portEXIT_CRITICAL(&g_txMux);
+  }
+
+  // Lanza 'cmd' para cada menú con como mucho RS485_PARAM_PIPELINE en la cola
+  // (el resto del hueco queda para el sondeo y las órdenes de apertura) y
+  // recoge los resultados según terminan. Lo que no acaba antes del plazo se
+  // queda en TXN_PENDING: el motor lo termina por su cuenta.
+  static void runParamTxns(uint8_t cmd, const uint8_t *menus, const uint8_t *vals, uint8_t n,
+                           TxnStatus *st, uint8_t *got, uint32_t t0, uint32_t timeoutMs)
+  {
+    Txn txn[64] = {};
+    uint8_t next = 0, done = 0, inFlight = 0;
+    for (uint8_t i = 0; i < n; i++)
+      st[i] = TXN_PENDING;
+
+    while (done < n)
+    {
+      poll();
+      for (uint8_t i = 0; i < next; i++)
+      {
+        if (st[i] != TXN_PENDING)
+          continue;
+        TxnResult r;
+        if (peek(txn[i], &r) == TXN_PENDING)
+          continue;
+        st[i] = r.status;
+        got[i] = r.spare[0];
+        done++;
+        inFlight--;
+      }
+
+      while (next < n && inFlight < RS485_PARAM_PIPELINE)
+      {
+        const Txn t = submit(MACHINE_ID, cmd, menus[next], vals ? vals[next] : 0x00, 0x00);
+        if (t == TXN_NONE)
+          break; // cola llena: se reintenta cuando termine alguna
+        txn[next++] = t;
+        inFlight++;
+      }
+
+      if (done >= n || millis() - t0 >= timeoutMs)
+        break;
+      vTaskDelay(pdMS_TO_TICKS(2));
+    }
+  }
+
+  ParamSyncResult syncParams(const uint8_t *want, uint8_t n, uint32_t timeoutMs)
+  {
+    ParamSyncResult res;
+    const uint32_t t0 = millis();
+    if (n > 64)
+      n = 64;
+
+    // Diferencia con la sombra
+    uint8_t menus[64] = {}, vals[64] = {};
+    uint8_t k = 0;
+    portENTER_CRITICAL(&g_txMux);
+    const uint64_t have = g_paramKnown | g_paramSeeded;
+    for (uint8_t i = 0; i < n; i++)
+    {
+      if (((have >> i) & 1ULL) && g_paramVal[i] == want[i])
+        continue;
+      menus[k] = i;
+      vals[k++] = want[i];
+    }
+    portEXIT_CRITICAL(&g_txMux);
+    res.changed = k;
+
+    TxnStatus st[64] = {};
+    uint8_t got[64] = {};
+    uint8_t okMenus[64] = {}, okVals[64] = {};
+    uint8_t nOk = 0, verifyFail = 0;
+    runParamTxns(0x96, menus, vals, k, st, got, t0, timeoutMs);
+    for (uint8_t i = 0; i < k; i++)
+    {
+      if (st[i] == TXN_OK)
+      {
+        supposeParam(menus[i], vals[i]); // confirmado solo tras leerlo de vuelta
+        res.written++;
+        okMenus[nOk] = menus[i];
+        okVals[nOk++] = vals[i];
+        continue;
+      }
+      forgetParam(menus[i]);
+      if (res.failed++ == 0)
+        res.firstFailed = menus[i];
+      logbuf_pushf("[RS485] Parámetro %u=%u: %s", menus[i], vals[i], txnStatusName(st[i]));
+    }
+
+#if RS485_CMD_PARAM_READ
+    // Lectura de vuelta de lo confirmado
+    runParamTxns(RS485_CMD_PARAM_READ, okMenus, nullptr, nOk, st, got, t0, timeoutMs);
+    for (uint8_t i = 0; i < nOk; i++)
+    {
+      if (st[i] == TXN_OK && got[i] == okVals[i])
+      {
+        rememberParam(okMenus[i], got[i]);
+        res.verified++;
+        continue;
+      }
+      if (st[i] == TXN_OK)
+      {
+        rememberParam(okMenus[i], got[i]); // lo que hay de verdad en el torno
+        verifyFail++;
+        logbuf_pushf("[RS485] Parámetro %u: escrito %u, leído %u", okMenus[i], okVals[i], got[i]);
+      }
+      else
+        forgetParam(okMenus[i]);
+      if (res.failed++ == 0)
+        res.firstFailed = okMenus[i];
+    }
+#else
+    (void)okMenus;
+    (void)okVals;
+    (void)nOk;
+#endif
+
+    res.ms = millis() - t0;
+    portENTER_CRITICAL(&g_txMux);
+    g_paramStats.syncs++;
+    g_paramStats.writes += k;
+    g_paramStats.skipped += (uint32_t)(n - k);
+    g_paramStats.failed += res.failed;
+    g_paramStats.verifyFail += verifyFail;
+    g_paramStats.lastMs = res.ms;
+    portEXIT_CRITICAL(&g_txMux);
+
+    if (k > 0)
+      logbuf_pushf("[RS485] Parámetros: %u cambiados, %u confirmados, %u fallidos (%lu ms)",
+                   res.changed, res.written, res.failed, (unsigned long)res.ms);
+    return res;
+  }
+
+  // ======= Tornos del bus =======
+  // Un UART, varios tornos (multi-drop). El ensamblador de bytes es uno solo
+  // (el maestro sondea de uno en uno, así que las tramas no se mezclan) y
+  // cada trama se reparte por su id de máquina a su propio estado.
+  //
+  // Instantánea por torno con seqlock: un único escritor (el ensamblador,
+  // protegido por g_rxBusy) y lectores en cualquier tarea sin bloquearse. El
+  // contador es impar mientras se escribe; el lector repite si lo ve impar o
+  // si cambió durante la copia.
+  struct Machine
+  {
+    uint8_t id;
+    StatusFrame snap;
+    std::atomic<uint32_t> snapSeq;
+    StatusFrame prev; // última publicada (solo la toca el escritor)
+    uint32_t frames;
+  };
+
+  static Machine g_machines[RS485_MAX_MACHINES];
+  static uint8_t g_machineCount = 0;
+  static uint8_t g_pollNext = 0;
+  static uint32_t g_unknownFrames = 0; // tramas de ids no dados de alta
+  static esp_timer_handle_t g_pollTimer = nullptr;
+
+  static TaskHandle_t g_subs[RS485_MAX_SUBS];
+  static uint8_t g_subCount = 0;
+
+  static Machine *machineById(uint8_t id)
+  {
+    for (uint8_t i = 0; i < g_machineCount; i++)
+      if (g_machines[i].id == id)
+        return &g_machines[i];
+    return nullptr;
+  }
+
+  static StatusFrame readStatus(const Machine &mc);
+
+  static bool lastGate(uint8_t id, uint8_t &gate)
+  {
+    const Machine *mc = machineById(id);
+    if (!mc)
+      return false;
+    const StatusFrame st = readStatus(*mc);
+    gate = st.gate;
+    return st.valid;
+  }
+
+  static void publishStatus(Machine &mc, const StatusFrame &st)
+  {
+    const uint32_t seq = mc.snapSeq.load(std::memory_order_relaxed);
+    mc.snapSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mc.snap = st;
+    mc.snapSeq.store(seq + 2, std::memory_order_release);
+  }
+
+  static StatusFrame readStatus(const Machine &mc)
+  {
+    StatusFrame st;
+    for (uint32_t spins = 0;; spins++)
+    {
+      const uint32_t s1 = mc.snapSeq.load(std::memory_order_acquire);
+      if ((s1 & 1) == 0)
+      {
+        st = mc.snap;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mc.snapSeq.load(std::memory_order_relaxed) == s1)
+          return st;
+      }
+      if (spins > 32)
+        vTaskDelay(1); // el escritor no acaba: cederle la CPU
+    }
+  }
+
+  // Sondeo por turnos: una consulta de estado cada RS485_POLL_MS / N, de modo
+  // que cada torno se pregunta una vez por RS485_POLL_MS
+  static void pollTimerCb(void *)
+  {
+    if (g_machineCount == 0)
+      return;
+    const uint8_t id = g_machines[g_pollNext % g_machineCount].id;
+    g_pollNext = (uint8_t)((g_pollNext + 1) % g_machineCount);
+
+    uint8_t frame[8];
+    buildCmd(id, 0x10, 0x00, 0x00, 0x00, frame, false);
+    // Un solo intento: un torno apagado no debe acaparar el bus con reintentos.
+    // Si ya hay una consulta a ese torno en cola, se fusiona.
+    txEnqueue(frame, 1);
+  }
+
+  static void restartPolling()
+  {
+    if (!g_pollTimer)
+      return;
+    esp_timer_stop(g_pollTimer);
+    // Con un solo torno basta con sus tramas espontáneas y las consultas a demanda
+    if (g_machineCount > 1 || RS485_POLL_SINGLE)
+      esp_timer_start_periodic(g_pollTimer, (uint64_t)RS485_POLL_MS * 1000ULL / g_machineCount);
   }
-  bool readParam(uint8_t /*id*/, uint8_t & /*value*/)
+
+  // Solo interesa lo que mueve la máquina de estados: contadores, puerta,
+  // fallo y alarma (no la tensión ni los infrarrojos, que varían a menudo)
+  static bool statusChanged(const StatusFrame &a, const StatusFrame &b)
   {
-    return false;
+    return !a.valid || a.leftCount != b.leftCount || a.rightCount != b.rightCount ||
+           a.gate != b.gate || a.fault != b.fault || a.alarm != b.alarm;
   }
 
   // ======= Parseo de frame 0x7F…(18B) =======
   static void parseStatusFrame()
   {
-    // Asegúrate de que estas variables globales existen y son accesibles
-    startPos = rxBuf[0];
-    version_number = rxBuf[1];
-    machineNumber_ret = rxBuf[2];
-    faultEvent = rxBuf[3];
-    gateStatus = rxBuf[4];
-    alarmEvent = rxBuf[5];
+    Machine *mc = machineById(rxBuf[2]);
+    if (!mc)
+    {
+      g_unknownFrames++;
+      return;
+    }
 
-    leftCount = ((uint32_t)rxBuf[6] << 16) | ((uint32_t)rxBuf[7] << 8) | (uint32_t)rxBuf[8];
-    rightCount = ((uint32_t)rxBuf[9] << 16) | ((uint32_t)rxBuf[10] << 8) | (uint32_t)rxBuf[11];
+    StatusFrame st;
+    decodeFrame(rxBuf, st);
+    st.seq = ++mc->frames;
+    const bool changed = statusChanged(mc->prev, st);
+    if (changed)
+      st.changeMs = st.lastMs;
+    else
+      st.changeMs = mc->prev.changeMs;
+    publishStatus(*mc, st);
+    mc->prev = st;
 
-    infraredStatus = rxBuf[12];
-    commandExecStatus = rxBuf[13];
-    powerSupplyVolt = rxBuf[14];
-    undef1 = rxBuf[15];
-    undef2 = rxBuf[16];
-    checkSum = rxBuf[17];
+    if (changed)
+    {
+      portENTER_CRITICAL(&g_txMux);
+      const uint8_t n = g_subCount;
+      TaskHandle_t subs[RS485_MAX_SUBS];
+      memcpy(subs, g_subs, sizeof(subs));
+      portEXIT_CRITICAL(&g_txMux);
+      for (uint8_t i = 0; i < n; i++)
+        xTaskNotifyGive(subs[i]);
+    }
 
     // Solo imprimimos cada cierto tiempo para no saturar si el poll es muy rápido
     static unsigned long lastPrint = 0;
@@ -211,30 +1002,34 @@ namespace RS485
       if (debugSerie)
       {
         Serial.println(F("===== RX STATUS (RS485 Heartbeat) ====="));
-        Serial.printf(" StartPos: 0x%02X\n", startPos);
-        Serial.printf(" Version: 0x%02X\n", version_number);
-        Serial.printf(" MachineID: 0x%02X\n", machineNumber_ret);
-        Serial.printf(" FaultEvent: 0x%02X\n", faultEvent);
-        Serial.printf(" GateStatus: 0x%02X\n", gateStatus);
-        Serial.printf(" AlarmEvent: 0x%02X\n", alarmEvent);
-        Serial.printf(" LeftCount: %lu\n", leftCount);
-        Serial.printf(" RightCount: %lu\n", rightCount);
-        Serial.printf(" InfraredStatus: 0x%02X\n", infraredStatus);
-        Serial.printf(" CommandExecStatus: 0x%02X\n", commandExecStatus);
-        Serial.printf(" PowerSupplyVolt: %u\n", powerSupplyVolt);
-        Serial.printf(" Checksum: 0x%02X\n", checkSum);
+        Serial.printf(" Version: 0x%02X\n", st.version);
+        Serial.printf(" MachineID: 0x%02X\n", st.machine);
+        Serial.printf(" FaultEvent: 0x%02X\n", st.fault);
+        Serial.printf(" GateStatus: 0x%02X\n", st.gate);
+        Serial.printf(" AlarmEvent: 0x%02X\n", st.alarm);
+        Serial.printf(" LeftCount: %lu\n", (unsigned long)st.leftCount);
+        Serial.printf(" RightCount: %lu\n", (unsigned long)st.rightCount);
+        Serial.printf(" InfraredStatus: 0x%02X\n", st.infrared);
+        Serial.printf(" CommandExecStatus: 0x%02X\n", st.cmdExec);
+        Serial.printf(" PowerSupplyVolt: %u\n", st.vcc);
+        Serial.printf(" Checksum: 0x%02X\n", rxBuf[17]);
         Serial.println("========================================");
         lastPrint = millis();
       }
     }
   }
 
-  // ======= Lector no-bloqueante =======
-  void poll()
+  // Los datos llegan al FIFO del UART: el evento de recepción del driver
+  // ensambla la trama en el momento, sin esperar a la vuelta de taskIO
+  static void onUartRx()
   {
-    if (!r_uart)
-      return;
+    poll();
+  }
 
+  // ======= Lector no-bloqueante =======
+  // Vacía el FIFO del UART ensamblando tramas (con g_rxBusy tomado)
+  static void drainRx()
+  {
     constexpr uint32_t INTERBYTE_TIMEOUT_MS = 50; // Reducido un poco para ser más ágil
     constexpr uint32_t FRAME_TIMEOUT_MS = 300;
 
@@ -243,8 +1038,11 @@ namespace RS485
     static uint32_t tLastByte = 0;
     static uint32_t tStart = 0;
 
+    bool rxActivity = false;
+
     while (r_uart->available())
     {
+      rxActivity = true;
       uint8_t b = (uint8_t)r_uart->read();
       uint32_t now = millis();
 
@@ -280,13 +1078,15 @@ namespace RS485
       if (idx >= sizeof(rxBuf))
       { // Buffer lleno (18 bytes)
         inFrame = false;
-        // IMPORTANTE: verifyChecksum aquí usa la misma lógica que sendTx
+        // IMPORTANTE: verifyChecksum aquí usa la misma lógica que buildCmd
         // Si esto devuelve true, significa que el cálculo del checksum es correcto para ambos lados.
         uint8_t ok = verifyChecksum(rxBuf, (int)sizeof(rxBuf));
 
         if (ok)
         {
           parseStatusFrame();
+          busActivity(rxBuf); // puede confirmar la transacción en curso
+          rxActivity = false;
         }
         else
         {
@@ -296,6 +1096,36 @@ namespace RS485
         idx = 0;
       }
     }
+
+    if (rxActivity)
+      busActivity(nullptr);
+  }
+
+  void poll()
+  {
+    if (!r_uart)
+      return;
+
+    // Lo llaman el evento del UART y wait() desde otras tareas: lee solo una.
+    // Quien suelta el cerrojo vuelve a mirar por si llegó algo mientras tanto.
+    do
+    {
+      portENTER_CRITICAL(&g_txMux);
+      const bool busy = g_rxBusy;
+      g_rxBusy = true;
+      portEXIT_CRITICAL(&g_txMux);
+      if (busy)
+        return;
+
+      drainRx();
+
+      portENTER_CRITICAL(&g_txMux);
+      g_rxBusy = false;
+      portEXIT_CRITICAL(&g_txMux);
+    } while (r_uart->available() > 0);
+
+    // Por si el temporizador no llegó a crearse
+    txPump();
   }
 
   // ======= Setup / Estado =======
@@ -306,6 +1136,42 @@ namespace RS485
     Serial2.begin(RS485_BAUD, SERIAL_8N1, PIN_RS485_RX, PIN_RS485_TX);
     r_uart = &Serial2;
 
+    // Recepción por eventos: una trama completa (18 B) o un silencio de
+    // 2 caracteres despiertan al ensamblador
+    Serial2.setRxFIFOFull(sizeof(rxBuf));
+    Serial2.setRxTimeout(2);
+    Serial2.onReceive(onUartRx, false);
+
+    // DE/RE gobernado por el propio UART (se suelta al salir el último bit)
+    if (PIN_RS485_DE >= 0)
+    {
+      Serial2.setPins(-1, -1, -1, PIN_RS485_DE);
+      Serial2.setMode(UART_MODE_RS485_HALF_DUPLEX);
+    }
+
+    if (!g_txTimer)
+    {
+      esp_timer_create_args_t args = {};
+      args.callback = &txTimerCb;
+      args.name = "rs485_tx";
+      if (esp_timer_create(&args, &g_txTimer) != ESP_OK)
+        g_txTimer = nullptr; // sin temporizador, la cola la vacía poll()
+    }
+
+    if (!g_pollTimer)
+    {
+      esp_timer_create_args_t args = {};
+      args.callback = &pollTimerCb;
+      args.name = "rs485_poll";
+      if (esp_timer_create(&args, &g_pollTimer) != ESP_OK)
+        g_pollTimer = nullptr;
+    }
+
+    // Tornos del bus (RS485_MACHINES); se pueden añadir más con addMachine()
+    static const uint8_t kMachines[] = RS485_MACHINES;
+    for (uint8_t id : kMachines)
+      addMachine(id);
+
     if (debugSerie)
     {
       Serial.println(F("[RS485] begin() OK"));
@@ -314,26 +1180,135 @@ namespace RS485
 
     logbuf_pushf("[RS485] begin() OK");
     logbuf_pushf(" UART Pins: RX=%d TX=%d Baud=%d", PIN_RS485_RX, PIN_RS485_TX, RS485_BAUD);
+    logbuf_pushf(" Tornos en el bus: %u", g_machineCount);
   }
 
   StatusFrame getStatus()
   {
-    StatusFrame st;
-    st.version = version_number;
-    st.machine = machineNumber_ret;
-    st.fault = faultEvent;
-    st.gate = gateStatus;
-    st.alarm = alarmEvent;
-    st.leftCount = leftCount;
-    st.rightCount = rightCount;
-    st.infrared = infraredStatus;
-    st.cmdExec = commandExecStatus;
-    st.vcc = powerSupplyVolt;
-    st.valid = (startPos == 0x7F); // Simple validación
-    st.lastMs = millis();
+    if (g_machineCount == 0)
+      return StatusFrame();
+    return readStatus(g_machines[0]);
+  }
+
+  StatusFrame getStatus(uint8_t m)
+  {
+    const Machine *mc = machineById(m);
+    return mc ? readStatus(*mc) : StatusFrame();
+  }
+
+  bool online(uint8_t m)
+  {
+    const StatusFrame st = getStatus(m);
+    return st.valid && (millis() - st.lastMs) < RS485_OFFLINE_MS;
+  }
+
+  bool addMachine(uint8_t id)
+  {
+    if (machineById(id))
+      return true;
+    if (g_machineCount >= RS485_MAX_MACHINES || id == 0)
+      return false;
+    Machine &mc = g_machines[g_machineCount];
+    mc.id = id;
+    mc.snap = StatusFrame();
+    mc.prev = StatusFrame();
+    mc.snapSeq.store(0, std::memory_order_relaxed);
+    mc.frames = 0;
+    // Publicar el alta después de inicializar el hueco (lectores sin cerrojo)
+    std::atomic_thread_fence(std::memory_order_release);
+    g_machineCount++;
+    restartPolling();
+    return true;
+  }
+
+  uint8_t machineCount()
+  {
+    return g_machineCount;
+  }
+
+  uint8_t machineAt(uint8_t idx)
+  {
+    return (idx < g_machineCount) ? g_machines[idx].id : 0;
+  }
+
+  String busStatsJson()
+  {
+    String json = "{\"unknown_frames\":" + String(g_unknownFrames);
+    json += ",\"machines\":[";
+    for (uint8_t i = 0; i < g_machineCount; i++)
+    {
+      const StatusFrame st = readStatus(g_machines[i]);
+      if (i)
+        json += ",";
+      json += "{\"id\":" + String(g_machines[i].id);
+      json += ",\"online\":" + String(st.valid && (millis() - st.lastMs) < RS485_OFFLINE_MS ? "true" : "false");
+      json += ",\"frames\":" + String(st.seq);
+      json += ",\"age_ms\":" + String(st.valid ? (uint32_t)(millis() - st.lastMs) : 0);
+      json += ",\"left\":" + String(st.leftCount);
+      json += ",\"right\":" + String(st.rightCount);
+      json += ",\"gate\":" + String(st.gate);
+      json += ",\"fault\":" + String(st.fault);
+      json += ",\"alarm\":" + String(st.alarm);
+      json += "}";
+    }
+    json += "]}";
+    return json;
+  }
+
+  bool subscribe(TaskHandle_t task)
+  {
+    bool ok = false;
+    portENTER_CRITICAL(&g_txMux);
+    for (uint8_t i = 0; i < g_subCount; i++)
+      if (g_subs[i] == task)
+        ok = true;
+    if (!ok && g_subCount < RS485_MAX_SUBS)
+    {
+      g_subs[g_subCount++] = task;
+      ok = true;
+    }
+    portEXIT_CRITICAL(&g_txMux);
+    return ok;
+  }
+
+  TxStats txStats()
+  {
+    portENTER_CRITICAL(&g_txMux);
+    TxStats st = g_txStats;
+    st.depth = g_qCount + (g_cur >= 0 ? 1 : 0);
+    portEXIT_CRITICAL(&g_txMux);
     return st;
   }
 
+  String txStatsJson()
+  {
+    const TxStats st = txStats();
+    String json = "{\"queued\":" + String(st.queued);
+    json += ",\"sent\":" + String(st.sent);
+    json += ",\"dropped\":" + String(st.dropped);
+    json += ",\"coalesced\":" + String(st.coalesced);
+    json += ",\"acked\":" + String(st.acked);
+    json += ",\"retries\":" + String(st.retries);
+    json += ",\"failed\":" + String(st.failed);
+    json += ",\"depth\":" + String(st.depth);
+    json += ",\"last_wait_us\":" + String(st.lastWaitUs);
+    json += ",\"max_wait_us\":" + String(st.maxWaitUs);
+    json += ",\"last_ack_us\":" + String(st.lastAckUs);
+    json += ",\"max_ack_us\":" + String(st.maxAckUs);
+
+    portENTER_CRITICAL(&g_txMux);
+    const ParamStats ps = g_paramStats;
+    portEXIT_CRITICAL(&g_txMux);
+    json += ",\"params\":{\"syncs\":" + String(ps.syncs);
+    json += ",\"writes\":" + String(ps.writes);
+    json += ",\"skipped\":" + String(ps.skipped);
+    json += ",\"failed\":" + String(ps.failed);
+    json += ",\"verify_fail\":" + String(ps.verifyFail);
+    json += ",\"last_ms\":" + String(ps.lastMs);
+    json += "}}";
+    return json;
+  }
+
   void setDebug(bool on) { debugSerie = on; }
 
 } // namespace RS485
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "cmd_lanes.hpp"
+
+// Cada hueco guarda cuándo se encoló para medir la espera
+struct CmdSlot
+{
+  CmdMsg msg;
+  uint32_t enqMs;
+};
+
+static QueueHandle_t g_lanes[LANE_COUNT] = {nullptr, nullptr, nullptr};
+static CmdLaneStats g_stats[LANE_COUNT];
+
+static bool g_hbPending = false;
+static uint32_t g_hbSinceMs = 0;
+
+// Las estadísticas se tocan desde taskIO (core 1) y taskNet (core 0)
+static portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const kLaneNames[LANE_COUNT] = {"critica", "normal", "best_effort"};
+
+static uint8_t depthBucket(uint32_t d)
+{
+  if (d <= 2)
+    return (uint8_t)d;
+  if (d <= 4)
+    return 3;
+  if (d <= 8)
+    return 4;
+  return 5;
+}
+
+static uint8_t waitBucket(uint32_t ms)
+{
+  if (ms < 10)
+    return 0;
+  if (ms < 50)
+    return 1;
+  if (ms < 200)
+    return 2;
+  if (ms < 1000)
+    return 3;
+  if (ms < 5000)
+    return 4;
+  return 5;
+}
+
+static void noteWait(CmdLane lane, uint32_t enqMs)
+{
+  const uint32_t w = millis() - enqMs;
+  portENTER_CRITICAL(&g_mux);
+  CmdLaneStats &st = g_stats[lane];
+  st.waitHist[waitBucket(w)]++;
+  if (w > st.maxWaitMs)
+    st.maxWaitMs = w;
+  portEXIT_CRITICAL(&g_mux);
+}
+
+bool cmdLanesBegin()
+{
+  const UBaseType_t lens[LANE_COUNT] = {CMD_LANE_CRIT_LEN, CMD_LANE_NORMAL_LEN, CMD_LANE_BE_LEN};
+  for (uint8_t i = 0; i < LANE_COUNT; i++)
+  {
+    if (!g_lanes[i])
+      g_lanes[i] = xQueueCreate(lens[i], sizeof(CmdSlot));
+    if (!g_lanes[i])
+      return false;
+  }
+  memset(g_stats, 0, sizeof(g_stats));
+  g_hbPending = false;
+  return true;
+}
+
+CmdLane cmdLaneOf(CmdType type)
+{
+  switch (type)
+  {
+  case CMD_VALIDATE_IN:
+  case CMD_VALIDATE_OUT:
+    return LANE_CRITICA;
+  case CMD_PASS_IN:
+  case CMD_PASS_OUT:
+  case CMD_PASS_OK:
+  case CMD_PASS_TIMEOUT:
+    return LANE_NORMAL;
+  default:
+    return LANE_BEST_EFFORT;
+  }
+}
+
+bool cmdPush(const CmdMsg &msg, TickType_t wait)
+{
+  if (msg.type == CMD_HEARTBEAT)
+  {
+    cmdRequestHeartbeat();
+    return true;
+  }
+
+  const CmdLane lane = cmdLaneOf(msg.type);
+  QueueHandle_t q = g_lanes[lane];
+  if (!q)
+    return false;
+
+  CmdSlot slot;
+  slot.msg = msg;
+  slot.enqMs = millis();
+
+  const uint32_t depth = (uint32_t)uxQueueMessagesWaiting(q);
+  const bool ok = (xQueueSend(q, &slot, wait) == pdTRUE);
+
+  portENTER_CRITICAL(&g_mux);
+  CmdLaneStats &st = g_stats[lane];
+  if (ok)
+  {
+    st.pushed++;
+    st.depthHist[depthBucket(depth)]++;
+  }
+  else
+    st.dropped++;
+  portEXIT_CRITICAL(&g_mux);
+
+  return ok;
+}
+
+void cmdRequestHeartbeat()
+{
+  QueueHandle_t be = g_lanes[LANE_BEST_EFFORT];
+  const uint32_t depth = be ? (uint32_t)uxQueueMessagesWaiting(be) : 0;
+
+  portENTER_CRITICAL(&g_mux);
+  if (g_hbPending)
+    g_stats[LANE_BEST_EFFORT].coalesced++;
+  else
+  {
+    g_hbPending = true;
+    g_hbSinceMs = millis();
+    g_stats[LANE_BEST_EFFORT].pushed++;
+    g_stats[LANE_BEST_EFFORT].depthHist[depthBucket(depth)]++;
+  }
+  portEXIT_CRITICAL(&g_mux);
+}
+
+bool cmdPop(CmdMsg &out, CmdLane hasta)
+{
+  CmdSlot slot;
+  for (uint8_t i = 0; i <= hasta && i < LANE_COUNT; i++)
+  {
+    if (g_lanes[i] && xQueueReceive(g_lanes[i], &slot, 0) == pdTRUE)
+    {
+      out = slot.msg;
+      noteWait((CmdLane)i, slot.enqMs);
+      return true;
+    }
+  }
+
+  // El latido va detrás de todo lo demás
+  if (hasta != LANE_BEST_EFFORT)
+    return false;
+
+  bool hb = false;
+  uint32_t since = 0;
+  portENTER_CRITICAL(&g_mux);
+  if (g_hbPending)
+  {
+    hb = true;
+    since = g_hbSinceMs;
+    g_hbPending = false;
+  }
+  portEXIT_CRITICAL(&g_mux);
+
+  if (!hb)
+    return false;
+
+  out.type = CMD_HEARTBEAT;
+  out.payload[0] = '\0';
+  noteWait(LANE_BEST_EFFORT, since);
+  return true;
+}
+
+uint32_t cmdLanesDepth()
+{
+  uint32_t n = g_hbPending ? 1 : 0;
+  for (uint8_t i = 0; i < LANE_COUNT; i++)
+    if (g_lanes[i])
+      n += (uint32_t)uxQueueMessagesWaiting(g_lanes[i]);
+  return n;
+}
+
+CmdLaneStats cmdLaneStats(CmdLane lane)
+{
+  CmdLaneStats st;
+  portENTER_CRITICAL(&g_mux);
+  st = g_stats[lane];
+  portEXIT_CRITICAL(&g_mux);
+  return st;
+}
+
+static void appendHist(String &json, const char *name, const uint32_t *h)
+{
+  json += ",\"";
+  json += name;
+  json += "\":[";
+  for (uint8_t b = 0; b < CMD_HIST_BUCKETS; b++)
+  {
+    if (b)
+      json += ',';
+    json += String(h[b]);
+  }
+  json += ']';
+}
+
+String cmdLanesStatsJson()
+{
+  String json;
+  json.reserve(512);
+  json += '{';
+  for (uint8_t i = 0; i < LANE_COUNT; i++)
+  {
+    const CmdLaneStats st = cmdLaneStats((CmdLane)i);
+    if (i)
+      json += ',';
+    json += '"';
+    json += kLaneNames[i];
+    json += "\":{\"depth\":" + String(g_lanes[i] ? (uint32_t)uxQueueMessagesWaiting(g_lanes[i]) : 0);
+    json += ",\"pushed\":" + String(st.pushed);
+    json += ",\"dropped\":" + String(st.dropped);
+    json += ",\"coalesced\":" + String(st.coalesced);
+    json += ",\"max_wait_ms\":" + String(st.maxWaitMs);
+    appendHist(json, "depth_hist", st.depthHist);
+    appendHist(json, "wait_hist", st.waitHist);
+    json += '}';
+  }
+  json += '}';
+  return json;
+}
@@ -1,112 +1,150 @@
 #include <Preferences.h>
 #include "config_params.hpp"
+#include "config_store.hpp"
 #include "definiciones.hpp"
 #include "logBuf.hpp"
 
 static Preferences pPrefs;
 static const char *NS_P = "params";
-static const char *K_PCRC = "pcrc"; // Firma de parámetros técnicos
+static const char *K_PCRC = "pcrc"; // Firma de parámetros técnicos (formato por claves)
+static const uint32_t PARAMS_MAGIC = 0x31505254; // "TRP1"
 
-bool paramsBegin() {
-    return pPrefs.begin(NS_P, false);
+static CfgStore g_pStore;
+static bool g_pValido = false; // hay registro en NVS
+
+// Valores de fábrica (mismo orden que TornoParams)
+static const TornoParams PARAMS_DEFAULTS = {
+    1, 1, 8, 3, 5, 12, 10, 10, 0, 10,   // 0-9
+    3, 0, 2, 0, 4, 1, 5, 1, 0, 2,       // 10-19
+    5, 1, 5, 1, 0, 0, 3, 0, 2, 3,       // 20-29
+    1, 0, 0, 0, 0, 1, 2};               // 30-36
+
+static TornoParams g_params = PARAMS_DEFAULTS; // registro vigente
+
+static bool paramsCommit(const TornoParams &p) {
+    if (!cfgStoreCommit(g_pStore, PARAMS_SCHEMA, &p, sizeof(p))) {
+        logbuf_pushf("Params: ERROR al escribir el registro en NVS");
+        return false;
+    }
+    g_params = p;
+    g_pValido = true;
+    return true;
+}
+
+// ========================= Migración =========================
+// Formato anterior: una clave por parámetro ("p0".."p36")
+static void paramsLoadLegacy(TornoParams &p) {
+    // Claves inexistentes: el valor que ya trae p (defaults)
+    p.machineId      = pPrefs.getUInt("p0", p.machineId);
+    p.openingMode    = pPrefs.getUInt("p1", p.openingMode);
+    p.waitTime       = pPrefs.getUInt("p2", p.waitTime);
+    p.voiceLeft      = pPrefs.getUInt("p3", p.voiceLeft);
+    p.voiceRight     = pPrefs.getUInt("p4", p.voiceRight);
+    p.voiceVol       = pPrefs.getUInt("p5", p.voiceVol);
+    p.masterSpeed    = pPrefs.getUInt("p6", p.masterSpeed);
+    p.slaveSpeed     = pPrefs.getUInt("p7", p.slaveSpeed);
+    p.debugMode      = pPrefs.getUInt("p8", p.debugMode);
+    p.decelRange     = pPrefs.getUInt("p9", p.decelRange);
+    p.selfTestSpeed  = pPrefs.getUInt("p10", p.selfTestSpeed);
+    p.passageMode    = pPrefs.getUInt("p11", p.passageMode);
+    p.closeControl   = pPrefs.getUInt("p12", p.closeControl);
+    p.singleMotor    = pPrefs.getUInt("p13", p.singleMotor);
+    p.language       = pPrefs.getUInt("p14", p.language);
+    p.irRebound      = pPrefs.getUInt("p15", p.irRebound);
+    p.pinchSens      = pPrefs.getUInt("p16", p.pinchSens);
+    p.reverseEntry   = pPrefs.getUInt("p17", p.reverseEntry);
+    p.turnstileType  = pPrefs.getUInt("p18", p.turnstileType);
+    p.emergencyDir   = pPrefs.getUInt("p19", p.emergencyDir);
+    p.motorResist    = pPrefs.getUInt("p20", p.motorResist);
+    p.intrusionVoice = pPrefs.getUInt("p21", p.intrusionVoice);
+    p.irDelay        = pPrefs.getUInt("p22", p.irDelay);
+    p.motorDir       = pPrefs.getUInt("p23", p.motorDir);
+    p.clutchLock     = pPrefs.getUInt("p24", p.clutchLock);
+    p.hallType       = pPrefs.getUInt("p25", p.hallType);
+    p.signalFilter   = pPrefs.getUInt("p26", p.signalFilter);
+    p.cardInside     = pPrefs.getUInt("p27", p.cardInside);
+    p.tailgateAlarm  = pPrefs.getUInt("p28", p.tailgateAlarm);
+    p.limitDev       = pPrefs.getUInt("p29", p.limitDev);
+    p.pinchFree      = pPrefs.getUInt("p30", p.pinchFree);
+    p.memoryFree     = pPrefs.getUInt("p31", p.memoryFree);
+    p.slipMaster     = pPrefs.getUInt("p32", p.slipMaster);
+    p.slipSlave      = pPrefs.getUInt("p33", p.slipSlave);
+    p.irLogicMode    = pPrefs.getUInt("p34", p.irLogicMode);
+    p.lightMaster    = pPrefs.getUInt("p35", p.lightMaster);
+    p.lightSlave     = pPrefs.getUInt("p36", p.lightSlave);
 }
 
-// ========================= Lógica de Firma =========================
-// Basada en tus valores hardcodeados para detectar cambios
-static uint32_t paramsDefaultsSignature() {
-    // Usamos una suma simple o el mismo FNV1a de tu código
-    uint32_t h = 2166136261u;
-    h ^= (uint32_t)36; // Número de parámetros
-    h *= 16777619u;
-    return h;
+// Registro de otro esquema ya copiado sobre los defaults. Con PARAMS_SCHEMA 1
+// no hay nada que convertir; aquí irán los casos de esquemas futuros.
+static void paramsMigrar(TornoParams &p, uint16_t desde) {
+    (void)p;
+    switch (desde) {
+    default:
+        break;
+    }
 }
 
 // ========================= Carga y Guardado =========================
+bool paramsBegin() {
+    if (!pPrefs.begin(NS_P, false))
+        return false;
+    cfgStoreInit(g_pStore, pPrefs, PARAMS_MAGIC);
+
+    const uint32_t t0 = micros();
+    TornoParams p = PARAMS_DEFAULTS;
+    uint16_t schema = 0;
+    const int n = cfgStoreLoad(g_pStore, &p, sizeof(p), schema);
+    if (n >= 0 && schema == PARAMS_SCHEMA && (size_t)n == sizeof(p)) {
+        g_params = p;
+        g_pValido = true;
+        logbuf_pushf("Params: registro %lu cargado en %lu us",
+                     (unsigned long)g_pStore.seq, (unsigned long)(uint32_t)(micros() - t0));
+        return true;
+    }
+    if (n >= 0 && schema > PARAMS_SCHEMA) {
+        // De un firmware más nuevo (vuelta atrás): se usa sin reescribirlo
+        g_params = p;
+        g_pValido = true;
+        logbuf_pushf("Params: registro de esquema %u (este firmware usa el %u)", schema, PARAMS_SCHEMA);
+        return true;
+    }
+    if (n >= 0) {
+        paramsMigrar(p, schema);
+        logbuf_pushf("Params: registro migrado del esquema %u al %u", schema, PARAMS_SCHEMA);
+        return paramsCommit(p);
+    }
+
+    if (pPrefs.isKey("p0")) {
+        // Formato por claves: se pasa a registro y se borran las claves
+        paramsLoadLegacy(p);
+        if (!paramsCommit(p))
+            return false;
+        char k[6];
+        for (int i = 0; i <= 36; i++) {
+            snprintf(k, sizeof(k), "p%d", i);
+            pPrefs.remove(k);
+        }
+        pPrefs.remove(K_PCRC);
+        logbuf_pushf("Params: migrados del formato por claves");
+    }
+    return true;
+}
+
+const TornoParams &paramsView() {
+    return g_params;
+}
+
 TornoParams paramsLoad() {
-    TornoParams p;
-    // Usamos getUInt/getInt con los valores default que me diste
-    p.machineId      = pPrefs.getUInt("p0", 1);
-    p.openingMode    = pPrefs.getUInt("p1", 1);
-    p.waitTime       = pPrefs.getUInt("p2", 8);
-    p.voiceLeft      = pPrefs.getUInt("p3", 3);
-    p.voiceRight     = pPrefs.getUInt("p4", 5);
-    p.voiceVol       = pPrefs.getUInt("p5", 12);
-    p.masterSpeed    = pPrefs.getUInt("p6", 10);
-    p.slaveSpeed     = pPrefs.getUInt("p7", 10);
-    p.debugMode      = pPrefs.getUInt("p8", 0);
-    p.decelRange     = pPrefs.getUInt("p9", 10);
-    p.selfTestSpeed  = pPrefs.getUInt("p10", 3);
-    p.passageMode    = pPrefs.getUInt("p11", 0);
-    p.closeControl   = pPrefs.getUInt("p12", 2);
-    p.singleMotor    = pPrefs.getUInt("p13", 0);
-    p.language       = pPrefs.getUInt("p14", 4);
-    p.irRebound      = pPrefs.getUInt("p15", 1);
-    p.pinchSens      = pPrefs.getUInt("p16", 5);
-    p.reverseEntry   = pPrefs.getUInt("p17", 1);
-    p.turnstileType  = pPrefs.getUInt("p18", 0);
-    p.emergencyDir   = pPrefs.getUInt("p19", 2);
-    p.motorResist    = pPrefs.getUInt("p20", 5);
-    p.intrusionVoice = pPrefs.getUInt("p21", 1);
-    p.irDelay        = pPrefs.getUInt("p22", 5);
-    p.motorDir       = pPrefs.getUInt("p23", 1);
-    p.clutchLock     = pPrefs.getUInt("p24", 0);
-    p.hallType       = pPrefs.getUInt("p25", 0);
-    p.signalFilter   = pPrefs.getUInt("p26", 3);
-    p.cardInside     = pPrefs.getUInt("p27", 0);
-    p.tailgateAlarm  = pPrefs.getUInt("p28", 2);
-    p.limitDev       = pPrefs.getUInt("p29", 3);
-    p.pinchFree      = pPrefs.getUInt("p30", 1);
-    p.memoryFree     = pPrefs.getUInt("p31", 0);
-    p.slipMaster     = pPrefs.getUInt("p32", 0);
-    p.slipSlave      = pPrefs.getUInt("p33", 0);
-    p.irLogicMode    = pPrefs.getUInt("p34", 0);
-    p.lightMaster    = pPrefs.getUInt("p35", 1);
-    p.lightSlave     = pPrefs.getUInt("p36", 2);
-    return p;
+    return g_params;
 }
 
 bool paramsSave(const TornoParams &p) {
-    pPrefs.putUInt("p0", p.machineId);
-    pPrefs.putUInt("p1", p.openingMode);
-    pPrefs.putUInt("p2", p.waitTime);
-    pPrefs.putUInt("p3", p.voiceLeft);
-    pPrefs.putUInt("p4", p.voiceRight);
-    pPrefs.putUInt("p5", p.voiceVol);
-    pPrefs.putUInt("p6", p.masterSpeed);
-    pPrefs.putUInt("p7", p.slaveSpeed);
-    pPrefs.putUInt("p8", p.debugMode);
-    pPrefs.putUInt("p9", p.decelRange);
-    pPrefs.putUInt("p10", p.selfTestSpeed);
-    pPrefs.putUInt("p11", p.passageMode);
-    pPrefs.putUInt("p12", p.closeControl);
-    pPrefs.putUInt("p13", p.singleMotor);
-    pPrefs.putUInt("p14", p.language);
-    pPrefs.putUInt("p15", p.irRebound);
-    pPrefs.putUInt("p16", p.pinchSens);
-    pPrefs.putUInt("p17", p.reverseEntry);
-    pPrefs.putUInt("p18", p.turnstileType);
-    pPrefs.putUInt("p19", p.emergencyDir);
-    pPrefs.putUInt("p20", p.motorResist);
-    pPrefs.putUInt("p21", p.intrusionVoice);
-    pPrefs.putUInt("p22", p.irDelay);
-    pPrefs.putUInt("p23", p.motorDir);
-    pPrefs.putUInt("p24", p.clutchLock);
-    pPrefs.putUInt("p25", p.hallType);
-    pPrefs.putUInt("p26", p.signalFilter);
-    pPrefs.putUInt("p27", p.cardInside);
-    pPrefs.putUInt("p28", p.tailgateAlarm);
-    pPrefs.putUInt("p29", p.limitDev);
-    pPrefs.putUInt("p30", p.pinchFree);
-    pPrefs.putUInt("p31", p.memoryFree);
-    pPrefs.putUInt("p32", p.slipMaster);
-    pPrefs.putUInt("p33", p.slipSlave);
-    pPrefs.putUInt("p34", p.irLogicMode);
-    pPrefs.putUInt("p35", p.lightMaster);
-    pPrefs.putUInt("p36", p.lightSlave);
-    return true;
+    // Los 37 parámetros en un único registro
+    return paramsCommit(p);
 }
 
 // ========================= Aplicación =========================
+// Lee directamente de paramsView() en el arranque (sin copia)
 void paramsApplyToGlobals(const TornoParams &p) {
     p_machineId = p.machineId;
     p_openingMode = p.openingMode;
@@ -147,24 +185,49 @@ void paramsApplyToGlobals(const TornoParams &p) {
     p_lightSlave = p.lightSlave;
 }
 
-void paramsEnsureDefaults() {
-    uint32_t now = paramsDefaultsSignature();
-    uint32_t saved = pPrefs.getUInt(K_PCRC, 0);
+void paramsToBus(const TornoParams &p, uint8_t out[PARAMS_COUNT]) {
+    out[0] = (uint8_t)p.machineId;
+    out[1] = (uint8_t)p.openingMode;
+    out[2] = (uint8_t)p.waitTime;
+    out[3] = (uint8_t)p.voiceLeft;
+    out[4] = (uint8_t)p.voiceRight;
+    out[5] = (uint8_t)p.voiceVol;
+    out[6] = (uint8_t)p.masterSpeed;
+    out[7] = (uint8_t)p.slaveSpeed;
+    out[8] = (uint8_t)p.debugMode;
+    out[9] = (uint8_t)p.decelRange;
+    out[10] = (uint8_t)p.selfTestSpeed;
+    out[11] = (uint8_t)p.passageMode;
+    out[12] = (uint8_t)p.closeControl;
+    out[13] = (uint8_t)p.singleMotor;
+    out[14] = (uint8_t)p.language;
+    out[15] = (uint8_t)p.irRebound;
+    out[16] = (uint8_t)p.pinchSens;
+    out[17] = (uint8_t)p.reverseEntry;
+    out[18] = (uint8_t)p.turnstileType;
+    out[19] = (uint8_t)p.emergencyDir;
+    out[20] = (uint8_t)p.motorResist;
+    out[21] = (uint8_t)p.intrusionVoice;
+    out[22] = (uint8_t)p.irDelay;
+    out[23] = (uint8_t)p.motorDir;
+    out[24] = (uint8_t)p.clutchLock;
+    out[25] = (uint8_t)p.hallType;
+    out[26] = (uint8_t)p.signalFilter;
+    out[27] = (uint8_t)p.cardInside;
+    out[28] = (uint8_t)p.tailgateAlarm;
+    out[29] = (uint8_t)p.limitDev;
+    out[30] = (uint8_t)p.pinchFree;
+    out[31] = (uint8_t)p.memoryFree;
+    out[32] = (uint8_t)p.slipMaster;
+    out[33] = (uint8_t)p.slipSlave;
+    out[34] = (uint8_t)p.irLogicMode;
+    out[35] = (uint8_t)p.lightMaster;
+    out[36] = (uint8_t)p.lightSlave;
+}
 
-    if (saved == 0 || saved != now) {
+void paramsEnsureDefaults() {
+    if (!g_pValido) {
         logbuf_pushf("Params: Detectada NVS técnica vacía. Aplicando defaults.");
-        TornoParams d; // Se inicializa con los valores de paramsLoad()
-        d.machineId = 1; d.openingMode = 1; d.waitTime = 8; d.voiceLeft = 3; d.voiceRight = 5;
-        d.voiceVol = 12; d.masterSpeed = 10; d.slaveSpeed = 10; d.debugMode = 0; d.decelRange = 10;
-        d.selfTestSpeed = 3; d.passageMode = 0; d.closeControl = 2; d.singleMotor = 0;
-        d.language = 4; d.irRebound = 1; d.pinchSens = 5; d.reverseEntry = 1; d.turnstileType = 0;
-        d.emergencyDir = 2; d.motorResist = 5; d.intrusionVoice = 1; d.irDelay = 5; d.motorDir = 1;
-        d.clutchLock = 0; d.hallType = 0; d.signalFilter = 3; d.cardInside = 0; d.tailgateAlarm = 2;
-        d.limitDev = 3; d.pinchFree = 1; d.memoryFree = 0; d.slipMaster = 0; d.slipSlave = 0;
-        d.irLogicMode = 0; d.lightMaster = 1; d.lightSlave = 2;
-        
-        if (paramsSave(d)) {
-            pPrefs.putUInt(K_PCRC, now);
-        }
+        paramsCommit(PARAMS_DEFAULTS);
     }
 }
\ No newline at end of file
@@ -1,16 +1,22 @@
 #include <Preferences.h>
 #include "config_prefs.hpp"
+#include "config_store.hpp"
 #include "definiciones.hpp"
 #include "logBuf.hpp"
 
 static Preferences prefs;
 static const char *NS = "torno";
-static const char *K_DCRC = "dcrc"; // Firma de los defaults
+static const char *K_DCRC = "dcrc"; // Firma de los defaults (formato por claves)
+static const uint32_t CFG_MAGIC = 0x31464354; // "TCF1"
 
-bool cfgBegin()
-{
-  return prefs.begin(NS, false);
-}
+static CfgStore g_store;
+static CfgRecord g_cfg; // registro vigente
+
+// Claves del formato anterior (una por campo); se borran al migrar
+static const char *const LEGACY_KEYS[] = {
+    "id", "mac", "urlBase", "urlActualiza", "modoPasillo", "modoApertura",
+    "sentidoApertura", "entradasTotales", "salidasTotales", "conexionRed",
+    "wifiSSID", "wifiPass", "modoRed", "ip", "gw", "mask", "dns1", "dns2", K_DCRC};
 
 // ========================= Auxiliares =========================
 static String getS(const char *k, const char *def)
@@ -22,6 +28,29 @@ static int getI(const char *k, int def)
   return prefs.getInt(k, def);
 }
 
+static void copiaTexto(char *dst, size_t cap, const String &s)
+{
+  strlcpy(dst, s.c_str(), cap);
+}
+
+static void ipABytes(const String &s, uint8_t out[4])
+{
+  IPAddress ip(0, 0, 0, 0);
+  cfgParseIP(s, ip);
+  for (int i = 0; i < 4; i++)
+    out[i] = ip[i];
+}
+
+static void ipDeBytes(const uint8_t b[4], IPAddress &out)
+{
+  out = IPAddress(b[0], b[1], b[2], b[3]);
+}
+
+static String ipTexto(const uint8_t b[4])
+{
+  return IPAddress(b[0], b[1], b[2], b[3]).toString();
+}
+
 bool cfgValidateIP(const String &s)
 {
   int a, b, c, d;
@@ -86,8 +115,87 @@ static uint32_t cfgDefaultsSignature()
   return fnv1a(s);
 }
 
-// ========================= Carga y Guardado =========================
-TornoConfig cfgLoad()
+// ========================= Registro <-> TornoConfig =========================
+static void cfgToRecord(const TornoConfig &c, CfgRecord &r)
+{
+  copiaTexto(r.deviceId, sizeof(r.deviceId), c.deviceId);
+  memcpy(r.mac, c.mac, 6);
+  copiaTexto(r.wifiSSID, sizeof(r.wifiSSID), c.wifiSSID);
+  copiaTexto(r.wifiPass, sizeof(r.wifiPass), c.wifiPass);
+  copiaTexto(r.urlBase, sizeof(r.urlBase), c.urlBase);
+  copiaTexto(r.urlActualiza, sizeof(r.urlActualiza), c.urlActualiza);
+
+  r.modoPasillo = c.modoPasillo;
+  r.modoApertura = c.modoApertura;
+  r.sentidoApertura = c.sentidoApertura;
+  r.entradasTotales = c.entradasTotales;
+  r.salidasTotales = c.salidasTotales;
+
+  r.conexionRed = c.conexionRed;
+  r.modoRed = c.modoRed;
+  ipABytes(c.ip, r.ip);
+  ipABytes(c.gw, r.gw);
+  ipABytes(c.mask, r.mask);
+  ipABytes(c.dns1, r.dns1);
+  ipABytes(c.dns2, r.dns2);
+}
+
+static bool cfgValida(const TornoConfig &c)
+{
+  // Validaciones básicas
+  if (c.deviceId.length() < 3)
+    return false;
+  if (!c.urlBase.startsWith("http"))
+    return false;
+
+  // Que quepa en el registro
+  const CfgRecord &r = g_cfg;
+  return c.deviceId.length() < sizeof(r.deviceId) && c.wifiSSID.length() < sizeof(r.wifiSSID) &&
+         c.wifiPass.length() < sizeof(r.wifiPass) && c.urlBase.length() < sizeof(r.urlBase) &&
+         c.urlActualiza.length() < sizeof(r.urlActualiza);
+}
+
+static TornoConfig cfgBuildDefaultsFromGlobals()
+{
+  TornoConfig d;
+  d.deviceId = DEVICE_ID;
+  for (int i = 0; i < 6; i++)
+    d.mac[i] = MAC[i];
+
+  d.urlBase = serverURL;
+  d.urlActualiza = urlActualiza;
+  d.modoPasillo = modoPasillo;
+  d.modoApertura = modoApertura;
+  d.sentidoApertura = sentidoApertura;
+  d.entradasTotales = entradasTotales;
+  d.salidasTotales = salidasTotales;
+  d.conexionRed = conexionRed;
+  d.wifiSSID = ssidComercio;
+  d.wifiPass = passwordComercio;
+  d.modoRed = modoRed;
+  d.ip = IP.toString();
+  d.gw = GATEWAY.toString();
+  d.mask = SUBNET.toString();
+  d.dns1 = DNS1.toString();
+  d.dns2 = DNS2.toString();
+  return d;
+}
+
+static bool cfgCommit(const CfgRecord &r)
+{
+  if (!cfgStoreCommit(g_store, CFG_SCHEMA, &r, sizeof(r)))
+  {
+    logbuf_pushf("Config: ERROR al escribir el registro en NVS");
+    return false;
+  }
+  g_cfg = r;
+  return true;
+}
+
+// ========================= Migración =========================
+// Formato anterior: una clave de Preferences por campo (cfgLoad/cfgSave
+// hasta la versión con registro binario)
+static void cfgLoadLegacy(CfgRecord &r)
 {
   TornoConfig c;
   c.deviceId = getS("id", DEVICE_ID.c_str());
@@ -100,7 +208,6 @@ TornoConfig cfgLoad()
       c.mac[i] = MAC[i];
   }
 
-  // IMPORTANTE: Claves unificadas con cfgSave
   c.urlBase = getS("urlBase", serverURL.c_str());
   c.urlActualiza = getS("urlActualiza", urlActualiza.c_str());
 
@@ -120,70 +227,149 @@ TornoConfig cfgLoad()
   c.dns1 = getS("dns1", DNS1.toString().c_str());
   c.dns2 = getS("dns2", DNS2.toString().c_str());
 
-  return c;
+  cfgToRecord(c, r);
+  r.defaultsSig = prefs.getUInt(K_DCRC, 0);
 }
 
-bool cfgSave(const TornoConfig &c)
+// Registro de otro esquema ya copiado sobre los defaults. Con CFG_SCHEMA 1
+// no hay nada que convertir; aquí irán los casos de esquemas futuros.
+static void cfgMigrar(CfgRecord &r, uint16_t desde)
 {
-  // Validaciones básicas
-  if (c.deviceId.length() < 3)
-    return false;
-  if (!c.urlBase.startsWith("http"))
+  (void)r;
+  switch (desde)
+  {
+  default:
+    break;
+  }
+}
+
+// ========================= Carga y Guardado =========================
+bool cfgBegin()
+{
+  if (!prefs.begin(NS, false))
     return false;
+  cfgStoreInit(g_store, prefs, CFG_MAGIC);
 
-  prefs.putString("id", c.deviceId);
-  prefs.putBytes("mac", c.mac, 6); // Guardamos 6 bytes del array
+  const uint32_t t0 = micros();
+  CfgRecord r;
+  cfgToRecord(cfgBuildDefaultsFromGlobals(), r);
+  r.defaultsSig = 0;
 
-  prefs.putString("urlBase", c.urlBase);
-  prefs.putString("urlActualiza", c.urlActualiza);
+  uint16_t schema = 0;
+  const int n = cfgStoreLoad(g_store, &r, sizeof(r), schema);
+  if (n >= 0 && schema == CFG_SCHEMA && (size_t)n == sizeof(r))
+  {
+    g_cfg = r;
+    logbuf_pushf("Config: registro %lu cargado en %lu us",
+                 (unsigned long)g_store.seq, (unsigned long)(uint32_t)(micros() - t0));
+    return true;
+  }
 
-  prefs.putInt("modoPasillo", (int)c.modoPasillo);
-  prefs.putInt("modoApertura", (int)c.modoApertura);
-  prefs.putInt("sentidoApertura", (int)c.sentidoApertura);
-  prefs.putInt("entradasTotales", (int)c.entradasTotales);
-  prefs.putInt("salidasTotales", (int)c.salidasTotales);
+  if (n >= 0 && schema > CFG_SCHEMA)
+  {
+    // Escrito por un firmware más nuevo (vuelta atrás tras una OTA): se usa
+    // lo que este entiende sin reescribirlo, por si se vuelve a actualizar
+    g_cfg = r;
+    logbuf_pushf("Config: registro de esquema %u (este firmware usa el %u)", schema, CFG_SCHEMA);
+    return true;
+  }
+  if (n >= 0)
+  {
+    // Esquema anterior: lo que falta queda con el default
+    cfgMigrar(r, schema);
+    logbuf_pushf("Config: registro migrado del esquema %u al %u", schema, CFG_SCHEMA);
+    return cfgCommit(r);
+  }
 
-  prefs.putInt("conexionRed", (int)c.conexionRed);
-  prefs.putString("wifiSSID", c.wifiSSID);
-  prefs.putString("wifiPass", c.wifiPass);
-  prefs.putInt("modoRed", (int)c.modoRed);
-  prefs.putString("ip", c.ip);
-  prefs.putString("gw", c.gw);
-  prefs.putString("mask", c.mask);
-  prefs.putString("dns1", c.dns1);
-  prefs.putString("dns2", c.dns2);
+  if (prefs.isKey("id"))
+  {
+    // Formato por claves: se pasa a registro y se borran las claves
+    cfgLoadLegacy(r);
+    if (!cfgCommit(r))
+      return false;
+    for (const char *k : LEGACY_KEYS)
+      prefs.remove(k);
+    logbuf_pushf("Config: migrada del formato por claves");
+    return true;
+  }
 
+  // NVS vacía: defaults (cfgEnsureFirmwareDefaults los guarda)
+  g_cfg = r;
   return true;
 }
 
+const CfgRecord &cfgView()
+{
+  return g_cfg;
+}
+
+TornoConfig cfgLoad()
+{
+  const CfgRecord &r = g_cfg;
+  TornoConfig c;
+  c.deviceId = r.deviceId;
+  memcpy(c.mac, r.mac, 6);
+  c.urlBase = r.urlBase;
+  c.urlActualiza = r.urlActualiza;
+
+  c.modoPasillo = r.modoPasillo;
+  c.modoApertura = r.modoApertura;
+  c.sentidoApertura = r.sentidoApertura;
+  c.entradasTotales = r.entradasTotales;
+  c.salidasTotales = r.salidasTotales;
+
+  c.conexionRed = r.conexionRed;
+  c.wifiSSID = r.wifiSSID;
+  c.wifiPass = r.wifiPass;
+  c.modoRed = r.modoRed;
+  c.ip = ipTexto(r.ip);
+  c.gw = ipTexto(r.gw);
+  c.mask = ipTexto(r.mask);
+  c.dns1 = ipTexto(r.dns1);
+  c.dns2 = ipTexto(r.dns2);
+
+  return c;
+}
+
+bool cfgSave(const TornoConfig &c)
+{
+  if (!cfgValida(c))
+    return false;
+
+  // Todo en un único registro: o se guarda entero o sigue el anterior
+  CfgRecord r = g_cfg;
+  cfgToRecord(c, r);
+  return cfgCommit(r);
+}
+
 // ========================= Aplicación =========================
-void cfgApplyToGlobals(const TornoConfig &c)
+void cfgApplyToGlobals(const CfgRecord &r)
 {
-  DEVICE_ID = c.deviceId;
+  DEVICE_ID = r.deviceId;
   for (int i = 0; i < 6; i++)
-    MAC[i] = c.mac[i];
+    MAC[i] = r.mac[i];
 
-  serverURL = c.urlBase;
-  urlActualiza = c.urlActualiza;
+  serverURL = r.urlBase;
+  urlActualiza = r.urlActualiza;
 
-  modoPasillo = c.modoPasillo;
-  modoApertura = c.modoApertura;
-  sentidoApertura = c.sentidoApertura;
-  entradasTotales = c.entradasTotales;
-  salidasTotales = c.salidasTotales;
+  modoPasillo = r.modoPasillo;
+  modoApertura = r.modoApertura;
+  sentidoApertura = r.sentidoApertura;
+  entradasTotales = r.entradasTotales;
+  salidasTotales = r.salidasTotales;
 
-  conexionRed = c.conexionRed;
-  ssidComercio = c.wifiSSID;
-  passwordComercio = c.wifiPass;
-  modoRed = c.modoRed;
+  conexionRed = r.conexionRed;
+  ssidComercio = r.wifiSSID;
+  passwordComercio = r.wifiPass;
+  modoRed = r.modoRed;
 
   if (modoRed == 1)
   {
-    cfgParseIP(c.ip, IP);
-    cfgParseIP(c.gw, GATEWAY);
-    cfgParseIP(c.mask, SUBNET);
-    cfgParseIP(c.dns1, DNS1);
-    cfgParseIP(c.dns2, DNS2);
+    ipDeBytes(r.ip, IP);
+    ipDeBytes(r.gw, GATEWAY);
+    ipDeBytes(r.mask, SUBNET);
+    ipDeBytes(r.dns1, DNS1);
+    ipDeBytes(r.dns2, DNS2);
   }
   else
   {
@@ -191,44 +377,22 @@ void cfgApplyToGlobals(const TornoConfig &c)
   }
 }
 
-static TornoConfig cfgBuildDefaultsFromGlobals()
-{
-  TornoConfig d;
-  d.deviceId = DEVICE_ID;
-  for (int i = 0; i < 6; i++)
-    d.mac[i] = MAC[i];
-
-  d.urlBase = serverURL;
-  d.urlActualiza = urlActualiza;
-  d.modoPasillo = modoPasillo;
-  d.modoApertura = modoApertura;
-  d.sentidoApertura = sentidoApertura;
-  d.entradasTotales = entradasTotales;
-  d.salidasTotales = salidasTotales;
-  d.conexionRed = conexionRed;
-  d.wifiSSID = ssidComercio;
-  d.wifiPass = passwordComercio;
-  d.modoRed = modoRed;
-  d.ip = IP.toString();
-  d.gw = GATEWAY.toString();
-  d.mask = SUBNET.toString();
-  d.dns1 = DNS1.toString();
-  d.dns2 = DNS2.toString();
-  return d;
-}
-
 void cfgEnsureFirmwareDefaults()
 {
   uint32_t now = cfgDefaultsSignature();
-  uint32_t saved = prefs.getUInt(K_DCRC, 0);
+  uint32_t saved = g_cfg.defaultsSig;
 
   if (saved == 0 || saved != now)
   {
     logbuf_pushf("Config: Detectado nuevo firmware o NVS vacía. Aplicando defaults.");
     TornoConfig d = cfgBuildDefaultsFromGlobals();
-    if (cfgSave(d))
+    if (cfgValida(d))
     {
-      prefs.putUInt(K_DCRC, now);
+      // Defaults y firma en el mismo registro
+      CfgRecord r = g_cfg;
+      cfgToRecord(d, r);
+      r.defaultsSig = now;
+      cfgCommit(r);
     }
   }
 }
\ No newline at end of file
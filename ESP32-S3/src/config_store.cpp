@@ -0,0 +1,107 @@
+#include "config_store.hpp"
+
+#include <string.h>
+
+static const char *const SLOT_KEY[2] = {"cfgA", "cfgB"};
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t n)
+{
+  crc = ~crc;
+  while (n--)
+  {
+    crc ^= *data++;
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
+  }
+  return ~crc;
+}
+
+static uint32_t crcRegistro(const CfgStoreHdr &h, const uint8_t *data)
+{
+  const uint32_t crc = crc32Update(0, (const uint8_t *)&h, offsetof(CfgStoreHdr, crc));
+  return crc32Update(crc, data, h.len);
+}
+
+// Lee y valida una ranura en 'buf' (cabecera + datos)
+static bool leerRanura(CfgStore &s, uint8_t slot, uint8_t *buf)
+{
+  const size_t n = s.prefs->getBytesLength(SLOT_KEY[slot]);
+  if (n == 0)
+    return false;
+  const CfgStoreHdr *h = (const CfgStoreHdr *)buf;
+  if (n < sizeof(CfgStoreHdr) || n > sizeof(CfgStoreHdr) + CFG_STORE_MAX ||
+      s.prefs->getBytes(SLOT_KEY[slot], buf, n) != n ||
+      h->magic != s.magic || n != sizeof(CfgStoreHdr) + h->len ||
+      h->crc != crcRegistro(*h, buf + sizeof(CfgStoreHdr)))
+  {
+    s.badSlots++;
+    return false;
+  }
+  return true;
+}
+
+void cfgStoreInit(CfgStore &s, Preferences &prefs, uint32_t magic)
+{
+  s.prefs = &prefs;
+  s.magic = magic;
+  s.seq = 0;
+  s.slot = 1; // el primer commit va a la A
+  s.commits = 0;
+  s.badSlots = 0;
+}
+
+int cfgStoreLoad(CfgStore &s, void *out, size_t cap, uint16_t &schema)
+{
+  static uint8_t buf[2][sizeof(CfgStoreHdr) + CFG_STORE_MAX];
+  bool ok[2];
+  for (uint8_t i = 0; i < 2; i++)
+    ok[i] = leerRanura(s, i, buf[i]);
+
+  int elegida = -1;
+  if (ok[0] && ok[1])
+  {
+    const uint32_t a = ((const CfgStoreHdr *)buf[0])->seq;
+    const uint32_t b = ((const CfgStoreHdr *)buf[1])->seq;
+    elegida = ((int32_t)(b - a) > 0) ? 1 : 0;
+  }
+  else if (ok[0] || ok[1])
+    elegida = ok[0] ? 0 : 1;
+  if (elegida < 0)
+    return -1;
+
+  const CfgStoreHdr *h = (const CfgStoreHdr *)buf[elegida];
+  s.seq = h->seq;
+  s.slot = (uint8_t)elegida;
+  schema = h->schema;
+  memcpy(out, buf[elegida] + sizeof(CfgStoreHdr), h->len < cap ? h->len : cap);
+  return h->len;
+}
+
+bool cfgStoreCommit(CfgStore &s, uint16_t schema, const void *data, size_t len)
+{
+  if (len > CFG_STORE_MAX)
+    return false;
+  uint8_t *buf = (uint8_t *)malloc(sizeof(CfgStoreHdr) + len);
+  if (!buf)
+    return false;
+
+  CfgStoreHdr h;
+  h.magic = s.magic;
+  h.schema = schema;
+  h.len = (uint16_t)len;
+  h.seq = s.seq + 1;
+  memcpy(buf + sizeof(h), data, len);
+  h.crc = crcRegistro(h, buf + sizeof(h));
+  memcpy(buf, &h, sizeof(h));
+
+  // La ranura vigente no se toca hasta que la otra esté escrita entera
+  const uint8_t destino = s.slot ^ 1;
+  const bool ok = s.prefs->putBytes(SLOT_KEY[destino], buf, sizeof(h) + len) == sizeof(h) + len;
+  free(buf);
+  if (!ok)
+    return false;
+  s.seq = h.seq;
+  s.slot = destino;
+  s.commits++;
+  return true;
+}
@@ -106,6 +106,9 @@
 
 // =================== Flags de control del ciclo ===================
     int actualizarFlag = 0;
+    uint32_t otaSlotS = 0;
+    uint32_t otaVentanaS = 0;
+    volatile StateIO estadoIO = ST_IDLE;
     int restartFlag = 0;
     int activaConecta = 1;
     bool errorNotificado = false;
@@ -122,9 +125,6 @@
     String outputTicket = "";
     String outputPaso = "";
     String outputReportFailure = "";
-    String estadoRecibido = "";
-    String ticketRecibido = "";
-    String pasoRecibido = "";
 
 // =================== Métricas/errores/auxiliares ===================
     unsigned long inicioServidor = 0;
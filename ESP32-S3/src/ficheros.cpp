@@ -1917,6 +1917,7 @@ static const char HTML_LOGS[] PROGMEM = R"HTML(<!doctype html>
         <div class="actions">
           <button class="btn" type="button" onclick="clearBox()" id="btn-clear">Limpiar pantalla</button>
           <button class="btn btn-danger" type="button" onclick="togglePause()" id="pauseBtn">Pausar</button>
+          <a class="btn" href="/logs_spool" id="btn-spool">Descargar histórico</a>
           <a class="btn" href="/menu" id="btn-back">Volver al menú</a>
         </div>
 
@@ -1932,7 +1933,7 @@ static const char HTML_LOGS[] PROGMEM = R"HTML(<!doctype html>
       es: {
         title: "Logs",
         header: "Logs en vivo",
-        desc: "Este visor muestra eventos y logs en tiempo real del dispositivo los cuales no se guardan en flash.",
+        desc: "Este visor muestra eventos y logs en tiempo real del dispositivo. El histórico guardado en flash (incluye reinicios) se descarga aparte.",
         filter: "Filtro por prefijo",
         all: "Todos",
         interval: "Intervalo refresco (ms)",
@@ -1941,6 +1942,7 @@ static const char HTML_LOGS[] PROGMEM = R"HTML(<!doctype html>
         clear: "Limpiar pantalla",
         pause: "Pausar",
         resume: "Reanudar",
+        spool: "Descargar histórico",
         back: "Volver al menú",
         hint: "Consejo: si quieres ver solo lo último, usa “Limpiar pantalla” y deja el filtro en “Todos”.",
         connecting: "Conectando...",
@@ -1950,7 +1952,7 @@ static const char HTML_LOGS[] PROGMEM = R"HTML(<!doctype html>
       en: {
         title: "Logs",
         header: "Live Logs",
-        desc: "This viewer shows real-time events and logs from the device which are not saved in flash memory.",
+        desc: "This viewer shows real-time events and logs from the device. The history kept in flash (across restarts) is downloaded separately.",
         filter: "Filter by prefix",
         all: "All",
         interval: "Refresh interval (ms)",
@@ -1959,6 +1961,7 @@ static const char HTML_LOGS[] PROGMEM = R"HTML(<!doctype html>
         clear: "Clear screen",
         pause: "Pause",
         resume: "Resume",
+        spool: "Download history",
         back: "Back to menu",
         hint: "Tip: if you only want to see the latest, use “Clear screen” and leave the filter on “All”.",
         connecting: "Connecting...",
@@ -1993,6 +1996,7 @@ static const char HTML_LOGS[] PROGMEM = R"HTML(<!doctype html>
       document.getElementById('lbl-action').innerText = t.action;
       document.getElementById('btn-apply').innerText = t.apply;
       document.getElementById('btn-clear').innerText = t.clear;
+      document.getElementById('btn-spool').innerText = t.spool;
       document.getElementById('pauseBtn').innerText = paused ? t.resume : t.pause;
       document.getElementById('btn-back').innerText = t.back;
       document.getElementById('txt-hint').innerText = t.hint;
@@ -2021,17 +2025,23 @@ static const char HTML_LOGS[] PROGMEM = R"HTML(<!doctype html>
       document.getElementById('pauseBtn').textContent = paused ? t.resume : t.pause;
     }
 
+    // El servidor retiene la petición hasta que hay logs (long-poll); el
+    // intervalo es la pausa mínima entre peticiones
+    let gap = 800;
+    let busy = false;
+
     function applyInterval() {
-      const ms = Math.max(200, parseInt(iv.value || '800', 10));
-      if (timer) clearInterval(timer);
-      timer = setInterval(tick, ms);
-      tick();
+      gap = Math.max(200, parseInt(iv.value || '800', 10));
+      if (timer) clearTimeout(timer);
+      if (!busy) tick();
     }
 
     async function tick() {
-      if (paused) return;
+      timer = null;
+      if (paused) { timer = setTimeout(tick, gap); return; }
+      busy = true;
       try {
-        const r = await fetch('/logs_data?since=' + since, { cache: 'no-store' });
+        const r = await fetch('/logs_data?wait=20000&since=' + since, { cache: 'no-store' });
         if (r.status === 401) { window.location.href = "/"; return; }
         if (!r.ok) { setOk(false); return; }
 
@@ -2046,12 +2056,15 @@ static const char HTML_LOGS[] PROGMEM = R"HTML(<!doctype html>
             if (!pref || (it.msg && it.msg.startsWith(pref))) {
               box.textContent += line;
             }
-            since = it.id;
           }
           box.scrollTop = box.scrollHeight;
         }
+        if (typeof j.next === 'number') since = j.next;
       } catch (e) {
         setOk(false);
+      } finally {
+        busy = false;
+        if (!timer) timer = setTimeout(tick, gap);
       }
     }
 
@@ -2768,7 +2781,7 @@ static const char HTML_UPLOAD[] PROGMEM = R"HTML(<!doctype html>
       font-size: 13px;
     }
 
-    input[type="file"] {
+    input[type="file"], input[type="text"] {
       width: 100%;
       padding: 12px;
       border-radius: 10px;
@@ -2855,11 +2868,13 @@ static const char HTML_UPLOAD[] PROGMEM = R"HTML(<!doctype html>
       </div>
 
       <div class="card-body">
-        <p><span id="txt-curr-ver">Versión actual del firmware:</span> <span class="pill">VERSION_FIRMWARE</span></p>
+        <p><span id="txt-curr-ver">Versión actual del firmware:</span> <span class="pill">{{VERSION_FIRMWARE}}</span></p>
         <p id="txt-select-file">Seleccione el archivo binario para actualizar el firmware.</p>
 
         <form method="POST" action="/upload_firmware" enctype="multipart/form-data">
           <input type="file" name="firmware" required />
+          <p id="txt-sha">SHA-256 de la imagen (opcional; si no coincide no se instala):</p>
+          <input type="text" name="sha256" id="inp-sha" maxlength="64" pattern="[0-9a-fA-F]{64}" autocomplete="off" spellcheck="false" />
           <div class="actions">
             <input type="submit" id="btn-submit" value="Actualizar firmware" />
             <button class="btn btn-danger" type="button" onclick="downloadFirmware()" id="btn-server">Descargar firmware desde servidor</button>
@@ -2877,6 +2892,7 @@ static const char HTML_UPLOAD[] PROGMEM = R"HTML(<!doctype html>
         header: "Actualizar firmware",
         currVer: "Versión actual del firmware:",
         selectFile: "Seleccione el archivo binario para actualizar el firmware.",
+        sha: "SHA-256 de la imagen (opcional; si no coincide no se instala):",
         btnSubmit: "Actualizar firmware",
         btnServer: "Descargar firmware desde servidor",
         btnBack: "Volver al menú",
@@ -2889,6 +2905,7 @@ static const char HTML_UPLOAD[] PROGMEM = R"HTML(<!doctype html>
         header: "Update Firmware",
         currVer: "Current firmware version:",
         selectFile: "Select the binary file to update the firmware.",
+        sha: "Image SHA-256 (optional; it is not installed on mismatch):",
         btnSubmit: "Update firmware",
         btnServer: "Download firmware from server",
         btnBack: "Back to menu",
@@ -2909,6 +2926,7 @@ static const char HTML_UPLOAD[] PROGMEM = R"HTML(<!doctype html>
       document.getElementById('txt-header').innerText = t.header;
       document.getElementById('txt-curr-ver').innerText = t.currVer;
       document.getElementById('txt-select-file').innerText = t.selectFile;
+      document.getElementById('txt-sha').innerText = t.sha;
       document.getElementById('btn-submit').value = t.btnSubmit;
       document.getElementById('btn-server').innerText = t.btnServer;
       document.getElementById('btn-back').innerText = t.btnBack;
@@ -3212,6 +3230,29 @@ struct PageDef
   const char *contentP; // PROGMEM
 };
 
+// Manifiesto: hash y tamaño de cada página tal y como se escribió la última
+// vez. Si el firmware no cambia la página (y el fichero sigue ahí con su
+// tamaño) no se vuelve a borrar ni a escribir.
+struct PagesManifestHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+};
+
+struct PageManifestEntry
+{
+  uint32_t pathHash;
+  uint32_t contentHash;
+  uint32_t len;
+};
+
+static const uint32_t PAGES_MANIFEST_MAGIC = 0x314E4D50; // "PMN1"
+static const uint16_t PAGES_MANIFEST_VERSION = 1;
+static const size_t PAGES_MANIFEST_MAX = 16;
+
+static WebPagesStats g_pagesStats = {};
+
 static size_t progmemStrLen(const char *p)
 {
   size_t n = 0;
@@ -3220,9 +3261,19 @@ static size_t progmemStrLen(const char *p)
   return n;
 }
 
-static bool writeFileFromProgmem(fs::FS &fs, const char *path, const char *contentP)
+// FNV-1a 32. En el ESP32 la flash está mapeada: se lee sin pgm_read_byte.
+static uint32_t fnv1a32(const char *p, size_t n, uint32_t h = 2166136261UL)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    h ^= (uint8_t)p[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+static bool writeFileFromProgmem(fs::FS &fs, const char *path, const char *contentP, size_t len)
 {
-  // Sobrescribe SIEMPRE
   if (fs.exists(path))
   {
     fs.remove(path);
@@ -3235,35 +3286,15 @@ static bool writeFileFromProgmem(fs::FS &fs, const char *path, const char *conte
     return false;
   }
 
-  const size_t len = progmemStrLen(contentP);
-
-  // Escritura en chunks para ir rápido
-  const size_t CHUNK = 512;
-  uint8_t buf[CHUNK];
-
-  size_t off = 0;
-  while (off < len)
+  // Directo desde la flash mapeada, sin buffer intermedio
+  const size_t w = f.write((const uint8_t *)contentP, len);
+  f.close();
+  if (w != len)
   {
-    size_t n = len - off;
-    if (n > CHUNK)
-      n = CHUNK;
-
-    for (size_t i = 0; i < n; i++)
-    {
-      buf[i] = (uint8_t)pgm_read_byte(contentP + off + i);
-    }
-
-    size_t w = f.write(buf, n);
-    if (w != n)
-    {
-      Serial.printf("[FS] ERROR write %s (w=%u n=%u)\n", path, (unsigned)w, (unsigned)n);
-      f.close();
-      return false;
-    }
-    off += n;
+    Serial.printf("[FS] ERROR write %s (w=%u n=%u)\n", path, (unsigned)w, (unsigned)len);
+    return false;
   }
 
-  f.close();
   Serial.printf("[FS] OK %s (%u bytes)\n", path, (unsigned)len);
   return true;
 }
@@ -3277,7 +3308,7 @@ static const PageDef pages[] = {
     {"/config.html", HTML_CONFIG},
     {"/actions.html", HTML_ACTIONS},
     {"/params.html", HTML_PARAMS},
-    {"/upload_fs", HTML_FICHEROS}, // “Actualizar sistema de ficheros”
+    {"/upload_fs.html", HTML_FICHEROS}, // “Actualizar sistema de ficheros” (GET /upload_fs)
     {"/index.html", HTML_INDEX},       // si tú sirves "/" desde otro, cambia el nombre
     {"/logs.html", HTML_LOGS},
     {"/menu.html", HTML_MENU},
@@ -3287,24 +3318,201 @@ static const PageDef pages[] = {
 
 };
 
+static const size_t PAGES_COUNT = sizeof(pages) / sizeof(pages[0]);
+static_assert(PAGES_COUNT <= PAGES_MANIFEST_MAX, "Demasiadas páginas para el manifiesto");
+
+// Copia de cada página en LittleFS frente al manifiesto de este arranque
+enum PageFsState : uint8_t
+{
+  PAGE_FS_UNKNOWN = 0, // por comprobar (leyendo el fichero)
+  PAGE_FS_STOCK,       // igual que la del firmware
+  PAGE_FS_CHANGED      // sustituida o borrada
+};
+
+static PageManifestEntry g_manifest[PAGES_MANIFEST_MAX];
+static PageFsState g_pageFs[PAGES_MANIFEST_MAX];
+static size_t g_manifestCount = 0;
+
+static size_t loadManifest(PageManifestEntry *out, size_t cap)
+{
+  File f = LittleFS.open(PAGES_MANIFEST_PATH, FILE_READ);
+  if (!f)
+    return 0;
+
+  PagesManifestHeader h;
+  size_t n = 0;
+  if (f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+      h.magic == PAGES_MANIFEST_MAGIC && h.version == PAGES_MANIFEST_VERSION && h.count <= cap)
+  {
+    const size_t bytes = h.count * sizeof(PageManifestEntry);
+    if (f.read((uint8_t *)out, bytes) == bytes)
+      n = h.count;
+  }
+  f.close();
+  return n;
+}
+
+static bool saveManifest(const PageManifestEntry *entries, size_t n)
+{
+  File f = LittleFS.open(PAGES_MANIFEST_PATH, FILE_WRITE);
+  if (!f)
+    return false;
+  PagesManifestHeader h = {PAGES_MANIFEST_MAGIC, PAGES_MANIFEST_VERSION, (uint16_t)n};
+  const size_t bytes = n * sizeof(PageManifestEntry);
+  const bool ok = f.write((const uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+                  f.write((const uint8_t *)entries, bytes) == bytes;
+  f.close();
+  return ok;
+}
+
+static bool pageUpToDate(const PageManifestEntry *old, size_t nOld, const PageManifestEntry &cur, const char *path)
+{
+  for (size_t i = 0; i < nOld; i++)
+  {
+    if (old[i].pathHash != cur.pathHash)
+      continue;
+    if (old[i].contentHash != cur.contentHash || old[i].len != cur.len)
+      return false;
+    // Alguien pudo borrarla o sustituirla desde /upload_fs
+    File f = LittleFS.open(path, FILE_READ);
+    const bool ok = f && f.size() == cur.len;
+    if (f)
+      f.close();
+    return ok;
+  }
+  return false;
+}
+
 // ============================================================================
-// 4) Función pública: crea/sobrescribe todos los HTML en LittleFS
+// 4) Función pública: escribe en LittleFS solo las páginas que han cambiado
 // ============================================================================
 
 bool ensureWebPagesInLittleFS(bool formatOnFail)
 {
+  const uint32_t t0 = micros();
+
   if (!LittleFS.begin(formatOnFail))
   {
     Serial.println("[FS] ERROR LittleFS.begin()");
     return false;
   }
 
+  PageManifestEntry old[PAGES_MANIFEST_MAX];
+  const size_t nOld = loadManifest(old, PAGES_MANIFEST_MAX);
+
+  PageManifestEntry cur[PAGES_MANIFEST_MAX];
+  WebPagesStats st = {};
   bool okAll = true;
-  for (size_t i = 0; i < sizeof(pages) / sizeof(pages[0]); i++)
+
+  for (size_t i = 0; i < PAGES_COUNT; i++)
   {
-    const bool ok = writeFileFromProgmem(LittleFS, pages[i].path, pages[i].contentP);
-    okAll = okAll && ok;
+    const char *path = pages[i].path;
+    const size_t len = progmemStrLen(pages[i].contentP);
+    cur[i].pathHash = fnv1a32(path, strlen(path));
+    cur[i].contentHash = fnv1a32(pages[i].contentP, len);
+    cur[i].len = (uint32_t)len;
+    st.bytesTotal += len;
+
+    if (pageUpToDate(old, nOld, cur[i], path))
+    {
+      st.skipped++;
+      continue;
+    }
+
+    if (writeFileFromProgmem(LittleFS, path, pages[i].contentP, len))
+    {
+      st.written++;
+      st.bytesWritten += len;
+    }
+    else
+    {
+      cur[i].contentHash = 0; // se reintenta en el próximo arranque
+      okAll = false;
+    }
   }
 
+  if (st.written > 0 || nOld != PAGES_COUNT)
+    saveManifest(cur, PAGES_COUNT);
+
+  // Recién escritas: son las del firmware. Las que no se tocaron pueden ser
+  // una subida del mismo tamaño, se comprueban al servirlas por primera vez.
+  memcpy(g_manifest, cur, sizeof(cur[0]) * PAGES_COUNT);
+  for (size_t i = 0; i < PAGES_COUNT; i++)
+    g_pageFs[i] = PAGE_FS_UNKNOWN;
+  g_manifestCount = PAGES_COUNT;
+
+  st.bootUs = micros() - t0;
+  g_pagesStats = st;
+
+  Serial.printf("[FS] Páginas: %u escritas, %u sin cambios, %u/%u bytes escritos, %lu us\n",
+                (unsigned)st.written, (unsigned)st.skipped,
+                (unsigned)st.bytesWritten, (unsigned)st.bytesTotal, (unsigned long)st.bootUs);
   return okAll;
 }
+
+static int pageIndex(const char *path)
+{
+  const uint32_t h = fnv1a32(path, strlen(path));
+  for (size_t i = 0; i < g_manifestCount; i++)
+    if (g_manifest[i].pathHash == h)
+      return (int)i;
+  return -1;
+}
+
+static bool fileMatchesManifest(const char *path, const PageManifestEntry &e)
+{
+  if (e.contentHash == 0)
+    return false; // no se pudo escribir en este arranque
+  File f = LittleFS.open(path, FILE_READ);
+  if (!f)
+    return false;
+  bool ok = f.size() == e.len;
+  uint32_t h = 2166136261UL;
+  char buf[256];
+  while (ok && f.available())
+  {
+    const size_t n = f.read((uint8_t *)buf, sizeof(buf));
+    if (n == 0)
+      break;
+    h = fnv1a32(buf, n, h);
+  }
+  f.close();
+  return ok && h == e.contentHash;
+}
+
+bool webPageIsStock(const char *path)
+{
+  const int i = pageIndex(path);
+  if (i < 0)
+    return false;
+  if (g_pageFs[i] == PAGE_FS_UNKNOWN)
+  {
+    g_pageFs[i] = fileMatchesManifest(path, g_manifest[i]) ? PAGE_FS_STOCK : PAGE_FS_CHANGED;
+    if (g_pageFs[i] == PAGE_FS_CHANGED)
+      Serial.printf("[FS] %s no es la del firmware: se sirve la de LittleFS\n", path);
+  }
+  return g_pageFs[i] == PAGE_FS_STOCK;
+}
+
+void webPageChanged(const char *path)
+{
+  const int i = pageIndex(path);
+  if (i >= 0)
+    g_pageFs[i] = PAGE_FS_UNKNOWN;
+}
+
+WebPagesStats webPagesStats()
+{
+  return g_pagesStats;
+}
+
+String webPagesStatsJson()
+{
+  String json = "{\"written\":" + String(g_pagesStats.written);
+  json += ",\"skipped\":" + String(g_pagesStats.skipped);
+  json += ",\"bytes_written\":" + String(g_pagesStats.bytesWritten);
+  json += ",\"bytes_total\":" + String(g_pagesStats.bytesTotal);
+  json += ",\"boot_us\":" + String(g_pagesStats.bootUs);
+  json += "}";
+  return json;
+}
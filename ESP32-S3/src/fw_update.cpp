@@ -0,0 +1,310 @@
+#include "fw_update.hpp"
+#include "logBuf.hpp"
+
+#include <Preferences.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/version.h>
+
+#if MBEDTLS_VERSION_NUMBER < 0x03000000
+// mbedtls 2.x: las variantes que devuelven código de error llevan _ret
+#define mbedtls_sha256_starts mbedtls_sha256_starts_ret
+#define mbedtls_sha256_update mbedtls_sha256_update_ret
+#define mbedtls_sha256_finish mbedtls_sha256_finish_ret
+#endif
+
+static uint8_t g_block[FW_BLOCK];
+static size_t g_blockLen = 0;
+static size_t g_written = 0;
+static bool g_active = false;
+static mbedtls_sha256_context g_sha;
+static uint8_t g_digest[32];
+static const char *g_error = "";
+
+// Validación tras actualizar (namespace propio en NVS)
+#define FW_NS "fwota"
+static bool g_pending = false;        // imagen en ejecución sin confirmar
+static bool g_bootloaderVerify = false; // además, PENDING_VERIFY del bootloader
+static char g_prev[17] = "";          // partición a la que se vuelve
+static uint32_t g_verifyMs = 0;       // tiempo acumulado con enlace
+static uint32_t g_verifyLast = 0;
+
+// El core de Arduino confirma la imagen al arrancar salvo que esto devuelva
+// true: la confirmación la hace fwUpdateVerifyLoop cuando responde el backend
+extern "C" bool verifyRollbackLater()
+{
+  return true;
+}
+
+static bool flushBlock()
+{
+  if (g_blockLen == 0)
+    return true;
+  if (Update.write(g_block, g_blockLen) != g_blockLen)
+  {
+    g_error = Update.errorString();
+    return false;
+  }
+  g_blockLen = 0;
+  return true;
+}
+
+static void terminar()
+{
+  mbedtls_sha256_free(&g_sha);
+  g_active = false;
+  g_blockLen = 0;
+}
+
+bool fwUpdateBegin(size_t size)
+{
+  if (g_active)
+    fwUpdateAbort();
+
+  if (!Update.begin(size ? size : UPDATE_SIZE_UNKNOWN))
+  {
+    g_error = Update.errorString();
+    return false;
+  }
+
+  mbedtls_sha256_init(&g_sha);
+  mbedtls_sha256_starts(&g_sha, 0);
+  memset(g_digest, 0, sizeof(g_digest));
+  g_blockLen = 0;
+  g_written = 0;
+  g_error = "";
+  g_active = true;
+  return true;
+}
+
+bool fwUpdateWrite(const uint8_t *data, size_t len)
+{
+  if (!g_active)
+    return false;
+
+  mbedtls_sha256_update(&g_sha, data, len);
+  g_written += len;
+
+  while (len > 0)
+  {
+    size_t n = FW_BLOCK - g_blockLen;
+    if (n > len)
+      n = len;
+    memcpy(g_block + g_blockLen, data, n);
+    g_blockLen += n;
+    data += n;
+    len -= n;
+    if (g_blockLen == FW_BLOCK && !flushBlock())
+    {
+      fwUpdateAbort();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool fwUpdateEnd(const char *sha256Hex)
+{
+  if (!g_active)
+    return false;
+
+  bool ok = flushBlock();
+  mbedtls_sha256_finish(&g_sha, g_digest);
+
+  if (ok && g_written == 0)
+  {
+    g_error = "No se recibieron datos";
+    ok = false;
+  }
+  if (ok && sha256Hex && *sha256Hex)
+  {
+    char hex[65];
+    fwUpdateDigestHex(hex);
+    if (strlen(sha256Hex) != 64 || strncasecmp(hex, sha256Hex, 64) != 0)
+    {
+      g_error = "El SHA-256 no coincide";
+      ok = false;
+    }
+  }
+
+  if (!ok)
+  {
+    Update.abort();
+    terminar();
+    return false;
+  }
+
+  // Update valida la imagen (cabecera, checksum y hash añadido) al cerrar
+  if (!Update.end(true))
+  {
+    g_error = Update.errorString();
+    terminar();
+    return false;
+  }
+  terminar();
+
+  // La nueva arranca a prueba; se recuerda a qué partición volver
+  const esp_partition_t *run = esp_ota_get_running_partition();
+  Preferences p;
+  if (run && p.begin(FW_NS, false))
+  {
+    p.putString("prev", run->label);
+    p.putUChar("boots", 0);
+    p.putBool("pend", true);
+    p.end();
+  }
+  return true;
+}
+
+void fwUpdateAbort()
+{
+  if (!g_active)
+    return;
+  Update.abort();
+  terminar();
+}
+
+bool fwUpdateActive()
+{
+  return g_active;
+}
+
+size_t fwUpdateWritten()
+{
+  return g_written;
+}
+
+const char *fwUpdateError()
+{
+  return g_error;
+}
+
+void fwUpdateDigestHex(char out[65])
+{
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  for (size_t i = 0; i < sizeof(g_digest); i++)
+  {
+    out[2 * i] = HEX_DIGITS[g_digest[i] >> 4];
+    out[2 * i + 1] = HEX_DIGITS[g_digest[i] & 0x0F];
+  }
+  out[64] = '\0';
+}
+
+// ===================== Imagen en ejecución =====================
+
+bool fwRunningRead(uint32_t offset, uint8_t *buf, size_t len)
+{
+  static const esp_partition_t *run = esp_ota_get_running_partition();
+  return run && offset + len <= run->size &&
+         esp_partition_read(run, offset, buf, len) == ESP_OK;
+}
+
+bool fwRunningSha256(size_t len, uint8_t out[32])
+{
+  uint8_t buf[1024];
+  mbedtls_sha256_context sha;
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+  bool ok = true;
+  for (size_t off = 0; ok && off < len; off += sizeof(buf))
+  {
+    const size_t n = (len - off < sizeof(buf)) ? len - off : sizeof(buf);
+    ok = fwRunningRead(off, buf, n);
+    if (ok)
+      mbedtls_sha256_update(&sha, buf, n);
+  }
+  if (ok)
+    mbedtls_sha256_finish(&sha, out);
+  mbedtls_sha256_free(&sha);
+  return ok;
+}
+
+// ===================== Validación tras actualizar =====================
+
+static void olvidarPendiente()
+{
+  Preferences p;
+  if (p.begin(FW_NS, false))
+  {
+    p.putBool("pend", false);
+    p.end();
+  }
+  g_pending = false;
+}
+
+// No vuelve: reinicia en la partición anterior
+static void volverAtras(const char *motivo)
+{
+  logbuf_pushf("[OTA] Imagen no confirmada (%s): vuelta a %s", motivo, g_prev);
+  olvidarPendiente();
+  if (g_bootloaderVerify)
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+
+  const esp_partition_t *prev = esp_partition_find_first(ESP_PARTITION_TYPE_APP,
+                                                         ESP_PARTITION_SUBTYPE_ANY, g_prev);
+  if (prev)
+    esp_ota_set_boot_partition(prev);
+  delay(100);
+  esp_restart();
+}
+
+void fwUpdateBootCheck()
+{
+  const esp_partition_t *run = esp_ota_get_running_partition();
+  esp_ota_img_states_t st;
+  g_bootloaderVerify = run && esp_ota_get_state_partition(run, &st) == ESP_OK &&
+                       st == ESP_OTA_IMG_PENDING_VERIFY;
+
+  Preferences p;
+  if (!p.begin(FW_NS, false))
+  {
+    g_pending = g_bootloaderVerify;
+    return;
+  }
+  bool pend = p.getBool("pend", false);
+  const uint8_t boots = p.getUChar("boots", 0) + 1;
+  p.getString("prev", g_prev, sizeof(g_prev));
+  if (pend && run && strcmp(g_prev, run->label) == 0)
+  {
+    // Sigue la imagen anterior (la nueva no llegó a arrancar)
+    p.putBool("pend", false);
+    pend = false;
+  }
+  else if (pend)
+    p.putUChar("boots", boots);
+  p.end();
+
+  g_pending = pend || g_bootloaderVerify;
+  if (pend && boots > FW_VERIFY_BOOTS)
+    volverAtras("reinicios");
+  if (g_pending)
+    logbuf_pushf("[OTA] Imagen a prueba (arranque %u de %u)", (unsigned)boots, (unsigned)FW_VERIFY_BOOTS);
+}
+
+bool fwUpdatePendingVerify()
+{
+  return g_pending;
+}
+
+void fwUpdateVerifyLoop(bool conRed, bool sano)
+{
+  if (!g_pending)
+    return;
+
+  if (sano)
+  {
+    if (g_bootloaderVerify)
+      esp_ota_mark_app_valid_cancel_rollback();
+    olvidarPendiente();
+    logbuf_pushf("[OTA] Imagen confirmada");
+    return;
+  }
+
+  const uint32_t now = millis();
+  if (conRed && g_verifyLast)
+    g_verifyMs += now - g_verifyLast;
+  g_verifyLast = now;
+  if (g_verifyMs > FW_VERIFY_MS)
+    volverAtras("sin backend");
+}
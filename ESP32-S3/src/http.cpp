@@ -2,13 +2,16 @@
 #include "definiciones.hpp"
 #include "json.hpp"
 #include "logBuf.hpp"
+#include "http_parser.hpp"
+#include "fw_update.hpp"
+#include "ota_delta.hpp"
 
 #include <Ethernet.h>
-#include <Update.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
+#include <utility>
 
 // ================== Helpers internos ====================
 
@@ -34,28 +37,6 @@ static void log_line_both(const char *fmt, ...)
     Serial.println(buf);
 }
 
-// Helper para leer líneas usando la clase base Client (funciona con WiFi y Ethernet)
-static bool readLine(Client &c, String &line, uint32_t timeout_ms)
-{
-  line = "";
-  line.reserve(128);
-  uint32_t t0 = millis();
-  while (millis() - t0 < timeout_ms)
-  {
-    while (c.available())
-    {
-      char ch = (char)c.read();
-      if (ch == '\r')
-        continue;
-      if (ch == '\n')
-        return true;
-      line += ch;
-    }
-    yield(); // Evita bloqueos del WDT
-  }
-  return false;
-}
-
 static bool parseHttpUrl(const String &url, String &host, uint16_t &port, String &path)
 {
   host = "";
@@ -95,13 +76,13 @@ static bool parseHttpUrl(const String &url, String &host, uint16_t &port, String
 }
 
 // --- IMPRESIÓN ATÓMICA DE CAMPOS JSON ---
-static void dumpJsonFieldsFromString(const char *tag, const String &json)
+static void dumpJsonFields(const char *tag, const char *json, size_t len)
 {
   if (!debugSerie)
     return;
 
   JsonDocument d;
-  DeserializationError err = deserializeJson(d, json);
+  DeserializationError err = deserializeJson(d, json, len);
 
   // Construimos TODO el mensaje en memoria primero
   String salida;
@@ -142,13 +123,179 @@ static void dumpJsonFieldsFromString(const char *tag, const String &json)
   Serial.print(salida);
 }
 
+// ================== Pool de conexiones keep-alive ====================
+// Una conexión persistente por transporte contra serverURL. Se reutiliza
+// mientras el servidor no pida "Connection: close" y no supere
+// HTTP_KEEPALIVE_IDLE_MS ociosa; si está medio cerrada se rehace.
+
+struct PooledConn
+{
+  Client *client;
+  String host;
+  uint16_t port;
+  uint32_t lastUseMs;
+  bool open;
+};
+
+static WiFiClient g_wifiConn;
+static EthernetClient g_ethConn;
+static PooledConn g_pool[2] = {{&g_wifiConn, "", 0, 0, false},
+                               {&g_ethConn, "", 0, 0, false}};
+static HttpPoolStats g_poolStats = {0, 0, 0, 0};
+
+static inline PooledConn &poolSlot()
+{
+  return g_pool[(conexionRed == 0) ? 0 : 1];
+}
+
+static void poolClose(PooledConn &pc)
+{
+  if (pc.open)
+    pc.client->stop();
+  pc.open = false;
+}
+
+// Devuelve un cliente conectado a host:port. 'reused' indica si venía del pool.
+static Client *poolAcquire(const String &host, uint16_t port, bool &reused)
+{
+  PooledConn &pc = poolSlot();
+  reused = false;
+
+  if (pc.open)
+  {
+    const bool mismoDestino = (pc.port == port) && (pc.host == host);
+    const bool caducada = (millis() - pc.lastUseMs) > HTTP_KEEPALIVE_IDLE_MS;
+
+    if (mismoDestino && !caducada && pc.client->connected())
+    {
+      // Restos de una respuesta anterior no deben mezclarse con la nueva
+      while (pc.client->available())
+        pc.client->read();
+      reused = true;
+      g_poolStats.reuses++;
+      return pc.client;
+    }
+
+    if (caducada)
+      g_poolStats.expired++;
+    poolClose(pc);
+  }
+
+  // connect() es la única fase bloqueante: se acota con HTTP_CONNECT_TIMEOUT_MS
+  pc.client->setTimeout(HTTP_TIMEOUT_MS / 1000); // Segundos en algunas implementaciones
+  bool conectado;
+  if (conexionRed == 0)
+    conectado = g_wifiConn.connect(host.c_str(), port, HTTP_CONNECT_TIMEOUT_MS);
+  else
+  {
+    g_ethConn.setConnectionTimeout(HTTP_CONNECT_TIMEOUT_MS);
+    conectado = g_ethConn.connect(host.c_str(), port);
+  }
+  if (!conectado)
+    return nullptr;
+
+  pc.host = host;
+  pc.port = port;
+  pc.open = true;
+  pc.lastUseMs = millis();
+  g_poolStats.connects++;
+  return pc.client;
+}
+
+static void poolRelease(bool keepAlive)
+{
+  PooledConn &pc = poolSlot();
+  if (keepAlive)
+    pc.lastUseMs = millis();
+  else
+    poolClose(pc);
+}
+
+HttpPoolStats httpPoolStats()
+{
+  return g_poolStats;
+}
+
+void httpPoolReset()
+{
+  poolClose(g_pool[0]);
+  poolClose(g_pool[1]);
+}
+
 // ====================== LÓGICA DE COMUNICACIÓN =========================
+// Todas las peticiones comparten el mismo camino: cabeceras en un único
+// write(), lectura del socket por bloques y parseo incremental con
+// HttpRespParser. El cuerpo va directo a g_respBuf (o a un callback) y de
+// ahí al deserializador JSON, sin Strings intermedios por carácter.
+
+static char g_respBuf[HTTP_RESP_BUF_SIZE]; // solo se usa desde taskNet
+static size_t g_respLen = 0;
+
+// 'extra': cabeceras adicionales ya terminadas en "\r\n" (o nullptr)
+static bool sendRequest(Client &client, const char *method, const char *host, uint16_t port,
+                        const char *path, const char *contentType,
+                        const char *body, size_t bodyLen, bool keepAlive,
+                        const char *extra = nullptr)
+{
+  char hdr[512];
+  int n = snprintf(hdr, sizeof(hdr), "%s %s HTTP/1.1\r\nHost: %s", method, path, host);
+  if (n > 0 && (size_t)n < sizeof(hdr) && port != 80)
+    n += snprintf(hdr + n, sizeof(hdr) - n, ":%u", port);
+  if (n > 0 && (size_t)n < sizeof(hdr))
+    n += snprintf(hdr + n, sizeof(hdr) - n, "\r\nConnection: %s\r\n",
+                  keepAlive ? "keep-alive" : "close");
+  if (n > 0 && (size_t)n < sizeof(hdr) && contentType)
+    n += snprintf(hdr + n, sizeof(hdr) - n, "Content-Type: %s\r\nContent-Length: %u\r\n",
+                  contentType, (unsigned)bodyLen);
+  if (n > 0 && (size_t)n < sizeof(hdr) && extra)
+    n += snprintf(hdr + n, sizeof(hdr) - n, "%s", extra);
+  if (n > 0 && (size_t)n < sizeof(hdr))
+    n += snprintf(hdr + n, sizeof(hdr) - n, "\r\n");
+  if (n <= 0 || (size_t)n >= sizeof(hdr))
+  {
+    log_line_both("[HTTP][ERR] Cabeceras demasiado largas (%s)", path);
+    return false;
+  }
+
+  if (client.write((const uint8_t *)hdr, (size_t)n) != (size_t)n)
+    return false;
+  if (bodyLen > 0 && client.write((const uint8_t *)body, bodyLen) != bodyLen)
+    return false;
+  return true;
+}
 
-static bool postJSON(const String &url, const String &payload, String &response)
+// Lee del socket y alimenta el parser hasta completar la respuesta.
+// El timeout es de inactividad: se reinicia cada vez que llegan datos.
+static bool readResponse(Client &c, HttpRespParser &p, uint32_t timeoutMs)
 {
-  response.clear();
+  uint8_t blk[256];
+  uint32_t t0 = millis();
+
+  while (!httpParserDone(p) && !httpParserFailed(p))
+  {
+    int avail = c.available();
+    if (avail > 0)
+    {
+      int n = c.read(blk, min((size_t)avail, sizeof(blk)));
+      if (n > 0)
+      {
+        httpParserFeed(p, blk, (size_t)n);
+        t0 = millis();
+        continue;
+      }
+    }
+    if (!c.connected())
+      return httpParserFinish(p);
+    if (millis() - t0 > timeoutMs)
+      return false;
+    delay(1);
+  }
+  return httpParserDone(p);
+}
 
-  // 1. Validar conexión según conexionRed (0: WiFi, 1: Ethernet)
+static bool transportReady()
+{
+  // conexionRed: 0 = WiFi, 1 = Ethernet
   if (conexionRed == 0)
   {
     if (WiFi.status() != WL_CONNECTED)
@@ -157,14 +304,27 @@ static bool postJSON(const String &url, const String &payload, String &response)
       return false;
     }
   }
-  else
+  else if (Ethernet.localIP() == IPAddress(0, 0, 0, 0))
   {
-    if (Ethernet.localIP() == IPAddress(0, 0, 0, 0))
-    {
-      log_line_both("[HTTP][ERR] Ethernet sin IP.");
-      return false;
-    }
+    log_line_both("[HTTP][ERR] Ethernet sin IP.");
+    return false;
   }
+  return true;
+}
+
+// POST contra serverURL por la conexión persistente. Si una conexión
+// reutilizada resulta estar medio cerrada (no llega ni un byte) se rehace
+// una única vez.
+static void asyncWaitActive();
+
+static bool httpPost(const String &url, const char *contentType,
+                     const String &payload, HttpRespParser &p)
+{
+  // La conexión persistente y g_respBuf son compartidos con el motor asíncrono
+  asyncWaitActive();
+
+  if (!transportReady())
+    return false;
 
   String host, path;
   uint16_t port;
@@ -174,423 +334,1176 @@ static bool postJSON(const String &url, const String &payload, String &response)
     return false;
   }
 
-  log_line_both("[HTTP][%s] POST %s", (conexionRed == 0 ? "WiFi" : "ETH"), url.c_str());
+  for (int intento = 0; intento < 2; intento++)
+  {
+    bool reused = false;
+    Client *client = poolAcquire(host, port, reused);
+    if (!client)
+    {
+      log_line_both("[HTTP][ERR] connect %s:%u FAILED", host.c_str(), port);
+      return false;
+    }
+
+    log_line_both("[HTTP][%s] POST %s%s", (conexionRed == 0 ? "WiFi" : "ETH"), url.c_str(),
+                  reused ? " (keep-alive)" : "");
 
-  // 2. Selección de Cliente (Abstracción)
-  WiFiClient wfClient;
-  EthernetClient ethClient;
-  Client *client;
+    bool sent = sendRequest(*client, "POST", host.c_str(), port, path.c_str(), contentType,
+                            payload.c_str(), payload.length(), true);
+    if (sent && readResponse(*client, p, HTTP_TIMEOUT_MS))
+    {
+      poolRelease(p.keepAlive);
+      return true;
+    }
 
-  if (conexionRed == 0)
-    client = &wfClient;
+    poolRelease(false);
+    if (!reused || p.rawBytes > 0)
+      break;
+
+    g_poolStats.reconnects++;
+    log_line_both("[HTTP] Conexión keep-alive cerrada por el servidor, reconectando");
+    httpParserReset(p);
+  }
+
+  if (p.status == 0)
+    log_line_both("[HTTP][ERR] Timeout status line");
   else
-    client = &ethClient;
+    log_line_both("[HTTP][ERR] Respuesta incompleta (status %d, %u bytes)", p.status, (unsigned)p.bodyLen);
+  return false;
+}
+
+// Respuesta JSON completa en g_respBuf: fija g_respLen y devuelve true si 2xx
+static bool cerrarRespuestaJSON(const HttpRespParser &p)
+{
+  g_respLen = (p.bodyLen < sizeof(g_respBuf) - 1) ? p.bodyLen : sizeof(g_respBuf) - 1;
+  if (p.overflow)
+    log_line_both("[HTTP][WARN] Respuesta de %u bytes truncada a %u", (unsigned)p.bodyLen, (unsigned)g_respLen);
 
-  client->setTimeout(HTTP_TIMEOUT_MS / 1000); // Segundos en algunas implementaciones
+  dumpJsonFields("IN", g_respBuf, g_respLen);
+  return (p.status >= 200 && p.status < 300);
+}
 
-  if (!client->connect(host.c_str(), port))
+// POST application/json → cuerpo en g_respBuf/g_respLen, true si 2xx
+static bool postJSON(const String &url, const String &payload)
+{
+  HttpRespParser p;
+  httpParserInit(p, g_respBuf, sizeof(g_respBuf));
+
+  bool ok = httpPost(url, "application/json", payload, p);
+  g_respLen = 0;
+  dumpJsonFields("OUT", payload.c_str(), payload.length());
+  if (!ok)
+    return false;
+  return cerrarRespuestaJSON(p);
+}
+
+// Callback de cuerpo → String (respuestas de tamaño no acotado)
+struct StringSink
+{
+  String *out;
+  size_t max;
+};
+
+static bool appendToString(void *ctx, const uint8_t *data, size_t len)
+{
+  StringSink *sink = static_cast<StringSink *>(ctx);
+  if (sink->max && sink->out->length() + len > sink->max)
+    return false;
+  return sink->out->concat((const char *)data, len);
+}
+
+// ================== Peticiones "raw" (otro host, sin pool) ====================
+
+struct RawCtx
+{
+  StringSink body;
+  String *headers;
+};
+
+static bool rawBody(void *ctx, const uint8_t *data, size_t len)
+{
+  return appendToString(&static_cast<RawCtx *>(ctx)->body, data, len);
+}
+
+// Reconstruye las cabeceras como "HTTP/1.1 <status>\r\nNombre: valor..."
+// (formato que espera parseHttpDateToEpochUTC en time.cpp)
+static void rawHeader(void *ctx, const char *name, const char *value)
+{
+  String &h = *static_cast<RawCtx *>(ctx)->headers;
+  h += "\r\n";
+  h += name;
+  h += ": ";
+  h += value;
+}
+
+static bool rawRequest(const char *method, const char *host, uint16_t port, const char *path,
+                       const char *contentType, const String *payload,
+                       String &headersOut, String &bodyOut)
+{
+  headersOut = "";
+  bodyOut = "";
+  if (!transportReady())
+    return false;
+
+  WiFiClient wc;
+  EthernetClient ec;
+  Client &client = (conexionRed == 0) ? (Client &)wc : (Client &)ec;
+
+  if (!client.connect(host, port))
   {
-    log_line_both("[HTTP][ERR] connect %s:%u FAILED", host.c_str(), port);
+    log_line_both("[HTTP][RAW] connect %s:%u FAILED", host, port);
     return false;
   }
 
-  // 3. Enviar HTTP Request
-  client->print("POST ");
-  client->print(path);
-  client->println(" HTTP/1.1");
-  client->print("Host: ");
-  client->print(host);
-  if (port != 80)
+  RawCtx ctx = {{&bodyOut, HTTP_MAX_BYTES}, &headersOut};
+  HttpRespParser p;
+  httpParserInitSink(p, rawBody, &ctx);
+  p.onHeader = rawHeader;
+
+  bool ok = sendRequest(client, method, host, port, path, contentType,
+                        payload ? payload->c_str() : nullptr, payload ? payload->length() : 0, false) &&
+            readResponse(client, p, HTTP_READ_TIMEOUT_MS);
+  client.stop();
+
+  if (p.status > 0)
   {
-    client->print(':');
-    client->print(port);
+    char st[24];
+    snprintf(st, sizeof(st), "HTTP/1.1 %d", p.status);
+    headersOut = String(st) + headersOut;
   }
-  client->println();
-  client->println("Content-Type: application/json");
-  client->println("Connection: close");
-  client->print("Content-Length: ");
-  client->println(payload.length());
-  client->println();
-  client->print(payload);
+  return ok;
+}
+
+bool httpGetRaw(const char *host, uint16_t port, const char *path,
+                String &headersOut, String &bodyOut)
+{
+  return rawRequest("GET", host, port, path, nullptr, nullptr, headersOut, bodyOut);
+}
+
+bool httpPostRaw(const char *host, uint16_t port, const char *path,
+                 const String &payloadJSON,
+                 String &outHeaders, String &outBody)
+{
+  return rawRequest("POST", host, port, path, "application/json", &payloadJSON, outHeaders, outBody);
+}
 
-  dumpJsonFieldsFromString("OUT", payload);
+// ====================== API ALTO NIVEL =========================
+// Cada tipo de petición sabe cómo serializarse, a qué endpoint va y qué hacer
+// con la respuesta. Lo comparten las llamadas bloqueantes y el motor asíncrono.
+
+static void logRespuesta(const char *tag)
+{
+  const size_t n = (g_respLen > HTTP_LOG_MAX_CHARS) ? HTTP_LOG_MAX_CHARS : g_respLen;
+  logbuf_pushf("[API][%s][IN] Payload: %.*s%s", tag, (int)n, g_respBuf,
+               (n < g_respLen) ? "...(truncado)" : "");
+}
 
-  // 4. Leer Status Line
-  String line;
-  if (!readLine(*client, line, HTTP_TIMEOUT_MS))
+static const char *tagPeticion(HttpReqKind kind)
+{
+  switch (kind)
   {
-    client->stop();
-    log_line_both("[HTTP][ERR] Timeout status line");
-    return false;
+  case REQ_INICIO:
+    return "INICIO";
+  case REQ_ESTADO:
+    return "STATUS";
+  case REQ_TICKET:
+    return "QR";
+  case REQ_PASO:
+    return "PASS";
+  case REQ_ENTRADAS:
+    return "ENTRIES";
+  case REQ_PENDIENTES:
+    return "PENDING";
+  default:
+    return "FAIL";
   }
+}
+
+static String g_pendBloque; // cuerpo de REQ_PENDIENTES hasta que se encola
 
-  int sp1 = line.indexOf(' ');
-  int sp2 = (sp1 >= 0) ? line.indexOf(' ', sp1 + 1) : -1;
-  int status = (sp2 > sp1) ? line.substring(sp1 + 1, sp2).toInt() : 0;
+static bool esTextoPlano(HttpReqKind kind)
+{
+  return kind == REQ_PENDIENTES;
+}
 
-  // 5. Leer Headers
-  bool chunked = false;
-  size_t contentLen = 0;
-  while (readLine(*client, line, HTTP_TIMEOUT_MS) && line.length() > 0)
+// Serializa el payload del tipo indicado y devuelve el endpoint
+static const String &prepararPeticion(HttpReqKind kind, const char *&path)
+{
+  const String *payload;
+  switch (kind)
   {
-    line.toLowerCase();
-    if (line.startsWith("transfer-encoding:") && line.indexOf("chunked") >= 0)
-      chunked = true;
-    else if (line.startsWith("content-length:"))
-    {
-      contentLen = line.substring(line.indexOf(':') + 1).toInt();
-    }
+  case REQ_INICIO:
+    serializaInicio();
+    path = "/inicio";
+    payload = &outputInicio;
+    break;
+  case REQ_ESTADO:
+    serializaEstado();
+    path = "/status";
+    payload = &outputEstado;
+    break;
+  case REQ_TICKET:
+    serializaQR();
+    path = "/validateQR";
+    payload = &outputTicket;
+    break;
+  case REQ_PASO:
+    serializaPaso();
+    path = "/validatePass";
+    payload = &outputPaso;
+    break;
+  case REQ_ENTRADAS:
+    serializaEstado();
+    path = "/entries";
+    payload = &outputEstado;
+    break;
+  case REQ_PENDIENTES:
+    path = "/entries/pending";
+    payload = &g_pendBloque;
+    break;
+  default:
+    serializaReportFailure();
+    path = "/reportFailure";
+    payload = &outputReportFailure;
+    break;
   }
+  logbuf_pushf("[API][%s][OUT] Payload: %s", tagPeticion(kind), truncateForLog(*payload, HTTP_LOG_MAX_CHARS).c_str());
+  return *payload;
+}
+
+// Aplica la respuesta (ya en g_respBuf) o el fallo de la petición
+static void finalizarPeticion(HttpReqKind kind, bool ok)
+{
+  if (kind == REQ_ENTRADAS || kind == REQ_PENDIENTES)
+    return; // texto plano: 'done' decide
 
-  // 6. Leer Body con Buffer
-  if (contentLen > 0)
-    response.reserve(contentLen + 1);
-  const size_t BUF_SIZE = 128;
-  uint8_t buff[BUF_SIZE];
+  if (ok)
+    logRespuesta(tagPeticion(kind));
 
-  if (chunked)
+  switch (kind)
   {
-    while (true)
+  case REQ_INICIO:
+    if (ok)
+      descifraEstado(g_respBuf, g_respLen);
+    else
+      log_line_both("[API][ERR] getInicio FAIL");
+    iniciOk = ok;
+    break;
+
+  case REQ_ESTADO:
+    if (ok)
+      descifraEstado(g_respBuf, g_respLen);
+    else
+      log_line_both("[API][ERR] getEstado FAIL");
+    break;
+
+  case REQ_TICKET:
+    if (ok)
+      descifraQR(g_respBuf, g_respLen);
+    else
     {
-      String szLine;
-      if (!readLine(*client, szLine, HTTP_TIMEOUT_MS))
-        break;
-      long chunkSize = strtol(szLine.c_str(), NULL, 16);
-      if (chunkSize == 0)
-        break;
-
-      while (chunkSize > 0)
-      {
-        size_t toRead = min((size_t)chunkSize, BUF_SIZE);
-        int n = client->read(buff, toRead);
-        if (n > 0)
-        {
-          for (int i = 0; i < n; i++)
-            response += (char)buff[i];
-          chunkSize -= n;
-        }
-      }
-      readLine(*client, szLine, HTTP_TIMEOUT_MS); // Consumir CRLF
+      log_line_both("[API][ERR] postTicket FAIL");
+      g_validateOutcome = VERROR;
+      resetCycleReady();
     }
+    break;
+
+  case REQ_PASO:
+    if (ok)
+      descifraPaso(g_respBuf, g_respLen);
+    else
+      resetCycleReady();
+    break;
+
+  case REQ_FAILURE:
+    if (ok)
+      descifraEstado(g_respBuf, g_respLen);
+    break;
+
+  case REQ_ENTRADAS:
+  case REQ_PENDIENTES:
+    break;
   }
+}
+
+static void peticionBloqueante(HttpReqKind kind)
+{
+  const char *path;
+  const String &payload = prepararPeticion(kind, path);
+  finalizarPeticion(kind, postJSON(serverURL + path, payload));
+}
+
+void getInicio() { peticionBloqueante(REQ_INICIO); }
+void getEstado() { peticionBloqueante(REQ_ESTADO); }
+void postTicket() { peticionBloqueante(REQ_TICKET); }
+void postPaso() { peticionBloqueante(REQ_PASO); }
+void reportFailure() { peticionBloqueante(REQ_FAILURE); }
+
+// ====================== MOTOR ASÍNCRONO =========================
+// Cola circular acotada; solo la cabeza está en vuelo (una conexión por
+// transporte y sin pipelining). httpPoll() la avanza sin esperar:
+//   AS_IDLE → AS_CONNECT → AS_SEND → AS_RECV → (finalizar y siguiente)
+// El plazo cuenta desde que se encola, así una petición que espera detrás de
+// otra lenta también vence a tiempo.
+
+enum AsyncState : uint8_t
+{
+  AS_IDLE = 0,
+  AS_CONNECT,
+  AS_SEND,
+  AS_RECV
+};
+
+struct AsyncReq
+{
+  HttpReqKind kind;
+  HttpDoneCb done;
+  HttpBodyCb onBody; // nullptr → cuerpo a g_respBuf
+  void *bodyCtx;
+  const char *path;
+  String payload; // copia: los output* globales se reescriben en la siguiente serialización
+  uint32_t submitMs;
+  uint32_t deadlineMs;
+};
+
+struct AsyncActive
+{
+  AsyncState state = AS_IDLE;
+  Client *client = nullptr;
+  bool reused = false;
+  bool reintentado = false;
+  String host;
+  String path;
+  uint16_t port = 0;
+  HttpRespParser p;
+};
+
+static AsyncReq g_aq[HTTP_ASYNC_QUEUE_LEN];
+static uint8_t g_aqHead = 0;
+static uint8_t g_aqCount = 0;
+static AsyncActive g_act;
+static HttpAsyncStats g_asyncStats = {0, 0, 0, 0, 0, 0};
+
+static inline AsyncReq &asyncAt(uint8_t i)
+{
+  return g_aq[(g_aqHead + i) % HTTP_ASYNC_QUEUE_LEN];
+}
+
+// Saca la i-ésima de la cola (0 = cabeza) y avisa a quien la pidió
+static void asyncFinish(uint8_t i, bool ok, bool vencida)
+{
+  AsyncReq &r = asyncAt(i);
+  const uint32_t lat = millis() - r.submitMs;
+  if (lat > g_asyncStats.maxLatencyMs)
+    g_asyncStats.maxLatencyMs = lat;
+  if (vencida)
+    g_asyncStats.timedOut++;
+  else if (ok)
+    g_asyncStats.completed++;
   else
+    g_asyncStats.failed++;
+
+  const HttpReqKind kind = r.kind;
+  const HttpDoneCb done = r.done;
+  if (i == 0)
   {
-    uint32_t tStart = millis();
-    while ((client->connected() || client->available()) && (millis() - tStart < HTTP_TIMEOUT_MS))
-    {
-      if (client->available())
-      {
-        int n = client->read(buff, BUF_SIZE);
-        if (n > 0)
-        {
-          for (int i = 0; i < n; i++)
-            response += (char)buff[i];
-          if (contentLen > 0 && response.length() >= contentLen)
-            break;
-        }
-      }
-      else
-        delay(1);
-    }
+    r.payload = "";
+    g_aqHead = (g_aqHead + 1) % HTTP_ASYNC_QUEUE_LEN;
   }
+  else
+  {
+    // Las de detrás avanzan un puesto para no romper el orden de llegada
+    for (uint8_t j = i; j + 1 < g_aqCount; j++)
+      asyncAt(j) = std::move(asyncAt(j + 1));
+    asyncAt(g_aqCount - 1).payload = "";
+  }
+  g_aqCount--;
 
-  client->stop();
-  dumpJsonFieldsFromString("IN", response);
-  return (status >= 200 && status < 300);
+  finalizarPeticion(kind, ok);
+  if (done)
+    done(kind, ok);
 }
 
-// POST text/plain → devuelve body en 'response', true si 2xx
-static bool postPlain(const String &url, const String &payload, String &response)
+// Termina la que está en vuelo
+static void asyncComplete(bool ok, bool vencida)
 {
-  response.clear();
+  g_act.state = AS_IDLE;
+  g_act.client = nullptr;
+  asyncFinish(0, ok, vencida);
+}
 
-  if (Ethernet.localIP() == IPAddress(0, 0, 0, 0))
+// Las que esperan detrás de la activa vencen a su hora aunque esta tarde: no
+// se han enviado, así que basta con sacarlas de la cola
+static void asyncExpireQueued()
+{
+  const uint32_t now = millis();
+  for (uint8_t i = 1; i < g_aqCount;)
   {
-    if (debugSerie)
-      Serial.println(F("[HTTP] Ethernet sin IP."));
-    return false;
+    AsyncReq &r = asyncAt(i);
+    if (now - r.submitMs <= r.deadlineMs)
+    {
+      i++;
+      continue;
+    }
+    log_line_both("[HTTP][ASYNC][ERR] %s vencida en cola (%lu ms)", r.path, (unsigned long)r.deadlineMs);
+    asyncFinish(i, false, true);
   }
-  if (!url.startsWith("http://"))
+}
+
+// Conexión caída antes de terminar: una reconexión si era keep-alive sin respuesta
+static void asyncRetryOrFail()
+{
+  poolRelease(false);
+  if (g_act.reused && !g_act.reintentado && g_act.p.rawBytes == 0)
   {
-    if (debugSerie)
-      Serial.println(F("[HTTP] Solo HTTP (no HTTPS) con W5500."));
-    return false;
+    g_act.reintentado = true;
+    g_poolStats.reconnects++;
+    log_line_both("[HTTP] Conexión keep-alive cerrada por el servidor, reconectando");
+    httpParserReset(g_act.p);
+    g_act.state = AS_CONNECT;
+    return;
   }
+  log_line_both("[HTTP][ASYNC][ERR] %s sin respuesta completa (status %d)", g_act.path.c_str(), g_act.p.status);
+  asyncComplete(false, false);
+}
 
-  String host, path;
-  uint16_t port;
-  if (!parseHttpUrl(url, host, port, path))
+bool httpSubmitStream(HttpReqKind kind, HttpBodyCb onBody, void *ctx,
+                      HttpDoneCb done, uint32_t deadlineMs)
+{
+  if (g_aqCount >= HTTP_ASYNC_QUEUE_LEN)
   {
-    if (debugSerie)
-      Serial.println(F("[HTTP] URL inválida."));
+    g_asyncStats.rejected++;
+    log_line_both("[HTTP][ASYNC][ERR] Cola llena, se descarta %s", tagPeticion(kind));
     return false;
   }
 
-  EthernetClient client;
-  client.setTimeout(HTTP_TIMEOUT_MS);
+  AsyncReq &r = g_aq[(g_aqHead + g_aqCount) % HTTP_ASYNC_QUEUE_LEN];
+  r.kind = kind;
+  r.done = done;
+  r.onBody = onBody;
+  r.bodyCtx = ctx;
+  r.payload = prepararPeticion(kind, r.path);
+  r.submitMs = millis();
+  r.deadlineMs = deadlineMs;
+  g_aqCount++;
+  g_asyncStats.submitted++;
+  return true;
+}
 
-  // --- CONEXIÓN Y LOG ATÓMICO ---
-  bool connected = client.connect(host.c_str(), port);
-  if (debugSerie)
-  {
-    Serial.printf("[HTTP][ETH] Conectando %s:%u ... %s\n", host.c_str(), port, connected ? "OK" : "FALLO");
-  }
-  if (!connected)
-    return false;
+bool httpSubmit(HttpReqKind kind, HttpDoneCb done, uint32_t deadlineMs)
+{
+  return httpSubmitStream(kind, nullptr, nullptr, done, deadlineMs);
+}
 
-  // --- Enviar petición ---
-  client.print(F("POST "));
-  client.print(path);
-  client.println(F(" HTTP/1.1"));
-  client.print(F("Host: "));
-  client.print(host);
-  if (port != 80)
-  {
-    client.print(':');
-    client.print(port);
-  }
-  client.println();
-  client.println(F("Content-Type: text/plain"));
-  client.println(F("Connection: close"));
-  client.print(F("Content-Length: "));
-  client.println(payload.length());
-  client.println();
-  client.print(payload);
-
-  // --- Leer status line ---
-  String line;
-  if (!readLine(client, line, HTTP_TIMEOUT_MS))
-  {
-    client.stop();
-    return false;
+void httpPoll()
+{
+  if (g_aqCount == 0)
+    return;
+
+  asyncExpireQueued();
+  AsyncReq &r = g_aq[g_aqHead];
+
+  if (millis() - r.submitMs > r.deadlineMs)
+  {
+    // Una respuesta a medias deja la conexión inservible
+    if (g_act.state != AS_IDLE)
+      poolRelease(false);
+    log_line_both("[HTTP][ASYNC][ERR] %s vencida (%lu ms)", r.path, (unsigned long)r.deadlineMs);
+    asyncComplete(false, true);
+    return;
   }
-  int sp1 = line.indexOf(' '), sp2 = (sp1 >= 0) ? line.indexOf(' ', sp1 + 1) : -1;
-  int status = (sp2 > sp1) ? line.substring(sp1 + 1, sp2).toInt() : 0;
 
-  // --- Headers/body ---
-  bool chunked = false;
-  size_t contentLen = 0;
-  while (readLine(client, line, HTTP_TIMEOUT_MS))
+  if (g_act.state == AS_IDLE)
   {
-    if (line.length() == 0)
-      break;
-    String l = line;
-    l.toLowerCase();
-    if (l.startsWith(F("transfer-encoding:")) && l.indexOf(F("chunked")) >= 0)
-      chunked = true;
-    else if (l.startsWith(F("content-length:")))
+    if (!transportReady() || !parseHttpUrl(serverURL + r.path, g_act.host, g_act.port, g_act.path))
     {
-      int colon = line.indexOf(':');
-      if (colon >= 0)
-        contentLen = line.substring(colon + 1).toInt();
+      asyncComplete(false, false);
+      return;
     }
+    if (r.onBody)
+      httpParserInitSink(g_act.p, r.onBody, r.bodyCtx);
+    else
+      httpParserInit(g_act.p, g_respBuf, sizeof(g_respBuf));
+    g_respLen = 0;
+    g_act.reintentado = false;
+    g_act.state = AS_CONNECT;
   }
 
-  response.reserve(contentLen ? contentLen : 128);
-  if (chunked)
+  if (g_act.state == AS_CONNECT)
   {
-    for (;;)
+    g_act.client = poolAcquire(g_act.host, g_act.port, g_act.reused);
+    if (!g_act.client)
     {
-      String sz;
-      if (!readLine(client, sz, HTTP_TIMEOUT_MS))
-      {
-        client.stop();
-        return false;
-      }
-      sz.trim();
-      if (sz.length() == 0)
-      {
-        if (!readLine(client, sz, HTTP_TIMEOUT_MS))
-        {
-          client.stop();
-          return false;
-        }
-        sz.trim();
-      }
-      unsigned long n = strtoul(sz.c_str(), nullptr, 16);
-      if (n == 0)
-      {
-        readLine(client, line, HTTP_TIMEOUT_MS);
-        break;
-      }
-      uint32_t t0 = millis();
-      while (n > 0 && millis() - t0 < HTTP_TIMEOUT_MS)
-      {
-        while (client.available() && n > 0)
-        {
-          response += (char)client.read();
-          n--;
-        }
-        if (n == 0)
-          break;
-        delay(1);
-      }
-      readLine(client, line, HTTP_TIMEOUT_MS);
+      log_line_both("[HTTP][ERR] connect %s:%u FAILED", g_act.host.c_str(), g_act.port);
+      asyncComplete(false, false);
+      return;
     }
+    log_line_both("[HTTP][%s] POST %s%s (async)", (conexionRed == 0 ? "WiFi" : "ETH"), g_act.path.c_str(),
+                  g_act.reused ? " (keep-alive)" : "");
+    g_act.state = AS_SEND;
   }
-  else if (contentLen > 0)
+
+  if (g_act.state == AS_SEND)
   {
-    size_t rem = contentLen;
-    uint32_t t0 = millis();
-    while (rem > 0 && millis() - t0 < HTTP_TIMEOUT_MS)
+    const bool texto = esTextoPlano(r.kind);
+    if (!sendRequest(*g_act.client, "POST", g_act.host.c_str(), g_act.port, g_act.path.c_str(),
+                     texto ? "text/plain" : "application/json", r.payload.c_str(), r.payload.length(), true))
     {
-      while (client.available() && rem > 0)
-      {
-        response += (char)client.read();
-        rem--;
-      }
-      if (rem == 0)
-        break;
-      delay(1);
+      asyncRetryOrFail();
+      return;
     }
+    if (!texto)
+      dumpJsonFields("OUT", r.payload.c_str(), r.payload.length());
+    g_act.state = AS_RECV;
+    return; // la respuesta llegará en las próximas vueltas
   }
-  else
+
+  // AS_RECV: solo lo que ya está en el socket, como mucho unos pocos bloques
+  // por vuelta (más si es una descarga por trozos, para no eternizarla)
+  Client &c = *g_act.client;
+  HttpRespParser &p = g_act.p;
+  uint8_t blk[256];
+  const int maxBloques = p.onBody ? 32 : 4;
+  for (int i = 0; i < maxBloques && !httpParserDone(p) && !httpParserFailed(p); i++)
   {
-    while (client.connected() || client.available())
-    {
-      while (client.available())
-        response += (char)client.read();
-      delay(1);
-    }
+    int avail = c.available();
+    if (avail <= 0)
+      break;
+    int n = c.read(blk, min((size_t)avail, sizeof(blk)));
+    if (n <= 0)
+      break;
+    httpParserFeed(p, blk, (size_t)n);
   }
 
-  client.stop();
+  if (!httpParserDone(p) && !httpParserFailed(p) && !c.connected() && !c.available())
+    httpParserFinish(p);
 
-  // --- IMPRESIÓN ATÓMICA DE RESPUESTA ---
-  if (debugSerie)
+  if (httpParserDone(p))
   {
-    Serial.printf("[HTTP][ETH][POST-PLAIN] Respuesta:\n%s\n", response.c_str());
+    poolRelease(p.keepAlive);
+    const bool texto = p.onBody || esTextoPlano(g_aq[g_aqHead].kind);
+    asyncComplete(texto ? (p.status >= 200 && p.status < 300) : cerrarRespuestaJSON(p), false);
   }
-  return (status >= 200 && status < 300);
+  else if (httpParserFailed(p))
+    asyncRetryOrFail();
 }
 
-// ====================== API ALTO NIVEL =========================
+// Una llamada bloqueante necesita la conexión: deja terminar la petición en vuelo
+static void asyncWaitActive()
+{
+  while (g_aqCount > 0 && g_act.state != AS_IDLE)
+  {
+    httpPoll();
+    delay(1);
+  }
+}
+
+bool httpPending(HttpReqKind kind)
+{
+  for (uint8_t i = 0; i < g_aqCount; i++)
+    if (g_aq[(g_aqHead + i) % HTTP_ASYNC_QUEUE_LEN].kind == kind)
+      return true;
+  return false;
+}
+
+bool httpIdle()
+{
+  return g_aqCount == 0;
+}
+
+HttpAsyncStats httpAsyncStats()
+{
+  return g_asyncStats;
+}
+
+// ================== ENTRADAS (texto plano) y PENDIENTES ======================
+
+bool getEntradas(String &outTexto)
+{
+  serializaEstado();
+  logbuf_pushf("[API][ENTRIES][OUT] Payload: %s", truncateForLog(outputEstado, HTTP_LOG_MAX_CHARS).c_str());
+  const String url = serverURL + "/entries";
+
+  // El listado puede superar g_respBuf: el cuerpo se vuelca por trozos a outTexto
+  outTexto = "";
+  StringSink sink = {&outTexto, 0};
+  HttpRespParser p;
+  httpParserInitSink(p, appendToString, &sink);
+
+  if (!httpPost(url, "application/json", outputEstado, p))
+    return false;
+  return (p.status >= 200 && p.status < 300);
+}
+
+// El bloque se copia a la cola al encolarlo: g_pendBloque solo dura la llamada
+bool postPendientesBloque(const String &contenido, HttpDoneCb done)
+{
+  g_pendBloque = contenido;
+  const bool ok = httpSubmit(REQ_PENDIENTES, done);
+  g_pendBloque = String();
+  return ok;
+}
+
+// ====================== ESTADO RED =========================
 
-void getInicio()
+bool linkUp()
+{
+  if (conexionRed == 0)
+    return WiFi.status() == WL_CONNECTED;
+  return Ethernet.linkStatus() == LinkON;
+}
+
+bool netOk()
+{
+  if (conexionRed == 0)
+    return (WiFi.status() == WL_CONNECTED) && (WiFi.localIP() != IPAddress(0, 0, 0, 0));
+  return (Ethernet.linkStatus() == LinkON) && (Ethernet.localIP() != IPAddress(0, 0, 0, 0));
+}
+// =============================== OTA por HTTP ================================
+// Conexión propia (no la del pool: el backend sigue atendiendo validaciones
+// durante la descarga). El cuerpo pasa por g_otaIn al decodificador, que
+// escribe en la partición inactiva con fw_update. Se lee del socket solo
+// con g_otaIn vacío, así el cuerpo de una lectura siempre cabe.
+
+enum OtaPhase : uint8_t
 {
-  serializaInicio();
-  logbuf_pushf("[API][INICIO][OUT] Payload: %s", truncateForLog(outputInicio, HTTP_LOG_MAX_CHARS).c_str());
+  OTA_IDLE = 0,
+  OTA_WAIT,  // esperando para (re)conectar
+  OTA_RECV,  // recibiendo y decodificando
+  OTA_REBOOT // imagen instalada: reinicio en cuanto el torno esté en reposo
+};
 
-  String resp;
-  if (postJSON(serverURL + "/inicio", outputInicio, resp))
+struct OtaJob
+{
+  OtaPhase phase;
+  String host;
+  String path;
+  uint16_t port;
+  bool delta;         // se acepta imagen diferencial
+  bool baseMal;       // el diferencial era contra otra imagen
+  bool respOk;        // respuesta de esta conexión aceptada
+  bool hasRange;      // llegó Content-Range
+  uint32_t rangeFrom; // inicio de Content-Range
+  uint32_t total;     // tamaño del fichero completo
+  uint32_t size;      // tamaño de la imagen destino (cabecera o Content-Length)
+  uint32_t skip;      // bytes a descartar (el servidor no respetó Range)
+  uint32_t retryAt;
+  uint32_t lastDataMs;
+  uint32_t connIn;    // bytes decodificados al conectar (para ver si hubo avance)
+  uint8_t fails;      // cortes seguidos sin avance
+  char etag[64];      // de la primera respuesta (If-Range al reanudar)
+  char respEtag[64];
+  char sha[65];       // SHA-256 de la imagen destino (contenedor)
+};
+
+static OtaJob g_ota = {};
+static OtaDecoder g_otaDec;
+static HttpRespParser g_otaResp;
+static WiFiClient g_otaWifi;
+static EthernetClient g_otaEth;
+static uint8_t g_otaRaw[1024]; // lectura del socket
+static uint8_t g_otaIn[1024];  // cuerpo pendiente de decodificar
+static size_t g_otaInLen = 0;
+static size_t g_otaInPos = 0;
+static OtaStats g_otaStats = {};
+static char g_otaErr[48] = "";
+
+// Franja asignada por el backend (otaProgramar)
+static bool g_slotPend = false;    // programada y aún sin empezar
+static uint32_t g_slotAt = 0;      // millis() de apertura
+static uint32_t g_slotFin = 0;     // millis() de cierre
+static bool g_slotPerdido = false; // la última pasó sin poder empezar
+
+static Client &otaClient()
+{
+  return (conexionRed == 0) ? (Client &)g_otaWifi : (Client &)g_otaEth;
+}
+
+// ---- Decodificador → partición OTA ----
+
+static bool otaImagenCabecera(void *, const OtaImageInfo &info)
+{
+  if (info.kind == OTA_DELTA)
   {
-    estadoRecibido = resp;
-    logbuf_pushf("[API][INICIO][IN] Payload: %s", truncateForLog(estadoRecibido, HTTP_LOG_MAX_CHARS).c_str());
-    descifraEstado();
-    iniciOk = true;
+    // Lee y resume la imagen base una vez (unos cientos de ms)
+    uint8_t sha[32];
+    if (!g_ota.delta || !fwRunningSha256(info.baseSize, sha) ||
+        memcmp(sha, info.baseSha, sizeof(sha)) != 0)
+    {
+      g_ota.baseMal = true;
+      return false;
+    }
   }
-  else
+
+  if (!fwUpdateBegin(info.kind == OTA_RAW ? g_ota.total : info.targetSize))
+  {
+    log_line_both("[OTA][ERR] Update.begin: %s", fwUpdateError());
+    return false;
+  }
+
+  g_ota.size = (info.kind == OTA_RAW) ? g_ota.total : info.targetSize;
+  g_ota.sha[0] = '\0';
+  if (info.kind != OTA_RAW)
   {
-    log_line_both("[API][ERR] getInicio FAIL");
-    iniciOk = false;
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    for (size_t i = 0; i < sizeof(info.targetSha); i++)
+    {
+      g_ota.sha[2 * i] = HEX_DIGITS[info.targetSha[i] >> 4];
+      g_ota.sha[2 * i + 1] = HEX_DIGITS[info.targetSha[i] & 0x0F];
+    }
+    g_ota.sha[64] = '\0';
   }
+  g_otaStats.kind = info.kind;
+  log_line_both("[OTA] Imagen %s de %lu bytes", info.kind == OTA_DELTA ? "diferencial" : (info.kind == OTA_LZ ? "comprimida" : "completa"),
+                (unsigned long)(info.kind == OTA_RAW ? g_ota.total : info.targetSize));
+  return true;
 }
 
-void getEstado()
+static bool otaImagenDatos(void *, const uint8_t *data, size_t len)
 {
-  serializaEstado();
-  logbuf_pushf("[API][STATUS][OUT] Payload: %s", truncateForLog(outputEstado, HTTP_LOG_MAX_CHARS).c_str());
+  return fwUpdateWrite(data, len);
+}
+
+static bool otaImagenBase(void *, uint32_t offset, uint8_t *buf, size_t len)
+{
+  return fwRunningRead(offset, buf, len);
+}
 
-  String resp;
-  if (postJSON(serverURL + "/status", outputEstado, resp))
+// ---- Respuesta HTTP ----
+
+static void otaRespHeader(void *, const char *name, const char *value)
+{
+  if (strcasecmp(name, "ETag") == 0)
+    strlcpy(g_ota.respEtag, value, sizeof(g_ota.respEtag));
+  else if (strcasecmp(name, "Content-Range") == 0)
   {
-    estadoRecibido = resp;
-    logbuf_pushf("[API][STATUS][IN] Payload: %s", truncateForLog(estadoRecibido, HTTP_LOG_MAX_CHARS).c_str());
+    // "bytes <desde>-<hasta>/<total>"
+    const char *sp = strchr(value, ' ');
+    const char *barra = strchr(value, '/');
+    g_ota.rangeFrom = sp ? strtoul(sp + 1, nullptr, 10) : 0;
+    if (barra)
+      g_ota.total = strtoul(barra + 1, nullptr, 10);
+    g_ota.hasRange = true;
+  }
+}
 
-    descifraEstado();
+// Cabeceras completas: ¿continúa esta respuesta la descarga? (una vez por conexión)
+static bool otaRespuestaValida()
+{
+  if (g_ota.respOk)
+    return true;
+
+  const HttpRespParser &p = g_otaResp;
+  const uint32_t desde = g_otaDec.inBytes;
+  if (p.status == 206 && g_ota.hasRange && g_ota.rangeFrom == desde)
+    g_ota.respOk = true;
+  else if (p.status == 200 && desde > 0 && strcmp(g_ota.etag, g_ota.respEtag) == 0)
+  {
+    // El servidor ignoró Range (mismo fichero): se descarta lo ya decodificado
+    g_ota.skip = desde;
+    g_ota.respOk = true;
   }
-  else
+  else if (p.status == 200)
   {
-    log_line_both("[API][ERR] getEstado FAIL");
+    // Primera respuesta, o el fichero cambió (If-Range): desde cero
+    if (desde > 0)
+    {
+      log_line_both("[OTA] La imagen del servidor cambió: se empieza de nuevo");
+      fwUpdateAbort();
+      otaDecInit(g_otaDec, otaImagenCabecera, otaImagenDatos, otaImagenBase, nullptr);
+    }
+    g_ota.total = p.hasLength ? p.contentLength : 0;
+    strlcpy(g_ota.etag, g_ota.respEtag, sizeof(g_ota.etag));
+    g_ota.respOk = true;
   }
+  return g_ota.respOk;
 }
 
-void postTicket()
+static bool otaRespBody(void *, const uint8_t *data, size_t len)
 {
-  serializaQR();
-  logbuf_pushf("[API][QR][OUT] Payload: %s", truncateForLog(outputTicket, HTTP_LOG_MAX_CHARS).c_str());
+  if (!otaRespuestaValida())
+    return false;
+  g_otaStats.wireBytes += len;
+  if (g_ota.skip)
+  {
+    const size_t n = (g_ota.skip < len) ? g_ota.skip : len;
+    g_ota.skip -= n;
+    data += n;
+    len -= n;
+  }
+  if (g_otaInLen + len > sizeof(g_otaIn))
+    return false;
+  memcpy(g_otaIn + g_otaInLen, data, len);
+  g_otaInLen += len;
+  return true;
+}
+
+// ---- Ciclo de la descarga ----
 
-  String resp;
-  if (postJSON(serverURL + "/validateQR", outputTicket, resp))
+static void otaFin(const char *motivo)
+{
+  otaClient().stop();
+  fwUpdateAbort();
+  strlcpy(g_otaErr, motivo, sizeof(g_otaErr));
+  g_otaStats.failures++;
+  g_otaStats.lastFailMs = millis();
+  g_ota.phase = OTA_IDLE;
+  log_line_both("[OTA][ERR] Descarga abandonada: %s", motivo);
+}
+
+static void otaEmpezar(bool delta)
+{
+  fwUpdateAbort();
+  otaDecInit(g_otaDec, otaImagenCabecera, otaImagenDatos, otaImagenBase, nullptr);
+  g_ota.delta = delta;
+  g_ota.baseMal = false;
+  g_ota.total = 0;
+  g_ota.size = 0;
+  g_ota.fails = 0;
+  g_ota.etag[0] = '\0';
+  g_ota.sha[0] = '\0';
+  g_ota.retryAt = millis();
+  g_ota.phase = OTA_WAIT;
+}
+
+// Conexión perdida o respuesta inservible: se reanuda más tarde
+static void otaCorte(const char *motivo)
+{
+  otaClient().stop();
+  if (g_otaDec.inBytes > g_ota.connIn)
+    g_ota.fails = 0;
+  if (++g_ota.fails > OTA_MAX_RETRIES)
   {
-    ticketRecibido = resp;
-    logbuf_pushf("[API][QR][IN] Payload: %s", truncateForLog(ticketRecibido, HTTP_LOG_MAX_CHARS).c_str());
-    descifraQR();
+    otaFin(motivo);
+    return;
+  }
+  log_line_both("[OTA] %s: se reanuda desde el byte %lu", motivo, (unsigned long)g_otaDec.inBytes);
+  g_ota.retryAt = millis() + OTA_RETRY_MS;
+  g_ota.phase = OTA_WAIT;
+}
+
+static void otaConectar()
+{
+  if (!transportReady())
+  {
+    otaCorte("sin red");
+    return;
   }
+
+  bool conectado;
+  if (conexionRed == 0)
+    conectado = g_otaWifi.connect(g_ota.host.c_str(), g_ota.port, HTTP_CONNECT_TIMEOUT_MS);
   else
   {
-    log_line_both("[API][ERR] postTicket FAIL");
-    g_validateOutcome = VERROR;
-    resetCycleReady();
+    g_otaEth.setConnectionTimeout(HTTP_CONNECT_TIMEOUT_MS);
+    conectado = g_otaEth.connect(g_ota.host.c_str(), g_ota.port);
   }
+  if (!conectado)
+  {
+    otaCorte("connect");
+    return;
+  }
+  g_otaStats.connects++;
+
+  const uint32_t desde = g_otaDec.inBytes;
+  char extra[256];
+  int n = snprintf(extra, sizeof(extra), "X-Firmware-Version: %s\r\nX-Firmware-Accept: %s\r\n",
+                   enVersion.c_str(), g_ota.delta ? "delta, lz, bin" : "lz, bin");
+  if (desde > 0 && n > 0 && (size_t)n < sizeof(extra))
+  {
+    n += snprintf(extra + n, sizeof(extra) - n, "Range: bytes=%lu-\r\n", (unsigned long)desde);
+    if (g_ota.etag[0] && n > 0 && (size_t)n < sizeof(extra))
+      snprintf(extra + n, sizeof(extra) - n, "If-Range: %s\r\n", g_ota.etag);
+    g_otaStats.resumes++;
+  }
+
+  httpParserInitSink(g_otaResp, otaRespBody, nullptr);
+  g_otaResp.onHeader = otaRespHeader;
+  g_ota.respOk = false;
+  g_ota.hasRange = false;
+  g_ota.rangeFrom = 0;
+  g_ota.skip = 0;
+  g_ota.respEtag[0] = '\0';
+  g_ota.connIn = desde;
+  g_otaInLen = g_otaInPos = 0;
+
+  if (!sendRequest(otaClient(), "GET", g_ota.host.c_str(), g_ota.port, g_ota.path.c_str(),
+                   nullptr, nullptr, 0, false, extra))
+  {
+    otaCorte("envío");
+    return;
+  }
+  g_ota.lastDataMs = millis();
+  g_ota.phase = OTA_RECV;
 }
 
-void postPaso()
+static void otaCompletar()
 {
-  serializaPaso();
-  logbuf_pushf("[API][PASS][OUT] Payload: %s", truncateForLog(outputPaso, HTTP_LOG_MAX_CHARS).c_str());
+  otaClient().stop();
+  if (!fwUpdateEnd(g_ota.sha))
+  {
+    otaFin(fwUpdateError());
+    return;
+  }
+  g_otaErr[0] = '\0';
+  log_line_both("[OTA] Imagen instalada: %lu bytes recibidos, %lu escritos (%lu de la imagen actual)",
+                (unsigned long)g_otaStats.wireBytes, (unsigned long)g_otaDec.outBytes,
+                (unsigned long)g_otaDec.baseBytes);
+  g_ota.phase = OTA_REBOOT;
+}
 
-  String resp;
-  if (postJSON(serverURL + "/validatePass", outputPaso, resp))
+// Respuesta descartada por el status (o cortada antes de las cabeceras)
+static void otaRespuestaMala()
+{
+  const int st = g_otaResp.status;
+  if (st >= 400 && st < 500)
   {
-    pasoRecibido = resp;
-    logbuf_pushf("[API][PASS][IN] Payload: %s", truncateForLog(pasoRecibido, HTTP_LOG_MAX_CHARS).c_str());
-    descifraPaso();
+    char m[24];
+    snprintf(m, sizeof(m), "HTTP %d", st);
+    otaFin(m);
   }
   else
-    resetCycleReady();
+    otaCorte(st ? "status inesperado" : "respuesta inválida");
 }
 
-void reportFailure()
+void actualiza()
 {
-  serializaReportFailure();
-  logbuf_pushf("[API][FAIL][OUT] Payload: %s", truncateForLog(outputReportFailure, HTTP_LOG_MAX_CHARS).c_str());
+  if (g_ota.phase != OTA_IDLE)
+    return;
+  // La franja pendiente (si la había) se consume aunque no llegue a empezar
+  g_slotPend = false;
+  g_slotPerdido = false;
+  if (fwUpdateActive())
+  {
+    log_line_both("[OTA] Hay una subida de firmware en curso");
+    return;
+  }
 
-  String resp;
-  if (postJSON(serverURL + "/reportFailure", outputReportFailure, resp))
+  String url = urlActualiza;
+  url.trim();
+  if (!url.startsWith("http://") || !parseHttpUrl(url, g_ota.host, g_ota.port, g_ota.path))
   {
-    estadoRecibido = resp;
-    logbuf_pushf("[API][FAIL][IN] Payload: %s", truncateForLog(estadoRecibido, HTTP_LOG_MAX_CHARS).c_str());
-    descifraEstado();
+    strlcpy(g_otaErr, "URL no válida (solo http://)", sizeof(g_otaErr));
+    g_otaStats.failures++;
+    g_otaStats.lastFailMs = millis();
+    log_line_both("[OTA][ERR] URL no válida (solo http://): %s", url.c_str());
+    return;
   }
+
+  log_line_both("[OTA] Descarga de %s (versión actual %s)", url.c_str(), enVersion.c_str());
+  g_otaStats.wireBytes = 0;
+  g_otaStats.kind = OTA_RAW;
+  g_otaErr[0] = '\0';
+  otaEmpezar(true);
 }
 
-// ================== ENTRADAS (texto plano) y PENDIENTES ======================
+// Tras abandonar una descarga, el 310 de cada latido no la relanza enseguida
+static bool otaEnEspera()
+{
+  return g_otaStats.failures != 0 && millis() - g_otaStats.lastFailMs <= OTA_FAIL_HOLD_MS;
+}
 
-bool getEntradas(String &outTexto)
+void otaProgramar(uint32_t esperaS, uint32_t ventanaS)
 {
-  serializaEstado();
-  logbuf_pushf("[API][ENTRIES][OUT] Payload: %s", truncateForLog(outputEstado, HTTP_LOG_MAX_CHARS).c_str());
-  const String url = serverURL + "/entries";
+  // Un 310 repetido con la descarga en marcha no la toca
+  if (g_ota.phase != OTA_IDLE || otaEnEspera())
+    return;
+  if (esperaS > OTA_SLOT_MAX_S)
+    esperaS = OTA_SLOT_MAX_S;
+  if (ventanaS == 0)
+    ventanaS = OTA_SLOT_WINDOW_S;
+  if (ventanaS > OTA_SLOT_MAX_S)
+    ventanaS = OTA_SLOT_MAX_S;
+
+  if (!g_slotPend)
+    log_line_both("[OTA] Franja asignada: dentro de %lu s durante %lu s",
+                  (unsigned long)esperaS, (unsigned long)ventanaS);
+  g_slotAt = millis() + esperaS * 1000UL;
+  g_slotFin = g_slotAt + ventanaS * 1000UL;
+  g_slotPend = true;
+  g_slotPerdido = false;
+}
 
-  String resp;
-  bool ok = postJSON(url, outputEstado, resp);
-  if (!ok)
-    return false;
-  outTexto = resp;
-  return true;
+void otaPoll(bool enReposo)
+{
+  // Franja abierta: se empieza en cuanto el torno esté en reposo
+  if (g_slotPend && g_ota.phase == OTA_IDLE && (int32_t)(millis() - g_slotAt) >= 0)
+  {
+    if ((int32_t)(millis() - g_slotFin) > 0)
+    {
+      g_slotPend = false;
+      g_slotPerdido = true;
+      g_otaStats.slotsMissed++;
+      log_line_both("[OTA] Franja perdida: el torno no estuvo en reposo");
+    }
+    else if (enReposo)
+      actualiza();
+  }
+
+  switch (g_ota.phase)
+  {
+  case OTA_IDLE:
+    return;
+  case OTA_REBOOT:
+    if (enReposo && httpIdle())
+    {
+      log_line_both("[OTA] Reiniciando con la imagen nueva");
+      delay(200);
+      ESP.restart();
+    }
+    return;
+  case OTA_WAIT:
+    if (enReposo && (int32_t)(millis() - g_ota.retryAt) >= 0)
+      otaConectar();
+    return;
+  case OTA_RECV:
+    break;
+  }
+
+  // Con paso en curso se deja de leer; si el servidor se cansa, se reanuda
+  if (!enReposo)
+    return;
+
+  Client &c = otaClient();
+  const uint32_t t0 = millis();
+  while (millis() - t0 < OTA_POLL_MS)
+  {
+    // 1) Decodificar lo recibido (o seguir una copia larga)
+    if (g_otaInPos < g_otaInLen || otaDecBusy(g_otaDec))
+    {
+      g_otaInPos += otaDecFeed(g_otaDec, g_otaIn + g_otaInPos, g_otaInLen - g_otaInPos);
+      if (otaDecDone(g_otaDec))
+      {
+        otaCompletar();
+        return;
+      }
+      if (otaDecFailed(g_otaDec))
+      {
+        if (g_ota.baseMal && g_ota.delta)
+        {
+          log_line_both("[OTA] El diferencial no es para esta imagen: se pide la completa");
+          otaClient().stop();
+          otaEmpezar(false);
+        }
+        else
+          otaFin(g_otaDec.error);
+        return;
+      }
+      continue;
+    }
+    g_otaInPos = g_otaInLen = 0;
+
+    // 2) Respuesta terminada: el .bin sin contenedor acaba con ella
+    if (httpParserDone(g_otaResp))
+    {
+      if (!otaRespuestaValida())
+        otaRespuestaMala();
+      else if (g_otaDec.state == OD_RAW)
+        otaCompletar();
+      else
+        otaCorte("imagen incompleta");
+      return;
+    }
+
+    // 3) Más datos del socket
+    const int avail = c.available();
+    if (avail <= 0)
+    {
+      if (!c.connected())
+      {
+        if (httpParserFinish(g_otaResp))
+          continue;
+        otaCorte("conexión cerrada");
+      }
+      else if (millis() - g_ota.lastDataMs > OTA_STALL_MS)
+        otaCorte("sin datos");
+      return;
+    }
+    const int n = c.read(g_otaRaw, min((size_t)avail, sizeof(g_otaRaw)));
+    if (n <= 0)
+      return;
+    g_ota.lastDataMs = millis();
+    httpParserFeed(g_otaResp, g_otaRaw, (size_t)n);
+    if (httpParserFailed(g_otaResp))
+    {
+      if (g_ota.respOk)
+        otaCorte("respuesta inválida");
+      else
+        otaRespuestaMala();
+      return;
+    }
+  }
 }
 
-bool postPendientesBloque(const String &contenido)
+bool otaActive()
 {
-  const String url = serverURL + "/entries/pending";
-  String resp;
-  bool ok = postPlain(url, contenido, resp);
-  return ok;
+  return g_ota.phase != OTA_IDLE;
 }
 
-// ====================== ESTADO RED =========================
+OtaStats otaStats()
+{
+  OtaStats st = g_otaStats;
+  st.imageBytes = g_otaDec.outBytes;
+  st.imageSize = g_ota.size;
+  st.baseBytes = g_otaDec.baseBytes;
+  st.active = otaActive();
+  st.lastError = g_otaErr;
+  return st;
+}
 
-bool linkUp()
+String otaStatsJson()
 {
-  if (conexionRed == 0)
-    return WiFi.status() == WL_CONNECTED;
-  return Ethernet.linkStatus() == LinkON;
+  static const char *const KINDS[] = {"bin", "lz", "delta"};
+  const OtaStats st = otaStats();
+  String json = "{\"active\":" + String(st.active ? "true" : "false");
+  json += ",\"kind\":\"" + String(st.kind <= OTA_DELTA ? KINDS[st.kind] : "?") + "\"";
+  json += ",\"wire\":" + String(st.wireBytes);
+  json += ",\"image\":" + String(st.imageBytes);
+  json += ",\"base\":" + String(st.baseBytes);
+  json += ",\"connects\":" + String(st.connects);
+  json += ",\"resumes\":" + String(st.resumes);
+  json += ",\"failures\":" + String(st.failures);
+  json += ",\"phase\":\"" + String(otaFase()) + "\"";
+  json += ",\"slot_in\":" + String(otaSlotEnS());
+  json += ",\"slots_missed\":" + String(st.slotsMissed);
+  json += ",\"pending_verify\":" + String(fwUpdatePendingVerify() ? "true" : "false");
+  json += ",\"error\":\"" + String(st.lastError) + "\"";
+  json += "}";
+  return json;
 }
 
-bool netOk()
+const char *otaFase()
 {
-  if (conexionRed == 0)
-    return (WiFi.status() == WL_CONNECTED) && (WiFi.localIP() != IPAddress(0, 0, 0, 0));
-  return (Ethernet.linkStatus() == LinkON) && (Ethernet.localIP() != IPAddress(0, 0, 0, 0));
+  switch (g_ota.phase)
+  {
+  case OTA_WAIT:
+  case OTA_RECV:
+    return "download";
+  case OTA_REBOOT:
+    return "reboot";
+  default:
+    break;
+  }
+  if (g_slotPend)
+    return "slot";
+  if (fwUpdatePendingVerify())
+    return "verify";
+  if (g_slotPerdido)
+    return "missed";
+  if (otaEnEspera())
+    return "failed";
+  return "idle";
+}
+
+bool otaDisponible()
+{
+  return g_ota.phase == OTA_IDLE && !g_slotPend && !fwUpdateActive() &&
+         !fwUpdatePendingVerify() && !otaEnEspera();
+}
+
+int32_t otaSlotEnS()
+{
+  if (!g_slotPend)
+    return -1;
+  const int32_t ms = (int32_t)(g_slotAt - millis());
+  return ms > 0 ? (ms + 999) / 1000 : 0;
 }
\ No newline at end of file
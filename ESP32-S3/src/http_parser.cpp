@@ -0,0 +1,321 @@
+#include "http_parser.hpp"
+
+#include <string.h>
+#include <stdlib.h>
+
+// ================== Helpers internos ====================
+
+static inline char lowerAscii(char c)
+{
+  return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static bool equalsNoCase(const char *a, const char *b)
+{
+  while (*a && *b)
+  {
+    if (lowerAscii(*a) != lowerAscii(*b))
+      return false;
+    a++;
+    b++;
+  }
+  return *a == *b;
+}
+
+// ¿'needle' (en minúsculas) aparece en 'hay' ignorando mayúsculas?
+static bool containsNoCase(const char *hay, const char *needle)
+{
+  const size_t n = strlen(needle);
+  for (; *hay; ++hay)
+  {
+    size_t i = 0;
+    while (i < n && hay[i] && lowerAscii(hay[i]) == needle[i])
+      i++;
+    if (i == n)
+      return true;
+  }
+  return false;
+}
+
+static char *trimInPlace(char *s)
+{
+  while (*s == ' ' || *s == '\t')
+    s++;
+  char *e = s + strlen(s);
+  while (e > s && (e[-1] == ' ' || e[-1] == '\t'))
+    *--e = '\0';
+  return s;
+}
+
+static void resetState(HttpRespParser &p)
+{
+  p.status = 0;
+  p.keepAlive = false;
+  p.chunked = false;
+  p.hasLength = false;
+  p.overflow = false;
+  p.contentLength = 0;
+  p.bodyLen = 0;
+  p.rawBytes = 0;
+  p.state = HP_STATUS;
+  p.remaining = 0;
+  p.lineLen = 0;
+  p.line[0] = '\0';
+}
+
+// ================== Entrega del cuerpo ====================
+
+static void emitBody(HttpRespParser &p, const uint8_t *data, size_t n)
+{
+  if (n == 0)
+    return;
+
+  if (p.onBody)
+  {
+    p.bodyLen += n;
+    if (!p.onBody(p.ctx, data, n))
+      p.state = HP_ERROR;
+    return;
+  }
+
+  if (p.buf && p.cap > 0)
+  {
+    const size_t stored = (p.bodyLen < p.cap - 1) ? p.bodyLen : p.cap - 1;
+    size_t room = (p.cap - 1) - stored;
+    size_t copy = (n < room) ? n : room;
+    memcpy(p.buf + stored, data, copy);
+    p.buf[stored + copy] = '\0';
+    if (copy < n)
+      p.overflow = true;
+  }
+  p.bodyLen += n;
+}
+
+// ================== Líneas (status, cabeceras, chunks) ====================
+
+static void endOfHeaders(HttpRespParser &p)
+{
+  // 1xx: viene otra status line detrás (p.ej. "100 Continue")
+  if (p.status >= 100 && p.status < 200)
+  {
+    p.state = HP_STATUS;
+    return;
+  }
+  if (p.status == 204 || p.status == 304)
+  {
+    p.state = HP_DONE;
+    return;
+  }
+  if (p.chunked)
+  {
+    p.state = HP_CHUNK_SIZE;
+    return;
+  }
+  if (p.hasLength)
+  {
+    p.remaining = p.contentLength;
+    p.state = (p.remaining == 0) ? HP_DONE : HP_BODY_LEN;
+    return;
+  }
+  // Sin longitud: el cuerpo termina con el cierre, la conexión no se puede reutilizar
+  p.keepAlive = false;
+  p.state = HP_BODY_EOF;
+}
+
+static void parseHeaderLine(HttpRespParser &p, bool trailer)
+{
+  char *colon = strchr(p.line, ':');
+  if (!colon)
+    return; // cabecera mal formada: se ignora
+
+  *colon = '\0';
+  char *name = trimInPlace(p.line);
+  char *value = trimInPlace(colon + 1);
+
+  if (!trailer)
+  {
+    if (equalsNoCase(name, "content-length"))
+    {
+      p.contentLength = (size_t)strtoul(value, nullptr, 10);
+      p.hasLength = true;
+    }
+    else if (equalsNoCase(name, "transfer-encoding"))
+    {
+      if (containsNoCase(value, "chunked"))
+        p.chunked = true;
+    }
+    else if (equalsNoCase(name, "connection"))
+    {
+      if (containsNoCase(value, "close"))
+        p.keepAlive = false;
+      else if (containsNoCase(value, "keep-alive"))
+        p.keepAlive = true;
+    }
+  }
+
+  if (p.onHeader)
+    p.onHeader(p.ctx, name, value);
+}
+
+static void onLine(HttpRespParser &p)
+{
+  switch (p.state)
+  {
+  case HP_STATUS:
+  {
+    if (p.lineLen == 0)
+      return; // CRLF sobrantes antes de la respuesta
+    if (strncmp(p.line, "HTTP/", 5) != 0)
+    {
+      p.state = HP_ERROR;
+      return;
+    }
+    const char *sp = strchr(p.line, ' ');
+    int st = sp ? atoi(sp + 1) : 0;
+    if (st < 100 || st > 999)
+    {
+      p.state = HP_ERROR;
+      return;
+    }
+    p.status = st;
+    p.keepAlive = (strncmp(p.line + 5, "1.0", 3) != 0);
+    p.chunked = false;
+    p.hasLength = false;
+    p.contentLength = 0;
+    p.state = HP_HEADERS;
+    return;
+  }
+
+  case HP_HEADERS:
+    if (p.lineLen == 0)
+      endOfHeaders(p);
+    else
+      parseHeaderLine(p, false);
+    return;
+
+  case HP_CHUNK_SIZE:
+  {
+    if (p.lineLen == 0)
+      return; // tolerancia: CRLF extra entre chunks
+    char *end = nullptr;
+    unsigned long n = strtoul(p.line, &end, 16);
+    if (end == p.line)
+    {
+      p.state = HP_ERROR;
+      return;
+    }
+    if (n == 0)
+    {
+      p.state = HP_TRAILERS;
+      return;
+    }
+    p.remaining = (size_t)n;
+    p.state = HP_CHUNK_DATA;
+    return;
+  }
+
+  case HP_CHUNK_CRLF:
+    p.state = (p.lineLen == 0) ? HP_CHUNK_SIZE : HP_ERROR;
+    return;
+
+  case HP_TRAILERS:
+    if (p.lineLen == 0)
+      p.state = HP_DONE;
+    else
+      parseHeaderLine(p, true);
+    return;
+
+  default:
+    return;
+  }
+}
+
+// ================== API ====================
+
+void httpParserInit(HttpRespParser &p, char *buf, size_t cap)
+{
+  resetState(p);
+  p.onHeader = nullptr;
+  p.buf = buf;
+  p.cap = cap;
+  p.onBody = nullptr;
+  p.ctx = nullptr;
+  if (buf && cap > 0)
+    buf[0] = '\0';
+}
+
+void httpParserInitSink(HttpRespParser &p, HttpBodyCb onBody, void *ctx)
+{
+  resetState(p);
+  p.onHeader = nullptr;
+  p.buf = nullptr;
+  p.cap = 0;
+  p.onBody = onBody;
+  p.ctx = ctx;
+}
+
+void httpParserReset(HttpRespParser &p)
+{
+  resetState(p);
+  if (p.buf && p.cap > 0)
+    p.buf[0] = '\0';
+}
+
+size_t httpParserFeed(HttpRespParser &p, const uint8_t *data, size_t len)
+{
+  size_t i = 0;
+
+  while (i < len && p.state != HP_DONE && p.state != HP_ERROR)
+  {
+    switch (p.state)
+    {
+    case HP_BODY_LEN:
+    case HP_CHUNK_DATA:
+    {
+      size_t n = len - i;
+      if (n > p.remaining)
+        n = p.remaining;
+      emitBody(p, data + i, n);
+      i += n;
+      p.remaining -= n;
+      if (p.remaining == 0 && p.state != HP_ERROR)
+        p.state = (p.state == HP_BODY_LEN) ? HP_DONE : HP_CHUNK_CRLF;
+      break;
+    }
+
+    case HP_BODY_EOF:
+      emitBody(p, data + i, len - i);
+      i = len;
+      break;
+
+    default:
+    {
+      const char c = (char)data[i++];
+      if (c == '\r')
+        break;
+      if (c != '\n')
+      {
+        if (p.lineLen < sizeof(p.line) - 1)
+          p.line[p.lineLen++] = c;
+        break;
+      }
+      p.line[p.lineLen] = '\0';
+      onLine(p);
+      p.lineLen = 0;
+      break;
+    }
+    }
+  }
+
+  p.rawBytes += i;
+  return i;
+}
+
+bool httpParserFinish(HttpRespParser &p)
+{
+  if (p.state == HP_BODY_EOF)
+    p.state = HP_DONE;
+  else if (p.state != HP_DONE)
+    p.state = HP_ERROR;
+  return p.state == HP_DONE;
+}
@@ -302,6 +302,20 @@ void serializaEstado()
     doc["id"] = DEVICE_ID;
     doc["status"] = estadoPuerta;
     doc["ec"] = ec_to_str(estadoMaquina);
+
+    // Despliegue escalonado: con esto el backend decide a quién da franja
+    // de actualización y sigue su avance (ver otaProgramar en http.hpp)
+    const OtaStats st = otaStats();
+    JsonObject ota = doc["ota"].to<JsonObject>();
+    ota["ready"] = otaDisponible();
+    ota["load"] = (estadoIO == ST_IDLE && activaConecta == 1) ? "idle" : "busy";
+    ota["phase"] = otaFase();
+    ota["pct"] = st.imageSize ? (int)((uint64_t)st.imageBytes * 100 / st.imageSize) : 0;
+    ota["slot"] = otaSlotEnS();
+    ota["v"] = enVersion;
+    if (st.lastError && st.lastError[0])
+        ota["err"] = st.lastError;
+
     outputEstado.remove(0);
     serializeJson(doc, outputEstado);
 }
@@ -334,17 +348,33 @@ void serializaPaso()
 
 void serializaReportFailure()
 {
+    // Instantánea coherente (la escribe el receptor RS485) del primer torno
+    // del bus con fallo, alarma o tensión baja; si ninguno, el primero
+    uint8_t maquina = RS485::machineCount() ? RS485::machineAt(0) : MACHINE_ID;
+    RS485::StatusFrame st = RS485::getStatus(maquina);
+    for (uint8_t i = 0; i < RS485::machineCount(); i++)
+    {
+        const RS485::StatusFrame s = RS485::getStatus(RS485::machineAt(i));
+        if (s.valid && (s.fault != 0 || s.alarm != 0 || s.vcc < 200))
+        {
+            maquina = RS485::machineAt(i);
+            st = s;
+            break;
+        }
+    }
+
     JsonDocument doc;
     doc["r"] = "OK";
     doc["id"] = DEVICE_ID;
     doc["s"] = "402";
     doc["ec"] = "FAIL_REPORT";
-    doc["fallo"] = faultEvent;
-    doc["puertas"] = gateStatus;
-    doc["alarma"] = alarmEvent;
-    doc["ce"] = leftCount;
-    doc["cs"] = rightCount;
-    doc["voltaje"] = powerSupplyVolt;
+    doc["fallo"] = st.fault;
+    doc["puertas"] = st.gate;
+    doc["alarma"] = st.alarm;
+    doc["ce"] = st.leftCount;
+    doc["cs"] = st.rightCount;
+    doc["voltaje"] = st.vcc;
+    doc["maquina"] = maquina;
 
     outputReportFailure.remove(0);
     serializeJson(doc, outputReportFailure);
@@ -352,22 +382,29 @@ void serializaReportFailure()
 
 // ========================= Deserializadores =========================
 
-void descifraEstado()
+void descifraEstado(const char *json, size_t len)
 {
     JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, estadoRecibido);
+    DeserializationError err = deserializeJson(doc, json, len);
     if (err)
         return;
 
     applyStatusLogic(get_status_as_int(doc), getStringFlex(doc, "ec", "EC"));
+    if (actualizarFlag == 1)
+    {
+        // Franja del despliegue escalonado (sin ella: en cuanto haya reposo)
+        const int slot = getIntFlex(doc, "slot");
+        const int ventana = getIntFlex(doc, "window");
+        otaSlotS = slot > 0 ? (uint32_t)slot : 0;
+        otaVentanaS = ventana > 0 ? (uint32_t)ventana : 0;
+    }
     procesarComandoHardware(doc);
-    estadoRecibido = "";
 }
 
-void descifraQR()
+void descifraQR(const char *json, size_t len)
 {
     JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, ticketRecibido);
+    DeserializationError error = deserializeJson(doc, json, len);
     if (error)
     {
         g_validateOutcome = VERROR;
@@ -414,13 +451,12 @@ void descifraQR()
         Serial.printf("[JSON] Validacion: %s | Status: %d | Pasos: %d/%d\n",
                       g_lastEd.c_str(), status, pasosActuales, pasosTotales);
     }
-    ticketRecibido = "";
 }
 
-void descifraPaso()
+void descifraPaso(const char *json, size_t len)
 {
     JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, pasoRecibido);
+    DeserializationError err = deserializeJson(doc, json, len);
     if (err)
         return;
 
@@ -429,5 +465,4 @@ void descifraPaso()
 
     applyStatusLogic(get_status_as_int(doc), getStringFlex(doc, "ec", "EC"));
     procesarComandoHardware(doc);
-    pasoRecibido = "";
 }
\ No newline at end of file
@@ -1,40 +1,346 @@
 #include "logBuf.hpp"
 
 #include <stdarg.h>
+#include <atomic>
 
-static LogEntry g_logs[LOGBUF_CAP];
-static uint32_t g_seq = 0;
-static uint16_t g_head = 0;
+static_assert((LOGBUF_CAP & (LOGBUF_CAP - 1)) == 0, "LOGBUF_CAP debe ser potencia de 2");
+static_assert(LOGBUF_STR <= 255, "LOGBUF_STR no cabe en strLen (uint8_t)");
+
+// Contenido de un registro (se copia entero al leer)
+struct LogBody
+{
+  uint32_t ms;
+  const char *fmt;
+  uint8_t nwords;                // palabras usadas en args
+  uint8_t strLen;                // bytes usados en str
+  uint8_t truncated;             // no cupieron todos los argumentos
+  uint32_t args[LOGBUF_ARGS];
+  char str[LOGBUF_STR];          // cadenas %s consecutivas, cada una con '\0'
+};
+
+struct LogRec
+{
+  std::atomic<uint32_t> id;      // 0 = escribiéndose; si no, id publicado
+  LogBody body;
+};
+
+static LogRec g_recs[LOGBUF_CAP];
+static std::atomic<uint32_t> g_next{0};     // último id reservado
+static std::atomic<uint32_t> g_clearedAt{0}; // ids <= este no se entregan
 
 // Gate para no generar logs cuando no hay sesión
 static volatile bool g_enabled = false;
 
-// Mutex ligero (ISR-safe) para ESP32
-static portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
+// ================== Especificadores de formato ====================
+
+struct FmtSpec
+{
+  const char *start; // '%'
+  const char *end;   // tras el carácter de conversión
+  char conv;
+  uint8_t stars;     // '*' de ancho/precisión (cada uno es un int)
+  int precision;     // -1 si no hay o es '*'
+  bool starPrec;     // la precisión llega como argumento
+  bool wide;         // ll / j: 64 bits
+};
+
+// Lee el especificador que empieza en p ('%'). false si no es completo.
+static bool parseSpec(const char *p, FmtSpec &s)
+{
+  s.start = p++;
+  s.stars = 0;
+  s.precision = -1;
+  s.starPrec = false;
+  s.wide = false;
+
+  while (*p && strchr("-+ #0", *p))
+    p++;
+  if (*p == '*')
+  {
+    s.stars++;
+    p++;
+  }
+  else
+    while (*p >= '0' && *p <= '9')
+      p++;
+  if (*p == '.')
+  {
+    p++;
+    if (*p == '*')
+    {
+      s.stars++;
+      s.starPrec = true;
+      p++;
+    }
+    else
+    {
+      s.precision = 0;
+      while (*p >= '0' && *p <= '9')
+        s.precision = s.precision * 10 + (*p++ - '0');
+    }
+  }
+  int l = 0;
+  while (*p && strchr("hlLqjzt", *p))
+  {
+    if (*p == 'l' || *p == 'q' || *p == 'L' || *p == 'j')
+      l++;
+    p++;
+  }
+  if (!*p)
+    return false;
+  s.conv = *p++;
+  s.end = p;
+  s.wide = (l >= 2) || (l == 1 && sizeof(long) == 8);
+  return true;
+}
+
+static inline bool isFloatConv(char c)
+{
+  return strchr("fFeEgGaA", c) != nullptr;
+}
+
+// ================== Captura (productores) ====================
+
+static bool put32(LogBody &b, uint32_t v)
+{
+  if (b.nwords >= LOGBUF_ARGS)
+    return false;
+  b.args[b.nwords++] = v;
+  return true;
+}
+
+static bool put64(LogBody &b, uint64_t v)
+{
+  if (b.nwords + 2 > LOGBUF_ARGS)
+    return false;
+  memcpy(&b.args[b.nwords], &v, sizeof(v));
+  b.nwords += 2;
+  return true;
+}
 
-static String jsonEscape(const char* s)
+static void captureArgs(LogBody &b, const char *fmt, va_list ap)
 {
-  String out;
-  for (const char* p = s; *p; ++p) {
-    char c = *p;
-    if (c == '\\' || c == '"') { out += '\\'; out += c; }
-    else if (c == '\n') out += "\\n";
-    else if (c == '\r') out += "\\r";
-    else if (c == '\t') out += "\\t";
-    else out += c;
+  b.nwords = 0;
+  b.strLen = 0;
+  b.truncated = 0;
+
+  for (const char *p = fmt; *p; ++p)
+  {
+    if (*p != '%')
+      continue;
+    if (p[1] == '%')
+    {
+      p++;
+      continue;
+    }
+    FmtSpec s;
+    if (!parseSpec(p, s))
+      break;
+    p = s.end - 1;
+
+    // '*': el primero puede ser ancho y el último precisión
+    int starVal = 0;
+    bool ok = true;
+    for (uint8_t i = 0; i < s.stars; i++)
+    {
+      starVal = va_arg(ap, int);
+      ok = ok && put32(b, (uint32_t)starVal);
+    }
+    const int prec = s.starPrec ? starVal : s.precision;
+
+    if (s.conv == 's')
+    {
+      const char *str = va_arg(ap, const char *);
+      if (!str)
+        str = "(null)";
+      // Con precisión no hace falta '\0' en el origen (p. ej. "%.*s" de un span)
+      size_t n = (prec >= 0) ? strnlen(str, (size_t)prec) : strlen(str);
+      const size_t room = LOGBUF_STR - b.strLen - 1;
+      if (n > room)
+      {
+        n = room;
+        b.truncated = 1;
+      }
+      ok = ok && put32(b, b.strLen);
+      if (ok && b.strLen < LOGBUF_STR)
+      {
+        memcpy(b.str + b.strLen, str, n);
+        b.str[b.strLen + n] = '\0';
+        b.strLen += (uint8_t)(n + 1);
+      }
+    }
+    else if (isFloatConv(s.conv))
+    {
+      const double d = va_arg(ap, double);
+      uint64_t raw;
+      memcpy(&raw, &d, sizeof(raw));
+      ok = ok && put64(b, raw);
+    }
+    else if (s.conv == 'p')
+    {
+      const uintptr_t v = (uintptr_t)va_arg(ap, void *);
+      ok = ok && (sizeof(v) == 8 ? put64(b, (uint64_t)v) : put32(b, (uint32_t)v));
+    }
+    else if (s.conv == 'n')
+      (void)va_arg(ap, int *);
+    else if (s.wide)
+      ok = ok && put64(b, (uint64_t)va_arg(ap, long long));
+    else
+      ok = ok && put32(b, (uint32_t)va_arg(ap, int));
+
+    if (!ok)
+    {
+      b.truncated = 1;
+      break;
+    }
   }
-  return out;
 }
 
+// ================== Formateo diferido (lector) ====================
+
+static size_t formatBody(const LogBody &b, char *out, size_t cap)
+{
+  size_t len = 0;
+  uint8_t w = 0;
+  out[0] = '\0';
+
+  for (const char *p = b.fmt; *p && len + 1 < cap;)
+  {
+    if (*p != '%')
+    {
+      out[len++] = *p++;
+      continue;
+    }
+    if (p[1] == '%')
+    {
+      out[len++] = '%';
+      p += 2;
+      continue;
+    }
+    FmtSpec s;
+    if (!parseSpec(p, s))
+      break;
+    p = s.end;
+
+    char spec[24];
+    const size_t sl = (size_t)(s.end - s.start);
+    if (sl >= sizeof(spec))
+      continue;
+    memcpy(spec, s.start, sl);
+    spec[sl] = '\0';
+
+    int stars[2] = {0, 0};
+    if (w + s.stars > b.nwords)
+      break;
+    for (uint8_t i = 0; i < s.stars; i++)
+      stars[i] = (int)b.args[w++];
+
+    const size_t room = cap - len;
+    int n = 0;
+    if (s.conv == 's')
+    {
+      if (w >= b.nwords)
+        break;
+      const uint32_t off = b.args[w++];
+      const char *str = (off < LOGBUF_STR) ? b.str + off : "";
+      n = (s.stars == 2) ? snprintf(out + len, room, spec, stars[0], stars[1], str)
+        : (s.stars == 1) ? snprintf(out + len, room, spec, stars[0], str)
+                         : snprintf(out + len, room, spec, str);
+    }
+    else if (isFloatConv(s.conv) || s.wide || (s.conv == 'p' && sizeof(void *) == 8))
+    {
+      if (w + 2 > b.nwords)
+        break;
+      uint64_t raw;
+      memcpy(&raw, &b.args[w], sizeof(raw));
+      w += 2;
+      if (isFloatConv(s.conv))
+      {
+        double d;
+        memcpy(&d, &raw, sizeof(d));
+        n = (s.stars == 2) ? snprintf(out + len, room, spec, stars[0], stars[1], d)
+          : (s.stars == 1) ? snprintf(out + len, room, spec, stars[0], d)
+                           : snprintf(out + len, room, spec, d);
+      }
+      else if (s.conv == 'p')
+        n = snprintf(out + len, room, "%p", (void *)(uintptr_t)raw);
+      else
+        n = (s.stars == 2) ? snprintf(out + len, room, spec, stars[0], stars[1], (long long)raw)
+          : (s.stars == 1) ? snprintf(out + len, room, spec, stars[0], (long long)raw)
+                           : snprintf(out + len, room, spec, (long long)raw);
+    }
+    else if (s.conv == 'n')
+      continue;
+    else
+    {
+      if (w >= b.nwords)
+        break;
+      const uint32_t v = b.args[w++];
+      if (s.conv == 'p')
+        n = snprintf(out + len, room, "%p", (void *)(uintptr_t)v);
+      else
+        n = (s.stars == 2) ? snprintf(out + len, room, spec, stars[0], stars[1], (int)v)
+          : (s.stars == 1) ? snprintf(out + len, room, spec, stars[0], (int)v)
+                           : snprintf(out + len, room, spec, (int)v);
+    }
+
+    if (n < 0)
+      break;
+    len += ((size_t)n < room) ? (size_t)n : room - 1;
+  }
+
+  if (b.truncated && len + 4 < cap)
+  {
+    memcpy(out + len, "...", 3);
+    len += 3;
+  }
+  out[len] = '\0';
+  return len;
+}
+
+// ================== Lectura de registros ====================
+
+enum RecRead : uint8_t
+{
+  REC_OK = 0,
+  REC_PENDING, // aún escribiéndose: se entrega en la siguiente consulta
+  REC_GONE     // ya pisado por uno más nuevo
+};
+
+static RecRead readRec(uint32_t id, LogBody &out)
+{
+  const LogRec &r = g_recs[id & (LOGBUF_CAP - 1)];
+  const uint32_t s1 = r.id.load(std::memory_order_acquire);
+  if (s1 != id)
+    return (s1 == 0 || s1 < id) ? REC_PENDING : REC_GONE;
+
+  out = r.body;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return (r.id.load(std::memory_order_relaxed) == id) ? REC_OK : REC_GONE;
+}
+
+// Lo más antiguo tras 'since' que sigue en el anillo
+static uint32_t firstAfter(uint32_t since, uint32_t last, uint32_t cleared)
+{
+  uint32_t first = since + 1;
+  if (first <= cleared)
+    first = cleared + 1;
+  if (last > LOGBUF_CAP && first < last - LOGBUF_CAP + 1)
+    first = last - LOGBUF_CAP + 1;
+  return first;
+}
+
+// ================== API ====================
+
 void logbuf_begin()
 {
   logbuf_clear();
-  g_enabled = false;
+  g_enabled = LOGBUF_ALWAYS_ON;
 }
 
 void logbuf_enable(bool on)
 {
-  g_enabled = on;
+  g_enabled = on || LOGBUF_ALWAYS_ON;
 }
 
 bool logbuf_enabled()
@@ -44,92 +350,148 @@ bool logbuf_enabled()
 
 void logbuf_clear()
 {
-  portENTER_CRITICAL(&g_mux);
-  memset(g_logs, 0, sizeof(g_logs));
-  g_seq = 0;
-  g_head = 0;
-  portEXIT_CRITICAL(&g_mux);
+  // No se toca el anillo (podría haber productores escribiendo): basta con
+  // no entregar lo anterior
+  g_clearedAt.store(g_next.load(std::memory_order_acquire), std::memory_order_release);
 }
 
 void logbuf_pushf(const char* fmt, ...)
 {
-  if (!g_enabled) return;  // CLAVE: coste casi cero si está desactivado
+  if (!g_enabled || !fmt) return;  // coste casi cero si está desactivado
 
-  char line[LOGBUF_LINE];
+  const uint32_t id = g_next.fetch_add(1, std::memory_order_relaxed) + 1;
+  LogRec &r = g_recs[id & (LOGBUF_CAP - 1)];
+
+  r.id.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  r.body.ms = millis();
+  r.body.fmt = fmt;
   va_list ap;
   va_start(ap, fmt);
-  vsnprintf(line, sizeof(line), fmt, ap);
+  captureArgs(r.body, fmt, ap);
   va_end(ap);
 
-  portENTER_CRITICAL(&g_mux);
-  LogEntry &e = g_logs[g_head];
-  e.id = ++g_seq;
-  e.ms = millis();
-  strlcpy(e.msg, line, sizeof(e.msg));
-  g_head = (g_head + 1) % LOGBUF_CAP;
-  portEXIT_CRITICAL(&g_mux);
+  r.id.store(id, std::memory_order_release);
 }
 
-String logbuf_get_json_since(uint32_t since, uint32_t& outNext)
+// Objeto JSON de un registro con el texto escapado; devuelve su longitud
+static size_t jsonRecord(uint32_t id, const LogBody &b, char *out, size_t cap)
 {
-  // ====== SNAPSHOT FUERA DE STACK (CRÍTICO) ======
-  static LogEntry snap[LOGBUF_CAP];
-
-  uint16_t head;
-  uint32_t seq;
-
-  portENTER_CRITICAL(&g_mux);
-  memcpy(snap, g_logs, sizeof(snap));
-  head = g_head;
-  seq  = g_seq;
-  portEXIT_CRITICAL(&g_mux);
+  char line[LOGBUF_LINE];
+  formatBody(b, line, sizeof(line));
 
-  outNext = seq;
+  int n = snprintf(out, cap, "{\"id\":%lu,\"ms\":%lu,\"msg\":\"",
+                   (unsigned long)id, (unsigned long)b.ms);
+  size_t len = (n > 0) ? (size_t)n : 0;
+  for (const char *p = line; *p && len + 8 < cap; ++p)
+  {
+    const char c = *p;
+    if (c == '\\' || c == '"')
+    {
+      out[len++] = '\\';
+      out[len++] = c;
+    }
+    else if (c == '\n' || c == '\r' || c == '\t')
+    {
+      out[len++] = '\\';
+      out[len++] = (c == '\n') ? 'n' : (c == '\r') ? 'r' : 't';
+    }
+    else if ((uint8_t)c < 0x20)
+      len += (size_t)snprintf(out + len, cap - len, "\\u%04x", (unsigned)c);
+    else
+      out[len++] = c;
+  }
+  out[len++] = '"';
+  out[len++] = '}';
+  return len;
+}
 
-  // Limitar items para no generar JSON enorme ni tardar demasiado
-  const uint16_t MAX_ITEMS = 40;
+bool logbuf_has_since(uint32_t since)
+{
+  const uint32_t last = g_next.load(std::memory_order_acquire);
+  // Un cursor por delante (el equipo se reinició) se contesta ya para resincronizar
+  return since > last || firstAfter(since, last, g_clearedAt.load(std::memory_order_acquire)) <= last;
+}
 
-  String body;
-  body.reserve(2048);  // Ajustado a un JSON razonable con límite
-  body += "{\"next\":";
-  body += String(seq);
-  body += ",\"items\":[";
+bool logbuf_stream_json(uint32_t since, LogBufSink sink, void *ctx, uint16_t maxItems)
+{
+  const uint32_t last = g_next.load(std::memory_order_acquire);
+  const uint32_t first = firstAfter(since, last, g_clearedAt.load(std::memory_order_acquire));
+  uint32_t next = last;
 
-  bool first = true;
+  // Los registros se agrupan en bloques: el sink recibe pocos trozos grandes
+  char out[LOGBUF_JSON_CHUNK];
+  char rec[2 * LOGBUF_LINE + 48];
+  size_t len = 0;
   uint16_t count = 0;
 
-  // Recorremos en orden cronológico
-  for (uint16_t i = 0; i < LOGBUF_CAP; ++i)
-  {
-    const LogEntry &e = snap[(head + i) % LOGBUF_CAP];
-    if (e.id == 0) continue;
-    if (e.id <= since) continue;
+  memcpy(out, "{\"items\":[", 10);
+  len = 10;
 
-    if (!first) body += ",";
-    first = false;
+  // Recorremos en orden cronológico, copiando cada registro bajo su id
+  for (uint32_t id = first; id <= last && id >= first; ++id)
+  {
+    LogBody b;
+    const RecRead rr = readRec(id, b);
+    if (rr == REC_PENDING)
+    {
+      next = id - 1;
+      break;
+    }
+    if (rr == REC_GONE)
+      continue;
 
-    body += "{\"id\":";
-    body += String(e.id);
-    body += ",\"ms\":";
-    body += String(e.ms);
-    body += ",\"msg\":\"";
+    size_t n = jsonRecord(id, b, rec + 1, sizeof(rec) - 1);
+    rec[0] = ',';
+    const char *src = count ? rec : rec + 1;
+    n += count ? 1 : 0;
 
-    // Escape inline (evita jsonEscape() que crea Strings temporales)
-    for (const char* p = e.msg; *p; ++p)
+    if (len + n > sizeof(out))
     {
-      char c = *p;
-      if (c == '\\' || c == '"') { body += '\\'; body += c; }
-      else if (c == '\n') body += "\\n";
-      else if (c == '\r') body += "\\r";
-      else if (c == '\t') body += "\\t";
-      else body += c;
+      if (!sink(ctx, (const uint8_t *)out, len))
+        return false;
+      len = 0;
     }
+    memcpy(out + len, src, n);
+    len += n;
 
-    body += "\"}";
+    if (++count >= maxItems)
+    {
+      next = id; // el resto en la siguiente consulta
+      break;
+    }
+  }
 
-    if (++count >= MAX_ITEMS) break;
+  // El cursor se conoce al terminar (puede quedarse antes de 'last')
+  char tail[32];
+  const int t = snprintf(tail, sizeof(tail), "],\"next\":%lu}", (unsigned long)next);
+  if (len + (size_t)t > sizeof(out))
+  {
+    if (!sink(ctx, (const uint8_t *)out, len))
+      return false;
+    len = 0;
   }
+  memcpy(out + len, tail, (size_t)t);
+  len += (size_t)t;
+  return sink(ctx, (const uint8_t *)out, len);
+}
 
-  body += "]}";
-  return body;
+bool logbuf_next(uint32_t& cursor, uint32_t& ms, char* line, size_t cap)
+{
+  const uint32_t last = g_next.load(std::memory_order_acquire);
+  for (uint32_t id = firstAfter(cursor, last, 0); id <= last && id > cursor; ++id)
+  {
+    LogBody b;
+    const RecRead rr = readRec(id, b);
+    if (rr == REC_PENDING)
+      return false;
+    cursor = id;
+    if (rr == REC_GONE)
+      continue;
+    ms = b.ms;
+    formatBody(b, line, cap);
+    return true;
+  }
+  return false;
 }
@@ -0,0 +1,352 @@
+#include "logSpool.hpp"
+#include "logBuf.hpp"
+#include <LittleFS.h>
+#include <esp_system.h>
+
+// Anillo en RTC RAM: head/flushed son contadores de bytes monótonos
+// (la posición es contador % LOGSPOOL_RTC_BYTES). Sobrevive a ESP.restart(),
+// watchdog y pánico; solo se pierde al cortar la alimentación.
+#define LOGSPOOL_MAGIC 0x4C53504CUL // "LPSL"
+
+struct RtcSpool
+{
+  uint32_t magic;
+  uint32_t head;    // bytes escritos
+  uint32_t flushed; // bytes ya volcados a flash (o descartados)
+  uint32_t lost;
+  uint32_t boots;
+  uint32_t check;
+  char data[LOGSPOOL_RTC_BYTES];
+};
+
+static RTC_NOINIT_ATTR RtcSpool g_rtc;
+
+static uint32_t g_first = 1, g_last = 1; // rango de segmentos en LittleFS
+static uint32_t g_bytes = 0;             // bytes en LittleFS
+static uint32_t g_actBytes = 0;          // bytes del segmento activo
+static uint32_t g_cursor = 0;            // último registro de logbuf drenado
+static uint32_t g_pendSince = 0;         // millis() de lo más antiguo sin volcar
+static uint32_t g_errorMs = 0;          // último fallo de escritura (reintento espaciado)
+static bool g_aplazado = false;
+static bool g_ok = false;
+static LogSpoolStats g_stats = {};
+
+static uint32_t rtcCheck()
+{
+  return ~(g_rtc.magic ^ g_rtc.head ^ g_rtc.flushed ^ g_rtc.lost ^ g_rtc.boots);
+}
+
+static void rtcSeal()
+{
+  g_rtc.check = rtcCheck();
+}
+
+static uint32_t rtcPending()
+{
+  return g_rtc.head - g_rtc.flushed;
+}
+
+static void rutaSegmento(uint32_t seg, char *out, size_t cap)
+{
+  snprintf(out, cap, LOGSPOOL_DIR "/%08lu.log", (unsigned long)seg);
+}
+
+// Añade texto al anillo; si no cabe se descarta lo más antiguo sin volcar
+// (hasta el siguiente salto de línea, para no dejar líneas partidas)
+static void rtcPut(const char *s, size_t n)
+{
+  if (n == 0)
+    return;
+  if (n > LOGSPOOL_RTC_BYTES)
+  {
+    s += n - LOGSPOOL_RTC_BYTES;
+    n = LOGSPOOL_RTC_BYTES;
+  }
+
+  if (rtcPending() == 0)
+    g_pendSince = millis();
+
+  if (rtcPending() + n > LOGSPOOL_RTC_BYTES)
+  {
+    uint32_t from = g_rtc.flushed;
+    uint32_t to = g_rtc.head + n - LOGSPOOL_RTC_BYTES;
+    while (to < g_rtc.head && g_rtc.data[(to - 1) % LOGSPOOL_RTC_BYTES] != '\n')
+      to++;
+    g_rtc.flushed = to;
+    g_rtc.lost += to - from;
+    rtcSeal();
+  }
+
+  // Primero los datos, después la cabecera
+  uint32_t pos = g_rtc.head % LOGSPOOL_RTC_BYTES;
+  size_t primero = LOGSPOOL_RTC_BYTES - pos;
+  if (primero > n)
+    primero = n;
+  memcpy(g_rtc.data + pos, s, primero);
+  memcpy(g_rtc.data, s + primero, n - primero);
+  g_rtc.head += n;
+  rtcSeal();
+}
+
+static void borrarMasAntiguo()
+{
+  char ruta[32];
+  rutaSegmento(g_first, ruta, sizeof(ruta));
+  File f = LittleFS.open(ruta, FILE_READ);
+  if (f)
+  {
+    g_bytes -= f.size();
+    f.close();
+  }
+  LittleFS.remove(ruta);
+  g_first++;
+}
+
+// Vuelca lo pendiente en RTC al segmento activo (rotando si está lleno)
+static bool volcar()
+{
+  const uint32_t n = rtcPending();
+  if (n == 0 || !g_ok)
+    return n == 0;
+
+  if (g_actBytes > 0 && g_actBytes + n > LOGSPOOL_SEG_BYTES)
+  {
+    g_last++;
+    g_actBytes = 0;
+    while (g_last - g_first + 1 > LOGSPOOL_MAX_SEGS)
+      borrarMasAntiguo();
+  }
+
+  char ruta[32];
+  rutaSegmento(g_last, ruta, sizeof(ruta));
+  File f = LittleFS.open(ruta, g_actBytes ? FILE_APPEND : FILE_WRITE);
+  if (!f)
+  {
+    g_stats.errors++;
+    g_errorMs = millis();
+    return false;
+  }
+
+  const uint32_t pos = g_rtc.flushed % LOGSPOOL_RTC_BYTES;
+  size_t primero = LOGSPOOL_RTC_BYTES - pos;
+  if (primero > n)
+    primero = n;
+  size_t w = f.write((const uint8_t *)g_rtc.data + pos, primero);
+  if (w == primero && n > primero)
+    w += f.write((const uint8_t *)g_rtc.data, n - primero);
+  f.close();
+
+  g_actBytes += w;
+  g_bytes += w;
+  if (w != n)
+  {
+    // Lo escrito a medias queda en flash; se reintenta el resto
+    g_rtc.flushed += w;
+    rtcSeal();
+    g_stats.errors++;
+    g_errorMs = millis();
+    return false;
+  }
+
+  g_rtc.flushed += n;
+  rtcSeal();
+  g_stats.flushes++;
+  g_stats.lastFlushMs = millis();
+  return true;
+}
+
+static const char *motivoReinicio(esp_reset_reason_t r)
+{
+  switch (r)
+  {
+  case ESP_RST_POWERON:
+    return "encendido";
+  case ESP_RST_EXT:
+    return "reset externo";
+  case ESP_RST_SW:
+    return "software";
+  case ESP_RST_PANIC:
+    return "panic";
+  case ESP_RST_INT_WDT:
+    return "watchdog int";
+  case ESP_RST_TASK_WDT:
+    return "watchdog tarea";
+  case ESP_RST_WDT:
+    return "watchdog";
+  case ESP_RST_DEEPSLEEP:
+    return "deep sleep";
+  case ESP_RST_BROWNOUT:
+    return "brownout";
+  default:
+    return "desconocido";
+  }
+}
+
+bool logspool_begin()
+{
+  if (!LittleFS.exists(LOGSPOOL_DIR))
+    LittleFS.mkdir(LOGSPOOL_DIR);
+
+  // Rango de segmentos existentes
+  uint32_t minSeg = 0, maxSeg = 0, lastSize = 0;
+  g_bytes = 0;
+  File dir = LittleFS.open(LOGSPOOL_DIR);
+  g_ok = dir && dir.isDirectory();
+  if (g_ok)
+  {
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile())
+    {
+      const char *nombre = f.name();
+      const char *barra = strrchr(nombre, '/');
+      const uint32_t seg = strtoul(barra ? barra + 1 : nombre, nullptr, 10);
+      const uint32_t size = f.size();
+      f.close();
+      if (seg == 0)
+        continue;
+      g_bytes += size;
+      if (minSeg == 0 || seg < minSeg)
+        minSeg = seg;
+      if (seg >= maxSeg)
+      {
+        maxSeg = seg;
+        lastSize = size;
+      }
+    }
+  }
+  if (dir)
+    dir.close();
+
+  g_first = minSeg ? minSeg : 1;
+  g_last = maxSeg ? maxSeg : g_first;
+  g_actBytes = maxSeg ? lastSize : 0;
+
+  // Anillo RTC: se conserva salvo tras encendido o si está corrupto
+  const esp_reset_reason_t motivo = esp_reset_reason();
+  if (motivo == ESP_RST_POWERON || g_rtc.magic != LOGSPOOL_MAGIC ||
+      g_rtc.check != rtcCheck() || rtcPending() > LOGSPOOL_RTC_BYTES)
+  {
+    memset(&g_rtc, 0, sizeof(g_rtc));
+    g_rtc.magic = LOGSPOOL_MAGIC;
+  }
+  g_rtc.boots++;
+  rtcSeal();
+
+  // Lo que no llegó a flash antes del reinicio va delante de la marca
+  g_pendSince = millis();
+  volcar();
+
+  char marca[96];
+  int n = snprintf(marca, sizeof(marca), "---- arranque %lu (%s) ----\n",
+                   (unsigned long)g_rtc.boots, motivoReinicio(motivo));
+  rtcPut(marca, n > 0 ? (size_t)n : 0);
+  volcar();
+
+  g_cursor = 0; // lo registrado en setup antes de esta llamada también entra
+  return g_ok;
+}
+
+void logspool_loop(bool enReposo)
+{
+  char texto[LOGBUF_LINE];
+  char linea[LOGBUF_LINE + 16];
+  uint32_t ms;
+  for (int i = 0; i < 16 && logbuf_next(g_cursor, ms, texto, sizeof(texto)); i++)
+  {
+    int n = snprintf(linea, sizeof(linea), "%lu %s\n", (unsigned long)ms, texto);
+    if (n <= 0)
+      continue;
+    if ((size_t)n >= sizeof(linea))
+    {
+      n = sizeof(linea) - 1;
+      linea[n - 1] = '\n';
+    }
+    rtcPut(linea, (size_t)n);
+  }
+
+  const uint32_t pend = rtcPending();
+  if (pend == 0)
+    return;
+  if (pend < LOGSPOOL_BATCH && millis() - g_pendSince < LOGSPOOL_FLUSH_MS)
+    return;
+  if (g_stats.errors && millis() - g_errorMs < 10000UL)
+    return;
+
+  if (!enReposo)
+  {
+    // Torno ocupado: el lote espera en RTC (cuenta una vez por lote)
+    if (!g_aplazado)
+      g_stats.deferred++;
+    g_aplazado = true;
+    return;
+  }
+  g_aplazado = false;
+  volcar();
+}
+
+uint32_t logspool_size()
+{
+  return g_bytes + rtcPending();
+}
+
+bool logspool_stream(LogSpoolSink sink, void *ctx)
+{
+  uint8_t buf[512];
+  char ruta[32];
+  for (uint32_t seg = g_first; seg <= g_last; seg++)
+  {
+    rutaSegmento(seg, ruta, sizeof(ruta));
+    File f = LittleFS.open(ruta, FILE_READ);
+    if (!f)
+      continue;
+    while (f.available())
+    {
+      size_t r = f.read(buf, sizeof(buf));
+      if (r == 0)
+        break;
+      if (!sink(ctx, buf, r))
+      {
+        f.close();
+        return false;
+      }
+    }
+    f.close();
+  }
+
+  // Cola aún en RTC
+  const uint32_t n = rtcPending();
+  const uint32_t pos = g_rtc.flushed % LOGSPOOL_RTC_BYTES;
+  size_t primero = LOGSPOOL_RTC_BYTES - pos;
+  if (primero > n)
+    primero = n;
+  if (primero && !sink(ctx, (const uint8_t *)g_rtc.data + pos, primero))
+    return false;
+  if (n > primero && !sink(ctx, (const uint8_t *)g_rtc.data, n - primero))
+    return false;
+  return true;
+}
+
+LogSpoolStats logspool_stats()
+{
+  LogSpoolStats st = g_stats;
+  st.segments = g_bytes ? g_last - g_first + 1 : 0;
+  st.bytes = g_bytes;
+  st.pending = rtcPending();
+  st.lost = g_rtc.lost;
+  st.boots = g_rtc.boots;
+  return st;
+}
+
+String logspool_stats_json()
+{
+  const LogSpoolStats st = logspool_stats();
+  String json = "{\"segments\":" + String(st.segments);
+  json += ",\"bytes\":" + String(st.bytes);
+  json += ",\"pending\":" + String(st.pending);
+  json += ",\"lost\":" + String(st.lost);
+  json += ",\"flushes\":" + String(st.flushes);
+  json += ",\"deferred\":" + String(st.deferred);
+  json += ",\"errors\":" + String(st.errors);
+  json += ",\"boots\":" + String(st.boots);
+  json += "}";
+  return json;
+}
@@ -24,6 +24,11 @@
 #include "config_prefs.hpp"
 #include "config_params.hpp"
 #include "logBuf.hpp"
+#include "logSpool.hpp"
+#include "fw_update.hpp"
+#include "cmd_lanes.hpp"
+#include "ticket.hpp"
+#include "scan_cache.hpp"
 
 // Servidor web global para WiFi
 WebServer serverWiFi(8080);
@@ -32,7 +37,7 @@ WebServer serverWiFi(8080);
 // Colas / Estado local de la tarea
 // ------------------------------
 static QueueHandle_t qFromNet = nullptr; // NET -> IO (Respuesta validación)
-static QueueHandle_t qToNet = nullptr;   // IO -> NET (Comandos y notificaciones)
+// IO -> NET: carriles de prioridad en cmd_lanes (cmdPush / cmdPop)
 static String entradaPendiente = "";
 
 // ------------------------------
@@ -41,7 +46,12 @@ static String entradaPendiente = "";
 static void taskNet(void *pv);
 static void taskIO(void *pv);
 static void handleSerialMenu();
-static void abrirPuerta(int direccion);
+static RS485::Txn abrirPuerta(uint8_t maquina, int direccion);
+static uint8_t maquinaDelCarril(uint8_t maquina);
+static uint8_t carrilDe(uint8_t maquina);
+static void notificarPaso(const String &ticket, const char *pasos);
+static void onTicketValidado(HttpReqKind kind, bool ok);
+static void responderLocal(const CmdMsg &msg, int vr, uint8_t pasos);
 
 static void mountFS()
 {
@@ -68,29 +78,35 @@ void setup()
     mountFS();
     // Inicialización del sistema de logs
     logbuf_begin();
+    logspool_begin(); // vuelca lo que quedó en RTC del arranque anterior
+    fwUpdateBootCheck(); // imagen recién instalada: a prueba hasta que responda el backend
 
     // ========================================================
     // 1) Carga de configuración de RED (TornoConfig)
     // ========================================================
-    cfgBegin();
+    cfgBegin();                     // un solo registro binario (A/B) en NVS
     cfgEnsureFirmwareDefaults();
-    TornoConfig c = cfgLoad();
-    cfgApplyToGlobals(c);
+    cfgApplyToGlobals(cfgView());   // directamente del registro cargado
 
     // ========================================================
     // 2) Carga de parámetros TÉCNICOS RS485 (TornoParams)
     // ========================================================
     if (modoApertura == 0) // Solo cargamos parámetros si vamos a usar RS485, si no no tiene sentido cargar parámetros que no se van a usar
     {
-        paramsBegin();                // Iniciamos el namespace "params" en Preferences
-        paramsEnsureDefaults();       // Si la NVS está vacía o el firmware es nuevo, cargamos los 36 defaults
-        TornoParams p = paramsLoad(); // Cargamos la estructura desde la flash
-        paramsApplyToGlobals(p);      // Volcamos los valores a las variables independientes (p_machineId, p_openingMode, etc.)
+        paramsBegin();                       // Namespace "params": un registro binario con los 37 parámetros
+        paramsEnsureDefaults();              // Si la NVS está vacía, guardamos los defaults
+        paramsApplyToGlobals(paramsView());  // Volcamos el registro a las variables independientes (p_machineId, p_openingMode, etc.)
+
+        uint8_t bus[PARAMS_COUNT];
+        paramsToBus(paramsView(), bus);
+        RS485::seedParams(bus, PARAMS_COUNT); // Lo que se supone que ya tiene el torno: solo se escribirá lo que cambie
     }
 
     logbuf_pushf("Sistema: Configuración y Parámetros cargados correctamente.");
 
     ensureWebPagesInLittleFS(true);
+    ticketsBegin(); // índice local de entradas de la última descarga
+    pendientesBegin(); // validaciones locales aún sin confirmar al backend
 
     // ========================================================
     // 3) Conexión a Red (WIFI o Ethernet)
@@ -131,7 +147,7 @@ void setup()
     else
         rele::begin();
 
-    qToNet = xQueueCreate(15, sizeof(CmdMsg));
+    cmdLanesBegin();
     qFromNet = xQueueCreate(5, sizeof(ServerReply));
 
     xTaskCreatePinnedToCore(taskNet, "taskNet", 8192, nullptr, 3, nullptr, 0);
@@ -143,19 +159,208 @@ void loop()
     (pdMS_TO_TICKS(1000));
 }
 
+// ============================================================
+// Ciclo de paso de cada torno
+// ============================================================
+// Cada torno del bus cuenta sus pasos y cierra su ciclo por su cuenta; solo
+// la validación (lector → índice local o backend) va de una en una
+struct CicloPaso
+{
+    bool activo = false;
+    uint8_t maquina = 0;
+    int direccion = 0; // 1 = Entrada, 2 = Salida
+    int pasosTotales = 0;
+    int pasosActuales = 0;
+    uint32_t pasosRef = 0;      // El valor del contador justo al abrir
+    uint32_t valorObjetivo = 0; // El valor que esperamos alcanzar (Ref + Totales)
+    uint32_t waitStart = 0;     // apertura o último paso (PASO_TIMEOUT)
+    RS485::Txn txnApertura = RS485::TXN_NONE; // orden de apertura (modo RS485)
+    bool aperturaPendiente = false;           // aún sin confirmar por el torno
+    uint32_t claveLectura = 0;                // lectura que abrió (caché de repetidas)
+};
+
+// Índice en el bus (RS485::machineAt) del torno; 0 si no está registrado
+// o en modo relé
+static uint8_t carrilDe(uint8_t maquina)
+{
+    if (modoApertura != 0)
+        return 0;
+    for (uint8_t i = 0; i < RS485::machineCount(); i++)
+        if (RS485::machineAt(i) == maquina)
+            return i;
+    return 0;
+}
+
+// Aviso a taskNet de un paso del ciclo con su torno y "hechos/totales": el
+// /validatePass lleva los de este ciclo aunque otro torno valide entretanto
+static void avisarPaso(const CicloPaso &c, CmdType tipo)
+{
+    CmdMsg msg;
+    msg.type = tipo;
+    msg.maquina = c.maquina;
+    snprintf(msg.payload, sizeof(msg.payload), "%d/%d", c.pasosActuales, c.pasosTotales);
+    cmdPush(msg, pdMS_TO_TICKS(10));
+}
+
+// Un turno del ciclo de paso de un torno con la puerta abierta
+static void atenderPaso(CicloPaso &c)
+{
+    uint32_t valorActualTorno = 0;
+    bool datosValidos = false;
+
+    if (modoApertura == 0 && c.aperturaPendiente)
+    {
+        // Si el torno no confirma la apertura no hay paso que esperar:
+        // se cierra el ciclo sin agotar PASO_TIMEOUT
+        const RS485::TxnStatus stApertura = RS485::peek(c.txnApertura);
+        if (stApertura != RS485::TXN_PENDING)
+        {
+            c.aperturaPendiente = false;
+            if (stApertura == RS485::TXN_NO_ACK || stApertura == RS485::TXN_NOT_EXECUTED || stApertura == RS485::TXN_REJECTED)
+            {
+                logbuf_pushf("[IO] Apertura no confirmada por el torno %u (%s).", c.maquina, RS485::txnStatusName(stApertura));
+
+                RS485::closeGate(c.maquina);
+                scanCacheForget(c.claveLectura); // sin paso: se puede volver a validar
+
+                avisarPaso(c, CMD_PASS_TIMEOUT);
+                c.activo = false;
+                return;
+            }
+        }
+    }
+
+    if (modoApertura == 0)
+    {
+        // ========================================================
+        // OBTENCIÓN DE DATOS - MODO RS485 (Lectura física)
+        // ========================================================
+        RS485::StatusFrame st = RS485::getStatus(c.maquina);
+        if (st.valid)
+        {
+            datosValidos = true;
+            if (c.direccion == 1) // ENTRADA
+                valorActualTorno = (sentidoApertura == 0) ? st.leftCount : st.rightCount;
+            else // SALIDA
+                valorActualTorno = (sentidoApertura == 0) ? st.rightCount : st.leftCount;
+        }
+    }
+    else
+    {
+        // ========================================================
+        // OBTENCIÓN DE DATOS - MODO RELÉ (Contador Virtual)
+        // ========================================================
+        datosValidos = true;
+
+        // Simulamos el paso físico de la persona:
+        // Si han pasado 1.5s y aún no hemos alcanzado el objetivo, incrementamos el contador interno
+        if ((millis() - c.waitStart > 1500) && ((c.pasosRef + c.pasosActuales) < c.valorObjetivo))
+        {
+            if (c.direccion == 1)
+                entradasTotales++;
+            else
+                salidasTotales++;
+        }
+
+        // Nuestro valor actual es la variable interna guardada
+        if (c.direccion == 1)
+            valorActualTorno = entradasTotales;
+        else
+            valorActualTorno = salidasTotales;
+    }
+
+    // ========================================================
+    // EVALUACIÓN UNIFICADA (Idéntica para RS485 y Relé)
+    // ========================================================
+    if (datosValidos)
+    {
+        // Si el contador del torno (físico o virtual) ha avanzado
+        if (valorActualTorno > (c.pasosRef + c.pasosActuales))
+        {
+            int incrementoReal = valorActualTorno - (c.pasosRef + c.pasosActuales);
+
+            for (int i = 0; i < incrementoReal; i++)
+            {
+                if (c.pasosActuales < c.pasosTotales)
+                {
+                    c.pasosActuales++;
+                    pasosActuales = c.pasosActuales;
+                    c.waitStart = millis(); // REINICIAMOS LOS 8 SEGUNDOS PARA LA SIGUIENTE PERSONA
+
+                    // Si NO es el último paso, notificamos el paso intermedio
+                    if (c.pasosActuales < c.pasosTotales)
+                    {
+                        avisarPaso(c, (c.direccion == 1) ? CMD_PASS_IN : CMD_PASS_OUT);
+                        logbuf_pushf("[IO] Paso Intermedio torno %u: %d/%d", c.maquina, c.pasosActuales, c.pasosTotales);
+
+                        // En modo relé, necesitamos dar un nuevo pulso para la siguiente persona
+                        if (modoApertura == 1)
+                        {
+                            if (c.direccion == 1)
+                                rele::openEntry();
+                            else
+                                rele::openExit();
+                        }
+                    }
+                }
+            }
+        }
+
+        // CONDICIÓN DE ÉXITO FINAL: El contador llegó al objetivo
+        if (valorActualTorno >= c.valorObjetivo || c.pasosActuales >= c.pasosTotales)
+        {
+            logbuf_pushf("[IO] Torno %u: meta alcanzada (%d). Enviando CMD_PASS_OK.", c.maquina, valorActualTorno);
+            avisarPaso(c, CMD_PASS_OK);
+
+            if (modoApertura == 0)
+                RS485::closeGate(c.maquina);
+            else
+                rele::close(); // Por seguridad, nos aseguramos de que el relé esté apagado
+
+            c.activo = false;
+            return;
+        }
+    }
+
+    // ========================================================
+    // CONDICIÓN DE TIMEOUT: 8 segundos de inactividad
+    // ========================================================
+    if (millis() - c.waitStart > PASO_TIMEOUT)
+    {
+        logbuf_pushf("[IO] Torno %u: timeout 8s. Pasaron %d de %d.", c.maquina, c.pasosActuales, c.pasosTotales);
+
+        if (modoApertura == 0)
+            RS485::closeGate(c.maquina);
+        else
+            rele::close();
+        // La autorización caduca con el ciclo: si el visitante sigue
+        // con el QR delante, la siguiente lectura se valida de nuevo
+        scanCacheForget(c.claveLectura);
+
+        avisarPaso(c, CMD_PASS_TIMEOUT);
+        c.activo = false;
+    }
+}
+
 // ============================================================
 // Tarea IO (Core 1)
 // ============================================================
 static void taskIO(void *pv)
 {
-    StateIO state = ST_IDLE;
-    String codeRead = "";
-    uint32_t waitStart = 0;
-    int localPasosTotales = 0;
-    int localPasosActuales = 0;
+    StateIO state = ST_IDLE; // validación en curso (lector → respuesta): una a la vez
+    uint32_t waitStart = 0;  // envío de la validación (SERVER_TIMEOUT)
     int localDireccion = 0;
-    uint32_t pasosRef = 0;      // El valor del contador justo al abrir
-    uint32_t valorObjetivo = 0; // El valor que esperamos alcanzar (Ref + Totales)
+    uint8_t maquinaActiva = maquinaDelCarril(0); // torno de la validación en curso (bus RS485)
+    uint8_t maquinaFallo = 0;                    // torno cuyo fallo se notificó
+    uint32_t claveLectura = 0;                   // lectura de la validación en curso (caché de repetidas)
+    CicloPaso ciclos[RS485_MAX_MACHINES];        // ciclo de paso por índice del bus
+
+    // Los cambios de contadores/puerta/fallo/alarma del torno despiertan la
+    // tarea en el acto; sin cambios, el ciclo sigue siendo de 50 ms
+    if (modoApertura == 0)
+        RS485::subscribe(xTaskGetCurrentTaskHandle());
+    // Igual con cada lectura completa del escáner
+    DSSP3120::subscribe(xTaskGetCurrentTaskHandle());
 
     for (;;)
     {
@@ -165,39 +370,46 @@ static void taskIO(void *pv)
         // =============================================================================
         if (modoApertura == 0 && activaConecta == 1)
         {
-            RS485::poll();
-            RS485::StatusFrame st = RS485::getStatus();
-            if (st.valid)
+            // Instantáneas coherentes publicadas por el receptor RS485 (sin
+            // poll); con varios tornos en el bus basta con que falle uno
+            RS485::StatusFrame st;
+            bool hayDatos = false;
+            bool hayProblema = false;
+            for (uint8_t i = 0; i < RS485::machineCount() && !hayProblema; i++)
             {
-                faultEvent = st.fault;
-                gateStatus = st.gate; // El estado es 0x03 (normal), lo guardamos pero no es un fallo
-                alarmEvent = st.alarm;
-                powerSupplyVolt = st.vcc;
-                leftCount = st.leftCount;
-                rightCount = st.rightCount;
-
+                const uint8_t m = RS485::machineAt(i);
+                st = RS485::getStatus(m);
+                if (!st.valid)
+                    continue;
+                hayDatos = true;
                 // CORRECCIÓN: Quitamos (gateStatus != 0) de la condición de fallo
-                bool hayProblema = (faultEvent != 0) || (alarmEvent != 0) || (powerSupplyVolt < 200);
+                // (el estado 0x03 es el normal)
+                hayProblema = (st.fault != 0) || (st.alarm != 0) || (st.vcc < 200);
+                if (hayProblema)
+                    maquinaFallo = m;
+            }
+            if (hayDatos)
+            {
 
                 if (hayProblema && !errorNotificado)
                 {
                     if (debugSerie)
-                        Serial.printf("[MAIN][IO] ¡Fallo detectado! Fault:0x%02X | Alarm:0x%02X | VCC:%u\n", faultEvent, alarmEvent, powerSupplyVolt);
+                        Serial.printf("[MAIN][IO] ¡Fallo detectado! Torno:%u | Fault:0x%02X | Alarm:0x%02X | VCC:%u\n", maquinaFallo, st.fault, st.alarm, st.vcc);
 
-                    logbuf_pushf("[MAIN][IO] Fallo detectado! Alarma: 0x%02X", alarmEvent);
+                    logbuf_pushf("[MAIN][IO] Fallo detectado en torno %u! Alarma: 0x%02X", maquinaFallo, st.alarm);
 
                     CmdMsg msgFallo;
                     msgFallo.type = CMD_FAIL_REPORT;
 
                     // Aseguramos que el mensaje va a la cola (aumentamos el timeout a 50ms por seguridad)
-                    if (xQueueSend(qToNet, &msgFallo, pdMS_TO_TICKS(50)) == pdTRUE)
+                    if (cmdPush(msgFallo, pdMS_TO_TICKS(50)) == pdTRUE)
                     {
                         errorNotificado = true;
                     }
                     else
                     {
                         if (debugSerie)
-                            Serial.println("[MAIN][IO] ERROR: Cola qToNet llena, no se pudo enviar FAIL_REPORT");
+                            Serial.println("[MAIN][IO] ERROR: Carril best-effort lleno, no se pudo enviar FAIL_REPORT");
                     }
                 }
                 else if (!hayProblema && errorNotificado)
@@ -216,22 +428,46 @@ static void taskIO(void *pv)
         switch (state)
         {
         case ST_IDLE:
-            if (activaConecta == 0 && (estadoMaquina == CMD_VALIDATE_IN || estadoMaquina == CMD_VALIDATE_OUT))
+            if (activaConecta == 0 && (estadoMaquina == CMD_VALIDATE_IN || estadoMaquina == CMD_VALIDATE_OUT) &&
+                !ciclos[carrilDe(maquinaDelCarril(0))].activo)
             {
                 localDireccion = (estadoMaquina == CMD_VALIDATE_IN) ? 1 : 2;
+                maquinaActiva = maquinaDelCarril(0); // validación desde el portal: torno por defecto
+                claveLectura = 0;
                 waitStart = millis();
                 state = ST_VALIDATING;
             }
-            else if (activaConecta == 1 && iniciOk == true)
+            else if (activaConecta == 1 && (iniciOk == true || ticketsDisponibles()))
             {
-                String codigoDetectado = "";
+                char codigoDetectado[sizeof(CmdMsg::payload)];
                 int direccionDetectada = 0; // 1 = Entrada, 2 = Salida
+                uint8_t maquinaDetectada = 0;
 
-                // Hacemos una única lectura. Si hay datos, la función rellena código y dirección.
-                if (DSSP3120::readLine_parsed(codigoDetectado, direccionDetectada, &ultimoTipoQR))
+                // Hacemos una única lectura. Si hay datos, la función rellena código, dirección y torno.
+                if (DSSP3120::readLine_parsed(codigoDetectado, sizeof(codigoDetectado), direccionDetectada, &ultimoTipoQR, &maquinaDetectada))
                 {
-                    codeRead = codigoDetectado;
-                    codeRead.trim();
+                    // Mismo QR otra vez delante del lector: se resuelve con el
+                    // último resultado, sin volver a validar
+                    const uint32_t clave = scanCacheKey(codigoDetectado, direccionDetectada);
+                    uint8_t previo = VNONE;
+                    if (scanCacheLookup(clave, previo))
+                    {
+                        logbuf_pushf("[IO] Lectura repetida (%s), no se valida de nuevo.",
+                                     (previo == VAUTH_IN || previo == VAUTH_OUT) ? "ya autorizada" : "rechazada");
+                        DSSP3120::markScan(DSSP3120::SCAN_END);
+                        break;
+                    }
+
+                    maquinaActiva = maquinaDelCarril(maquinaDetectada);
+                    if (ciclos[carrilDe(maquinaActiva)].activo)
+                    {
+                        // Ese torno sigue con la puerta abierta: su lector no
+                        // se atiende hasta que cierre el ciclo
+                        logbuf_pushf("[IO] Torno %u con paso en curso, lectura descartada.", maquinaActiva);
+                        DSSP3120::markScan(DSSP3120::SCAN_END);
+                        break;
+                    }
+                    claveLectura = clave;
 
                     // --- SI PASA EL FILTRO, ASIGNAR VALORES Y ENVIAR ---
                     localDireccion = direccionDetectada;
@@ -249,10 +485,11 @@ static void taskIO(void *pv)
                     activaConecta = 0;
                     CmdMsg msg;
                     msg.type = estadoMaquina;
-                    strlcpy(msg.payload, codeRead.c_str(), sizeof(msg.payload));
+                    msg.maquina = maquinaActiva;
+                    memcpy(msg.payload, codigoDetectado, sizeof(msg.payload));
 
                     xQueueReset(qFromNet);
-                    xQueueSend(qToNet, &msg, pdMS_TO_TICKS(100));
+                    cmdPush(msg, pdMS_TO_TICKS(100));
                     waitStart = millis();
                     state = ST_VALIDATING;
                 }
@@ -263,188 +500,93 @@ static void taskIO(void *pv)
             ServerReply reply;
             if (xQueueReceive(qFromNet, &reply, pdMS_TO_TICKS(10)) == pdTRUE)
             {
+                DSSP3120::markScan(DSSP3120::SCAN_DECIDED);
+                scanCacheStore(claveLectura, reply.resultado);
                 if (reply.autorizado && reply.pasosTotales > 0)
                 {
-                    localPasosTotales = reply.pasosTotales;
-                    pasosTotales = localPasosTotales;
-                    localPasosActuales = 0;
+                    CicloPaso &c = ciclos[carrilDe(maquinaActiva)];
+                    c.maquina = maquinaActiva;
+                    c.direccion = localDireccion;
+                    c.claveLectura = claveLectura;
+                    c.pasosTotales = reply.pasosTotales;
+                    pasosTotales = c.pasosTotales;
+                    c.pasosActuales = 0;
                     pasosActuales = 0;
 
                     if (modoApertura == 0)
                     {
                         // IMPORTANTE: Captura de marca de agua
-                        RS485::poll();
-                        RS485::StatusFrame stStart = RS485::getStatus();
+                        RS485::StatusFrame stStart = RS485::getStatus(c.maquina);
 
                         // --- Lógica de selección de contador de referencia ---
-                        if (localDireccion == 1) // ENTRADA
+                        if (c.direccion == 1) // ENTRADA
                         {
                             // Si sentidoApertura es 0 => Left, si es 1 => Right
-                            pasosRef = (sentidoApertura == 0) ? stStart.leftCount : stStart.rightCount;
+                            c.pasosRef = (sentidoApertura == 0) ? stStart.leftCount : stStart.rightCount;
                         }
                         else // SALIDA
                         {
                             // Si sentidoApertura es 0 => Right, si es 1 => Left
-                            pasosRef = (sentidoApertura == 0) ? stStart.rightCount : stStart.leftCount;
+                            c.pasosRef = (sentidoApertura == 0) ? stStart.rightCount : stStart.leftCount;
                         }
                     }
                     else
                     {
-                        if (localDireccion == 1)
+                        if (c.direccion == 1)
                         {
-                            pasosRef = entradasTotales; // En modo relé, no tenemos contador, así que asumimos que partimos de 0
+                            c.pasosRef = entradasTotales; // En modo relé, no tenemos contador, así que asumimos que partimos de 0
                         }
                         else
                         {
-                            pasosRef = salidasTotales;
+                            c.pasosRef = salidasTotales;
                         }
                     }
 
-                    valorObjetivo = pasosRef + localPasosTotales;
+                    c.valorObjetivo = c.pasosRef + c.pasosTotales;
 
-                    abrirPuerta(localDireccion);
-                    waitStart = millis();
-                    state = ST_WAITING_PASS;
+                    c.txnApertura = abrirPuerta(c.maquina, c.direccion);
+                    DSSP3120::markScan(DSSP3120::SCAN_GATE);
+                    c.aperturaPendiente = (modoApertura == 0);
+                    c.waitStart = millis();
+                    c.activo = true;
+                    state = ST_IDLE; // el lector queda libre para los demás tornos
                     if (debugSerie)
-                        Serial.printf("[MAIN][IO] Apertura: Ref=%d, Obj=%d", pasosRef, valorObjetivo);
+                        Serial.printf("[MAIN][IO] Apertura torno %u: Ref=%u, Obj=%u", c.maquina, (unsigned)c.pasosRef, (unsigned)c.valorObjetivo);
 
-                    logbuf_pushf("[IO] Apertura: Ref=%d, Obj=%d", pasosRef, valorObjetivo);
+                    logbuf_pushf("[IO] Apertura torno %u: Ref=%u, Obj=%u", c.maquina, (unsigned)c.pasosRef, (unsigned)c.valorObjetivo);
                 }
                 else
                 {
+                    DSSP3120::markScan(DSSP3120::SCAN_END);
                     resetCycleReady();
                     state = ST_IDLE;
                 }
             }
             else if (millis() - waitStart > SERVER_TIMEOUT)
             {
+                DSSP3120::markScan(DSSP3120::SCAN_END);
                 resetCycleReady();
                 state = ST_IDLE;
             }
             break;
 
         case ST_WAITING_PASS:
+            break; // los pasos van por torno, abajo
+        }
 
-            uint32_t valorActualTorno = 0;
-            bool datosValidos = false;
-
-            if (modoApertura == 0)
-            {
-                // ========================================================
-                // OBTENCIÓN DE DATOS - MODO RS485 (Lectura física)
-                // ========================================================
-                RS485::poll();
-                RS485::StatusFrame st = RS485::getStatus();
-                if (st.valid)
-                {
-                    datosValidos = true;
-                    if (localDireccion == 1) // ENTRADA
-                        valorActualTorno = (sentidoApertura == 0) ? st.leftCount : st.rightCount;
-                    else // SALIDA
-                        valorActualTorno = (sentidoApertura == 0) ? st.rightCount : st.leftCount;
-                }
-            }
-            else
-            {
-                // ========================================================
-                // OBTENCIÓN DE DATOS - MODO RELÉ (Contador Virtual)
-                // ========================================================
-                datosValidos = true;
-
-                // Simulamos el paso físico de la persona:
-                // Si han pasado 1.5s y aún no hemos alcanzado el objetivo, incrementamos el contador interno
-                if ((millis() - waitStart > 1500) && ((pasosRef + localPasosActuales) < valorObjetivo))
-                {
-                    if (localDireccion == 1)
-                        entradasTotales++;
-                    else
-                        salidasTotales++;
-                }
-
-                // Nuestro valor actual es la variable interna guardada
-                if (localDireccion == 1)
-                    valorActualTorno = entradasTotales;
-                else
-                    valorActualTorno = salidasTotales;
-            }
-
-            // ========================================================
-            // EVALUACIÓN UNIFICADA (Idéntica para RS485 y Relé)
-            // ========================================================
-            if (datosValidos)
-            {
-                // Si el contador del torno (físico o virtual) ha avanzado
-                if (valorActualTorno > (pasosRef + localPasosActuales))
-                {
-                    int incrementoReal = valorActualTorno - (pasosRef + localPasosActuales);
-
-                    for (int i = 0; i < incrementoReal; i++)
-                    {
-                        if (localPasosActuales < localPasosTotales)
-                        {
-                            localPasosActuales++;
-                            pasosActuales = localPasosActuales;
-                            waitStart = millis(); // REINICIAMOS LOS 8 SEGUNDOS PARA LA SIGUIENTE PERSONA
-
-                            // Si NO es el último paso, notificamos el paso intermedio
-                            if (localPasosActuales < localPasosTotales)
-                            {
-                                CmdMsg msgStep;
-                                msgStep.type = (localDireccion == 1) ? CMD_PASS_IN : CMD_PASS_OUT;
-                                sprintf(msgStep.payload, "%d/%d", localPasosActuales, localPasosTotales);
-                                xQueueSend(qToNet, &msgStep, pdMS_TO_TICKS(10));
-                                logbuf_pushf("[IO] Paso Intermedio: %s", msgStep.payload);
-
-                                // En modo relé, necesitamos dar un nuevo pulso para la siguiente persona
-                                if (modoApertura == 1)
-                                {
-                                    if (localDireccion == 1)
-                                        rele::openEntry();
-                                    else
-                                        rele::openExit();
-                                }
-                            }
-                        }
-                    }
-                }
-
-                // CONDICIÓN DE ÉXITO FINAL: El contador llegó al objetivo
-                if (valorActualTorno >= valorObjetivo || localPasosActuales >= localPasosTotales)
-                {
-                    logbuf_pushf("[IO] Meta alcanzada (%d). Enviando CMD_PASS_OK.", valorActualTorno);
-                    CmdMsg msgOk;
-                    msgOk.type = CMD_PASS_OK;
-                    xQueueSend(qToNet, &msgOk, pdMS_TO_TICKS(10));
-
-                    if (modoApertura == 0)
-                        RS485::closeGate(MACHINE_ID);
-                    else
-                        rele::close(); // Por seguridad, nos aseguramos de que el relé esté apagado
-
-                    state = ST_IDLE;
-                }
-            }
-
-            // ========================================================
-            // CONDICIÓN DE TIMEOUT: 8 segundos de inactividad
-            // ========================================================
-            if (state == ST_WAITING_PASS && (millis() - waitStart > PASO_TIMEOUT))
-            {
-                logbuf_pushf("[IO] Timeout 8s. Pasaron %d de %d.", localPasosActuales, localPasosTotales);
-
-                if (modoApertura == 0)
-                    RS485::closeGate(MACHINE_ID);
-                else
-                    rele::close();
-
-                CmdMsg msgTo;
-                msgTo.type = CMD_PASS_TIMEOUT;
-                xQueueSend(qToNet, &msgTo, pdMS_TO_TICKS(10));
-                state = ST_IDLE;
-            }
-            break;
+        // ====================================================================================
+        // 4) Pasos: cada torno con la puerta abierta cuenta y cierra su propio ciclo
+        // ====================================================================================
+        bool enPaso = false;
+        for (CicloPaso &c : ciclos)
+        {
+            if (c.activo)
+                atenderPaso(c);
+            enPaso = enPaso || c.activo;
         }
-        vTaskDelay(pdMS_TO_TICKS(50));
+        // taskNet no arranca la OTA con lectura o paso en curso
+        estadoIO = (state == ST_IDLE && enPaso) ? ST_WAITING_PASS : state;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
     }
 }
 
@@ -460,6 +602,15 @@ static void taskNet(void *pv)
     uint32_t lastWifiReconnect = millis(); // Para no saturar los reintentos WiFi
     uint32_t lastEthRetry = 0;
 
+    // Ciclo de cada torno (índice del bus): sus pasos se notifican con su
+    // ticket aunque otro torno valide entretanto
+    struct CicloNet
+    {
+        String ticket;
+        bool local = false; // lo decidió el índice local
+    };
+    CicloNet ciclosNet[RS485_MAX_MACHINES];
+
     uint8_t fallosConsecutivos = 0;
     bool prevLinkState = true;
 
@@ -477,6 +628,9 @@ static void taskNet(void *pv)
                 serverWiFi.handleClient();
         }
 
+        // 1b. PETICIONES AL BACKEND EN CURSO (avanza sin esperar la respuesta)
+        httpPoll();
+
         // 2. VIGILANTE DE RED FÍSICA / ENLACE
         bool currentLink = linkUp();
 
@@ -487,6 +641,9 @@ static void taskNet(void *pv)
                 Serial.println("[NET] Enlace recuperado. Reintentando saludo...");
             // iniciOk = false;
         }
+        // Si perdemos el enlace, las conexiones keep-alive ya no sirven
+        if (!currentLink && prevLinkState)
+            httpPoolReset();
         prevLinkState = currentLink;
 
         // --- LÓGICA DE RECUPERACIÓN ETHERNET ---
@@ -519,7 +676,8 @@ static void taskNet(void *pv)
             if (millis() - lastInicioAttempt > 5000)
             {
                 lastInicioAttempt = millis();
-                getInicio();
+                if (!httpPending(REQ_INICIO))
+                    httpSubmit(REQ_INICIO);
             }
         }
 
@@ -566,62 +724,95 @@ static void taskNet(void *pv)
         }
 
         // ======================================================
-        // 5. LÓGICA PRINCIPAL DEL TORNO (Solo si hay conexión OK)
+        // 5. LÓGICA PRINCIPAL DEL TORNO
         // ======================================================
-        if (currentLink && iniciOk)
+        const bool online = currentLink && iniciOk;
+        // Sin validación en curso ni puerta abierta en ningún torno
+        const bool reposo = activaConecta == 1 && estadoIO == ST_IDLE;
+
+        // Con el motor HTTP libre se atienden todos los carriles por prioridad.
+        // Si está ocupado (o no hay red) se siguen atendiendo las validaciones:
+        // el índice local decide sin red y solo lo desconocido va al backend.
+        // Sin red también se cierran los pasos de un ciclo validado en local.
+        CmdMsg msg{};
+        bool hayMsg;
+        if (online && httpIdle())
+            hayMsg = cmdPop(msg);
+        else
+            hayMsg = cmdPop(msg, online ? LANE_CRITICA : LANE_NORMAL);
+
+        if (hayMsg)
         {
-            CmdMsg msg{};
-            if (xQueueReceive(qToNet, &msg, 0) == pdTRUE)
+            // Las peticiones se serializan al encolarlas; la respuesta se
+            // aplica en httpPoll() cuando llegue
+            if (msg.type == CMD_HEARTBEAT)
             {
-                if (msg.type == CMD_FAIL_REPORT)
-                {
-                    reportFailure();
-                }
-                else if (msg.type == CMD_VALIDATE_IN || msg.type == CMD_VALIDATE_OUT)
-                {
-                    activaConecta = 0;
-                    ultimoTicket = String(msg.payload);
-                    postTicket();
-
-                    ServerReply reply;
-                    reply.autorizado = (g_validateOutcome == VAUTH_IN || g_validateOutcome == VAUTH_OUT);
-                    reply.pasosTotales = (reply.autorizado) ? pasosTotales : 0;
-                    xQueueSend(qFromNet, &reply, pdMS_TO_TICKS(50));
-
-                    if (!reply.autorizado)
-                        activaConecta = 1;
-                }
-                else if (msg.type == CMD_PASS_IN || msg.type == CMD_PASS_OUT)
-                {
-                    estadoMaquina = msg.type;
-                    ultimoPaso = msg.payload;
-                    postPaso();
-                }
-                else if (msg.type == CMD_PASS_OK)
-                {
-                    estadoPuerta = 205;
-                    estadoMaquina = CMD_PASS_OK;
-                    ultimoPaso = "OK";
-                    postPaso();
-                    DSSP3120::flushInput();
-                    activaConecta = 1;
-                }
-                else if (msg.type == CMD_PASS_TIMEOUT)
+                // Si mientras esperaba empezó una validación o un paso, el latido sobra
+                if (reposo)
+                    httpSubmit(REQ_ESTADO);
+            }
+            else if (msg.type == CMD_FAIL_REPORT)
+            {
+                httpSubmit(REQ_FAILURE);
+            }
+            else if (msg.type == CMD_VALIDATE_IN || msg.type == CMD_VALIDATE_OUT)
+            {
+                activaConecta = 0;
+                ultimoTicket = String(msg.payload);
+                CicloNet &c = ciclosNet[carrilDe(msg.maquina)];
+                c.ticket = ultimoTicket;
+
+                // Primero el índice local; lo que no conoce lo decide el backend
+                uint8_t pasosLocal = 1;
+                const int vr = verificarTicket(ultimoTicket, &pasosLocal);
+                c.local = (vr == TICKET_OK);
+                if (vr != TICKET_NO_EXISTE)
+                    responderLocal(msg, vr, pasosLocal);
+                else if (!online || !httpSubmit(REQ_TICKET, onTicketValidado))
                 {
-                    estadoPuerta = 206;
-                    estadoMaquina = CMD_PASS_TIMEOUT;
-                    ultimoPaso = "TIMEOUT";
-                    postPaso();
-                    DSSP3120::flushInput();
-                    activaConecta = 1;
+                    g_validateOutcome = VERROR;
+                    resetCycleReady();
+                    onTicketValidado(REQ_TICKET, false);
                 }
             }
+            else if (msg.type == CMD_PASS_IN || msg.type == CMD_PASS_OUT)
+            {
+                const CicloNet &c = ciclosNet[carrilDe(msg.maquina)];
+                estadoMaquina = msg.type;
+                ultimoPaso = msg.payload;
+                if (online && !c.local)
+                    notificarPaso(c.ticket, msg.payload);
+            }
+            else if (msg.type == CMD_PASS_OK || msg.type == CMD_PASS_TIMEOUT)
+            {
+                CicloNet &c = ciclosNet[carrilDe(msg.maquina)];
+                const bool ok = (msg.type == CMD_PASS_OK);
+                estadoPuerta = ok ? 205 : 206;
+                estadoMaquina = msg.type;
+                ultimoPaso = ok ? "OK" : "TIMEOUT";
+                if (online && !c.local)
+                    notificarPaso(c.ticket, msg.payload);
+                c.ticket = "";
+                c.local = false;
+            }
+        }
 
+        if (online)
+        {
             // Latido (Status periódico)
-            if (activaConecta == 1 && (millis() - lastStatus) >= PERIOD_STATUS_MS)
+            if (reposo && (millis() - lastStatus) >= PERIOD_STATUS_MS)
             {
                 lastStatus = millis();
-                getEstado();
+                cmdRequestHeartbeat();
+            }
+
+            // Índice local de entradas y confirmación de lo validado en local
+            if (reposo && httpIdle())
+            {
+                if (ticketsToca())
+                    ticketsDescargar();
+                else if (pendientesToca())
+                    reenviarTicketsPendientesComoBloque(); // encolado: el cursor avanza al confirmarse
             }
 
             if (restartFlag == 1)
@@ -630,6 +821,19 @@ static void taskNet(void *pv)
                 ESP.restart();
             }
         }
+        ticketsLoop();
+        logspool_loop(reposo); // a flash solo sin paso en curso
+
+        // OTA pedida por el backend (status 310), en la franja que asigne.
+        // La descarga avanza por tramos y solo empieza y escribe en flash
+        // con el torno en reposo (taskIO en ST_IDLE, sin paso en curso)
+        if (actualizarFlag == 1)
+        {
+            actualizarFlag = 0;
+            otaProgramar(otaSlotS, otaVentanaS);
+        }
+        otaPoll(reposo);
+        fwUpdateVerifyLoop(currentLink, httpAsyncStats().completed > 0);
 
         // ======================================================
         // 6. CONTROL DE SESIÓN WEB
@@ -638,17 +842,74 @@ static void taskNet(void *pv)
         {
             registrado_eth = false;
             logbuf_enable(false);
-            logbuf_clear();
         }
 
         vTaskDelay(pdMS_TO_TICKS(10));
     }
 }
 
-static void abrirPuerta(int direccion)
+// Respuesta de /validateQR (o fallo/plazo vencido): se la pasamos a taskIO
+static void onTicketValidado(HttpReqKind kind, bool ok)
+{
+    ServerReply reply;
+    reply.autorizado = ok && (g_validateOutcome == VAUTH_IN || g_validateOutcome == VAUTH_OUT);
+    reply.pasosTotales = (reply.autorizado) ? pasosTotales : 0;
+    reply.resultado = ok ? (uint8_t)g_validateOutcome : (uint8_t)VERROR;
+
+    // La validación termina aquí: el paso lo cuenta taskIO en su torno y el
+    // lector queda libre para los demás (antes de que taskIO vea la respuesta)
+    activaConecta = 1;
+    xQueueSend(qFromNet, &reply, pdMS_TO_TICKS(50));
+}
+
+// /validatePass de un ciclo con su ticket y sus pasos ("hechos/totales")
+static void notificarPaso(const String &ticket, const char *pasos)
+{
+    ultimoTicket = ticket;
+    sscanf(pasos, "%d/%d", &pasosActuales, &pasosTotales);
+    httpSubmit(REQ_PASO);
+}
+
+// Respuesta a taskIO decidida con el índice local (sub-milisegundo). Lo
+// autorizado aquí se confirma después al backend con /entries/pending.
+static void responderLocal(const CmdMsg &msg, int vr, uint8_t pasos)
+{
+    if (vr == TICKET_OK)
+    {
+        g_validateOutcome = (msg.type == CMD_VALIDATE_IN) ? VAUTH_IN : VAUTH_OUT;
+        g_lastEd = "OK";
+        pasosTotales = pasos; // entradas de grupo: las personas del índice
+        guardarTicketPendiente(ultimoTicket, pasos);
+    }
+    else
+    {
+        g_validateOutcome = (vr == TICKET_AUN_NO) ? VTIME_NOT_YET : VDENIED;
+        g_lastEd = (vr == TICKET_AUN_NO) ? "TIME_NOT_YET" : "TICKET_ALREADY_USED";
+    }
+
+    logbuf_pushf("[NET][LOCAL] Ticket=%s → %s", ultimoTicket.c_str(), g_lastEd.c_str());
+    onTicketValidado(REQ_TICKET, true);
+}
+
+// Torno del bus al que va el ciclo: el etiquetado por el lector si está
+// registrado; si no (o en modo relé), el primero del bus
+static uint8_t maquinaDelCarril(uint8_t maquina)
+{
+    const uint8_t def = RS485::machineCount() ? RS485::machineAt(0) : MACHINE_ID;
+    if (modoApertura != 0 || maquina == 0)
+        return def;
+    for (uint8_t i = 0; i < RS485::machineCount(); i++)
+        if (RS485::machineAt(i) == maquina)
+            return maquina;
+
+    logbuf_pushf("[IO] Torno %u no registrado en el bus, se usa el %u.", maquina, def);
+    return def;
+}
+
+static RS485::Txn abrirPuerta(uint8_t maquina, int direccion)
 {
     if (debugSerie)
-        Serial.printf("[MAIN][IO] Abriendo puerta. Dirección: %d | ModoApertura: %d\n", direccion, modoApertura);
+        Serial.printf("[MAIN][IO] Abriendo puerta. Torno: %u | Dirección: %d | ModoApertura: %d\n", maquina, direccion, modoApertura);
 
     if (modoApertura == 1) // --- MODO RELÉ ---
     {
@@ -656,24 +917,13 @@ static void abrirPuerta(int direccion)
             rele::openEntry();
         else
             rele::openExit();
+        return RS485::TXN_NONE;
     }
-    else // --- MODO RS485 ---
-    {
-        if (direccion == 1)
-        {
-            if (sentidoApertura == 0)
-                RS485::leftOpen(MACHINE_ID, pasosTotales);
-            else
-                RS485::rightOpen(MACHINE_ID, pasosTotales);
-        }
-        else
-        {
-            if (sentidoApertura == 0)
-                RS485::rightOpen(MACHINE_ID, pasosTotales);
-            else
-                RS485::leftOpen(MACHINE_ID, pasosTotales);
-        }
-    }
+
+    // --- MODO RS485 ---
+    if (direccion == 1)
+        return (sentidoApertura == 0) ? RS485::leftOpen(maquina, pasosTotales) : RS485::rightOpen(maquina, pasosTotales);
+    return (sentidoApertura == 0) ? RS485::rightOpen(maquina, pasosTotales) : RS485::leftOpen(maquina, pasosTotales);
 }
 
 static void handleSerialMenu()
@@ -0,0 +1,172 @@
+#include "multipart.hpp"
+
+#include <string.h>
+
+static_assert(MULTIPART_WINDOW > MULTIPART_BOUNDARY_MAX + 4, "MULTIPART_WINDOW demasiado pequeña");
+
+// ================== Contenido ====================
+
+static void emit(MultipartParser &p, const uint8_t *d, size_t n)
+{
+  if (n == 0 || p.state != MP_DATA)
+    return;
+  if (!p.discard && p.onData && !p.onData(p.ctx, d, n))
+    p.state = MP_ERROR;
+  p.dataBytes += n;
+}
+
+// Primera aparición del marcador en la ventana a partir de 'from'; -1 si no está
+static int bmhFind(const MultipartParser &p, size_t from)
+{
+  const size_t m = p.markerLen;
+  const uint8_t last = (uint8_t)p.marker[m - 1];
+  for (size_t s = from; s + m <= p.winLen;)
+  {
+    const uint8_t c = p.win[s + m - 1];
+    if (c == last && memcmp(p.win + s, p.marker, m - 1) == 0)
+      return (int)s;
+    s += p.skip[c];
+  }
+  return -1;
+}
+
+// Preámbulo o contenido: pasa por la ventana. Devuelve los bytes de 'data'
+// consumidos; si aparece el marcador, solo hasta su final (lo que sigue
+// pertenece a la línea del boundary y se procesa aparte).
+static size_t feedWindow(MultipartParser &p, const uint8_t *data, size_t len)
+{
+  const size_t keep = p.markerLen - 1;
+  const size_t carry = p.winLen;
+  size_t n = sizeof(p.win) - p.winLen;
+  if (n > len)
+    n = len;
+  memcpy(p.win + p.winLen, data, n);
+  p.winLen += n;
+
+  const int pos = bmhFind(p, p.scanFrom);
+  if (pos >= 0)
+  {
+    emit(p, p.win, (size_t)pos);
+    // Lo retenido (carry) ya se buscó: el marcador acaba en lo recién copiado
+    const size_t end = (size_t)pos + p.markerLen;
+    p.winLen = 0;
+    p.scanFrom = 0;
+    if (p.state != MP_ERROR)
+    {
+      p.state = MP_BOUNDARY_LINE;
+      p.hdrLen = 0;
+    }
+    return end - carry;
+  }
+
+  if (p.winLen == sizeof(p.win))
+  {
+    // Ventana llena: sale todo salvo la cola que aún puede empezar un marcador
+    const size_t out = p.winLen - keep;
+    emit(p, p.win, out);
+    memmove(p.win, p.win + out, keep);
+    p.winLen = (uint16_t)keep;
+    p.scanFrom = 0;
+  }
+  else
+    p.scanFrom = (p.winLen > keep) ? (uint16_t)(p.winLen - keep) : 0;
+  return n;
+}
+
+// ================== API ====================
+
+bool multipartInit(MultipartParser &p, const char *boundary, size_t boundaryLen,
+                   MultipartPartCb onPart, MultipartDataCb onData, void *ctx)
+{
+  if (boundaryLen == 0 || boundaryLen > MULTIPART_BOUNDARY_MAX)
+    return false;
+
+  p.marker[0] = '\r';
+  p.marker[1] = '\n';
+  p.marker[2] = '-';
+  p.marker[3] = '-';
+  memcpy(p.marker + 4, boundary, boundaryLen);
+  p.markerLen = (uint8_t)(boundaryLen + 4);
+
+  // Tabla BMH: cuánto avanzar según el byte bajo el final de la ventana
+  for (size_t c = 0; c < sizeof(p.skip); c++)
+    p.skip[c] = p.markerLen;
+  for (uint8_t i = 0; i + 1 < p.markerLen; i++)
+    p.skip[(uint8_t)p.marker[i]] = (uint8_t)(p.markerLen - 1 - i);
+
+  p.state = MP_PREAMBLE;
+  p.discard = false;
+  p.parts = 0;
+  p.hdrLen = 0;
+  p.dataBytes = 0;
+  p.onPart = onPart;
+  p.onData = onData;
+  p.ctx = ctx;
+
+  // El cuerpo empieza por "--<boundary>" sin CRLF previo: se antepone
+  p.win[0] = '\r';
+  p.win[1] = '\n';
+  p.winLen = 2;
+  p.scanFrom = 0;
+  return true;
+}
+
+size_t multipartFeed(MultipartParser &p, const uint8_t *data, size_t len)
+{
+  size_t i = 0;
+  while (i < len)
+  {
+    if (p.state == MP_DONE)
+      return len; // epílogo: se ignora
+    if (p.state == MP_ERROR)
+      return i;
+
+    if (p.state == MP_PREAMBLE || p.state == MP_DATA)
+    {
+      i += feedWindow(p, data + i, len - i);
+      continue;
+    }
+
+    const uint8_t c = data[i++];
+    switch (p.state)
+    {
+    case MP_BOUNDARY_LINE:
+      // "--" justo tras el boundary: era el último
+      if (p.hdrLen < 2)
+      {
+        p.hdr[p.hdrLen++] = (char)c;
+        if (p.hdrLen == 2 && p.hdr[0] == '-' && p.hdr[1] == '-')
+        {
+          p.state = MP_DONE;
+          break;
+        }
+      }
+      if (c == '\n')
+      {
+        p.state = MP_HEADERS;
+        p.hdrLen = 0;
+      }
+      break;
+
+    case MP_HEADERS:
+      if (p.hdrLen >= sizeof(p.hdr) - 1)
+      {
+        p.state = MP_ERROR;
+        break;
+      }
+      p.hdr[p.hdrLen++] = (char)c;
+      if (p.hdrLen >= 4 && memcmp(p.hdr + p.hdrLen - 4, "\r\n\r\n", 4) == 0)
+      {
+        p.hdr[p.hdrLen] = '\0';
+        p.parts++;
+        p.discard = p.onPart && !p.onPart(p.ctx, p.hdr);
+        p.state = MP_DATA;
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+  return i;
+}
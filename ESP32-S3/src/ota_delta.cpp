@@ -0,0 +1,327 @@
+#include "ota_delta.hpp"
+
+#include <string.h>
+
+// ================== Helpers internos ====================
+
+static uint16_t rd16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void fallo(OtaDecoder &d, const char *motivo)
+{
+  d.error = motivo;
+  d.state = OD_ERROR;
+}
+
+// Entrega bytes reconstruidos y los guarda en la ventana
+static bool emitir(OtaDecoder &d, const uint8_t *data, size_t len)
+{
+  if (d.info.kind != OTA_RAW && d.outBytes + len > d.info.targetSize)
+  {
+    fallo(d, "La imagen excede el tamaño anunciado");
+    return false;
+  }
+  if (!d.onOut(d.ctx, data, len))
+  {
+    fallo(d, "Escritura de la imagen rechazada");
+    return false;
+  }
+
+  // Solo interesan los últimos OTA_WINDOW bytes
+  size_t skip = len > OTA_WINDOW ? len - OTA_WINDOW : 0;
+  for (size_t i = skip; i < len; i++)
+    d.win[(d.outBytes + i) % OTA_WINDOW] = data[i];
+  d.outBytes += len;
+  return true;
+}
+
+static bool leerCabecera(OtaDecoder &d)
+{
+  const uint8_t *h = d.hdr;
+  OtaImageInfo &info = d.info;
+  if (memcmp(h, OTA_MAGIC, 4) != 0)
+  {
+    fallo(d, "Formato de imagen desconocido");
+    return false;
+  }
+  if (h[4] != 1)
+  {
+    fallo(d, "Versión de contenedor no soportada");
+    return false;
+  }
+
+  info.kind = h[5];
+  info.window = rd16(h + 6);
+  info.targetSize = rd32(h + 8);
+  info.baseSize = rd32(h + 12);
+  memcpy(info.targetSha, h + 16, 32);
+  memcpy(info.baseSha, h + 48, 32);
+
+  if (info.kind != OTA_LZ && info.kind != OTA_DELTA)
+  {
+    fallo(d, "Tipo de imagen desconocido");
+    return false;
+  }
+  if (info.window == 0 || info.window > OTA_WINDOW || info.targetSize == 0)
+  {
+    fallo(d, "Cabecera de imagen inválida");
+    return false;
+  }
+  if (info.kind == OTA_DELTA && (info.baseSize == 0 || !d.onBase))
+  {
+    fallo(d, "Imagen diferencial sin base");
+    return false;
+  }
+  if (d.onHeader && !d.onHeader(d.ctx, info))
+  {
+    fallo(d, "Imagen rechazada");
+    return false;
+  }
+  d.state = OD_OP;
+  return true;
+}
+
+// Argumentos completos: prepara la operación
+static void empezarOperacion(OtaDecoder &d)
+{
+  switch (d.op)
+  {
+  case OP_LIT:
+    d.remaining = d.args[0];
+    d.state = d.remaining ? OD_LIT : OD_OP;
+    return;
+
+  case OP_COPY:
+    if (d.args[0] == 0 || d.args[0] > d.info.window || d.args[0] > d.outBytes)
+    {
+      fallo(d, "Distancia de copia inválida");
+      return;
+    }
+    d.src = d.args[0];
+    break;
+
+  case OP_BASE:
+  {
+    if (d.info.kind != OTA_DELTA)
+    {
+      fallo(d, "Copia de base en imagen no diferencial");
+      return;
+    }
+    // zigzag: 0, -1, 1, -2, 2...
+    const int32_t delta = (int32_t)((d.args[0] >> 1) ^ (0u - (d.args[0] & 1u)));
+    const int64_t off = (int64_t)d.baseNext + delta;
+    if (off < 0 || off + d.args[1] > (int64_t)d.info.baseSize)
+    {
+      fallo(d, "Copia fuera de la imagen base");
+      return;
+    }
+    d.src = (uint32_t)off;
+    d.baseNext = (uint32_t)off + d.args[1];
+    break;
+  }
+  }
+
+  d.remaining = d.args[1];
+  d.state = d.remaining ? OD_EXEC : OD_OP;
+}
+
+// Un tramo de OP_COPY / OP_BASE (como mucho 'max' bytes)
+static size_t ejecutarCopia(OtaDecoder &d, size_t max)
+{
+  uint8_t tmp[256];
+  size_t n = d.remaining;
+  if (n > max)
+    n = max;
+  if (n > sizeof(tmp))
+    n = sizeof(tmp);
+
+  if (d.op == OP_COPY)
+  {
+    // Con solape (dist < n) el tramo no pasa de 'dist': lo que se lee ya existe
+    if (n > d.src)
+      n = d.src;
+    const uint32_t from = d.outBytes - d.src;
+    for (size_t i = 0; i < n; i++)
+      tmp[i] = d.win[(from + i) % OTA_WINDOW];
+  }
+  else
+  {
+    if (!d.onBase(d.ctx, d.src, tmp, n))
+    {
+      fallo(d, "Lectura de la imagen base fallida");
+      return 0;
+    }
+    d.src += n;
+    d.baseBytes += n;
+  }
+
+  if (!emitir(d, tmp, n))
+    return 0;
+  d.remaining -= n;
+  if (d.remaining == 0)
+    d.state = OD_OP;
+  return n;
+}
+
+// ================== API ====================
+
+void otaDecInit(OtaDecoder &d, OtaHeaderCb onHeader, OtaOutCb onOut, OtaBaseCb onBase, void *ctx)
+{
+  memset(&d.info, 0, sizeof(d.info));
+  d.inBytes = 0;
+  d.outBytes = 0;
+  d.baseBytes = 0;
+  d.error = "";
+  d.onHeader = onHeader;
+  d.onOut = onOut;
+  d.onBase = onBase;
+  d.ctx = ctx;
+  d.state = OD_HEADER;
+  d.op = OP_END;
+  d.argIdx = 0;
+  d.shift = 0;
+  d.args[0] = d.args[1] = 0;
+  d.remaining = 0;
+  d.src = 0;
+  d.baseNext = 0;
+  d.hdrLen = 0;
+}
+
+size_t otaDecFeed(OtaDecoder &d, const uint8_t *data, size_t len)
+{
+  size_t used = 0;
+  size_t made = 0;
+
+  while (made < OTA_DEC_STEP)
+  {
+    switch (d.state)
+    {
+    case OD_HEADER:
+      if (used == len)
+        return used;
+      if (d.hdrLen == 0 && data[used] == OTA_IMAGE_MAGIC)
+      {
+        // .bin sin contenedor
+        d.info.kind = OTA_RAW;
+        if (d.onHeader && !d.onHeader(d.ctx, d.info))
+        {
+          fallo(d, "Imagen rechazada");
+          return used;
+        }
+        d.state = OD_RAW;
+        break;
+      }
+      d.hdr[d.hdrLen++] = data[used++];
+      d.inBytes++;
+      if (d.hdrLen == OTA_HDR_LEN && !leerCabecera(d))
+        return used;
+      break;
+
+    case OD_RAW:
+    {
+      size_t n = len - used;
+      if (n > OTA_DEC_STEP - made)
+        n = OTA_DEC_STEP - made;
+      if (n == 0)
+        return used;
+      if (!emitir(d, data + used, n))
+        return used;
+      used += n;
+      made += n;
+      d.inBytes += n;
+      break;
+    }
+
+    case OD_OP:
+      if (used == len)
+        return used;
+      d.op = data[used++];
+      d.inBytes++;
+      if (d.op == OP_END)
+      {
+        if (d.outBytes != d.info.targetSize)
+          fallo(d, "Imagen incompleta");
+        else
+          d.state = OD_DONE;
+        return used;
+      }
+      if (d.op > OP_BASE)
+      {
+        fallo(d, "Operación desconocida");
+        return used;
+      }
+      d.argIdx = 0;
+      d.shift = 0;
+      d.args[0] = d.args[1] = 0;
+      d.state = OD_ARGS;
+      break;
+
+    case OD_ARGS:
+    {
+      if (used == len)
+        return used;
+      const uint8_t b = data[used++];
+      d.inBytes++;
+      if (d.shift > 28)
+      {
+        fallo(d, "Argumento demasiado largo");
+        return used;
+      }
+      d.args[d.argIdx] |= (uint32_t)(b & 0x7F) << d.shift;
+      if (b & 0x80)
+      {
+        d.shift += 7;
+        break;
+      }
+      d.shift = 0;
+      if (++d.argIdx == (d.op == OP_LIT ? 1 : 2))
+      {
+        empezarOperacion(d);
+        if (d.state == OD_ERROR)
+          return used;
+      }
+      break;
+    }
+
+    case OD_LIT:
+    {
+      size_t n = len - used;
+      if (n > d.remaining)
+        n = d.remaining;
+      if (n > OTA_DEC_STEP - made)
+        n = OTA_DEC_STEP - made;
+      if (n == 0)
+        return used;
+      if (!emitir(d, data + used, n))
+        return used;
+      used += n;
+      made += n;
+      d.inBytes += n;
+      d.remaining -= n;
+      if (d.remaining == 0)
+        d.state = OD_OP;
+      break;
+    }
+
+    case OD_EXEC:
+    {
+      const size_t n = ejecutarCopia(d, OTA_DEC_STEP - made);
+      if (n == 0)
+        return used;
+      made += n;
+      break;
+    }
+
+    default: // OD_DONE / OD_ERROR
+      return used;
+    }
+  }
+  return used;
+}
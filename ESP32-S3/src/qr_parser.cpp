@@ -0,0 +1,225 @@
+#include "qr_parser.hpp"
+
+#include <string.h>
+
+// ================== Helpers internos ====================
+
+static inline bool isSpaceAscii(char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool isDigitAscii(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static inline bool isTokenChar(char c)
+{
+  return isDigitAscii(c) ||
+         (c >= 'a' && c <= 'f') ||
+         (c >= 'A' && c <= 'F') ||
+         (c == '-');
+}
+
+static QrSpan trim(QrSpan s)
+{
+  while (s.n > 0 && isSpaceAscii(s.p[0]))
+  {
+    s.p++;
+    s.n--;
+  }
+  while (s.n > 0 && isSpaceAscii(s.p[s.n - 1]))
+    s.n--;
+  return s;
+}
+
+static bool allDigits(QrSpan s)
+{
+  if (s.n == 0)
+    return false;
+  for (size_t i = 0; i < s.n; ++i)
+    if (!isDigitAscii(s.p[i]))
+      return false;
+  return true;
+}
+
+// Posición de 'lit' en 's' a partir de 'from', o -1
+static long find(QrSpan s, const char *lit, size_t from = 0)
+{
+  const size_t m = strlen(lit);
+  if (m == 0 || s.n < m)
+    return -1;
+  for (size_t i = from; i + m <= s.n; ++i)
+    if (s.p[i] == lit[0] && memcmp(s.p + i, lit, m) == 0)
+      return (long)i;
+  return -1;
+}
+
+static long findChar(QrSpan s, char c, size_t from = 0)
+{
+  for (size_t i = from; i < s.n; ++i)
+    if (s.p[i] == c)
+      return (long)i;
+  return -1;
+}
+
+// Valor de "key=" en la query de una URL (hasta '&' o el final), recortado
+static QrSpan queryParam(QrSpan url, const char *key)
+{
+  QrSpan query = url;
+  const long q = findChar(url, '?');
+  if (q >= 0)
+  {
+    query.p += q + 1;
+    query.n -= (size_t)q + 1;
+  }
+
+  QrSpan v = {query.p, 0};
+  const size_t kn = strlen(key);
+  long pos = 0;
+  while ((pos = find(query, key, (size_t)pos)) >= 0)
+  {
+    if ((size_t)pos + kn < query.n && query.p[pos + kn] == '=')
+      break;
+    pos++;
+  }
+  if (pos < 0)
+    return v;
+
+  const size_t start = (size_t)pos + kn + 1;
+  const long amp = findChar(query, '&', start);
+  v.p = query.p + start;
+  v.n = ((amp >= 0) ? (size_t)amp : query.n) - start;
+  return trim(v);
+}
+
+// Copia con '\0'; false si no cabe
+static bool put(char *out, size_t cap, size_t &len, const char *p, size_t n)
+{
+  if (len + n + 1 > cap)
+    return false;
+  memcpy(out + len, p, n);
+  len += n;
+  out[len] = '\0';
+  return true;
+}
+
+// ================== Ensamblado de líneas ====================
+
+void qrLineReset(QrLineAsm &a)
+{
+  a.len = 0;
+  a.buf[0] = '\0';
+}
+
+bool qrLineFeed(QrLineAsm &a, uint8_t b, QrSpan &line)
+{
+  if (b == 0x0D || b == 0x0A)
+  {
+    if (a.len == 0)
+      return false;
+    a.buf[a.len] = '\0';
+    line = trim(QrSpan{a.buf, a.len});
+    a.len = 0;
+    return line.n > 0;
+  }
+
+  // Solo ASCII imprimible (0x00/0xFF y demás basura del lector se ignoran)
+  if (b < 32 || b > 126)
+    return false;
+
+  if (a.len >= QR_LINE_MAX)
+    a.len = 0; // protección anti-cuelgues: línea demasiado larga
+  a.buf[a.len++] = (char)b;
+  return false;
+}
+
+// ================== Clasificación ====================
+
+bool qrSplitPrefix(QrSpan line, QrScan &out)
+{
+  out.direccion = 0;
+  out.machine = 0;
+  out.body = line;
+
+  long tag = find(line, "IN:");
+  size_t tagLen = 3;
+  if (tag >= 0)
+    out.direccion = 1;
+  else if ((tag = find(line, "OUT:")) >= 0)
+  {
+    out.direccion = 2;
+    tagLen = 4;
+  }
+  else
+    return false;
+
+  // Id de torno: dígitos justo antes del prefijo
+  size_t start = (size_t)tag;
+  while (start > 0 && isDigitAscii(line.p[start - 1]))
+    start--;
+  uint32_t id = 0;
+  for (size_t i = start; i < (size_t)tag && id < 256; ++i)
+    id = id * 10 + (uint32_t)(line.p[i] - '0');
+  if (id > 0 && id < 256)
+    out.machine = (uint8_t)id;
+
+  out.body.p = line.p + tag + tagLen;
+  out.body.n = line.n - (size_t)tag - tagLen;
+  return true;
+}
+
+QRKind qrNormalize(QrSpan body, char *out, size_t cap)
+{
+  if (!out || cap == 0)
+    return QR_UNKNOWN;
+  out[0] = '\0';
+
+  QrSpan s = trim(body);
+  if (s.n >= 2 && (s.p[0] == '"' || s.p[0] == '\'') && s.p[s.n - 1] == s.p[0])
+    s = trim(QrSpan{s.p + 1, s.n - 2});
+
+  size_t len = 0;
+
+  // Odoo TPV: ...tpv.museoelder.es/...?access_token=<hex/guiones>
+  // (también lo contiene el dominio de TEC, por eso va primero y sigue si no hay token)
+  if (find(s, "tpv.museoelder.es") >= 0)
+  {
+    const QrSpan token = queryParam(s, "access_token");
+    bool ok = token.n >= 10;
+    for (size_t i = 0; ok && i < token.n; ++i)
+      ok = isTokenChar(token.p[i]);
+    if (ok)
+      return put(out, cap, len, token.p, token.n) ? QR_ODOO : QR_UNKNOWN;
+  }
+
+  // TEC: ...wptpv.museoelder.es/...?ticket_id=<n>&event_id=<n>
+  if (find(s, "wptpv.museoelder.es") >= 0)
+  {
+    const QrSpan tid = queryParam(s, "ticket_id");
+    const QrSpan eid = queryParam(s, "event_id");
+    if (allDigits(tid) && allDigits(eid))
+    {
+      const bool ok = put(out, cap, len, "ticket_id=", 10) &&
+                      put(out, cap, len, tid.p, tid.n) &&
+                      put(out, cap, len, "&event_id=", 10) &&
+                      put(out, cap, len, eid.p, eid.n);
+      if (!ok)
+        out[0] = '\0';
+      return ok ? QR_TEC : QR_UNKNOWN;
+    }
+  }
+
+  // MAGE: localizador numérico de 17 a 20 dígitos
+  if (s.n >= 17 && s.n <= 20 && allDigits(s))
+    return put(out, cap, len, s.p, s.n) ? QR_MAGE : QR_UNKNOWN;
+
+  return QR_UNKNOWN;
+}
+
+bool qrEquals(QrSpan s, const char *lit)
+{
+  const size_t m = strlen(lit);
+  return s.n == m && memcmp(s.p, lit, m) == 0;
+}
@@ -0,0 +1,129 @@
+#include "scan_cache.hpp"
+
+struct ScanEntry
+{
+  uint32_t key;    // 0 = libre
+  uint32_t seenMs; // última vez que se leyó (o se decidió)
+  uint8_t outcome; // ValidateOutcome
+};
+
+static ScanEntry g_entries[SCAN_CACHE_LEN];
+static ScanCacheStats g_stats = {};
+
+static uint32_t windowMs(uint8_t outcome)
+{
+  switch (outcome)
+  {
+  case VAUTH_IN:
+  case VAUTH_OUT:
+    return SCAN_DEDUP_MS;
+  case VTIME_NOT_YET:
+    return SCAN_NOT_YET_MS;
+  case VDENIED:
+    return SCAN_REJECT_MS;
+  default:
+    return 0;
+  }
+}
+
+static ScanEntry *find(uint32_t key)
+{
+  for (ScanEntry &e : g_entries)
+    if (e.key == key)
+      return &e;
+  return nullptr;
+}
+
+uint32_t scanCacheKey(const char *code, int direccion)
+{
+  uint32_t h = 2166136261UL;
+  for (const char *p = code; *p; ++p)
+  {
+    h ^= (uint8_t)*p;
+    h *= 16777619UL;
+  }
+  h ^= (uint8_t)direccion;
+  h *= 16777619UL;
+  return h ? h : 1;
+}
+
+bool scanCacheLookup(uint32_t key, uint8_t &outcome)
+{
+  ScanEntry *e = find(key);
+  const uint32_t now = millis();
+  if (!e || now - e->seenMs > windowMs(e->outcome))
+  {
+    if (e)
+      e->key = 0; // caducada
+    g_stats.misses++;
+    return false;
+  }
+
+  outcome = e->outcome;
+  g_stats.hits++;
+  if (outcome != VAUTH_IN && outcome != VAUTH_OUT)
+  {
+    e->seenMs = now; // mientras el QR rechazado siga delante, la ventana se alarga
+    g_stats.rejects++;
+  }
+  return true;
+}
+
+void scanCacheStore(uint32_t key, uint8_t outcome)
+{
+  if (key == 0 || windowMs(outcome) == 0)
+    return;
+
+  ScanEntry *e = find(key);
+  if (!e)
+  {
+    // Hueco libre o, si no hay, el visto hace más tiempo
+    e = &g_entries[0];
+    for (ScanEntry &c : g_entries)
+    {
+      if (c.key == 0)
+      {
+        e = &c;
+        break;
+      }
+      if ((int32_t)(c.seenMs - e->seenMs) < 0)
+        e = &c;
+    }
+  }
+
+  e->key = key;
+  e->seenMs = millis();
+  e->outcome = outcome;
+  g_stats.stored++;
+}
+
+void scanCacheForget(uint32_t key)
+{
+  ScanEntry *e = key ? find(key) : nullptr;
+  if (e)
+    e->key = 0;
+}
+
+void scanCacheClear()
+{
+  for (ScanEntry &e : g_entries)
+    e.key = 0;
+}
+
+ScanCacheStats scanCacheStats()
+{
+  return g_stats;
+}
+
+String scanCacheStatsJson()
+{
+  const ScanCacheStats st = scanCacheStats();
+  String json = "{\"hits\":" + String(st.hits);
+  json += ",\"rejects\":" + String(st.rejects);
+  json += ",\"misses\":" + String(st.misses);
+  json += ",\"stored\":" + String(st.stored);
+  json += ",\"dedup_ms\":" + String((unsigned long)SCAN_DEDUP_MS);
+  json += ",\"reject_ms\":" + String((unsigned long)SCAN_REJECT_MS);
+  json += "}";
+  return json;
+}
@@ -1,241 +1,1052 @@
 #include <Arduino.h>
 #include <LittleFS.h>
 #include <Ethernet.h>
-#include <map>
+#include <algorithm>
+#include <new>
+#include <esp_heap_caps.h>
 
 #include "ticket.hpp"
 #include "definiciones.hpp"
 #include "http.hpp"
 #include "time.hpp"
+#include "logBuf.hpp"
+
+// ====== Formato del índice ======
+// Cabecera + registros de ancho fijo ordenados por hash. No se guarda el
+// código: con 64 bits la probabilidad de colisión en decenas de miles de
+// entradas es despreciable y cada entrada ocupa 11 bytes (+1 bit de consumo).
+struct __attribute__((packed)) TicketRec
+{
+  uint64_t hash;   // FNV-1a 64 del código
+  uint16_t minuto; // HH*60+MM de la franja
+  uint8_t pasos;   // personas que entran con el código (entradas de grupo)
+};
+
+struct TicketIdxHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recSize;
+  uint32_t count; // se escribe al final: 0 = fichero a medias
+  uint32_t epoch; // hora de la descarga (0 si no había hora válida)
+};
+
+static const uint32_t TICKETS_MAGIC = 0x31584B54; // "TKX1"
+static const uint16_t TICKETS_VERSION = 2; // 2: pasos por registro
+static const uint32_t TICKETS_USED_FLUSH_MS = 2000; // agrupa marcas antes de escribir en flash
+static const size_t TICKETS_HEAP_MARGIN = 48 * 1024; // sin PSRAM: lo que se deja libre a WiFi/TCP/web
 
 // ====== Estado ======
-std::map<String, TicketInfo> ticketsLocales;
-int countTickets = 0;
-const int numMaxTickets = 500;
+static TicketRec *g_recs = nullptr; // índice en PSRAM; nullptr → búsqueda en g_idxFile
+static File g_idxFile;
+static uint32_t g_count = 0;
+static uint8_t *g_used = nullptr; // bitset de consumo
+static bool g_usedDirty = false;
+static uint32_t g_usedDirtyMs = 0;
+static uint32_t g_nextDownloadMs = 0;
+static TicketsStats g_stats = {};
 
-static bool g_httpOk = false;
+// Descarga en curso
+struct IdxBuilder
+{
+  TicketRec *recs;
+  uint32_t n;
+  uint32_t cap;
+  uint32_t dropped;
+  bool psram;
+  uint8_t lineLen;
+  char line[96];
+};
+static IdxBuilder *g_build = nullptr;
 
-// ====== helpers formatos ======
-static bool is36AlphaDash(const String &s)
+// ====== helpers ======
+static uint64_t hashCodigo(const char *s, size_t n)
 {
-  if ((int)s.length() != 36)
-    return false;
-  for (char c : s)
+  uint64_t h = 1469598103934665603ULL;
+  for (size_t i = 0; i < n; i++)
   {
-    if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-'))
-      return false;
+    h ^= (uint8_t)s[i];
+    h *= 1099511628211ULL;
   }
-  return true;
+  return h;
 }
-static bool isDigitsLen(const String &s, int n)
+
+static inline size_t bitsetBytes(uint32_t n)
 {
-  if ((int)s.length() != n)
+  return (n + 7) / 8;
+}
+
+static inline bool usado(uint32_t i)
+{
+  return g_used && (g_used[i >> 3] & (1u << (i & 7)));
+}
+
+static bool codigoValido(const char *s, size_t n)
+{
+  if (n == 36)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      char c = s[i];
+      if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-'))
+        return false;
+    }
+    return true;
+  }
+  if (n != 6 && n != 19)
     return false;
-  for (char c : s)
-    if (!(c >= '0' && c <= '9'))
+  for (size_t i = 0; i < n; i++)
+    if (!(s[i] >= '0' && s[i] <= '9'))
       return false;
   return true;
 }
 
-// línea: "<CODE>:HH:MM;"
-static bool parseLinea(const String &linea, String &codeOut, uint32_t &segsOut)
+// Pasos de la línea: 1 si no vienen; acotados a lo que cabe en el registro
+static uint8_t parsePasos(const char *s)
 {
-  int p1 = linea.indexOf(':');
-  if (p1 <= 0)
-    return false;
-  int p2 = linea.indexOf(':', p1 + 1);
-  if (p2 < 0)
+  const int n = atoi(s);
+  if (n < 1)
+    return 1;
+  return (uint8_t)(n > 255 ? 255 : n);
+}
+
+// línea v2: "<CODE>:HH:MM;" o "<CODE>:HH:MM;<pasos>"
+// línea v1: "<CODE>:<pasos>:HH:MM:SS" (GET /entries)
+static bool parseLinea(char *linea, TicketRec &rec)
+{
+  while (*linea == ' ' || *linea == '\t')
+    linea++;
+
+  char *p1 = strchr(linea, ':');
+  if (!p1 || p1 == linea)
     return false;
-  int p3 = linea.indexOf(';', p2 + 1);
-  if (p3 < 0)
+  char *p2 = strchr(p1 + 1, ':');
+  if (!p2)
     return false;
 
-  String code = linea.substring(0, p1);
-  code.trim();
-  String sh = linea.substring(p1 + 1, p2);
-  sh.trim();
-  String sm = linea.substring(p2 + 1, p3);
-  sm.trim();
+  int h, m;
+  uint8_t pasos = 1;
+  char *fin = strchr(p2 + 1, ';');
+  if (fin)
+  {
+    h = atoi(p1 + 1);
+    m = atoi(p2 + 1);
+    pasos = parsePasos(fin + 1);
+  }
+  else
+  {
+    char *p3 = strchr(p2 + 1, ':');
+    if (!p3)
+      return false;
+    pasos = parsePasos(p1 + 1);
+    h = atoi(p2 + 1);
+    m = atoi(p3 + 1);
+  }
 
-  bool okCode = is36AlphaDash(code) || isDigitsLen(code, 6) || isDigitsLen(code, 19);
-  if (!okCode)
+  size_t codeLen = p1 - linea;
+  while (codeLen > 0 && (linea[codeLen - 1] == ' ' || linea[codeLen - 1] == '\t'))
+    codeLen--;
+  if (!codigoValido(linea, codeLen))
     return false;
 
-  int h = sh.toInt(), m = sm.toInt();
   if (h < 0 || h > 23 || m < 0 || m > 59)
     return false;
 
-  codeOut = code;
-  segsOut = (uint32_t)h * 3600UL + (uint32_t)m * 60UL;
+  rec.hash = hashCodigo(linea, codeLen);
+  rec.minuto = (uint16_t)(h * 60 + m);
+  rec.pasos = pasos;
   return true;
 }
 
-// ---------------- Carga de tickets (texto plano local ó remoto) ----------------
-bool cargarTicketsDesdeTextoPlano(const String &textoPlano)
+// ====== Acceso al índice activo ======
+static bool leerRegistro(uint32_t i, TicketRec &rec)
 {
-  ticketsLocales.clear();
-  countTickets = 0;
-
-  int start = 0;
-  int end = textoPlano.indexOf('\n', start);
-  if (end != -1)
+  if (g_recs)
   {
-    String first = textoPlano.substring(start, end);
-    first.trim();
-    if (first == "OK")
-      start = end + 1;
+    rec = g_recs[i];
+    return true;
   }
+  if (!g_idxFile)
+    return false;
+  if (!g_idxFile.seek(sizeof(TicketIdxHeader) + (size_t)i * sizeof(TicketRec)))
+    return false;
+  return g_idxFile.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+}
 
-  while (start < textoPlano.length() && countTickets < numMaxTickets)
+static bool buscar(uint64_t hash, uint32_t &idx, TicketRec &rec)
+{
+  uint32_t lo = 0, hi = g_count;
+  while (lo < hi)
   {
-    end = textoPlano.indexOf('\n', start);
-    if (end == -1)
-      end = textoPlano.length();
-    String linea = textoPlano.substring(start, end);
-    linea.trim();
-    start = end + 1;
-    if (linea.length() == 0)
-      continue;
-
-    String code;
-    uint32_t segs = 0;
-    if (parseLinea(linea, code, segs))
+    const uint32_t mid = lo + (hi - lo) / 2;
+    if (!leerRegistro(mid, rec))
+      return false;
+    if (rec.hash == hash)
     {
-      ticketsLocales[code] = {/*pasos*/ 1, segs};
-      countTickets++;
+      idx = mid;
+      return true;
     }
+    if (rec.hash < hash)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
+  return false;
+}
 
-  if (debugSerie)
+static void liberarIndice()
+{
+  if (g_idxFile)
+    g_idxFile.close();
+  free(g_recs);
+  g_recs = nullptr;
+  free(g_used);
+  g_used = nullptr;
+  g_count = 0;
+  g_usedDirty = false;
+}
+
+// Reserva para 'cap' registros: PSRAM si la hay; si no, lo que quepa en heap
+static TicketRec *reservarRegistros(uint32_t &cap, bool &psram)
+{
+  cap = TICKETS_MAX;
+  psram = false;
+  if (psramFound())
   {
-    Serial.printf("Se han cargado %d tickets con hora en RAM\n", countTickets);
-    if (countTickets >= numMaxTickets)
+    TicketRec *p = (TicketRec *)ps_malloc((size_t)cap * sizeof(TicketRec));
+    if (p)
     {
-      Serial.printf("Se ha alcanzado el máximo permitido de entradas\n");
+      psram = true;
+      return p;
     }
   }
-  return (countTickets > 0);
+
+  const size_t libre = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  if (libre <= TICKETS_HEAP_MARGIN + 64 * sizeof(TicketRec))
+  {
+    cap = 0;
+    return nullptr;
+  }
+  const size_t maxRecs = (libre - TICKETS_HEAP_MARGIN) / sizeof(TicketRec);
+  if (maxRecs < cap)
+    cap = (uint32_t)maxRecs;
+  return (TicketRec *)malloc((size_t)cap * sizeof(TicketRec));
 }
 
-bool descargarTicketsLocales()
+// ====== Persistencia ======
+static bool escribirIndice(const TicketRec *recs, uint32_t n)
 {
-  String texto;
-  bool ok = getEntradas(texto); // http.cpp
+  File f = LittleFS.open(TICKETS_IDX_PATH, FILE_WRITE);
+  if (!f)
+    return false;
+
+  TicketIdxHeader h = {TICKETS_MAGIC, TICKETS_VERSION, (uint16_t)sizeof(TicketRec), 0, (uint32_t)epochActual()};
+  bool ok = f.write((const uint8_t *)&h, sizeof(h)) == sizeof(h);
+
+  const uint8_t *p = (const uint8_t *)recs;
+  const size_t total = (size_t)n * sizeof(TicketRec);
+  for (size_t off = 0; ok && off < total; off += 4096)
+  {
+    const size_t k = (total - off < 4096) ? total - off : 4096;
+    ok = f.write(p + off, k) == k;
+  }
+
+  // La cabecera con 'count' va la última: un corte a medias deja count = 0
+  if (ok)
+  {
+    h.count = n;
+    ok = f.seek(0) && f.write((const uint8_t *)&h, sizeof(h)) == sizeof(h);
+  }
+  f.close();
+
   if (!ok)
+    LittleFS.remove(TICKETS_IDX_PATH);
+  return ok;
+}
+
+static void escribirUsados()
+{
+  File f = LittleFS.open(TICKETS_USED_PATH, FILE_WRITE);
+  if (!f)
+    return;
+  f.write(g_used, bitsetBytes(g_count));
+  f.close();
+  g_usedDirty = false;
+}
+
+static void cargarUsados()
+{
+  g_stats.consumed = 0;
+  g_used = (uint8_t *)calloc(bitsetBytes(g_count), 1);
+  if (!g_used)
+    return;
+
+  File f = LittleFS.open(TICKETS_USED_PATH, FILE_READ);
+  if (!f)
+    return;
+  if (f.size() == bitsetBytes(g_count))
+    f.read(g_used, bitsetBytes(g_count));
+  f.close();
+
+  for (uint32_t i = 0; i < g_count; i++)
+    if (usado(i))
+      g_stats.consumed++;
+}
+
+bool ticketsBegin()
+{
+  liberarIndice();
+
+  File f = LittleFS.open(TICKETS_IDX_PATH, FILE_READ);
+  if (!f)
+    return false;
+
+  TicketIdxHeader h;
+  const bool okHdr = f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+                     h.magic == TICKETS_MAGIC && h.version == TICKETS_VERSION &&
+                     h.recSize == sizeof(TicketRec) && h.count > 0 && h.count <= TICKETS_MAX &&
+                     f.size() == sizeof(h) + (size_t)h.count * sizeof(TicketRec);
+  if (!okHdr)
+  {
+    f.close();
+    logbuf_pushf("[TICKETS] Índice local inválido, se ignora");
     return false;
+  }
 
-  bool cargado = cargarTicketsDesdeTextoPlano(texto);
+  // Con PSRAM el índice se sube entero a memoria; si no, se busca en el fichero
+  TicketRec *recs = psramFound() ? (TicketRec *)ps_malloc((size_t)h.count * sizeof(TicketRec)) : nullptr;
+  if (recs)
+  {
+    const size_t total = (size_t)h.count * sizeof(TicketRec);
+    if (f.read((uint8_t *)recs, total) != total)
+    {
+      free(recs);
+      f.close();
+      return false;
+    }
+    f.close();
+    g_recs = recs;
+  }
+  else
+    g_idxFile = f;
+
+  g_count = h.count;
+  cargarUsados();
+  g_stats.count = g_count;
+  g_stats.inPsram = (g_recs != nullptr);
+  g_stats.loadedMs = millis();
+
+  logbuf_pushf("[TICKETS] Índice local: %u entradas (%u usadas, %s)",
+               (unsigned)g_count, (unsigned)g_stats.consumed, g_recs ? "PSRAM" : "LittleFS");
   if (debugSerie)
+    Serial.printf("[TICKETS] Índice local: %u entradas (%u usadas, %s)\n",
+                  (unsigned)g_count, (unsigned)g_stats.consumed, g_recs ? "PSRAM" : "LittleFS");
+  return true;
+}
+
+// ====== Descarga y construcción del índice ======
+static void builderLinea(IdxBuilder *b)
+{
+  if (b->lineLen == 0)
+    return;
+  b->line[b->lineLen] = '\0';
+  b->lineLen = 0;
+
+  TicketRec rec;
+  if (!parseLinea(b->line, rec))
   {
-    if (cargado)
-      Serial.println("[TICKETS] Descargados y cargados en RAM");
-    else
-      Serial.println("[TICKETS] Respuesta sin entradas válidas");
+    if (strcmp(b->line, "OK") != 0)
+      b->dropped++;
+    return;
   }
-  return cargado;
+  if (b->n >= b->cap)
+  {
+    b->dropped++;
+    return;
+  }
+  b->recs[b->n++] = rec;
 }
 
-// ---------------- Verificación local ----------------
-int verificarTicket(const String &codigoTicket)
+static bool onEntradasChunk(void *ctx, const uint8_t *data, size_t len)
 {
-  auto it = ticketsLocales.find(codigoTicket);
-  if (it == ticketsLocales.end())
+  IdxBuilder *b = static_cast<IdxBuilder *>(ctx);
+  for (size_t i = 0; i < len; i++)
   {
-    if (debugSerie)
-      Serial.printf("WARNING: Ticket no encontrado en memoria: %s\n", codigoTicket.c_str());
-    return 3; // no existe
+    const char c = (char)data[i];
+    if (c == '\n')
+      builderLinea(b);
+    else if (c != '\r' && b->lineLen < sizeof(b->line) - 1)
+      b->line[b->lineLen++] = c;
   }
+  return true;
+}
+
+// Ordena, quita duplicados, conserva las marcas de consumo del índice
+// anterior y sustituye índice y bitset (en memoria y en LittleFS)
+static bool instalarIndice(IdxBuilder *b)
+{
+  if (b->n == 0)
+    return false;
 
-  TicketInfo t = it->second;
-  unsigned long ahora = segundosActualesDelDia();
+  std::sort(b->recs, b->recs + b->n,
+            [](const TicketRec &x, const TicketRec &y)
+            { return x.hash < y.hash; });
 
-  if (ahora + MARGEN_ANTICIPACION_S >= t.segundosEntrada)
+  uint32_t n = 0;
+  for (uint32_t r = 0; r < b->n; r++)
   {
-    ticketsLocales.erase(it); // consume para evitar reutilización
-    if (debugSerie)
+    if (n > 0 && b->recs[n - 1].hash == b->recs[r].hash)
     {
-      Serial.printf("Ticket válido (offline): %s | Entrada: %lu | Ahora: %lu | Pasos: %d\n",
-                    codigoTicket.c_str(), t.segundosEntrada, ahora, t.pasos);
+      if (b->recs[r].minuto < b->recs[n - 1].minuto)
+        b->recs[n - 1].minuto = b->recs[r].minuto;
+      if (b->recs[r].pasos > b->recs[n - 1].pasos)
+        b->recs[n - 1].pasos = b->recs[r].pasos;
+      continue;
     }
-    // Si usas pasosTotales global, puedes asignarlo aquí:
-    // pasosTotales = t.pasos;
-    return 1;
+    b->recs[n++] = b->recs[r];
   }
-  else
+
+  uint8_t *used = (uint8_t *)calloc(bitsetBytes(n), 1);
+  if (!used)
+    return false;
+
+  // Lo consumido aquí sigue consumido aunque el backend aún no lo sepa
+  uint32_t consumidas = 0;
+  for (uint32_t i = 0; i < g_count; i++)
   {
-    unsigned long falta = (t.segundosEntrada > ahora) ? (t.segundosEntrada - ahora) : 0;
-    if (debugSerie)
+    TicketRec old;
+    if (!usado(i) || !leerRegistro(i, old))
+      continue;
+    const TicketRec *it = std::lower_bound(b->recs, b->recs + n, old,
+                                           [](const TicketRec &x, const TicketRec &y)
+                                           { return x.hash < y.hash; });
+    if (it != b->recs + n && it->hash == old.hash)
     {
-      Serial.printf("🕒 Aún no es hora (offline): %s | Faltan %lu s\n",
-                    codigoTicket.c_str(), falta);
+      const uint32_t j = (uint32_t)(it - b->recs);
+      used[j >> 3] |= (uint8_t)(1u << (j & 7));
+      consumidas++;
     }
-    return 2; // aún no
   }
+
+  liberarIndice();
+  LittleFS.remove(TICKETS_IDX_PATH);
+  const bool escrito = escribirIndice(b->recs, n);
+
+  g_used = used;
+  g_count = n;
+  if (b->psram)
+  {
+    g_recs = b->recs; // se queda residente
+    b->recs = nullptr;
+  }
+  else if (escrito)
+    g_idxFile = LittleFS.open(TICKETS_IDX_PATH, FILE_READ);
+
+  if (!g_recs && !g_idxFile)
+  {
+    logbuf_pushf("[TICKETS] ERROR: no se pudo guardar el índice local");
+    liberarIndice();
+    return false;
+  }
+  escribirUsados();
+
+  g_stats.count = n;
+  g_stats.consumed = consumidas;
+  g_stats.dropped = b->dropped;
+  g_stats.inPsram = (g_recs != nullptr);
+  g_stats.loadedMs = millis();
+  return true;
 }
 
-// ---------------- Pendientes (LittleFS) ----------------
-void guardarTicketPendiente(const String &ticketCode, int pasosTotales)
+static void onEntradasDone(HttpReqKind /*kind*/, bool ok)
 {
-  // Crea si no existe, añade si existe
-  File file = LittleFS.open(PENDIENTES_PATH, LittleFS.exists(PENDIENTES_PATH) ? FILE_APPEND : FILE_WRITE);
-  if (!file)
+  IdxBuilder *b = g_build;
+  g_build = nullptr;
+  if (!b)
+    return;
+
+  if (ok)
   {
+    builderLinea(b); // última línea sin '\n'
+    ok = instalarIndice(b);
+  }
+
+  if (ok)
+  {
+    logbuf_pushf("[TICKETS] Índice actualizado: %u entradas, %u descartadas",
+                 (unsigned)g_stats.count, (unsigned)g_stats.dropped);
     if (debugSerie)
-      Serial.println("ERROR: No se pudo abrir pendientes.txt (LittleFS)");
-    return;
+      Serial.printf("[TICKETS] Índice actualizado: %u entradas, %u descartadas (%s)\n",
+                    (unsigned)g_stats.count, (unsigned)g_stats.dropped, g_stats.inPsram ? "PSRAM" : "LittleFS");
   }
-  file.print(ticketCode);
-  file.print(":");
-  file.print(String(pasosTotales));
-  file.print(";\n");
-  file.close();
+  else
+    logbuf_pushf("[TICKETS] Descarga de entradas fallida");
+
+  free(b->recs);
+  delete b;
+  g_nextDownloadMs = millis() + (ok ? TICKETS_REFRESH_MS : TICKETS_RETRY_MS);
+}
+
+bool ticketsDescargar()
+{
+  if (g_build)
+    return false;
+
+  IdxBuilder *b = new (std::nothrow) IdxBuilder();
+  if (b)
+    b->recs = reservarRegistros(b->cap, b->psram);
+  if (!b || !b->recs)
+  {
+    logbuf_pushf("[TICKETS] Sin memoria para descargar entradas");
+    delete b;
+    g_nextDownloadMs = millis() + TICKETS_RETRY_MS;
+    return false;
+  }
+
+  g_build = b;
+  if (!httpSubmitStream(REQ_ENTRADAS, onEntradasChunk, b, onEntradasDone, TICKETS_DOWNLOAD_MS))
+  {
+    g_build = nullptr;
+    free(b->recs);
+    delete b;
+    g_nextDownloadMs = millis() + TICKETS_RETRY_MS;
+    return false;
+  }
+  return true;
+}
+
+bool ticketsDescargando()
+{
+  return g_build != nullptr;
+}
+
+bool ticketsToca()
+{
+  return !g_build && (int32_t)(millis() - g_nextDownloadMs) >= 0;
+}
+
+bool ticketsDisponibles()
+{
+  return g_count > 0;
+}
+
+void ticketsLoop()
+{
+  if (g_usedDirty && (millis() - g_usedDirtyMs) >= TICKETS_USED_FLUSH_MS)
+    escribirUsados();
+}
+
+// ---------------- Verificación local ----------------
+int verificarTicket(const String &codigoTicket, uint8_t *pasos)
+{
+  const uint32_t t0 = micros();
+  int r = TICKET_NO_EXISTE;
+  uint32_t idx = 0;
+  TicketRec rec;
+
+  if (g_count > 0 && buscar(hashCodigo(codigoTicket.c_str(), codigoTicket.length()), idx, rec))
+  {
+    g_stats.hits++;
+    if (usado(idx))
+      r = TICKET_YA_USADO;
+    else
+    {
+      // Sin hora válida no se puede comprobar la franja: se acepta
+      char hhmmss[9];
+      const unsigned long ahora = segundosActualesDelDia();
+      if (!horaLocal_HHMMSS(hhmmss) || ahora + MARGEN_ANTICIPACION_S >= (unsigned long)rec.minuto * 60UL)
+      {
+        if (g_used)
+          g_used[idx >> 3] |= (uint8_t)(1u << (idx & 7));
+        g_stats.consumed++;
+        if (!g_usedDirty)
+          g_usedDirtyMs = millis();
+        g_usedDirty = true;
+        r = TICKET_OK;
+        if (pasos)
+          *pasos = rec.pasos ? rec.pasos : 1;
+      }
+      else
+        r = TICKET_AUN_NO;
+    }
+  }
+
+  const uint32_t us = micros() - t0;
+  g_stats.lookups++;
+  g_stats.lastLookupUs = us;
+  if (us > g_stats.maxLookupUs)
+    g_stats.maxLookupUs = us;
 
   if (debugSerie)
+    Serial.printf("[TICKETS] %s → %d (%lu us)\n", codigoTicket.c_str(), r, (unsigned long)us);
+  return r;
+}
+
+TicketsStats ticketsStats()
+{
+  return g_stats;
+}
+
+String ticketsStatsJson()
+{
+  String json = "{\"count\":" + String(g_stats.count);
+  json += ",\"consumed\":" + String(g_stats.consumed);
+  json += ",\"dropped\":" + String(g_stats.dropped);
+  json += ",\"bytes_per_ticket\":" + String((unsigned)sizeof(TicketRec));
+  json += ",\"psram\":" + String(g_stats.inPsram ? "true" : "false");
+  json += ",\"lookups\":" + String(g_stats.lookups);
+  json += ",\"hits\":" + String(g_stats.hits);
+  json += ",\"last_lookup_us\":" + String(g_stats.lastLookupUs);
+  json += ",\"max_lookup_us\":" + String(g_stats.maxLookupUs);
+  json += ",\"age_s\":" + String(g_stats.loadedMs ? (millis() - g_stats.loadedMs) / 1000UL : 0UL);
+  const PendientesStats p = pendientesStats();
+  json += ",\"pending\":{\"count\":" + String(p.pending);
+  json += ",\"segments\":" + String(p.segments);
+  json += ",\"appended\":" + String(p.appended);
+  json += ",\"acked\":" + String(p.acked);
+  json += ",\"batches\":" + String(p.batches);
+  json += ",\"failed_posts\":" + String(p.failedPosts);
+  json += ",\"lost\":" + String(p.lost);
+  json += "}}";
+  return json;
+}
+
+// ---------------- Pendientes (diario binario en LittleFS) ----------------
+// Cada validación local se añade como una trama autocontenida al segmento
+// activo (/pend/NNNNNNNN.jnl). Un corte de luz a mitad de escritura deja como
+// mucho una trama incompleta al final, que el CRC descarta al arrancar. El
+// cursor (/pend.cur) solo avanza cuando el backend confirma un bloque; los
+// segmentos ya confirmados se borran.
+struct __attribute__((packed)) JnlFrameHdr
+{
+  uint8_t magic;
+  uint8_t len;    // bytes del código
+  uint16_t pasos;
+  uint32_t seq;   // número de orden (diagnóstico)
+};
+
+struct JnlCursor
+{
+  uint32_t magic;
+  uint32_t seg;
+  uint32_t off;
+  uint32_t crc;
+};
+
+static const uint8_t JNL_FRAME_MAGIC = 0xA5;
+static const uint32_t JNL_CURSOR_MAGIC = 0x3152434A; // "JCR1"
+
+static File g_jnlFile;           // segmento activo abierto en modo append
+static uint32_t g_jnlFirst = 1;  // segmento más antiguo que existe
+static uint32_t g_jnlLast = 1;   // segmento activo
+static uint32_t g_jnlWriteOff = 0;
+static uint32_t g_jnlSeq = 0;
+static JnlCursor g_jnlCur = {JNL_CURSOR_MAGIC, 1, 0, 0};
+static PendientesStats g_pend = {};
+
+// Bloque en vuelo: dónde queda el cursor si el backend lo confirma
+static bool g_pendEnVuelo = false;
+static uint32_t g_pendSeg = 0, g_pendOff = 0, g_pendN = 0;
+static uint32_t g_pendNextMs = 0;
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t n)
+{
+  crc = ~crc;
+  while (n--)
   {
-    Serial.printf("Pendiente guardado → %s:%d\n", ticketCode.c_str(), pasosTotales);
+    crc ^= *data++;
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
   }
+  return ~crc;
 }
 
-bool hayTicketsPendientes()
+static void rutaSegmento(uint32_t seg, char *out, size_t cap)
+{
+  snprintf(out, cap, JOURNAL_DIR "/%08lu.jnl", (unsigned long)seg);
+}
+
+static uint32_t crcCursor(const JnlCursor &c)
+{
+  return crc32Update(0, (const uint8_t *)&c, offsetof(JnlCursor, crc));
+}
+
+static bool guardarCursor()
+{
+  g_jnlCur.magic = JNL_CURSOR_MAGIC;
+  g_jnlCur.crc = crcCursor(g_jnlCur);
+
+  // tmp + rename: el cursor anterior sigue siendo válido hasta el último paso
+  File f = LittleFS.open(JOURNAL_CURSOR_PATH ".tmp", FILE_WRITE);
+  if (!f)
+    return false;
+  const bool ok = f.write((const uint8_t *)&g_jnlCur, sizeof(g_jnlCur)) == sizeof(g_jnlCur);
+  f.close();
+  return ok && LittleFS.rename(JOURNAL_CURSOR_PATH ".tmp", JOURNAL_CURSOR_PATH);
+}
+
+static void cargarCursor()
+{
+  JnlCursor c;
+  File f = LittleFS.open(JOURNAL_CURSOR_PATH, FILE_READ);
+  if (f && f.read((uint8_t *)&c, sizeof(c)) == sizeof(c) &&
+      c.magic == JNL_CURSOR_MAGIC && c.crc == crcCursor(c))
+    g_jnlCur = c;
+  else
+    g_jnlCur = {JNL_CURSOR_MAGIC, g_jnlFirst, 0, 0};
+  if (f)
+    f.close();
+}
+
+// Lee la trama en la posición actual de 'f'. Devuelve false al llegar al
+// final del segmento o ante una trama dañada (incompleta o CRC erróneo).
+static bool leerTrama(File &f, JnlFrameHdr &h, char *code, uint32_t &frameLen)
+{
+  if (f.read((uint8_t *)&h, sizeof(h)) != sizeof(h))
+    return false;
+  if (h.magic != JNL_FRAME_MAGIC || h.len == 0 || h.len > JOURNAL_CODE_MAX)
+    return false;
+  uint32_t crc = 0;
+  if (f.read((uint8_t *)code, h.len) != h.len ||
+      f.read((uint8_t *)&crc, sizeof(crc)) != sizeof(crc))
+    return false;
+
+  uint32_t calc = crc32Update(0, (const uint8_t *)&h, sizeof(h));
+  calc = crc32Update(calc, (const uint8_t *)code, h.len);
+  if (calc != crc)
+    return false;
+
+  code[h.len] = '\0';
+  frameLen = sizeof(h) + h.len + sizeof(crc);
+  return true;
+}
+
+// Recorre las tramas válidas de un segmento desde 'off'. Devuelve cuántas hay
+// y deja en 'off' el final de la última válida.
+static uint32_t recorrerSegmento(uint32_t seg, uint32_t &off)
+{
+  char ruta[32];
+  rutaSegmento(seg, ruta, sizeof(ruta));
+  File f = LittleFS.open(ruta, FILE_READ);
+  if (!f)
+    return 0;
+
+  uint32_t n = 0;
+  JnlFrameHdr h;
+  char code[JOURNAL_CODE_MAX + 1];
+  uint32_t len = 0;
+  if (off == 0 || f.seek(off))
+  {
+    while (leerTrama(f, h, code, len))
+    {
+      off += len;
+      n++;
+      if (h.seq >= g_jnlSeq)
+        g_jnlSeq = h.seq + 1;
+    }
+  }
+  f.close();
+  return n;
+}
+
+static bool abrirSegmentoActivo()
+{
+  if (g_jnlFile)
+    g_jnlFile.close();
+  char ruta[32];
+  rutaSegmento(g_jnlLast, ruta, sizeof(ruta));
+  g_jnlFile = LittleFS.open(ruta, LittleFS.exists(ruta) ? FILE_APPEND : FILE_WRITE);
+  return (bool)g_jnlFile;
+}
+
+// Descarta el segmento más antiguo cuando el diario llega a su tope
+static void descartarSegmentoAntiguo()
+{
+  uint32_t off = (g_jnlCur.seg == g_jnlFirst) ? g_jnlCur.off : 0;
+  const uint32_t perdidas = recorrerSegmento(g_jnlFirst, off);
+
+  char ruta[32];
+  rutaSegmento(g_jnlFirst, ruta, sizeof(ruta));
+  LittleFS.remove(ruta);
+  g_jnlFirst++;
+  if (g_jnlCur.seg < g_jnlFirst)
+  {
+    g_jnlCur.seg = g_jnlFirst;
+    g_jnlCur.off = 0;
+    guardarCursor();
+  }
+
+  g_pend.pending = (g_pend.pending > perdidas) ? g_pend.pending - perdidas : 0;
+  g_pend.lost += perdidas;
+  logbuf_pushf("[PEND] Diario lleno: descartadas %u validaciones sin confirmar", (unsigned)perdidas);
+}
+
+static bool rotarSegmento()
+{
+  g_jnlLast++;
+  g_jnlWriteOff = 0;
+  while (g_jnlLast - g_jnlFirst >= JOURNAL_MAX_SEGS)
+    descartarSegmentoAntiguo();
+  return abrirSegmentoActivo();
+}
+
+// Fija el cursor tras un bloque confirmado y borra los segmentos ya enviados
+static void avanzarCursor(uint32_t seg, uint32_t off)
+{
+  g_jnlCur.seg = seg;
+  g_jnlCur.off = off;
+  guardarCursor();
+
+  char ruta[32];
+  while (g_jnlFirst < g_jnlCur.seg)
+  {
+    rutaSegmento(g_jnlFirst, ruta, sizeof(ruta));
+    LittleFS.remove(ruta);
+    g_jnlFirst++;
+  }
+}
+
+static void importarPendientesTexto()
 {
   File file = LittleFS.open(PENDIENTES_PATH, FILE_READ);
   if (!file)
-    return false;
+    return;
   while (file.available())
   {
     String linea = file.readStringUntil('\n');
     linea.trim();
-    if (linea.length() > 0)
+    const int sep = linea.lastIndexOf(':');
+    if (sep > 0)
+      guardarTicketPendiente(linea.substring(0, sep), linea.substring(sep + 1).toInt());
+  }
+  file.close();
+  LittleFS.remove(PENDIENTES_PATH);
+  logbuf_pushf("[PEND] Importado %s al diario binario", PENDIENTES_PATH);
+}
+
+bool pendientesBegin()
+{
+  if (!LittleFS.exists(JOURNAL_DIR))
+    LittleFS.mkdir(JOURNAL_DIR);
+
+  // Rango de segmentos existentes
+  uint32_t minSeg = 0, maxSeg = 0;
+  File dir = LittleFS.open(JOURNAL_DIR);
+  if (dir && dir.isDirectory())
+  {
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile())
     {
-      file.close();
-      return true;
+      const char *nombre = f.name();
+      const char *barra = strrchr(nombre, '/');
+      const uint32_t seg = strtoul(barra ? barra + 1 : nombre, nullptr, 10);
+      f.close();
+      if (seg == 0)
+        continue;
+      if (minSeg == 0 || seg < minSeg)
+        minSeg = seg;
+      if (seg > maxSeg)
+        maxSeg = seg;
     }
   }
-  file.close();
-  return false;
+  if (dir)
+    dir.close();
+
+  g_jnlFirst = minSeg ? minSeg : 1;
+  g_jnlLast = maxSeg ? maxSeg : g_jnlFirst;
+
+  cargarCursor();
+  if (g_jnlCur.seg < g_jnlFirst || g_jnlCur.seg > g_jnlLast)
+  {
+    g_jnlCur.seg = g_jnlFirst;
+    g_jnlCur.off = 0;
+  }
+
+  // Cuenta lo pendiente desde el cursor y localiza el final válido del activo
+  g_pend.pending = 0;
+  for (uint32_t seg = g_jnlCur.seg; seg <= g_jnlLast; seg++)
+  {
+    uint32_t off = (seg == g_jnlCur.seg) ? g_jnlCur.off : 0;
+    g_pend.pending += recorrerSegmento(seg, off);
+    if (seg == g_jnlLast)
+      g_jnlWriteOff = off;
+  }
+
+  // Cola dañada (corte a mitad de trama): no se escribe detrás de ella
+  char ruta[32];
+  rutaSegmento(g_jnlLast, ruta, sizeof(ruta));
+  File act = LittleFS.open(ruta, FILE_READ);
+  const bool colaRota = act && act.size() > g_jnlWriteOff;
+  if (act)
+    act.close();
+
+  const bool ok = colaRota ? rotarSegmento() : abrirSegmentoActivo();
+  if (colaRota)
+    logbuf_pushf("[PEND] Trama incompleta al final del segmento %u, se abre uno nuevo", (unsigned)(g_jnlLast - 1));
+
+  importarPendientesTexto();
+
+  if (g_pend.pending > 0)
+    logbuf_pushf("[PEND] %u validaciones locales pendientes de confirmar (segmentos %u..%u)",
+                 (unsigned)g_pend.pending, (unsigned)g_jnlCur.seg, (unsigned)g_jnlLast);
+  return ok;
+}
+
+void guardarTicketPendiente(const String &ticketCode, int pasosTotales)
+{
+  const size_t len = ticketCode.length();
+  if (len == 0 || len > JOURNAL_CODE_MAX)
+    return;
+
+  if (!g_jnlFile && !abrirSegmentoActivo())
+  {
+    if (debugSerie)
+      Serial.println("ERROR: No se pudo abrir el diario de pendientes (LittleFS)");
+    return;
+  }
+
+  // Trama completa en un solo write: cabecera + código + CRC
+  uint8_t trama[sizeof(JnlFrameHdr) + JOURNAL_CODE_MAX + sizeof(uint32_t)];
+  JnlFrameHdr h = {JNL_FRAME_MAGIC, (uint8_t)len, (uint16_t)pasosTotales, g_jnlSeq++};
+  memcpy(trama, &h, sizeof(h));
+  memcpy(trama + sizeof(h), ticketCode.c_str(), len);
+  const uint32_t crc = crc32Update(0, trama, sizeof(h) + len);
+  memcpy(trama + sizeof(h) + len, &crc, sizeof(crc));
+  const size_t total = sizeof(h) + len + sizeof(crc);
+
+  if (g_jnlWriteOff > 0 && g_jnlWriteOff + total > JOURNAL_SEG_BYTES && !rotarSegmento())
+    return;
+
+  if (g_jnlFile.write(trama, total) != total)
+  {
+    // Lo escrito a medias lo descarta el CRC; se reintenta en un segmento nuevo
+    logbuf_pushf("[PEND] Error escribiendo el diario, se rota el segmento");
+    if (!rotarSegmento() || g_jnlFile.write(trama, total) != total)
+    {
+      g_pend.lost++;
+      return;
+    }
+  }
+  g_jnlFile.flush();
+  g_jnlWriteOff += total;
+  g_pend.pending++;
+  g_pend.appended++;
+
+  if (debugSerie)
+    Serial.printf("Pendiente guardado → %s:%d (seg %u)\n", ticketCode.c_str(), pasosTotales, (unsigned)g_jnlLast);
 }
 
+bool hayTicketsPendientes()
+{
+  return g_jnlCur.seg < g_jnlLast || g_jnlCur.off < g_jnlWriteOff;
+}
+
+bool pendientesEnviando()
+{
+  return g_pendEnVuelo;
+}
+
+bool pendientesToca()
+{
+  return !g_pendEnVuelo && hayTicketsPendientes() && (int32_t)(millis() - g_pendNextMs) >= 0;
+}
+
+static void onPendientesDone(HttpReqKind /*kind*/, bool ok)
+{
+  g_pendEnVuelo = false;
+  if (!ok)
+  {
+    g_pend.failedPosts++;
+    g_pendNextMs = millis() + JOURNAL_SYNC_MS;
+    if (debugSerie)
+      Serial.println("[OFFLINE] Fallo al sincronizar pendientes");
+    return;
+  }
+
+  // Con el diario lleno, descartarSegmentoAntiguo() puede haber adelantado el
+  // cursor mientras el bloque estaba en vuelo: nunca se retrocede
+  if (g_pendSeg > g_jnlCur.seg || (g_pendSeg == g_jnlCur.seg && g_pendOff > g_jnlCur.off))
+    avanzarCursor(g_pendSeg, g_pendOff);
+
+  const uint32_t n = g_pendN;
+  g_pend.pending = (g_pend.pending > n) ? g_pend.pending - n : 0;
+  g_pend.acked += n;
+  g_pend.batches++;
+  // Si queda atraso, el siguiente bloque sale en la próxima vuelta de taskNet
+  g_pendNextMs = millis() + (hayTicketsPendientes() ? 0 : JOURNAL_SYNC_MS);
+  if (debugSerie)
+    Serial.printf("[OFFLINE] %u pendientes confirmados (quedan %u)\n", (unsigned)n, (unsigned)g_pend.pending);
+}
+
+// Encola un bloque de como mucho JOURNAL_BATCH tramas desde el cursor; el
+// cursor avanza en onPendientesDone cuando el backend lo confirma. La RAM
+// usada no depende de cuánto se haya acumulado durante la desconexión.
 bool reenviarTicketsPendientesComoBloque()
 {
-  File file = LittleFS.open(PENDIENTES_PATH, FILE_READ);
-  if (!file)
+  if (g_pendEnVuelo)
     return false;
-  String contenido = file.readString();
-  file.close();
-
-  if (contenido.length() == 0)
+  if (!hayTicketsPendientes())
     return true;
 
-  bool ok = postPendientesBloque(contenido); // http.cpp
-  if (ok)
+  String bloque;
+  bloque.reserve(DEVICE_ID.length() + 2 + JOURNAL_BATCH * (JOURNAL_CODE_MAX + 8));
+  bloque = DEVICE_ID + ";\n"; // /entries/pending espera "<id>;" en la primera línea
+
+  uint32_t seg = g_jnlCur.seg, off = g_jnlCur.off, n = 0;
+  JnlFrameHdr h;
+  char code[JOURNAL_CODE_MAX + 1];
+  uint32_t len = 0;
+  char ruta[32];
+
+  while (n < JOURNAL_BATCH && seg <= g_jnlLast)
   {
-    LittleFS.remove(PENDIENTES_PATH);
-    if (debugSerie)
-      Serial.println("[OFFLINE] Pendientes sincronizados y limpiados");
+    rutaSegmento(seg, ruta, sizeof(ruta));
+    File f = LittleFS.open(ruta, FILE_READ);
+    if (f && (off == 0 || f.seek(off)))
+    {
+      while (n < JOURNAL_BATCH && (seg < g_jnlLast || off < g_jnlWriteOff) && leerTrama(f, h, code, len))
+      {
+        bloque += code;
+        bloque += ':';
+        bloque += String(h.pasos);
+        bloque += ";\n";
+        off += len;
+        n++;
+      }
+    }
+    if (f)
+      f.close();
+
+    if (n >= JOURNAL_BATCH || seg == g_jnlLast)
+      break;
+    // Fin (o trama dañada) de un segmento cerrado: se sigue con el siguiente
+    seg++;
+    off = 0;
+  }
+
+  if (n == 0)
+  {
+    // Solo quedaban restos ilegibles: se salta hasta el final conocido
+    avanzarCursor(g_jnlLast, g_jnlWriteOff);
+    return true;
   }
-  else if (debugSerie)
+
+  g_pendSeg = seg;
+  g_pendOff = off;
+  g_pendN = n;
+  g_pendEnVuelo = true;
+  if (!postPendientesBloque(bloque, onPendientesDone)) // http.cpp
   {
-    Serial.println("[OFFLINE] Fallo al sincronizar pendientes");
+    g_pendEnVuelo = false;
+    g_pend.failedPosts++;
+    g_pendNextMs = millis() + JOURNAL_SYNC_MS;
+    return false;
   }
-  return ok;
+  return true;
+}
+
+PendientesStats pendientesStats()
+{
+  PendientesStats s = g_pend;
+  s.segments = g_jnlLast - g_jnlFirst + 1;
+  return s;
 }
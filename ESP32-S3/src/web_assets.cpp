@@ -0,0 +1,84 @@
+#include "web_assets.hpp"
+#include "ficheros.hpp"
+
+#if __has_include("web_assets_gz.h")
+#include "web_assets_gz.h"
+static const size_t WEB_ASSETS_COUNT = sizeof(WEB_ASSETS_GZ) / sizeof(WEB_ASSETS_GZ[0]);
+#else
+// Sin generar (compilación fuera de PlatformIO): todo se sirve desde LittleFS
+static const WebAsset *const WEB_ASSETS_GZ = nullptr;
+static const size_t WEB_ASSETS_COUNT = 0;
+#endif
+
+static WebAssetsStats g_assetsStats = {};
+
+const WebAsset *webAssetFind(const String &path)
+{
+  for (size_t i = 0; i < WEB_ASSETS_COUNT; i++)
+  {
+    if (path != WEB_ASSETS_GZ[i].path)
+      continue;
+    if (webPageIsStock(WEB_ASSETS_GZ[i].path))
+      return &WEB_ASSETS_GZ[i];
+    g_assetsStats.overridden++;
+    return nullptr;
+  }
+  return nullptr;
+}
+
+bool webAcceptsGzip(const String &acceptEncoding)
+{
+  String v = acceptEncoding;
+  v.toLowerCase();
+  int p = v.indexOf("gzip");
+  if (p < 0)
+    return false;
+
+  // "gzip;q=0" lo rechaza expresamente
+  int end = v.indexOf(',', p);
+  String item = v.substring(p, end < 0 ? v.length() : end);
+  int q = item.indexOf("q=");
+  return q < 0 || item.substring(q + 2).toFloat() > 0.0f;
+}
+
+bool webEtagMatches(const WebAsset *a, const String &ifNoneMatch)
+{
+  if (!a || ifNoneMatch.length() == 0)
+    return false;
+  if (ifNoneMatch == "*")
+    return true;
+  // Puede venir una lista y con prefijo débil (W/)
+  return ifNoneMatch.indexOf(a->etag) >= 0;
+}
+
+void webAssetServed(const WebAsset *a, bool notModified)
+{
+  if (!a)
+    return;
+  if (notModified)
+  {
+    g_assetsStats.notModified++;
+    g_assetsStats.bytesSaved += a->rawLen;
+    return;
+  }
+  g_assetsStats.served++;
+  g_assetsStats.bytesSent += a->gzLen;
+  g_assetsStats.bytesSaved += a->rawLen - a->gzLen;
+}
+
+WebAssetsStats webAssetsStats()
+{
+  return g_assetsStats;
+}
+
+String webAssetsStatsJson()
+{
+  String json = "{\"count\":" + String((unsigned)WEB_ASSETS_COUNT);
+  json += ",\"served\":" + String(g_assetsStats.served);
+  json += ",\"not_modified\":" + String(g_assetsStats.notModified);
+  json += ",\"bytes_sent\":" + String(g_assetsStats.bytesSent);
+  json += ",\"bytes_saved\":" + String(g_assetsStats.bytesSaved);
+  json += ",\"overridden\":" + String(g_assetsStats.overridden);
+  json += "}";
+  return json;
+}
@@ -20,6 +20,9 @@ static void sendResponse(EthernetClient &client, int code,
   case 302:
     client.print(" Found");
     break;
+  case 304:
+    client.print(" Not Modified");
+    break;
   case 400:
     client.print(" Bad Request");
     break;
@@ -92,74 +95,10 @@ static void sendResponse(EthernetClient &client, int code,
   }
 }
 
-// Lee la primera línea del request (método + ruta + versión)
-static bool readRequestLine(EthernetClient &client, String &method, String &path, String &version)
-{
-  String line = client.readStringUntil('\n');
-  line.trim();
-  if (line.length() == 0)
-    return false;
-
-  int firstSpace = line.indexOf(' ');
-  int secondSpace = line.indexOf(' ', firstSpace + 1);
-  if (firstSpace < 0 || secondSpace < 0)
-    return false;
-
-  method = line.substring(0, firstSpace);
-  path = line.substring(firstSpace + 1, secondSpace);
-  version = line.substring(secondSpace + 1);
-  return true;
-}
-
-// Lee cabeceras; devuelve Content-Length y Content-Type si existe
-static int readHeaders(EthernetClient &client, String &outContentType)
-{
-  int contentLength = 0;
-  outContentType = "";
-
-  while (client.connected())
-  {
-    String line = client.readStringUntil('\n');
-    line.trim();
-    if (line.length() == 0)
-      break; // fin headers
-
-    int colon = line.indexOf(':');
-    if (colon < 0)
-      continue;
-
-    String headerName = line.substring(0, colon);
-    headerName.trim();
-    headerName.toLowerCase();
-
-    String value = line.substring(colon + 1);
-    value.trim();
-
-    if (headerName == "content-length")
-      contentLength = value.toInt();
-    else if (headerName == "content-type")
-      outContentType = value;
-  }
-  return contentLength;
-}
-
-// Lee body según Content-Length
-static String readBody(EthernetClient &client, int contentLength)
-{
-  String body;
-  body.reserve(contentLength);
-
-  while (contentLength > 0 && client.connected())
-  {
-    while (client.available() && contentLength > 0)
-    {
-      char c = client.read();
-      body += c;
-      contentLength--;
-    }
-  }
-  return body;
-}
+// Cabeceras de la petición en curso que usan las páginas precomprimidas
+// (las copia routeRequest() desde la conexión antes de despachar)
+static String reqAcceptEncoding;
+static String reqIfNoneMatch;
 
 static String getParam(const String &body, const String &key)
 {
@@ -187,6 +126,35 @@ static inline bool requireAuth(EthernetClient &client)
   return true;
 }
 
+// Escribe en el socket un trozo generado por la plantilla
+static bool clientSink(void *ctx, const uint8_t *data, size_t len)
+{
+  EthernetClient &client = *static_cast<EthernetClient *>(ctx);
+  size_t written = 0;
+  while (written < len && client.connected())
+  {
+    int w = client.write(data + written, len - written);
+    if (w <= 0)
+      return false;
+    written += (size_t)w;
+  }
+  return written == len;
+}
+
+// Página con marcadores {{...}} enviada por streaming. Sin Content-Length:
+// el cuerpo termina al cerrar la conexión (Connection: close).
+static void sendTemplate(EthernetClient &client, File &file, const TplVar *vars, size_t nVars)
+{
+  client.print("HTTP/1.1 200 OK\r\n");
+  client.print("Content-Type: text/html; charset=utf-8\r\n");
+  client.print("Cache-Control: no-store\r\n");
+  client.print("Connection: close\r\n\r\n");
+
+  tplRender(file, vars, nVars, clientSink, &client);
+  file.close();
+  client.flush();
+}
+
 // ========================= Status UI (profesional) =========================
 
 static void redirectStatus(EthernetClient &client,
@@ -223,9 +191,6 @@ static void handleStatus(EthernetClient &client, const String &pathWithQuery)
     return;
   }
 
-  String html = file.readString();
-  file.close();
-
   String kind = getQueryParam(pathWithQuery, "kind");
   if (kind != "success" && kind != "error" && kind != "info")
     kind = "info";
@@ -250,21 +215,24 @@ static void handleStatus(EthernetClient &client, const String &pathWithQuery)
   String redir = getQueryParam(pathWithQuery, "redir");
   String ms = getQueryParam(pathWithQuery, "ms");
 
-  html.replace("{{KIND}}", htmlEscape(kind));
-  html.replace("{{TITLE}}", htmlEscape(title));
-  html.replace("{{MESSAGE}}", htmlEscape(msg));
-  html.replace("{{BACK_URL}}", htmlEscape(back));
-  html.replace("{{BACK_TEXT}}", htmlEscape(backText));
-  html.replace("{{AUTO_REDIRECT_URL}}", htmlEscape(redir));
-  html.replace("{{AUTO_REDIRECT_MS}}", htmlEscape(ms));
+  const String eKind = htmlEscape(kind), eTitle = htmlEscape(title), eMsg = htmlEscape(msg);
+  const String eBack = htmlEscape(back), eBackText = htmlEscape(backText);
+  const String eRedir = htmlEscape(redir), eMs = htmlEscape(ms);
 
   // Texto auxiliar
-  if (redir.length() == 0 || ms.length() == 0)
-    html.replace("{{REDIRECT_HINT}}", "");
-  else
-    html.replace("{{REDIRECT_HINT}}", "Redirigiendo automáticamente...");
-
-  sendResponse(client, 200, "text/html; charset=utf-8", html);
+  const char *hint = (redir.length() == 0 || ms.length() == 0) ? "" : "Redirigiendo automáticamente...";
+
+  const TplVar vars[] = {
+      {"KIND", eKind.c_str()},
+      {"TITLE", eTitle.c_str()},
+      {"MESSAGE", eMsg.c_str()},
+      {"BACK_URL", eBack.c_str()},
+      {"BACK_TEXT", eBackText.c_str()},
+      {"AUTO_REDIRECT_URL", eRedir.c_str()},
+      {"AUTO_REDIRECT_MS", eMs.c_str()},
+      {"REDIRECT_HINT", hint},
+  };
+  sendTemplate(client, file, vars, sizeof(vars) / sizeof(vars[0]));
 }
 
 // ========================= Static files =========================
@@ -292,8 +260,55 @@ static String contentTypeFromPath(const String &path)
   return "application/octet-stream";
 }
 
+// Versión gzip embebida en el firmware (o 304 si el navegador ya la tiene).
+// Devuelve false si no hay versión comprimida o el cliente no acepta gzip.
+static bool sendAsset(EthernetClient &client, const String &path)
+{
+  const WebAsset *a = webAssetFind(path);
+  if (!a || !webAcceptsGzip(reqAcceptEncoding))
+    return false;
+
+  const bool notModified = webEtagMatches(a, reqIfNoneMatch);
+
+  client.print(notModified ? "HTTP/1.1 304 Not Modified\r\n" : "HTTP/1.1 200 OK\r\n");
+  client.print("ETag: ");
+  client.print(a->etag);
+  client.print("\r\nCache-Control: " WEB_ASSET_CACHE_CONTROL "\r\n");
+  client.print("Vary: Accept-Encoding\r\n");
+  if (!notModified)
+  {
+    client.print("Content-Type: ");
+    client.print(a->contentType);
+    client.print("\r\nContent-Encoding: gzip\r\n");
+    client.print("Content-Length: ");
+    client.print((unsigned long)a->gzLen);
+    client.print("\r\n");
+  }
+  client.print("Connection: close\r\n\r\n");
+
+  // Directo desde la flash mapeada, por trozos
+  size_t written = 0;
+  while (!notModified && written < a->gzLen && client.connected())
+  {
+    size_t chunk = a->gzLen - written;
+    if (chunk > 1024)
+      chunk = 1024;
+    int w = client.write(a->gz + written, chunk);
+    if (w <= 0)
+      break;
+    written += (size_t)w;
+  }
+  client.flush();
+
+  webAssetServed(a, notModified);
+  return true;
+}
+
 static void sendFile(EthernetClient &client, const String &path)
 {
+  if (sendAsset(client, path))
+    return;
+
   File file = LittleFS.open(path, "r");
   if (!file)
   {
@@ -346,13 +361,9 @@ void handleRoot(EthernetClient &client)
     return;
   }
 
-  String htmlContent = file.readString();
-  file.close();
-
-  htmlContent.replace("{{ERROR_MSG}}", errorMessage_eth);
+  const TplVar vars[] = {{"ERROR_MSG", errorMessage_eth.c_str()}};
+  sendTemplate(client, file, vars, 1);
   errorMessage_eth = "";
-
-  sendResponse(client, 200, "text/html; charset=utf-8", htmlContent);
 }
 
 void handleSubmit(EthernetClient &client, const String &body)
@@ -381,8 +392,7 @@ void handleSubmit(EthernetClient &client, const String &body)
     lastActivityTime_eth = millis();
     errorMessage_eth = "";
 
-    logbuf_clear();      // Limpiar buffer de logs
-    logbuf_enable(true); // CLAVE: desde aquí se loguea
+    logbuf_enable(true); // sin efecto con LOGBUF_ALWAYS_ON (se conserva el historial)
 
     sendResponse(client, 302, "text/plain", "", "Location: /menu\r\n");
   }
@@ -402,6 +412,9 @@ void handleMenu(EthernetClient &client)
   }
 
   lastActivityTime_eth = millis();
+  if (sendAsset(client, "/menu.html"))
+    return;
+
   File file = LittleFS.open("/menu.html", "r");
   if (!file)
   {
@@ -413,10 +426,7 @@ void handleMenu(EthernetClient &client)
     return;
   }
 
-  String htmlContent = file.readString();
-  file.close();
-
-  sendResponse(client, 200, "text/html; charset=utf-8", htmlContent);
+  sendTemplate(client, file, nullptr, 0); // sin marcadores: solo streaming
 }
 
 void handleReiniciarPage(EthernetClient &client)
@@ -427,6 +437,9 @@ void handleReiniciarPage(EthernetClient &client)
     return;
   }
 
+  if (sendAsset(client, "/reiniciar.html"))
+    return;
+
   File file = LittleFS.open("/reiniciar.html", "r");
   if (!file)
   {
@@ -436,10 +449,7 @@ void handleReiniciarPage(EthernetClient &client)
     return;
   }
 
-  String htmlContent = file.readString();
-  file.close();
-
-  sendResponse(client, 200, "text/html; charset=utf-8", htmlContent);
+  sendTemplate(client, file, nullptr, 0); // sin marcadores: solo streaming
 }
 
 void handleReiniciarDispositivo(EthernetClient &client)
@@ -482,12 +492,26 @@ void handleFirmwarePage(EthernetClient &client)
     return;
   }
 
-  String htmlContent = file.readString();
-  file.close();
+  const TplVar vars[] = {{"VERSION_FIRMWARE", enVersion.c_str()}};
+  sendTemplate(client, file, vars, 1);
+}
 
-  htmlContent.replace("VERSION_FIRMWARE", enVersion);
+// Descarga de urlActualiza (lo mismo que pide el backend con status 310)
+void handleDownloadFirmware(EthernetClient &client)
+{
+  if (!registrado_eth)
+  {
+    sendResponse(client, 401, "text/plain; charset=utf-8", "Sesión no iniciada");
+    return;
+  }
+  lastActivityTime_eth = millis();
 
-  sendResponse(client, 200, "text/html; charset=utf-8", htmlContent);
+  actualiza();
+  if (otaActive())
+    sendResponse(client, 200, "text/plain; charset=utf-8", "Descarga iniciada");
+  else
+    sendResponse(client, 409, "text/plain; charset=utf-8",
+                 fwUpdateActive() ? "Hay una subida de firmware en curso" : otaStats().lastError);
 }
 
 void handleLogout(EthernetClient &client)
@@ -495,71 +519,71 @@ void handleLogout(EthernetClient &client)
   registrado_eth = false;
   errorMessage_eth = "";
 
-  logbuf_enable(false); // CLAVE: deja de loguear
-  logbuf_clear();       // opcional
+  logbuf_enable(false); // sin efecto con LOGBUF_ALWAYS_ON
 
   sendResponse(client, 302, "text/plain", "", "Location: /\r\n");
 }
 
-// ========================= Upload firmware (multipart/form-data) =========================
+// ========================= Subidas (multipart por streaming) =========================
+// El cuerpo se consume a medida que llega en cada vuelta de webHandleClient(),
+// sin bloquear al resto de conexiones. Solo hay una subida a la vez.
+// El firmware va directo a la partición OTA (fw_update); un campo opcional
+// "sha256" del formulario se comprueba antes de activarlo.
 
-void handleFirmwareUpload(EthernetClient &client, int contentLength, const String &contentType)
+enum UploadKind : uint8_t
 {
-  if (debugSerie)
-    Serial.println("handleFirmwareUpload: inicio");
-  if (!client)
-    return;
+  UP_NONE = 0,
+  UP_FIRMWARE,
+  UP_FS
+};
 
-  if (!registrado_eth)
-  {
-    redirectStatus(client, "error", "Acceso denegado",
-                   "Inicia sesión para poder actualizar el firmware.",
-                   "/", "Volver al login");
-    return;
-  }
-
-  // boundary
-  String boundary = "";
-  int bpos = contentType.indexOf("boundary=");
-  if (bpos >= 0)
-  {
-    boundary = contentType.substring(bpos + 9);
-    boundary.trim();
-  }
-  if (boundary.length() == 0)
-  {
-    redirectStatus(client, "error", "Solicitud inválida",
-                   "No se detectó 'boundary' en Content-Type. Reintenta la subida.",
-                   "/upload_firmware", "Volver a firmware");
-    return;
-  }
-
-  String boundaryMarker = "--" + boundary;
-
-  int remaining = contentLength;
+enum UploadPart : uint8_t
+{
+  PART_SKIP = 0,
+  PART_FILE,  // fichero (firmware o LittleFS)
+  PART_SHA256 // campo de texto con el hash esperado
+};
 
-  // leer cabeceras de la parte
-  String partHeaders;
-  while (remaining > 0 && client.connected())
+struct EthUpload
+{
+  UploadKind kind;
+  int8_t owner; // conexión que la está enviando
+  UploadPart part; // parte en curso
+  MultipartParser mp;
+  File f;
+  String path;
+  size_t written;
+  uint8_t shaLen;
+  char sha256[65]; // hex esperado ("" = no se indicó)
+  const char *errTitle; // nullptr = sin error
+  String errMsg;
+};
+
+static EthUpload g_upload = {};
+
+static void uploadFail(const char *title, const String &msg)
+{
+  if (!g_upload.errTitle)
   {
-    char c = client.read();
-    remaining--;
-    partHeaders += c;
-    if (partHeaders.endsWith("\r\n\r\n"))
-      break;
+    g_upload.errTitle = title;
+    g_upload.errMsg = msg;
   }
+}
 
-  // filename
+// filename="..." de las cabeceras de la parte, sin directorios
+static String partFilename(const char *headers)
+{
+  String h(headers);
   String filename;
-  int fnPos = partHeaders.indexOf("filename=");
+  int fnPos = h.indexOf("filename=");
   if (fnPos >= 0)
   {
-    int start = partHeaders.indexOf('"', fnPos);
+    int start = h.indexOf('"', fnPos);
     if (start >= 0)
     {
-      int end = partHeaders.indexOf('"', start + 1);
+      int end = h.indexOf('"', start + 1);
       if (end > start)
-        filename = partHeaders.substring(start + 1, end);
+        filename = h.substring(start + 1, end);
     }
   }
 
@@ -570,173 +594,275 @@ void handleFirmwareUpload(EthernetClient &client, int contentLength, const Strin
   if (cut >= 0)
     filename = filename.substring(cut + 1);
   filename.trim();
+  return filename;
+}
 
-  // validar nombre
+static bool onUploadPart(void *, const char *headers)
+{
+  g_upload.part = PART_SKIP;
+  if (g_upload.errTitle)
+    return false;
 
-  if (filename != DEVICE_ID + ".bin")
+  if (strstr(headers, "filename=") == nullptr)
   {
-    while (remaining > 0 && client.connected())
+    // Campo de texto: solo interesa el hash del firmware
+    if (g_upload.kind == UP_FIRMWARE && strstr(headers, "name=\"sha256\""))
     {
-      client.read();
-      remaining--;
+      g_upload.part = PART_SHA256;
+      g_upload.shaLen = 0;
+      return true;
     }
-    redirectStatus(client, "error", "Archivo no válido",
-                   "El fichero debe llamarse exactamente: " + DEVICE_ID + ".bin",
-                   "/upload_firmware", "Volver a firmware");
-    return;
+    return false;
   }
 
-  // temporal en FS
-  const char *tmpPath = "/upload.bin";
-  if (LittleFS.exists(tmpPath))
-    LittleFS.remove(tmpPath);
+  String filename = partFilename(headers);
 
-  File f = LittleFS.open(tmpPath, "w");
-  if (!f)
+  if (g_upload.kind == UP_FIRMWARE)
   {
-    redirectStatus(client, "error", "Error de almacenamiento",
-                   "No se pudo crear el archivo temporal en LittleFS.",
-                   "/upload_firmware", "Volver a firmware");
-    return;
+    // validar nombre
+    if (filename != DEVICE_ID + ".bin")
+    {
+      uploadFail("Archivo no válido", "El fichero debe llamarse exactamente: " + DEVICE_ID + ".bin");
+      return false;
+    }
+    if (fwUpdateActive() || g_upload.written > 0)
+    {
+      uploadFail("Solicitud inválida", "El formulario contiene más de un firmware.");
+      return false;
+    }
+    if (!fwUpdateBegin())
+    {
+      if (debugSerie)
+        Serial.printf("Update.begin failed: %s\n", fwUpdateError());
+      uploadFail("Error de actualización", "No se pudo iniciar la actualización (Update.begin falló).");
+      return false;
+    }
+    g_upload.part = PART_FILE;
+    return true;
   }
-
-  // recibir cuerpo detectando boundary
-  String tail;
-  const size_t BUF_SZ = 512;
-  uint8_t buf[BUF_SZ];
-
-  while (remaining > 0 && client.connected())
+  else
   {
-    size_t toRead = remaining;
-    if (toRead > BUF_SZ)
-      toRead = BUF_SZ;
-    int r = client.readBytes(buf, toRead);
-    if (r <= 0)
-      break;
-    remaining -= r;
+    if (filename.length() == 0)
+    {
+      uploadFail("Archivo no válido", "El nombre del archivo está vacío. Reintenta la subida.");
+      return false;
+    }
 
-    String chunk;
-    chunk.reserve(r);
-    for (int i = 0; i < r; ++i)
-      chunk += (char)buf[i];
+    // validar extensión permitida
+    String lower = filename;
+    lower.toLowerCase();
+    if (!lower.endsWith(".html") &&
+        !lower.endsWith(".png"))
+    {
+      uploadFail("Tipo de archivo no permitido", "Solo se permiten: html, json, css, png, ico, jpg, jpeg, svg.");
+      return false;
+    }
+    g_upload.path = "/" + filename;
+  }
 
-    String combined = tail + chunk;
-    int idxB = combined.indexOf(boundaryMarker);
+  if (g_upload.f)
+  {
+    uploadFail("Solicitud inválida", "El formulario contiene más de un fichero.");
+    return false;
+  }
+  if (LittleFS.exists(g_upload.path))
+    LittleFS.remove(g_upload.path);
+  g_upload.f = LittleFS.open(g_upload.path, "w");
+  if (!g_upload.f)
+  {
+    uploadFail("Error de almacenamiento", "No se pudo escribir el archivo en LittleFS.");
+    return false;
+  }
+  g_upload.part = PART_FILE;
+  return true;
+}
 
-    if (idxB >= 0)
+static bool onUploadData(void *, const uint8_t *data, size_t len)
+{
+  if (g_upload.part == PART_SHA256)
+  {
+    for (size_t i = 0; i < len; i++)
     {
-      int writeUpTo = idxB;
-      if (writeUpTo >= 2 &&
-          combined.charAt(writeUpTo - 2) == '\r' &&
-          combined.charAt(writeUpTo - 1) == '\n')
-      {
-        writeUpTo -= 2;
-      }
-      for (int i = 0; i < writeUpTo; ++i)
-        f.write((uint8_t)combined.charAt(i));
-      break;
+      const char ch = (char)data[i];
+      if (isxdigit((unsigned char)ch) && g_upload.shaLen < sizeof(g_upload.sha256) - 1)
+        g_upload.sha256[g_upload.shaLen++] = ch;
     }
-    else
+    g_upload.sha256[g_upload.shaLen] = '\0';
+    return true;
+  }
+  if (g_upload.part != PART_FILE)
+    return true;
+
+  if (g_upload.kind == UP_FIRMWARE)
+  {
+    if (!fwUpdateWrite(data, len))
     {
-      int keep = boundaryMarker.length();
-      if ((int)combined.length() <= keep)
-      {
-        tail = combined;
-        continue;
-      }
-      int writeLen = combined.length() - keep;
-      for (int i = 0; i < writeLen; ++i)
-        f.write((uint8_t)combined.charAt(i));
-      tail = combined.substring(writeLen);
+      if (debugSerie)
+        Serial.printf("Update.write failed: %s\n", fwUpdateError());
+      uploadFail("Error de escritura", "Fallo escribiendo el firmware en flash.");
+      return false;
     }
   }
+  else if (g_upload.f.write(data, len) != len)
+  {
+    uploadFail("Error de almacenamiento", "No se pudo escribir el archivo en LittleFS.");
+    return false;
+  }
+  g_upload.written += len;
+  return true;
+}
 
-  f.close();
+static void uploadRelease(bool removeFile)
+{
+  if (g_upload.f)
+    g_upload.f.close();
+  if (removeFile && g_upload.path.length() > 0)
+    LittleFS.remove(g_upload.path);
+  if (g_upload.kind == UP_FS && g_upload.path.length() > 0)
+    webPageChanged(g_upload.path.c_str()); // deja de servirse la versión gzip si ya no coincide
+  if (g_upload.kind == UP_FIRMWARE)
+    fwUpdateAbort(); // sin efecto si ya se cerró (no toca la descarga del servidor)
+  g_upload.kind = UP_NONE;
+  g_upload.owner = -1;
+  g_upload.part = PART_SKIP;
+  g_upload.path = "";
+  g_upload.errTitle = nullptr;
+  g_upload.errMsg = "";
+}
 
-  File f2 = LittleFS.open(tmpPath, "r");
-  if (!f2)
+// Cabeceras leídas: comprueba sesión y boundary y reserva la subida.
+// Devuelve false si ya se ha respondido (error) y hay que cerrar.
+static bool uploadBegin(EthernetClient &client, int8_t owner, UploadKind kind, const String &contentType,
+                        int contentLength)
+{
+  const char *backUrl = (kind == UP_FIRMWARE) ? "/upload_firmware" : "/upload_fs";
+  const char *backText = (kind == UP_FIRMWARE) ? "Volver a firmware" : "Volver a ficheros";
+
+  if (!registrado_eth)
   {
-    redirectStatus(client, "error", "Error de lectura",
-                   "No se pudo abrir el firmware temporal para validar.",
-                   "/upload_firmware", "Volver a firmware");
-    return;
+    redirectStatus(client, "error", "Acceso denegado",
+                   kind == UP_FIRMWARE ? "Inicia sesión para poder actualizar el firmware."
+                                       : "Inicia sesión para actualizar el sistema de ficheros.",
+                   "/", "Volver al login");
+    return false;
   }
 
-  size_t fwSize = f2.size();
-  if (fwSize == 0)
+  if (g_upload.kind != UP_NONE)
   {
-    f2.close();
-    LittleFS.remove(tmpPath);
-    redirectStatus(client, "error", "Fichero vacío",
-                   "No se recibieron datos válidos. Reintenta la subida.",
-                   "/upload_firmware", "Volver a firmware");
-    return;
+    redirectStatus(client, "error", "Subida en curso",
+                   "Ya hay otra subida en marcha. Espera a que termine y reintenta.",
+                   backUrl, backText);
+    return false;
   }
 
-  size_t maxSketchSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
-  if (fwSize > maxSketchSpace)
+  if (kind == UP_FIRMWARE && otaActive())
+  {
+    redirectStatus(client, "error", "Descarga en curso",
+                   "El equipo está descargando firmware del servidor. Espera a que termine.",
+                   backUrl, backText);
+    return false;
+  }
+
+  // Se descarta antes de recibirlo (el sobre multipart ocupa menos de 1 KB)
+  if (kind == UP_FIRMWARE && contentLength > 0 &&
+      (size_t)contentLength > ESP.getFreeSketchSpace() + 1024)
   {
-    f2.close();
-    LittleFS.remove(tmpPath);
     redirectStatus(client, "error", "Firmware demasiado grande",
                    "El firmware excede el espacio disponible para OTA.",
-                   "/upload_firmware", "Volver a firmware");
-    return;
+                   backUrl, backText);
+    return false;
   }
 
-  if (!Update.begin(fwSize))
+  // boundary
+  String boundary = "";
+  int bpos = contentType.indexOf("boundary=");
+  if (bpos >= 0)
   {
-    if (debugSerie)
-      Serial.printf("Update.begin failed: %s\n", Update.errorString());
-    f2.close();
-    LittleFS.remove(tmpPath);
-    redirectStatus(client, "error", "Error de actualización",
-                   "No se pudo iniciar la actualización (Update.begin falló).",
-                   "/upload_firmware", "Volver a firmware");
-    return;
+    boundary = contentType.substring(bpos + 9);
+    boundary.trim();
+  }
+  if (boundary.length() == 0 ||
+      !multipartInit(g_upload.mp, boundary.c_str(), boundary.length(), onUploadPart, onUploadData, nullptr))
+  {
+    redirectStatus(client, "error", "Solicitud inválida",
+                   "No se detectó 'boundary' en Content-Type. Reintenta la subida.",
+                   backUrl, backText);
+    return false;
   }
 
-  size_t written = 0;
-  uint8_t rb[512];
+  g_upload.kind = kind;
+  g_upload.owner = owner;
+  g_upload.part = PART_SKIP;
+  g_upload.written = 0;
+  g_upload.shaLen = 0;
+  g_upload.sha256[0] = '\0';
+  g_upload.errTitle = nullptr;
+  g_upload.path = "";
+  if (debugSerie)
+    Serial.printf("[WEB] Subida %s: inicio\n", kind == UP_FIRMWARE ? "firmware" : "fichero");
+  return true;
+}
+
+// Cuerpo completo recibido: responde según el resultado
+static void uploadFinish(EthernetClient &client)
+{
+  const UploadKind kind = g_upload.kind;
+  const char *backUrl = (kind == UP_FIRMWARE) ? "/upload_firmware" : "/upload_fs";
+  const char *backText = (kind == UP_FIRMWARE) ? "Volver a firmware" : "Volver a ficheros";
+
+  if (!g_upload.errTitle && !multipartDone(g_upload.mp))
+    uploadFail("Subida incompleta", "No se recibieron datos válidos para el fichero. Reintenta la subida.");
+  if (!g_upload.errTitle && g_upload.written == 0)
+    uploadFail(kind == UP_FIRMWARE ? "Fichero vacío" : "Subida incompleta",
+               kind == UP_FIRMWARE ? "No se recibieron datos válidos. Reintenta la subida."
+                                   : "No se recibieron datos válidos para el fichero. Reintenta la subida.");
+  if (!g_upload.errTitle && kind == UP_FIRMWARE &&
+      g_upload.shaLen != 0 && g_upload.shaLen != 64)
+    uploadFail("SHA-256 no válido", "El hash indicado debe tener 64 caracteres hexadecimales.");
+
+  if (g_upload.errTitle)
+  {
+    const char *title = g_upload.errTitle;
+    const String msg = g_upload.errMsg;
+    uploadRelease(true); // nada a medias en LittleFS ni en la partición OTA
+    redirectStatus(client, "error", title, msg, backUrl, backText);
+    return;
+  }
 
-  while (f2.available())
+  if (kind == UP_FIRMWARE)
   {
-    int r = f2.read(rb, sizeof(rb));
-    if (r > 0)
+    const bool ok = fwUpdateEnd(g_upload.sha256);
+    char sha[65];
+    fwUpdateDigestHex(sha);
+    uploadRelease(false);
+    if (!ok)
     {
-      size_t w = Update.write(rb, r);
-      if (w != (size_t)r)
-      {
-        Update.end();
-        f2.close();
-        LittleFS.remove(tmpPath);
-        redirectStatus(client, "error", "Error de escritura",
-                       "Fallo escribiendo el firmware en flash.",
-                       "/upload_firmware", "Volver a firmware");
-        return;
-      }
-      written += w;
+      if (debugSerie)
+        Serial.printf("Update end error: %s\n", fwUpdateError());
+      redirectStatus(client, "error", "Actualización fallida",
+                     String("El firmware no se pudo finalizar correctamente: ") + fwUpdateError() +
+                         ". SHA-256 recibido: " + sha,
+                     backUrl, backText);
+      return;
     }
-  }
-  f2.close();
+    logbuf_pushf("[WEB] Firmware subido: %u bytes, sha256 %.16s...", (unsigned)fwUpdateWritten(), sha);
 
-  bool ok = Update.end(true);
-  if (!ok)
-  {
-    if (debugSerie)
-      Serial.printf("Update end error: %s\n", Update.errorString());
-    LittleFS.remove(tmpPath);
-    redirectStatus(client, "error", "Actualización fallida",
-                   "El firmware no se pudo finalizar correctamente.",
-                   "/upload_firmware", "Volver a firmware");
+    // respuesta profesional + reinicio
+    redirectStatus(client, "success", "Firmware actualizado",
+                   "Firmware cargado correctamente. El dispositivo se reiniciará en unos instantes.",
+                   "/menu", "Volver al menú");
+
+    delay(150);
+    ESP.restart();
     return;
   }
 
-  LittleFS.remove(tmpPath);
+  const String path = g_upload.path;
+  uploadRelease(false);
 
-  // respuesta profesional + reinicio
-  redirectStatus(client, "success", "Firmware actualizado",
-                 "Firmware cargado correctamente. El dispositivo se reiniciará en unos instantes.",
+  // OK: página profesional + reinicio
+  redirectStatus(client, "success", "Archivo actualizado",
+                 "Archivo subido correctamente como " + path + ". El dispositivo se reiniciará en unos instantes.",
                  "/menu", "Volver al menú");
 
   delay(150);
@@ -755,8 +881,6 @@ void handleConfigPage(EthernetClient &client)
     redirectStatus(client, "error", "Error", "Falta config.html", "/menu", "Volver");
     return;
   }
-  String html = file.readString();
-  file.close();
 
   TornoConfig c = cfgLoad();
 
@@ -781,44 +905,43 @@ void handleConfigPage(EthernetClient &client)
   }
 
   // Identificación
-  html.replace("{{DEVICE_ID}}", htmlEscape(c.deviceId));
+  const String eDeviceId = htmlEscape(c.deviceId);
   char macStr[18];
   snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X", c.mac[0], c.mac[1], c.mac[2], c.mac[3], c.mac[4], c.mac[5]);
-  html.replace("{{MAC_ADDRESS}}", String(macStr));
-
-  // Hardware, Sentido y Apertura (Asegúrate de que estas etiquetas coinciden con tu config.html)
-  html.replace("{{MOD_VEGA_SEL}}", (c.modoPasillo == 0) ? "selected" : "");
-  html.replace("{{MOD_CANOPU_SEL}}", (c.modoPasillo == 1) ? "selected" : "");
-  html.replace("{{MOD_ARTURUS_SEL}}", (c.modoPasillo == 2) ? "selected" : "");
-  
-  html.replace("{{MODO_RS485_SEL}}", (c.modoApertura == 0) ? "selected" : "");
-  html.replace("{{MODO_RELES_SEL}}", (c.modoApertura == 1) ? "selected" : "");
-  
-  html.replace("{{SENT_LEFT_SEL}}", (c.sentidoApertura == 0) ? "selected" : "");
-  html.replace("{{SENT_RIGHT_SEL}}", (c.sentidoApertura == 1) ? "selected" : "");
-
-  // Red (Usamos las variables dinámicas calculadas arriba)
-  html.replace("{{CON_WIFI_SEL}}", (c.conexionRed == 0) ? "selected" : "");
-  html.replace("{{CON_ETH_SEL}}", (c.conexionRed == 1) ? "selected" : "");
-  html.replace("{{MODO_DHCP_SEL}}", (c.modoRed == 0) ? "selected" : "");
-  html.replace("{{MODO_ESTATICA_SEL}}", (c.modoRed == 1) ? "selected" : "");
-  
-  html.replace("{{WIFI_SSID}}", htmlEscape(c.wifiSSID));
-  html.replace("{{WIFI_PASS}}", htmlEscape(c.wifiPass));
-  
-  html.replace("{{IP}}", currentIP);
-  html.replace("{{GATEWAY}}", currentGW);
-  html.replace("{{SUBNET}}", currentMask);
-  html.replace("{{DNS1}}", currentDNS1);
-  html.replace("{{DNS2}}", currentDNS2);
-
-  // API
-  html.replace("{{URL_BASE}}", htmlEscape(c.urlBase));
-  html.replace("{{URL_ACTUALIZA}}", htmlEscape(c.urlActualiza));
-
-  html.replace("{{CFG_MSG}}", errorMessage_eth);
+  const String eSsid = htmlEscape(c.wifiSSID), ePass = htmlEscape(c.wifiPass);
+  const String eUrlBase = htmlEscape(c.urlBase), eUrlActualiza = htmlEscape(c.urlActualiza);
+  const char *SEL = "selected";
+
+  const TplVar vars[] = {
+      {"DEVICE_ID", eDeviceId.c_str()},
+      {"MAC_ADDRESS", macStr},
+      // Hardware, Sentido y Apertura (Asegúrate de que estas etiquetas coinciden con tu config.html)
+      {"MOD_VEGA_SEL", (c.modoPasillo == 0) ? SEL : ""},
+      {"MOD_CANOPU_SEL", (c.modoPasillo == 1) ? SEL : ""},
+      {"MOD_ARTURUS_SEL", (c.modoPasillo == 2) ? SEL : ""},
+      {"MODO_RS485_SEL", (c.modoApertura == 0) ? SEL : ""},
+      {"MODO_RELES_SEL", (c.modoApertura == 1) ? SEL : ""},
+      {"SENT_LEFT_SEL", (c.sentidoApertura == 0) ? SEL : ""},
+      {"SENT_RIGHT_SEL", (c.sentidoApertura == 1) ? SEL : ""},
+      // Red (Usamos las variables dinámicas calculadas arriba)
+      {"CON_WIFI_SEL", (c.conexionRed == 0) ? SEL : ""},
+      {"CON_ETH_SEL", (c.conexionRed == 1) ? SEL : ""},
+      {"MODO_DHCP_SEL", (c.modoRed == 0) ? SEL : ""},
+      {"MODO_ESTATICA_SEL", (c.modoRed == 1) ? SEL : ""},
+      {"WIFI_SSID", eSsid.c_str()},
+      {"WIFI_PASS", ePass.c_str()},
+      {"IP", currentIP.c_str()},
+      {"GATEWAY", currentGW.c_str()},
+      {"SUBNET", currentMask.c_str()},
+      {"DNS1", currentDNS1.c_str()},
+      {"DNS2", currentDNS2.c_str()},
+      // API
+      {"URL_BASE", eUrlBase.c_str()},
+      {"URL_ACTUALIZA", eUrlActualiza.c_str()},
+      {"CFG_MSG", errorMessage_eth.c_str()},
+  };
+  sendTemplate(client, file, vars, sizeof(vars) / sizeof(vars[0]));
   errorMessage_eth = "";
-  sendResponse(client, 200, "text/html; charset=utf-8", html);
 }
 
 void handleConfigSave(EthernetClient &client, const String &body)
@@ -1063,10 +1186,15 @@ void handleParamsSave(EthernetClient &client, const String &body)
 
   paramsSave(p);
   paramsApplyToGlobals(p);
-  if (RS485::setParam(MACHINE_ID, (uint8_t)id, (uint16_t)val))
+
+  // Solo sale al bus lo que difiere de lo que ya tiene el torno (normalmente el menú 'id')
+  uint8_t bus[PARAMS_COUNT];
+  paramsToBus(p, bus);
+  const RS485::ParamSyncResult r = RS485::syncParams(bus, PARAMS_COUNT, RS485_PARAM_WAIT_MS);
+  if (r.ok())
   {
-    delay(150);
-    RS485::resetDevice(MACHINE_ID);
+    if (r.written > 0)
+      RS485::resetDevice(MACHINE_ID);
     sendResponse(client, 200, "application/json", "{\"status\":\"ok\"}");
   }
   else
@@ -1086,11 +1214,12 @@ void handleActionsPage(EthernetClient &client)
     sendResponse(client, 404, "text/plain", "No encontrado");
     return;
   }
-  String html = file.readString();
-  file.close();
-  html.replace("{{DEVICE_ID}}", htmlEscape(cfgLoad().deviceId));
-  html.replace("{{RS485_CLASS}}", (modoApertura == 0) ? "" : "hidden");
-  sendResponse(client, 200, "text/html; charset=utf-8", html);
+  const String eDeviceId = htmlEscape(cfgLoad().deviceId);
+  const TplVar vars[] = {
+      {"DEVICE_ID", eDeviceId.c_str()},
+      {"RS485_CLASS", (modoApertura == 0) ? "" : "hidden"},
+  };
+  sendTemplate(client, file, vars, 2);
 }
 
 void handleDoAction(EthernetClient &client, const String &fullPath)
@@ -1291,6 +1420,20 @@ void handleGetStatusJson(EthernetClient &client)
     json += ",\"gate_text\":\"Modo Relé\",\"fault_text\":\"N/A\",\"alarm_text\":\"N/A\"";
   }
 
+  json += ",\"colas\":" + cmdLanesStatsJson();
+  json += ",\"tickets\":" + ticketsStatsJson();
+  json += ",\"paginas\":" + webPagesStatsJson();
+  json += ",\"assets\":" + webAssetsStatsJson();
+  if (modoApertura == 0)
+  {
+    json += ",\"rs485_tx\":" + RS485::txStatsJson();
+    json += ",\"rs485_bus\":" + RS485::busStatsJson();
+  }
+  json += ",\"lector\":" + DSSP3120::scanStatsJson();
+  json += ",\"repetidas\":" + scanCacheStatsJson();
+  json += ",\"log_spool\":" + logspool_stats_json();
+  json += ",\"ota\":" + otaStatsJson();
+  json += ",\"web_eth\":" + webEthStatsJson();
   json += "}";
   sendResponse(client, 200, "application/json", json);
 }
@@ -1346,23 +1489,26 @@ static void handleLogsPage(EthernetClient &client)
   sendFile(client, "/logs.html");
 }
 
-static void handleLogsData(EthernetClient &client, const String &fullPath)
+// Copia persistente en LittleFS (+ lo pendiente en RTC) como descarga de texto
+static void handleLogsSpool(EthernetClient &client)
 {
-  Serial.printf("[LOGS] registrado=%d enabled=%d\n", (int)registrado_eth, (int)logbuf_enabled());
-
   if (!registrado_eth)
   {
-    sendResponse(client, 401, "application/json; charset=utf-8",
-                 "{\"ok\":false,\"error\":\"unauthorized\"}");
+    sendResponse(client, 302, "text/plain", "", "Location: /\r\n");
     return;
   }
-
   lastActivityTime_eth = millis();
 
-  uint32_t since = (uint32_t)getQueryParam(fullPath, "since").toInt();
-  uint32_t next = 0;
-  String json = logbuf_get_json_since(since, next);
-  sendResponse(client, 200, "application/json; charset=utf-8", json);
+  client.print("HTTP/1.1 200 OK\r\n");
+  client.print("Content-Type: text/plain; charset=utf-8\r\n");
+  client.print("Content-Disposition: attachment; filename=\"logs.txt\"\r\n");
+  client.print("Cache-Control: no-store\r\n");
+  client.print("Content-Length: ");
+  client.print((unsigned long)logspool_size());
+  client.print("\r\n");
+  client.print("Connection: close\r\n\r\n");
+  logspool_stream(clientSink, &client);
+  client.flush();
 }
 
 // ========================= FS Upload pages =========================
@@ -1377,6 +1523,9 @@ void handleFsPage(EthernetClient &client)
 
   lastActivityTime_eth = millis();
 
+  if (sendAsset(client, "/upload_fs.html"))
+    return;
+
   File file = LittleFS.open("/upload_fs.html", "r");
   if (!file)
   {
@@ -1386,237 +1535,171 @@ void handleFsPage(EthernetClient &client)
     return;
   }
 
-  String htmlContent = file.readString();
-  file.close();
-
-  sendResponse(client, 200, "text/html; charset=utf-8", htmlContent);
+  sendTemplate(client, file, nullptr, 0); // sin marcadores: solo streaming
 }
 
-void handleFsUpload(EthernetClient &client, int contentLength, const String &contentType)
-{
-  if (debugSerie)
-    Serial.println("handleFsUpload: inicio (subida de archivo suelto)");
-  if (!client)
-    return;
 
-  if (!registrado_eth)
-  {
-    redirectStatus(client, "error", "Acceso denegado",
-                   "Inicia sesión para actualizar el sistema de ficheros.",
-                   "/", "Volver al login");
-    return;
-  }
+// ========================= Bucle principal web =========================
+// Varias conexiones a la vez (un socket del W5500 por conexión), cada una con
+// su propia máquina de estados. Cada vuelta lee lo que haya disponible sin
+// esperar; una petición se despacha cuando está completa y se cierra.
 
-  // boundary
-  String boundary = "";
-  int bpos = contentType.indexOf("boundary=");
-  if (bpos >= 0)
-  {
-    boundary = contentType.substring(bpos + 9);
-    boundary.trim();
-  }
-  if (boundary.length() == 0)
-  {
-    redirectStatus(client, "error", "Solicitud inválida",
-                   "No se detectó 'boundary' en Content-Type. Reintenta la subida.",
-                   "/upload_fs", "Volver a ficheros");
-    return;
-  }
+enum EthConnState : uint8_t
+{
+  EC_FREE = 0,
+  EC_HEAD,   // línea de petición y cabeceras
+  EC_BODY,   // cuerpo de formulario (acotado)
+  EC_UPLOAD, // cuerpo multipart hacia g_upload
+  EC_LOGWAIT // /logs_data aparcado hasta que haya logs nuevos
+};
+
+struct EthConn
+{
+  EthernetClient client;
+  EthConnState state;
+  uint32_t lastMs;
+  uint32_t remaining; // bytes de cuerpo por leer
+  uint16_t lineLen;
+  bool gotRequestLine;
+  char line[WEB_ETH_LINE_MAX];
+
+  String method;
+  String path;
+  String fullPath; // con query (para /status, /do_action, /logs_data)
+  String contentType;
+  String acceptEncoding;
+  String ifNoneMatch;
+  int contentLength;
+  String body;
 
-  String boundaryMarker = "--" + boundary;
-  int remaining = contentLength;
+  uint32_t logSince;  // cursor de /logs_data
+  uint32_t logWaitMs; // espera máxima pedida (?wait=)
+};
 
-  // headers de la parte
-  String partHeaders;
-  while (remaining > 0 && client.connected())
-  {
-    char c = client.read();
-    remaining--;
-    partHeaders += c;
-    if (partHeaders.endsWith("\r\n\r\n"))
-      break;
-  }
+static EthConn conns[WEB_ETH_MAX_CONN];
+static WebEthStats g_webStats = {};
 
-  // filename
-  String filename;
-  int fnPos = partHeaders.indexOf("filename=");
-  if (fnPos >= 0)
+static void resetConn(EthConn &c)
+{
+  c.state = EC_HEAD;
+  c.lastMs = millis();
+  c.remaining = 0;
+  c.lineLen = 0;
+  c.gotRequestLine = false;
+  c.method = "";
+  c.path = "";
+  c.fullPath = "";
+  c.contentType = "";
+  c.acceptEncoding = "";
+  c.ifNoneMatch = "";
+  c.contentLength = 0;
+  c.body = "";
+  c.logSince = 0;
+  c.logWaitMs = 0;
+}
+
+static void closeConn(EthConn &c)
+{
+  if (g_upload.kind != UP_NONE && g_upload.owner == (int8_t)(&c - conns))
   {
-    int start = partHeaders.indexOf('"', fnPos);
-    if (start >= 0)
-    {
-      int end = partHeaders.indexOf('"', start + 1);
-      if (end > start)
-        filename = partHeaders.substring(start + 1, end);
-    }
+    // Cliente caído a mitad de subida
+    if (debugSerie)
+      Serial.println("[WEB] Subida abortada: conexión cerrada");
+    uploadRelease(true);
   }
+  c.client.flush();
+  c.client.stop();
+  c.state = EC_FREE;
+  c.body = "";
+}
 
-  // normalizar ruta
-  int slash = filename.lastIndexOf('/');
-  int bslash = filename.lastIndexOf('\\');
-  int cut = max(slash, bslash);
-  if (cut >= 0)
-    filename = filename.substring(cut + 1);
-  filename.trim();
+// ========================= Logs en vivo =========================
+// JSON en streaming (Transfer-Encoding: chunked) directamente desde el
+// anillo. Con ?wait=ms y nada nuevo tras 'since', la conexión queda aparcada
+// y se contesta en cuanto llega un log o vence la espera (long-poll).
 
-  if (filename.length() == 0)
-  {
-    while (remaining > 0 && client.connected())
-    {
-      client.read();
-      remaining--;
-    }
-    redirectStatus(client, "error", "Archivo no válido",
-                   "El nombre del archivo está vacío. Reintenta la subida.",
-                   "/upload_fs", "Volver a ficheros");
-    return;
-  }
+static bool chunkSink(void *ctx, const uint8_t *data, size_t len)
+{
+  char hdr[12];
+  const int n = snprintf(hdr, sizeof(hdr), "%X\r\n", (unsigned)len);
+  return clientSink(ctx, (const uint8_t *)hdr, (size_t)n) &&
+         clientSink(ctx, data, len) &&
+         clientSink(ctx, (const uint8_t *)"\r\n", 2);
+}
 
-  // validar extensión permitida
-  String lower = filename;
-  lower.toLowerCase();
-  if (!lower.endsWith(".html") &&
-      !lower.endsWith(".png"))
-  {
-    while (remaining > 0 && client.connected())
-    {
-      client.read();
-      remaining--;
-    }
-    redirectStatus(client, "error", "Tipo de archivo no permitido",
-                   "Solo se permiten: html, json, css, png, ico, jpg, jpeg, svg.",
-                   "/upload_fs", "Volver a ficheros");
-    return;
-  }
+static void sendLogsData(EthConn &c)
+{
+  EthernetClient &client = c.client;
+  client.print("HTTP/1.1 200 OK\r\n");
+  client.print("Content-Type: application/json; charset=utf-8\r\n");
+  client.print("Cache-Control: no-store\r\n");
+  client.print("Transfer-Encoding: chunked\r\n");
+  client.print("Connection: close\r\n\r\n");
+  if (logbuf_stream_json(c.logSince, chunkSink, &client))
+    client.print("0\r\n\r\n");
+  client.flush();
+}
 
-  String path = "/" + filename;
+static void handleLogsData(EthConn &c)
+{
+  if (debugSerie)
+    Serial.printf("[LOGS] registrado=%d enabled=%d\n", (int)registrado_eth, (int)logbuf_enabled());
 
-  File f = LittleFS.open(path, "w");
-  if (!f)
+  if (!registrado_eth)
   {
-    while (remaining > 0 && client.connected())
-    {
-      client.read();
-      remaining--;
-    }
-    redirectStatus(client, "error", "Error de almacenamiento",
-                   "No se pudo escribir el archivo en LittleFS.",
-                   "/upload_fs", "Volver a ficheros");
+    sendResponse(c.client, 401, "application/json; charset=utf-8",
+                 "{\"ok\":false,\"error\":\"unauthorized\"}");
     return;
   }
 
-  // escribir cuerpo detectando boundary
-  String tail;
-  const size_t BUF_SZ = 512;
-  uint8_t buf[BUF_SZ];
-  size_t totalWritten = 0;
-
-  while (remaining > 0 && client.connected())
-  {
-    size_t toRead = remaining;
-    if (toRead > BUF_SZ)
-      toRead = BUF_SZ;
-    int r = client.readBytes(buf, toRead);
-    if (r <= 0)
-      break;
-    remaining -= r;
-
-    String chunk;
-    chunk.reserve(r);
-    for (int i = 0; i < r; ++i)
-      chunk += (char)buf[i];
-
-    String combined = tail + chunk;
-    int idxB = combined.indexOf(boundaryMarker);
-    if (idxB >= 0)
-    {
-      int writeUpTo = idxB;
-      if (writeUpTo >= 2 &&
-          combined.charAt(writeUpTo - 2) == '\r' &&
-          combined.charAt(writeUpTo - 1) == '\n')
-      {
-        writeUpTo -= 2;
-      }
-
-      for (int i = 0; i < writeUpTo; ++i)
-        f.write((uint8_t)combined.charAt(i));
-      totalWritten += writeUpTo;
-      break;
-    }
-    else
-    {
-      int keep = boundaryMarker.length();
-      if ((int)combined.length() <= keep)
-      {
-        tail = combined;
-        continue;
-      }
-
-      int writeLen = combined.length() - keep;
-      for (int i = 0; i < writeLen; ++i)
-        f.write((uint8_t)combined.charAt(i));
-      totalWritten += writeLen;
-      tail = combined.substring(writeLen);
-    }
-  }
+  lastActivityTime_eth = millis();
 
-  f.close();
+  c.logSince = (uint32_t)getQueryParam(c.fullPath, "since").toInt();
+  c.logWaitMs = (uint32_t)getQueryParam(c.fullPath, "wait").toInt();
+  if (c.logWaitMs > WEB_ETH_LOGS_WAIT_MS)
+    c.logWaitMs = WEB_ETH_LOGS_WAIT_MS;
 
-  if (totalWritten == 0)
+  if (c.logWaitMs == 0 || logbuf_has_since(c.logSince))
   {
-    redirectStatus(client, "error", "Subida incompleta",
-                   "No se recibieron datos válidos para el fichero. Reintenta la subida.",
-                   "/upload_fs", "Volver a ficheros");
+    sendLogsData(c);
     return;
   }
 
-  // OK: página profesional + reinicio
-  redirectStatus(client, "success", "Archivo actualizado",
-                 "Archivo subido correctamente como " + path + ". El dispositivo se reiniciará en unos instantes.",
-                 "/menu", "Volver al menú");
-
-  delay(150);
-  ESP.restart();
+  c.state = EC_LOGWAIT;
+  c.lastMs = millis();
+  g_webStats.longPolls++;
 }
 
-// ========================= Bucle principal web =========================
-
-void webHandleClient()
+// Conexión aparcada: se contesta al llegar logs, al vencer la espera o
+// al caducar la sesión
+static void pumpLogWait(EthConn &c)
 {
-  EthernetClient client = serverETH.available();
-  if (!client)
-    return;
-
-  if (debugSerie)
-    Serial.println("Nuevo cliente conectado (Ethernet)");
-
-  unsigned long start = millis();
-  while (!client.available() && (millis() - start) < 500)
-    delay(5);
-
-  if (!client.available())
+  if (!c.client.connected())
   {
-    client.stop();
-    if (debugSerie)
-      Serial.println("Cliente sin datos, desconectado.");
+    closeConn(c);
     return;
   }
-
-  String method, path, version;
-  if (!readRequestLine(client, method, path, version))
-  {
-    mensajeError(client);
-    client.stop();
+  if (!registrado_eth)
+    sendResponse(c.client, 401, "application/json; charset=utf-8",
+                 "{\"ok\":false,\"error\":\"unauthorized\"}");
+  else if (logbuf_has_since(c.logSince) || millis() - c.lastMs >= c.logWaitMs)
+    sendLogsData(c);
+  else
     return;
-  }
+  closeConn(c);
+}
 
-  // Guardar ruta completa con query para /status
-  String fullPath = path;
+static void routeRequest(EthConn &c)
+{
+  EthernetClient &client = c.client;
+  const String &method = c.method;
+  const String &path = c.path;
+  const String &fullPath = c.fullPath;
+  const String &body = c.body;
 
-  // Quitar query string para enrutado normal
-  int q = path.indexOf('?');
-  if (q >= 0)
-    path = path.substring(0, q);
+  // Para las páginas precomprimidas
+  reqAcceptEncoding = c.acceptEncoding;
+  reqIfNoneMatch = c.ifNoneMatch;
 
   if (debugSerie)
   {
@@ -1626,19 +1709,6 @@ void webHandleClient()
     Serial.println(path);
   }
 
-  String contentType;
-  int contentLength = readHeaders(client, contentType);
-  String body;
-
-  // No leer body para uploads (se consume dentro)
-  if (method == "POST" &&
-      path != "/upload_firmware" &&
-      path != "/upload_fs" &&
-      contentLength > 0)
-  {
-    body = readBody(client, contentLength);
-  }
-
   // Enrutado
   if (method == "GET" && path == "/")
     handleRoot(client);
@@ -1652,12 +1722,10 @@ void webHandleClient()
     handleReiniciarDispositivo(client);
   else if (method == "GET" && path == "/upload_firmware")
     handleFirmwarePage(client);
-  else if (method == "POST" && path == "/upload_firmware")
-    handleFirmwareUpload(client, contentLength, contentType);
+  else if (method == "GET" && path == "/download_firmware")
+    handleDownloadFirmware(client);
   else if (method == "GET" && path == "/upload_fs")
     handleFsPage(client);
-  else if (method == "POST" && path == "/upload_fs")
-    handleFsUpload(client, contentLength, contentType);
   else if (method == "GET" && path == "/logout")
     handleLogout(client);
   else if (method == "GET" && path == "/config")
@@ -1683,7 +1751,9 @@ void webHandleClient()
   else if (method == "GET" && path == "/logs")
     handleLogsPage(client);
   else if (method == "GET" && path == "/logs_data")
-    handleLogsData(client, fullPath);
+    handleLogsData(c);
+  else if (method == "GET" && path == "/logs_spool")
+    handleLogsSpool(client);
   // Manejo de estáticos con seguridad equiparable al onNotFound() de WiFi
   else if (method == "GET" && path != "/")
   {
@@ -1704,10 +1774,283 @@ void webHandleClient()
   {
     mensajeError(client);
   }
+}
 
-  delay(20);
-  client.stop();
-  if (debugSerie)
+// Línea de petición: "GET /ruta?query HTTP/1.1"
+static bool parseRequestLine(EthConn &c)
+{
+  char *sp1 = strchr(c.line, ' ');
+  char *sp2 = sp1 ? strchr(sp1 + 1, ' ') : nullptr;
+  if (!sp1 || !sp2)
+    return false;
+  *sp1 = '\0';
+  *sp2 = '\0';
+  c.method = c.line;
+  c.fullPath = sp1 + 1; // Guardar ruta completa con query para /status
+  c.path = c.fullPath;
+
+  // Quitar query string para enrutado normal
+  int q = c.path.indexOf('?');
+  if (q >= 0)
+    c.path = c.path.substring(0, q);
+  return true;
+}
+
+static void parseHeaderLine(EthConn &c)
+{
+  char *colon = strchr(c.line, ':');
+  if (!colon)
+    return;
+  *colon = '\0';
+  String headerName = c.line;
+  headerName.trim();
+  headerName.toLowerCase();
+  String value = colon + 1;
+  value.trim();
+
+  if (headerName == "content-length")
+    c.contentLength = value.toInt();
+  else if (headerName == "content-type")
+    c.contentType = value;
+  else if (headerName == "accept-encoding")
+    c.acceptEncoding = value;
+  else if (headerName == "if-none-match")
+    c.ifNoneMatch = value;
+}
+
+// Cabeceras completas: decide cómo seguir. false → ya atendida (cerrada o aparcada).
+static bool headersDone(EthConn &c)
+{
+  const bool isUpload = c.method == "POST" &&
+                        (c.path == "/upload_firmware" || c.path == "/upload_fs");
+  c.remaining = (c.contentLength > 0) ? (uint32_t)c.contentLength : 0;
+
+  if (isUpload)
+  {
+    const UploadKind kind = (c.path == "/upload_firmware") ? UP_FIRMWARE : UP_FS;
+    if (!uploadBegin(c.client, (int8_t)(&c - conns), kind, c.contentType, c.contentLength))
+    {
+      closeConn(c);
+      return false;
+    }
+    c.state = EC_UPLOAD;
+    return true;
+  }
+
+  if (c.method == "POST" && c.remaining > 0)
+  {
+    if (c.remaining > WEB_ETH_BODY_MAX)
+    {
+      sendResponse(c.client, 413, "text/plain", "Cuerpo demasiado grande");
+      closeConn(c);
+      return false;
+    }
+    c.body.reserve(c.remaining);
+    c.state = EC_BODY;
+    return true;
+  }
+
+  routeRequest(c);
+  if (c.state != EC_LOGWAIT) // un long-poll queda aparcado
+    closeConn(c);
+  return false;
+}
+
+// Consume bytes de cabecera. Devuelve los usados; el resto es cuerpo.
+static size_t feedHead(EthConn &c, const uint8_t *data, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    const char ch = (char)data[i];
+    if (ch == '\r')
+      continue;
+    if (ch != '\n')
+    {
+      if (c.lineLen >= sizeof(c.line) - 1)
+      {
+        sendResponse(c.client, 400, "text/plain", "Cabecera demasiado larga");
+        closeConn(c);
+        return len;
+      }
+      c.line[c.lineLen++] = ch;
+      continue;
+    }
+
+    c.line[c.lineLen] = '\0';
+    const bool empty = (c.lineLen == 0);
+    c.lineLen = 0;
+
+    if (!c.gotRequestLine)
+    {
+      if (empty)
+        continue; // CRLF sobrantes entre peticiones
+      if (!parseRequestLine(c))
+      {
+        mensajeError(c.client);
+        closeConn(c);
+        return len;
+      }
+      c.gotRequestLine = true;
+    }
+    else if (!empty)
+      parseHeaderLine(c);
+    else
+    {
+      headersDone(c);
+      return i + 1;
+    }
+  }
+  return len;
+}
+
+// Petición completa: se contesta y se cierra (salvo un long-poll aparcado)
+static void dispatch(EthConn &c)
+{
+  if (c.state == EC_UPLOAD)
+    uploadFinish(c.client);
+  else
+    routeRequest(c);
+  if (c.state != EC_LOGWAIT)
+    closeConn(c);
+}
+
+// Atiende una conexión sin esperar: lee lo disponible (con tope por vuelta)
+static void pumpConn(EthConn &c)
+{
+  if (c.state == EC_LOGWAIT)
+  {
+    pumpLogWait(c);
+    return;
+  }
+
+  uint8_t buf[WEB_ETH_READ_CHUNK];
+  size_t budget = (c.state == EC_UPLOAD) ? WEB_ETH_UPLOAD_PUMP_BYTES : WEB_ETH_PUMP_BYTES;
+
+  while (c.state != EC_FREE && c.state != EC_LOGWAIT && budget > 0)
+  {
+    int avail = c.client.available();
+    if (avail <= 0)
+      break;
+
+    size_t n = (size_t)avail;
+    if (n > sizeof(buf))
+      n = sizeof(buf);
+    if (n > budget)
+      n = budget;
+    if (c.state != EC_HEAD && n > c.remaining)
+      n = c.remaining;
+
+    int r = c.client.read(buf, n);
+    if (r <= 0)
+      break;
+    budget -= (size_t)r;
+    c.lastMs = millis();
+
+    size_t off = 0;
+    if (c.state == EC_HEAD)
+    {
+      off = feedHead(c, buf, (size_t)r);
+      if (c.state != EC_BODY && c.state != EC_UPLOAD)
+        continue; // sin cuerpo: ya contestada, cerrada o aparcada
+    }
+
+    // Cuerpo (lo que sobró del bloque de cabeceras también cuenta)
+    size_t n2 = (size_t)r - off;
+    if (n2 > c.remaining)
+      n2 = c.remaining;
+    if (c.state == EC_BODY)
+      c.body.concat((const char *)buf + off, n2);
+    else if (c.state == EC_UPLOAD)
+      multipartFeed(g_upload.mp, buf + off, n2);
+    c.remaining -= n2;
+
+    if (c.state != EC_HEAD && c.remaining == 0)
+      dispatch(c);
+  }
+
+  if (c.state == EC_FREE || c.state == EC_LOGWAIT)
+    return;
+
+  // Cuerpo vacío que aún no se ha despachado (POST sin datos)
+  if (c.state != EC_HEAD && c.remaining == 0)
+  {
+    dispatch(c);
+    return;
+  }
+
+  const uint32_t idle = (c.state == EC_UPLOAD) ? WEB_ETH_UPLOAD_IDLE_MS : WEB_ETH_IDLE_MS;
+  if (!c.client.connected() && c.client.available() <= 0)
+    closeConn(c);
+  else if (millis() - c.lastMs > idle)
+  {
+    g_webStats.timeouts++;
     if (debugSerie)
-      Serial.println("Cliente desconectado");
+      Serial.println("Cliente sin datos, desconectado.");
+    closeConn(c);
+  }
+}
+
+void webHandleClient()
+{
+  // Conexiones nuevas (accept() entrega cada cliente una sola vez)
+  for (EthernetClient nc = serverETH.accept(); nc; nc = serverETH.accept())
+  {
+    EthConn *slot = nullptr;
+    for (size_t i = 0; i < WEB_ETH_MAX_CONN; i++)
+      if (conns[i].state == EC_FREE)
+      {
+        slot = &conns[i];
+        break;
+      }
+
+    if (!slot)
+    {
+      g_webStats.rejected++;
+      nc.print("HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+      nc.flush();
+      nc.stop();
+      continue;
+    }
+
+    if (debugSerie)
+      Serial.println("Nuevo cliente conectado (Ethernet)");
+    slot->client = nc;
+    resetConn(*slot);
+    g_webStats.accepted++;
+  }
+
+  uint8_t active = 0;
+  for (size_t i = 0; i < WEB_ETH_MAX_CONN; i++)
+  {
+    if (conns[i].state == EC_FREE)
+      continue;
+    pumpConn(conns[i]);
+    if (conns[i].state != EC_FREE)
+      active++;
+  }
+  if (active > g_webStats.maxActive)
+    g_webStats.maxActive = active;
+}
+
+WebEthStats webEthStats()
+{
+  WebEthStats s = g_webStats;
+  s.active = 0;
+  for (size_t i = 0; i < WEB_ETH_MAX_CONN; i++)
+    if (conns[i].state != EC_FREE)
+      s.active++;
+  return s;
+}
+
+String webEthStatsJson()
+{
+  const WebEthStats s = webEthStats();
+  String json = "{\"active\":" + String(s.active);
+  json += ",\"max_active\":" + String(s.maxActive);
+  json += ",\"accepted\":" + String(s.accepted);
+  json += ",\"rejected\":" + String(s.rejected);
+  json += ",\"timeouts\":" + String(s.timeouts);
+  json += ",\"long_polls\":" + String(s.longPolls);
+  json += "}";
+  return json;
 }
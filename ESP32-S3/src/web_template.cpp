@@ -0,0 +1,178 @@
+#include "web_template.hpp"
+
+#include <string.h>
+
+enum TplState : uint8_t
+{
+  TPL_TEXT = 0,
+  TPL_OPEN1,  // visto '{'
+  TPL_NAME,   // dentro de "{{"
+  TPL_CLOSE1  // visto '}' tras el nombre
+};
+
+struct TplOut
+{
+  uint8_t buf[TPL_CHUNK];
+  size_t len;
+  size_t total;
+  bool ok;
+  TplSink sink;
+  void *ctx;
+};
+
+static void outFlush(TplOut &o)
+{
+  if (o.len > 0 && o.ok)
+    o.ok = o.sink(o.ctx, o.buf, o.len);
+  o.len = 0;
+}
+
+static void outWrite(TplOut &o, const char *s, size_t n)
+{
+  while (n > 0 && o.ok)
+  {
+    size_t room = sizeof(o.buf) - o.len;
+    size_t c = (n < room) ? n : room;
+    memcpy(o.buf + o.len, s, c);
+    o.len += c;
+    o.total += c;
+    s += c;
+    n -= c;
+    if (o.len == sizeof(o.buf))
+      outFlush(o);
+  }
+}
+
+static inline void outByte(TplOut &o, char c)
+{
+  outWrite(o, &c, 1);
+}
+
+static inline bool nameChar(char c)
+{
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static const char *lookup(const TplVar *vars, size_t n, const char *name)
+{
+  for (size_t i = 0; i < n; i++)
+    if (strcmp(vars[i].name, name) == 0)
+      return vars[i].value ? vars[i].value : "";
+  return nullptr;
+}
+
+size_t tplRender(File &file, const TplVar *vars, size_t nVars, TplSink sink, void *ctx)
+{
+  TplOut o;
+  o.len = 0;
+  o.total = 0;
+  o.ok = true;
+  o.sink = sink;
+  o.ctx = ctx;
+
+  TplState st = TPL_TEXT;
+  char name[TPL_NAME_MAX + 1];
+  size_t nameLen = 0;
+  char in[TPL_CHUNK];
+
+  while (o.ok)
+  {
+    const int r = file.read((uint8_t *)in, sizeof(in));
+    if (r <= 0)
+      break;
+
+    size_t runStart = 0; // texto literal pendiente de copiar en bloque
+    for (size_t i = 0; i < (size_t)r; i++)
+    {
+      const char c = in[i];
+      switch (st)
+      {
+      case TPL_TEXT:
+        if (c == '{')
+        {
+          outWrite(o, in + runStart, i - runStart);
+          st = TPL_OPEN1;
+        }
+        continue;
+
+      case TPL_OPEN1:
+        if (c == '{')
+        {
+          st = TPL_NAME;
+          nameLen = 0;
+        }
+        else
+        {
+          outByte(o, '{');
+          st = TPL_TEXT;
+          runStart = i;
+          i--; // se reprocesa como texto
+          continue;
+        }
+        break;
+
+      case TPL_NAME:
+        if (c == '{' && nameLen == 0)
+          outByte(o, '{'); // "{{{": la primera llave es texto
+        else if (c == '}' && nameLen > 0)
+          st = TPL_CLOSE1;
+        else if (nameChar(c) && nameLen < TPL_NAME_MAX)
+          name[nameLen++] = c;
+        else
+        {
+          // No era un marcador: se devuelve lo consumido
+          outWrite(o, "{{", 2);
+          outWrite(o, name, nameLen);
+          st = TPL_TEXT;
+          runStart = i;
+          i--;
+          continue;
+        }
+        break;
+
+      case TPL_CLOSE1:
+        if (c == '}')
+        {
+          name[nameLen] = '\0';
+          const char *v = lookup(vars, nVars, name);
+          if (v)
+            outWrite(o, v, strlen(v));
+          else
+          {
+            outWrite(o, "{{", 2);
+            outWrite(o, name, nameLen);
+            outWrite(o, "}}", 2);
+          }
+          st = TPL_TEXT;
+          runStart = i + 1;
+          continue;
+        }
+        outWrite(o, "{{", 2);
+        outWrite(o, name, nameLen);
+        outByte(o, '}');
+        st = TPL_TEXT;
+        runStart = i;
+        i--;
+        continue;
+      }
+      runStart = i + 1;
+    }
+
+    if (st == TPL_TEXT)
+      outWrite(o, in + runStart, (size_t)r - runStart);
+  }
+
+  // Marcador a medias al final del fichero: se copia tal cual
+  if (st == TPL_OPEN1)
+    outByte(o, '{');
+  else if (st == TPL_NAME || st == TPL_CLOSE1)
+  {
+    outWrite(o, "{{", 2);
+    outWrite(o, name, nameLen);
+    if (st == TPL_CLOSE1)
+      outByte(o, '}');
+  }
+
+  outFlush(o);
+  return o.total;
+}
@@ -26,7 +26,7 @@ bool isDeviceIdOK(const String &s)
       Serial.println("isDeviceIdOK: longitud incorrecta");
     }
 
-    logbuf_pushf(("Tamaño de deviceId: " + String(s.length())).c_str());
+    logbuf_pushf("Tamaño de deviceId: %u", (unsigned)s.length());
     logbuf_pushf("isDeviceIdOK: longitud incorrecta");
     return false;
   }
@@ -79,7 +79,7 @@ bool isIPv4OK(const String &ip)
       {
         if (debugSerie)
           Serial.println("isIPv4OK: octeto fuera de rango: " + String(val));
-        logbuf_pushf(("isIPv4OK: octeto fuera de rango: " + String(val)).c_str());
+        logbuf_pushf("isIPv4OK: octeto fuera de rango: %ld", (long)val);
         return false;
       }
 
@@ -23,6 +23,63 @@ static String contentTypeFromPath(const String &path)
     return "application/octet-stream";
 }
 
+// Versión gzip embebida en el firmware (o 304 si el navegador ya la tiene).
+// Devuelve false si no hay versión comprimida o el cliente no acepta gzip.
+static bool sendAssetWiFi(const String &path)
+{
+    const WebAsset *a = webAssetFind(path);
+    if (!a || !webAcceptsGzip(serverWiFi.header("Accept-Encoding")))
+        return false;
+
+    serverWiFi.sendHeader("ETag", a->etag);
+    serverWiFi.sendHeader("Cache-Control", WEB_ASSET_CACHE_CONTROL);
+    serverWiFi.sendHeader("Vary", "Accept-Encoding");
+
+    const bool notModified = webEtagMatches(a, serverWiFi.header("If-None-Match"));
+    if (notModified)
+        serverWiFi.send(304);
+    else
+    {
+        serverWiFi.sendHeader("Content-Encoding", "gzip");
+        serverWiFi.send_P(200, a->contentType, (PGM_P)a->gz, a->gzLen);
+    }
+    webAssetServed(a, notModified);
+    return true;
+}
+
+// Página estática: gzip embebido si se puede, si no la copia de LittleFS
+static void sendPageWiFi(const char *path)
+{
+    if (sendAssetWiFi(path))
+        return;
+    File f = LittleFS.open(path, "r");
+    if (f)
+    {
+        serverWiFi.streamFile(f, "text/html");
+        f.close();
+    }
+    else
+        serverWiFi.send(404);
+}
+
+// Trozo generado por la plantilla → chunk HTTP
+static bool wifiSink(void *, const uint8_t *data, size_t len)
+{
+    serverWiFi.sendContent((const char *)data, len);
+    return serverWiFi.client().connected();
+}
+
+// Página con marcadores {{...}} enviada por streaming (Transfer-Encoding: chunked)
+static void sendTemplateWiFi(File &file, const TplVar *vars, size_t nVars)
+{
+    serverWiFi.sendHeader("Cache-Control", "no-store");
+    serverWiFi.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    serverWiFi.send(200, "text/html; charset=utf-8", "");
+    tplRender(file, vars, nVars, wifiSink, nullptr);
+    serverWiFi.sendContent(""); // fin del chunked
+    file.close();
+}
+
 // ========================= Autenticación y Redirección =========================
 
 static void redirectStatusWiFi(const String &kind, const String &title, const String &msg,
@@ -60,12 +117,9 @@ void handleWiFiRoot()
         serverWiFi.send(500, "text/plain", "Error critico: No se encuentra index.html en la memoria interna.");
         return;
     }
-    String html = file.readString();
-    file.close();
-
-    html.replace("{{ERROR_MSG}}", errorMessage_eth);
+    const TplVar vars[] = {{"ERROR_MSG", errorMessage_eth.c_str()}};
+    sendTemplateWiFi(file, vars, 1);
     errorMessage_eth = "";
-    serverWiFi.send(200, "text/html; charset=utf-8", html);
 }
 
 // ========================= Handlers de Estado y UI =========================
@@ -78,8 +132,6 @@ void handleWiFiStatus()
         serverWiFi.send(500, "text/plain", "Error critico: status.html no encontrado.");
         return;
     }
-    String html = file.readString();
-    file.close();
 
     String kind = serverWiFi.arg("kind");
     if (kind != "success" && kind != "error" && kind != "info")
@@ -107,25 +159,26 @@ void handleWiFiStatus()
     if (backText.length() == 0 || backText == "Volver" || backText == "BACK_ID")
         backText = "Volver al Menú";
 
-    html.replace("{{KIND}}", htmlEscape(kind));
-    html.replace("{{TITLE}}", htmlEscape(title));
-    html.replace("{{MESSAGE}}", htmlEscape(msg));
-    html.replace("{{BACK_URL}}", htmlEscape(back));
-    html.replace("{{BACK_TEXT}}", htmlEscape(backText));
-    html.replace("{{AUTO_REDIRECT_URL}}", htmlEscape(serverWiFi.arg("redir")));
-    html.replace("{{AUTO_REDIRECT_MS}}", htmlEscape(serverWiFi.arg("ms")));
+    const String eKind = htmlEscape(kind), eTitle = htmlEscape(title), eMsg = htmlEscape(msg);
+    const String eBack = htmlEscape(back), eBackText = htmlEscape(backText);
+    const String eRedir = htmlEscape(serverWiFi.arg("redir")), eMs = htmlEscape(serverWiFi.arg("ms"));
 
     // Texto de ayuda para la redirección automática
-    if (serverWiFi.arg("redir").length() > 0 && serverWiFi.arg("ms").toInt() > 0)
-    {
-        html.replace("{{REDIRECT_HINT}}", "Redirigiendo automáticamente, espere un momento...");
-    }
-    else
-    {
-        html.replace("{{REDIRECT_HINT}}", "");
-    }
-
-    serverWiFi.send(200, "text/html; charset=utf-8", html);
+    const char *hint = (serverWiFi.arg("redir").length() > 0 && serverWiFi.arg("ms").toInt() > 0)
+                           ? "Redirigiendo automáticamente, espere un momento..."
+                           : "";
+
+    const TplVar vars[] = {
+        {"KIND", eKind.c_str()},
+        {"TITLE", eTitle.c_str()},
+        {"MESSAGE", eMsg.c_str()},
+        {"BACK_URL", eBack.c_str()},
+        {"BACK_TEXT", eBackText.c_str()},
+        {"AUTO_REDIRECT_URL", eRedir.c_str()},
+        {"AUTO_REDIRECT_MS", eMs.c_str()},
+        {"REDIRECT_HINT", hint},
+    };
+    sendTemplateWiFi(file, vars, sizeof(vars) / sizeof(vars[0]));
 }
 
 void handleWiFiSubmit()
@@ -134,7 +187,6 @@ void handleWiFiSubmit()
     {
         registrado_eth = true;
         lastActivityTime_eth = millis();
-        logbuf_clear();
         logbuf_enable(true);
         serverWiFi.sendHeader("Location", "/menu");
         serverWiFi.send(302, "text/plain", "");
@@ -162,9 +214,6 @@ void handleWiFiConfigPage()
         redirectStatusWiFi("error", "Error de Sistema", "No se ha encontrado el archivo de interfaz config.html", "/menu", "Volver al Menú");
         return;
     }
-    String html = file.readString();
-    file.close();
-
     TornoConfig c = cfgLoad();
     String currentIP, currentGW, currentMask, currentDNS1, currentDNS2;
 
@@ -185,40 +234,41 @@ void handleWiFiConfigPage()
         currentDNS2 = c.dns2;
     }
 
-    html.replace("{{DEVICE_ID}}", htmlEscape(c.deviceId));
-    html.replace("{{WIFI_SSID}}", htmlEscape(c.wifiSSID));
-    html.replace("{{WIFI_PASS}}", htmlEscape(c.wifiPass));
+    const String eDeviceId = htmlEscape(c.deviceId);
+    const String eSsid = htmlEscape(c.wifiSSID), ePass = htmlEscape(c.wifiPass);
+    const String eUrlBase = htmlEscape(c.urlBase), eUrlActualiza = htmlEscape(c.urlActualiza);
 
     char macStr[18];
     snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X", c.mac[0], c.mac[1], c.mac[2], c.mac[3], c.mac[4], c.mac[5]);
-    html.replace("{{MAC_ADDRESS}}", String(macStr));
-
-    html.replace("{{IP}}", currentIP);
-    html.replace("{{GATEWAY}}", currentGW);
-    html.replace("{{SUBNET}}", currentMask);
-    html.replace("{{DNS1}}", currentDNS1);
-    html.replace("{{DNS2}}", currentDNS2);
-
-    html.replace("{{MOD_VEGA_SEL}}", (c.modoPasillo == 0) ? "selected" : "");
-    html.replace("{{MOD_CANOPU_SEL}}", (c.modoPasillo == 1) ? "selected" : "");
-    html.replace("{{MOD_ARTURUS_SEL}}", (c.modoPasillo == 2) ? "selected" : "");
-
-    html.replace("{{SENT_LEFT_SEL}}", (c.sentidoApertura == 0) ? "selected" : "");
-    html.replace("{{SENT_RIGHT_SEL}}", (c.sentidoApertura == 1) ? "selected" : "");
-    html.replace("{{MODO_RS485_SEL}}", (c.modoApertura == 0) ? "selected" : "");
-    html.replace("{{MODO_RELES_SEL}}", (c.modoApertura == 1) ? "selected" : "");
-
-    html.replace("{{MODO_DHCP_SEL}}", (c.modoRed == 0) ? "selected" : "");
-    html.replace("{{MODO_ESTATICA_SEL}}", (c.modoRed == 1) ? "selected" : "");
-    html.replace("{{CON_WIFI_SEL}}", (c.conexionRed == 0) ? "selected" : "");
-    html.replace("{{CON_ETH_SEL}}", (c.conexionRed == 1) ? "selected" : "");
-
-    html.replace("{{URL_BASE}}", htmlEscape(c.urlBase));
-    html.replace("{{URL_ACTUALIZA}}", htmlEscape(c.urlActualiza));
-
-    html.replace("{{CFG_MSG}}", errorMessage_eth);
+    const char *SEL = "selected";
+
+    const TplVar vars[] = {
+        {"DEVICE_ID", eDeviceId.c_str()},
+        {"WIFI_SSID", eSsid.c_str()},
+        {"WIFI_PASS", ePass.c_str()},
+        {"MAC_ADDRESS", macStr},
+        {"IP", currentIP.c_str()},
+        {"GATEWAY", currentGW.c_str()},
+        {"SUBNET", currentMask.c_str()},
+        {"DNS1", currentDNS1.c_str()},
+        {"DNS2", currentDNS2.c_str()},
+        {"MOD_VEGA_SEL", (c.modoPasillo == 0) ? SEL : ""},
+        {"MOD_CANOPU_SEL", (c.modoPasillo == 1) ? SEL : ""},
+        {"MOD_ARTURUS_SEL", (c.modoPasillo == 2) ? SEL : ""},
+        {"SENT_LEFT_SEL", (c.sentidoApertura == 0) ? SEL : ""},
+        {"SENT_RIGHT_SEL", (c.sentidoApertura == 1) ? SEL : ""},
+        {"MODO_RS485_SEL", (c.modoApertura == 0) ? SEL : ""},
+        {"MODO_RELES_SEL", (c.modoApertura == 1) ? SEL : ""},
+        {"MODO_DHCP_SEL", (c.modoRed == 0) ? SEL : ""},
+        {"MODO_ESTATICA_SEL", (c.modoRed == 1) ? SEL : ""},
+        {"CON_WIFI_SEL", (c.conexionRed == 0) ? SEL : ""},
+        {"CON_ETH_SEL", (c.conexionRed == 1) ? SEL : ""},
+        {"URL_BASE", eUrlBase.c_str()},
+        {"URL_ACTUALIZA", eUrlActualiza.c_str()},
+        {"CFG_MSG", errorMessage_eth.c_str()},
+    };
+    sendTemplateWiFi(file, vars, sizeof(vars) / sizeof(vars[0]));
     errorMessage_eth = "";
-    serverWiFi.send(200, "text/html; charset=utf-8", html);
 }
 
 void handleWiFiConfigSave()
@@ -483,10 +533,15 @@ void handleWiFiParamsSave()
 
     paramsSave(p);
     paramsApplyToGlobals(p);
-    if (RS485::setParam(MACHINE_ID, (uint8_t)id, (uint16_t)val))
+
+    // Solo sale al bus lo que difiere de lo que ya tiene el torno (normalmente el menú 'id')
+    uint8_t bus[PARAMS_COUNT];
+    paramsToBus(p, bus);
+    const RS485::ParamSyncResult r = RS485::syncParams(bus, PARAMS_COUNT, RS485_PARAM_WAIT_MS);
+    if (r.ok())
     {
-        delay(150);
-        RS485::resetDevice(MACHINE_ID);
+        if (r.written > 0)
+            RS485::resetDevice(MACHINE_ID);
         serverWiFi.send(200, "application/json", "{\"status\":\"ok\"}");
     }
     else
@@ -508,11 +563,12 @@ void handleWiFiActionsPage()
         serverWiFi.send(404);
         return;
     }
-    String html = file.readString();
-    file.close();
-    html.replace("{{DEVICE_ID}}", htmlEscape(cfgLoad().deviceId));
-    html.replace("{{RS485_CLASS}}", (modoApertura == 0) ? "" : "hidden");
-    serverWiFi.send(200, "text/html; charset=utf-8", html);
+    const String eDeviceId = htmlEscape(cfgLoad().deviceId);
+    const TplVar vars[] = {
+        {"DEVICE_ID", eDeviceId.c_str()},
+        {"RS485_CLASS", (modoApertura == 0) ? "" : "hidden"},
+    };
+    sendTemplateWiFi(file, vars, 2);
 }
 
 void handleWiFiDoAction()
@@ -654,6 +710,19 @@ void handleWiFiGetStatusJson()
         json += ",\"gate_text\":\"Modo Relé\",\"fault_text\":\"N/A\",\"alarm_text\":\"N/A\"";
     }
 
+    json += ",\"colas\":" + cmdLanesStatsJson();
+    json += ",\"tickets\":" + ticketsStatsJson();
+    json += ",\"paginas\":" + webPagesStatsJson();
+    json += ",\"assets\":" + webAssetsStatsJson();
+    if (modoApertura == 0)
+    {
+      json += ",\"rs485_tx\":" + RS485::txStatsJson();
+      json += ",\"rs485_bus\":" + RS485::busStatsJson();
+    }
+    json += ",\"lector\":" + DSSP3120::scanStatsJson();
+    json += ",\"repetidas\":" + scanCacheStatsJson();
+    json += ",\"log_spool\":" + logspool_stats_json();
+    json += ",\"ota\":" + otaStatsJson();
     json += "}";
     serverWiFi.send(200, "application/json", json);
 }
@@ -667,9 +736,25 @@ void handleWiFiLogsData()
         serverWiFi.send(401);
         return;
     }
+    // Sin long-poll: WebServer atiende una petición cada vez y la espera
+    // bloquearía el resto; se contesta en el acto, en streaming
     uint32_t since = (uint32_t)serverWiFi.arg("since").toInt();
-    uint32_t next = 0;
-    serverWiFi.send(200, "application/json", logbuf_get_json_since(since, next));
+    serverWiFi.sendHeader("Cache-Control", "no-store");
+    serverWiFi.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    serverWiFi.send(200, "application/json; charset=utf-8", "");
+    logbuf_stream_json(since, wifiSink, nullptr);
+    serverWiFi.sendContent(""); // fin del chunked
+}
+
+void handleWiFiLogsSpool()
+{
+    if (!requireAuthWiFi())
+        return;
+    serverWiFi.sendHeader("Content-Disposition", "attachment; filename=\"logs.txt\"");
+    serverWiFi.sendHeader("Cache-Control", "no-store");
+    serverWiFi.setContentLength(logspool_size());
+    serverWiFi.send(200, "text/plain; charset=utf-8", "");
+    logspool_stream(wifiSink, nullptr);
 }
 
 void handleWiFiReiniciarDo()
@@ -681,17 +766,36 @@ void handleWiFiReiniciarDo()
     ESP.restart();
 }
 
+// Descarga de urlActualiza (lo mismo que pide el backend con status 310)
+void handleWiFiDownloadFirmware()
+{
+    if (!requireAuthWiFi())
+        return;
+    actualiza();
+    if (otaActive())
+        serverWiFi.send(200, "text/plain; charset=utf-8", "Descarga iniciada");
+    else
+        serverWiFi.send(409, "text/plain; charset=utf-8",
+                        fwUpdateActive() ? "Hay una subida de firmware en curso" : otaStats().lastError);
+}
+
+// Cuerpo de /upload_firmware: directo a la partición OTA (fw_update)
+static bool _fwNombreMal = false;
+static bool _fwOcupado = false; // descarga del servidor en curso
+
 void handleWiFiFirmwareUploadDo()
 {
     if (!registrado_eth)
         return;
-    static bool _abortUpload = false;
 
     HTTPUpload &upload = serverWiFi.upload();
 
     if (upload.status == UPLOAD_FILE_START)
     {
-        _abortUpload = false;
+        _fwNombreMal = false;
+        _fwOcupado = otaActive();
+        if (_fwOcupado)
+            return;
         String filename = upload.filename;
 
         int idx = filename.lastIndexOf('/');
@@ -705,39 +809,56 @@ void handleWiFiFirmwareUploadDo()
 
         if (filename != expectedName)
         {
-            _abortUpload = true;
+            _fwNombreMal = true;
             return;
         }
 
-        size_t maxSketchSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
-        if (!Update.begin(maxSketchSpace))
-        {
-            Update.printError(Serial);
-        }
+        if (!fwUpdateBegin())
+            Serial.printf("Update.begin failed: %s\n", fwUpdateError());
     }
     else if (upload.status == UPLOAD_FILE_WRITE)
     {
-        if (_abortUpload)
-            return;
-        if (Update.write(upload.buf, upload.currentSize) != upload.currentSize)
-        {
-            Update.printError(Serial);
-        }
+        if (!_fwOcupado && !_fwNombreMal && fwUpdateActive() &&
+            !fwUpdateWrite(upload.buf, upload.currentSize))
+            Serial.printf("Update.write failed: %s\n", fwUpdateError());
     }
-    else if (upload.status == UPLOAD_FILE_END)
+    else if (upload.status == UPLOAD_FILE_ABORTED)
     {
-        if (_abortUpload)
-        {
-            // Error de nombre de archivo
-            errorMessage_eth = "<span style='color:red;'>El archivo debe llamarse exactamente: " + String(DEVICE_ID) + ".bin</span>";
-            return;
-        }
+        if (!_fwOcupado)
+            fwUpdateAbort();
+    }
+    // UPLOAD_FILE_END: se cierra en handleWiFiFirmwareUploadEnd(), cuando ya
+    // están disponibles los campos del formulario (sha256)
+}
 
-        if (!Update.end(true))
-        {
-            errorMessage_eth = "<span style='color:red;'>Fallo al finalizar la actualización del firmware.</span>";
-        }
+void handleWiFiFirmwareUploadEnd()
+{
+    if (!requireAuthWiFi())
+    {
+        if (!otaActive())
+            fwUpdateAbort();
+        return;
+    }
+    if (_fwOcupado)
+    {
+        redirectStatusWiFi("error", "Descarga en curso", "El equipo está descargando firmware del servidor. Espera a que termine.", "/upload_firmware", "Reintentar");
+        return;
+    }
+    if (_fwNombreMal)
+    {
+        redirectStatusWiFi("error", "Archivo no válido", "El fichero debe llamarse exactamente: " + String(DEVICE_ID) + ".bin", "/upload_firmware", "Reintentar");
+        return;
     }
+    const String sha = serverWiFi.arg("sha256");
+    if (!fwUpdateEnd(sha.c_str()))
+    {
+        Serial.printf("Update end error: %s\n", fwUpdateError());
+        redirectStatusWiFi("error", "Fallo de Actualización", String("No se pudo procesar el archivo de firmware: ") + fwUpdateError(), "/upload_firmware", "Reintentar");
+        return;
+    }
+    redirectStatusWiFi("success", "Actualización Completada", "El nuevo firmware se ha cargado con éxito. El sistema se reiniciará ahora.", "/menu", "Menú Principal", "/menu", 5000);
+    delay(100);
+    ESP.restart();
 }
 
 void handleWiFiFsUploadDoCorrect()
@@ -763,7 +884,10 @@ void handleWiFiFsUploadDoCorrect()
     else if (upload.status == UPLOAD_FILE_END)
     {
         if (fsUploadFile)
+        {
+            webPageChanged(fsUploadFile.path()); // deja de servirse la versión gzip si ya no coincide
             fsUploadFile.close();
+        }
     }
 }
 
@@ -771,19 +895,21 @@ void handleWiFiFsUploadDoCorrect()
 
 void setupWebWiFi()
 {
+    // Cabeceras que necesitan las páginas precomprimidas
+    static const char *cabeceras[] = {"Accept-Encoding", "If-None-Match"};
+    serverWiFi.collectHeaders(cabeceras, 2);
+
     serverWiFi.on("/", HTTP_GET, handleWiFiRoot);
     serverWiFi.on("/menu", HTTP_GET, []()
                   {
         if(!requireAuthWiFi()) return;
-        File f = LittleFS.open("/menu.html", "r");
-        if(f) { serverWiFi.streamFile(f, "text/html"); f.close(); } else serverWiFi.send(404); });
+        sendPageWiFi("/menu.html"); });
     serverWiFi.on("/config", HTTP_GET, handleWiFiConfigPage);
     serverWiFi.on("/actions", HTTP_GET, handleWiFiActionsPage);
     serverWiFi.on("/params", HTTP_GET, []()
                   {
         if(!requireAuthWiFi() || modoApertura != 0) { serverWiFi.send(403); return; }
-        File f = LittleFS.open("/params.html", "r");
-        if(f) { serverWiFi.streamFile(f, "text/html"); f.close(); } else serverWiFi.send(404); });
+        sendPageWiFi("/params.html"); });
 
     serverWiFi.on("/get_all_params", HTTP_GET, handleWiFiGetAllParams);
     serverWiFi.on("/params_save", HTTP_POST, handleWiFiParamsSave);
@@ -795,16 +921,15 @@ void setupWebWiFi()
     serverWiFi.on("/logs", HTTP_GET, []()
                   {
         if(!requireAuthWiFi()) return;
-        File f = LittleFS.open("/logs.html", "r");
-        if(f) { serverWiFi.streamFile(f, "text/html"); f.close(); } else serverWiFi.send(404); });
+        sendPageWiFi("/logs.html"); });
     serverWiFi.on("/logs_data", HTTP_GET, handleWiFiLogsData);
+    serverWiFi.on("/logs_spool", HTTP_GET, handleWiFiLogsSpool);
     serverWiFi.on("/status", HTTP_GET, handleWiFiStatus);
     serverWiFi.on("/submit", HTTP_POST, handleWiFiSubmit);
     serverWiFi.on("/reiniciar", HTTP_GET, []()
                   {
         if(!requireAuthWiFi()) return;
-        File f = LittleFS.open("/reiniciar.html", "r");
-        if(f) { serverWiFi.streamFile(f, "text/html"); f.close(); } else serverWiFi.send(404); });
+        sendPageWiFi("/reiniciar.html"); });
     serverWiFi.on("/reiniciar_dispositivo", HTTP_POST, handleWiFiReiniciarDo);
     serverWiFi.on("/logout", HTTP_GET, []()
                   { registrado_eth = false; serverWiFi.sendHeader("Location", "/"); serverWiFi.send(302); });
@@ -814,27 +939,15 @@ void setupWebWiFi()
                   {
         if(!requireAuthWiFi()) return;
         File f = LittleFS.open("/upload.html", "r");
-        if(f) { String h = f.readString(); f.close(); h.replace("VERSION_FIRMWARE", enVersion); serverWiFi.send(200, "text/html", h); } else serverWiFi.send(404); });
-    serverWiFi.on("/upload_firmware", HTTP_POST, []()
-                  { 
-        if (Update.hasError()) {
-            redirectStatusWiFi("error", "Fallo de Actualización", "No se pudo procesar el archivo de firmware correctamente.", "/upload_firmware", "Reintentar");
-        }
-        else { 
-            redirectStatusWiFi("success", "Actualización Completada", "El nuevo firmware se ha cargado con éxito. El sistema se reiniciará ahora.", "/menu", "Menú Principal", "/menu", 5000); 
-            delay(100); 
-            ESP.restart(); 
-        } }, handleWiFiFirmwareUploadDo);
+        if(!f) { serverWiFi.send(404); return; }
+        const TplVar vars[] = {{"VERSION_FIRMWARE", enVersion.c_str()}};
+        sendTemplateWiFi(f, vars, 1); });
+    serverWiFi.on("/upload_firmware", HTTP_POST, handleWiFiFirmwareUploadEnd, handleWiFiFirmwareUploadDo);
+    serverWiFi.on("/download_firmware", HTTP_GET, handleWiFiDownloadFirmware);
     serverWiFi.on("/upload_fs", HTTP_GET, []()
                   { if(!requireAuthWiFi()) return;
-    File f = LittleFS.open("/upload_fs.html", "r");
-    if(f) {
-        serverWiFi.streamFile(f, "text/html");
-        f.close();
-    } else {
-        // Si el archivo no existe en LittleFS, lo servimos desde el String en PROGMEM
-        // Esto es útil si el sistema de archivos está dañado
-    } });
+    // Con gzip se sirve desde el firmware aunque el sistema de ficheros esté dañado
+    sendPageWiFi("/upload_fs.html"); });
     
     serverWiFi.on("/upload_fs", HTTP_POST, []()
                   { redirectStatusWiFi("success", "Archivo Cargado", "El archivo se ha subido correctamente al sistema de ficheros interno.", "/upload_fs", "Subir otro"); }, handleWiFiFsUploadDoCorrect);
@@ -851,6 +964,9 @@ void setupWebWiFi()
             }
         }
 
+        if (sendAssetWiFi(path))
+            return;
+
         if (LittleFS.exists(path)) {
             File f = LittleFS.open(path, "r");
             serverWiFi.streamFile(f, contentTypeFromPath(path));
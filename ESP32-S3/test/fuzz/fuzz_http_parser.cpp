@@ -0,0 +1,208 @@
+// Fuzzing del parser de respuestas HTTP (http_parser.cpp). No lo ejecuta
+// pio test: se compila a mano desde ESP32-S3/.
+//
+//   libFuzzer:
+//     clang++ -g -O1 -fsanitize=fuzzer,address,undefined -I include \
+//       test/fuzz/fuzz_http_parser.cpp -o fuzz_http_parser
+//     ./fuzz_http_parser -max_len=4096
+//
+//   Sin libFuzzer (entradas al azar, o los ficheros indicados):
+//     g++ -g -O1 -fsanitize=address,undefined -DFUZZ_STANDALONE -I include \
+//       test/fuzz/fuzz_http_parser.cpp -o fuzz_http_parser
+//     ./fuzz_http_parser [iteraciones | ficheros...]
+//
+// El primer byte de la entrada elige el troceo y el destino; el resto es la
+// respuesta. Se comprueba que la versión troceada da exactamente lo mismo que
+// una sola lectura y que nunca se escribe fuera del buffer.
+#include "../../src/http_parser.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Outcome
+{
+  HttpParseState state;
+  int status;
+  bool keepAlive;
+  bool overflow;
+  size_t bodyLen;
+  size_t rawBytes;
+  uint32_t bodyHash;
+  uint32_t headerHash;
+};
+
+struct Ctx
+{
+  uint32_t bodyHash;
+  uint32_t headerHash;
+};
+
+static uint32_t fnv(uint32_t h, const void *data, size_t n)
+{
+  const uint8_t *b = (const uint8_t *)data;
+  for (size_t i = 0; i < n; i++)
+    h = (h ^ b[i]) * 16777619u;
+  return h;
+}
+
+static bool onBody(void *ctx, const uint8_t *data, size_t len)
+{
+  Ctx *c = (Ctx *)ctx;
+  c->bodyHash = fnv(c->bodyHash, data, len);
+  return true;
+}
+
+static void onHeader(void *ctx, const char *name, const char *value)
+{
+  Ctx *c = (Ctx *)ctx;
+  c->headerHash = fnv(c->headerHash, name, strlen(name) + 1);
+  c->headerHash = fnv(c->headerHash, value, strlen(value) + 1);
+}
+
+// 'step' = 0: todo de una vez; si no, trozos de 1..step bytes según 'seed'
+static Outcome run(const uint8_t *data, size_t size, bool sink, size_t cap, unsigned step, uint32_t seed)
+{
+  static char buf[600];
+  const size_t guard = 64;
+  memset(buf, 0xA5, sizeof(buf));
+
+  Ctx ctx = {2166136261u, 2166136261u};
+  HttpRespParser p;
+  if (sink)
+    httpParserInitSink(p, onBody, &ctx);
+  else
+    httpParserInit(p, buf, cap);
+  p.onHeader = onHeader;
+  p.ctx = &ctx;
+
+  size_t pos = 0;
+  while (pos < size && !httpParserDone(p) && !httpParserFailed(p))
+  {
+    size_t n = size - pos;
+    if (step)
+    {
+      seed = seed * 1103515245u + 12345u;
+      n = 1 + (seed >> 16) % step;
+      if (n > size - pos)
+        n = size - pos;
+    }
+    const size_t used = httpParserFeed(p, data + pos, n);
+    if (used > n || (used < n && !httpParserDone(p) && !httpParserFailed(p)))
+      abort();
+    pos += used;
+    if (used < n)
+      break;
+  }
+  httpParserFinish(p);
+
+  if (!sink)
+  {
+    if (!memchr(buf, 0, cap))
+      abort(); // sin terminador dentro de la capacidad
+    for (size_t i = cap; i < cap + guard; i++)
+      if ((uint8_t)buf[i] != 0xA5)
+        abort(); // escritura fuera del buffer
+    ctx.bodyHash = fnv(2166136261u, buf, strlen(buf));
+  }
+  if (p.rawBytes != pos || p.bodyLen > p.rawBytes)
+    abort();
+
+  Outcome o = {p.state, p.status, p.keepAlive, p.overflow, p.bodyLen, p.rawBytes, ctx.bodyHash, ctx.headerHash};
+  return o;
+}
+
+static bool same(const Outcome &a, const Outcome &b)
+{
+  return a.state == b.state && a.status == b.status && a.keepAlive == b.keepAlive &&
+         a.overflow == b.overflow && a.bodyLen == b.bodyLen && a.rawBytes == b.rawBytes &&
+         a.bodyHash == b.bodyHash && a.headerHash == b.headerHash;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  if (size < 1)
+    return 0;
+  const uint8_t mode = data[0];
+  data++;
+  size--;
+
+  const bool sink = mode & 1;
+  const size_t cap = (mode & 2) ? 16 : 512;
+  const unsigned step = 1 + (mode >> 2);
+
+  const Outcome whole = run(data, size, sink, cap, 0, 0);
+  if (!same(whole, run(data, size, sink, cap, step, mode)))
+    abort();
+  if (!same(whole, run(data, size, sink, cap, 1, 0)))
+    abort();
+  return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+// Respuestas válidas que se mutan para las entradas al azar
+static const char *SEEDS[] = {
+    "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello",
+    "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5;x=1\r\nhello\r\n0\r\nX-T: 1\r\n\r\n",
+    "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 204 No Content\r\n\r\n",
+    "HTTP/1.0 200 OK\r\n\r\nhasta el cierre",
+    "HTTP/1.1 304 Not Modified\r\nContent-Length: 99\r\n\r\n",
+};
+
+int main(int argc, char **argv)
+{
+  static uint8_t in[4096];
+  if (argc > 1 && atol(argv[1]) == 0)
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      FILE *f = fopen(argv[i], "rb");
+      if (!f)
+        continue;
+      const size_t n = fread(in, 1, sizeof(in), f);
+      fclose(f);
+      LLVMFuzzerTestOneInput(in, n);
+    }
+    return 0;
+  }
+
+  const long iters = argc > 1 ? atol(argv[1]) : 200000;
+  srand(1);
+  for (long it = 0; it < iters; it++)
+  {
+    const char *s = SEEDS[rand() % (sizeof(SEEDS) / sizeof(SEEDS[0]))];
+    size_t n = strlen(s);
+    in[0] = (uint8_t)rand();
+    memcpy(in + 1, s, n);
+    n++;
+    for (int m = rand() % 6; m > 0; m--)
+    {
+      const size_t at = 1 + rand() % (n - 1);
+      switch (rand() % 4)
+      {
+      case 0: // byte cambiado
+        in[at] = (uint8_t)rand();
+        break;
+      case 1: // byte de control o separador
+        in[at] = "\r\n:; 0fF"[rand() % 8];
+        break;
+      case 2: // recorte
+        n = at;
+        break;
+      default: // duplicar un tramo
+        if (n + 16 < sizeof(in))
+        {
+          memmove(in + at + 16, in + at, n - at);
+          n += 16;
+        }
+        break;
+      }
+      if (n < 2)
+        break;
+    }
+    LLVMFuzzerTestOneInput(in, n);
+  }
+  printf("%ld entradas sin fallos\n", iters);
+  return 0;
+}
+#endif
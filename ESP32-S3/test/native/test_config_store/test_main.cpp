@@ -0,0 +1,435 @@
+// Registro de configuración A/B (config_store.cpp) y su uso en config_prefs.cpp
+// y config_params.cpp contra la NVS simulada de test/stubs/Preferences.h:
+// alternancia de ranuras, commit cortado a medias, copia vigente dañada y
+// migración desde el formato de una clave por campo.
+#include <unity.h>
+
+#include "../../support/bench.hpp"
+
+#define FAKE_LOGBUF
+#include "../../support/app_fakes.hpp"
+
+#include "../../../src/definiciones.cpp"
+#include "../../../src/config_store.cpp"
+#include "../../../src/config_prefs.cpp"
+#include "../../../src/config_params.cpp"
+
+static const uint32_t MAGIC = 0x54534554; // "TEST"
+
+static Preferences g_nvs;
+static CfgStore g_s;
+
+struct Datos
+{
+  uint32_t n;
+  char texto[40];
+};
+
+void setUp()
+{
+  hostNvsReset();
+  g_fakeLog.clear();
+  g_nvs.begin("prueba", false);
+  cfgStoreInit(g_s, g_nvs, MAGIC);
+}
+
+void tearDown()
+{
+  g_nvs.end();
+}
+
+static bool guardar(uint32_t n)
+{
+  Datos d = {};
+  d.n = n;
+  snprintf(d.texto, sizeof(d.texto), "registro %u", (unsigned)n);
+  return cfgStoreCommit(g_s, 1, &d, sizeof(d));
+}
+
+// Arranque: CfgStore nuevo sobre la misma NVS; devuelve d.n o -1
+static int arrancar(CfgStore &s)
+{
+  cfgStoreInit(s, g_nvs, MAGIC);
+  Datos d = {};
+  uint16_t schema = 0;
+  if (cfgStoreLoad(s, &d, sizeof(d), schema) != (int)sizeof(d))
+    return -1;
+  return (int)d.n;
+}
+
+static std::vector<uint8_t> &ranura(const char *ns, const char *key)
+{
+  return g_hostNvs.ns[ns][key];
+}
+
+static const uint8_t MAC_VIEJA[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+
+// NVS como la dejaba el firmware anterior: una clave por campo (cfgSave)
+static void escribirClavesConfig()
+{
+  Preferences p;
+  p.begin("torno", false);
+  p.putString("id", "ME077");
+  p.putBytes("mac", MAC_VIEJA, 6);
+  p.putString("urlBase", "http://10.0.0.9:8084/QRDService/api");
+  p.putString("urlActualiza", "http://10.0.0.9/fw");
+  p.putInt("modoPasillo", 2);
+  p.putInt("modoApertura", 1);
+  p.putInt("sentidoApertura", 1);
+  p.putInt("entradasTotales", 123456);
+  p.putInt("salidasTotales", 654321);
+  p.putInt("conexionRed", 1);
+  p.putString("wifiSSID", "museo");
+  p.putString("wifiPass", "secreto");
+  p.putInt("modoRed", 1);
+  p.putString("ip", "192.168.5.40");
+  p.putString("gw", "192.168.5.1");
+  p.putString("mask", "255.255.255.0");
+  p.putString("dns1", "8.8.8.8");
+  p.putString("dns2", "1.1.1.1");
+  p.putUInt("dcrc", 0xCAFEF00Du);
+  p.end();
+}
+
+// Parámetros técnicos por claves "p0".."p36" (salvo 'falta', si es >= 0)
+static void escribirClavesParams(int falta)
+{
+  Preferences p;
+  p.begin("params", false);
+  char k[6];
+  for (int i = 0; i <= 36; i++)
+  {
+    if (i == falta)
+      continue;
+    snprintf(k, sizeof(k), "p%d", i);
+    p.putUInt(k, 100 + i);
+  }
+  p.putUInt("pcrc", 0x1234);
+  p.end();
+}
+
+static void test_ab_alternation()
+{
+  CfgStore s;
+  TEST_ASSERT_EQUAL_INT(-1, arrancar(s));
+
+  TEST_ASSERT_TRUE(guardar(10));
+  TEST_ASSERT_EQUAL_UINT8(0, g_s.slot);
+  TEST_ASSERT_TRUE(guardar(11));
+  TEST_ASSERT_EQUAL_UINT8(1, g_s.slot);
+  TEST_ASSERT_TRUE(guardar(12));
+  TEST_ASSERT_EQUAL_UINT8(0, g_s.slot);
+  TEST_ASSERT_EQUAL_UINT32(3, g_s.commits);
+  TEST_ASSERT_EQUAL_UINT32(3, g_hostNvs.puts); // un putBytes por commit
+
+  // Al arrancar gana la secuencia más alta y el siguiente commit va a la otra
+  TEST_ASSERT_EQUAL_INT(12, arrancar(s));
+  TEST_ASSERT_EQUAL_UINT32(3, s.seq);
+  TEST_ASSERT_EQUAL_UINT8(0, s.slot);
+  TEST_ASSERT_EQUAL_UINT32(0, s.badSlots);
+  Datos d = {};
+  d.n = 13;
+  TEST_ASSERT_TRUE(cfgStoreCommit(s, 1, &d, sizeof(d)));
+  TEST_ASSERT_EQUAL_UINT8(1, s.slot);
+  TEST_ASSERT_EQUAL_INT(13, arrancar(s));
+}
+
+// Corte a mitad del putBytes: la ranura destino queda a medias, la vigente
+// intacta, y el siguiente commit reescribe la misma ranura destino
+static void test_torn_commit()
+{
+  TEST_ASSERT_TRUE(guardar(20));
+  TEST_ASSERT_TRUE(guardar(21));
+  const std::vector<uint8_t> vigente = ranura("prueba", "cfgB");
+
+  g_hostNvs.failPut = 0;
+  TEST_ASSERT_FALSE(guardar(22));
+  TEST_ASSERT_EQUAL_UINT8(1, g_s.slot);
+  TEST_ASSERT_EQUAL_UINT32(2, g_s.seq);
+  TEST_ASSERT_TRUE(ranura("prueba", "cfgA").size() < sizeof(CfgStoreHdr) + sizeof(Datos));
+  TEST_ASSERT_TRUE(vigente == ranura("prueba", "cfgB"));
+
+  CfgStore s;
+  TEST_ASSERT_EQUAL_INT(21, arrancar(s));
+  TEST_ASSERT_EQUAL_UINT32(1, s.badSlots);
+
+  TEST_ASSERT_TRUE(guardar(22));
+  TEST_ASSERT_EQUAL_UINT8(0, g_s.slot);
+  TEST_ASSERT_EQUAL_INT(22, arrancar(s));
+  TEST_ASSERT_EQUAL_UINT32(0, s.badSlots);
+}
+
+// Copia vigente dañada (un bit, otro magic, longitud que no cuadra): se
+// usa la anterior
+static void test_corrupt_slot_falls_back()
+{
+  TEST_ASSERT_TRUE(guardar(30));
+  TEST_ASSERT_TRUE(guardar(31)); // vigente en B
+  CfgStore s;
+
+  ranura("prueba", "cfgB")[sizeof(CfgStoreHdr) + 2] ^= 0x04;
+  TEST_ASSERT_EQUAL_INT(30, arrancar(s));
+  TEST_ASSERT_EQUAL_UINT32(1, s.badSlots);
+  TEST_ASSERT_EQUAL_UINT8(0, s.slot);
+
+  // El siguiente commit sustituye a la dañada
+  Datos d = {};
+  d.n = 32;
+  TEST_ASSERT_TRUE(cfgStoreCommit(s, 1, &d, sizeof(d)));
+  TEST_ASSERT_EQUAL_INT(32, arrancar(s));
+  TEST_ASSERT_EQUAL_UINT32(0, s.badSlots);
+
+  ranura("prueba", "cfgB")[0] ^= 0xFF; // magic
+  TEST_ASSERT_EQUAL_INT(30, arrancar(s));
+  ranura("prueba", "cfgA").push_back(0); // longitud
+  TEST_ASSERT_EQUAL_INT(-1, arrancar(s));
+  TEST_ASSERT_EQUAL_UINT32(2, s.badSlots);
+
+  // Registro de otro módulo (otro magic) en la misma NVS: no se acepta
+  g_hostNvs.ns["prueba"].clear();
+  TEST_ASSERT_TRUE(guardar(33));
+  cfgStoreInit(s, g_nvs, MAGIC + 1);
+  Datos d2;
+  uint16_t schema;
+  TEST_ASSERT_EQUAL_INT(-1, cfgStoreLoad(s, &d2, sizeof(d2), schema));
+}
+
+// La secuencia se compara con aritmética modular: el paso de 0xFFFFFFFF a 0
+// no hace ganar a la copia antigua
+static void test_sequence_wrap()
+{
+  g_s.seq = 0xFFFFFFFEu;
+  TEST_ASSERT_TRUE(guardar(40)); // seq 0xFFFFFFFF en B
+  TEST_ASSERT_TRUE(guardar(41)); // seq 0 en A
+  CfgStore s;
+  TEST_ASSERT_EQUAL_INT(41, arrancar(s));
+  TEST_ASSERT_EQUAL_UINT32(0, s.seq);
+}
+
+// Esquema y longitud distintos: se devuelve lo guardado y el llamador decide
+static void test_schema_and_length()
+{
+  const uint8_t corto[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  TEST_ASSERT_TRUE(cfgStoreCommit(g_s, 7, corto, sizeof(corto)));
+  CfgStore s;
+  cfgStoreInit(s, g_nvs, MAGIC);
+  uint8_t out[16];
+  memset(out, 0xEE, sizeof(out));
+  uint16_t schema = 0;
+  TEST_ASSERT_EQUAL_INT(8, cfgStoreLoad(s, out, sizeof(out), schema));
+  TEST_ASSERT_EQUAL_UINT16(7, schema);
+  TEST_ASSERT_EQUAL_MEMORY(corto, out, 8);
+  TEST_ASSERT_EQUAL_HEX8(0xEE, out[8]); // lo que no estaba guardado no se toca
+
+  // Más largo que el destino: se copia hasta 'cap' y se informa de la longitud
+  memset(out, 0, sizeof(out));
+  TEST_ASSERT_EQUAL_INT(8, cfgStoreLoad(s, out, 4, schema));
+  TEST_ASSERT_EQUAL_UINT8(0, out[4]);
+
+  static uint8_t grande[CFG_STORE_MAX + 1];
+  TEST_ASSERT_FALSE(cfgStoreCommit(g_s, 1, grande, sizeof(grande)));
+  TEST_ASSERT_TRUE(cfgStoreCommit(g_s, 1, grande, CFG_STORE_MAX));
+}
+
+// NVS escrita por el firmware anterior (una clave por campo, como hacía
+// cfgSave): el primer arranque la pasa a registro y borra las claves
+static void test_config_migrates_from_keys()
+{
+  escribirClavesConfig();
+
+  TEST_ASSERT_TRUE(cfgBegin());
+  TEST_ASSERT_TRUE(fakeLogHas("migrada del formato por claves"));
+  auto &ns = g_hostNvs.ns["torno"];
+  TEST_ASSERT_EQUAL_UINT32(1, ns.size()); // solo queda cfgA
+  TEST_ASSERT_TRUE(ns.count("cfgA") == 1);
+
+  // Siguiente arranque: se lee el registro de una vez
+  g_hostNvs.calls = 0;
+  TEST_ASSERT_TRUE(cfgBegin());
+  TEST_ASSERT_TRUE(g_hostNvs.calls <= 8);
+  const CfgRecord &r = cfgView();
+  TEST_ASSERT_EQUAL_STRING("ME077", r.deviceId);
+  TEST_ASSERT_EQUAL_MEMORY(MAC_VIEJA, r.mac, 6);
+  TEST_ASSERT_EQUAL_STRING("http://10.0.0.9:8084/QRDService/api", r.urlBase);
+  TEST_ASSERT_EQUAL_STRING("museo", r.wifiSSID);
+  TEST_ASSERT_EQUAL_STRING("secreto", r.wifiPass);
+  TEST_ASSERT_EQUAL_UINT8(2, r.modoPasillo);
+  TEST_ASSERT_EQUAL_UINT32(123456, r.entradasTotales);
+  TEST_ASSERT_EQUAL_UINT32(654321, r.salidasTotales);
+  TEST_ASSERT_EQUAL_UINT8(1, r.modoRed);
+  const uint8_t ip[4] = {192, 168, 5, 40}, dns2[4] = {1, 1, 1, 1};
+  TEST_ASSERT_EQUAL_MEMORY(ip, r.ip, 4);
+  TEST_ASSERT_EQUAL_MEMORY(dns2, r.dns2, 4);
+  TEST_ASSERT_EQUAL_HEX32(0xCAFEF00Du, r.defaultsSig);
+
+  // Y lo que ve la página de configuración
+  const TornoConfig c = cfgLoad();
+  TEST_ASSERT_EQUAL_STRING("192.168.5.40", c.ip.c_str());
+  TEST_ASSERT_EQUAL_STRING("255.255.255.0", c.mask.c_str());
+}
+
+// cfgSave cortado a medias: sigue la configuración anterior, entera
+static void test_config_save_torn()
+{
+  TEST_ASSERT_TRUE(cfgBegin());
+  cfgEnsureFirmwareDefaults(); // NVS vacía: guarda los defaults con su firma
+  TEST_ASSERT_TRUE(cfgView().defaultsSig != 0);
+
+  TornoConfig c = cfgLoad();
+  c.deviceId = "ME090";
+  c.wifiSSID = "otra-red";
+  c.ip = "10.1.2.3";
+  g_hostNvs.failPut = 0;
+  TEST_ASSERT_FALSE(cfgSave(c));
+  TEST_ASSERT_TRUE(fakeLogHas("ERROR al escribir el registro"));
+  TEST_ASSERT_EQUAL_STRING(DEVICE_ID.c_str(), cfgView().deviceId);
+
+  TEST_ASSERT_TRUE(cfgBegin());
+  TEST_ASSERT_EQUAL_STRING(DEVICE_ID.c_str(), cfgView().deviceId);
+  TEST_ASSERT_EQUAL_STRING(ssidComercio.c_str(), cfgView().wifiSSID);
+
+  TEST_ASSERT_TRUE(cfgSave(c));
+  TEST_ASSERT_TRUE(cfgBegin());
+  TEST_ASSERT_EQUAL_STRING("ME090", cfgView().deviceId);
+  TEST_ASSERT_EQUAL_STRING("otra-red", cfgView().wifiSSID);
+  // Los defaults del firmware no cambiaron: no se vuelven a aplicar
+  cfgEnsureFirmwareDefaults();
+  TEST_ASSERT_EQUAL_STRING("ME090", cfgView().deviceId);
+}
+
+// Parámetros técnicos por claves "p0".."p36": a registro, con los que
+// falten al valor de fábrica
+static void test_params_migrate_from_keys()
+{
+  escribirClavesParams(20); // p20 nunca guardado: queda el de fábrica
+
+  TEST_ASSERT_TRUE(paramsBegin());
+  TEST_ASSERT_TRUE(fakeLogHas("Params: migrados del formato por claves"));
+  TEST_ASSERT_EQUAL_UINT32(1, g_hostNvs.ns["params"].size());
+
+  TEST_ASSERT_TRUE(paramsBegin());
+  const TornoParams &t = paramsView();
+  TEST_ASSERT_EQUAL_UINT16(100, t.machineId);
+  TEST_ASSERT_EQUAL_UINT16(102, t.waitTime);
+  TEST_ASSERT_EQUAL_UINT16(122, t.irDelay);
+  TEST_ASSERT_EQUAL_UINT8(136, t.lightSlave);
+  TEST_ASSERT_EQUAL_UINT8(5, t.motorResist);
+
+  uint8_t bus[PARAMS_COUNT];
+  paramsToBus(t, bus);
+  TEST_ASSERT_EQUAL_UINT8(100, bus[0]);
+  TEST_ASSERT_EQUAL_UINT8(5, bus[20]);
+  TEST_ASSERT_EQUAL_UINT8(136, bus[36]);
+
+  // Un commit cortado no cambia lo cargado en el siguiente arranque
+  TornoParams n = t;
+  n.voiceVol = 1;
+  g_hostNvs.failPut = 0;
+  TEST_ASSERT_FALSE(paramsSave(n));
+  TEST_ASSERT_TRUE(paramsBegin());
+  TEST_ASSERT_EQUAL_UINT8(105, paramsView().voiceVol);
+}
+
+// Registro escrito por un firmware más nuevo (vuelta atrás tras una OTA):
+// se usa sin reescribirlo
+static void test_newer_schema_not_rewritten()
+{
+  TEST_ASSERT_TRUE(cfgBegin());
+  CfgRecord r = cfgView();
+  strlcpy(r.deviceId, "ME555", sizeof(r.deviceId));
+  Preferences p;
+  p.begin("torno", false);
+  CfgStore s;
+  cfgStoreInit(s, p, CFG_MAGIC);
+  TEST_ASSERT_TRUE(cfgStoreCommit(s, CFG_SCHEMA + 1, &r, sizeof(r)));
+  const std::vector<uint8_t> antes = ranura("torno", "cfgA");
+
+  g_hostNvs.puts = 0;
+  TEST_ASSERT_TRUE(cfgBegin());
+  TEST_ASSERT_TRUE(fakeLogHas("registro de esquema 2"));
+  TEST_ASSERT_EQUAL_STRING("ME555", cfgView().deviceId);
+  TEST_ASSERT_EQUAL_UINT32(0, g_hostNvs.puts);
+  TEST_ASSERT_TRUE(antes == ranura("torno", "cfgA"));
+}
+
+// Arranque del firmware anterior: config y parámetros leídos clave a clave
+static void arranqueViejo()
+{
+  prefs.begin(NS, false);
+  CfgRecord r;
+  cfgToRecord(cfgBuildDefaultsFromGlobals(), r);
+  cfgLoadLegacy(r);
+  pPrefs.begin(NS_P, false);
+  TornoParams t = PARAMS_DEFAULTS;
+  paramsLoadLegacy(t);
+}
+
+// Arranque actual: un registro por espacio de nombres (lo mismo que hacen
+// cfgBegin y paramsBegin, sin el registro en el log)
+static void arranqueNuevo()
+{
+  prefs.begin(NS, false);
+  cfgStoreInit(g_store, prefs, CFG_MAGIC);
+  CfgRecord r;
+  cfgToRecord(cfgBuildDefaultsFromGlobals(), r);
+  uint16_t schema = 0;
+  TEST_ASSERT_EQUAL_INT((int)sizeof(r), cfgStoreLoad(g_store, &r, sizeof(r), schema));
+  pPrefs.begin(NS_P, false);
+  cfgStoreInit(g_pStore, pPrefs, PARAMS_MAGIC);
+  TornoParams t = PARAMS_DEFAULTS;
+  TEST_ASSERT_EQUAL_INT((int)sizeof(t), cfgStoreLoad(g_pStore, &t, sizeof(t), schema));
+}
+
+// Coste de arrancar con el formato por claves frente al registro: llamadas
+// a la NVS y entradas leídas (deterministas) y tiempo y reservas (solo se
+// informa: la NVS simulada no cuesta nada por llamada y en el ESP32-S3 cada
+// una busca la clave en flash, así que ahí manda el número de llamadas)
+static void test_boot_cost_keys_vs_record()
+{
+  const uint32_t iters = 2000;
+  escribirClavesConfig();
+  escribirClavesParams(-1);
+
+  g_hostNvs.calls = g_hostNvs.entries = 0;
+  arranqueViejo();
+  const uint32_t llamadasViejo = g_hostNvs.calls, entradasViejo = g_hostNvs.entries;
+  BenchHeap m = benchHeapMark();
+  const double nsViejo = benchNsPerIter(iters, arranqueViejo);
+  const uint64_t reservasViejo = benchHeapSince(m).allocs / iters;
+
+  TEST_ASSERT_TRUE(cfgBegin()); // migración a registro
+  TEST_ASSERT_TRUE(paramsBegin());
+  g_hostNvs.calls = g_hostNvs.entries = 0;
+  arranqueNuevo();
+  const uint32_t llamadasNuevo = g_hostNvs.calls, entradasNuevo = g_hostNvs.entries;
+  m = benchHeapMark();
+  const double nsNuevo = benchNsPerIter(iters, arranqueNuevo);
+  const uint64_t reservasNuevo = benchHeapSince(m).allocs / iters;
+
+  // Lo cargado es lo mismo que daba el formato por claves
+  TEST_ASSERT_EQUAL_STRING("ME077", cfgView().deviceId);
+  TEST_ASSERT_EQUAL_UINT8(136, paramsView().lightSlave);
+
+  TEST_ASSERT_TRUE(llamadasNuevo * 4 <= llamadasViejo);
+  TEST_ASSERT_TRUE(entradasNuevo < entradasViejo);
+  benchReport("arranque config+params, claves", "%u llamadas NVS, %u entradas, %.0f ns, %llu reservas",
+              (unsigned)llamadasViejo, (unsigned)entradasViejo, nsViejo, (unsigned long long)reservasViejo);
+  benchReport("arranque config+params, registro", "%u llamadas NVS, %u entradas, %.0f ns, %llu reservas",
+              (unsigned)llamadasNuevo, (unsigned)entradasNuevo, nsNuevo, (unsigned long long)reservasNuevo);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_ab_alternation);
+  RUN_TEST(test_torn_commit);
+  RUN_TEST(test_corrupt_slot_falls_back);
+  RUN_TEST(test_sequence_wrap);
+  RUN_TEST(test_schema_and_length);
+  RUN_TEST(test_config_migrates_from_keys);
+  RUN_TEST(test_config_save_torn);
+  RUN_TEST(test_params_migrate_from_keys);
+  RUN_TEST(test_newer_schema_not_rewritten);
+  RUN_TEST(test_boot_cost_keys_vs_record);
+  return UNITY_END();
+}
@@ -0,0 +1,247 @@
+// Motor asíncrono de http.cpp (httpSubmit/httpPoll) contra un backend lento:
+// el plazo de cada petición cuenta desde que se encola, tanto si está en
+// vuelo como si espera detrás de otra.
+#include <unity.h>
+
+#define FAKE_JSON
+#define FAKE_FW_UPDATE
+#define FAKE_LOGBUF
+#include "../../support/app_fakes.hpp"
+#include "../../support/host_http.hpp"
+
+#include "../../../src/definiciones.cpp"
+#include "../../../src/http_parser.cpp"
+#include "../../../src/ota_delta.cpp"
+#include "../../../src/http.cpp"
+
+#include <vector>
+
+static HostHttpServer *srv;
+
+struct Done
+{
+  HttpReqKind kind;
+  bool ok;
+  uint32_t atMs;
+};
+static std::vector<Done> g_done;
+static uint32_t g_t0;
+
+static void onDone(HttpReqKind kind, bool ok)
+{
+  g_done.push_back({kind, ok, (uint32_t)(millis() - g_t0)});
+}
+
+// Vueltas de taskNet: httpPoll() cada 'periodMs' hasta 'ms' o hasta vaciar la cola
+static void pump(uint32_t ms, uint32_t periodMs = 2)
+{
+  const uint32_t t0 = millis();
+  while (millis() - t0 < ms)
+  {
+    httpPoll();
+    if (httpIdle())
+      return;
+    delay(periodMs);
+  }
+}
+
+static const Done *doneOf(HttpReqKind kind)
+{
+  for (auto &d : g_done)
+    if (d.kind == kind)
+      return &d;
+  return nullptr;
+}
+
+static HostHttpReply slow(uint32_t ms)
+{
+  HostHttpReply r;
+  r.delayMs = ms;
+  r.body = "{\"ok\":1}";
+  return r;
+}
+
+void setUp()
+{
+  hostReset(5000000);
+  hostNetReset();
+  g_fakeJson = FakeJson();
+  g_fakeLog.clear();
+  g_done.clear();
+  debugSerie = 0;
+  conexionRed = 1;
+  Ethernet.hostIP = IPAddress(192, 168, 1, 20);
+  serverURL = "http://10.0.0.5:8084/api";
+  srv = new HostHttpServer(8084);
+  srv->fallback.body = "{\"ok\":1}";
+  g_t0 = millis();
+}
+
+void tearDown()
+{
+  pump(10000);
+  httpPoolReset();
+  g_poolStats = {0, 0, 0, 0};
+  g_asyncStats = {0, 0, 0, 0, 0, 0};
+  delete srv;
+}
+
+static void test_requests_complete_in_order()
+{
+  TEST_ASSERT_TRUE(httpSubmit(REQ_ESTADO, onDone));
+  TEST_ASSERT_TRUE(httpSubmit(REQ_TICKET, onDone));
+  TEST_ASSERT_TRUE(httpSubmit(REQ_PASO, onDone));
+  TEST_ASSERT_TRUE(httpPending(REQ_TICKET));
+  pump(1000);
+
+  TEST_ASSERT_TRUE(httpIdle());
+  TEST_ASSERT_EQUAL(3, g_done.size());
+  TEST_ASSERT_EQUAL(REQ_ESTADO, g_done[0].kind);
+  TEST_ASSERT_EQUAL(REQ_TICKET, g_done[1].kind);
+  TEST_ASSERT_EQUAL(REQ_PASO, g_done[2].kind);
+  for (auto &d : g_done)
+    TEST_ASSERT_TRUE(d.ok);
+  TEST_ASSERT_EQUAL_STRING("/api/validateQR", srv->requests[1].path.c_str());
+  TEST_ASSERT_EQUAL(1, g_fakeJson.qr.size());
+  TEST_ASSERT_EQUAL(1, srv->accepted); // una sola conexión keep-alive
+  TEST_ASSERT_EQUAL_UINT32(3, httpAsyncStats().completed);
+}
+
+static void test_submit_does_not_block()
+{
+  srv->script.push_back(slow(3000));
+  const uint32_t t0 = millis();
+  TEST_ASSERT_TRUE(httpSubmit(REQ_ESTADO, onDone));
+  httpPoll(); // conecta y envía
+  httpPoll();
+  TEST_ASSERT_EQUAL_UINT32(t0, millis()); // ni un milisegundo esperando al backend
+  TEST_ASSERT_EQUAL(1, srv->requests.size());
+  TEST_ASSERT_FALSE(httpIdle());
+}
+
+// El núcleo de la revisión: la segunda espera detrás de una lenta y vence a
+// su hora, sin esperar a que la primera termine y sin llegar a enviarse
+static void test_queued_request_expires_behind_slow_one()
+{
+  srv->script.push_back(slow(3000));
+  TEST_ASSERT_TRUE(httpSubmit(REQ_ESTADO, onDone, 4000));
+  TEST_ASSERT_TRUE(httpSubmit(REQ_TICKET, onDone, 1000));
+  pump(5000);
+
+  const Done *ticket = doneOf(REQ_TICKET);
+  const Done *estado = doneOf(REQ_ESTADO);
+  TEST_ASSERT_NOT_NULL(ticket);
+  TEST_ASSERT_NOT_NULL(estado);
+  TEST_ASSERT_FALSE(ticket->ok);
+  TEST_ASSERT_UINT32_WITHIN(5, 1000, ticket->atMs);
+  TEST_ASSERT_TRUE(estado->ok);
+  TEST_ASSERT_UINT32_WITHIN(5, 3000, estado->atMs);
+  TEST_ASSERT_TRUE(ticket->atMs < estado->atMs);
+
+  // La vencida no llegó a enviarse y se trató como fallo de validación
+  TEST_ASSERT_EQUAL(1, srv->requests.size());
+  TEST_ASSERT_EQUAL(VERROR, g_validateOutcome);
+  TEST_ASSERT_EQUAL(1, g_fakeJson.resets);
+
+  HttpAsyncStats s = httpAsyncStats();
+  TEST_ASSERT_EQUAL_UINT32(1, s.timedOut);
+  TEST_ASSERT_EQUAL_UINT32(1, s.completed);
+  TEST_ASSERT_UINT32_WITHIN(5, 3000, s.maxLatencyMs);
+}
+
+static void test_expired_in_the_middle_keeps_fifo_order()
+{
+  srv->script.push_back(slow(2000));
+  httpSubmit(REQ_ESTADO, onDone, 4000);
+  httpSubmit(REQ_TICKET, onDone, 500);
+  httpSubmit(REQ_PASO, onDone, 4000);
+  httpSubmit(REQ_FAILURE, onDone, 700);
+  pump(6000);
+
+  TEST_ASSERT_EQUAL(4, g_done.size());
+  TEST_ASSERT_EQUAL(REQ_TICKET, g_done[0].kind);
+  TEST_ASSERT_EQUAL(REQ_FAILURE, g_done[1].kind);
+  TEST_ASSERT_EQUAL(REQ_ESTADO, g_done[2].kind);
+  TEST_ASSERT_EQUAL(REQ_PASO, g_done[3].kind);
+  TEST_ASSERT_UINT32_WITHIN(5, 500, g_done[0].atMs);
+  TEST_ASSERT_UINT32_WITHIN(5, 700, g_done[1].atMs);
+  TEST_ASSERT_TRUE(g_done[3].ok);
+  TEST_ASSERT_EQUAL(2, srv->requests.size());
+  TEST_ASSERT_EQUAL_STRING("/api/validatePass", srv->requests[1].path.c_str());
+}
+
+// Enviada tarde por esperar en cola: vence en vuelo a su plazo desde el encolado
+static void test_wait_in_queue_counts_toward_deadline()
+{
+  srv->script.push_back(slow(800));
+  srv->script.push_back(slow(600));
+  httpSubmit(REQ_ESTADO, onDone, 4000);
+  httpSubmit(REQ_TICKET, onDone, 1000);
+  pump(5000);
+
+  const Done *ticket = doneOf(REQ_TICKET);
+  TEST_ASSERT_NOT_NULL(ticket);
+  TEST_ASSERT_FALSE(ticket->ok);
+  TEST_ASSERT_UINT32_WITHIN(5, 1000, ticket->atMs); // no 800 + 600
+  TEST_ASSERT_EQUAL(2, srv->requests.size());
+  TEST_ASSERT_EQUAL_UINT32(1, httpAsyncStats().timedOut);
+}
+
+static void test_in_flight_timeout_drops_the_connection()
+{
+  srv->script.push_back(slow(2000));
+  httpSubmit(REQ_ESTADO, onDone, 500);
+  pump(1000);
+  TEST_ASSERT_EQUAL(1, g_done.size());
+  TEST_ASSERT_FALSE(g_done[0].ok);
+  TEST_ASSERT_UINT32_WITHIN(5, 500, g_done[0].atMs);
+
+  // La respuesta tardía no se mezcla con la siguiente: conexión nueva
+  delay(2000);
+  httpSubmit(REQ_PASO, onDone);
+  pump(1000);
+  TEST_ASSERT_EQUAL(2, g_done.size());
+  TEST_ASSERT_TRUE(g_done[1].ok);
+  TEST_ASSERT_EQUAL(2, srv->accepted);
+  TEST_ASSERT_EQUAL(1, g_fakeJson.paso.size());
+  TEST_ASSERT_EQUAL_STRING("{\"ok\":1}", g_fakeJson.paso[0].c_str());
+}
+
+static void test_full_queue_rejects()
+{
+  srv->script.push_back(slow(100));
+  for (int i = 0; i < HTTP_ASYNC_QUEUE_LEN; i++)
+    TEST_ASSERT_TRUE(httpSubmit(REQ_ESTADO, onDone));
+  TEST_ASSERT_FALSE(httpSubmit(REQ_TICKET, onDone));
+  TEST_ASSERT_EQUAL_UINT32(1, httpAsyncStats().rejected);
+  TEST_ASSERT_FALSE(httpPending(REQ_TICKET));
+  pump(3000);
+  TEST_ASSERT_EQUAL(HTTP_ASYNC_QUEUE_LEN, g_done.size());
+}
+
+static void test_blocking_call_waits_for_the_active_request()
+{
+  srv->script.push_back(slow(300));
+  httpSubmit(REQ_ESTADO, onDone);
+  httpPoll(); // en vuelo
+  getInicio(); // misma conexión: espera a que termine la asíncrona
+  TEST_ASSERT_EQUAL(1, g_done.size());
+  TEST_ASSERT_TRUE(g_done[0].ok);
+  TEST_ASSERT_EQUAL(2, srv->requests.size());
+  TEST_ASSERT_EQUAL_STRING("/api/inicio", srv->requests[1].path.c_str());
+  TEST_ASSERT_TRUE(iniciOk);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_requests_complete_in_order);
+  RUN_TEST(test_submit_does_not_block);
+  RUN_TEST(test_queued_request_expires_behind_slow_one);
+  RUN_TEST(test_expired_in_the_middle_keeps_fifo_order);
+  RUN_TEST(test_wait_in_queue_counts_toward_deadline);
+  RUN_TEST(test_in_flight_timeout_drops_the_connection);
+  RUN_TEST(test_full_queue_rejects);
+  RUN_TEST(test_blocking_call_waits_for_the_active_request);
+  return UNITY_END();
+}
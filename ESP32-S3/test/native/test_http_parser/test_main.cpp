@@ -0,0 +1,404 @@
+// Parser incremental de respuestas (http_parser.cpp): cada respuesta de
+// prueba se trocea en todos los puntos posibles (uno y dos cortes, byte a
+// byte y al azar) y el resultado tiene que ser idéntico al de una sola
+// lectura. Al final, rendimiento en bytes/s y reservas de memoria.
+#include <unity.h>
+
+#include "../../support/bench.hpp"
+#include "../../../src/http_parser.cpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Parsed
+{
+  int status;
+  bool done;
+  bool failed;
+  bool keepAlive;
+  bool overflow;
+  size_t bodyLen;
+  size_t consumed; // bytes que el parser tomó de la entrada
+  std::string body;
+  std::string headers; // "nombre=valor\n" en orden de llegada
+};
+
+struct Case
+{
+  const char *name;
+  std::string wire;  // respuesta (más, quizá, el principio de la siguiente)
+  size_t respLen;    // bytes que pertenecen a esta respuesta
+  bool needsFinish;  // el cuerpo termina con el cierre
+  int status;
+  bool keepAlive;
+  std::string body;
+  std::string headers;
+};
+
+struct SinkCtx
+{
+  Parsed *out;
+  size_t abortAfter; // 0 = nunca
+};
+
+static void onHeader(void *ctx, const char *name, const char *value)
+{
+  Parsed *r = ((SinkCtx *)ctx)->out;
+  r->headers += name;
+  r->headers += '=';
+  r->headers += value;
+  r->headers += '\n';
+}
+
+static bool onBody(void *ctx, const uint8_t *data, size_t len)
+{
+  SinkCtx *s = (SinkCtx *)ctx;
+  s->out->body.append((const char *)data, len);
+  return !(s->abortAfter && s->out->body.size() >= s->abortAfter);
+}
+
+// Alimenta 'wire' cortado en 'cuts' (posiciones crecientes). Como el cliente
+// real, deja de alimentar en cuanto la respuesta termina o falla.
+static Parsed parse(const std::string &wire, const std::vector<size_t> &cuts, bool sink,
+                    size_t cap = 512, bool finish = true, size_t abortAfter = 0)
+{
+  Parsed r = {};
+  SinkCtx ctx = {&r, abortAfter};
+  std::vector<char> buf(cap ? cap : 1);
+  HttpRespParser p;
+  if (sink)
+    httpParserInitSink(p, onBody, &ctx);
+  else
+    httpParserInit(p, cap ? buf.data() : nullptr, cap);
+  p.onHeader = onHeader;
+  p.ctx = &ctx;
+
+  size_t pos = 0;
+  for (size_t k = 0; k <= cuts.size() && !httpParserDone(p) && !httpParserFailed(p); k++)
+  {
+    const size_t end = (k < cuts.size()) ? cuts[k] : wire.size();
+    if (end < pos)
+      continue;
+    const size_t used = httpParserFeed(p, (const uint8_t *)wire.data() + pos, end - pos);
+    TEST_ASSERT_TRUE(used <= end - pos);
+    if (used < end - pos)
+      TEST_ASSERT_TRUE(httpParserDone(p) || httpParserFailed(p));
+    r.consumed += used;
+    pos = end;
+  }
+  if (finish && !httpParserDone(p) && !httpParserFailed(p))
+    httpParserFinish(p);
+
+  r.status = p.status;
+  r.done = httpParserDone(p);
+  r.failed = httpParserFailed(p);
+  r.keepAlive = p.keepAlive;
+  r.overflow = p.overflow;
+  r.bodyLen = p.bodyLen;
+  TEST_ASSERT_EQUAL_size_t(r.consumed, p.rawBytes);
+  if (!sink && cap)
+  {
+    TEST_ASSERT_TRUE(memchr(buf.data(), 0, cap) != nullptr);
+    r.body = buf.data();
+  }
+  return r;
+}
+
+static void expectSame(const Parsed &a, const Parsed &b, const char *what)
+{
+  TEST_ASSERT_EQUAL_INT_MESSAGE(a.status, b.status, what);
+  TEST_ASSERT_EQUAL_MESSAGE(a.done, b.done, what);
+  TEST_ASSERT_EQUAL_MESSAGE(a.failed, b.failed, what);
+  TEST_ASSERT_EQUAL_MESSAGE(a.keepAlive, b.keepAlive, what);
+  TEST_ASSERT_EQUAL_MESSAGE(a.overflow, b.overflow, what);
+  TEST_ASSERT_EQUAL_size_t_MESSAGE(a.bodyLen, b.bodyLen, what);
+  TEST_ASSERT_EQUAL_size_t_MESSAGE(a.consumed, b.consumed, what);
+  TEST_ASSERT_EQUAL_STRING_MESSAGE(a.body.c_str(), b.body.c_str(), what);
+  TEST_ASSERT_EQUAL_STRING_MESSAGE(a.headers.c_str(), b.headers.c_str(), what);
+}
+
+static const char *NEXT = "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nnext";
+
+static std::vector<Case> cases()
+{
+  std::vector<Case> v;
+  std::string w;
+
+  w = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 11\r\n\r\n{\"ok\":true}";
+  v.push_back({"content-length", w + NEXT, w.size(), false, 200, true, "{\"ok\":true}",
+               "Content-Type=application/json\nContent-Length=11\n"});
+
+  const std::string big(26, 'z');
+  w = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5;ext=1\r\nHello\r\n1A\r\n" + big + "\r\n0\r\n\r\n";
+  v.push_back({"chunked", w + NEXT, w.size(), false, 200, true, "Hello" + big, "Transfer-Encoding=chunked\n"});
+
+  w = "HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip, Chunked\r\n\r\n3\r\nabc\r\n\r\n2\r\nde\r\n0\r\nX-Checksum: 77\r\nX-Count :  2 \r\n\r\n";
+  v.push_back({"chunked+trailers", w + NEXT, w.size(), false, 200, true, "abcde",
+               "Transfer-Encoding=gzip, Chunked\nX-Checksum=77\nX-Count=2\n"});
+
+  w = "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 103 Early Hints\r\nLink: </s.css>\r\n\r\n"
+      "HTTP/1.1 201 Created\r\nContent-Length: 2\r\n\r\nok";
+  v.push_back({"1xx", w + NEXT, w.size(), false, 201, true, "ok", "Link=</s.css>\nContent-Length=2\n"});
+
+  w = "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n";
+  v.push_back({"204", w + NEXT, w.size(), false, 204, true, "", "Content-Length=0\n"});
+
+  w = "HTTP/1.1 204 No Content\r\n\r\n";
+  v.push_back({"204 sin longitud", w + NEXT, w.size(), false, 204, true, "", ""});
+
+  w = "HTTP/1.1 304 Not Modified\r\nETag: \"a1\"\r\nContent-Length: 1234\r\n\r\n";
+  v.push_back({"304", w + NEXT, w.size(), false, 304, true, "", "ETag=\"a1\"\nContent-Length=1234\n"});
+
+  w = "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n\r\nlinea1\nlinea2\r\n";
+  v.push_back({"hasta EOF (1.0)", w, w.size(), true, 200, false, "linea1\nlinea2\r\n", "Content-Type=text/plain\n"});
+
+  w = "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\n\r\nsin longitud";
+  v.push_back({"hasta EOF (1.1)", w, w.size(), true, 200, false, "sin longitud", "Connection=keep-alive\n"});
+
+  w = "HTTP/1.0 200 OK\r\nConnection: Keep-Alive\r\nContent-Length: 2\r\n\r\nhi";
+  v.push_back({"1.0 keep-alive", w + NEXT, w.size(), false, 200, true, "hi", "Connection=Keep-Alive\nContent-Length=2\n"});
+
+  w = "\r\n\r\nHTTP/1.1 500 Internal\r\nconnection: CLOSE\r\ncontent-LENGTH: 3\r\n\r\nerr";
+  v.push_back({"close + mayúsculas", w + NEXT, w.size(), false, 500, false, "err", "connection=CLOSE\ncontent-LENGTH=3\n"});
+
+  w = "HTTP/1.1 200 OK\nContent-Length: 3\n\nabc";
+  v.push_back({"solo LF", w + NEXT, w.size(), false, 200, true, "abc", "Content-Length=3\n"});
+  return v;
+}
+
+static std::string label(const Case &c, const char *how, size_t a = 0, size_t b = 0)
+{
+  char t[128];
+  snprintf(t, sizeof(t), "%s [%s %u %u]", c.name, how, (unsigned)a, (unsigned)b);
+  return t;
+}
+
+static void checkCase(const Case &c, const Parsed &r, const std::string &what)
+{
+  TEST_ASSERT_TRUE_MESSAGE(r.done, what.c_str());
+  TEST_ASSERT_FALSE_MESSAGE(r.failed, what.c_str());
+  TEST_ASSERT_EQUAL_INT_MESSAGE(c.status, r.status, what.c_str());
+  TEST_ASSERT_EQUAL_MESSAGE(c.keepAlive, r.keepAlive, what.c_str());
+  TEST_ASSERT_EQUAL_STRING_MESSAGE(c.body.c_str(), r.body.c_str(), what.c_str());
+  TEST_ASSERT_EQUAL_STRING_MESSAGE(c.headers.c_str(), r.headers.c_str(), what.c_str());
+  if (!c.needsFinish)
+    TEST_ASSERT_EQUAL_size_t_MESSAGE(c.respLen, r.consumed, what.c_str());
+}
+
+static void test_whole_response()
+{
+  for (const Case &c : cases())
+    for (int sink = 0; sink < 2; sink++)
+      checkCase(c, parse(c.wire, {}, sink), label(c, sink ? "sink" : "buf"));
+}
+
+static void test_eof_body_needs_finish()
+{
+  for (const Case &c : cases())
+  {
+    const Parsed r = parse(c.wire, {}, false, 512, false);
+    TEST_ASSERT_EQUAL_MESSAGE(!c.needsFinish, r.done, c.name);
+  }
+}
+
+static void test_split_at_every_offset()
+{
+  for (const Case &c : cases())
+    for (int sink = 0; sink < 2; sink++)
+    {
+      const Parsed whole = parse(c.wire, {}, sink);
+      for (size_t k = 0; k <= c.wire.size(); k++)
+        expectSame(whole, parse(c.wire, {k}, sink), label(c, "1 corte", k).c_str());
+    }
+}
+
+static void test_split_at_every_pair_of_offsets()
+{
+  for (const Case &c : cases())
+  {
+    const Parsed whole = parse(c.wire, {}, false);
+    for (size_t a = 0; a <= c.wire.size(); a++)
+      for (size_t b = a; b <= c.wire.size(); b++)
+        expectSame(whole, parse(c.wire, {a, b}, false), label(c, "2 cortes", a, b).c_str());
+  }
+}
+
+static void test_byte_at_a_time()
+{
+  for (const Case &c : cases())
+  {
+    std::vector<size_t> cuts;
+    for (size_t k = 1; k < c.wire.size(); k++)
+      cuts.push_back(k);
+    for (int sink = 0; sink < 2; sink++)
+      checkCase(c, parse(c.wire, cuts, sink), label(c, "byte a byte"));
+  }
+}
+
+// Entrada de troceo aleatorio (la misma idea que test/fuzz/fuzz_http_parser.cpp)
+static void test_random_splits()
+{
+  std::mt19937 rng(12345);
+  for (const Case &c : cases())
+  {
+    const Parsed whole = parse(c.wire, {}, false);
+    for (int it = 0; it < 2000; it++)
+    {
+      std::vector<size_t> cuts;
+      const size_t n = rng() % 12;
+      for (size_t k = 0; k < n; k++)
+        cuts.push_back(rng() % (c.wire.size() + 1));
+      std::sort(cuts.begin(), cuts.end());
+      expectSame(whole, parse(c.wire, cuts, (it & 1) != 0), label(c, "azar", (size_t)it).c_str());
+    }
+  }
+}
+
+static void test_body_larger_than_buffer()
+{
+  const std::string w = "HTTP/1.1 200 OK\r\nContent-Length: 20\r\n\r\n0123456789abcdefghij";
+  for (size_t k = 0; k <= w.size(); k++)
+  {
+    const Parsed r = parse(w, {k}, false, 8);
+    TEST_ASSERT_TRUE(r.done);
+    TEST_ASSERT_TRUE(r.overflow);
+    TEST_ASSERT_EQUAL_size_t(20, r.bodyLen);
+    TEST_ASSERT_EQUAL_STRING("0123456", r.body.c_str());
+  }
+  // Cabe justo (7 + '\0')
+  const Parsed r = parse("HTTP/1.1 200 OK\r\nContent-Length: 7\r\n\r\n0123456", {}, false, 8);
+  TEST_ASSERT_FALSE(r.overflow);
+  TEST_ASSERT_EQUAL_STRING("0123456", r.body.c_str());
+}
+
+static void test_malformed_responses_fail()
+{
+  const char *bad[] = {
+      "HTML/1.1 200 OK\r\n\r\n",
+      "HTTP/1.1 abc\r\n\r\n",
+      "HTTP/1.1 42 Too small\r\n\r\n",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabcX\r\n",
+  };
+  for (const char *w : bad)
+  {
+    const std::string s(w);
+    for (size_t k = 0; k <= s.size(); k++)
+    {
+      const Parsed r = parse(s, {k}, false);
+      TEST_ASSERT_TRUE_MESSAGE(r.failed, w);
+      TEST_ASSERT_FALSE_MESSAGE(r.done, w);
+    }
+  }
+}
+
+static void test_truncated_responses_fail_on_close()
+{
+  const char *cut[] = {
+      "",
+      "HTTP/1.1 200",
+      "HTTP/1.1 200 OK\r\nContent-Len",
+      "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nabc",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nab",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n0\r\nX-Trailer: 1\r\n",
+  };
+  for (const char *w : cut)
+  {
+    const Parsed r = parse(w, {}, false);
+    TEST_ASSERT_FALSE_MESSAGE(r.done, w);
+    TEST_ASSERT_TRUE_MESSAGE(r.failed, w);
+  }
+}
+
+static void test_sink_can_abort()
+{
+  const std::string w = "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n0123456789";
+  const Parsed r = parse(w, {w.size() - 6}, true, 0, true, 3);
+  TEST_ASSERT_TRUE(r.failed);
+  TEST_ASSERT_EQUAL_STRING("0123", r.body.c_str());
+}
+
+static void test_reset_keeps_destination()
+{
+  char buf[32];
+  HttpRespParser p;
+  httpParserInit(p, buf, sizeof(buf));
+  const char *a = "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nabc";
+  httpParserFeed(p, (const uint8_t *)a, strlen(a));
+  TEST_ASSERT_TRUE(httpParserDone(p));
+  httpParserReset(p);
+  TEST_ASSERT_EQUAL_STRING("", buf);
+  TEST_ASSERT_EQUAL(0, p.status);
+  const char *b = "HTTP/1.1 201 Created\r\nContent-Length: 2\r\n\r\nxy";
+  httpParserFeed(p, (const uint8_t *)b, strlen(b));
+  TEST_ASSERT_TRUE(httpParserDone(p));
+  TEST_ASSERT_EQUAL_STRING("xy", buf);
+  TEST_ASSERT_EQUAL_size_t(strlen(b), p.rawBytes);
+}
+
+// ============================== Rendimiento =================================
+
+static bool discard(void *, const uint8_t *, size_t) { return true; }
+
+static void benchFeed(const char *name, const std::string &wire, size_t block, bool sink, uint32_t iters)
+{
+  static char buf[2048];
+  HttpRespParser p;
+  bool ok = true;
+  const BenchHeap m = benchHeapMark();
+  const double ns = benchNsPerIter(iters, [&]()
+                                   {
+    if (sink)
+      httpParserInitSink(p, discard, nullptr);
+    else
+      httpParserInit(p, buf, sizeof(buf));
+    for (size_t i = 0; i < wire.size(); i += block)
+      httpParserFeed(p, (const uint8_t *)wire.data() + i, std::min(block, wire.size() - i));
+    ok = ok && httpParserDone(p); });
+  const BenchHeap h = benchHeapSince(m);
+  TEST_ASSERT_TRUE(ok);
+  TEST_ASSERT_EQUAL_UINT32(0, h.allocs); // sin memoria dinámica
+  benchReport(name, "%8.1f MB/s  %6.0f ns/resp  %llu allocs", wire.size() / ns * 1000.0, ns,
+              (unsigned long long)h.allocs);
+}
+
+static void test_bench_throughput_and_allocations()
+{
+  std::string json = "{";
+  while (json.size() < 600)
+    json += "\"campo" + std::to_string(json.size()) + "\":\"valor\",";
+  json += "\"fin\":1}";
+  const std::string resp = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+                           std::to_string(json.size()) + "\r\nConnection: keep-alive\r\n\r\n" + json;
+  benchFeed("json 600 B, bloques de 256", resp, 256, false, 20000);
+  benchFeed("json 600 B, byte a byte", resp, 1, false, 2000);
+
+  std::string chunked = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+  for (int i = 0; i < 64; i++)
+    chunked += "400\r\n" + std::string(1024, 'x') + "\r\n";
+  chunked += "0\r\n\r\n";
+  benchFeed("chunked 64 KiB, bloques de 1024", chunked, 1024, true, 500);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_whole_response);
+  RUN_TEST(test_eof_body_needs_finish);
+  RUN_TEST(test_split_at_every_offset);
+  RUN_TEST(test_split_at_every_pair_of_offsets);
+  RUN_TEST(test_byte_at_a_time);
+  RUN_TEST(test_random_splits);
+  RUN_TEST(test_body_larger_than_buffer);
+  RUN_TEST(test_malformed_responses_fail);
+  RUN_TEST(test_truncated_responses_fail_on_close);
+  RUN_TEST(test_sink_can_abort);
+  RUN_TEST(test_reset_keeps_destination);
+  RUN_TEST(test_bench_throughput_and_allocations);
+  return UNITY_END();
+}
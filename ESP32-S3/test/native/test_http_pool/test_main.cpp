@@ -0,0 +1,237 @@
+// Pool keep-alive de http.cpp contra un backend simulado (test/support/host_http.hpp):
+// reutilización de la conexión, "Connection: close", caducidad por
+// inactividad, conexión medio cerrada por el servidor y un pool por transporte.
+#include <unity.h>
+
+#define FAKE_JSON
+#define FAKE_FW_UPDATE
+#define FAKE_LOGBUF
+#include "../../support/app_fakes.hpp"
+#include "../../support/host_http.hpp"
+
+#include "../../../src/definiciones.cpp"
+#include "../../../src/http_parser.cpp"
+#include "../../../src/ota_delta.cpp"
+#include "../../../src/http.cpp"
+
+static HostHttpServer *srv;
+
+void setUp()
+{
+  hostReset(1000000);
+  hostNetReset();
+  g_fakeJson = FakeJson();
+  g_fakeLog.clear();
+  debugSerie = 0;
+  conexionRed = 0;
+  WiFi.hostStatus = WL_CONNECTED;
+  Ethernet.hostIP = IPAddress(192, 168, 1, 20);
+  serverURL = "http://10.0.0.5:8084/api";
+  srv = new HostHttpServer(8084);
+  srv->fallback.body = "{\"ok\":1}";
+}
+
+void tearDown()
+{
+  httpPoolReset();
+  g_poolStats = {0, 0, 0, 0};
+  delete srv;
+}
+
+static void test_requests_share_one_connection()
+{
+  getEstado();
+  delay(50);
+  getEstado();
+  delay(50);
+  getEstado();
+
+  TEST_ASSERT_EQUAL(3, srv->requests.size());
+  TEST_ASSERT_EQUAL(1, srv->accepted);
+  for (auto &r : srv->requests)
+  {
+    TEST_ASSERT_EQUAL(1, r.conn);
+    TEST_ASSERT_EQUAL_STRING("/api/status", r.path.c_str());
+    TEST_ASSERT_TRUE(r.hasHeader("Connection: keep-alive"));
+    TEST_ASSERT_TRUE(r.hasHeader("Host: 10.0.0.5:8084"));
+  }
+  HttpPoolStats s = httpPoolStats();
+  TEST_ASSERT_EQUAL_UINT32(1, s.connects);
+  TEST_ASSERT_EQUAL_UINT32(2, s.reuses);
+  TEST_ASSERT_EQUAL_UINT32(0, s.reconnects);
+  TEST_ASSERT_EQUAL(3, g_fakeJson.estado.size());
+  TEST_ASSERT_EQUAL_STRING("{\"ok\":1}", g_fakeJson.estado[2].c_str());
+}
+
+static void test_body_is_sent_with_content_length()
+{
+  postTicket();
+  TEST_ASSERT_EQUAL(1, srv->requests.size());
+  const HostHttpRequest &r = srv->requests[0];
+  TEST_ASSERT_EQUAL_STRING("POST", r.method.c_str());
+  TEST_ASSERT_EQUAL_STRING("/api/validateQR", r.path.c_str());
+  TEST_ASSERT_EQUAL_STRING(outputTicket.c_str(), r.body.c_str());
+  TEST_ASSERT_TRUE(r.hasHeader("Content-Type: application/json"));
+}
+
+static void test_connection_close_opens_a_new_one()
+{
+  HostHttpReply cerrar;
+  cerrar.keepAlive = false;
+  srv->script.push_back(cerrar);
+
+  getEstado();
+  getEstado();
+
+  TEST_ASSERT_EQUAL(2, srv->accepted);
+  TEST_ASSERT_EQUAL(1, srv->requests[0].conn);
+  TEST_ASSERT_EQUAL(2, srv->requests[1].conn);
+  TEST_ASSERT_EQUAL_UINT32(2, httpPoolStats().connects);
+  TEST_ASSERT_EQUAL_UINT32(0, httpPoolStats().reuses);
+  TEST_ASSERT_EQUAL(2, g_fakeJson.estado.size());
+}
+
+static void test_idle_connection_expires()
+{
+  getEstado();
+  delay(HTTP_KEEPALIVE_IDLE_MS + 10);
+  getEstado();
+
+  HttpPoolStats s = httpPoolStats();
+  TEST_ASSERT_EQUAL_UINT32(2, s.connects);
+  TEST_ASSERT_EQUAL_UINT32(1, s.expired);
+  TEST_ASSERT_EQUAL_UINT32(0, s.reuses);
+  TEST_ASSERT_EQUAL(2, srv->accepted);
+
+  // Justo por debajo del límite sigue valiendo
+  delay(HTTP_KEEPALIVE_IDLE_MS - 10);
+  getEstado();
+  TEST_ASSERT_EQUAL_UINT32(1, httpPoolStats().reuses);
+}
+
+static void test_server_closed_idle_connection_is_not_reused()
+{
+  getEstado();
+  srv->closeAll(); // el backend cierra la persistente por su cuenta
+  delay(5);
+  getEstado();
+
+  HttpPoolStats s = httpPoolStats();
+  TEST_ASSERT_EQUAL_UINT32(2, s.connects);
+  TEST_ASSERT_EQUAL_UINT32(0, s.reuses);
+  TEST_ASSERT_EQUAL_UINT32(0, s.reconnects);
+  TEST_ASSERT_EQUAL(2, g_fakeJson.estado.size());
+}
+
+static void test_half_closed_reused_connection_is_retried_once()
+{
+  getEstado();
+
+  // La conexión parece viva pero el servidor la cierra al llegar la petición
+  HostHttpReply corta;
+  corta.drop = true;
+  srv->script.push_back(corta);
+  getEstado();
+
+  TEST_ASSERT_EQUAL(3, srv->requests.size());
+  TEST_ASSERT_EQUAL(1, srv->requests[1].conn);
+  TEST_ASSERT_EQUAL(2, srv->requests[2].conn);
+  HttpPoolStats s = httpPoolStats();
+  TEST_ASSERT_EQUAL_UINT32(2, s.connects);
+  TEST_ASSERT_EQUAL_UINT32(1, s.reuses);
+  TEST_ASSERT_EQUAL_UINT32(1, s.reconnects);
+  TEST_ASSERT_EQUAL(2, g_fakeJson.estado.size());
+  TEST_ASSERT_TRUE(iniciOk);
+}
+
+static void test_fresh_connection_is_not_retried()
+{
+  HostHttpReply corta;
+  corta.drop = true;
+  srv->script.push_back(corta);
+
+  getInicio();
+
+  TEST_ASSERT_EQUAL(1, srv->requests.size());
+  TEST_ASSERT_EQUAL_UINT32(0, httpPoolStats().reconnects);
+  TEST_ASSERT_FALSE(iniciOk);
+  iniciOk = true;
+}
+
+static void test_partial_response_is_not_retried()
+{
+  getEstado();
+
+  // Llega parte de la respuesta y se corta: reintentar duplicaría la petición
+  HostHttpReply media;
+  media.raw = "HTTP/1.1 200 OK\r\nContent-Length: 50\r\n\r\n{\"ok\"";
+  media.closeAfter = true;
+  srv->script.push_back(media);
+  postTicket();
+
+  TEST_ASSERT_EQUAL(2, srv->requests.size());
+  TEST_ASSERT_EQUAL_UINT32(0, httpPoolStats().reconnects);
+  TEST_ASSERT_EQUAL(0, g_fakeJson.qr.size());
+  TEST_ASSERT_EQUAL(1, g_fakeJson.resets);
+}
+
+static void test_each_transport_keeps_its_own_connection()
+{
+  getEstado(); // WiFi
+  conexionRed = 1;
+  getEstado(); // Ethernet
+  getEstado();
+  conexionRed = 0;
+  getEstado();
+
+  TEST_ASSERT_EQUAL(2, srv->accepted);
+  TEST_ASSERT_EQUAL(1, srv->requests[0].conn);
+  TEST_ASSERT_EQUAL(2, srv->requests[1].conn);
+  TEST_ASSERT_EQUAL(2, srv->requests[2].conn);
+  TEST_ASSERT_EQUAL(1, srv->requests[3].conn);
+  TEST_ASSERT_EQUAL_UINT32(2, httpPoolStats().reuses);
+}
+
+static void test_other_destination_replaces_the_connection()
+{
+  HostHttpServer otro(9000);
+  getEstado();
+  serverURL = "http://10.0.0.5:9000/api";
+  getEstado();
+  serverURL = "http://10.0.0.5:8084/api";
+  getEstado();
+
+  TEST_ASSERT_EQUAL(2, srv->accepted);
+  TEST_ASSERT_EQUAL(1, otro.accepted);
+  TEST_ASSERT_EQUAL_UINT32(3, httpPoolStats().connects);
+}
+
+static void test_no_transport_no_connection()
+{
+  WiFi.hostStatus = WL_DISCONNECTED;
+  getEstado();
+  TEST_ASSERT_EQUAL(0, srv->accepted);
+  TEST_ASSERT_EQUAL(0, g_fakeJson.estado.size());
+
+  srv->refuse = true;
+  WiFi.hostStatus = WL_CONNECTED;
+  getEstado();
+  TEST_ASSERT_EQUAL_UINT32(0, httpPoolStats().connects);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_requests_share_one_connection);
+  RUN_TEST(test_body_is_sent_with_content_length);
+  RUN_TEST(test_connection_close_opens_a_new_one);
+  RUN_TEST(test_idle_connection_expires);
+  RUN_TEST(test_server_closed_idle_connection_is_not_reused);
+  RUN_TEST(test_half_closed_reused_connection_is_retried_once);
+  RUN_TEST(test_fresh_connection_is_not_retried);
+  RUN_TEST(test_partial_response_is_not_retried);
+  RUN_TEST(test_each_transport_keeps_its_own_connection);
+  RUN_TEST(test_other_destination_replaces_the_connection);
+  RUN_TEST(test_no_transport_no_connection);
+  return UNITY_END();
+}
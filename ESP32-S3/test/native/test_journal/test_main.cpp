@@ -0,0 +1,415 @@
+// Diario de validaciones pendientes de ticket.cpp: un apagón corta el
+// segmento (o el cursor) en cualquier byte y, tras reiniciar, se reenvían al
+// backend simulado todas las entradas escritas por completo, sin perder
+// ninguna. La RAM usada al arrancar y al reenviar no depende de cuánto se
+// haya acumulado. Los bloques salen por el motor asíncrono de http.cpp y el
+// cursor solo avanza cuando el backend los confirma.
+#include <unity.h>
+
+#define FAKE_JSON
+#define FAKE_FW_UPDATE
+#define FAKE_LOGBUF
+#define FAKE_TIME
+#include "../../support/app_fakes.hpp"
+#include "../../support/host_http.hpp"
+#include "../../support/bench.hpp"
+
+#include "../../../src/definiciones.cpp"
+#include "../../../src/http_parser.cpp"
+#include "../../../src/ota_delta.cpp"
+#include "../../../src/http.cpp"
+#include "../../../src/ticket.cpp"
+
+#include <set>
+
+static HostHttpServer *srv;
+
+static std::string codigo(uint32_t i)
+{
+  char c[24];
+  snprintf(c, sizeof(c), "%019llu", 1000000000000000000ULL + (unsigned long long)i * 104729ULL);
+  return c;
+}
+
+static const size_t FRAME = sizeof(JnlFrameHdr) + 19 + sizeof(uint32_t);
+
+static std::string rutaSeg(uint32_t seg)
+{
+  char r[32];
+  rutaSegmento(seg, r, sizeof(r));
+  return r;
+}
+
+// Reinicio: se pierde todo lo que había en RAM y se vuelve a abrir el diario
+static bool reiniciar()
+{
+  if (g_jnlFile)
+    g_jnlFile.close();
+  g_jnlFirst = g_jnlLast = 1;
+  g_jnlWriteOff = 0;
+  g_jnlSeq = 0;
+  g_jnlCur = {JNL_CURSOR_MAGIC, 1, 0, 0};
+  g_pend = {};
+  g_pendEnVuelo = false;
+  g_pendNextMs = 0;
+  return pendientesBegin();
+}
+
+// Copia profunda de LittleFS (el estado en el instante del apagón)
+static std::map<std::string, std::vector<uint8_t>> foto()
+{
+  std::map<std::string, std::vector<uint8_t>> f;
+  for (auto &e : g_hostFs.files)
+    f[e.first] = *e.second;
+  return f;
+}
+
+static void restaurar(const std::map<std::string, std::vector<uint8_t>> &f)
+{
+  if (g_jnlFile)
+    g_jnlFile.close();
+  g_hostFs.files.clear();
+  for (auto &e : f)
+    g_hostFs.files[e.first] = std::make_shared<std::vector<uint8_t>>(e.second);
+}
+
+// Lo que ha recibido /entries/pending, en orden
+static std::vector<std::string> recibidos()
+{
+  std::vector<std::string> v;
+  for (auto &r : srv->requests)
+  {
+    if (r.path != "/api/entries/pending")
+      continue;
+    size_t pos = r.body.find('\n') + 1; // primera línea: "<id>;"
+    while (pos < r.body.size())
+    {
+      const size_t fin = r.body.find('\n', pos);
+      const std::string l = r.body.substr(pos, fin - pos);
+      v.push_back(l.substr(0, l.find(':')));
+      pos = fin + 1;
+    }
+  }
+  return v;
+}
+
+// Un bloque como en taskNet: se encola y se dan vueltas de httpPoll() hasta
+// que el backend contesta. true si lo confirmó
+static bool enviarBloque()
+{
+  const uint32_t fallos = pendientesStats().failedPosts;
+  if (!reenviarTicketsPendientesComoBloque())
+    return false;
+  for (int i = 0; i < 10000 && pendientesEnviando(); i++)
+  {
+    httpPoll();
+    delay(1);
+  }
+  TEST_ASSERT_FALSE(pendientesEnviando());
+  return pendientesStats().failedPosts == fallos;
+}
+
+// Reenvía hasta vaciar el diario
+static void vaciar()
+{
+  for (int i = 0; i < 10000 && hayTicketsPendientes(); i++)
+    TEST_ASSERT_TRUE(enviarBloque());
+  TEST_ASSERT_FALSE(hayTicketsPendientes());
+}
+
+void setUp()
+{
+  hostReset(1000000);
+  hostNetReset();
+  hostFsReset();
+  g_fakeLog.clear();
+  debugSerie = 0;
+  conexionRed = 1;
+  Ethernet.hostIP = IPAddress(192, 168, 1, 20);
+  serverURL = "http://10.0.0.5:8084/api";
+  DEVICE_ID = "T1";
+  srv = new HostHttpServer(8084);
+  srv->fallback.body = "OK";
+  srv->fallback.contentType = "text/plain";
+  TEST_ASSERT_TRUE(reiniciar());
+}
+
+void tearDown()
+{
+  if (g_jnlFile)
+    g_jnlFile.close();
+  httpPoolReset();
+  delete srv;
+}
+
+static void test_frames_round_trip_in_batches()
+{
+  const uint32_t n = 2 * JOURNAL_BATCH + 5;
+  for (uint32_t i = 0; i < n; i++)
+    guardarTicketPendiente(codigo(i).c_str(), (int)i % 3 + 1);
+  TEST_ASSERT_EQUAL_UINT32(n, pendientesStats().pending);
+
+  TEST_ASSERT_TRUE(reiniciar());
+  TEST_ASSERT_EQUAL_UINT32(n, pendientesStats().pending);
+  vaciar();
+
+  const std::vector<std::string> v = recibidos();
+  TEST_ASSERT_EQUAL(n, v.size());
+  for (uint32_t i = 0; i < n; i++)
+    TEST_ASSERT_EQUAL_STRING(codigo(i).c_str(), v[i].c_str());
+  TEST_ASSERT_EQUAL(3, srv->requests.size());
+  TEST_ASSERT_EQUAL(0, srv->requests[0].body.find("T1;\n"));
+  TEST_ASSERT_TRUE(srv->requests[0].body.find(codigo(1) + ":2;\n") != std::string::npos);
+  TEST_ASSERT_EQUAL_UINT32(n, pendientesStats().acked);
+  TEST_ASSERT_EQUAL_UINT32(0, pendientesStats().pending);
+}
+
+// Apagón a mitad de escritura: el segmento activo acaba en cualquier byte
+static void test_truncate_active_segment_at_every_offset()
+{
+  const uint32_t n = 10;
+  for (uint32_t i = 0; i < n; i++)
+    guardarTicketPendiente(codigo(i).c_str(), 1);
+  const auto antes = foto();
+  const std::string seg = rutaSeg(1);
+  TEST_ASSERT_EQUAL(n * FRAME, antes.at(seg).size());
+
+  for (size_t corte = 0; corte <= n * FRAME; corte++)
+  {
+    restaurar(antes);
+    hostFsTruncate(seg, corte);
+    srv->requests.clear();
+    TEST_ASSERT_TRUE(reiniciar());
+
+    const uint32_t completas = (uint32_t)(corte / FRAME);
+    TEST_ASSERT_EQUAL_UINT32(completas, pendientesStats().pending);
+    // Con una trama a medias se escribe en un segmento nuevo, nunca detrás
+    TEST_ASSERT_EQUAL_UINT32(corte % FRAME ? 2 : 1, pendientesStats().segments);
+
+    guardarTicketPendiente("NUEVA-DESPUES-CORTE", 2);
+    TEST_ASSERT_TRUE(reiniciar());
+    TEST_ASSERT_EQUAL_UINT32(completas + 1, pendientesStats().pending);
+    vaciar();
+
+    const std::vector<std::string> v = recibidos();
+    TEST_ASSERT_EQUAL_MESSAGE(completas + 1, v.size(), "entradas reenviadas");
+    for (uint32_t i = 0; i < completas; i++)
+      TEST_ASSERT_EQUAL_STRING(codigo(i).c_str(), v[i].c_str());
+    TEST_ASSERT_EQUAL_STRING("NUEVA-DESPUES-CORTE", v[completas].c_str());
+  }
+}
+
+// Varios segmentos, parte ya confirmada: se corta el último en cada byte y no
+// se reenvía lo confirmado ni se pierde lo pendiente
+static void test_truncate_after_partial_ack_at_every_offset()
+{
+  const uint32_t porSeg = JOURNAL_SEG_BYTES / FRAME;
+  const uint32_t n = porSeg + 6; // el segundo segmento con 6 tramas
+  for (uint32_t i = 0; i < n; i++)
+    guardarTicketPendiente(codigo(i).c_str(), 1);
+  TEST_ASSERT_EQUAL_UINT32(2, pendientesStats().segments);
+  TEST_ASSERT_TRUE(enviarBloque());
+  const uint32_t confirmadas = JOURNAL_BATCH;
+
+  const auto antes = foto();
+  const std::string seg = rutaSeg(2);
+  const size_t tam = antes.at(seg).size();
+  TEST_ASSERT_EQUAL(6 * FRAME, tam);
+
+  for (size_t corte = 0; corte <= tam; corte++)
+  {
+    restaurar(antes);
+    hostFsTruncate(seg, corte);
+    srv->requests.clear();
+    TEST_ASSERT_TRUE(reiniciar());
+
+    const uint32_t esperadas = porSeg - confirmadas + (uint32_t)(corte / FRAME);
+    TEST_ASSERT_EQUAL_UINT32(esperadas, pendientesStats().pending);
+    vaciar();
+
+    const std::vector<std::string> v = recibidos();
+    TEST_ASSERT_EQUAL(esperadas, v.size());
+    for (uint32_t i = 0; i < esperadas; i++)
+      TEST_ASSERT_EQUAL_STRING(codigo(confirmadas + i).c_str(), v[i].c_str());
+  }
+}
+
+// El cursor también puede quedar a medias: se vuelve al principio de lo que
+// queda en LittleFS (algún duplicado, ninguna pérdida)
+static void test_truncate_cursor_at_every_offset()
+{
+  const uint32_t porSeg = JOURNAL_SEG_BYTES / FRAME;
+  const uint32_t n = 2 * porSeg + 10;
+  for (uint32_t i = 0; i < n; i++)
+    guardarTicketPendiente(codigo(i).c_str(), 1);
+  // Confirmado todo el primer segmento y parte del segundo
+  while (pendientesStats().acked < porSeg + 40)
+    TEST_ASSERT_TRUE(enviarBloque());
+  const uint32_t primera = porSeg; // primera del segmento 2, el más antiguo que queda
+  const uint32_t confirmadasAntes = pendientesStats().acked;
+  TEST_ASSERT_FALSE(g_hostFs.files.count(rutaSeg(1)));
+
+  const auto antes = foto();
+  for (size_t corte = 0; corte <= sizeof(JnlCursor); corte++)
+  {
+    restaurar(antes);
+    hostFsTruncate(JOURNAL_CURSOR_PATH, corte);
+    srv->requests.clear();
+    TEST_ASSERT_TRUE(reiniciar());
+    vaciar();
+
+    const std::vector<std::string> v = recibidos();
+    std::set<std::string> vistos(v.begin(), v.end());
+    TEST_ASSERT_EQUAL(v.size(), vistos.size()); // cada una una sola vez por reenvío
+    for (uint32_t i = confirmadasAntes; i < n; i++)
+      TEST_ASSERT_TRUE_MESSAGE(vistos.count(codigo(i)), "entrada perdida");
+    const uint32_t desde = corte == sizeof(JnlCursor) ? confirmadasAntes : primera;
+    TEST_ASSERT_EQUAL(n - desde, v.size());
+  }
+}
+
+// Backend caído: nada avanza, y al volver se envía todo una sola vez
+static void test_failed_post_keeps_entries()
+{
+  for (uint32_t i = 0; i < 5; i++)
+    guardarTicketPendiente(codigo(i).c_str(), 1);
+  HostHttpReply err;
+  err.status = 503;
+  srv->script.push_back(err);
+  TEST_ASSERT_FALSE(enviarBloque());
+  TEST_ASSERT_EQUAL_UINT32(1, pendientesStats().failedPosts);
+  TEST_ASSERT_EQUAL_UINT32(5, pendientesStats().pending);
+  TEST_ASSERT_TRUE(reiniciar());
+  srv->requests.clear();
+  vaciar();
+  TEST_ASSERT_EQUAL(5, recibidos().size());
+}
+
+// Encolar no espera al backend: taskNet sigue atendiendo validaciones y
+// portales mientras el bloque está en vuelo. Con atraso, el siguiente sale en
+// cuanto se confirma; vacío o tras un fallo, se espera JOURNAL_SYNC_MS
+static void test_batch_is_async_and_paced()
+{
+  for (uint32_t i = 0; i < JOURNAL_BATCH + 3; i++)
+    guardarTicketPendiente(codigo(i).c_str(), 1);
+  HostHttpReply lenta;
+  lenta.status = 200;
+  lenta.body = "OK";
+  lenta.contentType = "text/plain";
+  lenta.delayMs = 800;
+  srv->script.push_back(lenta);
+
+  TEST_ASSERT_TRUE(pendientesToca());
+  const uint64_t t0 = hostNowUs();
+  TEST_ASSERT_TRUE(reenviarTicketsPendientesComoBloque());
+  TEST_ASSERT_TRUE(hostNowUs() - t0 < 1000); // ni conecta: solo encola
+  TEST_ASSERT_TRUE(pendientesEnviando());
+  TEST_ASSERT_FALSE(pendientesToca());
+  TEST_ASSERT_FALSE(reenviarTicketsPendientesComoBloque()); // uno en vuelo como mucho
+
+  // Las vueltas de httpPoll() no bloquean aunque el backend tarde
+  uint32_t vueltas = 0;
+  while (pendientesEnviando() && vueltas < 5000)
+  {
+    const uint64_t v0 = hostNowUs();
+    httpPoll();
+    TEST_ASSERT_TRUE(hostNowUs() - v0 < 50000);
+    delay(1);
+    vueltas++;
+  }
+  TEST_ASSERT_TRUE(vueltas > 100); // ~800 ms de espera repartidos en vueltas
+  TEST_ASSERT_EQUAL_UINT32(JOURNAL_BATCH, pendientesStats().acked);
+  TEST_ASSERT_EQUAL_UINT32(3, pendientesStats().pending);
+
+  // Queda atraso: toca ya
+  TEST_ASSERT_TRUE(pendientesToca());
+  TEST_ASSERT_TRUE(enviarBloque());
+  TEST_ASSERT_FALSE(hayTicketsPendientes());
+
+  // Una validación nueva con el diario vacío espera a juntarse con otras
+  guardarTicketPendiente("NUEVA", 1);
+  TEST_ASSERT_FALSE(pendientesToca());
+  delay(JOURNAL_SYNC_MS);
+  TEST_ASSERT_TRUE(pendientesToca());
+
+  // Tras un fallo también se espera
+  HostHttpReply err;
+  err.status = 503;
+  srv->script.push_back(err);
+  TEST_ASSERT_FALSE(enviarBloque());
+  TEST_ASSERT_FALSE(pendientesToca());
+  TEST_ASSERT_EQUAL_UINT32(1, pendientesStats().pending);
+  delay(JOURNAL_SYNC_MS);
+  TEST_ASSERT_TRUE(pendientesToca());
+  TEST_ASSERT_TRUE(enviarBloque());
+  TEST_ASSERT_EQUAL_UINT32(0, pendientesStats().pending);
+}
+
+// La memoria dinámica al arrancar y al reenviar un bloque no crece con el
+// tamaño del diario (se lee trama a trama desde LittleFS)
+static void medirRam(uint32_t n, int64_t &picoBegin, int64_t &picoBloque)
+{
+  hostFsReset();
+  TEST_ASSERT_TRUE(reiniciar());
+  for (uint32_t i = 0; i < n; i++)
+    guardarTicketPendiente(codigo(i).c_str(), 1);
+
+  // Un bloque antes para dejar abierta la conexión keep-alive: se mide el
+  // régimen normal, no el alta de la conexión
+  TEST_ASSERT_TRUE(enviarBloque());
+  n -= JOURNAL_BATCH;
+
+  if (g_jnlFile)
+    g_jnlFile.close();
+  srv->requests.clear(); // lo que guarda el servidor de prueba no cuenta
+  srv->requests.reserve(4);
+  BenchHeap m = benchHeapMark();
+  TEST_ASSERT_TRUE(reiniciar());
+  picoBegin = benchHeapSince(m).peak;
+  TEST_ASSERT_EQUAL_UINT32(n, pendientesStats().pending);
+
+  m = benchHeapMark();
+  TEST_ASSERT_TRUE(enviarBloque());
+  picoBloque = benchHeapSince(m).peak;
+
+  char nombre[48];
+  snprintf(nombre, sizeof(nombre), "diario %u pendientes", (unsigned)n);
+  benchReport(nombre, "%u segmentos, pico %lld B al arrancar, %lld B por bloque",
+              (unsigned)pendientesStats().segments, (long long)picoBegin, (long long)picoBloque);
+}
+
+static void test_ram_is_flat_regardless_of_backlog()
+{
+  const uint32_t tam[] = {80, 400, 4000, (JOURNAL_MAX_SEGS - 1) * (JOURNAL_SEG_BYTES / FRAME)};
+  int64_t begin0 = 0, bloque0 = 0;
+  for (size_t k = 0; k < sizeof(tam) / sizeof(tam[0]); k++)
+  {
+    int64_t b, p;
+    medirRam(tam[k], b, p);
+    if (k == 0)
+    {
+      begin0 = b;
+      bloque0 = p;
+      continue;
+    }
+    // El bloque es siempre de JOURNAL_BATCH tramas: mismo pico salvo el
+    // reparto de los sockets simulados en trozos de 512 B. Al arrancar, el
+    // listado del directorio del LittleFS simulado guarda los nombres de los
+    // segmentos (el real no): menos de 64 B por segmento.
+    TEST_ASSERT_INT32_WITHIN(512, (int32_t)bloque0, (int32_t)p);
+    TEST_ASSERT_TRUE(b - begin0 <= (int64_t)pendientesStats().segments * 64);
+  }
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_frames_round_trip_in_batches);
+  RUN_TEST(test_truncate_active_segment_at_every_offset);
+  RUN_TEST(test_truncate_after_partial_ack_at_every_offset);
+  RUN_TEST(test_truncate_cursor_at_every_offset);
+  RUN_TEST(test_failed_post_keeps_entries);
+  RUN_TEST(test_batch_is_async_and_paced);
+  RUN_TEST(test_ram_is_flat_regardless_of_backlog);
+  return UNITY_END();
+}
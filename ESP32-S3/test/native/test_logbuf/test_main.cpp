@@ -0,0 +1,247 @@
+// Registro en RAM de logBuf.cpp: el texto que sale del formateo diferido es
+// el mismo que daría snprintf con los mismos argumentos, especificador a
+// especificador; lo que no cabe se corta y se marca con "..."; y con varias
+// tareas escribiendo a la vez mientras otra lee, ninguna línea entregada
+// sale mezclada con otra ni fuera de orden.
+#include <unity.h>
+
+#include "../../support/bench.hpp"
+
+#include "../../../src/logBuf.cpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+static uint32_t g_cursor = 0;
+
+void setUp()
+{
+  hostReset(1000000);
+  logbuf_begin();
+  g_cursor = g_next.load();
+}
+
+void tearDown() {}
+
+// Siguiente línea formateada (o "" si no hay)
+static std::string siguiente()
+{
+  char line[LOGBUF_LINE];
+  uint32_t ms = 0;
+  if (!logbuf_next(g_cursor, ms, line, sizeof(line)))
+    return "";
+  return line;
+}
+
+// Mismo formato y argumentos a snprintf y a logbuf_pushf
+#define IGUAL_QUE_SNPRINTF(fmt, ...)                                     \
+  do                                                                     \
+  {                                                                      \
+    char esperado[LOGBUF_LINE];                                          \
+    snprintf(esperado, sizeof(esperado), fmt, __VA_ARGS__);              \
+    logbuf_pushf(fmt, __VA_ARGS__);                                      \
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(esperado, siguiente().c_str(), fmt); \
+  } while (0)
+
+static void test_integers_match_snprintf()
+{
+  IGUAL_QUE_SNPRINTF("%d", -42);
+  IGUAL_QUE_SNPRINTF("%i|%+d|% d", 7, 7, 7);
+  IGUAL_QUE_SNPRINTF("%u", 4000000000u);
+  IGUAL_QUE_SNPRINTF("%x|%X|%#x|%08x", 0xBEEFu, 0xBEEFu, 0xBEEFu, 0xBEEFu);
+  IGUAL_QUE_SNPRINTF("%o", 0755u);
+  IGUAL_QUE_SNPRINTF("%5d|%-5d|%05d", 42, 42, 42);
+  IGUAL_QUE_SNPRINTF("%ld|%lu|%lx", -100000L, 3000000000UL, 0xABCDEFUL);
+  IGUAL_QUE_SNPRINTF("%lld|%llu", -9000000000000LL, 18000000000000000000ULL);
+  IGUAL_QUE_SNPRINTF("%hu|%hhu|%hd", (unsigned short)65535, (unsigned char)255, (short)-3);
+  IGUAL_QUE_SNPRINTF("%zu|%jd", (size_t)12345, (intmax_t)-77);
+  IGUAL_QUE_SNPRINTF("%*d|%-*d", 6, 1, 6, 2);
+  IGUAL_QUE_SNPRINTF("%.*d", 4, 9);
+}
+
+static void test_chars_strings_and_pointers_match_snprintf()
+{
+  IGUAL_QUE_SNPRINTF("%c%c%c", 'a', 'b', 'c');
+  IGUAL_QUE_SNPRINTF("[%s]", "hola");
+  IGUAL_QUE_SNPRINTF("[%10s|%-10s]", "der", "izq");
+  IGUAL_QUE_SNPRINTF("[%.3s]", "recortado");
+  IGUAL_QUE_SNPRINTF("[%*.*s]", 8, 2, "abcdef");
+  IGUAL_QUE_SNPRINTF("[%s][%s][%s]", "", "uno", "dos");
+  IGUAL_QUE_SNPRINTF("%p", (void *)&g_cursor);
+  IGUAL_QUE_SNPRINTF("100%% de %s", "acierto");
+
+  // "%.*s" de un trozo sin '\0' (p. ej. un cuerpo HTTP)
+  const char trozo[4] = {'O', 'K', '!', '?'};
+  IGUAL_QUE_SNPRINTF("cuerpo=%.*s", 3, trozo);
+
+  // La cadena se copia al registrar: cambiarla después no afecta
+  char tmp[16] = "antes";
+  logbuf_pushf("v=%s", tmp);
+  strcpy(tmp, "despues");
+  TEST_ASSERT_EQUAL_STRING("v=antes", siguiente().c_str());
+
+  logbuf_pushf("%s", (const char *)nullptr);
+  TEST_ASSERT_EQUAL_STRING("(null)", siguiente().c_str());
+}
+
+static void test_floats_match_snprintf()
+{
+  IGUAL_QUE_SNPRINTF("%f", 3.14159);
+  IGUAL_QUE_SNPRINTF("%.2f|%8.3f|%-8.1f|", 2.5, -1.0 / 3, 10.25);
+  IGUAL_QUE_SNPRINTF("%e|%E", 123456.789, 0.000123);
+  IGUAL_QUE_SNPRINTF("%g|%G", 0.0001, 1e20);
+  IGUAL_QUE_SNPRINTF("%.*f", 3, 2.0 / 3);
+  IGUAL_QUE_SNPRINTF("%f", (double)1.5f); // float promocionado
+}
+
+// Mezclas reales del firmware: el orden de los argumentos de 32 y 64 bits
+// se conserva
+static void test_mixed_formats_match_snprintf()
+{
+  IGUAL_QUE_SNPRINTF("[HTTP][%s] POST %s%s (async)", "ETH", "/validateQR", " (keep-alive)");
+  IGUAL_QUE_SNPRINTF("[RS485] Parámetro %u=%u: %s", 12u, 99u, "no_ack");
+  IGUAL_QUE_SNPRINTF("[OTA] %lld/%lld B %.1f%% %s", 123456LL, 1000000LL, 12.3, "ok");
+  IGUAL_QUE_SNPRINTF("%d %lld %d %f %d", 1, 2LL, 3, 4.0, 5);
+  IGUAL_QUE_SNPRINTF("[API][%s][IN] Payload: %.*s%s", "QR", 5, "{\"a\":1}", "...(truncado)");
+}
+
+// Lo que no cabe se corta y se marca; nunca se escribe fuera del registro
+static void test_overflow_is_truncated_and_marked()
+{
+  // %s más largos que LOGBUF_STR: se guarda el principio
+  std::string largo(3 * LOGBUF_STR, 'x');
+  logbuf_pushf("a=%s", largo.c_str());
+  std::string l = siguiente();
+  TEST_ASSERT_EQUAL_STRING(("a=" + std::string(LOGBUF_STR - 1, 'x') + "...").c_str(), l.c_str());
+
+  // Varias cadenas comparten el espacio: la segunda se corta
+  std::string mitad(LOGBUF_STR / 2, 'y');
+  logbuf_pushf("%s|%s|%d", mitad.c_str(), mitad.c_str(), 7);
+  l = siguiente();
+  TEST_ASSERT_EQUAL_STRING(mitad.c_str(), l.substr(0, mitad.size()).c_str());
+  TEST_ASSERT_TRUE(l.size() >= 3 && l.compare(l.size() - 3, 3, "...") == 0);
+
+  // Más argumentos que LOGBUF_ARGS palabras: lo que cabe y "..."
+  logbuf_pushf("%d %d %d %d %d %d %d %d %d %d", 0, 1, 2, 3, 4, 5, 6, 7, 8, 9);
+  l = siguiente();
+  TEST_ASSERT_EQUAL_STRING("0 1 2 3 4 5 6 7 ...", l.c_str());
+
+  // Una línea más larga que el búfer de lectura se corta sin desbordar
+  char corto[16];
+  uint32_t ms;
+  logbuf_pushf("%s-%s", "0123456789", "abcdefghij");
+  TEST_ASSERT_TRUE(logbuf_next(g_cursor, ms, corto, sizeof(corto)));
+  TEST_ASSERT_EQUAL_STRING("0123456789-abcd", corto);
+}
+
+// Los mensajes habituales del firmware (rutas, ids, respuestas) caben enteros
+static void test_typical_strings_fit()
+{
+  const char *url = "http://192.168.100.200:8084/api/entries/pending?device=ME001&v=2";
+  const char *err = "connect 192.168.100.200:8084 FAILED (timeout tras 4000 ms)";
+  IGUAL_QUE_SNPRINTF("[HTTP] %s -> %s", url, err);
+}
+
+// Varias tareas escriben a la vez mientras otra lee: cada línea entregada es
+// exactamente una de las escritas (sin mezclar argumentos ni cadenas de dos
+// registros) y las de cada productor llegan en orden
+static void test_multi_producer_with_concurrent_reader()
+{
+  const int PRODUCTORES = 4;
+  const uint32_t POR_PRODUCTOR = 20000;
+  std::atomic<int> activos{PRODUCTORES};
+  std::atomic<bool> salida{false};
+
+  std::vector<std::thread> hilos;
+  for (int p = 0; p < PRODUCTORES; p++)
+    hilos.emplace_back([p, &activos, &salida]()
+                       {
+      while (!salida.load())
+        std::this_thread::yield();
+      char tag[24];
+      for (uint32_t n = 0; n < POR_PRODUCTOR; n++)
+      {
+        // La cadena depende de p y n: una mezcla de registros se detecta
+        snprintf(tag, sizeof(tag), "P%d-%07u", p, (unsigned)n);
+        logbuf_pushf("p=%d n=%u tag=%s chk=%lld", p, (unsigned)n, tag, (long long)p * 1000000007LL + n);
+      }
+      activos--; });
+
+  uint32_t leidas = 0, malas = 0, desordenadas = 0;
+  int64_t ultimo[PRODUCTORES];
+  for (int p = 0; p < PRODUCTORES; p++)
+    ultimo[p] = -1;
+
+  auto comprobar = [&](const char *line)
+  {
+    int p = -1;
+    unsigned n = 0;
+    char tag[24] = {};
+    long long chk = 0;
+    if (sscanf(line, "p=%d n=%u tag=%23s chk=%lld", &p, &n, tag, &chk) != 4 || p < 0 || p >= PRODUCTORES)
+    {
+      malas++;
+      return;
+    }
+    char esperado[24];
+    snprintf(esperado, sizeof(esperado), "P%d-%07u", p, n);
+    if (strcmp(tag, esperado) != 0 || chk != (long long)p * 1000000007LL + n)
+    {
+      malas++;
+      return;
+    }
+    if ((int64_t)n <= ultimo[p])
+      desordenadas++;
+    ultimo[p] = n;
+    leidas++;
+  };
+
+  salida = true;
+  char line[LOGBUF_LINE];
+  uint32_t ms;
+  while (activos.load() > 0)
+  {
+    while (logbuf_next(g_cursor, ms, line, sizeof(line)))
+      comprobar(line);
+  }
+  for (auto &h : hilos)
+    h.join();
+  while (logbuf_next(g_cursor, ms, line, sizeof(line)))
+    comprobar(line);
+
+  TEST_ASSERT_EQUAL_UINT32(0, malas);
+  TEST_ASSERT_EQUAL_UINT32(0, desordenadas);
+  TEST_ASSERT_TRUE(leidas >= LOGBUF_CAP); // al menos lo que queda en el anillo
+  TEST_ASSERT_EQUAL_UINT32(g_next.load(), g_cursor); // todo leído o saltado
+  benchReport("logbuf 4 productores + lector", "%u de %u líneas leídas (el resto se pisó antes)",
+              (unsigned)leidas, (unsigned)(PRODUCTORES * POR_PRODUCTOR));
+}
+
+// Coste de registrar frente a formatear en el acto (solo se informa)
+static void test_push_cost()
+{
+  const uint32_t iters = 200000;
+  char buf[LOGBUF_LINE];
+  const double nsPush = benchNsPerIter(iters, [&]()
+                                       { logbuf_pushf("[RS485] Parámetro %u=%u: %s (%.1f ms)", 12u, 99u, "ok", 3.5); });
+  const double nsFmt = benchNsPerIter(iters, [&]()
+                                      { snprintf(buf, sizeof(buf), "[RS485] Parámetro %u=%u: %s (%.1f ms)", 12u, 99u, "ok", 3.5); });
+  benchReport("logbuf_pushf vs snprintf", "%.0f ns vs %.0f ns por línea", nsPush, nsFmt);
+  TEST_ASSERT_TRUE(nsPush > 0);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_integers_match_snprintf);
+  RUN_TEST(test_chars_strings_and_pointers_match_snprintf);
+  RUN_TEST(test_floats_match_snprintf);
+  RUN_TEST(test_mixed_formats_match_snprintf);
+  RUN_TEST(test_overflow_is_truncated_and_marked);
+  RUN_TEST(test_typical_strings_fit);
+  RUN_TEST(test_multi_producer_with_concurrent_reader);
+  RUN_TEST(test_push_cost);
+  return UNITY_END();
+}
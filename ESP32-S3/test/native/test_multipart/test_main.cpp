@@ -0,0 +1,357 @@
+// Parser incremental de multipart/form-data (multipart.cpp): cada cuerpo de
+// prueba se trocea en todos los puntos posibles, byte a byte y al azar, con
+// el marcador partido a caballo del borde de la ventana de búsqueda, y el
+// resultado tiene que ser idéntico al de una sola lectura. El cierre
+// "--<boundary>--" termina el cuerpo y lo que sigue se ignora. Al final,
+// rendimiento en bytes/s.
+#include <unity.h>
+
+#include "../../support/bench.hpp"
+#include "../../../src/multipart.cpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+static const std::string B = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+
+struct Parte
+{
+  std::string headers; // tal y como llegan a onPart (con el "\r\n\r\n" final)
+  std::string data;
+};
+
+struct Recogida
+{
+  std::vector<Parte> partes;
+  int rechazar = -1;    // índice de la parte que onPart descarta
+  size_t abortar = 0;   // onData devuelve false al pasar de estos bytes (0 = nunca)
+  size_t entregados = 0;
+  size_t maxTrozo = 0;
+};
+
+static bool onPart(void *ctx, const char *headers)
+{
+  Recogida *r = static_cast<Recogida *>(ctx);
+  r->partes.push_back({headers, ""});
+  return (int)r->partes.size() - 1 != r->rechazar;
+}
+
+static bool onData(void *ctx, const uint8_t *d, size_t n)
+{
+  Recogida *r = static_cast<Recogida *>(ctx);
+  TEST_ASSERT_FALSE(r->partes.empty());
+  r->partes.back().data.append((const char *)d, n);
+  r->entregados += n;
+  if (n > r->maxTrozo)
+    r->maxTrozo = n;
+  return !r->abortar || r->entregados <= r->abortar;
+}
+
+static std::string cabeceras(const std::string &nombre, const char *tipo = "application/octet-stream")
+{
+  return "Content-Disposition: form-data; name=\"" + nombre + "\"; filename=\"" + nombre +
+         ".bin\"\r\nContent-Type: " + tipo + "\r\n\r\n";
+}
+
+// Cuerpo completo: preámbulo, partes y cierre, y después el epílogo
+static std::string cuerpo(const std::vector<Parte> &partes, const std::string &boundary = B,
+                          const std::string &preambulo = "", const std::string &epilogo = "")
+{
+  std::string s = preambulo;
+  if (!preambulo.empty())
+    s += "\r\n";
+  for (auto &p : partes)
+    s += "--" + boundary + "\r\n" + p.headers + p.data + "\r\n";
+  s += "--" + boundary + "--\r\n" + epilogo;
+  return s;
+}
+
+// Contenido con todo lo que se parece al marcador sin serlo
+static std::string casiMarcadores(size_t n, uint32_t semilla)
+{
+  const std::string trampas[] = {"\r\n--", "\r\n-", "\r\n--" + B.substr(0, B.size() - 1) + "X",
+                                 "--" + B, "\r\n" + B, "\r", "\n", std::string(1, '\0')};
+  std::mt19937 rng(semilla);
+  std::string s;
+  while (s.size() < n)
+  {
+    if (rng() % 4 == 0)
+      s += trampas[rng() % (sizeof(trampas) / sizeof(trampas[0]))];
+    else
+      s += (char)(rng() & 0xFF);
+  }
+  s.resize(n);
+  // Dos trampas seguidas pueden formar el marcador de verdad: se rompe
+  const std::string marcador = "\r\n--" + B;
+  for (size_t pos; (pos = s.find(marcador)) != std::string::npos;)
+    s[pos + marcador.size() - 1] ^= 1;
+  return s;
+}
+
+struct Resultado
+{
+  Recogida r;
+  bool done = false;
+  bool failed = false;
+  size_t consumidos = 0;
+  size_t dataBytes = 0;
+};
+
+// Alimenta 'body' cortado en 'cortes' (posiciones crecientes)
+static Resultado parsear(const std::string &body, const std::vector<size_t> &cortes,
+                         const std::string &boundary = B, int rechazar = -1, size_t abortar = 0)
+{
+  static MultipartParser p; // la ventana es grande para la pila de las pruebas
+  Resultado res;
+  res.r.rechazar = rechazar;
+  res.r.abortar = abortar;
+  TEST_ASSERT_TRUE(multipartInit(p, boundary.data(), boundary.size(), onPart, onData, &res.r));
+
+  size_t desde = 0;
+  std::vector<size_t> c = cortes;
+  c.push_back(body.size());
+  for (size_t hasta : c)
+  {
+    if (hasta <= desde)
+      continue;
+    const size_t n = multipartFeed(p, (const uint8_t *)body.data() + desde, hasta - desde);
+    res.consumidos += n;
+    if (n < hasta - desde)
+      break;
+    desde = hasta;
+  }
+  res.done = multipartDone(p);
+  res.failed = multipartFailed(p);
+  res.dataBytes = p.dataBytes;
+  return res;
+}
+
+static void comprobarIgual(const std::vector<Parte> &esperado, const Resultado &res, const char *msg)
+{
+  TEST_ASSERT_TRUE_MESSAGE(res.done, msg);
+  TEST_ASSERT_FALSE_MESSAGE(res.failed, msg);
+  TEST_ASSERT_EQUAL_MESSAGE(esperado.size(), res.r.partes.size(), msg);
+  for (size_t i = 0; i < esperado.size(); i++)
+  {
+    TEST_ASSERT_TRUE_MESSAGE(esperado[i].headers == res.r.partes[i].headers, msg);
+    TEST_ASSERT_EQUAL_MESSAGE(esperado[i].data.size(), res.r.partes[i].data.size(), msg);
+    TEST_ASSERT_TRUE_MESSAGE(esperado[i].data == res.r.partes[i].data, msg);
+  }
+}
+
+// Un formulario típico de la subida de firmware, de una vez
+static void test_whole_body()
+{
+  const std::vector<Parte> partes = {
+      {"Content-Disposition: form-data; name=\"md5\"\r\n\r\n", "0cc175b9c0f1b6a831c399e269772661"},
+      {cabeceras("firmware"), casiMarcadores(5000, 1)},
+      {"Content-Disposition: form-data; name=\"vacio\"\r\n\r\n", ""}};
+  const std::string body = cuerpo(partes, B, "preámbulo que se ignora", "epílogo\r\n--" + B + "\r\n");
+  const Resultado res = parsear(body, {});
+  comprobarIgual(partes, res, "de una vez");
+  TEST_ASSERT_EQUAL(body.size(), res.consumidos);
+  TEST_ASSERT_EQUAL(5000 + 32, res.dataBytes);
+  // Trozos grandes: como mucho la ventana menos lo retenido por si el
+  // marcador queda partido
+  TEST_ASSERT_TRUE(res.r.maxTrozo > MULTIPART_WINDOW / 2);
+  TEST_ASSERT_TRUE(res.r.maxTrozo <= MULTIPART_WINDOW);
+}
+
+// Un corte en cada posición: el resultado no depende de cómo llegue
+static void test_split_at_every_offset()
+{
+  const std::vector<Parte> partes = {
+      {cabeceras("a"), casiMarcadores(700, 2)},
+      {cabeceras("b", "text/plain"), "\r\n--" + B.substr(0, 10)},
+      {cabeceras("c"), casiMarcadores(1500, 3)}};
+  const std::string body = cuerpo(partes, B, "pre", "post");
+  for (size_t k = 0; k <= body.size(); k++)
+  {
+    char msg[32];
+    snprintf(msg, sizeof(msg), "corte en %u", (unsigned)k);
+    comprobarIgual(partes, parsear(body, {k}), msg);
+  }
+}
+
+// Byte a byte, dos cortes por todo el marcador y trozos al azar
+static void test_byte_by_byte_and_random_chunks()
+{
+  const std::vector<Parte> partes = {
+      {cabeceras("x"), casiMarcadores(3000, 4)},
+      {cabeceras("y"), casiMarcadores(10, 5)}};
+  const std::string body = cuerpo(partes);
+
+  std::vector<size_t> uno;
+  for (size_t k = 1; k < body.size(); k++)
+    uno.push_back(k);
+  comprobarIgual(partes, parsear(body, uno), "byte a byte");
+
+  // Dos cortes dentro del primer marcador de contenido y sus alrededores
+  const size_t m = body.find("\r\n--" + B);
+  for (size_t a = m - 3; a < m + B.size() + 6; a++)
+    for (size_t b = a; b < m + B.size() + 6; b++)
+      comprobarIgual(partes, parsear(body, {a, b}), "dos cortes");
+
+  std::mt19937 rng(7);
+  for (int it = 0; it < 300; it++)
+  {
+    std::vector<size_t> c;
+    for (size_t pos = 0; pos < body.size();)
+    {
+      pos += 1 + rng() % (rng() % 2 ? 17 : 2 * MULTIPART_WINDOW);
+      c.push_back(pos);
+    }
+    comprobarIgual(partes, parsear(body, c), "al azar");
+  }
+}
+
+// El marcador cae a caballo del final de la ventana: se prueban todos los
+// desplazamientos alrededor de uno y varios llenados completos, con varios
+// tamaños de lectura
+static void test_marker_across_window_edges()
+{
+  const std::string marcador = "\r\n--" + B;
+  const size_t h = cabeceras("fw").size();
+  // Dentro de la ventana, el contenido empieza tras las cabeceras (la
+  // ventana se vacía al encontrar el marcador anterior)
+  for (size_t llenados = 1; llenados <= 3; llenados++)
+  {
+    const size_t borde = llenados * (MULTIPART_WINDOW - (marcador.size() - 1)) + (marcador.size() - 1);
+    for (size_t len = borde - marcador.size() - 2; len <= borde + 2; len++)
+    {
+      const std::vector<Parte> partes = {{cabeceras("fw"), casiMarcadores(len, (uint32_t)len)}};
+      const std::string body = cuerpo(partes);
+      const size_t ini = body.find(partes[0].data);
+      TEST_ASSERT_TRUE(ini == 2 + B.size() + 2 + h);
+      for (size_t trozo : {(size_t)1, (size_t)7, marcador.size() - 1, marcador.size(), (size_t)512,
+                           (size_t)MULTIPART_WINDOW, (size_t)MULTIPART_WINDOW + 1, body.size()})
+      {
+        std::vector<size_t> c;
+        for (size_t pos = trozo; pos < body.size(); pos += trozo)
+          c.push_back(pos);
+        char msg[48];
+        snprintf(msg, sizeof(msg), "contenido %u, lecturas de %u", (unsigned)len, (unsigned)trozo);
+        comprobarIgual(partes, parsear(body, c), msg);
+      }
+    }
+  }
+}
+
+// "--<boundary>--" termina el cuerpo: el epílogo se consume sin mirarlo,
+// aunque traiga otro boundary; sin cierre no hay fin
+static void test_closing_boundary()
+{
+  const std::vector<Parte> partes = {{cabeceras("a"), "hola"}};
+  const std::string epilogo = "--" + B + "\r\n" + cabeceras("falsa") + "no\r\n--" + B + "--\r\n";
+  const std::string body = cuerpo(partes, B, "", epilogo);
+  for (size_t k = 0; k <= body.size(); k++)
+  {
+    const Resultado res = parsear(body, {k});
+    comprobarIgual(partes, res, "epílogo");
+    TEST_ASSERT_EQUAL(body.size(), res.consumidos);
+  }
+
+  // Cierre sin CRLF final
+  std::string sinCrlf = cuerpo(partes);
+  sinCrlf.resize(sinCrlf.size() - 2);
+  comprobarIgual(partes, parsear(sinCrlf, {}), "sin CRLF final");
+
+  // Sin cierre (conexión cortada): la parte sigue abierta
+  std::string cortado = cuerpo(partes);
+  cortado.resize(cortado.find("--" + B + "--") - 2);
+  Resultado res = parsear(cortado, {});
+  TEST_ASSERT_FALSE(res.done);
+  TEST_ASSERT_FALSE(res.failed);
+
+  // Un solo '-' tras el boundary no es el cierre: empieza otra parte
+  const std::string unGuion = "--" + B + "\r\n" + cabeceras("a") + "hola\r\n--" + B + "-\r\n" +
+                              cabeceras("b") + "adiós\r\n--" + B + "--";
+  res = parsear(unGuion, {});
+  TEST_ASSERT_TRUE(res.done);
+  TEST_ASSERT_EQUAL(2, res.r.partes.size());
+  TEST_ASSERT_TRUE(res.r.partes[1].data == "adiós");
+
+  // Relleno (espacios) en la línea del boundary
+  const std::string relleno = "--" + B + "  \r\n" + cabeceras("a") + "x\r\n--" + B + "--";
+  res = parsear(relleno, {});
+  TEST_ASSERT_TRUE(res.done);
+  TEST_ASSERT_TRUE(res.r.partes[0].data == "x");
+
+  // Cuerpo vacío: solo el cierre
+  res = parsear("--" + B + "--\r\n", {});
+  TEST_ASSERT_TRUE(res.done);
+  TEST_ASSERT_EQUAL(0, res.r.partes.size());
+}
+
+// Parte rechazada en onPart: su contenido no llega pero se salta entero;
+// onData que corta: error y el resto no se consume
+static void test_rejected_part_and_abort()
+{
+  const std::vector<Parte> partes = {
+      {cabeceras("no"), casiMarcadores(3000, 8)},
+      {cabeceras("si"), "bien"}};
+  const std::string body = cuerpo(partes);
+  Resultado res = parsear(body, {100, 1500}, B, 0);
+  TEST_ASSERT_TRUE(res.done);
+  TEST_ASSERT_EQUAL(2, res.r.partes.size());
+  TEST_ASSERT_TRUE(res.r.partes[0].data.empty());
+  TEST_ASSERT_TRUE(res.r.partes[1].data == "bien");
+  TEST_ASSERT_EQUAL(3004, res.dataBytes); // cuenta lo saltado
+
+  res = parsear(body, {}, B, -1, 1000);
+  TEST_ASSERT_TRUE(res.failed);
+  TEST_ASSERT_TRUE(res.consumidos < body.size());
+}
+
+// Límites: boundary de 70 caracteres, demasiado largo, cabeceras que no caben
+static void test_limits()
+{
+  const std::string largo(70, 'b');
+  const std::vector<Parte> partes = {{cabeceras("a"), casiMarcadores(2000, 9)}};
+  comprobarIgual(partes, parsear(cuerpo(partes, largo), {}, largo), "boundary de 70");
+
+  static MultipartParser p;
+  const std::string demasiado(MULTIPART_BOUNDARY_MAX + 1, 'b');
+  TEST_ASSERT_FALSE(multipartInit(p, demasiado.data(), demasiado.size(), onPart, onData, nullptr));
+  TEST_ASSERT_FALSE(multipartInit(p, "", 0, onPart, onData, nullptr));
+
+  const std::vector<Parte> enorme = {{"X-Relleno: " + std::string(MULTIPART_HDR_MAX, 'h') + "\r\n\r\n", "x"}};
+  const Resultado res = parsear(cuerpo(enorme), {});
+  TEST_ASSERT_TRUE(res.failed);
+  TEST_ASSERT_EQUAL(0, res.r.partes.size());
+}
+
+// Rendimiento: un firmware de 1 MB en lecturas de 1460 B (segmento TCP)
+static void test_throughput()
+{
+  const std::vector<Parte> partes = {{cabeceras("firmware"), casiMarcadores(1 << 20, 10)}};
+  const std::string body = cuerpo(partes);
+  std::vector<size_t> c;
+  for (size_t pos = 1460; pos < body.size(); pos += 1460)
+    c.push_back(pos);
+
+  Resultado res;
+  const double ns = benchNsPerIter(5, [&]()
+                                   { res = parsear(body, c); });
+  comprobarIgual(partes, res, "1 MB");
+  benchReport("multipart 1 MB / 1460 B", "%.1f MB/s, trozo máx. %u B", body.size() / (ns / 1e3),
+              (unsigned)res.r.maxTrozo);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_whole_body);
+  RUN_TEST(test_split_at_every_offset);
+  RUN_TEST(test_byte_by_byte_and_random_chunks);
+  RUN_TEST(test_marker_across_window_edges);
+  RUN_TEST(test_closing_boundary);
+  RUN_TEST(test_rejected_part_and_abort);
+  RUN_TEST(test_limits);
+  RUN_TEST(test_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,370 @@
+// Ida y vuelta de las imágenes OTA: scripts/ota_pack.py empaqueta (LZ o
+// diferencial) y ota_delta.cpp reconstruye la imagen, que debe dar el mismo
+// SHA-256 que el original. Incluye cortes de la descarga en cualquier punto
+// reanudando desde inBytes, como hace actualiza() con Range.
+//
+// Necesita python3 en el PATH (si no lo hay, las pruebas se ignoran).
+#include <unity.h>
+
+#include "../../../src/ota_delta.cpp"
+
+#include "../../support/sha256_host.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static std::string g_dir;    // temporal con las imágenes
+static std::string g_script; // scripts/ota_pack.py
+static bool g_python = false;
+
+static std::string g_base, g_target; // imagen en ejecución y nueva
+
+// ---- Imágenes de prueba ----
+
+static uint32_t g_rnd;
+static uint32_t rnd()
+{
+  g_rnd = g_rnd * 1103515245u + 12345u;
+  return g_rnd >> 8;
+}
+
+// Algo parecido a un firmware: cabecera 0xE9, "código" con mucha repetición,
+// cadenas y una parte sin estructura (datos comprimidos, certificados...)
+static std::string firmware(uint32_t semilla, size_t size)
+{
+  g_rnd = semilla;
+  std::string s;
+  s += (char)OTA_IMAGE_MAGIC;
+  static const uint8_t ops[][4] = {{0x36, 0x41, 0x00, 0x0c}, {0x1d, 0xf0, 0x00, 0x00}, {0x22, 0xa0, 0x01, 0x91},
+                                   {0xe5, 0x12, 0x00, 0x81}, {0x0c, 0x02, 0x1d, 0xf0}, {0x88, 0x33, 0x82, 0x28}};
+  while (s.size() < size * 6 / 10)
+  {
+    const uint8_t *op = ops[rnd() % 6];
+    s.append((const char *)op, 3);
+    s += (char)(rnd() % 8); // registro/desplazamiento
+  }
+  static const char *txt[] = {"[RS485] begin() OK", "[OTA] Descarga completa", "[IO] Timeout 8s. Pasaron %d de %d.",
+                              "https://tpv.museoelder.es/pos/ticket/validate", "Content-Length: %u\r\n"};
+  while (s.size() < size * 8 / 10)
+    s += txt[rnd() % 5], s += '\0';
+  while (s.size() < size)
+    s += (char)rnd();
+  return s;
+}
+
+// Versión siguiente: constantes cambiadas, una función nueva en medio (todo
+// lo demás se desplaza), un bloque quitado, otro movido y una cola nueva
+static std::string nuevaVersion(const std::string &base)
+{
+  std::string t = base;
+  g_rnd = 777;
+  for (size_t p = 1000; p < t.size(); p += 3000 + rnd() % 2000)
+    t[p] = (char)(t[p] ^ 0x5A);
+  std::string nueva(3000, '\0');
+  for (char &c : nueva)
+    c = (char)rnd();
+  t.insert(t.size() / 3, nueva);
+  t.erase(t.size() / 2, 1500);
+  const std::string movido = t.substr(t.size() * 3 / 4, 2048);
+  t.erase(t.size() * 3 / 4, 2048);
+  t.insert(t.size() / 5, movido);
+  t += "VERSION_FIRMWARE 3.1";
+  return t;
+}
+
+static void guardar(const std::string &path, const std::string &data)
+{
+  FILE *f = fopen(path.c_str(), "wb");
+  TEST_ASSERT_NOT_NULL(f);
+  fwrite(data.data(), 1, data.size(), f);
+  fclose(f);
+}
+
+static std::string cargar(const std::string &path)
+{
+  std::string s;
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f)
+    return s;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    s.append(buf, n);
+  fclose(f);
+  return s;
+}
+
+// ota_pack.py nuevo.bin salida.meot [--base base.bin]
+static std::string empaquetar(const std::string &nombre, const std::string &target, const std::string *base)
+{
+  const std::string in = g_dir + "/" + nombre + ".bin";
+  const std::string out = g_dir + "/" + nombre + ".meot";
+  guardar(in, target);
+  std::string cmd = "python3 \"" + g_script + "\" \"" + in + "\" \"" + out + "\"";
+  if (base)
+  {
+    guardar(g_dir + "/base.bin", *base);
+    cmd += " --base \"" + g_dir + "/base.bin\"";
+  }
+  cmd += " > \"" + g_dir + "/pack.log\" 2>&1";
+  TEST_ASSERT_EQUAL_MESSAGE(0, system(cmd.c_str()), cargar(g_dir + "/pack.log").c_str());
+  return cargar(out);
+}
+
+// ---- Destino de la imagen (lo que en el equipo es fw_update) ----
+
+struct Destino
+{
+  const std::string *base = nullptr;
+  std::string out;
+  HostSha256 sha;
+  bool cabecera = false;
+  bool baseOk = true;
+};
+
+static bool enCabecera(void *ctx, const OtaImageInfo &info)
+{
+  Destino &d = *(Destino *)ctx;
+  d.cabecera = true;
+  if (info.kind == OTA_DELTA)
+  {
+    // Como otaImagenCabecera(): la base debe ser exactamente la imagen en ejecución
+    HostSha256 s;
+    s.update((const uint8_t *)d.base->data(), info.baseSize <= d.base->size() ? info.baseSize : 0);
+    uint8_t h[32];
+    s.finish(h);
+    d.baseOk = info.baseSize == d.base->size() && memcmp(h, info.baseSha, 32) == 0;
+  }
+  return d.baseOk;
+}
+
+static bool enDatos(void *ctx, const uint8_t *data, size_t len)
+{
+  Destino &d = *(Destino *)ctx;
+  d.out.append((const char *)data, len);
+  d.sha.update(data, len);
+  return true;
+}
+
+static bool enBase(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+  Destino &d = *(Destino *)ctx;
+  if (!d.base || offset + len > d.base->size())
+    return false;
+  memcpy(buf, d.base->data() + offset, len);
+  return true;
+}
+
+// Entrega 'len' bytes como los da la red: el decodificador puede quedarse
+// con menos por vuelta (OTA_DEC_STEP) y seguir sin entrada (otaDecBusy)
+static void alimentar(OtaDecoder &d, const uint8_t *data, size_t len)
+{
+  while (!otaDecFailed(d) && !otaDecDone(d) && (len > 0 || otaDecBusy(d)))
+  {
+    const size_t used = otaDecFeed(d, data, len);
+    data += used;
+    len -= used;
+  }
+}
+
+// Descarga completa en trozos de tamaño variable
+static void decodificar(OtaDecoder &d, Destino &dst, const std::string &blob, uint32_t semilla = 1)
+{
+  otaDecInit(d, enCabecera, enDatos, enBase, &dst);
+  g_rnd = semilla;
+  size_t pos = 0;
+  while (pos < blob.size() && !otaDecFailed(d))
+  {
+    size_t n = 1 + rnd() % 1460;
+    if (n > blob.size() - pos)
+      n = blob.size() - pos;
+    alimentar(d, (const uint8_t *)blob.data() + pos, n);
+    pos += n;
+  }
+}
+
+static std::string shaDe(HostSha256 &s)
+{
+  uint8_t h[32];
+  s.finish(h);
+  return hostHex(h, sizeof(h));
+}
+
+static void comprobarImagen(const OtaDecoder &d, Destino &dst, const std::string &target)
+{
+  TEST_ASSERT_TRUE_MESSAGE(otaDecDone(d), d.error);
+  TEST_ASSERT_EQUAL_UINT32(target.size(), d.outBytes);
+  TEST_ASSERT_EQUAL(target.size(), dst.out.size());
+  const std::string esperado = hostSha256Hex(target);
+  TEST_ASSERT_EQUAL_STRING(esperado.c_str(), hostHex(d.info.targetSha, 32).c_str()); // lo que puso ota_pack.py
+  TEST_ASSERT_EQUAL_STRING(esperado.c_str(), shaDe(dst.sha).c_str());                 // lo reconstruido
+  TEST_ASSERT_TRUE(dst.out == target);
+}
+
+static OtaDecoder g_dec; // ~4 KB de ventana: fuera de la pila
+
+void setUp()
+{
+  if (!g_python)
+    TEST_IGNORE_MESSAGE("python3 no disponible: no se puede ejecutar ota_pack.py");
+}
+
+void tearDown() {}
+
+static void test_sha256_helper()
+{
+  TEST_ASSERT_EQUAL_STRING("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", hostSha256Hex("").c_str());
+  TEST_ASSERT_EQUAL_STRING("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hostSha256Hex("abc").c_str());
+  TEST_ASSERT_EQUAL_STRING("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+                           hostSha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq").c_str());
+}
+
+// Imagen comprimida: solo literales y copias dentro de la ventana
+static void test_lz_roundtrip()
+{
+  const std::string blob = empaquetar("lz", g_target, nullptr);
+  TEST_ASSERT_TRUE(blob.size() < g_target.size());
+  Destino dst;
+  decodificar(g_dec, dst, blob);
+  TEST_ASSERT_EQUAL_UINT8(OTA_LZ, g_dec.info.kind);
+  comprobarImagen(g_dec, dst, g_target);
+  TEST_ASSERT_EQUAL_UINT32(0, g_dec.baseBytes);
+  TEST_ASSERT_EQUAL_UINT32(blob.size(), g_dec.inBytes);
+}
+
+// Diferencial: casi todo sale de la imagen en ejecución
+static void test_delta_roundtrip()
+{
+  const std::string blob = empaquetar("delta", g_target, &g_base);
+  TEST_ASSERT_TRUE(blob.size() < g_target.size() / 4);
+  Destino dst;
+  dst.base = &g_base;
+  decodificar(g_dec, dst, blob, 7);
+  TEST_ASSERT_EQUAL_UINT8(OTA_DELTA, g_dec.info.kind);
+  comprobarImagen(g_dec, dst, g_target);
+  TEST_ASSERT_TRUE(g_dec.baseBytes > g_target.size() * 8 / 10);
+}
+
+// La conexión se corta tras recibir 'corte' bytes: lo que el decodificador no
+// llegó a consumir se pierde y la descarga sigue desde inBytes (Range)
+static void test_resume_at_offset()
+{
+  const std::string blob = empaquetar("delta", g_target, &g_base);
+  std::vector<size_t> cortes = {1, 40, OTA_HDR_LEN - 1, OTA_HDR_LEN, OTA_HDR_LEN + 1, OTA_HDR_LEN + 2};
+  for (size_t c = 97; c < blob.size(); c += 97 + c / 3)
+    cortes.push_back(c);
+  cortes.push_back(blob.size() - 1);
+
+  for (size_t corte : cortes)
+  {
+    Destino dst;
+    dst.base = &g_base;
+    otaDecInit(g_dec, enCabecera, enDatos, enBase, &dst);
+
+    // Primera conexión: un único trozo y se cae (sin volver a llamar)
+    otaDecFeed(g_dec, (const uint8_t *)blob.data(), corte);
+    const uint32_t desde = g_dec.inBytes;
+    TEST_ASSERT_TRUE(desde <= corte);
+
+    // Segunda conexión: desde el byte que pidió el decodificador
+    alimentar(g_dec, (const uint8_t *)blob.data() + desde, blob.size() - desde);
+    char msg[48];
+    snprintf(msg, sizeof(msg), "corte en %u (reanuda en %u)", (unsigned)corte, (unsigned)desde);
+    TEST_ASSERT_TRUE_MESSAGE(otaDecDone(g_dec), msg);
+    comprobarImagen(g_dec, dst, g_target);
+  }
+
+  // Varios cortes seguidos en la misma descarga
+  Destino dst;
+  dst.base = &g_base;
+  otaDecInit(g_dec, enCabecera, enDatos, enBase, &dst);
+  g_rnd = 99;
+  uint32_t reanudaciones = 0;
+  while (!otaDecDone(g_dec) && !otaDecFailed(g_dec))
+  {
+    const size_t desde = g_dec.inBytes;
+    size_t n = 1 + rnd() % 6000;
+    if (n > blob.size() - desde)
+      n = blob.size() - desde;
+    otaDecFeed(g_dec, (const uint8_t *)blob.data() + desde, n);
+    reanudaciones++;
+  }
+  comprobarImagen(g_dec, dst, g_target);
+  TEST_ASSERT_TRUE(reanudaciones > 5);
+}
+
+// Un .bin sin contenedor pasa tal cual
+static void test_raw_bin_passthrough()
+{
+  Destino dst;
+  decodificar(g_dec, dst, g_target);
+  TEST_ASSERT_EQUAL_UINT8(OTA_RAW, g_dec.info.kind);
+  TEST_ASSERT_TRUE(dst.out == g_target);
+  TEST_ASSERT_EQUAL_STRING(hostSha256Hex(g_target).c_str(), shaDe(dst.sha).c_str());
+}
+
+// Diferencial para otra base: se rechaza en la cabecera, sin escribir nada.
+// Contenedor dañado: nunca sale una imagen completa con otro contenido.
+static void test_wrong_base_and_damage()
+{
+  const std::string blob = empaquetar("delta", g_target, &g_base);
+
+  std::string otra = g_base;
+  otra[otra.size() / 2] ^= 1;
+  Destino dst;
+  dst.base = &otra;
+  decodificar(g_dec, dst, blob);
+  TEST_ASSERT_TRUE(otaDecFailed(g_dec));
+  TEST_ASSERT_FALSE(dst.baseOk);
+  TEST_ASSERT_EQUAL(0, dst.out.size());
+
+  // Truncado: no termina
+  Destino corto;
+  corto.base = &g_base;
+  decodificar(g_dec, corto, blob.substr(0, blob.size() - 1));
+  TEST_ASSERT_FALSE(otaDecDone(g_dec));
+
+  // Un byte cambiado en cada zona: error, o imagen que no pasa el SHA-256
+  const std::string esperado = hostSha256Hex(g_target);
+  for (size_t p = OTA_HDR_LEN; p < blob.size(); p += blob.size() / 50)
+  {
+    std::string malo = blob;
+    malo[p] ^= 0x21;
+    Destino d;
+    d.base = &g_base;
+    decodificar(g_dec, d, malo);
+    if (otaDecDone(g_dec))
+      TEST_ASSERT_TRUE(shaDe(d.sha) != esperado);
+  }
+}
+
+int main(int, char **)
+{
+  char tmpl[] = "/tmp/ota_rtXXXXXX";
+  g_dir = mkdtemp(tmpl) ? tmpl : "/tmp";
+  // scripts/ota_pack.py respecto a este fichero (test/native/test_ota_roundtrip/)
+  std::string here = __FILE__;
+  const size_t cut = here.rfind("test/native/");
+  g_script = (cut == std::string::npos ? std::string() : here.substr(0, cut)) + "scripts/ota_pack.py";
+  g_python = system("python3 -c \"import hashlib\" > /dev/null 2>&1") == 0 && access(g_script.c_str(), R_OK) == 0;
+
+  g_base = firmware(1234, 96 * 1024);
+  g_target = nuevaVersion(g_base);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_sha256_helper);
+  RUN_TEST(test_lz_roundtrip);
+  RUN_TEST(test_delta_roundtrip);
+  RUN_TEST(test_resume_at_offset);
+  RUN_TEST(test_raw_bin_passthrough);
+  RUN_TEST(test_wrong_base_and_damage);
+  const int r = UNITY_END();
+
+  const std::string rm = "rm -rf \"" + g_dir + "\"";
+  if (g_dir != "/tmp")
+    system(rm.c_str());
+  return r;
+}
@@ -0,0 +1,92 @@
+// Generado por scripts/qr_corpus.py a partir de QR/*.svg: no editar a mano.
+// Texto que lee el lector de cada muestra, su tipo y el código normalizado.
+#pragma once
+
+struct QrSample
+{
+  const char *file;
+  QRKind kind;
+  const char *text;
+  const char *code;
+};
+
+static const QrSample QR_CORPUS[] = {
+    {"MAGE/3123508120006123513.svg", QR_MAGE,
+     "3123508120006123513",
+     "3123508120006123513"},
+    {"MAGE/3123508120006123514.svg", QR_MAGE,
+     "3123508120006123514",
+     "3123508120006123514"},
+    {"MAGE/3123508120006123515.svg", QR_MAGE,
+     "3123508120006123515",
+     "3123508120006123515"},
+    {"MAGE/3123578120006123579.svg", QR_MAGE,
+     "3123578120006123579",
+     "3123578120006123579"},
+    {"MAGE/4123543120006123544.svg", QR_MAGE,
+     "4123543120006123544",
+     "4123543120006123544"},
+    {"MAGE/4123543120006123545.svg", QR_MAGE,
+     "4123543120006123545",
+     "4123543120006123545"},
+    {"MAGE/4123543120006123546.svg", QR_MAGE,
+     "4123543120006123546",
+     "4123543120006123546"},
+    {"MAGE/4127881127863127882.svg", QR_MAGE,
+     "4127881127863127882",
+     "4127881127863127882"},
+    {"MAGE/4127881127863127883.svg", QR_MAGE,
+     "4127881127863127883",
+     "4127881127863127883"},
+    {"MAGE/8129143128684129144.svg", QR_MAGE,
+     "8129143128684129144",
+     "8129143128684129144"},
+    {"POS_ODOO/8fef3165fb647cec9aca5863f5c789a5 (1).svg", QR_ODOO,
+     "https://tpv.museoelder.es/pos/ticket/validate?access_token=914d6697-21d4-4ce5-9009-8dcb5a58f419",
+     "914d6697-21d4-4ce5-9009-8dcb5a58f419"},
+    {"POS_ODOO/8fef3165fb647cec9aca5863f5c789a5.svg", QR_ODOO,
+     "https://tpv.museoelder.es/pos/ticket/validate?access_token=914d6697-21d4-4ce5-9009-8dcb5a58f419",
+     "914d6697-21d4-4ce5-9009-8dcb5a58f419"},
+    {"POS_ODOO/d64a8ee2402480c5a199f139eab01cb1.svg", QR_ODOO,
+     "https://tpv.museoelder.es/pos/ticket/validate?access_token=e6e4f346-dc20-425b-94eb-74f86fb67d09",
+     "e6e4f346-dc20-425b-94eb-74f86fb67d09"},
+    {"POS_ODOO/d8b7eab5274eaf180960914bbbec4ea9.svg", QR_ODOO,
+     "https://tpv.museoelder.es/pos/ticket/validate?access_token=16e18770-be7a-46d1-b76e-72d1cfc1a77d",
+     "16e18770-be7a-46d1-b76e-72d1cfc1a77d"},
+    {"POS_ODOO/f030f3afdaca3a52f61136ae1f53cf99.svg", QR_ODOO,
+     "https://tpv.museoelder.es/pos/ticket/validate?access_token=af324cf9-bd6e-4617-992d-6a6fb3cda976",
+     "af324cf9-bd6e-4617-992d-6a6fb3cda976"},
+    {"TEC/05a873fbd5f8630bd910ef781b8c260c.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=133124&event_id=132395",
+     "ticket_id=133124&event_id=132395"},
+    {"TEC/19671f742c8fd23b72152c9ac7eef4c1.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=133122&event_id=132395",
+     "ticket_id=133122&event_id=132395"},
+    {"TEC/1ed650d3efbfc6c0a3276d66016a037f.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=133294&event_id=132395",
+     "ticket_id=133294&event_id=132395"},
+    {"TEC/2e6f64bab9d647c685fa2356deb52a27.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=133297&event_id=132395",
+     "ticket_id=133297&event_id=132395"},
+    {"TEC/524acf9e6bd4e2cb89ce062b217af9d4.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=133288&event_id=132395",
+     "ticket_id=133288&event_id=132395"},
+    {"TEC/86102dc31148f095bb5982a965d3a0f7.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=133293&event_id=132395",
+     "ticket_id=133293&event_id=132395"},
+    {"TEC/89e1d6e564870ed3856fa9620160f36b.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=133289&event_id=132395",
+     "ticket_id=133289&event_id=132395"},
+    {"TEC/9c6afae6201204927a1a76cacbbb1bd6.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=133292&event_id=132395",
+     "ticket_id=133292&event_id=132395"},
+    {"TEC/c74e02ca93a690dc58bb686ed6d6df74.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=133296&event_id=132395",
+     "ticket_id=133296&event_id=132395"},
+    {"TEC/d22a279579c3b235e3e99338ec49716c.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=133123&event_id=132395",
+     "ticket_id=133123&event_id=132395"},
+    {"TEC/dd41f72d62916f7a2482b59fa543937a.svg", QR_TEC,
+     "https://wptpv.museoelder.es/?event_qr_code=1&ticket_id=132979&event_id=132395",
+     "ticket_id=132979&event_id=132395"},
+};
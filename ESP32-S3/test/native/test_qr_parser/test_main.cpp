@@ -0,0 +1,403 @@
+// Clasificación de QR (qr_parser.cpp) con las muestras de QR/ decodificadas
+// en qr_corpus.h (scripts/qr_corpus.py): cada código como lo manda el lector,
+// comparación con el parser de Strings al que sustituye y coste por lectura.
+#include <unity.h>
+
+#include "../../support/bench.hpp"
+
+#include <Arduino.h>
+
+#include "../../../src/qr_parser.cpp"
+
+#include "qr_corpus.h"
+
+#include <string>
+#include <vector>
+
+static const size_t NCORPUS = sizeof(QR_CORPUS) / sizeof(QR_CORPUS[0]);
+
+void setUp() {}
+void tearDown() {}
+
+static QrSpan span(const std::string &s)
+{
+  return QrSpan{s.data(), s.size()};
+}
+
+// ---- Lo de antes (DSSP3120.cpp): Strings, indexOf y substring ----
+
+static bool viejoAllDigits(const String &s)
+{
+  if (s.length() == 0)
+    return false;
+  for (size_t i = 0; i < s.length(); ++i)
+    if (!isDigit((unsigned char)s[i]))
+      return false;
+  return true;
+}
+
+static bool viejoTokenOdoo(String s)
+{
+  s.trim();
+  if (s.length() < 10)
+    return false;
+  for (size_t i = 0; i < s.length(); ++i)
+  {
+    const char c = s[i];
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') || c == '-'))
+      return false;
+  }
+  return true;
+}
+
+static String viejoQueryParam(const String &url, const char *key)
+{
+  const int q = url.indexOf('?');
+  const String query = (q >= 0) ? url.substring(q + 1) : url;
+  const String ks = String(key) + "=";
+  int pos = query.indexOf(ks);
+  if (pos < 0)
+    return "";
+  pos += ks.length();
+  const int amp = query.indexOf('&', pos);
+  String res = (amp >= 0) ? query.substring(pos, amp) : query.substring(pos);
+  res.trim();
+  return res;
+}
+
+static QRKind viejoNormalizar(const String &raw, String &outCode)
+{
+  String s = raw;
+  s.trim();
+  if (s.length() >= 2)
+  {
+    if ((s.startsWith("\"") && s.endsWith("\"")) || (s.startsWith("'") && s.endsWith("'")))
+    {
+      s.remove(0, 1);
+      s.remove(s.length() - 1);
+      s.trim();
+    }
+  }
+  if (s.indexOf("tpv.museoelder.es") >= 0)
+  {
+    const String token = viejoQueryParam(s, "access_token");
+    if (viejoTokenOdoo(token))
+    {
+      outCode = token;
+      return QR_ODOO;
+    }
+  }
+  if (s.indexOf("wptpv.museoelder.es") >= 0)
+  {
+    const String tid = viejoQueryParam(s, "ticket_id");
+    const String eid = viejoQueryParam(s, "event_id");
+    if (tid.length() > 0 && eid.length() > 0 && viejoAllDigits(tid) && viejoAllDigits(eid))
+    {
+      outCode = "ticket_id=" + tid + "&event_id=" + eid;
+      return QR_TEC;
+    }
+  }
+  if (s.length() >= 17 && s.length() <= 20 && viejoAllDigits(s))
+  {
+    outCode = s;
+    return QR_MAGE;
+  }
+  return QR_UNKNOWN;
+}
+
+// Línea completa como la trataba readLine_parsed() (sin UART ni logs)
+static bool viejoLinea(String &buffer, uint8_t b, String &code, int &dir, QRKind &kind)
+{
+  if (b == 0x00 || b == 0xFF)
+    return false;
+  if (b == 0x0D || b == 0x0A)
+  {
+    if (buffer.length() == 0)
+      return false;
+    String raw = buffer;
+    buffer = "";
+    raw.trim();
+    if (raw.indexOf("IN:") != -1)
+    {
+      dir = 1;
+      raw = raw.substring(raw.indexOf("IN:") + 3);
+    }
+    else if (raw.indexOf("OUT:") != -1)
+    {
+      dir = 2;
+      raw = raw.substring(raw.indexOf("OUT:") + 4);
+    }
+    else
+      return false;
+    kind = viejoNormalizar(raw, code);
+    return kind != QR_UNKNOWN;
+  }
+  if (b >= 32 && b <= 126)
+  {
+    buffer += (char)b;
+    if (buffer.length() > 256)
+      buffer = "";
+  }
+  return false;
+}
+
+// ---- Lo de ahora ----
+
+struct Lectura
+{
+  bool ok = false;
+  QrScan scan = {};
+  QRKind kind = QR_UNKNOWN;
+  char code[QR_CODE_MAX];
+};
+
+// Alimenta la línea byte a byte; se queda con la última línea completa
+static Lectura leer(QrLineAsm &a, const std::string &bytes)
+{
+  Lectura r;
+  for (unsigned char b : bytes)
+  {
+    QrSpan line;
+    if (!qrLineFeed(a, b, line))
+      continue;
+    r.ok = qrSplitPrefix(line, r.scan);
+    r.kind = r.ok ? qrNormalize(r.scan.body, r.code, sizeof(r.code)) : QR_UNKNOWN;
+  }
+  return r;
+}
+
+// Cada muestra de QR/ sale con su tipo y su código
+static void test_corpus_normalizes()
+{
+  TEST_ASSERT_EQUAL(26, NCORPUS);
+  uint32_t porTipo[3] = {0, 0, 0};
+  for (const QrSample &q : QR_CORPUS)
+  {
+    char out[QR_CODE_MAX];
+    const QRKind k = qrNormalize(span(q.text), out, sizeof(out));
+    TEST_ASSERT_EQUAL_MESSAGE(q.kind, k, q.file);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(q.code, out, q.file);
+    porTipo[k]++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(5, porTipo[QR_ODOO]);
+  TEST_ASSERT_EQUAL_UINT32(11, porTipo[QR_TEC]);
+  TEST_ASSERT_EQUAL_UINT32(10, porTipo[QR_MAGE]);
+}
+
+// Como llegan del lector: prefijo, id de torno, basura y fin de línea
+static void test_corpus_through_line_assembler()
+{
+  static const struct
+  {
+    const char *antes;
+    const char *fin;
+    int dir;
+    uint8_t machine;
+  } envoltorios[] = {
+      {"IN:", "\r\n", 1, 0},
+      {"OUT:", "\n", 2, 0},
+      {"3IN:", "\r", 1, 3},
+      {"12OUT:", "\r\n", 2, 12},
+      {"  IN: ", "  \r\n", 1, 0},
+      {"999IN:", "\n", 1, 0}, // id fuera de rango: torno por defecto
+  };
+  QrLineAsm a;
+  qrLineReset(a);
+  for (const QrSample &q : QR_CORPUS)
+  {
+    for (auto &e : envoltorios)
+    {
+      std::string linea = std::string("\r\n") + e.antes;
+      // Basura del lector intercalada (se ignora)
+      for (const char *p = q.text; *p; p++)
+      {
+        linea += *p;
+        if ((p - q.text) % 7 == 3)
+          linea += (char)((p - q.text) % 2 ? 0x00 : 0xFF);
+      }
+      linea += e.fin;
+      const Lectura r = leer(a, linea);
+      TEST_ASSERT_TRUE_MESSAGE(r.ok, q.file);
+      TEST_ASSERT_EQUAL(e.dir, r.scan.direccion);
+      TEST_ASSERT_EQUAL_UINT8(e.machine, r.scan.machine);
+      TEST_ASSERT_EQUAL_MESSAGE(q.kind, r.kind, q.file);
+      TEST_ASSERT_EQUAL_STRING_MESSAGE(q.code, r.code, q.file);
+    }
+  }
+
+  // Sin prefijo no hay dirección (el llamante la descarta)
+  const Lectura r = leer(a, std::string(QR_CORPUS[0].text) + "\n");
+  TEST_ASSERT_FALSE(r.ok);
+}
+
+// Variantes de cada muestra (recortes, comillas, otro dominio, parámetros
+// movidos...): mismo resultado que el parser de Strings
+static void test_matches_old_parser()
+{
+  std::vector<std::string> casos;
+  for (const QrSample &q : QR_CORPUS)
+  {
+    const std::string t = q.text;
+    for (size_t n = 0; n <= t.size(); n++)
+      casos.push_back(t.substr(0, n));
+    for (size_t i = 0; i < t.size(); i++)
+      casos.push_back(t.substr(0, i) + t.substr(i + 1));
+    casos.push_back("\"" + t + "\"");
+    casos.push_back("' " + t + " '");
+    casos.push_back("\"" + t + "'");
+    casos.push_back(" \t" + t + " ");
+    casos.push_back(t + "&x=1");
+    casos.push_back(t + "#frag");
+    casos.push_back(t + "0");
+    casos.push_back("X" + t);
+  }
+  casos.push_back("https://tpv.museoelder.es/pos?access_token=");
+  casos.push_back("https://tpv.museoelder.es/pos?access_token=abcdef012");
+  casos.push_back("https://tpv.museoelder.es/pos?access_token=abcdef0123");
+  casos.push_back("https://tpv.museoelder.es/pos?access_token=ABCDEF-0123&x=y");
+  casos.push_back("https://tpv.museoelder.es/pos?access_token=abcdefg0123");
+  casos.push_back("https://tpv.museoelder.es/pos?access_token= abcdef0123 &a=b");
+  casos.push_back("https://tpv.museoelder.es/pos?my_access_token=abcdef0123");
+  casos.push_back("https://tpv.museoelder.es/pos?access_tokenx=1&access_token=abcdef0123");
+  casos.push_back("https://wptpv.museoelder.es/?event_id=2&ticket_id=1");
+  casos.push_back("https://wptpv.museoelder.es/?ticket_id=1&event_id=");
+  casos.push_back("https://wptpv.museoelder.es/?ticket_id=1a&event_id=2");
+  casos.push_back("https://wptpv.museoelder.es/?ticket_id=1&event_id=2&access_token=abcdef0123");
+  casos.push_back("https://otro.es/?ticket_id=1&event_id=2");
+  casos.push_back("ticket_id=1&event_id=2");
+  casos.push_back("12345678901234567");
+  casos.push_back("1234567890123456");
+  casos.push_back("123456789012345678901");
+  casos.push_back("\"\"");
+  casos.push_back("\"");
+  casos.push_back("");
+
+  uint32_t validos = 0;
+  for (const std::string &c : casos)
+  {
+    String viejoCode;
+    const QRKind viejo = viejoNormalizar(String(c.c_str()), viejoCode);
+    char out[QR_CODE_MAX];
+    const QRKind nuevo = qrNormalize(span(c), out, sizeof(out));
+    if (viejo != nuevo || (nuevo != QR_UNKNOWN && strcmp(viejoCode.c_str(), out) != 0))
+    {
+      char msg[256];
+      snprintf(msg, sizeof(msg), "\"%s\": antes %d \"%s\", ahora %d \"%s\"", c.c_str(), viejo, viejoCode.c_str(), nuevo, out);
+      TEST_FAIL_MESSAGE(msg);
+    }
+    if (nuevo != QR_UNKNOWN)
+      validos++;
+    else
+      TEST_ASSERT_EQUAL_STRING("", out);
+  }
+  TEST_ASSERT_TRUE(validos > 4 * NCORPUS);
+  TEST_ASSERT_TRUE(casos.size() > 2000);
+}
+
+// Un código que no cabe en el buffer del llamante se rechaza entero
+static void test_output_capacity()
+{
+  for (const QrSample &q : QR_CORPUS)
+  {
+    const size_t n = strlen(q.code);
+    char out[QR_CODE_MAX];
+    memset(out, 'x', sizeof(out));
+    TEST_ASSERT_EQUAL(QR_UNKNOWN, qrNormalize(span(q.text), out, n));
+    TEST_ASSERT_EQUAL_STRING("", out);
+    TEST_ASSERT_EQUAL(q.kind, qrNormalize(span(q.text), out, n + 1));
+    TEST_ASSERT_EQUAL_STRING(q.code, out);
+  }
+  TEST_ASSERT_EQUAL(QR_UNKNOWN, qrNormalize(span(QR_CORPUS[0].text), nullptr, 10));
+}
+
+// Líneas demasiado largas y vacías
+static void test_line_limits()
+{
+  QrLineAsm a;
+  qrLineReset(a);
+  QrSpan line;
+
+  // Una línea que se pasa de QR_LINE_MAX se descarta y se empieza de nuevo
+  std::string largo(QR_LINE_MAX, 'z');
+  Lectura r = leer(a, largo + "IN:" + QR_CORPUS[0].text + "\n");
+  TEST_ASSERT_TRUE(r.ok);
+  TEST_ASSERT_EQUAL_STRING(QR_CORPUS[0].code, r.code);
+
+  // Justo QR_LINE_MAX cabe
+  std::string justo = std::string("IN:") + QR_CORPUS[0].text;
+  justo = std::string(QR_LINE_MAX - justo.size(), ' ') + justo;
+  r = leer(a, justo + "\n");
+  TEST_ASSERT_TRUE(r.ok);
+  TEST_ASSERT_EQUAL(QR_CORPUS[0].kind, r.kind);
+
+  // Solo espacios o fines de línea: nada
+  for (const char *p = "   \r\n\r\n\t\n"; *p; p++)
+    TEST_ASSERT_FALSE(qrLineFeed(a, (uint8_t)*p, line));
+  TEST_ASSERT_EQUAL_UINT16(0, a.len);
+}
+
+// Coste por lectura, de los bytes del lector al código normalizado
+static void test_bench_per_scan()
+{
+  std::vector<std::string> lineas;
+  for (const QrSample &q : QR_CORPUS)
+    lineas.push_back(std::string("3IN:") + q.text + "\r\n");
+  size_t bytes = 0;
+  for (auto &l : lineas)
+    bytes += l.size();
+
+  QrLineAsm a;
+  qrLineReset(a);
+  uint32_t okNuevo = 0;
+  BenchHeap m = benchHeapMark();
+  for (auto &l : lineas)
+    okNuevo += leer(a, l).kind != QR_UNKNOWN;
+  const BenchHeap hNuevo = benchHeapSince(m);
+  const double nsNuevo = benchNsPerIter(2000, [&]
+                                        { for (auto &l : lineas)
+                                            leer(a, l); }) / lineas.size();
+
+  String buffer;
+  uint32_t okViejo = 0;
+  m = benchHeapMark();
+  for (auto &l : lineas)
+  {
+    String code;
+    int dir = 0;
+    QRKind k = QR_UNKNOWN;
+    for (unsigned char b : l)
+      okViejo += viejoLinea(buffer, b, code, dir, k);
+  }
+  const BenchHeap hViejo = benchHeapSince(m);
+  const double nsViejo = benchNsPerIter(2000, [&]
+                                        { for (auto &l : lineas)
+                                          {
+                                            String code;
+                                            int dir = 0;
+                                            QRKind k = QR_UNKNOWN;
+                                            for (unsigned char b : l)
+                                              viejoLinea(buffer, b, code, dir, k);
+                                          } }) / lineas.size();
+
+  TEST_ASSERT_EQUAL_UINT32(NCORPUS, okNuevo);
+  TEST_ASSERT_EQUAL_UINT32(NCORPUS, okViejo);
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)hNuevo.allocs);
+  TEST_ASSERT_TRUE(hViejo.allocs >= NCORPUS);
+
+  benchReport("qr_parser", "%.0f ns/lectura, 0 reservas (%u B de media por línea)",
+              nsNuevo, (unsigned)(bytes / lineas.size()));
+  benchReport("String (antes)", "%.0f ns/lectura, %.1f reservas y %.0f B pedidos por lectura",
+              nsViejo, (double)hViejo.allocs / NCORPUS, (double)hViejo.bytes / NCORPUS);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_corpus_normalizes);
+  RUN_TEST(test_corpus_through_line_assembler);
+  RUN_TEST(test_matches_old_parser);
+  RUN_TEST(test_output_capacity);
+  RUN_TEST(test_line_limits);
+  RUN_TEST(test_bench_per_scan);
+  return UNITY_END();
+}
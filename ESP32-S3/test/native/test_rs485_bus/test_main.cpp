@@ -0,0 +1,207 @@
+// Varios tornos en un mismo bus RS485 (RS485.cpp, g_machines): sondeo por
+// turnos, estado separado por id, tornos apagados que no acaparan el bus y
+// altas en caliente. Tres tornos simulados comparten Serial2.
+#include <unity.h>
+
+#define RS485_MACHINES {1, 2, 3}
+
+#define FAKE_LOGBUF
+#include "../../support/app_fakes.hpp"
+
+#include "../../../src/definiciones.cpp"
+#include "../../../src/RS485.cpp"
+
+#include "../../support/turnstile_emu.hpp"
+
+static TurnstileBus *g_bus = nullptr;
+
+static const uint64_t POLL_US = RS485_POLL_MS * 1000ULL;
+
+void setUp()
+{
+  hostReset(hostNowUs());
+  g_bus = new TurnstileBus({1, 2, 3, 4});
+  g_bus->attach();
+  delay(2 * RS485_POLL_MS); // todos los tornos con trama reciente
+  g_bus->clearLog();
+}
+
+void tearDown()
+{
+  g_bus->detach();
+  delete g_bus;
+  g_bus = nullptr;
+}
+
+static void test_begin_registers_bus()
+{
+  TEST_ASSERT_EQUAL_UINT8(3, RS485::machineCount());
+  TEST_ASSERT_EQUAL_UINT8(1, RS485::machineAt(0));
+  TEST_ASSERT_EQUAL_UINT8(3, RS485::machineAt(2));
+  TEST_ASSERT_EQUAL_UINT8(0, RS485::machineAt(3));
+  TEST_ASSERT_TRUE(fakeLogHas("Tornos en el bus: 3"));
+  for (uint8_t id = 1; id <= 3; id++)
+    TEST_ASSERT_TRUE(RS485::online(id));
+  TEST_ASSERT_FALSE(RS485::online(4)); // en el cable, pero no dado de alta
+}
+
+// Una consulta cada RS485_POLL_MS / N, por turnos: cada torno una vez por
+// periodo, sin colisiones en el cable
+static void test_round_robin_polling()
+{
+  delay(4 * RS485_POLL_MS);
+  const auto q = g_bus->sentCmd(0x10);
+  TEST_ASSERT_TRUE(q.size() >= 11 && q.size() <= 13);
+  for (size_t i = 1; i < q.size(); i++)
+  {
+    TEST_ASSERT_EQUAL_UINT8(q[i - 1].machine() % 3 + 1, q[i].machine());
+    const uint64_t gap = q[i].startUs - q[i - 1].startUs;
+    TEST_ASSERT_UINT32_WITHIN(500, POLL_US / 3, (uint32_t)gap);
+  }
+  for (uint8_t id = 1; id <= 3; id++)
+  {
+    const auto mq = g_bus->sentCmd(0x10, id);
+    for (size_t i = 1; i < mq.size(); i++)
+      TEST_ASSERT_UINT32_WITHIN(1000, POLL_US, (uint32_t)(mq[i].startUs - mq[i - 1].startUs));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->sentCmd(0x10, 4).size());
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->collisions);
+}
+
+// Cada trama va al estado de su id: una apertura en el 2 no toca a los demás
+static void test_per_machine_state()
+{
+  const uint32_t l1 = RS485::getStatus(1).leftCount;
+  const uint32_t r3 = RS485::getStatus(3).rightCount;
+
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, RS485::wait(RS485::leftOpen(2, 1), 500).status);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, RS485::wait(RS485::rightOpen(3, 1), 500).status);
+  delay(2 * RS485_POLL_MS);
+
+  TEST_ASSERT_EQUAL_UINT32(g_bus->unit(2).left, RS485::getStatus(2).leftCount);
+  TEST_ASSERT_EQUAL_UINT32(g_bus->unit(3).right, RS485::getStatus(3).rightCount);
+  TEST_ASSERT_EQUAL_UINT32(r3 + 1, RS485::getStatus(3).rightCount);
+  TEST_ASSERT_EQUAL_UINT32(l1, RS485::getStatus(1).leftCount);
+  TEST_ASSERT_EQUAL_UINT8(2, RS485::getStatus(2).machine);
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->unit(1).opens);
+
+  // Sin id: el primero de RS485_MACHINES
+  TEST_ASSERT_EQUAL_UINT8(1, RS485::getStatus().machine);
+}
+
+// Órdenes a tornos distintos mezcladas con el sondeo: cada una la confirma
+// la trama de su propio torno
+static void test_commands_to_several_machines()
+{
+  RS485::Txn t[3];
+  for (uint8_t id = 1; id <= 3; id++)
+    t[id - 1] = RS485::closeGate(id);
+  delay(RS485_POLL_MS);
+  for (uint8_t id = 1; id <= 3; id++)
+  {
+    RS485::TxnResult r;
+    TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, RS485::peek(t[id - 1], &r));
+    TEST_ASSERT_EQUAL_UINT8(1, r.attempts);
+    TEST_ASSERT_EQUAL_UINT8(id, r.frame.machine);
+    TEST_ASSERT_EQUAL_UINT32(1, g_bus->unit(id).closes);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->collisions);
+}
+
+// Un torno apagado pasa a desconectado y no retrasa a los demás: una sola
+// consulta por periodo, sin reintentos
+static void test_dead_machine_does_not_hog_bus()
+{
+  g_bus->unit(2).mute = true;
+  const uint32_t retries = RS485::txStats().retries;
+  delay(RS485_OFFLINE_MS + 2 * RS485_POLL_MS);
+
+  TEST_ASSERT_FALSE(RS485::online(2));
+  TEST_ASSERT_TRUE(RS485::online(1));
+  TEST_ASSERT_TRUE(RS485::online(3));
+  TEST_ASSERT_EQUAL_UINT32(retries, RS485::txStats().retries);
+
+  const auto q2 = g_bus->sentCmd(0x10, 2);
+  const auto q1 = g_bus->sentCmd(0x10, 1);
+  TEST_ASSERT_UINT32_WITHIN(1, q1.size(), q2.size());
+  for (size_t i = 1; i < q1.size(); i++)
+    TEST_ASSERT_UINT32_WITHIN(1000, POLL_US, (uint32_t)(q1[i].startUs - q1[i - 1].startUs));
+
+  const String json = RS485::busStatsJson();
+  TEST_ASSERT_TRUE(json.indexOf("{\"id\":2,\"online\":false") >= 0);
+  TEST_ASSERT_TRUE(json.indexOf("{\"id\":1,\"online\":true") >= 0);
+
+  // Vuelve en cuanto contesta
+  g_bus->unit(2).mute = false;
+  delay(2 * RS485_POLL_MS);
+  TEST_ASSERT_TRUE(RS485::online(2));
+}
+
+// Tramas de un id que no está dado de alta: se cuentan y se descartan
+static void test_unknown_id_frames()
+{
+  const String antes = RS485::busStatsJson();
+  const int u0 = antes.substring(antes.indexOf(':') + 1).toInt();
+  g_bus->spontaneous(9, 20000);
+  delay(100);
+  const String json = RS485::busStatsJson();
+  TEST_ASSERT_EQUAL(u0 + 1, json.substring(json.indexOf(':') + 1).toInt());
+  TEST_ASSERT_FALSE(RS485::getStatus(9).valid);
+}
+
+// Los suscritos se enteran de los cambios de cualquier torno, no del latido
+static void test_subscribers_notified_on_change()
+{
+  TEST_ASSERT_TRUE(RS485::subscribe(xTaskGetCurrentTaskHandle()));
+  g_hostNotify = 0;
+  delay(2 * RS485_POLL_MS);
+  TEST_ASSERT_EQUAL_UINT32(0, g_hostNotify); // sondeo sin cambios
+
+  g_bus->unit(3).left += 5; // alguien pasa por el torno 3
+  delay(2 * RS485_POLL_MS);
+  TEST_ASSERT_EQUAL_UINT32(1, g_hostNotify);
+  TEST_ASSERT_EQUAL_UINT32(g_bus->unit(3).left, RS485::getStatus(3).leftCount);
+}
+
+// Alta en caliente: entra en el turno y el periodo se reparte entre cuatro
+static void test_add_machine_hot()
+{
+  TEST_ASSERT_TRUE(RS485::addMachine(2)); // ya estaba: no duplica
+  TEST_ASSERT_EQUAL_UINT8(3, RS485::machineCount());
+  TEST_ASSERT_FALSE(RS485::addMachine(0));
+
+  TEST_ASSERT_TRUE(RS485::addMachine(4));
+  TEST_ASSERT_EQUAL_UINT8(4, RS485::machineCount());
+  g_bus->clearLog();
+  delay(4 * RS485_POLL_MS);
+
+  const auto q = g_bus->sentCmd(0x10);
+  for (size_t i = 1; i < q.size(); i++)
+  {
+    TEST_ASSERT_EQUAL_UINT8(q[i - 1].machine() % 4 + 1, q[i].machine());
+    TEST_ASSERT_UINT32_WITHIN(500, POLL_US / 4, (uint32_t)(q[i].startUs - q[i - 1].startUs));
+  }
+  TEST_ASSERT_TRUE(RS485::online(4));
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->collisions);
+
+  // Hasta RS485_MAX_MACHINES
+  for (uint8_t id = 5; RS485::machineCount() < RS485_MAX_MACHINES; id++)
+    TEST_ASSERT_TRUE(RS485::addMachine(id));
+  TEST_ASSERT_FALSE(RS485::addMachine(100));
+}
+
+int main(int, char **)
+{
+  hostReset(1000000);
+  RS485::begin();
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_registers_bus);
+  RUN_TEST(test_round_robin_polling);
+  RUN_TEST(test_per_machine_state);
+  RUN_TEST(test_commands_to_several_machines);
+  RUN_TEST(test_dead_machine_does_not_hog_bus);
+  RUN_TEST(test_unknown_id_frames);
+  RUN_TEST(test_subscribers_notified_on_change);
+  RUN_TEST(test_add_machine_hot); // la última: deja el bus con más tornos
+  return UNITY_END();
+}
@@ -0,0 +1,280 @@
+// Sincronización de parámetros (RS485::syncParams) contra el torno
+// guionizado: solo se escribe lo que difiere de la sombra, con varias
+// escrituras en la cola a la vez, se lee de vuelta lo escrito y lo que falla
+// o no termina sale de la sombra para reescribirse en la siguiente llamada.
+// Un menú solo pasa a confirmado con el valor que de verdad tiene el torno.
+//
+// La sombra es del módulo y no se reinicia entre pruebas: cada una parte de
+// lo que dejó la anterior (el orden de RUN_TEST importa).
+#include <unity.h>
+
+#define FAKE_LOGBUF
+#include "../../support/app_fakes.hpp"
+
+#include "../../../src/definiciones.cpp"
+#include "../../../src/RS485.cpp"
+
+#include "../../support/turnstile_emu.hpp"
+
+static const uint8_t N = 37; // PARAMS_COUNT
+static const uint32_t PLAZO_MS = 5000;
+
+static TurnstileBus *g_bus = nullptr;
+static uint8_t g_want[64];
+static uint8_t g_maxDepth = 0; // profundidad máxima de la cola durante la prueba
+
+// Menús que pasaron a confirmados (o cambiaron de valor confirmado) con un
+// valor distinto del que tenía el torno en ese instante
+static uint32_t g_malConfirmados = 0;
+static uint64_t g_knownAntes = 0;
+static uint8_t g_valAntes[64];
+
+static EmuTurnstile &torno()
+{
+  return g_bus->unit(MACHINE_ID);
+}
+
+void setUp()
+{
+  hostReset(hostNowUs());
+  g_bus = new TurnstileBus();
+  g_bus->attach();
+  hostOnTick([]()
+             {
+    const uint8_t d = RS485::txStats().depth;
+    if (d > g_maxDepth)
+      g_maxDepth = d;
+    const uint64_t k = RS485::g_paramKnown;
+    for (uint8_t i = 0; i < 64; i++)
+    {
+      const bool nuevo = !((g_knownAntes >> i) & 1ULL) || RS485::g_paramVal[i] != g_valAntes[i];
+      if (((k >> i) & 1ULL) && nuevo && RS485::g_paramVal[i] != torno().params[i])
+        g_malConfirmados++;
+    }
+    g_knownAntes = k;
+    memcpy(g_valAntes, RS485::g_paramVal, sizeof(g_valAntes)); });
+  // Lo que el torno ya tiene de una sincronización anterior
+  for (uint8_t i = 0; i < 64; i++)
+    torno().params[i] = g_want[i];
+  delay(500);
+  g_bus->clearLog();
+  g_fakeLog.clear();
+  g_maxDepth = 0;
+  g_malConfirmados = 0;
+  g_knownAntes = RS485::g_paramKnown;
+  memcpy(g_valAntes, RS485::g_paramVal, sizeof(g_valAntes));
+}
+
+void tearDown()
+{
+  g_bus->detach();
+  delete g_bus;
+  g_bus = nullptr;
+}
+
+// Tramas de una orden de parámetros en el cable, en orden (menú de cada una)
+static std::vector<uint8_t> menusEnCable(uint8_t cmd)
+{
+  std::vector<uint8_t> v;
+  for (auto &t : g_bus->sentCmd(cmd, MACHINE_ID))
+    v.push_back(t.b[4]);
+  return v;
+}
+
+static void comprobarTorno(uint8_t n)
+{
+  for (uint8_t i = 0; i < n; i++)
+    TEST_ASSERT_EQUAL_UINT8(g_want[i], torno().params[i]);
+}
+
+// Sombra vacía: se escriben y leen de vuelta todos, con varias escrituras en
+// la cola a la vez pero sin pasar de RS485_PARAM_PIPELINE (+ el sondeo)
+static void test_all_unknown_written_pipelined()
+{
+  for (uint8_t i = 0; i < N; i++)
+    g_want[i] = (uint8_t)(i % 7 + 1);
+  const RS485::ParamSyncResult r = RS485::syncParams(g_want, N, PLAZO_MS);
+  TEST_ASSERT_TRUE(r.ok());
+  TEST_ASSERT_EQUAL_UINT8(N, r.changed);
+  TEST_ASSERT_EQUAL_UINT8(N, r.written);
+  TEST_ASSERT_EQUAL_UINT8(N, r.verified);
+  TEST_ASSERT_EQUAL_UINT8(0xFF, r.firstFailed);
+  comprobarTorno(N);
+
+  const std::vector<uint8_t> w = menusEnCable(0x96), rd = menusEnCable(0x97);
+  TEST_ASSERT_EQUAL_UINT32(N, w.size());
+  TEST_ASSERT_EQUAL_UINT32(N, rd.size());
+  for (uint8_t i = 0; i < N; i++)
+  {
+    TEST_ASSERT_EQUAL_UINT8(i, w[i]);
+    TEST_ASSERT_EQUAL_UINT8(i, rd[i]);
+  }
+  TEST_ASSERT_TRUE(g_maxDepth >= 2);
+  TEST_ASSERT_TRUE(g_maxDepth <= RS485_PARAM_PIPELINE + 1);
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->collisions);
+  TEST_ASSERT_TRUE(r.ms < PLAZO_MS);
+  TEST_ASSERT_EQUAL_UINT32(0, g_malConfirmados);
+}
+
+// Sin cambios: ninguna trama de parámetros
+static void test_no_change_no_traffic()
+{
+  const RS485::ParamSyncResult r = RS485::syncParams(g_want, N, PLAZO_MS);
+  TEST_ASSERT_TRUE(r.ok());
+  TEST_ASSERT_EQUAL_UINT8(0, r.changed);
+  TEST_ASSERT_EQUAL_UINT8(0, r.written);
+  TEST_ASSERT_EQUAL_UINT32(0, menusEnCable(0x96).size());
+  TEST_ASSERT_EQUAL_UINT32(0, menusEnCable(0x97).size());
+  TEST_ASSERT_EQUAL_UINT32(0, torno().paramWrites);
+}
+
+// Guardar un parámetro: una escritura y una lectura, de ese menú
+static void test_single_change_single_write()
+{
+  g_want[12] = 99;
+  const RS485::ParamSyncResult r = RS485::syncParams(g_want, N, PLAZO_MS);
+  TEST_ASSERT_TRUE(r.ok());
+  TEST_ASSERT_EQUAL_UINT8(1, r.changed);
+  TEST_ASSERT_EQUAL_UINT8(1, r.written);
+  TEST_ASSERT_EQUAL_UINT8(1, r.verified);
+  TEST_ASSERT_TRUE(menusEnCable(0x96) == std::vector<uint8_t>({12}));
+  TEST_ASSERT_TRUE(menusEnCable(0x97) == std::vector<uint8_t>({12}));
+  TEST_ASSERT_EQUAL_UINT8(99, torno().params[12]);
+
+  uint8_t v = 0;
+  TEST_ASSERT_TRUE(RS485::readParam(12, v));
+  TEST_ASSERT_EQUAL_UINT8(99, v);
+}
+
+// seedParams: lo supuesto desde la NVS evita escribir, pero no pisa lo ya
+// confirmado por el torno
+static void test_seed_does_not_override_confirmed()
+{
+  uint8_t seed[40];
+  for (uint8_t i = 0; i < 40; i++)
+    seed[i] = (uint8_t)(200 + i); // 0..36 ya confirmados: se ignoran
+  RS485::seedParams(seed, 40);
+  for (uint8_t i = N; i < 40; i++)
+    g_want[i] = seed[i];
+
+  RS485::ParamSyncResult r = RS485::syncParams(g_want, 40, PLAZO_MS);
+  TEST_ASSERT_TRUE(r.ok());
+  TEST_ASSERT_EQUAL_UINT8(0, r.changed);
+  TEST_ASSERT_EQUAL_UINT32(0, menusEnCable(0x96).size());
+
+  uint8_t v = 0;
+  TEST_ASSERT_TRUE(RS485::readParam(3, v)); // confirmado
+  TEST_ASSERT_EQUAL_UINT8(g_want[3], v);
+
+  // Un supuesto que cambia se escribe como cualquier otro
+  g_want[38] = 7;
+  r = RS485::syncParams(g_want, 40, PLAZO_MS);
+  TEST_ASSERT_TRUE(r.ok());
+  TEST_ASSERT_TRUE(menusEnCable(0x96) == std::vector<uint8_t>({38}));
+  TEST_ASSERT_EQUAL_UINT8(7, torno().params[38]);
+}
+
+// Leído de vuelta con otro valor: falla y la sombra se queda con lo leído,
+// así que la siguiente sincronización lo vuelve a escribir
+static void test_readback_mismatch_rewritten()
+{
+  torno().corruptParams = true;
+  g_want[3] = 77;
+  RS485::ParamSyncResult r = RS485::syncParams(g_want, N, PLAZO_MS);
+  TEST_ASSERT_FALSE(r.ok());
+  TEST_ASSERT_EQUAL_UINT8(1, r.written);
+  TEST_ASSERT_EQUAL_UINT8(0, r.verified);
+  TEST_ASSERT_EQUAL_UINT8(1, r.failed);
+  TEST_ASSERT_EQUAL_UINT8(3, r.firstFailed);
+  TEST_ASSERT_EQUAL_UINT8(76, torno().params[3]);
+  TEST_ASSERT_TRUE(fakeLogHas("escrito 77, le"));
+  // La confirmación de la escritura no basta: nunca se dio 77 por bueno
+  TEST_ASSERT_EQUAL_UINT32(0, g_malConfirmados);
+
+  uint8_t v = 0;
+  TEST_ASSERT_TRUE(RS485::readParam(3, v));
+  TEST_ASSERT_EQUAL_UINT8(76, v);
+
+  torno().corruptParams = false;
+  g_bus->clearLog();
+  r = RS485::syncParams(g_want, N, PLAZO_MS);
+  TEST_ASSERT_TRUE(r.ok());
+  TEST_ASSERT_TRUE(menusEnCable(0x96) == std::vector<uint8_t>({3}));
+  TEST_ASSERT_EQUAL_UINT8(77, torno().params[3]);
+}
+
+// Escritura sin confirmar (el torno la ejecuta pero no contesta a los
+// sondeos): sale de la sombra. Si se vuelve al valor anterior hay que
+// escribirlo, porque el torno sí cambió
+static void test_unconfirmed_write_forgotten()
+{
+  const uint8_t antes = g_want[20];
+  torno().mute = true;
+  g_want[20] = 55;
+  RS485::ParamSyncResult r = RS485::syncParams(g_want, N, PLAZO_MS);
+  TEST_ASSERT_FALSE(r.ok());
+  TEST_ASSERT_EQUAL_UINT8(0, r.written);
+  TEST_ASSERT_EQUAL_UINT8(1, r.failed);
+  TEST_ASSERT_EQUAL_UINT8(20, r.firstFailed);
+  TEST_ASSERT_EQUAL_UINT8(55, torno().params[20]);
+  TEST_ASSERT_EQUAL_UINT32(1, torno().paramWrites); // se pregunta otra vez, no se repite
+  TEST_ASSERT_TRUE(fakeLogHas("Parámetro 20=55"));
+  uint8_t v = 0;
+  TEST_ASSERT_FALSE(RS485::readParam(20, v));
+
+  torno().mute = false;
+  delay(500);
+  g_bus->clearLog();
+  g_want[20] = antes;
+  r = RS485::syncParams(g_want, N, PLAZO_MS);
+  TEST_ASSERT_TRUE(r.ok());
+  TEST_ASSERT_EQUAL_UINT8(1, r.changed);
+  TEST_ASSERT_TRUE(menusEnCable(0x96) == std::vector<uint8_t>({20}));
+  TEST_ASSERT_EQUAL_UINT8(antes, torno().params[20]);
+}
+
+// Plazo agotado a mitad: lo que no terminó, escritura o lectura de vuelta,
+// cuenta como fallido y se olvida; la siguiente sincronización escribe
+// exactamente eso (el motor acabó lo pendiente por su cuenta)
+static void test_timeout_forgets_unfinished()
+{
+  for (uint8_t i = 0; i < N; i++)
+    g_want[i] = (uint8_t)(g_want[i] + 1);
+  RS485::ParamSyncResult r = RS485::syncParams(g_want, N, 60);
+  TEST_ASSERT_FALSE(r.ok());
+  TEST_ASSERT_EQUAL_UINT8(N, r.changed);
+  TEST_ASSERT_TRUE(r.written > 0);
+  TEST_ASSERT_TRUE(r.written < N);
+  TEST_ASSERT_EQUAL_UINT8(N - r.verified, r.failed);
+  TEST_ASSERT_TRUE(r.firstFailed < N);
+  const uint8_t olvidados = r.failed;
+  TEST_ASSERT_EQUAL_UINT32(0, g_malConfirmados);
+  // Confirmados exactamente los leídos de vuelta
+  TEST_ASSERT_EQUAL_INT(r.verified, __builtin_popcountll(RS485::g_paramKnown & ((1ULL << N) - 1)));
+
+  delay(1000); // el motor termina lo que quedó en la cola
+  g_bus->clearLog();
+  r = RS485::syncParams(g_want, N, PLAZO_MS);
+  TEST_ASSERT_TRUE(r.ok());
+  TEST_ASSERT_EQUAL_UINT8(olvidados, r.changed);
+  TEST_ASSERT_EQUAL_UINT32(olvidados, menusEnCable(0x96).size());
+  comprobarTorno(N);
+
+  // Las estadísticas de /rs485_tx recogen las sincronizaciones
+  TEST_ASSERT_TRUE(RS485::txStatsJson().indexOf("\"params\"") >= 0);
+}
+
+int main(int, char **)
+{
+  hostReset(1000000);
+  RS485::begin();
+  UNITY_BEGIN();
+  RUN_TEST(test_all_unknown_written_pipelined);
+  RUN_TEST(test_no_change_no_traffic);
+  RUN_TEST(test_single_change_single_write);
+  RUN_TEST(test_seed_does_not_override_confirmed);
+  RUN_TEST(test_readback_mismatch_rewritten);
+  RUN_TEST(test_unconfirmed_write_forgotten);
+  RUN_TEST(test_timeout_forgets_unfinished);
+  return UNITY_END();
+}
@@ -0,0 +1,246 @@
+// Planificador de transmisión RS485 (RS485.cpp) sobre el UART simulado: las
+// órdenes se encolan sin bloquear, salen en orden FIFO y respetan los tiempos
+// del bus (hueco entre tramas, espera de la respuesta, margen tras recibir)
+// sin que el maestro pise nunca el cable.
+#include <unity.h>
+
+#define FAKE_LOGBUF
+#include "../../support/app_fakes.hpp"
+
+#include "../../../src/definiciones.cpp"
+#include "../../../src/RS485.cpp"
+
+#include "../../support/turnstile_emu.hpp"
+
+static TurnstileBus *g_bus = nullptr;
+
+static const uint64_t CMD_GAP_US = RS485_CMD_GAP_MS * 1000ULL;
+static const uint64_t RESP_WAIT_US = RS485_RESP_WAIT_MS * 1000ULL;
+
+// El estado del motor es estático: cada prueba arranca con el bus en reposo
+void setUp()
+{
+  hostReset(hostNowUs());
+  g_bus = new TurnstileBus();
+  g_bus->attach();
+  delay(500);
+  g_bus->clearLog();
+}
+
+void tearDown()
+{
+  g_bus->detach();
+  delete g_bus;
+  g_bus = nullptr;
+}
+
+static void esperarTodo(uint32_t ms = 500)
+{
+  delay(ms);
+  TEST_ASSERT_EQUAL_UINT8(0, RS485::txStats().depth);
+}
+
+// Encolar no consume tiempo y la primera trama sale en el acto con el bus libre
+static void test_enqueue_never_blocks()
+{
+  const uint64_t t0 = hostNowUs();
+  const RS485::Txn a = RS485::leftOpen(MACHINE_ID, 1);
+  const RS485::Txn b = RS485::closeGate(MACHINE_ID);
+  const RS485::Txn c = RS485::resetLeftCount(MACHINE_ID);
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)(hostNowUs() - t0));
+  TEST_ASSERT_TRUE(a != RS485::TXN_NONE && b != RS485::TXN_NONE && c != RS485::TXN_NONE);
+
+  TEST_ASSERT_EQUAL(1, g_bus->tx.size());
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)(g_bus->tx[0].startUs - t0));
+  TEST_ASSERT_EQUAL_HEX8(0x80, g_bus->tx[0].cmd());
+  TEST_ASSERT_EQUAL_UINT8(3, RS485::txStats().depth);
+  esperarTodo();
+}
+
+// Varias órdenes a la vez: salen en orden, cada una seguida de su consulta
+// de confirmación, y con los huecos del torno entre tramas
+static void test_fifo_order_and_gaps()
+{
+  const uint8_t cmds[] = {0x80, 0x84, 0x82, 0x20, 0x84};
+  RS485::Txn t[5];
+  t[0] = RS485::leftOpen(MACHINE_ID, 1);
+  t[1] = RS485::closeGate(MACHINE_ID);
+  t[2] = RS485::rightOpen(MACHINE_ID, 1);
+  t[3] = RS485::resetLeftCount(MACHINE_ID);
+  t[4] = RS485::closeGate(MACHINE_ID);
+  esperarTodo();
+
+  for (auto x : t)
+    TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, RS485::peek(x));
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->collisions);
+
+  // orden, consulta, orden, consulta...
+  const auto &tx = g_bus->tx;
+  TEST_ASSERT_EQUAL(10, tx.size());
+  for (size_t i = 0; i < 5; i++)
+  {
+    TEST_ASSERT_EQUAL_HEX8(cmds[i], tx[2 * i].cmd());
+    TEST_ASSERT_EQUAL_HEX8(0x10, tx[2 * i + 1].cmd());
+    // la consulta, tras el hueco mínimo desde el fin de la orden
+    TEST_ASSERT_TRUE(tx[2 * i + 1].startUs >= tx[2 * i].endUs + CMD_GAP_US);
+    TEST_ASSERT_TRUE(tx[2 * i + 1].startUs <= tx[2 * i].endUs + CMD_GAP_US + 200);
+  }
+
+  // Cada orden siguiente, en cuanto termina la respuesta (margen de giro) y
+  // con el hueco mínimo desde la orden anterior
+  const auto &rx = g_bus->sent;
+  TEST_ASSERT_EQUAL(5, rx.size());
+  for (size_t i = 1; i < 5; i++)
+  {
+    const uint64_t libre = std::max(rx[i - 1].endUs + RS485_TURNAROUND_US, tx[2 * (i - 1)].endUs + CMD_GAP_US);
+    TEST_ASSERT_TRUE(tx[2 * i].startUs >= libre);
+    TEST_ASSERT_TRUE(tx[2 * i].startUs <= libre + 200);
+  }
+}
+
+// Lo que cuesta una apertura confirmada frente al delay(50) de antes
+static void test_open_latency()
+{
+  const uint64_t t0 = hostNowUs();
+  const RS485::Txn t = RS485::leftOpen(MACHINE_ID, 1);
+  esperarTodo();
+  RS485::TxnResult r;
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, RS485::peek(t, &r));
+  TEST_ASSERT_EQUAL_UINT8(1, r.attempts);
+
+  // orden + hueco + consulta + respuesta del torno
+  const uint64_t esperado = emuWireUs(8) + CMD_GAP_US + emuWireUs(8) +
+                            g_bus->unit(MACHINE_ID).replyDelayUs + emuWireUs(18);
+  TEST_ASSERT_UINT32_WITHIN(300, (uint32_t)esperado, r.latencyUs);
+  TEST_ASSERT_TRUE(r.latencyUs < 50000);
+  TEST_ASSERT_TRUE(g_bus->sent.back().endUs - t0 < 50000);
+  printf("[bench] apertura confirmada en %.1f ms (antes: 50 ms de delay solo para enviar)\n", r.latencyUs / 1000.0);
+}
+
+// Tras una consulta sin respuesta el bus queda reservado RS485_RESP_WAIT_MS
+static void test_query_reserves_bus_until_reply_window()
+{
+  g_bus->unit(MACHINE_ID).mute = true;
+  RS485::Txn q = RS485::queryDeviceStatus(MACHINE_ID);
+  RS485::Txn c = RS485::closeGate(MACHINE_ID);
+  delay(RS485_ACK_TIMEOUT_MS * 2 + 600);
+  g_bus->unit(MACHINE_ID).mute = false;
+  esperarTodo();
+
+  const auto &tx = g_bus->tx;
+  TEST_ASSERT_TRUE(tx.size() >= 2);
+  TEST_ASSERT_EQUAL_HEX8(0x10, tx[0].cmd());
+  // La consulta que no obtuvo respuesta retiene el bus hasta que vence la ventana
+  TEST_ASSERT_TRUE(tx[1].startUs >= tx[0].endUs + RESP_WAIT_US);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_NO_ACK, RS485::peek(q));
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->collisions);
+  (void)c;
+}
+
+// Tráfico del torno a mitad de un hueco: no se transmite encima y se espera
+// el margen de giro desde su último byte
+static void test_no_transmit_over_incoming_frame()
+{
+  RS485::Txn a = RS485::leftOpen(MACHINE_ID, 1);
+  RS485::Txn b = RS485::closeGate(MACHINE_ID);
+  // Trama espontánea que acaba justo antes de que venza el hueco
+  const uint64_t cmdEnd = g_bus->tx[0].endUs;
+  const uint64_t inicio = cmdEnd + CMD_GAP_US - 500 - emuWireUs(18) - hostNowUs();
+  g_bus->spontaneous(MACHINE_ID, inicio);
+  esperarTodo();
+
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->collisions);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, RS485::peek(a));
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, RS485::peek(b));
+
+  // La trama espontánea confirma la apertura: no hace falta consulta y la
+  // siguiente orden sale tras el margen de giro
+  const auto &tx = g_bus->tx;
+  TEST_ASSERT_EQUAL_HEX8(0x84, tx[1].cmd());
+  const uint64_t rxEnd = g_bus->sent[0].endUs;
+  TEST_ASSERT_TRUE(tx[1].startUs >= rxEnd + RS485_TURNAROUND_US);
+  TEST_ASSERT_TRUE(tx[1].startUs <= rxEnd + RS485_TURNAROUND_US + 200);
+}
+
+// Consultas de estado repetidas en cola se fusionan en una sola trama
+static void test_status_queries_coalesce()
+{
+  const uint32_t fusionadas = RS485::txStats().coalesced;
+  RS485::Txn a = RS485::closeGate(MACHINE_ID);
+  RS485::Txn q1 = RS485::queryDeviceStatus(MACHINE_ID);
+  RS485::Txn q2 = RS485::queryDeviceStatus(MACHINE_ID);
+  RS485::Txn q3 = RS485::queryDeviceStatus(MACHINE_ID);
+  TEST_ASSERT_TRUE(q1 == q2 && q2 == q3);
+  esperarTodo();
+  TEST_ASSERT_EQUAL_UINT32(fusionadas + 2, RS485::txStats().coalesced);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, RS485::peek(a));
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, RS485::peek(q1));
+  // cierre + su consulta + la consulta pedida
+  TEST_ASSERT_EQUAL(3, g_bus->tx.size());
+}
+
+// Cola llena: lo que no cabe se rechaza en el acto y se cuenta
+static void test_full_queue_rejects()
+{
+  const uint32_t descartadas = RS485::txStats().dropped;
+  uint32_t aceptadas = 0, rechazadas = 0;
+  for (int i = 0; i < RS485_TXQ_LEN + 3; i++)
+  {
+    if (RS485::resetLeftCount(MACHINE_ID) != RS485::TXN_NONE)
+      aceptadas++;
+    else
+      rechazadas++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(RS485_TXQ_LEN, aceptadas);
+  TEST_ASSERT_EQUAL_UINT32(3, rechazadas);
+  TEST_ASSERT_EQUAL_UINT32(descartadas + 3, RS485::txStats().dropped);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_REJECTED, RS485::peek(RS485::TXN_NONE));
+  esperarTodo(1500);
+  TEST_ASSERT_EQUAL_UINT32(RS485_TXQ_LEN, g_bus->sentCmd(0x20).size());
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->collisions);
+}
+
+// Órdenes desde otra "tarea" mientras la cola se vacía (el temporizador
+// es quien transmite): siguen en orden y sin colisiones
+static void test_enqueue_while_draining()
+{
+  const uint32_t descartadas = RS485::txStats().dropped;
+  std::vector<uint8_t> pedido;
+  for (int i = 0; i < 30; i++)
+  {
+    const uint8_t m = (i % 3 == 0) ? 0x80 : (i % 3 == 1) ? 0x84 : 0x21;
+    if (m == 0x80)
+      RS485::leftOpen(MACHINE_ID, 1);
+    else if (m == 0x84)
+      RS485::closeGate(MACHINE_ID);
+    else
+      RS485::resetRightCount(MACHINE_ID);
+    pedido.push_back(m);
+    delay(20 + (i * 13) % 37); // a veces antes de que termine la anterior
+  }
+  esperarTodo(3000);
+
+  std::vector<uint8_t> visto;
+  for (auto &t : g_bus->tx)
+    if (t.cmd() != 0x10)
+      visto.push_back(t.cmd());
+  TEST_ASSERT_EQUAL_UINT32(descartadas, RS485::txStats().dropped);
+  TEST_ASSERT_TRUE(visto == pedido);
+  TEST_ASSERT_EQUAL_UINT32(0, g_bus->collisions);
+}
+
+int main(int, char **)
+{
+  hostReset(1000000);
+  RS485::begin();
+  UNITY_BEGIN();
+  RUN_TEST(test_enqueue_never_blocks);
+  RUN_TEST(test_fifo_order_and_gaps);
+  RUN_TEST(test_open_latency);
+  RUN_TEST(test_query_reserves_bus_until_reply_window);
+  RUN_TEST(test_no_transmit_over_incoming_frame);
+  RUN_TEST(test_status_queries_coalesce);
+  RUN_TEST(test_full_queue_rejects);
+  RUN_TEST(test_enqueue_while_draining);
+  return UNITY_END();
+}
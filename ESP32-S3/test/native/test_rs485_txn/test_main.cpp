@@ -0,0 +1,310 @@
+// Transacciones RS485 (RS485.cpp) contra el torno guionizado: cada orden se
+// confirma con una trama de estado de su máquina que la refleja, lo perdido
+// se vuelve a preguntar sin repetir la orden, lo no ejecutado se repite, y
+// los Txn antiguos no se confunden con los nuevos al reciclar huecos.
+//
+// Con la configuración por defecto: eco en commandExecStatus (o cambio de
+// puerta) y lectura de parámetros real (RS485_CMD_PARAM_READ).
+#include <unity.h>
+
+#define FAKE_LOGBUF
+#include "../../support/app_fakes.hpp"
+
+#include "../../../src/definiciones.cpp"
+#include "../../../src/RS485.cpp"
+
+#include "../../support/turnstile_emu.hpp"
+
+#include <set>
+
+static TurnstileBus *g_bus = nullptr;
+
+static EmuTurnstile &torno()
+{
+  return g_bus->unit(MACHINE_ID);
+}
+
+void setUp()
+{
+  hostReset(hostNowUs());
+  g_bus = new TurnstileBus();
+  g_bus->attach();
+  // El torno nuevo parte con la puerta cerrada: que el estado publicado lo refleje
+  RS485::wait(RS485::queryDeviceStatus(MACHINE_ID), 200);
+  delay(500);
+  g_bus->clearLog();
+}
+
+void tearDown()
+{
+  g_bus->detach();
+  delete g_bus;
+  g_bus = nullptr;
+}
+
+static RS485::TxnResult resultado(RS485::Txn t, uint32_t ms = 1000)
+{
+  delay(ms);
+  RS485::TxnResult r;
+  RS485::peek(t, &r);
+  return r;
+}
+
+static std::vector<uint8_t> ordenesEnCable()
+{
+  std::vector<uint8_t> v;
+  for (auto &t : g_bus->tx)
+    v.push_back(t.cmd());
+  return v;
+}
+
+static void test_normal()
+{
+  const RS485::Txn t = RS485::leftOpen(MACHINE_ID, 1);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_PENDING, RS485::peek(t));
+  const RS485::TxnResult r = resultado(t);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, r.status);
+  TEST_ASSERT_EQUAL_UINT8(1, r.attempts);
+  TEST_ASSERT_EQUAL_HEX8(0x80, r.cmd);
+  TEST_ASSERT_TRUE(r.frame.valid);
+  TEST_ASSERT_EQUAL_UINT8(MACHINE_ID, r.frame.machine);
+  TEST_ASSERT_EQUAL_HEX8(0x80, r.frame.cmdExec);
+  TEST_ASSERT_EQUAL_UINT32(1, r.frame.leftCount);
+  TEST_ASSERT_EQUAL_UINT32(1, torno().opens);
+  TEST_ASSERT_TRUE(ordenesEnCable() == std::vector<uint8_t>({0x80, 0x10}));
+}
+
+// wait() atiende el bus mientras espera y devuelve el resultado tipado
+static void test_wait()
+{
+  const uint64_t t0 = hostNowUs();
+  const RS485::TxnResult r = RS485::wait(RS485::closeGate(MACHINE_ID), 500);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, r.status);
+  TEST_ASSERT_TRUE(hostNowUs() - t0 < 50000);
+
+  // Con un plazo corto vuelve pendiente y el motor la termina solo
+  g_bus->clearLog();
+  const RS485::Txn t = RS485::closeGate(MACHINE_ID);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_PENDING, RS485::wait(t, 5).status);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, resultado(t).status);
+}
+
+// Respuesta perdida: se vuelve a preguntar (no se repite la apertura), tras
+// la espera de confirmación y el primer escalón de espera
+static void test_lost_reply_probes_again()
+{
+  torno().dropReplies = 1;
+  const RS485::Txn t = RS485::leftOpen(MACHINE_ID, 1);
+  const RS485::TxnResult r = resultado(t);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, r.status);
+  TEST_ASSERT_EQUAL_UINT8(2, r.attempts);
+  TEST_ASSERT_EQUAL_UINT32(1, torno().opens);
+  TEST_ASSERT_TRUE(ordenesEnCable() == std::vector<uint8_t>({0x80, 0x10, 0x10}));
+
+  const auto &tx = g_bus->tx;
+  const uint64_t minimo = tx[1].endUs + RS485_ACK_TIMEOUT_MS * 1000ULL + RS485_RETRY_BASE_MS * 1000ULL;
+  TEST_ASSERT_TRUE(tx[2].startUs >= minimo);
+  TEST_ASSERT_TRUE(tx[2].startUs <= minimo + 300);
+}
+
+// Trama con el checksum roto: no cuenta como respuesta
+static void test_corrupted_reply_is_retried()
+{
+  torno().corruptReplies = 1;
+  const RS485::TxnResult r = resultado(RS485::closeGate(MACHINE_ID));
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, r.status);
+  TEST_ASSERT_EQUAL_UINT8(2, r.attempts);
+  TEST_ASSERT_EQUAL_UINT32(1, torno().closes);
+}
+
+// Torno mudo: RS485_MAX_ATTEMPTS consultas con espera creciente y NO_ACK;
+// la orden sale una sola vez
+static void test_mute_device()
+{
+  torno().mute = true;
+  const uint32_t fallos = RS485::txStats().failed;
+  const RS485::TxnResult r = resultado(RS485::leftOpen(MACHINE_ID, 1));
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_NO_ACK, r.status);
+  TEST_ASSERT_EQUAL_UINT8(RS485_MAX_ATTEMPTS, r.attempts);
+  TEST_ASSERT_EQUAL(1, g_bus->sentCmd(0x80).size());
+  TEST_ASSERT_EQUAL(RS485_MAX_ATTEMPTS, g_bus->sentCmd(0x10).size());
+  TEST_ASSERT_EQUAL_UINT32(fallos + 1, RS485::txStats().failed);
+  TEST_ASSERT_TRUE(fakeLogHas("Orden 0x80 sin confirmar"));
+
+  // Espera creciente entre consultas, con tope
+  const auto q = g_bus->sentCmd(0x10);
+  for (size_t i = 1; i < q.size(); i++)
+  {
+    uint32_t backoff = (uint32_t)RS485_RETRY_BASE_MS << (i - 1);
+    if (backoff > RS485_RETRY_MAX_MS)
+      backoff = RS485_RETRY_MAX_MS;
+    const uint64_t minimo = q[i - 1].endUs + (RS485_ACK_TIMEOUT_MS + backoff) * 1000ULL;
+    TEST_ASSERT_TRUE(q[i].startUs >= minimo);
+    TEST_ASSERT_TRUE(q[i].startUs <= minimo + 300);
+  }
+}
+
+// Contesta otro torno: no confirma la orden de este
+static void test_wrong_machine_id()
+{
+  torno().replyAs = MACHINE_ID + 1;
+  const RS485::TxnResult r = resultado(RS485::closeGate(MACHINE_ID));
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_NO_ACK, r.status);
+  TEST_ASSERT_EQUAL_UINT32(1, torno().closes);
+}
+
+// Responde pero no la ejecutó (commandExecStatus distinto): se repite la orden
+static void test_not_executed_resends_command()
+{
+  torno().ignoreCmds = 1;
+  const RS485::TxnResult r = resultado(RS485::leftOpen(MACHINE_ID, 1));
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, r.status);
+  TEST_ASSERT_EQUAL_UINT8(2, r.attempts);
+  TEST_ASSERT_EQUAL_UINT32(1, torno().opens);
+  TEST_ASSERT_TRUE(ordenesEnCable() == std::vector<uint8_t>({0x80, 0x10, 0x80, 0x10}));
+
+  // Nunca la ejecuta: NOT_EXECUTED (distinto de no responder)
+  g_bus->clearLog();
+  torno().ignoreCmds = 100;
+  const RS485::TxnResult n = resultado(RS485::closeGate(MACHINE_ID));
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_NOT_EXECUTED, n.status);
+  TEST_ASSERT_EQUAL(RS485_MAX_ATTEMPTS, g_bus->sentCmd(0x84).size());
+  torno().ignoreCmds = 0;
+}
+
+// Las tramas espontáneas del torno no confirman una orden que no ejecutó:
+// la perdida se repite en vez de darse por buena
+static void test_spontaneous_frame_does_not_confirm_lost_command()
+{
+  torno().ignoreCmds = 1; // como si la orden llegara rota
+  const RS485::Txn t = RS485::leftOpen(MACHINE_ID, 1);
+  g_bus->spontaneous(MACHINE_ID, 2000); // antes de la consulta
+  const RS485::TxnResult r = resultado(t);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, r.status);
+  TEST_ASSERT_EQUAL_UINT8(2, r.attempts);
+  TEST_ASSERT_EQUAL_HEX8(0x80, r.frame.cmdExec);
+  TEST_ASSERT_EQUAL_UINT32(1, torno().opens);
+  TEST_ASSERT_TRUE(ordenesEnCable() == std::vector<uint8_t>({0x80, 0x10, 0x80, 0x10}));
+
+  // Perdida del todo y el torno solo manda tramas por su cuenta: no se confirma
+  g_bus->clearLog();
+  torno().ignoreCmds = 100;
+  const RS485::Txn n = RS485::closeGate(MACHINE_ID);
+  for (int i = 0; i < 10; i++)
+    g_bus->spontaneous(MACHINE_ID, 5000 + i * 30000);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_NOT_EXECUTED, resultado(n).status);
+  TEST_ASSERT_EQUAL_UINT32(0, torno().closes);
+  torno().ignoreCmds = 0;
+}
+
+// Firmware sin eco: las órdenes de puerta se confirman por el cambio de
+// puerta; si no cambia, se repite la orden
+static void test_gate_change_confirms_without_echo()
+{
+  torno().noEcho = true;
+  TEST_ASSERT_EQUAL_UINT8(0, RS485::getStatus(MACHINE_ID).gate);
+  RS485::TxnResult r = resultado(RS485::leftOpen(MACHINE_ID, 1));
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, r.status);
+  TEST_ASSERT_EQUAL_UINT8(1, r.attempts);
+  TEST_ASSERT_EQUAL_UINT8(1, r.frame.gate);
+  TEST_ASSERT_EQUAL_UINT8(0, r.frame.cmdExec);
+
+  torno().ignoreCmds = 1;
+  g_bus->clearLog();
+  r = resultado(RS485::closeGate(MACHINE_ID));
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, r.status);
+  TEST_ASSERT_EQUAL_UINT8(2, r.attempts);
+  TEST_ASSERT_EQUAL_UINT8(0, r.frame.gate);
+  TEST_ASSERT_EQUAL_UINT32(1, torno().closes);
+  TEST_ASSERT_TRUE(ordenesEnCable() == std::vector<uint8_t>({0x84, 0x10, 0x84, 0x10}));
+  torno().noEcho = false;
+}
+
+// Varias a la vez: cada resultado es el de su orden y terminan en orden
+static void test_results_follow_submission_order()
+{
+  torno().dropReplies = 1; // la primera necesita un reintento
+  RS485::Txn t[4];
+  t[0] = RS485::leftOpen(MACHINE_ID, 1);
+  t[1] = RS485::closeGate(MACHINE_ID);
+  t[2] = RS485::rightOpen(MACHINE_ID, 1);
+  t[3] = RS485::closeGate(MACHINE_ID);
+  const uint8_t cmd[4] = {0x80, 0x84, 0x82, 0x84};
+  delay(1000);
+
+  uint32_t lat = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    RS485::TxnResult r;
+    TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, RS485::peek(t[i], &r));
+    TEST_ASSERT_EQUAL_HEX8(cmd[i], r.cmd);
+    TEST_ASSERT_EQUAL_HEX8(cmd[i], r.frame.cmdExec);
+    TEST_ASSERT_TRUE(r.latencyUs > lat);
+    lat = r.latencyUs;
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, torno().opens);
+  TEST_ASSERT_EQUAL_UINT32(2, torno().closes);
+}
+
+// Parámetros: escritura confirmada y lectura de vuelta del propio torno
+static void test_param_write_and_read_back()
+{
+  TEST_ASSERT_TRUE(RS485::setParam(MACHINE_ID, 5, 42));
+  TEST_ASSERT_EQUAL_UINT8(42, torno().params[5]);
+  uint8_t v = 0;
+  TEST_ASSERT_TRUE(RS485::readParam(5, v));
+  TEST_ASSERT_EQUAL_UINT8(42, v);
+  TEST_ASSERT_EQUAL_UINT32(1, torno().paramReads);
+
+  // Lo que hay en el torno, no lo último escrito
+  torno().params[6] = 17;
+  TEST_ASSERT_TRUE(RS485::readParam(6, v));
+  TEST_ASSERT_EQUAL_UINT8(17, v);
+
+  torno().mute = true;
+  TEST_ASSERT_FALSE(RS485::setParam(MACHINE_ID, 7, 1));
+  TEST_ASSERT_FALSE(RS485::readParam(7, v));
+  torno().mute = false;
+}
+
+// Un Txn de un hueco reciclado no devuelve el resultado de otra orden, por
+// muchas veces que se reutilice el hueco
+static void test_stale_handle_across_generation_wrap()
+{
+  torno().mute = true;
+  const RS485::Txn viejo = RS485::closeGate(MACHINE_ID);
+  delay(1000);
+  TEST_ASSERT_EQUAL_UINT8(RS485::TXN_NO_ACK, RS485::peek(viejo));
+  torno().mute = false;
+
+  std::set<RS485::Txn> vistos = {viejo};
+  for (int i = 0; i < 40 * RS485_TXQ_LEN; i++)
+  {
+    const RS485::Txn t = RS485::resetLeftCount(MACHINE_ID);
+    TEST_ASSERT_TRUE(t != RS485::TXN_NONE);
+    TEST_ASSERT_TRUE(vistos.insert(t).second); // ningún Txn se repite
+    TEST_ASSERT_EQUAL_UINT8(RS485::TXN_OK, resultado(t, 60).status);
+    if (i >= RS485_TXQ_LEN) // su hueco ya se ha reutilizado
+      TEST_ASSERT_EQUAL_UINT8(RS485::TXN_UNKNOWN, RS485::peek(viejo));
+  }
+}
+
+int main(int, char **)
+{
+  hostReset(1000000);
+  RS485::begin();
+  UNITY_BEGIN();
+  RUN_TEST(test_normal);
+  RUN_TEST(test_wait);
+  RUN_TEST(test_lost_reply_probes_again);
+  RUN_TEST(test_corrupted_reply_is_retried);
+  RUN_TEST(test_mute_device);
+  RUN_TEST(test_wrong_machine_id);
+  RUN_TEST(test_not_executed_resends_command);
+  RUN_TEST(test_spontaneous_frame_does_not_confirm_lost_command);
+  RUN_TEST(test_gate_change_confirms_without_echo);
+  RUN_TEST(test_results_follow_submission_order);
+  RUN_TEST(test_param_write_and_read_back);
+  RUN_TEST(test_stale_handle_across_generation_wrap);
+  return UNITY_END();
+}
@@ -0,0 +1,149 @@
+// Caché de lecturas repetidas (scan_cache.cpp) con el reloj simulado: ventanas
+// por resultado, rechazos que se alargan mientras el QR sigue delante y
+// autorizaciones que no, y el olvido cuando el ciclo acaba sin paso.
+#include <unity.h>
+
+#include <Arduino.h>
+
+#include "../../../src/scan_cache.cpp"
+
+static const char *QR = "3123508120006123513";
+static const uint32_t PASO_MS = 8000; // PASO_TIMEOUT de definiciones.hpp
+
+void setUp()
+{
+  scanCacheClear();
+}
+
+void tearDown() {}
+
+static bool repetida(uint32_t key)
+{
+  uint8_t outcome = VNONE;
+  return scanCacheLookup(key, outcome);
+}
+
+// El QR se queda delante del lector leyéndose cada 'cadaMs' durante 'durMs':
+// devuelve el momento (ms desde el inicio) de la primera lectura que no se
+// resuelve en local, o 0 si todas se resolvieron
+static uint32_t mantenerDelante(uint32_t key, uint32_t cadaMs, uint32_t durMs)
+{
+  for (uint32_t t = cadaMs; t <= durMs; t += cadaMs)
+  {
+    delay(cadaMs);
+    if (!repetida(key))
+      return t;
+  }
+  return 0;
+}
+
+static void test_keys()
+{
+  const uint32_t in = scanCacheKey(QR, 1);
+  TEST_ASSERT_TRUE(in != 0);
+  TEST_ASSERT_TRUE(in != scanCacheKey(QR, 2));
+  TEST_ASSERT_EQUAL_UINT32(in, scanCacheKey(QR, 1));
+  TEST_ASSERT_TRUE(in != scanCacheKey("3123508120006123514", 1));
+}
+
+// Autorizado: la ventana cuenta desde la decisión aunque el QR siga delante
+static void test_authorized_window_not_renewed()
+{
+  const uint32_t key = scanCacheKey(QR, 1);
+  scanCacheStore(key, VAUTH_IN);
+  uint8_t outcome = VNONE;
+  TEST_ASSERT_TRUE(scanCacheLookup(key, outcome));
+  TEST_ASSERT_EQUAL_UINT8(VAUTH_IN, outcome);
+
+  const uint32_t t = mantenerDelante(key, 200, 3 * SCAN_DEDUP_MS);
+  TEST_ASSERT_UINT32_WITHIN(200, SCAN_DEDUP_MS, t);
+}
+
+// Rechazado: cada repetición alarga la ventana (no se vuelve a preguntar)
+static void test_rejected_window_renewed()
+{
+  const uint32_t key = scanCacheKey(QR, 1);
+  scanCacheStore(key, VDENIED);
+  TEST_ASSERT_EQUAL_UINT32(0, mantenerDelante(key, 1000, 3 * SCAN_REJECT_MS));
+  const ScanCacheStats st = scanCacheStats();
+  TEST_ASSERT_TRUE(st.rejects >= 3 * SCAN_REJECT_MS / 1000);
+
+  // Retirado del lector más de la ventana: se valida otra vez
+  delay(SCAN_REJECT_MS + 1);
+  TEST_ASSERT_FALSE(repetida(key));
+}
+
+static void test_not_yet_and_errors()
+{
+  const uint32_t key = scanCacheKey(QR, 2);
+  scanCacheStore(key, VTIME_NOT_YET);
+  delay(SCAN_NOT_YET_MS - 100);
+  TEST_ASSERT_TRUE(repetida(key));
+  delay(SCAN_NOT_YET_MS + 1);
+  TEST_ASSERT_FALSE(repetida(key));
+
+  // Errores y plazos vencidos no se guardan
+  scanCacheStore(key, VERROR);
+  TEST_ASSERT_FALSE(repetida(key));
+  scanCacheStore(key, VNONE);
+  TEST_ASSERT_FALSE(repetida(key));
+  scanCacheStore(0, VDENIED);
+  TEST_ASSERT_FALSE(repetida(0));
+}
+
+// Visitante autorizado que no pasa antes de PASO_TIMEOUT y sigue con el QR
+// delante: al acabar el ciclo en CMD_PASS_TIMEOUT la autorización se olvida
+// y la siguiente lectura va a validación
+static void test_forget_after_pass_timeout()
+{
+  const uint32_t key = scanCacheKey(QR, 1);
+  scanCacheStore(key, VAUTH_IN);
+  TEST_ASSERT_EQUAL_UINT32(0, mantenerDelante(key, 250, PASO_MS));
+  scanCacheForget(key); // lo que hace taskIO con CMD_PASS_TIMEOUT
+  TEST_ASSERT_FALSE(repetida(key));
+
+  // Se autoriza de nuevo y esta vez pasa: las repeticiones ya no se validan
+  scanCacheStore(key, VAUTH_IN);
+  delay(250);
+  TEST_ASSERT_TRUE(repetida(key));
+
+  // Olvidar algo que no está (o la clave 0 del portal) no toca lo demás
+  scanCacheForget(0);
+  scanCacheForget(scanCacheKey(QR, 2));
+  TEST_ASSERT_TRUE(repetida(key));
+}
+
+// Tabla llena: se reemplaza la entrada vista hace más tiempo
+static void test_evicts_oldest()
+{
+  char code[24];
+  uint32_t keys[SCAN_CACHE_LEN + 1];
+  for (uint32_t i = 0; i <= SCAN_CACHE_LEN; i++)
+  {
+    snprintf(code, sizeof(code), "31235081200061%05u", (unsigned)i);
+    keys[i] = scanCacheKey(code, 1);
+    if (i < SCAN_CACHE_LEN)
+      scanCacheStore(keys[i], VDENIED);
+    delay(10);
+  }
+  TEST_ASSERT_TRUE(repetida(keys[0])); // se renueva: la más antigua pasa a ser la 1
+  scanCacheStore(keys[SCAN_CACHE_LEN], VDENIED);
+  TEST_ASSERT_TRUE(repetida(keys[SCAN_CACHE_LEN]));
+  TEST_ASSERT_TRUE(repetida(keys[0]));
+  TEST_ASSERT_FALSE(repetida(keys[1]));
+  for (uint32_t i = 2; i < SCAN_CACHE_LEN; i++)
+    TEST_ASSERT_TRUE(repetida(keys[i]));
+}
+
+int main(int, char **)
+{
+  hostReset(1000000);
+  UNITY_BEGIN();
+  RUN_TEST(test_keys);
+  RUN_TEST(test_authorized_window_not_renewed);
+  RUN_TEST(test_rejected_window_renewed);
+  RUN_TEST(test_not_yet_and_errors);
+  RUN_TEST(test_forget_after_pass_timeout);
+  RUN_TEST(test_evicts_oldest);
+  return UNITY_END();
+}
@@ -0,0 +1,341 @@
+// Índice local de entradas de ticket.cpp: descarga de /entries por trozos
+// desde el backend simulado, búsqueda (hash FNV-1a 64 + búsqueda binaria) en
+// PSRAM o sobre el fichero de LittleFS, marcas de consumo, y medida de
+// latencia por consulta y memoria por entrada según el tamaño del índice.
+#include <unity.h>
+
+#define FAKE_JSON
+#define FAKE_FW_UPDATE
+#define FAKE_LOGBUF
+#define FAKE_TIME
+#include "../../support/app_fakes.hpp"
+#include "../../support/host_http.hpp"
+#include "../../support/bench.hpp"
+
+#include "../../../src/definiciones.cpp"
+#include "../../../src/http_parser.cpp"
+#include "../../../src/ota_delta.cpp"
+#include "../../../src/http.cpp"
+#include "../../../src/ticket.cpp"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+static HostHttpServer *srv;
+
+// Código de 19 cifras distinto para cada i
+static std::string codigo(uint32_t i)
+{
+  char c[24];
+  snprintf(c, sizeof(c), "%019llu", 1000000000000000000ULL + (unsigned long long)i * 7919ULL);
+  return c;
+}
+
+static std::string lista(uint32_t n, uint16_t minuto = 9 * 60)
+{
+  std::string s = "OK\n";
+  s.reserve(n * 28);
+  char t[40];
+  for (uint32_t i = 0; i < n; i++)
+  {
+    snprintf(t, sizeof(t), "%s:%02u:%02u;\n", codigo(i).c_str(), minuto / 60, minuto % 60);
+    s += t;
+  }
+  return s;
+}
+
+// Pide /entries y da vueltas a httpPoll() hasta que termina
+static bool descargar(const std::string &cuerpo)
+{
+  HostHttpReply r;
+  r.body = cuerpo;
+  r.contentType = "text/plain";
+  srv->script.push_back(r);
+  if (!ticketsDescargar())
+    return false;
+  for (int i = 0; i < 100000 && ticketsDescargando(); i++)
+  {
+    httpPoll();
+    delay(1);
+  }
+  return !ticketsDescargando() && ticketsDisponibles();
+}
+
+static size_t heapEnUso()
+{
+#ifdef __GLIBC__
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+void setUp()
+{
+  hostReset(1000000);
+  hostNetReset();
+  hostFsReset();
+  g_hostFs.capacity = 4 * 1024 * 1024;
+  g_hostPsram = false;
+  g_hostLargestFree = 110 * 1024;
+  g_fakeTime = FakeTime();
+  g_fakeLog.clear();
+  debugSerie = 0;
+  conexionRed = 1;
+  Ethernet.hostIP = IPAddress(192, 168, 1, 20);
+  serverURL = "http://10.0.0.5:8084/api";
+  srv = new HostHttpServer(8084);
+}
+
+void tearDown()
+{
+  liberarIndice();
+  g_stats = {};
+  httpPoolReset();
+  delete srv;
+}
+
+static void test_lookup_results()
+{
+  g_hostPsram = true;
+  TEST_ASSERT_TRUE(descargar("OK\n"
+                             "1111111111111111111:09:15;\n"
+                             "2222222222222222222:10:00;\r\n"
+                             "123456:08:00;\n"
+                             "0123abcd-0123-4567-89ab-0123456789ab:00:00;\n"
+                             "mal:08:00;\n"
+                             "3333333333333333333:25:00;\n"
+                             "4444444444444444444:08:00;")); // última línea sin '\n'
+  TicketsStats s = ticketsStats();
+  TEST_ASSERT_EQUAL_UINT32(5, s.count);
+  TEST_ASSERT_EQUAL_UINT32(2, s.dropped); // "mal" y la hora 25
+  TEST_ASSERT_TRUE(s.inPsram);
+  TEST_ASSERT_EQUAL_STRING("/api/entries", srv->requests[0].path.c_str());
+
+  g_fakeTime.valid = true;
+  g_fakeTime.secOfDay = 9 * 3600; // 09:00, margen de 20 min
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("1111111111111111111"));
+  TEST_ASSERT_EQUAL(TICKET_YA_USADO, verificarTicket("1111111111111111111"));
+  TEST_ASSERT_EQUAL(TICKET_AUN_NO, verificarTicket("2222222222222222222"));
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("123456"));
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("0123abcd-0123-4567-89ab-0123456789ab"));
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("4444444444444444444"));
+  TEST_ASSERT_EQUAL(TICKET_NO_EXISTE, verificarTicket("3333333333333333333"));
+  TEST_ASSERT_EQUAL(TICKET_NO_EXISTE, verificarTicket("111111111111111111"));
+
+  // Sin hora válida no se comprueba la franja
+  g_fakeTime.valid = false;
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("2222222222222222222"));
+
+  s = ticketsStats();
+  TEST_ASSERT_EQUAL_UINT32(9, s.lookups);
+  TEST_ASSERT_EQUAL_UINT32(7, s.hits);
+  TEST_ASSERT_EQUAL_UINT32(5, s.consumed);
+}
+
+static void test_duplicate_keeps_earliest_slot()
+{
+  g_hostPsram = true;
+  TEST_ASSERT_TRUE(descargar("OK\n"
+                             "5555555555555555555:12:00;\n"
+                             "5555555555555555555:09:10;\n"
+                             "5555555555555555555:11:00;\n"));
+  TEST_ASSERT_EQUAL_UINT32(1, ticketsStats().count);
+  g_fakeTime.valid = true;
+  g_fakeTime.secOfDay = 9 * 3600;
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("5555555555555555555"));
+}
+
+// Entradas de grupo: los pasos viajan en la línea (v2 con ";<pasos>" o v1
+// "<code>:<pasos>:HH:MM:SS") y se conservan en el índice guardado
+static void test_group_tickets_keep_pasos()
+{
+  TEST_ASSERT_TRUE(descargar("OK\n"
+                             "6666666666666666666:09:00;4\n"
+                             "7777777777777777777:5:08:30:00\n"
+                             "8888888888888888888:09:00;\n"
+                             "9999999999999999999:09:00;900\n"
+                             "1212121212121212121:09:00;3\n"
+                             "1212121212121212121:09:30;6\n"));
+  TEST_ASSERT_EQUAL_UINT32(5, ticketsStats().count);
+  TEST_ASSERT_EQUAL_UINT32(0, ticketsStats().dropped);
+  TEST_ASSERT_FALSE(ticketsStats().inPsram);
+
+  uint8_t pasos = 0;
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("6666666666666666666", &pasos));
+  TEST_ASSERT_EQUAL_UINT8(4, pasos);
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("7777777777777777777", &pasos));
+  TEST_ASSERT_EQUAL_UINT8(5, pasos);
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("8888888888888888888", &pasos));
+  TEST_ASSERT_EQUAL_UINT8(1, pasos);
+
+  // Tras reiniciar (índice leído de LittleFS a PSRAM) siguen ahí
+  g_hostPsram = true;
+  TEST_ASSERT_TRUE(ticketsBegin());
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("9999999999999999999", &pasos));
+  TEST_ASSERT_EQUAL_UINT8(255, pasos);
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket("1212121212121212121", &pasos));
+  TEST_ASSERT_EQUAL_UINT8(6, pasos); // duplicado: la franja antes y los pasos mayores
+}
+
+// Mismo resultado con el índice en PSRAM que buscando en el fichero
+static void test_littlefs_index_matches_psram()
+{
+  const uint32_t n = 3000;
+  TEST_ASSERT_TRUE(descargar(lista(n)));
+  TEST_ASSERT_FALSE(ticketsStats().inPsram);
+  TEST_ASSERT_EQUAL_UINT32(n, ticketsStats().count);
+  for (uint32_t i = 0; i < n; i += 7)
+    TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket(codigo(i).c_str()));
+  delay(TICKETS_USED_FLUSH_MS);
+  ticketsLoop();
+
+  g_hostPsram = true;
+  TEST_ASSERT_TRUE(ticketsBegin());
+  TEST_ASSERT_TRUE(ticketsStats().inPsram);
+  for (uint32_t i = 0; i < n; i++)
+    TEST_ASSERT_EQUAL(i % 7 ? TICKET_OK : TICKET_YA_USADO, verificarTicket(codigo(i).c_str()));
+  TEST_ASSERT_EQUAL(TICKET_NO_EXISTE, verificarTicket(codigo(n).c_str()));
+}
+
+// Las marcas se guardan en diferido, sobreviven al reinicio y a una nueva descarga
+static void test_consumed_marks_survive_reload_and_refresh()
+{
+  g_hostPsram = true;
+  TEST_ASSERT_TRUE(descargar(lista(100)));
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket(codigo(10).c_str()));
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket(codigo(20).c_str()));
+
+  ticketsLoop();
+  TEST_ASSERT_TRUE(g_usedDirty); // aún dentro de la ventana de agrupado
+  delay(TICKETS_USED_FLUSH_MS);
+  ticketsLoop();
+  TEST_ASSERT_FALSE(g_usedDirty);
+
+  TEST_ASSERT_TRUE(ticketsBegin());
+  TEST_ASSERT_EQUAL_UINT32(2, ticketsStats().consumed);
+  TEST_ASSERT_EQUAL(TICKET_YA_USADO, verificarTicket(codigo(10).c_str()));
+
+  // La lista nueva ya no trae la 20 y añade otras: la 10 sigue consumida
+  std::string nueva = "OK\n";
+  for (uint32_t i = 0; i < 150; i++)
+    if (i != 20)
+      nueva += codigo(i) + ":09:00;\n";
+  TEST_ASSERT_TRUE(descargar(nueva));
+  TEST_ASSERT_EQUAL_UINT32(149, ticketsStats().count);
+  TEST_ASSERT_EQUAL_UINT32(1, ticketsStats().consumed);
+  TEST_ASSERT_EQUAL(TICKET_YA_USADO, verificarTicket(codigo(10).c_str()));
+  TEST_ASSERT_EQUAL(TICKET_NO_EXISTE, verificarTicket(codigo(20).c_str()));
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket(codigo(120).c_str()));
+}
+
+static void test_torn_index_is_ignored()
+{
+  TEST_ASSERT_TRUE(descargar(lista(50)));
+  liberarIndice();
+  hostFsTruncate(TICKETS_IDX_PATH, sizeof(TicketIdxHeader) + 25 * sizeof(TicketRec) + 3);
+  TEST_ASSERT_FALSE(ticketsBegin());
+  TEST_ASSERT_FALSE(ticketsDisponibles());
+  TEST_ASSERT_EQUAL(TICKET_NO_EXISTE, verificarTicket(codigo(1).c_str()));
+}
+
+static void test_failed_download_keeps_previous_index()
+{
+  TEST_ASSERT_TRUE(descargar(lista(20)));
+  HostHttpReply r;
+  r.status = 500;
+  r.body = "error";
+  srv->script.push_back(r);
+  TEST_ASSERT_TRUE(ticketsDescargar());
+  for (int i = 0; i < 1000 && ticketsDescargando(); i++)
+  {
+    httpPoll();
+    delay(1);
+  }
+  TEST_ASSERT_EQUAL_UINT32(20, ticketsStats().count);
+  TEST_ASSERT_EQUAL(TICKET_OK, verificarTicket(codigo(3).c_str()));
+  TEST_ASSERT_TRUE(fakeLogHas("Descarga de entradas fallida"));
+}
+
+// ----------------------------------------------------------------------------
+// Rendimiento: latencia por consulta (acierto y fallo) y memoria por entrada
+// para varios tamaños, con el índice en PSRAM y sobre LittleFS. En LittleFS
+// cada paso de la búsqueda es un seek+read: se cuentan las lecturas para
+// comprobar que son log2(n) y no dependen de nada más.
+static void medir(uint32_t n, bool psram)
+{
+  g_hostPsram = psram;
+  g_hostLargestFree = (size_t)TICKETS_MAX * sizeof(TicketRec) + 64 * 1024; // que quepa la descarga
+  TEST_ASSERT_TRUE(descargar(lista(n)));
+  liberarIndice();
+
+  // Memoria residente tras cargar desde LittleFS (lo que queda al arrancar)
+  const size_t antes = heapEnUso();
+  TEST_ASSERT_TRUE(ticketsBegin());
+  const size_t residente = heapEnUso() - antes;
+  TEST_ASSERT_EQUAL(psram, ticketsStats().inPsram);
+
+  std::vector<std::string> hits, misses;
+  for (uint32_t i = 0; i < 4096; i++)
+  {
+    hits.push_back(codigo((i * 2654435761u) % n));
+    misses.push_back(codigo(n + i));
+  }
+  const uint32_t iters = 4096;
+  uint32_t k = 0;
+  const uint64_t lecturas0 = g_hostFs.bytesRead;
+  const double nsHit = benchNsPerIter(iters, [&]
+                                      { uint32_t idx; TicketRec rec;
+                                        const std::string &c = hits[k++ % hits.size()];
+                                        TEST_ASSERT_TRUE(buscar(hashCodigo(c.c_str(), c.size()), idx, rec)); });
+  const uint64_t bytesPorHit = (g_hostFs.bytesRead - lecturas0) / iters;
+  k = 0;
+  const double nsMiss = benchNsPerIter(iters, [&]
+                                       { uint32_t idx; TicketRec rec;
+                                         const std::string &c = misses[k++ % misses.size()];
+                                         TEST_ASSERT_FALSE(buscar(hashCodigo(c.c_str(), c.size()), idx, rec)); });
+
+  // Paso de búsqueda = un registro de 10 bytes leído
+  uint32_t log2n = 0;
+  while ((1u << log2n) < n)
+    log2n++;
+  if (!psram)
+    TEST_ASSERT_TRUE(bytesPorHit <= (uint64_t)(log2n + 1) * sizeof(TicketRec));
+  else
+    TEST_ASSERT_TRUE(bytesPorHit == 0);
+
+  const size_t fichero = g_hostFs.files[TICKETS_IDX_PATH]->size();
+  TEST_ASSERT_EQUAL(sizeof(TicketIdxHeader) + (size_t)n * sizeof(TicketRec), fichero);
+
+  char nombre[48];
+  snprintf(nombre, sizeof(nombre), "tickets %s n=%u", psram ? "psram" : "littlefs", (unsigned)n);
+  benchReport(nombre, "hit %.0f ns, miss %.0f ns, %.2f B/entrada en flash, %.2f B/entrada residentes",
+              nsHit, nsMiss, (double)fichero / n, (double)residente / n);
+  liberarIndice();
+}
+
+static void test_bench_lookup_and_memory()
+{
+  TEST_ASSERT_EQUAL(11, sizeof(TicketRec)); // hash + minuto + pasos
+  const uint32_t tam[] = {1000, 10000, TICKETS_MAX};
+  for (uint32_t n : tam)
+  {
+    medir(n, true);
+    medir(n, false);
+  }
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_lookup_results);
+  RUN_TEST(test_duplicate_keeps_earliest_slot);
+  RUN_TEST(test_group_tickets_keep_pasos);
+  RUN_TEST(test_littlefs_index_matches_psram);
+  RUN_TEST(test_consumed_marks_survive_reload_and_refresh);
+  RUN_TEST(test_torn_index_is_ignored);
+  RUN_TEST(test_failed_download_keeps_previous_index);
+  RUN_TEST(test_bench_lookup_and_memory);
+  return UNITY_END();
+}
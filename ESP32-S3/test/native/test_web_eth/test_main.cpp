@@ -0,0 +1,485 @@
+// Portal Ethernet (web_eth.cpp) con varios clientes a la vez sobre los
+// sockets simulados: cada conexión lleva su máquina de estados, una petición
+// troceada en cualquier punto se entiende igual, las conexiones lentas o
+// aparcadas no frenan al resto y los límites (cabecera, cuerpo, conexiones,
+// inactividad) se cumplen.
+#include <unity.h>
+
+#define FAKE_FW_UPDATE
+#include "../../support/app_fakes.hpp"
+
+#include "../../../src/definiciones.cpp"
+#include "../../../src/logBuf.cpp"
+#include "../../../src/multipart.cpp"
+#include "../../../src/web_utils.cpp"
+#include "../../../src/ficheros.cpp"
+#include "../../../src/web_assets.cpp"
+#include "../../../src/web_template.cpp"
+#include "../../../src/web_eth.cpp"
+
+#include <string>
+#include <vector>
+
+// ---- Dobles de lo que las rutas usan y aquí no se ejercita ----
+namespace RS485
+{
+StatusFrame getStatus() { return StatusFrame(); }
+String busStatsJson() { return "{}"; }
+String txStatsJson() { return "{}"; }
+Txn queryDeviceStatus(uint8_t) { return 0; }
+Txn resetLeftCount(uint8_t) { return 0; }
+Txn resetRightCount(uint8_t) { return 0; }
+Txn resetDevice(uint8_t) { return 0; }
+Txn leftOpen(uint8_t, uint8_t) { return 0; }
+Txn leftAlwaysOpen(uint8_t) { return 0; }
+Txn rightOpen(uint8_t, uint8_t) { return 0; }
+Txn rightAlwaysOpen(uint8_t) { return 0; }
+Txn closeGate(uint8_t) { return 0; }
+Txn forbiddenLeftPassage(uint8_t) { return 0; }
+Txn forbiddenRightPassage(uint8_t) { return 0; }
+Txn disablePassageRestriccion(uint8_t) { return 0; }
+ParamSyncResult syncParams(const uint8_t *, uint8_t, uint32_t) { return ParamSyncResult(); }
+} // namespace RS485
+namespace DSSP3120
+{
+String scanStatsJson() { return "{}"; }
+}
+namespace rele
+{
+void openEntry() {}
+void openExit() {}
+void close() {}
+} // namespace rele
+TornoConfig cfgLoad() { return TornoConfig(); }
+bool cfgSave(const TornoConfig &) { return true; }
+TornoParams paramsLoad() { return TornoParams(); }
+bool paramsSave(const TornoParams &) { return true; }
+void paramsApplyToGlobals(const TornoParams &) {}
+void paramsToBus(const TornoParams &, uint8_t out[PARAMS_COUNT]) { memset(out, 0, PARAMS_COUNT); }
+void actualiza() {}
+bool otaActive() { return false; }
+OtaStats otaStats() { return OtaStats(); }
+String otaStatsJson() { return "{}"; }
+uint32_t logspool_size() { return 0; }
+bool logspool_stream(LogSpoolSink, void *) { return true; }
+String logspool_stats_json() { return "{}"; }
+String scanCacheStatsJson() { return "{}"; }
+String cmdLanesStatsJson() { return "{}"; }
+String ticketsStatsJson() { return "{}"; }
+
+// ---- Clientes de prueba ----
+static const uint16_t PORT = 8081;
+
+struct Cliente
+{
+  std::shared_ptr<HostEnd> e;
+  std::string got;
+
+  void send(const std::string &s) { e->write((const uint8_t *)s.data(), s.size()); }
+  bool done()
+  {
+    got += e->readAll();
+    return e->peerClosed();
+  }
+  bool has(const char *s) { return done(), got.find(s) != std::string::npos; }
+};
+
+static Cliente conectar()
+{
+  return Cliente{hostDial(PORT), std::string()};
+}
+
+// Una vuelta del bucle de taskNet
+static void vuelta(uint32_t ms = 1)
+{
+  webHandleClient();
+  delay(ms);
+}
+
+// Vueltas hasta que el cliente tiene la respuesta completa (o se agotan)
+static uint32_t hastaRespuesta(Cliente &c, uint32_t max = 200)
+{
+  uint32_t n = 0;
+  while (!c.done() && n < max)
+  {
+    vuelta();
+    n++;
+  }
+  return n;
+}
+
+static std::string formPost(const char *path, const std::string &body)
+{
+  return std::string("POST ") + path + " HTTP/1.1\r\nHost: torno\r\n" +
+         "Content-Type: application/x-www-form-urlencoded\r\n" +
+         "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static const char *BOUNDARY = "----limite7MA4YWxk";
+
+static std::string multipart(const char *path, const char *filename, const std::string &data)
+{
+  std::string body = std::string("--") + BOUNDARY + "\r\n" +
+                     "Content-Disposition: form-data; name=\"file\"; filename=\"" + filename + "\"\r\n" +
+                     "Content-Type: application/octet-stream\r\n\r\n" + data + "\r\n--" + BOUNDARY + "--\r\n";
+  return std::string("POST ") + path + " HTTP/1.1\r\nHost: torno\r\n" +
+         "Content-Type: multipart/form-data; boundary=" + BOUNDARY + "\r\n" +
+         "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static uint8_t activas()
+{
+  return webEthStats().active;
+}
+
+void setUp()
+{
+  hostReset(1000000);
+  hostNetReset();
+  hostFsReset();
+  g_fakeFw = FakeFw();
+  ESP.restarts = 0;
+  for (auto &c : conns)
+    if (c.state != EC_FREE)
+      closeConn(c);
+  g_webStats = {};
+  registrado_eth = false;
+  errorMessage_eth = "";
+  logbuf_begin();
+  TEST_ASSERT_TRUE(ensureWebPagesInLittleFS(true));
+  serverETH.begin();
+}
+
+void tearDown() {}
+
+// La misma petición (login con cuerpo) cortada en cada byte posible
+static void test_request_split_at_every_offset()
+{
+  const std::string req = formPost("/submit", "password=Qualicard&x=1");
+  for (size_t k = 1; k < req.size(); k++)
+  {
+    registrado_eth = false;
+    Cliente c = conectar();
+    c.send(req.substr(0, k));
+    vuelta();
+    TEST_ASSERT_FALSE(c.done());
+    c.send(req.substr(k));
+    hastaRespuesta(c, 5);
+    TEST_ASSERT_TRUE_MESSAGE(c.has("Location: /menu\r\n"), std::to_string(k).c_str());
+    TEST_ASSERT_TRUE(registrado_eth);
+  }
+  TEST_ASSERT_EQUAL_UINT8(0, activas());
+}
+
+// Un byte por vuelta, CRLF sobrantes delante y cabeceras en minúsculas
+static void test_byte_per_loop()
+{
+  Cliente c = conectar();
+  const std::string req = "\r\n\r\nGET /logout HTTP/1.1\r\nhost: torno\r\naccept-encoding: gzip\r\n\r\n";
+  for (char ch : req)
+  {
+    TEST_ASSERT_FALSE(c.done());
+    c.send(std::string(1, ch));
+    vuelta();
+  }
+  TEST_ASSERT_TRUE(c.done());
+  TEST_ASSERT_TRUE(c.has("HTTP/1.1 302"));
+}
+
+// Todas las conexiones a medias a la vez; cada una se contesta al completarse
+// y la que no cabe recibe 503 en el acto
+static void test_concurrent_clients_and_503()
+{
+  std::vector<Cliente> cs;
+  for (int i = 0; i < WEB_ETH_MAX_CONN; i++)
+  {
+    cs.push_back(conectar());
+    cs.back().send("GET /logout HTTP/1.1\r\nHost: t");
+  }
+  vuelta();
+  TEST_ASSERT_EQUAL_UINT8(WEB_ETH_MAX_CONN, activas());
+
+  Cliente extra = conectar();
+  extra.send("GET / HTTP/1.1\r\n\r\n");
+  vuelta();
+  TEST_ASSERT_TRUE(extra.done());
+  TEST_ASSERT_TRUE(extra.has("HTTP/1.1 503"));
+  TEST_ASSERT_EQUAL_UINT32(1, webEthStats().rejected);
+
+  // Se completan en orden inverso: cada una sale en su vuelta
+  for (int i = WEB_ETH_MAX_CONN - 1; i >= 0; i--)
+  {
+    cs[i].send("orno\r\n\r\n");
+    vuelta();
+    TEST_ASSERT_TRUE(cs[i].done());
+    TEST_ASSERT_TRUE(cs[i].has("HTTP/1.1 302"));
+    for (int j = 0; j < i; j++)
+      TEST_ASSERT_FALSE(cs[j].done());
+  }
+  TEST_ASSERT_EQUAL_UINT8(0, activas());
+  TEST_ASSERT_EQUAL_UINT32(WEB_ETH_MAX_CONN, webEthStats().maxActive);
+}
+
+// Un cliente que gotea no retrasa a los demás y acaba cerrado por inactividad
+static void test_slow_client_times_out_without_blocking()
+{
+  Cliente lento = conectar();
+  lento.send("GET /menu HT");
+  vuelta();
+
+  for (int i = 0; i < 20; i++)
+  {
+    Cliente c = conectar();
+    c.send("GET / HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_EQUAL_UINT32(1, hastaRespuesta(c));
+    TEST_ASSERT_TRUE(c.has("HTTP/1.1 200"));
+  }
+  TEST_ASSERT_FALSE(lento.done());
+
+  // Sigue vivo mientras envía algo antes del plazo
+  delay(WEB_ETH_IDLE_MS - 100);
+  lento.send("T");
+  vuelta();
+  delay(WEB_ETH_IDLE_MS - 100);
+  vuelta();
+  TEST_ASSERT_FALSE(lento.done());
+
+  delay(200);
+  vuelta();
+  TEST_ASSERT_TRUE(lento.done());
+  TEST_ASSERT_EQUAL_UINT32(1, webEthStats().timeouts);
+  TEST_ASSERT_EQUAL_UINT8(0, activas());
+}
+
+// Cabecera demasiado larga, cuerpo demasiado grande y línea de petición rota
+static void test_limits()
+{
+  Cliente a = conectar();
+  a.send("GET /" + std::string(WEB_ETH_LINE_MAX, 'a') + " HTTP/1.1\r\n\r\n");
+  hastaRespuesta(a, 5);
+  TEST_ASSERT_TRUE(a.has("HTTP/1.1 400"));
+
+  Cliente b = conectar();
+  b.send("POST /submit HTTP/1.1\r\nContent-Length: " + std::to_string(WEB_ETH_BODY_MAX + 1) + "\r\n\r\n");
+  hastaRespuesta(b, 5);
+  TEST_ASSERT_TRUE(b.has("HTTP/1.1 413"));
+
+  Cliente c = conectar();
+  c.send("BASURA\r\n\r\n");
+  hastaRespuesta(c, 5);
+  TEST_ASSERT_TRUE(c.has("404"));
+
+  // POST sin cuerpo: se despacha sin esperar datos
+  Cliente d = conectar();
+  d.send("POST /submit HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+  hastaRespuesta(d, 5);
+  TEST_ASSERT_TRUE(d.has("Location: /\r\n"));
+  TEST_ASSERT_EQUAL_UINT8(0, activas());
+}
+
+// Cliente que cierra a medias: se libera el hueco sin esperar al plazo
+static void test_peer_close_frees_slot()
+{
+  Cliente c = conectar();
+  c.send("GET /me");
+  vuelta();
+  TEST_ASSERT_EQUAL_UINT8(1, activas());
+  c.e->close();
+  vuelta();
+  TEST_ASSERT_EQUAL_UINT8(0, activas());
+  TEST_ASSERT_EQUAL_UINT32(0, webEthStats().timeouts);
+}
+
+// Una subida grande avanza un tope de bytes por vuelta y el resto de clientes
+// se atiende entre medias
+static void test_upload_streams_while_others_are_served()
+{
+  registrado_eth = true;
+  std::string data(60 * 1024, 0);
+  for (size_t i = 0; i < data.size(); i++)
+    data[i] = (char)('a' + i * 7 % 26);
+  Cliente up = conectar();
+  up.send(multipart("/upload_fs", "nueva.html", data));
+
+  uint32_t vueltas = 0, servidos = 0;
+  while (!up.done() && vueltas < 100)
+  {
+    Cliente c = conectar();
+    c.send("GET /logout HTTP/1.1\r\n\r\n");
+    registrado_eth = true; // /logout cierra la sesión; la subida ya la comprobó
+    vuelta();
+    if (c.done() && c.has("HTTP/1.1 302"))
+      servidos++;
+    vueltas++;
+  }
+  TEST_ASSERT_TRUE(up.has("title=Archivo+actualizado"));
+  TEST_ASSERT_EQUAL_UINT32(vueltas, servidos);
+  // Ni de golpe ni a trozos de más del tope por vuelta
+  TEST_ASSERT_TRUE(vueltas >= data.size() / WEB_ETH_UPLOAD_PUMP_BYTES);
+  TEST_ASSERT_TRUE(vueltas <= data.size() / WEB_ETH_UPLOAD_PUMP_BYTES + 3);
+
+  File f = LittleFS.open("/nueva.html", "r");
+  TEST_ASSERT_TRUE((bool)f);
+  TEST_ASSERT_EQUAL(data.size(), f.size());
+  std::string leido(data.size(), 0);
+  f.read((uint8_t *)&leido[0], leido.size());
+  TEST_ASSERT_TRUE(leido == data);
+  TEST_ASSERT_EQUAL_UINT32(1, ESP.restarts);
+}
+
+// Corte a mitad de subida: el fichero a medias se borra y se admite otra
+static void test_dropped_upload_is_released()
+{
+  registrado_eth = true;
+  const std::string req = multipart("/upload_fs", "rota.html", std::string(20000, 'x'));
+  Cliente a = conectar();
+  a.send(req.substr(0, req.size() / 2));
+  vuelta();
+  vuelta();
+
+  // Mientras, otra subida se rechaza
+  Cliente b = conectar();
+  b.send(multipart("/upload_fs", "otra.html", "hola"));
+  hastaRespuesta(b, 5);
+  TEST_ASSERT_TRUE(b.has("title=Subida+en+curso"));
+
+  a.e->close();
+  for (int i = 0; i < 10; i++)
+    vuelta();
+  TEST_ASSERT_TRUE(a.done());
+  TEST_ASSERT_FALSE(LittleFS.exists("/rota.html"));
+  TEST_ASSERT_EQUAL_UINT8(0, activas());
+
+  Cliente c = conectar();
+  c.send(multipart("/upload_fs", "otra.html", "hola"));
+  hastaRespuesta(c, 5);
+  TEST_ASSERT_TRUE(c.has("title=Archivo+actualizado"));
+}
+
+// El firmware no pasa del socket a la partición OTA de golpe
+static void test_firmware_upload()
+{
+  registrado_eth = true;
+  std::string fw(10000, 0);
+  for (size_t i = 0; i < fw.size(); i++)
+    fw[i] = (char)(i * 13);
+  Cliente c = conectar();
+  c.send(multipart("/upload_firmware", (DEVICE_ID + ".bin").c_str(), fw));
+  hastaRespuesta(c, 20);
+  TEST_ASSERT_TRUE(c.has("title=Firmware+actualizado"));
+  TEST_ASSERT_EQUAL_UINT32(1, g_fakeFw.ends);
+  TEST_ASSERT_TRUE(std::string(g_fakeFw.written.begin(), g_fakeFw.written.end()) == fw);
+
+  Cliente m = conectar();
+  m.send(multipart("/upload_firmware", "otro.bin", fw));
+  hastaRespuesta(m, 20);
+  TEST_ASSERT_TRUE(m.has("title=Archivo+no+v"));
+  TEST_ASSERT_EQUAL_UINT32(1, g_fakeFw.begins);
+}
+
+static uint32_t cursorLogs(const std::string &resp)
+{
+  const size_t p = resp.find("\"next\":");
+  TEST_ASSERT_TRUE(p != std::string::npos);
+  return (uint32_t)strtoul(resp.c_str() + p + 7, nullptr, 10);
+}
+
+// /logs_data?wait= queda aparcado sin ocupar el bucle y contesta al llegar
+// un log o al vencer la espera
+static void test_logs_long_poll()
+{
+  registrado_eth = true;
+  logbuf_pushf("[T] primero");
+  Cliente a = conectar();
+  a.send("GET /logs_data?since=0 HTTP/1.1\r\n\r\n");
+  hastaRespuesta(a, 5);
+  TEST_ASSERT_TRUE(a.has("[T] primero"));
+  const uint32_t since = cursorLogs(a.got);
+
+  Cliente w = conectar();
+  w.send("GET /logs_data?since=" + std::to_string(since) + "&wait=3000 HTTP/1.1\r\n\r\n");
+  vuelta();
+  TEST_ASSERT_EQUAL_UINT32(1, webEthStats().longPolls);
+
+  for (int i = 0; i < 5; i++)
+  {
+    Cliente c = conectar();
+    c.send("GET / HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_EQUAL_UINT32(1, hastaRespuesta(c));
+  }
+  TEST_ASSERT_FALSE(w.done());
+
+  logbuf_pushf("[T] segundo %d", 2);
+  vuelta();
+  TEST_ASSERT_TRUE(w.done());
+  TEST_ASSERT_TRUE(w.has("[T] segundo 2"));
+  TEST_ASSERT_FALSE(w.has("[T] primero"));
+
+  // Sin logs nuevos: vacío al vencer la espera
+  Cliente v = conectar();
+  v.send("GET /logs_data?since=" + std::to_string(cursorLogs(w.got)) + "&wait=1000 HTTP/1.1\r\n\r\n");
+  vuelta();
+  delay(900);
+  vuelta();
+  TEST_ASSERT_FALSE(v.done());
+  delay(200);
+  vuelta();
+  TEST_ASSERT_TRUE(v.done());
+  TEST_ASSERT_TRUE(v.has("{\"items\":[]"));
+}
+
+// Carga: 400 clientes en ráfagas más grandes que los huecos, con envíos
+// troceados. Todos reciben respuesta (la suya o 503) y no queda nada abierto.
+static void test_load_many_clients()
+{
+  std::vector<Cliente> cs;
+  uint32_t ok = 0, busy = 0;
+  uint32_t seed = 12345;
+  for (int ronda = 0; ronda < 50; ronda++)
+  {
+    for (int i = 0; i < WEB_ETH_MAX_CONN + 4; i++)
+    {
+      cs.push_back(conectar());
+      cs.back().send("GET /logout");
+    }
+    vuelta();
+    for (auto &c : cs)
+      c.send(" HTTP/1.1\r\nHost: t\r\n\r\n");
+    for (int i = 0; i < 3; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      vuelta(seed % 3);
+    }
+    for (auto &c : cs)
+    {
+      TEST_ASSERT_TRUE(c.done());
+      if (c.has("HTTP/1.1 302"))
+        ok++;
+      else if (c.has("HTTP/1.1 503"))
+        busy++;
+    }
+    cs.clear();
+  }
+  TEST_ASSERT_EQUAL_UINT32(50 * (WEB_ETH_MAX_CONN + 4), ok + busy);
+  TEST_ASSERT_EQUAL_UINT32(50 * WEB_ETH_MAX_CONN, ok);
+  TEST_ASSERT_EQUAL_UINT32(busy, webEthStats().rejected);
+  TEST_ASSERT_EQUAL_UINT8(0, activas());
+  TEST_ASSERT_EQUAL_UINT32(0, webEthStats().timeouts);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_request_split_at_every_offset);
+  RUN_TEST(test_byte_per_loop);
+  RUN_TEST(test_concurrent_clients_and_503);
+  RUN_TEST(test_slow_client_times_out_without_blocking);
+  RUN_TEST(test_limits);
+  RUN_TEST(test_peer_close_frees_slot);
+  RUN_TEST(test_upload_streams_while_others_are_served);
+  RUN_TEST(test_dropped_upload_is_released);
+  RUN_TEST(test_firmware_upload);
+  RUN_TEST(test_logs_long_poll);
+  RUN_TEST(test_load_many_clients);
+  return UNITY_END();
+}
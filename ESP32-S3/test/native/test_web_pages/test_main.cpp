@@ -0,0 +1,145 @@
+// Páginas embebidas (ficheros.cpp) y su versión gzip (web_assets.cpp): el
+// manifiesto evita reescribirlas en cada arranque y la versión gzip solo se
+// sirve mientras la copia de LittleFS sea la del firmware.
+#include <unity.h>
+
+#include "../../../src/ficheros.cpp"
+#include "../../../src/web_assets.cpp"
+
+#include <string>
+
+static std::string leer(const char *path)
+{
+  File f = LittleFS.open(path, FILE_READ);
+  std::string s;
+  while (f && f.available())
+    s += (char)f.read();
+  return s;
+}
+
+static void escribir(const char *path, const std::string &s)
+{
+  File f = LittleFS.open(path, FILE_WRITE);
+  f.write((const uint8_t *)s.data(), s.size());
+  f.close();
+}
+
+// Arranque: lo que queda en RAM se pierde, LittleFS se conserva
+static void arrancar()
+{
+  g_manifestCount = 0;
+  memset(g_pageFs, 0, sizeof(g_pageFs));
+  TEST_ASSERT_TRUE(ensureWebPagesInLittleFS(true));
+}
+
+void setUp()
+{
+  hostReset(1000000);
+  hostFsReset();
+  g_assetsStats = {};
+  g_pagesStats = {};
+  g_manifestCount = 0;
+}
+
+void tearDown() {}
+
+static void test_second_boot_writes_nothing()
+{
+  arrancar();
+  WebPagesStats s = webPagesStats();
+  TEST_ASSERT_EQUAL_UINT32(PAGES_COUNT, s.written);
+  TEST_ASSERT_EQUAL_UINT32(s.bytesTotal, s.bytesWritten);
+  TEST_ASSERT_EQUAL_STRING(HTML_MENU, leer("/menu.html").c_str());
+
+  const uint32_t escrituras = g_hostFs.writes;
+  arrancar();
+  s = webPagesStats();
+  TEST_ASSERT_EQUAL_UINT32(0, s.written);
+  TEST_ASSERT_EQUAL_UINT32(PAGES_COUNT, s.skipped);
+  TEST_ASSERT_EQUAL_UINT32(0, s.bytesWritten);
+  TEST_ASSERT_EQUAL_UINT32(escrituras, g_hostFs.writes);
+}
+
+static void test_missing_page_is_rewritten()
+{
+  arrancar();
+  LittleFS.remove("/logs.html");
+  arrancar();
+  TEST_ASSERT_EQUAL_UINT32(1, webPagesStats().written);
+  TEST_ASSERT_EQUAL_STRING(HTML_LOGS, leer("/logs.html").c_str());
+}
+
+static void test_gzip_served_while_page_is_stock()
+{
+  arrancar();
+  const WebAsset *a = webAssetFind("/menu.html");
+  TEST_ASSERT_NOT_NULL(a);
+  TEST_ASSERT_EQUAL_HEX8(0x1f, a->gz[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x8b, a->gz[1]);
+  TEST_ASSERT_TRUE(a->gzLen < a->rawLen);
+  for (size_t i = 0; i < WEB_ASSETS_COUNT; i++)
+    TEST_ASSERT_NOT_NULL(webAssetFind(WEB_ASSETS_GZ[i].path));
+  TEST_ASSERT_NULL(webAssetFind("/no-existe.html"));
+  TEST_ASSERT_FALSE(webPageIsStock("/no-existe.html"));
+  TEST_ASSERT_EQUAL_UINT32(0, webAssetsStats().overridden);
+}
+
+// Una página subida desde /upload_fs es la que se sirve; al volver a subir la
+// del firmware se recupera la versión gzip
+static void test_uploaded_page_replaces_gzip()
+{
+  arrancar();
+  TEST_ASSERT_NOT_NULL(webAssetFind("/menu.html"));
+
+  escribir("/menu.html", "<html>menu propio</html>");
+  webPageChanged("/menu.html");
+  TEST_ASSERT_NULL(webAssetFind("/menu.html"));
+  TEST_ASSERT_NULL(webAssetFind("/menu.html"));
+  TEST_ASSERT_EQUAL_UINT32(2, webAssetsStats().overridden);
+  TEST_ASSERT_NOT_NULL(webAssetFind("/logs.html"));
+
+  escribir("/menu.html", HTML_MENU);
+  webPageChanged("/menu.html");
+  TEST_ASSERT_NOT_NULL(webAssetFind("/menu.html"));
+}
+
+// Misma longitud que la del firmware: el manifiesto no la reescribe al
+// arrancar, pero el hash del fichero la delata
+static void test_same_size_upload_is_detected_after_reboot()
+{
+  arrancar();
+  std::string propia(HTML_PARAMS);
+  propia[propia.size() / 2] ^= 0x20;
+  escribir("/params.html", propia);
+
+  arrancar();
+  TEST_ASSERT_EQUAL_UINT32(0, webPagesStats().written);
+  TEST_ASSERT_NULL(webAssetFind("/params.html"));
+  TEST_ASSERT_EQUAL_STRING(propia.c_str(), leer("/params.html").c_str());
+  TEST_ASSERT_NOT_NULL(webAssetFind("/menu.html"));
+}
+
+// El fichero se lee una sola vez por página hasta el siguiente cambio
+static void test_page_is_hashed_once()
+{
+  arrancar();
+  const uint64_t leidos = g_hostFs.bytesRead;
+  TEST_ASSERT_NOT_NULL(webAssetFind("/logs.html"));
+  const uint64_t unaVez = g_hostFs.bytesRead - leidos;
+  TEST_ASSERT_EQUAL_UINT32(strlen(HTML_LOGS), (uint32_t)unaVez);
+  for (int i = 0; i < 10; i++)
+    TEST_ASSERT_NOT_NULL(webAssetFind("/logs.html"));
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)unaVez, (uint32_t)(g_hostFs.bytesRead - leidos));
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_second_boot_writes_nothing);
+  RUN_TEST(test_missing_page_is_rewritten);
+  RUN_TEST(test_gzip_served_while_page_is_stock);
+  RUN_TEST(test_uploaded_page_replaces_gzip);
+  RUN_TEST(test_same_size_upload_is_detected_after_reboot);
+  RUN_TEST(test_page_is_hashed_once);
+  return UNITY_END();
+}
@@ -0,0 +1,246 @@
+// tplRender (web_template.cpp) frente a lo que hacían antes los handlers:
+// readString() de la página entera y String::replace por cada marcador. Se
+// compara la salida con el marcador en cada posición respecto a los bloques
+// de lectura (TPL_CHUNK) y se miden memoria y primer byte de ambas formas.
+#include <unity.h>
+
+#include "../../support/bench.hpp"
+
+#include "../../../src/ficheros.cpp"
+#include "../../../src/web_template.cpp"
+
+#include <string>
+
+static const TplVar VARS[] = {
+    {"A", "xx"},
+    {"LONG_NAME", "<v>"},
+    {"EMPTY", ""},
+    {"NUM_1", "12345"},
+};
+static const size_t NVARS = sizeof(VARS) / sizeof(VARS[0]);
+
+struct Salida
+{
+  std::string out;
+  uint32_t calls = 0;
+  uint32_t stopAfter = 0;      // 0 = nunca corta
+  uint64_t readAtFirst = 0;    // bytes leídos de LittleFS al primer trozo
+  uint64_t nsAtFirst = 0;
+};
+
+static uint64_t g_t0Ns;
+
+static bool sink(void *ctx, const uint8_t *d, size_t n)
+{
+  Salida &s = *(Salida *)ctx;
+  if (s.calls++ == 0)
+  {
+    s.readAtFirst = g_hostFs.bytesRead;
+    s.nsAtFirst = benchNowNs() - g_t0Ns;
+  }
+  s.out.append((const char *)d, n);
+  return !s.stopAfter || s.calls < s.stopAfter;
+}
+
+static void guardar(const char *path, const std::string &s)
+{
+  File f = LittleFS.open(path, FILE_WRITE);
+  f.write((const uint8_t *)s.data(), s.size());
+  f.close();
+}
+
+static std::string render(const std::string &page, const TplVar *vars, size_t n, Salida *sal = nullptr)
+{
+  guardar("/t.html", page);
+  File f = LittleFS.open("/t.html", FILE_READ);
+  Salida local;
+  Salida &s = sal ? *sal : local;
+  g_hostFs.bytesRead = 0;
+  g_t0Ns = benchNowNs();
+  const size_t total = tplRender(f, vars, n, sink, &s);
+  f.close();
+  TEST_ASSERT_EQUAL(s.out.size(), total);
+  return s.out;
+}
+
+// Lo de antes: la página entera en un String y un replace por variable
+static std::string conReplace(const std::string &page, const TplVar *vars, size_t n)
+{
+  String s(page.c_str());
+  for (size_t i = 0; i < n; i++)
+    s.replace(String("{{") + vars[i].name + "}}", vars[i].value);
+  return s.c_str();
+}
+
+void setUp()
+{
+  hostFsReset();
+}
+
+void tearDown() {}
+
+// Cada caso se desplaza byte a byte para que el corte entre bloques de
+// lectura caiga en todas sus posiciones (incluida justo tras una '{')
+static void test_matches_replace_at_every_split()
+{
+  static const char *casos[] = {
+      "hola {{A}} y {{LONG_NAME}}!",
+      "{{A}}{{NUM_1}}{{EMPTY}}{{A}}",
+      "{{", "{{A", "{{A}", "{", "}}", "{}{{A}}{",
+      "x{{DESCONOCIDA}}y",
+      "{ {{A}}}",
+      "{{{A}}}",
+      "{{{{A}}}}",
+      "js {{\") z",
+      "{{A }} {{ A}} {{A-B}}",
+      "{{NOMBRE_DEMASIADO_LARGO_PARA_EL_BUFFER_DE_NOMBRES}}",
+      "{{A}{{A}}",
+      "}{{A}}}{",
+  };
+  uint32_t comprobados = 0;
+  for (const char *c : casos)
+  {
+    for (size_t pad = 0; pad <= TPL_CHUNK + 8; pad++)
+    {
+      const std::string page = std::string(pad, '.') + c + std::string(pad % 5, '-');
+      const std::string esperado = conReplace(page, VARS, NVARS);
+      const std::string salida = render(page, VARS, NVARS);
+      if (salida != esperado)
+      {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "caso \"%s\" desplazado %u", c, (unsigned)pad);
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(esperado.c_str(), salida.c_str(), msg);
+      }
+      comprobados++;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32((TPL_CHUNK + 9) * (sizeof(casos) / sizeof(casos[0])), comprobados);
+}
+
+// '{' como último byte de un bloque y un carácter que no es '{' como primero
+// del siguiente: se reprocesa con i = 0 (el i-- da la vuelta en size_t)
+static void test_reprocess_at_chunk_start()
+{
+  const std::string base(TPL_CHUNK - 1, 'a');
+  TEST_ASSERT_EQUAL_STRING((base + "{b").c_str(), render(base + "{b", VARS, NVARS).c_str());
+  TEST_ASSERT_EQUAL_STRING((base + "{{A b").c_str(), render(base + "{{A b", VARS, NVARS).c_str());
+  TEST_ASSERT_EQUAL_STRING((base + "xx").c_str(), render(base + "{{A}}", VARS, NVARS).c_str());
+
+  const std::string base2(TPL_CHUNK - 3, 'a');
+  TEST_ASSERT_EQUAL_STRING((base2 + "{{A}x").c_str(), render(base2 + "{{A}x", VARS, NVARS).c_str());
+  TEST_ASSERT_EQUAL_STRING((base2 + "{{LONG-").c_str(), render(base2 + "{{LONG-", VARS, NVARS).c_str());
+}
+
+// La página de configuración, con todas sus variables, en cada desplazamiento
+static void test_config_page_matches_replace()
+{
+  static const TplVar vars[] = {
+      {"DEVICE_ID", "TORNO-07"}, {"MAC_ADDRESS", "24:0A:C4:00:11:22"}, {"IP", "192.168.1.20"},
+      {"SUBNET", "255.255.255.0"}, {"GATEWAY", "192.168.1.1"}, {"DNS1", "8.8.8.8"},
+      {"DNS2", "1.1.1.1"}, {"CFG_MSG", "Guardado"}, {"CON_ETH_SEL", "selected"},
+      {"CON_WIFI_SEL", ""}, {"MODO_DHCP_SEL", ""}, {"MODO_ESTATICA_SEL", "selected"},
+      {"MODO_RELES_SEL", ""}, {"MODO_RS485_SEL", "selected"}, {"MOD_ARTURUS_SEL", ""},
+      {"MOD_CANOPU_SEL", "selected"}, {"MOD_VEGA_SEL", ""}, {"SENT_LEFT_SEL", "selected"},
+      {"SENT_RIGHT_SEL", ""}, {"RS485_CLASS", ""}, {"TABLET_CLASS", "hidden"},
+  };
+  const size_t n = sizeof(vars) / sizeof(vars[0]);
+  for (size_t pad = 0; pad < TPL_CHUNK; pad += 3)
+  {
+    const std::string page = std::string(pad, ' ') + HTML_CONFIG;
+    const std::string esperado = conReplace(page, vars, n);
+    TEST_ASSERT_TRUE(esperado.find("{{DEVICE_ID}}") == std::string::npos);
+    TEST_ASSERT_TRUE(render(page, vars, n) == esperado);
+  }
+}
+
+// Cliente caído: en cuanto el sink dice que no, se deja de leer
+static void test_sink_failure_stops_reading()
+{
+  const std::string page(20 * TPL_CHUNK, 'z');
+  Salida s;
+  s.stopAfter = 2;
+  render(page, VARS, NVARS, &s);
+  TEST_ASSERT_EQUAL_UINT32(2, s.calls);
+  TEST_ASSERT_EQUAL(2 * TPL_CHUNK, s.out.size());
+  TEST_ASSERT_TRUE(g_hostFs.bytesRead <= 3 * TPL_CHUNK);
+}
+
+// Memoria dinámica y primer byte: streaming frente a readString + replace
+static void test_bench_heap_and_ttfb()
+{
+  static const TplVar vars[] = {{"DEVICE_ID", "TORNO-07"}, {"IP", "192.168.1.20"}, {"CFG_MSG", "Guardado"}};
+  const std::string page = HTML_CONFIG;
+  guardar("/config.html", page);
+  const uint32_t iters = 200;
+
+  // tplRender
+  Salida s;
+  s.out.reserve(page.size());
+  BenchHeap m = benchHeapMark();
+  {
+    File f = LittleFS.open("/config.html", FILE_READ);
+    g_hostFs.bytesRead = 0;
+    g_t0Ns = benchNowNs();
+    tplRender(f, vars, 3, sink, &s);
+  }
+  const BenchHeap hTpl = benchHeapSince(m);
+  std::string ref = s.out;
+  const double nsTpl = benchNsPerIter(iters, [&]
+                                      { File f = LittleFS.open("/config.html", FILE_READ);
+                                        Salida x; x.out.reserve(page.size());
+                                        tplRender(f, vars, 3, sink, &x); });
+
+  // readString + replace
+  uint64_t leidoAntes = 0;
+  m = benchHeapMark();
+  uint64_t t0 = benchNowNs();
+  std::string viejo;
+  {
+    File f = LittleFS.open("/config.html", FILE_READ);
+    g_hostFs.bytesRead = 0;
+    String html = f.readString();
+    for (auto &v : vars)
+      html.replace(String("{{") + v.name + "}}", v.value);
+    leidoAntes = g_hostFs.bytesRead;
+    viejo = html.c_str();
+  }
+  const uint64_t nsPrimerViejo = benchNowNs() - t0;
+  const BenchHeap hOld = benchHeapSince(m);
+  const double nsOld = benchNsPerIter(iters, [&]
+                                      { File f = LittleFS.open("/config.html", FILE_READ);
+                                        String html = f.readString();
+                                        for (auto &v : vars)
+                                          html.replace(String("{{") + v.name + "}}", v.value); });
+
+  TEST_ASSERT_TRUE(ref == viejo);
+  // La salida del sink ya estaba reservada: solo queda el File del stub
+  TEST_ASSERT_TRUE(hTpl.peak < 1024);
+  TEST_ASSERT_TRUE(hOld.peak >= (int64_t)(2 * page.size()));
+  TEST_ASSERT_TRUE(s.readAtFirst <= 2 * TPL_CHUNK);
+  TEST_ASSERT_EQUAL(page.size(), leidoAntes);
+
+  benchReport("tplRender config.html", "pico %lld B, primer byte tras leer %llu B (%.1f us), %.1f us/página",
+              (long long)hTpl.peak, (unsigned long long)s.readAtFirst, s.nsAtFirst / 1000.0, nsTpl / 1000.0);
+  benchReport("readString+replace config.html", "pico %lld B, primer byte tras leer %llu B (%.1f us), %.1f us/página",
+              (long long)hOld.peak, (unsigned long long)leidoAntes, nsPrimerViejo / 1000.0, nsOld / 1000.0);
+
+  // Sin guardar la salida: tplRender no reserva nada
+  m = benchHeapMark();
+  {
+    File f = LittleFS.open("/config.html", FILE_READ);
+    tplRender(f, vars, 3, [](void *, const uint8_t *, size_t)
+              { return true; }, nullptr);
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, (uint32_t)benchHeapSince(m).allocs); // el File del stub
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_replace_at_every_split);
+  RUN_TEST(test_reprocess_at_chunk_start);
+  RUN_TEST(test_config_page_matches_replace);
+  RUN_TEST(test_sink_failure_stops_reading);
+  RUN_TEST(test_bench_heap_and_ttfb);
+  return UNITY_END();
+}
@@ -0,0 +1,508 @@
+// Arduino.h (host) — sustituto mínimo del núcleo Arduino-ESP32 para las
+// pruebas de [env:native]. El reloj es simulado: millis()/micros() solo
+// avanzan con delay()/hostAdvanceUs(), así los plazos se prueban sin esperar.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define PGM_P const char *
+#define F(x) (x)
+#define PSTR(x) (x)
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define INPUT 0
+#define INPUT_PULLUP 2
+#define HEX 16
+#define DEC 10
+
+typedef bool boolean;
+typedef uint8_t byte;
+class __FlashStringHelper;
+
+inline uint8_t pgm_read_byte(const void *p) { return *(const uint8_t *)p; }
+inline uint16_t pgm_read_word(const void *p) { return *(const uint16_t *)p; }
+inline uint32_t pgm_read_dword(const void *p) { return *(const uint32_t *)p; }
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+#ifndef __GLIBC_PREREQ
+#define HOST_NEEDS_STRLCPY 1
+#elif !__GLIBC_PREREQ(2, 38)
+#define HOST_NEEDS_STRLCPY 1
+#endif
+#ifdef HOST_NEEDS_STRLCPY
+inline size_t strlcpy(char *d, const char *s, size_t n)
+{
+  const size_t l = strlen(s);
+  if (n)
+  {
+    const size_t c = l < n - 1 ? l : n - 1;
+    memcpy(d, s, c);
+    d[c] = 0;
+  }
+  return l;
+}
+#endif
+
+inline bool isDigit(int c) { return c >= '0' && c <= '9'; }
+inline bool isAlpha(int c) { return isalpha(c) != 0; }
+inline bool isAlphaNumeric(int c) { return isalnum(c) != 0; }
+inline bool isHexadecimalDigit(int c) { return isxdigit(c) != 0; }
+inline bool isSpace(int c) { return isspace(c) != 0; }
+inline bool isPrintable(int c) { return isprint(c) != 0; }
+
+// ============================ Reloj simulado =================================
+// Avanza por pasos de g_hostStepUs; en cada paso se disparan los esp_timer
+// vencidos y los ganchos que haya registrado la prueba (emuladores de bus,
+// servidores con retardo...).
+
+inline uint64_t g_hostUs = 0;
+inline uint32_t g_hostStepUs = 100;
+inline void (*g_hostTimerHook)() = nullptr;
+inline std::vector<std::function<void()>> g_hostTicks;
+
+inline uint64_t hostNowUs() { return g_hostUs; }
+
+inline void hostAdvanceUs(uint64_t us)
+{
+  const uint64_t end = g_hostUs + us;
+  while (g_hostUs < end)
+  {
+    const uint64_t step = std::min<uint64_t>(g_hostStepUs ? g_hostStepUs : 1, end - g_hostUs);
+    g_hostUs += step;
+    if (g_hostTimerHook)
+      g_hostTimerHook();
+    for (size_t i = 0; i < g_hostTicks.size(); i++)
+      g_hostTicks[i]();
+  }
+}
+
+inline void hostOnTick(std::function<void()> fn) { g_hostTicks.push_back(std::move(fn)); }
+
+// Deja el reloj en 't' µs y quita ganchos y temporizadores de la prueba anterior
+inline void hostReset(uint64_t t = 0)
+{
+  g_hostUs = t;
+  g_hostTicks.clear();
+}
+
+inline unsigned long micros() { return (uint32_t)g_hostUs; }
+inline unsigned long millis() { return (uint32_t)(g_hostUs / 1000); }
+inline void delay(unsigned long ms) { hostAdvanceUs((uint64_t)ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { hostAdvanceUs(us); }
+inline void yield() {}
+
+// ================================ GPIO ======================================
+inline uint8_t g_hostPins[64] = {};
+inline void pinMode(int, int) {}
+inline void digitalWrite(int pin, int v)
+{
+  if (pin >= 0 && pin < 64)
+    g_hostPins[pin] = (uint8_t)v;
+}
+inline int digitalRead(int pin) { return (pin >= 0 && pin < 64) ? g_hostPins[pin] : 0; }
+
+inline long random(long hi) { return hi > 0 ? rand() % hi : 0; }
+inline long random(long lo, long hi) { return hi > lo ? lo + rand() % (hi - lo) : lo; }
+inline void randomSeed(unsigned long s) { srand((unsigned)s); }
+
+// Sin PSRAM salvo que la prueba diga otra cosa
+inline bool g_hostPsram = false;
+inline bool psramFound() { return g_hostPsram; }
+inline void *ps_malloc(size_t n) { return malloc(n); }
+inline void configTzTime(const char *, const char *, const char * = nullptr, const char * = nullptr) {}
+
+// =============================== String =====================================
+// Misma semántica que WString de Arduino (índices int, -1 si no está), sobre
+// std::string: las reservas de memoria cuentan igual en las pruebas de heap.
+
+class String
+{
+public:
+  std::string s;
+
+  String() {}
+  String(const char *c) : s(c ? c : "") {}
+  String(const char *c, unsigned int n) : s(c ? std::string(c, n) : std::string()) {}
+  String(const uint8_t *c, unsigned int n) : s(c ? std::string((const char *)c, n) : std::string()) {}
+  String(const std::string &x) : s(x) {}
+  explicit String(char c) : s(1, c) {}
+  String(int v, unsigned char base = 10) { s = fmtSigned(v, base); }
+  String(unsigned int v, unsigned char base = 10) { s = fmtUnsigned(v, base); }
+  String(long v, unsigned char base = 10) { s = fmtSigned(v, base); }
+  String(unsigned long v, unsigned char base = 10) { s = fmtUnsigned(v, base); }
+  String(long long v, unsigned char base = 10) { s = fmtSigned(v, base); }
+  String(unsigned long long v, unsigned char base = 10) { s = fmtUnsigned(v, base); }
+  String(unsigned char v, unsigned char base = 10) { s = fmtUnsigned(v, base); }
+  String(float v, unsigned int dec = 2) { s = fmtFloat(v, dec); }
+  String(double v, unsigned int dec = 2) { s = fmtFloat(v, dec); }
+
+  unsigned int length() const { return (unsigned int)s.size(); }
+  bool isEmpty() const { return s.empty(); }
+  const char *c_str() const { return s.c_str(); }
+  bool reserve(unsigned int n)
+  {
+    s.reserve(n);
+    return true;
+  }
+  void clear() { s.clear(); }
+
+  char charAt(unsigned int i) const { return i < s.size() ? s[i] : 0; }
+  void setCharAt(unsigned int i, char c)
+  {
+    if (i < s.size())
+      s[i] = c;
+  }
+  char operator[](unsigned int i) const { return charAt(i); }
+  char &operator[](unsigned int i) { return s[i]; }
+  char *begin() { return &s[0]; }
+  char *end() { return &s[0] + s.size(); }
+  const char *begin() const { return s.c_str(); }
+  const char *end() const { return s.c_str() + s.size(); }
+
+  bool concat(const String &o)
+  {
+    s += o.s;
+    return true;
+  }
+  bool concat(const char *p)
+  {
+    if (p)
+      s += p;
+    return p != nullptr;
+  }
+  bool concat(const char *p, unsigned int n)
+  {
+    if (p)
+      s.append(p, n);
+    return p != nullptr;
+  }
+  bool concat(char c)
+  {
+    s += c;
+    return true;
+  }
+  template <typename T>
+  bool concat(T v)
+  {
+    s += String(v).s;
+    return true;
+  }
+
+  String &operator+=(const String &o)
+  {
+    s += o.s;
+    return *this;
+  }
+  String &operator+=(const char *p)
+  {
+    concat(p);
+    return *this;
+  }
+  String &operator+=(char c)
+  {
+    s += c;
+    return *this;
+  }
+  template <typename T>
+  String &operator+=(T v)
+  {
+    concat(v);
+    return *this;
+  }
+
+  bool equals(const String &o) const { return s == o.s; }
+  bool equalsIgnoreCase(const String &o) const
+  {
+    if (s.size() != o.s.size())
+      return false;
+    for (size_t i = 0; i < s.size(); i++)
+      if (tolower((unsigned char)s[i]) != tolower((unsigned char)o.s[i]))
+        return false;
+    return true;
+  }
+  int compareTo(const String &o) const { return s.compare(o.s); }
+  bool operator==(const String &o) const { return s == o.s; }
+  bool operator==(const char *o) const { return s == (o ? o : ""); }
+  bool operator!=(const String &o) const { return s != o.s; }
+  bool operator!=(const char *o) const { return !(*this == o); }
+  bool operator<(const String &o) const { return s < o.s; }
+  bool operator>(const String &o) const { return s > o.s; }
+  explicit operator bool() const { return true; }
+
+  bool startsWith(const String &p) const { return s.compare(0, p.s.size(), p.s) == 0 && s.size() >= p.s.size(); }
+  bool startsWith(const String &p, unsigned int off) const
+  {
+    return off <= s.size() && s.size() - off >= p.s.size() && s.compare(off, p.s.size(), p.s) == 0;
+  }
+  bool endsWith(const String &p) const
+  {
+    return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0;
+  }
+
+  int indexOf(char c, unsigned int from = 0) const { return pos(s.find(c, from)); }
+  int indexOf(const String &t, unsigned int from = 0) const { return pos(s.find(t.s, from)); }
+  int indexOf(const char *t, unsigned int from = 0) const { return pos(s.find(t, from)); }
+  int lastIndexOf(char c) const { return pos(s.rfind(c)); }
+  int lastIndexOf(char c, unsigned int from) const { return pos(s.rfind(c, from)); }
+  int lastIndexOf(const String &t) const { return pos(s.rfind(t.s)); }
+  int lastIndexOf(const String &t, unsigned int from) const { return pos(s.rfind(t.s, from)); }
+
+  String substring(unsigned int from) const { return substring(from, length()); }
+  String substring(unsigned int from, unsigned int to) const
+  {
+    if (from > to)
+      std::swap(from, to);
+    if (from >= s.size())
+      return String();
+    if (to > s.size())
+      to = (unsigned int)s.size();
+    return String(s.substr(from, to - from));
+  }
+
+  void replace(char a, char b) { std::replace(s.begin(), s.end(), a, b); }
+  void replace(const String &a, const String &b)
+  {
+    if (a.s.empty())
+      return;
+    std::string out;
+    size_t i = 0, p;
+    while ((p = s.find(a.s, i)) != std::string::npos)
+    {
+      out.append(s, i, p - i);
+      out += b.s;
+      i = p + a.s.size();
+    }
+    if (i == 0)
+      return;
+    out.append(s, i, std::string::npos);
+    s.swap(out);
+  }
+  void remove(unsigned int i)
+  {
+    if (i < s.size())
+      s.erase(i);
+  }
+  void remove(unsigned int i, unsigned int n)
+  {
+    if (i < s.size())
+      s.erase(i, n);
+  }
+  void toLowerCase()
+  {
+    for (auto &c : s)
+      c = (char)tolower((unsigned char)c);
+  }
+  void toUpperCase()
+  {
+    for (auto &c : s)
+      c = (char)toupper((unsigned char)c);
+  }
+  void trim()
+  {
+    size_t a = 0, b = s.size();
+    while (a < b && isspace((unsigned char)s[a]))
+      a++;
+    while (b > a && isspace((unsigned char)s[b - 1]))
+      b--;
+    s = s.substr(a, b - a);
+  }
+
+  long toInt() const { return atol(s.c_str()); }
+  float toFloat() const { return (float)atof(s.c_str()); }
+  double toDouble() const { return atof(s.c_str()); }
+  void toCharArray(char *buf, unsigned int n, unsigned int from = 0) const { getBytes((uint8_t *)buf, n, from); }
+  void getBytes(uint8_t *buf, unsigned int n, unsigned int from = 0) const
+  {
+    if (!n || !buf)
+      return;
+    size_t c = from < s.size() ? std::min<size_t>(n - 1, s.size() - from) : 0;
+    if (c)
+      memcpy(buf, s.data() + from, c);
+    buf[c] = 0;
+  }
+
+private:
+  static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+  static std::string fmtUnsigned(unsigned long long v, unsigned char base)
+  {
+    if (base < 2 || base > 36)
+      base = 10;
+    char t[72];
+    int i = 70;
+    t[71] = 0;
+    do
+    {
+      const int d = (int)(v % base);
+      t[i--] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+      v /= base;
+    } while (v && i >= 0);
+    return std::string(t + i + 1);
+  }
+  static std::string fmtSigned(long long v, unsigned char base)
+  {
+    if (base == 10 && v < 0)
+      return "-" + fmtUnsigned((unsigned long long)(-(v + 1)) + 1, 10);
+    return fmtUnsigned(base == 10 ? (unsigned long long)v : (unsigned long long)(unsigned long)v, base);
+  }
+  static std::string fmtFloat(double v, unsigned int dec)
+  {
+    char t[64];
+    snprintf(t, sizeof(t), "%.*f", (int)dec, v);
+    return t;
+  }
+};
+
+inline String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+inline String operator+(const String &a, const char *b) { return String(a.s + (b ? b : "")); }
+inline String operator+(const char *a, const String &b) { return String((a ? a : "") + b.s); }
+inline String operator+(const String &a, char b) { return String(a.s + b); }
+template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+inline String operator+(const String &a, T v)
+{
+  String r(a);
+  r.concat(v);
+  return r;
+}
+
+// =============================== Print / Stream =============================
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *b, size_t n)
+  {
+    size_t k = 0;
+    while (n--)
+      k += write(*b++);
+    return k;
+  }
+  size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+  size_t write(const char *s, size_t n) { return write((const uint8_t *)s, n); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const String &v) { return write((const uint8_t *)v.c_str(), v.length()); }
+  size_t print(const char *v) { return write(v); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(int v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned int v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(long long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(double v, int dec = 2) { return print(String(v, (unsigned int)dec)); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T &v)
+  {
+    const size_t n = print(v);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(const T &v, int fmt)
+  {
+    const size_t n = print(v, fmt);
+    return n + println();
+  }
+
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+  {
+    char t[256];
+    va_list a;
+    va_start(a, fmt);
+    const int n = vsnprintf(t, sizeof(t), fmt, a);
+    va_end(a);
+    if (n < 0)
+      return 0;
+    if ((size_t)n < sizeof(t))
+      return write((const uint8_t *)t, (size_t)n);
+    std::vector<char> big((size_t)n + 1);
+    va_start(a, fmt);
+    vsnprintf(big.data(), big.size(), fmt, a);
+    va_end(a);
+    return write((const uint8_t *)big.data(), (size_t)n);
+  }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() { return -1; }
+
+  void setTimeout(unsigned long ms) { _timeout = ms; }
+  unsigned long getTimeout() const { return _timeout; }
+
+  size_t readBytes(uint8_t *buf, size_t n)
+  {
+    size_t k = 0;
+    while (k < n)
+    {
+      const int c = timedRead();
+      if (c < 0)
+        break;
+      buf[k++] = (uint8_t)c;
+    }
+    return k;
+  }
+  size_t readBytes(char *buf, size_t n) { return readBytes((uint8_t *)buf, n); }
+  String readStringUntil(char term)
+  {
+    String r;
+    int c;
+    while ((c = timedRead()) >= 0 && c != term)
+      r += (char)c;
+    return r;
+  }
+  String readString()
+  {
+    String r;
+    int c;
+    while ((c = timedRead()) >= 0)
+      r += (char)c;
+    return r;
+  }
+
+protected:
+  unsigned long _timeout = 1000;
+  int timedRead()
+  {
+    const unsigned long t0 = millis();
+    do
+    {
+      if (available() > 0)
+        return read();
+      delay(1);
+    } while (millis() - t0 < _timeout);
+    return -1;
+  }
+};
+
+#include "HardwareSerial.h"
+#include "IPAddress.h"
+#include "freertos_host.h"
+#include "Esp.h"
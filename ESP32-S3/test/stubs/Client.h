@@ -0,0 +1,222 @@
+// Client.h (host) — sockets TCP simulados en memoria.
+//
+// Cada conexión son dos HostPipe (uno por sentido). Lo que escribe un
+// extremo lo lee el otro, a partir del instante que marque quien escribe
+// (así un servidor de prueba puede contestar con retardo). connect() busca
+// el HostServer registrado en el puerto con hostListen(); para el lado
+// servidor del equipo (EthernetServer) la prueba marca con hostDial().
+#pragma once
+
+#include "Arduino.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+
+struct HostPipe
+{
+  std::deque<std::pair<uint64_t, uint8_t>> q; // (instante de llegada, byte)
+  bool closed = false;                        // el que escribe ha cerrado
+  uint64_t closedAtUs = 0;
+  std::function<void()> onData; // avisa al otro extremo de que hay bytes
+
+  void push(const uint8_t *b, size_t n, uint64_t atUs)
+  {
+    // Como en TCP, nada adelanta a lo ya enviado: los instantes no decrecen
+    if (!q.empty() && atUs < q.back().first)
+      atUs = q.back().first;
+    for (size_t i = 0; i < n; i++)
+      q.emplace_back(atUs, b[i]);
+    if (onData)
+      onData();
+  }
+  void close(uint64_t atUs)
+  {
+    if (closed)
+      return;
+    closed = true;
+    closedAtUs = atUs;
+  }
+  size_t ready() const
+  {
+    if (q.empty() || q.back().first <= g_hostUs)
+      return q.size();
+    return std::partition_point(q.begin(), q.end(), [](const std::pair<uint64_t, uint8_t> &e)
+                                { return e.first <= g_hostUs; }) -
+           q.begin();
+  }
+  bool eof() const { return closed && closedAtUs <= g_hostUs && ready() == 0; }
+};
+
+// Un extremo de la conexión (equipo o prueba)
+struct HostEnd
+{
+  std::shared_ptr<HostPipe> in, out;
+  uint64_t latencyUs = 0; // retardo de lo que se escribe desde este extremo
+
+  bool open() const { return in && out; }
+  size_t write(const uint8_t *b, size_t n)
+  {
+    if (!out || out->closed)
+      return 0;
+    out->push(b, n, g_hostUs + latencyUs);
+    return n;
+  }
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t write(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+  size_t writeAt(uint64_t atUs, const uint8_t *b, size_t n)
+  {
+    if (!out || out->closed)
+      return 0;
+    out->push(b, n, atUs);
+    return n;
+  }
+  std::string readAll()
+  {
+    std::string r;
+    if (!in)
+      return r;
+    while (!in->q.empty() && in->q.front().first <= g_hostUs)
+    {
+      r += (char)in->q.front().second;
+      in->q.pop_front();
+    }
+    return r;
+  }
+  bool peerClosed() const { return !in || in->eof(); }
+  void close(uint64_t delayUs = 0)
+  {
+    if (out)
+      out->close(g_hostUs + delayUs);
+  }
+};
+
+// Servidor de prueba: recibe las conexiones salientes del equipo
+struct HostServer
+{
+  virtual ~HostServer() {}
+  virtual bool onAccept(const std::shared_ptr<HostEnd> &) { return true; }
+  virtual void onData(const std::shared_ptr<HostEnd> &) = 0;
+};
+
+struct HostNet
+{
+  std::map<uint16_t, HostServer *> servers;
+  std::map<uint16_t, std::deque<std::shared_ptr<HostEnd>>> backlog; // hacia el equipo
+  std::vector<std::shared_ptr<HostEnd>> remotes;                      // extremos del lado servidor
+  uint32_t connects = 0;
+  uint32_t refused = 0;
+  bool linkUp = true;
+};
+inline HostNet g_hostNet;
+
+inline void hostListen(uint16_t port, HostServer *srv) { g_hostNet.servers[port] = srv; }
+inline void hostNetReset() { g_hostNet = HostNet(); }
+
+// Par de extremos conectados: first para el equipo, second para la prueba
+inline std::pair<std::shared_ptr<HostEnd>, std::shared_ptr<HostEnd>> hostPair()
+{
+  auto a = std::make_shared<HostEnd>(), b = std::make_shared<HostEnd>();
+  a->out = b->in = std::make_shared<HostPipe>();
+  a->in = b->out = std::make_shared<HostPipe>();
+  return {a, b};
+}
+
+// La prueba abre una conexión contra un EthernetServer del equipo
+inline std::shared_ptr<HostEnd> hostDial(uint16_t port)
+{
+  auto p = hostPair();
+  g_hostNet.backlog[port].push_back(p.first);
+  return p.second;
+}
+
+class Client : public Stream
+{
+public:
+  virtual int connect(IPAddress ip, uint16_t port) { return connect(ip.toString().c_str(), port); }
+  virtual int connect(const char *, uint16_t port)
+  {
+    stop();
+    auto it = g_hostNet.servers.find(port);
+    if (!g_hostNet.linkUp || it == g_hostNet.servers.end())
+    {
+      g_hostNet.refused++;
+      return 0;
+    }
+    auto p = hostPair();
+    HostServer *srv = it->second;
+    std::shared_ptr<HostEnd> remote = p.second;
+    if (!srv->onAccept(remote))
+    {
+      g_hostNet.refused++;
+      return 0;
+    }
+    g_hostNet.remotes.push_back(remote);
+    std::weak_ptr<HostEnd> w = remote;
+    p.first->out->onData = [srv, w]()
+    {
+      if (auto r = w.lock())
+        srv->onData(r);
+    };
+    _end = p.first;
+    g_hostNet.connects++;
+    return 1;
+  }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *b, size_t n) override
+  {
+    if (!_end)
+      return 0;
+    return _end->write(b, n);
+  }
+  using Print::write;
+
+  int available() override { return _end ? (int)_end->in->ready() : 0; }
+  int read() override
+  {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  virtual int read(uint8_t *buf, size_t n)
+  {
+    if (!_end)
+      return -1;
+    size_t k = 0;
+    auto &q = _end->in->q;
+    while (k < n && !q.empty() && q.front().first <= g_hostUs)
+    {
+      buf[k++] = q.front().second;
+      q.pop_front();
+    }
+    return (int)k;
+  }
+  int peek() override
+  {
+    if (!_end || !available())
+      return -1;
+    return _end->in->q.front().second;
+  }
+  void flush() override {}
+
+  virtual void stop()
+  {
+    if (_end)
+      _end->close();
+    _end.reset();
+  }
+  // Como en lwIP/W5500: sigue "conectado" mientras queden datos por leer
+  virtual uint8_t connected()
+  {
+    if (!_end)
+      return 0;
+    return (available() > 0 || !_end->in->eof()) ? 1 : 0;
+  }
+  virtual operator bool() { return _end != nullptr; }
+
+  void hostAttach(const std::shared_ptr<HostEnd> &e) { _end = e; }
+  const std::shared_ptr<HostEnd> &hostEnd() const { return _end; }
+
+protected:
+  std::shared_ptr<HostEnd> _end;
+};
@@ -0,0 +1,83 @@
+// Ethernet.h (host) — W5500 simulado: enlace e IP fijados por la prueba y
+// hasta MAX_SOCK_NUM sockets contando los de cliente y los de servidor.
+#pragma once
+
+#include "Client.h"
+
+#define MAX_SOCK_NUM 8
+
+enum EthernetLinkStatus
+{
+  Unknown,
+  LinkON,
+  LinkOFF
+};
+enum EthernetHardwareStatus
+{
+  EthernetNoHardware,
+  EthernetW5100,
+  EthernetW5200,
+  EthernetW5500
+};
+
+class EthernetClient : public Client
+{
+public:
+  EthernetClient() {}
+  explicit EthernetClient(const std::shared_ptr<HostEnd> &e, uint8_t sock) : _sock(sock) { _end = e; }
+  void setConnectionTimeout(uint16_t ms) { _connTimeout = ms; }
+  uint8_t getSocketNumber() const { return _sock; }
+  uint16_t localPort() { return 80; }
+  IPAddress remoteIP() { return IPAddress(192, 168, 1, 50); }
+  uint16_t remotePort() { return 50000; }
+
+private:
+  uint8_t _sock = MAX_SOCK_NUM;
+  uint16_t _connTimeout = 1000;
+};
+
+class EthernetServer
+{
+public:
+  explicit EthernetServer(uint16_t port) : _port(port) {}
+  virtual ~EthernetServer() {}
+  virtual void begin(uint16_t = 0) { _begun = true; }
+  EthernetClient accept()
+  {
+    auto &bl = g_hostNet.backlog[_port];
+    if (!_begun || bl.empty())
+      return EthernetClient();
+    auto e = bl.front();
+    bl.pop_front();
+    return EthernetClient(e, _nextSock++ % MAX_SOCK_NUM);
+  }
+  EthernetClient available() { return accept(); }
+  uint16_t port() const { return _port; }
+
+private:
+  uint16_t _port;
+  bool _begun = false;
+  uint8_t _nextSock = 0;
+};
+
+class EthernetClass
+{
+public:
+  EthernetLinkStatus hostLink = LinkON;
+  IPAddress hostIP = IPAddress(192, 168, 1, 20);
+
+  EthernetLinkStatus linkStatus() { return hostLink; }
+  EthernetHardwareStatus hardwareStatus() { return EthernetW5500; }
+  IPAddress localIP() { return hostIP; }
+  IPAddress gatewayIP() { return IPAddress(192, 168, 1, 1); }
+  IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+  IPAddress dnsServerIP() { return IPAddress(192, 168, 1, 1); }
+  int begin(uint8_t *, unsigned long = 60000, unsigned long = 4000) { return 1; }
+  void begin(uint8_t *, IPAddress, IPAddress = IPAddress(), IPAddress = IPAddress(), IPAddress = IPAddress()) {}
+  void init(uint8_t) {}
+  int maintain() { return 0; }
+  void setRetransmissionTimeout(uint16_t) {}
+  void setRetransmissionCount(uint8_t) {}
+};
+
+inline EthernetClass Ethernet;
@@ -0,0 +1,281 @@
+// FS.h (host) — sistema de ficheros en memoria con la semántica de LittleFS
+// que usa el firmware: open() con "r"/"w"/"a", directorios, rename atómico.
+// Los ficheros son visibles para la prueba en g_hostFs (p. ej. para cortar
+// uno a mitad y simular un apagón).
+#pragma once
+
+#include "Arduino.h"
+#include <map>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+struct HostFsState
+{
+  std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+  std::map<std::string, bool> dirs;
+  size_t capacity = 1024 * 1024;
+  uint32_t opens = 0;
+  uint32_t writes = 0;
+  uint64_t bytesWritten = 0;
+  uint64_t bytesRead = 0;
+
+  size_t used() const
+  {
+    size_t n = 0;
+    for (auto &f : files)
+      n += f.second->size();
+    return n;
+  }
+};
+inline HostFsState g_hostFs;
+
+inline void hostFsReset() { g_hostFs = HostFsState(); }
+
+// Deja el fichero con sus primeros 'n' bytes (escritura cortada)
+inline bool hostFsTruncate(const std::string &path, size_t n)
+{
+  auto it = g_hostFs.files.find(path);
+  if (it == g_hostFs.files.end() || n > it->second->size())
+    return false;
+  it->second->resize(n);
+  return true;
+}
+
+namespace fs
+{
+  enum SeekMode
+  {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+  };
+
+  struct HostFile
+  {
+    std::string path;
+    std::shared_ptr<std::vector<uint8_t>> data;
+    size_t pos = 0;
+    bool write = false;
+    bool append = false;
+    bool dir = false;
+    std::vector<std::string> entries; // nombres para openNextFile()
+    size_t next = 0;
+  };
+
+  static inline std::string hostBase(const std::string &p)
+  {
+    const size_t s = p.rfind('/');
+    return s == std::string::npos ? p : p.substr(s + 1);
+  }
+
+  class File : public Stream
+  {
+  public:
+    File() {}
+    explicit File(std::shared_ptr<HostFile> f) : _f(std::move(f)) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *b, size_t n) override
+    {
+      if (!_f || _f->dir || !_f->write)
+        return 0;
+      if (g_hostFs.used() + n > g_hostFs.capacity)
+        return 0;
+      auto &d = *_f->data;
+      if (_f->append)
+        _f->pos = d.size();
+      if (_f->pos + n > d.size())
+        d.resize(_f->pos + n);
+      memcpy(d.data() + _f->pos, b, n);
+      _f->pos += n;
+      g_hostFs.writes++;
+      g_hostFs.bytesWritten += n;
+      return n;
+    }
+    using Print::write;
+
+    int available() override { return (_f && !_f->dir) ? (int)(_f->data->size() - std::min(_f->pos, _f->data->size())) : 0; }
+    int peek() override { return available() ? (*_f->data)[_f->pos] : -1; }
+    int read() override
+    {
+      uint8_t c;
+      return read(&c, 1) == 1 ? c : -1;
+    }
+    size_t read(uint8_t *buf, size_t n)
+    {
+      const size_t a = (size_t)available();
+      if (n > a)
+        n = a;
+      if (n)
+        memcpy(buf, _f->data->data() + _f->pos, n);
+      if (_f)
+        _f->pos += n;
+      g_hostFs.bytesRead += n;
+      return n;
+    }
+    size_t readBytes(char *buf, size_t n) { return read((uint8_t *)buf, n); }
+    String readString()
+    {
+      String r;
+      while (available())
+        r += (char)read();
+      return r;
+    }
+    String readStringUntil(char term)
+    {
+      String r;
+      int c;
+      while ((c = read()) >= 0 && c != term)
+        r += (char)c;
+      return r;
+    }
+    void flush() override {}
+
+    bool seek(uint32_t pos, SeekMode mode = SeekSet)
+    {
+      if (!_f || _f->dir)
+        return false;
+      const size_t sz = _f->data->size();
+      size_t p = mode == SeekSet ? pos : mode == SeekCur ? _f->pos + pos : sz + pos;
+      if (p > sz)
+        return false;
+      _f->pos = p;
+      return true;
+    }
+    size_t position() const { return _f ? _f->pos : 0; }
+    size_t size() const { return (_f && !_f->dir) ? _f->data->size() : 0; }
+    void close() { _f.reset(); }
+    operator bool() const { return _f != nullptr; }
+    const char *name() const { return _f ? (_name = hostBase(_f->path)).c_str() : ""; }
+    const char *path() const { return _f ? _f->path.c_str() : ""; }
+    bool isDirectory() const { return _f && _f->dir; }
+    time_t getLastWrite() { return 0; }
+
+    File openNextFile(const char * = FILE_READ)
+    {
+      if (!_f || !_f->dir)
+        return File();
+      while (_f->next < _f->entries.size())
+      {
+        const std::string p = _f->entries[_f->next++];
+        auto it = g_hostFs.files.find(p);
+        auto h = std::make_shared<HostFile>();
+        h->path = p;
+        if (it != g_hostFs.files.end())
+          h->data = it->second;
+        else if (g_hostFs.dirs.count(p))
+          h->dir = true;
+        else
+          continue; // borrado mientras se recorría
+        return File(h);
+      }
+      return File();
+    }
+    void rewindDirectory()
+    {
+      if (_f)
+        _f->next = 0;
+    }
+
+  private:
+    std::shared_ptr<HostFile> _f;
+    mutable std::string _name;
+  };
+
+  class FS
+  {
+  public:
+    File open(const char *path, const char *mode = FILE_READ, bool create = false)
+    {
+      const std::string p = norm(path);
+      g_hostFs.opens++;
+      auto h = std::make_shared<HostFile>();
+      h->path = p;
+      if (g_hostFs.dirs.count(p))
+      {
+        h->dir = true;
+        const std::string pre = p == "/" ? "/" : p + "/";
+        for (auto &f : g_hostFs.files)
+          if (f.first.compare(0, pre.size(), pre) == 0 && f.first.find('/', pre.size()) == std::string::npos)
+            h->entries.push_back(f.first);
+        for (auto &d : g_hostFs.dirs)
+          if (d.first != p && d.first.compare(0, pre.size(), pre) == 0 && d.first.find('/', pre.size()) == std::string::npos)
+            h->entries.push_back(d.first);
+        return File(h);
+      }
+      auto it = g_hostFs.files.find(p);
+      const char m = mode ? mode[0] : 'r';
+      if (m == 'r')
+      {
+        if (it == g_hostFs.files.end())
+          return File();
+        h->data = it->second;
+        return File(h);
+      }
+      (void)create;
+      if (m == 'w' || it == g_hostFs.files.end())
+      {
+        auto d = std::make_shared<std::vector<uint8_t>>();
+        g_hostFs.files[p] = d;
+        h->data = d;
+      }
+      else
+        h->data = it->second;
+      h->write = true;
+      h->append = (m == 'a');
+      if (h->append)
+        h->pos = h->data->size();
+      return File(h);
+    }
+    File open(const String &path, const char *mode = FILE_READ, bool create = false)
+    {
+      return open(path.c_str(), mode, create);
+    }
+    bool exists(const char *path)
+    {
+      const std::string p = norm(path);
+      return g_hostFs.files.count(p) || g_hostFs.dirs.count(p);
+    }
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path) { return g_hostFs.files.erase(norm(path)) > 0; }
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to)
+    {
+      auto it = g_hostFs.files.find(norm(from));
+      if (it == g_hostFs.files.end())
+        return false;
+      auto d = it->second;
+      g_hostFs.files.erase(it);
+      g_hostFs.files[norm(to)] = d;
+      return true;
+    }
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char *path)
+    {
+      g_hostFs.dirs[norm(path)] = true;
+      return true;
+    }
+    bool mkdir(const String &path) { return mkdir(path.c_str()); }
+    bool rmdir(const char *path) { return g_hostFs.dirs.erase(norm(path)) > 0; }
+
+  private:
+    static std::string norm(const char *p)
+    {
+      std::string s = p ? p : "";
+      if (s.empty() || s[0] != '/')
+        s = "/" + s;
+      if (s.size() > 1 && s.back() == '/')
+        s.pop_back();
+      return s;
+    }
+  };
+}
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekSet;
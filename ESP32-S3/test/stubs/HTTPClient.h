@@ -0,0 +1,4 @@
+// HTTPClient.h (host) — no se usa en las pruebas; solo para compilar
+#pragma once
+
+#include "WiFi.h"
@@ -0,0 +1,94 @@
+// HardwareSerial.h (host) — UART simulado. Lo que se escribe va a 'hostTx'
+// (un emulador de bus) o, en Serial, a stdout si HOST_SERIAL está definida
+// en el entorno. hostRx() mete bytes de vuelta y avisa a onReceive() como
+// haría el evento de fin de trama del UART.
+#pragma once
+
+#include "Arduino.h"
+#include <deque>
+
+#define SERIAL_8N1 0x800001c
+
+class HardwareSerial : public Stream
+{
+public:
+  std::function<void(const uint8_t *, size_t)> hostTx;
+  std::deque<uint8_t> hostRxBuf;
+  bool hostEcho = false;
+
+  explicit HardwareSerial(int num = 0) : _num(num) {}
+
+  void begin(unsigned long baud, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1, bool = false, unsigned long = 20000UL)
+  {
+    _baud = baud;
+    hostEcho = (_num == 0) && getenv("HOST_SERIAL") != nullptr;
+  }
+  void end() {}
+  unsigned long baudRate() const { return _baud; }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *b, size_t n) override
+  {
+    if (hostTx)
+      hostTx(b, n);
+    else if (hostEcho)
+      fwrite(b, 1, n, stdout);
+    return n;
+  }
+  using Print::write;
+  int availableForWrite() override { return 128; }
+  void flush() override {}
+
+  int available() override { return (int)hostRxBuf.size(); }
+  int peek() override { return hostRxBuf.empty() ? -1 : hostRxBuf.front(); }
+  int read() override
+  {
+    if (hostRxBuf.empty())
+      return -1;
+    const int c = hostRxBuf.front();
+    hostRxBuf.pop_front();
+    return c;
+  }
+  size_t read(uint8_t *buf, size_t n)
+  {
+    size_t k = 0;
+    while (k < n && !hostRxBuf.empty())
+    {
+      buf[k++] = hostRxBuf.front();
+      hostRxBuf.pop_front();
+    }
+    return k;
+  }
+
+  void onReceive(void (*cb)(void), bool = false) { _onRx = cb; }
+  bool setRxFIFOFull(uint8_t) { return true; }
+  bool setRxTimeout(uint8_t) { return true; }
+  size_t setRxBufferSize(size_t n) { return n; }
+  size_t setTxBufferSize(size_t n) { return n; }
+  bool setPins(int8_t, int8_t, int8_t = -1, int8_t = -1) { return true; }
+  bool setMode(uint8_t) { return true; }
+  operator bool() const { return true; }
+
+  // Lado del emulador: llegan bytes al UART
+  void hostRx(const uint8_t *b, size_t n)
+  {
+    hostRxBuf.insert(hostRxBuf.end(), b, b + n);
+    if (_onRx)
+      _onRx();
+  }
+  void hostClear()
+  {
+    hostRxBuf.clear();
+    hostTx = nullptr;
+    _onRx = nullptr;
+  }
+
+private:
+  int _num;
+  unsigned long _baud = 0;
+  void (*_onRx)(void) = nullptr;
+};
+
+inline HardwareSerial Serial(0);
+inline HardwareSerial Serial1(1);
+inline HardwareSerial Serial2(2);
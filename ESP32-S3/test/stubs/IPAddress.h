@@ -0,0 +1,40 @@
+// IPAddress.h (host)
+#pragma once
+
+#include "Arduino.h"
+
+class IPAddress
+{
+public:
+  IPAddress() : _v(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _v((uint32_t)a | (uint32_t)b << 8 | (uint32_t)c << 16 | (uint32_t)d << 24) {}
+  IPAddress(uint32_t v) : _v(v) {}
+  IPAddress(const uint8_t *b) : IPAddress(b[0], b[1], b[2], b[3]) {}
+
+  operator uint32_t() const { return _v; }
+  bool operator==(const IPAddress &o) const { return _v == o._v; }
+  bool operator!=(const IPAddress &o) const { return _v != o._v; }
+  uint8_t operator[](int i) const { return (uint8_t)(_v >> (8 * i)); }
+
+  String toString() const
+  {
+    char t[16];
+    snprintf(t, sizeof(t), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(t);
+  }
+  bool fromString(const char *s)
+  {
+    unsigned a, b, c, d;
+    char extra;
+    if (!s || sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4 || a > 255 || b > 255 || c > 255 || d > 255)
+      return false;
+    *this = IPAddress((uint8_t)a, (uint8_t)b, (uint8_t)c, (uint8_t)d);
+    return true;
+  }
+  bool fromString(const String &s) { return fromString(s.c_str()); }
+
+private:
+  uint32_t _v;
+};
+
+inline const IPAddress INADDR_NONE(0, 0, 0, 0);
@@ -0,0 +1,26 @@
+// LittleFS.h (host)
+#pragma once
+
+#include "FS.h"
+
+class LittleFSFS : public fs::FS
+{
+public:
+  bool hostMounted = true;
+
+  bool begin(bool = false, const char * = "/littlefs", uint8_t = 10, const char * = "spiffs")
+  {
+    g_hostFs.dirs["/"] = true;
+    return hostMounted;
+  }
+  void end() {}
+  bool format()
+  {
+    hostFsReset();
+    return true;
+  }
+  size_t totalBytes() { return g_hostFs.capacity; }
+  size_t usedBytes() { return g_hostFs.used(); }
+};
+
+inline LittleFSFS LittleFS;
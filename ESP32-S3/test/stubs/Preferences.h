@@ -0,0 +1,149 @@
+// Preferences.h (host) — NVS en memoria compartida por todas las instancias.
+// Cuenta llamadas y lecturas de entradas (para comparar formatos) y permite
+// cortar una escritura a medias con g_hostNvs.failPut.
+#pragma once
+
+#include "Arduino.h"
+#include <map>
+
+struct HostNvsState
+{
+  std::map<std::string, std::map<std::string, std::vector<uint8_t>>> ns;
+  uint32_t calls = 0;
+  uint32_t puts = 0;
+  uint32_t entries = 0; // entradas de 32 B leídas o escritas
+  int failPut = -1;     // el put número N (desde 0) queda a medias y falla
+};
+inline HostNvsState g_hostNvs;
+
+inline void hostNvsReset() { g_hostNvs = HostNvsState(); }
+
+class Preferences
+{
+public:
+  bool begin(const char *name, bool readOnly = false, const char * = nullptr)
+  {
+    g_hostNvs.calls++;
+    _ns = &g_hostNvs.ns[name];
+    _ro = readOnly;
+    return true;
+  }
+  void end() { _ns = nullptr; }
+  bool clear()
+  {
+    if (!_ns || _ro)
+      return false;
+    _ns->clear();
+    return true;
+  }
+  bool remove(const char *key)
+  {
+    g_hostNvs.calls++;
+    return _ns && !_ro && _ns->erase(key) > 0;
+  }
+  bool isKey(const char *key) { return find(key) != nullptr; }
+  size_t freeEntries() { return 630; }
+
+  size_t putBytes(const char *key, const void *v, size_t n) { return put(key, v, n) ? n : 0; }
+  size_t putString(const char *key, const String &v) { return put(key, v.c_str(), v.length() + 1) ? v.length() : 0; }
+  size_t putString(const char *key, const char *v) { return putString(key, String(v)); }
+  size_t putUChar(const char *key, uint8_t v) { return put(key, &v, 1) ? 1 : 0; }
+  size_t putChar(const char *key, int8_t v) { return put(key, &v, 1) ? 1 : 0; }
+  size_t putBool(const char *key, bool v) { return putUChar(key, v ? 1 : 0); }
+  size_t putUShort(const char *key, uint16_t v) { return put(key, &v, 2) ? 2 : 0; }
+  size_t putShort(const char *key, int16_t v) { return put(key, &v, 2) ? 2 : 0; }
+  size_t putUInt(const char *key, uint32_t v) { return put(key, &v, 4) ? 4 : 0; }
+  size_t putInt(const char *key, int32_t v) { return put(key, &v, 4) ? 4 : 0; }
+  size_t putULong(const char *key, uint32_t v) { return putUInt(key, v); }
+  size_t putLong(const char *key, int32_t v) { return putInt(key, v); }
+  size_t putFloat(const char *key, float v) { return put(key, &v, 4) ? 4 : 0; }
+
+  size_t getBytesLength(const char *key)
+  {
+    auto v = find(key);
+    return v ? v->size() : 0;
+  }
+  size_t getBytes(const char *key, void *buf, size_t n)
+  {
+    auto v = find(key);
+    if (!v || v->size() > n)
+      return 0;
+    touch(*v);
+    memcpy(buf, v->data(), v->size());
+    return v->size();
+  }
+  String getString(const char *key, const String &def = String())
+  {
+    auto v = find(key);
+    if (!v)
+      return def;
+    touch(*v);
+    return String(std::string(v->begin(), std::find(v->begin(), v->end(), (uint8_t)0)));
+  }
+  size_t getString(const char *key, char *buf, size_t n)
+  {
+    auto v = find(key);
+    if (!v || !n || v->size() > n)
+      return 0;
+    touch(*v);
+    memcpy(buf, v->data(), v->size());
+    buf[v->size() - 1] = 0;
+    return v->size();
+  }
+  uint8_t getUChar(const char *key, uint8_t def = 0) { return get(key, def); }
+  int8_t getChar(const char *key, int8_t def = 0) { return get(key, def); }
+  bool getBool(const char *key, bool def = false) { return get<uint8_t>(key, def ? 1 : 0) != 0; }
+  uint16_t getUShort(const char *key, uint16_t def = 0) { return get(key, def); }
+  int16_t getShort(const char *key, int16_t def = 0) { return get(key, def); }
+  uint32_t getUInt(const char *key, uint32_t def = 0) { return get(key, def); }
+  int32_t getInt(const char *key, int32_t def = 0) { return get(key, def); }
+  uint32_t getULong(const char *key, uint32_t def = 0) { return get(key, def); }
+  int32_t getLong(const char *key, int32_t def = 0) { return get(key, def); }
+  float getFloat(const char *key, float def = 0) { return get(key, def); }
+
+private:
+  std::map<std::string, std::vector<uint8_t>> *_ns = nullptr;
+  bool _ro = false;
+
+  // Como la NVS real: búsqueda por nombre y una lectura por entrada de 32 B
+  std::vector<uint8_t> *find(const char *key)
+  {
+    g_hostNvs.calls++;
+    if (!_ns)
+      return nullptr;
+    auto it = _ns->find(key);
+    return it == _ns->end() ? nullptr : &it->second;
+  }
+  static void touch(const std::vector<uint8_t> &v) { g_hostNvs.entries += 1 + (uint32_t)(v.size() > 8 ? (v.size() + 31) / 32 : 0); }
+
+  template <typename T>
+  T get(const char *key, T def)
+  {
+    auto v = find(key);
+    if (!v || v->size() != sizeof(T))
+      return def;
+    touch(*v);
+    T x;
+    memcpy(&x, v->data(), sizeof(T));
+    return x;
+  }
+  bool put(const char *key, const void *v, size_t n)
+  {
+    g_hostNvs.calls++;
+    g_hostNvs.puts++;
+    if (!_ns || _ro)
+      return false;
+    const uint8_t *b = (const uint8_t *)v;
+    if (g_hostNvs.failPut == 0)
+    {
+      g_hostNvs.failPut = -1;
+      (*_ns)[key].assign(b, b + n / 2); // corte a mitad de escritura
+      return false;
+    }
+    if (g_hostNvs.failPut > 0)
+      g_hostNvs.failPut--;
+    (*_ns)[key].assign(b, b + n);
+    touch((*_ns)[key]);
+    return true;
+  }
+};
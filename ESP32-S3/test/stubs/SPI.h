@@ -0,0 +1,13 @@
+// SPI.h (host)
+#pragma once
+
+#include "Arduino.h"
+
+class SPIClass
+{
+public:
+  void begin(int8_t = -1, int8_t = -1, int8_t = -1, int8_t = -1) {}
+  void end() {}
+};
+
+inline SPIClass SPI;
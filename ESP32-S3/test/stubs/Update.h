@@ -0,0 +1,3 @@
+// Update.h (host) — vacío: la escritura de firmware se simula en
+// app_fakes.hpp (FAKE_FW_UPDATE) y ningún .cpp probado usa Update directamente
+#pragma once
@@ -0,0 +1,64 @@
+// WiFi.h (host) — estado de la STA fijado por la prueba
+#pragma once
+
+#include "Client.h"
+
+#define WL_IDLE_STATUS 0
+#define WL_NO_SSID_AVAIL 1
+#define WL_CONNECTED 3
+#define WL_CONNECT_FAILED 4
+#define WL_DISCONNECTED 6
+
+typedef enum
+{
+  WIFI_OFF = 0,
+  WIFI_STA,
+  WIFI_AP,
+  WIFI_AP_STA
+} wifi_mode_t;
+
+typedef int WiFiEvent_t;
+enum
+{
+  ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5
+};
+
+class WiFiClient : public Client
+{
+public:
+  using Client::connect;
+  int connect(const char *host, uint16_t port, int32_t) { return Client::connect(host, port); }
+  int connect(IPAddress ip, uint16_t port, int32_t) { return Client::connect(ip, port); }
+  int setNoDelay(bool) { return 0; }
+};
+
+class WiFiClass
+{
+public:
+  int hostStatus = WL_CONNECTED;
+  IPAddress hostIP = IPAddress(192, 168, 4, 10);
+
+  int status() { return hostStatus; }
+  IPAddress localIP() { return hostStatus == WL_CONNECTED ? hostIP : IPAddress(); }
+  IPAddress gatewayIP() { return IPAddress(192, 168, 4, 1); }
+  IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+  IPAddress dnsIP(uint8_t = 0) { return IPAddress(192, 168, 4, 1); }
+  IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+  String macAddress() { return "02:A1:B2:C3:D4:E5"; }
+  void persistent(bool) {}
+  bool setSleep(bool) { return true; }
+  void onEvent(void (*)(WiFiEvent_t)) {}
+  bool setHostname(const char *) { return true; }
+  bool config(IPAddress, IPAddress, IPAddress, IPAddress = IPAddress(), IPAddress = IPAddress()) { return true; }
+  bool mode(wifi_mode_t) { return true; }
+  int begin(const char *, const char * = nullptr) { return hostStatus; }
+  bool disconnect(bool = false) { return true; }
+  bool softAP(const char *, const char * = nullptr) { return true; }
+  int16_t scanNetworks() { return 0; }
+  String SSID(uint8_t = 0) { return String(); }
+  int32_t RSSI(uint8_t = 0) { return -60; }
+  void scanDelete() {}
+};
+
+inline WiFiClass WiFi;
@@ -0,0 +1,11 @@
+// WiFiClientSecure.h (host) — no se usa en las pruebas; solo para compilar
+#pragma once
+
+#include "WiFi.h"
+
+class WiFiClientSecure : public WiFiClient
+{
+public:
+  void setInsecure() {}
+  void setCACert(const char *) {}
+};
@@ -0,0 +1,5 @@
+// driver/uart.h (host)
+#pragma once
+
+#define UART_MODE_UART 0x00
+#define UART_MODE_RS485_HALF_DUPLEX 0x01
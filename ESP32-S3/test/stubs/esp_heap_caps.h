@@ -0,0 +1,19 @@
+// esp_heap_caps.h (host) — el mayor bloque libre lo fija la prueba
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+inline size_t g_hostLargestFree = 110 * 1024;
+inline size_t g_hostFreeHeap = 200 * 1024;
+
+inline size_t heap_caps_get_largest_free_block(unsigned) { return g_hostLargestFree; }
+inline size_t heap_caps_get_free_size(unsigned) { return g_hostFreeHeap; }
+inline size_t heap_caps_get_minimum_free_size(unsigned) { return g_hostFreeHeap; }
+inline void *heap_caps_malloc(size_t n, unsigned) { return malloc(n); }
+inline void heap_caps_free(void *p) { free(p); }
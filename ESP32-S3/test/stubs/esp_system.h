@@ -0,0 +1,24 @@
+// esp_system.h (host)
+#pragma once
+
+#include "Esp.h"
+
+typedef enum
+{
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+  ESP_RST_SDIO
+} esp_reset_reason_t;
+
+inline esp_reset_reason_t g_hostResetReason = ESP_RST_POWERON;
+inline esp_reset_reason_t esp_reset_reason() { return g_hostResetReason; }
+inline void esp_restart() { ESP.restart(); }
+inline uint32_t esp_get_free_heap_size() { return ESP.getFreeHeap(); }
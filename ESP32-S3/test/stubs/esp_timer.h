@@ -0,0 +1,100 @@
+// esp_timer.h (host) — temporizadores sobre el reloj simulado. Se disparan
+// desde hostAdvanceUs() en cuanto vencen, en el orden en que vencen.
+#pragma once
+
+#include "Arduino.h"
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#define ESP_FAIL -1
+#endif
+
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef enum
+{
+  ESP_TIMER_TASK,
+  ESP_TIMER_ISR
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+  esp_timer_cb_t callback;
+  void *arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char *name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct esp_timer
+{
+  esp_timer_cb_t cb;
+  void *arg;
+  const char *name;
+  bool armed;
+  uint64_t at;
+  uint64_t period;
+};
+typedef esp_timer *esp_timer_handle_t;
+
+inline std::vector<esp_timer *> g_hostTimers;
+
+inline void hostRunTimers()
+{
+  for (;;)
+  {
+    esp_timer *next = nullptr;
+    for (esp_timer *t : g_hostTimers)
+      if (t->armed && t->at <= g_hostUs && (!next || t->at < next->at))
+        next = t;
+    if (!next)
+      return;
+    if (next->period)
+      next->at += next->period;
+    else
+      next->armed = false;
+    next->cb(next->arg);
+  }
+}
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *a, esp_timer_handle_t *h)
+{
+  esp_timer *t = new esp_timer{a->callback, a->arg, a->name, false, 0, 0};
+  g_hostTimers.push_back(t);
+  g_hostTimerHook = hostRunTimers;
+  *h = t;
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t us)
+{
+  if (t->armed)
+    return ESP_FAIL;
+  t->armed = true;
+  t->at = g_hostUs + us;
+  t->period = 0;
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t us)
+{
+  if (t->armed)
+    return ESP_FAIL;
+  t->armed = true;
+  t->at = g_hostUs + us;
+  t->period = us;
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+  if (!t->armed)
+    return ESP_FAIL;
+  t->armed = false;
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_delete(esp_timer_handle_t t)
+{
+  g_hostTimers.erase(std::remove(g_hostTimers.begin(), g_hostTimers.end(), t), g_hostTimers.end());
+  delete t;
+  return ESP_OK;
+}
+inline bool esp_timer_is_active(esp_timer_handle_t t) { return t->armed; }
+inline int64_t esp_timer_get_time() { return (int64_t)g_hostUs; }
@@ -0,0 +1,4 @@
+// freertos/FreeRTOS.h (host)
+#pragma once
+
+#include "../freertos_host.h"
@@ -0,0 +1,4 @@
+// freertos/queue.h (host)
+#pragma once
+
+#include "../freertos_host.h"
@@ -0,0 +1,4 @@
+// freertos/semphr.h (host)
+#pragma once
+
+#include "../freertos_host.h"
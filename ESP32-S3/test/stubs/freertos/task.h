@@ -0,0 +1,4 @@
+// freertos/task.h (host)
+#pragma once
+
+#include "../freertos_host.h"
@@ -0,0 +1,136 @@
+// freertos_host.h (host) — FreeRTOS de un solo hilo. Un tick es 1 ms del reloj
+// simulado; vTaskDelay() lo avanza. Las colas son FIFO de copia por valor.
+#pragma once
+
+#include "Arduino.h"
+#include <deque>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define configTICK_RATE_HZ 1000
+#define tskIDLE_PRIORITY 0
+
+typedef struct
+{
+  int owner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(m) (void)(m)
+#define portEXIT_CRITICAL(m) (void)(m)
+#define portENTER_CRITICAL_ISR(m) (void)(m)
+#define portEXIT_CRITICAL_ISR(m) (void)(m)
+#define taskENTER_CRITICAL(m) (void)(m)
+#define taskEXIT_CRITICAL(m) (void)(m)
+#define portYIELD_FROM_ISR(x) (void)(x)
+
+inline void vTaskDelay(TickType_t t) { delay(t); }
+inline TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+inline void vTaskDelete(TaskHandle_t) {}
+
+// Tareas: no se ejecutan (cada prueba llama a las funciones de la tarea)
+inline TaskHandle_t g_hostCurrentTask = (TaskHandle_t)1;
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *h, int)
+{
+  static uintptr_t next = 2;
+  if (h)
+    *h = (TaskHandle_t)next++;
+  return pdPASS;
+}
+inline BaseType_t xTaskCreate(TaskFunction_t f, const char *n, uint32_t s, void *p, UBaseType_t pr, TaskHandle_t *h)
+{
+  return xTaskCreatePinnedToCore(f, n, s, p, pr, h, 0);
+}
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return g_hostCurrentTask; }
+
+// Notificaciones: un contador global por simplicidad
+inline uint32_t g_hostNotify = 0;
+inline BaseType_t xTaskNotifyGive(TaskHandle_t)
+{
+  g_hostNotify++;
+  return pdPASS;
+}
+inline void vTaskNotifyGiveFromISR(TaskHandle_t t, BaseType_t *)
+{
+  xTaskNotifyGive(t);
+}
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+  if (!g_hostNotify && wait)
+    vTaskDelay(wait == portMAX_DELAY ? 1 : wait);
+  const uint32_t n = g_hostNotify;
+  g_hostNotify = clear ? 0 : (n ? n - 1 : 0);
+  return n;
+}
+
+struct HostQueue
+{
+  size_t item;
+  size_t cap;
+  std::deque<std::vector<uint8_t>> q;
+};
+typedef HostQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item)
+{
+  return new HostQueue{item, len, {}};
+}
+inline BaseType_t xQueueSend(QueueHandle_t h, const void *p, TickType_t)
+{
+  if (!h || h->q.size() >= h->cap)
+    return pdFALSE;
+  h->q.emplace_back((const uint8_t *)p, (const uint8_t *)p + h->item);
+  return pdTRUE;
+}
+inline BaseType_t xQueueSendToBack(QueueHandle_t h, const void *p, TickType_t t) { return xQueueSend(h, p, t); }
+inline BaseType_t xQueueSendToFront(QueueHandle_t h, const void *p, TickType_t)
+{
+  if (!h || h->q.size() >= h->cap)
+    return pdFALSE;
+  h->q.emplace_front((const uint8_t *)p, (const uint8_t *)p + h->item);
+  return pdTRUE;
+}
+inline BaseType_t xQueueOverwrite(QueueHandle_t h, const void *p)
+{
+  h->q.clear();
+  return xQueueSend(h, p, 0);
+}
+inline BaseType_t xQueueReceive(QueueHandle_t h, void *p, TickType_t wait)
+{
+  if (h && h->q.empty() && wait)
+    vTaskDelay(wait == portMAX_DELAY ? 1 : wait);
+  if (!h || h->q.empty())
+    return pdFALSE;
+  memcpy(p, h->q.front().data(), h->item);
+  h->q.pop_front();
+  return pdTRUE;
+}
+inline BaseType_t xQueuePeek(QueueHandle_t h, void *p, TickType_t)
+{
+  if (!h || h->q.empty())
+    return pdFALSE;
+  memcpy(p, h->q.front().data(), h->item);
+  return pdTRUE;
+}
+inline BaseType_t xQueueReset(QueueHandle_t h)
+{
+  if (h)
+    h->q.clear();
+  return pdPASS;
+}
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t h) { return h ? (UBaseType_t)h->q.size() : 0; }
+
+typedef void *SemaphoreHandle_t;
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return (SemaphoreHandle_t)1; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
@@ -0,0 +1,4 @@
+// pgmspace.h (host) — PROGMEM y pgm_read_* ya están en Arduino.h
+#pragma once
+
+#include "Arduino.h"
@@ -0,0 +1,166 @@
+// app_fakes.hpp — dobles de los módulos que las pruebas no compilan. Una
+// prueba incluye los .cpp que ejercita (http.cpp, ticket.cpp...) y este
+// fichero pone el resto: serializadores/descifradores de json.cpp,
+// escritura de firmware de fw_update.cpp, el registro de logBuf.cpp y la
+// hora de time.cpp. Cada grupo se pide con su macro antes de incluirlo:
+//   FAKE_JSON, FAKE_FW_UPDATE, FAKE_LOGBUF, FAKE_TIME
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+#ifdef FAKE_LOGBUF
+#include "logBuf.hpp"
+
+// Las líneas se guardan ya formateadas (con HOST_LOG=1 también a stdout)
+inline std::vector<std::string> g_fakeLog;
+
+void logbuf_pushf(const char *fmt, ...)
+{
+  char t[LOGBUF_LINE];
+  va_list a;
+  va_start(a, fmt);
+  vsnprintf(t, sizeof(t), fmt, a);
+  va_end(a);
+  g_fakeLog.push_back(t);
+  if (getenv("HOST_LOG"))
+    printf("[log] %s\n", t);
+}
+void logbuf_begin() {}
+void logbuf_enable(bool) {}
+bool logbuf_enabled() { return true; }
+void logbuf_clear() { g_fakeLog.clear(); }
+
+inline bool fakeLogHas(const char *needle)
+{
+  for (auto &l : g_fakeLog)
+    if (l.find(needle) != std::string::npos)
+      return true;
+  return false;
+}
+#endif
+
+#ifdef FAKE_JSON
+#include "json.hpp"
+
+// Qué ha pedido serializar y qué respuesta ha llegado a cada descifrador
+struct FakeJson
+{
+  uint32_t serialized = 0;
+  uint32_t resets = 0;
+  std::vector<std::string> estado, qr, paso;
+};
+inline FakeJson g_fakeJson;
+
+static void fakeSerialize(String &out, const char *kind)
+{
+  g_fakeJson.serialized++;
+  out = String("{\"kind\":\"") + kind + "\",\"n\":" + String(g_fakeJson.serialized) + "}";
+}
+
+void serializaInicio() { fakeSerialize(outputInicio, "inicio"); }
+void serializaEstado() { fakeSerialize(outputEstado, "estado"); }
+void serializaQR() { fakeSerialize(outputTicket, "qr"); }
+void serializaPaso() { fakeSerialize(outputPaso, "paso"); }
+void serializaReportFailure() { fakeSerialize(outputReportFailure, "failure"); }
+void descifraEstado(const char *json, size_t len) { g_fakeJson.estado.emplace_back(json, len); }
+void descifraQR(const char *json, size_t len) { g_fakeJson.qr.emplace_back(json, len); }
+void descifraPaso(const char *json, size_t len) { g_fakeJson.paso.emplace_back(json, len); }
+void resetCycleReady() { g_fakeJson.resets++; }
+#endif
+
+#ifdef FAKE_FW_UPDATE
+#include "fw_update.hpp"
+
+// Partición OTA inactiva en memoria y una imagen "en ejecución" que fija la prueba
+struct FakeFw
+{
+  bool active = false;
+  std::vector<uint8_t> written;
+  std::vector<uint8_t> running;
+  const char *error = "";
+  uint32_t begins = 0, ends = 0, aborts = 0;
+};
+inline FakeFw g_fakeFw;
+
+bool fwUpdateBegin(size_t)
+{
+  g_fakeFw.active = true;
+  g_fakeFw.written.clear();
+  g_fakeFw.begins++;
+  return true;
+}
+bool fwUpdateWrite(const uint8_t *data, size_t len)
+{
+  if (!g_fakeFw.active)
+    return false;
+  g_fakeFw.written.insert(g_fakeFw.written.end(), data, data + len);
+  return true;
+}
+bool fwUpdateEnd(const char *)
+{
+  g_fakeFw.active = false;
+  g_fakeFw.ends++;
+  return true;
+}
+void fwUpdateAbort()
+{
+  g_fakeFw.active = false;
+  g_fakeFw.aborts++;
+}
+bool fwUpdateActive() { return g_fakeFw.active; }
+size_t fwUpdateWritten() { return g_fakeFw.written.size(); }
+const char *fwUpdateError() { return g_fakeFw.error; }
+void fwUpdateDigestHex(char out[65]) { memset(out, '0', 64), out[64] = 0; }
+bool fwRunningRead(uint32_t offset, uint8_t *buf, size_t len)
+{
+  if ((size_t)offset + len > g_fakeFw.running.size())
+    return false;
+  memcpy(buf, g_fakeFw.running.data() + offset, len);
+  return true;
+}
+bool fwRunningSha256(size_t, uint8_t out[32])
+{
+  memset(out, 0, 32);
+  return true;
+}
+void fwUpdateBootCheck() {}
+bool fwUpdatePendingVerify() { return false; }
+void fwUpdateVerifyLoop(bool, bool) {}
+#endif
+
+#ifdef FAKE_TIME
+#include "time.hpp"
+
+// Hora local que fija la prueba; valid = false equivale a no haber sincronizado
+struct FakeTime
+{
+  bool valid = false;
+  unsigned long secOfDay = 0;
+  time_t epoch = 1700000000;
+};
+inline FakeTime g_fakeTime;
+
+void configurarZonaHoraria() {}
+bool syncHoraInicio(uint32_t) { return g_fakeTime.valid; }
+void loop_time_sync(uint32_t) {}
+unsigned long segundosActualesDelDia() { return g_fakeTime.valid ? g_fakeTime.secOfDay : 0; }
+bool horaLocal_HHMMSS(char out[9])
+{
+  if (!g_fakeTime.valid)
+    return false;
+  const unsigned long s = g_fakeTime.secOfDay;
+  snprintf(out, 9, "%02lu:%02lu:%02lu", s / 3600, (s / 60) % 60, s % 60);
+  return true;
+}
+bool horaLocal_ISO(char out[20])
+{
+  if (!g_fakeTime.valid)
+    return false;
+  const unsigned long s = g_fakeTime.secOfDay;
+  snprintf(out, 20, "2024-01-01 %02lu:%02lu:%02lu", s / 3600, (s / 60) % 60, s % 60);
+  return true;
+}
+time_t epochActual() { return g_fakeTime.valid ? g_fakeTime.epoch : (time_t)-1; }
+#endif
@@ -0,0 +1,112 @@
+// bench.hpp — medidas para las pruebas de rendimiento del host: tiempo real
+// (no el reloj simulado) y memoria dinámica. Sustituye el operator new global,
+// así que solo se puede incluir en un .cpp por prueba.
+//
+// Los números son del PC, no del ESP32-S3: sirven para comparar variantes y
+// vigilar regresiones (reservas por operación, memoria viva), no como valor
+// absoluto.
+#pragma once
+
+#include <chrono>
+#include <new>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct BenchHeap
+{
+  uint64_t allocs; // reservas hechas
+  uint64_t bytes;  // bytes pedidos en total
+  int64_t live;    // bytes vivos ahora
+  int64_t peak;    // máximo de 'live' desde el último benchHeapMark()
+};
+
+inline BenchHeap g_benchHeap = {0, 0, 0, 0};
+
+// Cabecera delante de cada bloque con su tamaño (para llevar la cuenta de lo vivo)
+static const size_t BENCH_HDR = 16;
+
+void *operator new(size_t n)
+{
+  uint8_t *p = (uint8_t *)malloc(n + BENCH_HDR);
+  if (!p)
+    throw std::bad_alloc();
+  *(size_t *)p = n;
+  g_benchHeap.allocs++;
+  g_benchHeap.bytes += n;
+  g_benchHeap.live += (int64_t)n;
+  if (g_benchHeap.live > g_benchHeap.peak)
+    g_benchHeap.peak = g_benchHeap.live;
+  return p + BENCH_HDR;
+}
+void *operator new[](size_t n) { return operator new(n); }
+void *operator new(size_t n, const std::nothrow_t &) noexcept
+{
+  try
+  {
+    return operator new(n);
+  }
+  catch (...)
+  {
+    return nullptr;
+  }
+}
+void *operator new[](size_t n, const std::nothrow_t &t) noexcept { return operator new(n, t); }
+void operator delete(void *q) noexcept
+{
+  if (!q)
+    return;
+  uint8_t *p = (uint8_t *)q - BENCH_HDR;
+  g_benchHeap.live -= (int64_t)*(size_t *)p;
+  free(p);
+}
+void operator delete[](void *q) noexcept { operator delete(q); }
+void operator delete(void *q, size_t) noexcept { operator delete(q); }
+void operator delete[](void *q, size_t) noexcept { operator delete(q); }
+
+// Pone a cero los contadores y el pico (lo vivo se mantiene)
+inline BenchHeap benchHeapMark()
+{
+  g_benchHeap.allocs = 0;
+  g_benchHeap.bytes = 0;
+  g_benchHeap.peak = g_benchHeap.live;
+  return g_benchHeap;
+}
+
+// Reservas/bytes desde 'm' y pico por encima de lo vivo en 'm'
+inline BenchHeap benchHeapSince(const BenchHeap &m)
+{
+  BenchHeap d = g_benchHeap;
+  d.peak -= m.live;
+  d.live -= m.live;
+  return d;
+}
+
+inline uint64_t benchNowNs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Ejecuta fn() 'iters' veces y devuelve ns por iteración
+template <typename F>
+inline double benchNsPerIter(uint32_t iters, F fn)
+{
+  const uint64_t t0 = benchNowNs();
+  for (uint32_t i = 0; i < iters; i++)
+    fn();
+  return (double)(benchNowNs() - t0) / (iters ? iters : 1);
+}
+
+// Resultado en una línea (aparece en la salida de pio test -v)
+inline void benchReport(const char *name, const char *fmt, ...)
+{
+  char t[256];
+  va_list a;
+  va_start(a, fmt);
+  vsnprintf(t, sizeof(t), fmt, a);
+  va_end(a);
+  printf("[bench] %-34s %s\n", name, t);
+}
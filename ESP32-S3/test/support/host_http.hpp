@@ -0,0 +1,156 @@
+// host_http.hpp — servidor HTTP/1.1 de prueba sobre los sockets simulados de
+// test/stubs/Client.h. Hace de backend: guarda cada petición recibida y
+// contesta lo que la prueba tenga en cola (o la respuesta por defecto), con
+// retardo opcional, keep-alive o cierre, y fallos a propósito (cerrar sin
+// responder, no contestar nunca).
+#pragma once
+
+#include <Client.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+struct HostHttpRequest
+{
+  std::string method;
+  std::string path;
+  std::string headers; // en bruto, con "\r\n" entre líneas
+  std::string body;
+  uint32_t conn;       // número de conexión TCP por la que llegó (desde 1)
+  uint64_t atUs;       // instante en que se completó
+
+  bool hasHeader(const char *line) const { return headers.find(line) != std::string::npos; }
+};
+
+struct HostHttpReply
+{
+  int status = 200;
+  std::string body = "{}";
+  std::string contentType = "application/json";
+  bool keepAlive = true;
+  uint32_t delayMs = 0;   // retardo antes de la respuesta
+  bool drop = false;      // cierra la conexión sin responder
+  bool silent = false;    // no responde ni cierra
+  bool closeAfter = false; // responde sin "Connection: close" y cierra igual
+  std::string raw;        // si no está vacía se envía tal cual
+};
+
+class HostHttpServer : public HostServer
+{
+public:
+  std::vector<HostHttpRequest> requests;
+  std::deque<HostHttpReply> script; // respuestas pendientes, en orden
+  HostHttpReply fallback;           // cuando 'script' está vacía
+  uint32_t accepted = 0;
+  bool refuse = false;
+
+  explicit HostHttpServer(uint16_t port) { hostListen(port, this); }
+
+  bool onAccept(const std::shared_ptr<HostEnd> &e) override
+  {
+    if (refuse)
+      return false;
+    _conns.push_back({e, ++accepted, std::string()});
+    return true;
+  }
+
+  void onData(const std::shared_ptr<HostEnd> &e) override
+  {
+    Conn *c = find(e);
+    if (!c)
+      return;
+    c->buf += e->readAll();
+    for (;;)
+    {
+      const size_t hdrEnd = c->buf.find("\r\n\r\n");
+      if (hdrEnd == std::string::npos)
+        return;
+      size_t bodyLen = 0;
+      const std::string head = c->buf.substr(0, hdrEnd + 2);
+      const size_t cl = lower(head).find("content-length:");
+      if (cl != std::string::npos)
+        bodyLen = strtoul(head.c_str() + cl + 15, nullptr, 10);
+      if (c->buf.size() < hdrEnd + 4 + bodyLen)
+        return;
+
+      HostHttpRequest r;
+      const size_t sp1 = head.find(' ');
+      const size_t sp2 = head.find(' ', sp1 + 1);
+      r.method = head.substr(0, sp1);
+      r.path = head.substr(sp1 + 1, sp2 - sp1 - 1);
+      r.headers = head;
+      r.body = c->buf.substr(hdrEnd + 4, bodyLen);
+      r.conn = c->id;
+      r.atUs = g_hostUs;
+      c->buf.erase(0, hdrEnd + 4 + bodyLen);
+      requests.push_back(r);
+
+      HostHttpReply rep = fallback;
+      if (!script.empty())
+      {
+        rep = script.front();
+        script.pop_front();
+      }
+      respond(*e, rep);
+    }
+  }
+
+  // Cierra desde el servidor todas las conexiones abiertas (p. ej. por inactividad)
+  void closeAll()
+  {
+    for (auto &c : _conns)
+      if (auto e = c.end.lock())
+        e->close();
+  }
+
+  static std::string response(const HostHttpReply &rep)
+  {
+    if (!rep.raw.empty())
+      return rep.raw;
+    char h[256];
+    snprintf(h, sizeof(h), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: %s\r\n\r\n",
+             rep.status, rep.status < 300 ? "OK" : "Error", rep.contentType.c_str(),
+             (unsigned)rep.body.size(), rep.keepAlive ? "keep-alive" : "close");
+    return std::string(h) + rep.body;
+  }
+
+private:
+  struct Conn
+  {
+    std::weak_ptr<HostEnd> end;
+    uint32_t id;
+    std::string buf;
+  };
+  std::vector<Conn> _conns;
+
+  Conn *find(const std::shared_ptr<HostEnd> &e)
+  {
+    for (auto &c : _conns)
+      if (c.end.lock() == e)
+        return &c;
+    return nullptr;
+  }
+
+  static std::string lower(std::string s)
+  {
+    for (auto &ch : s)
+      ch = (char)tolower((unsigned char)ch);
+    return s;
+  }
+
+  static void respond(HostEnd &e, const HostHttpReply &rep)
+  {
+    const uint64_t at = g_hostUs + (uint64_t)rep.delayMs * 1000;
+    if (rep.drop)
+    {
+      e.close(at - g_hostUs);
+      return;
+    }
+    if (rep.silent)
+      return;
+    const std::string out = response(rep);
+    e.writeAt(at, (const uint8_t *)out.data(), out.size());
+    if (!rep.keepAlive || rep.closeAfter)
+      e.close(at - g_hostUs);
+  }
+};
@@ -0,0 +1,271 @@
+// turnstile_emu.hpp — tornos de prueba en el bus RS485 simulado (Serial2).
+//
+// Cada trama que escribe el maestro queda registrada con su instante y su
+// tiempo en el cable a RS485_BAUD. Los tornos dados de alta contestan a la
+// consulta 0x10 con su trama de estado 0x7F de 18 bytes, que llega al UART
+// (Serial2.hostRx, como el evento de FIFO lleno) al terminar de transmitirse.
+// Con el guion de cada torno se pierden respuestas, se contesta con otro id,
+// se responde sin ejecutar la orden (o sin eco de ella) o el torno se queda mudo.
+//
+// También cuenta colisiones: el maestro transmitiendo mientras el cable está
+// ocupado (su trama anterior o una respuesta todavía en vuelo).
+#pragma once
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+#include <deque>
+#include <vector>
+
+#include "RS485.hpp"
+
+// Duración en el cable a 8N1
+inline uint64_t emuWireUs(size_t bytes)
+{
+  return (uint64_t)bytes * 10ULL * 1000000ULL / RS485_BAUD;
+}
+
+struct EmuTx
+{
+  uint64_t startUs, endUs;
+  uint8_t b[8];
+  uint8_t machine() const { return b[2]; }
+  uint8_t cmd() const { return b[3]; }
+};
+
+struct EmuTurnstile
+{
+  uint8_t id = MACHINE_ID;
+
+  // Guion
+  bool mute = false;            // no contesta nunca
+  uint32_t dropReplies = 0;     // respuestas que se pierden (las siguientes N)
+  uint32_t corruptReplies = 0;  // respuestas con el checksum roto (las siguientes N)
+  uint32_t ignoreCmds = 0;      // órdenes que "no ejecuta" (las siguientes N)
+  uint8_t replyAs = 0;          // contesta con este id (0 = el suyo)
+  uint32_t replyDelayUs = 3000; // del fin de la consulta al primer byte
+  bool corruptParams = false;   // guarda el parámetro con otro valor
+  bool noEcho = false;          // firmware sin eco: commandExecStatus siempre a 0
+
+  // Estado del torno
+  uint8_t gate = 0;
+  uint8_t cmdExec = 0;
+  uint32_t left = 0, right = 0;
+  uint8_t params[64] = {};
+  uint8_t lastRead = 0;
+
+  // Lo que ha recibido
+  uint32_t queries = 0, opens = 0, closes = 0, paramWrites = 0, paramReads = 0, replies = 0;
+};
+
+struct EmuReply
+{
+  uint64_t startUs, endUs;
+  std::vector<uint8_t> b;
+};
+
+class TurnstileBus
+{
+public:
+  std::vector<EmuTurnstile> units;
+  std::vector<EmuTx> tx;        // todo lo que transmitió el maestro
+  std::deque<EmuReply> pending; // respuestas aún en el cable o por salir
+  std::vector<EmuReply> sent;   // respuestas ya entregadas al UART
+  uint32_t collisions = 0;
+
+  // Un torno por id (MACHINE_ID si no se indica otro)
+  explicit TurnstileBus(std::initializer_list<uint8_t> ids = {MACHINE_ID})
+  {
+    for (uint8_t id : ids)
+    {
+      EmuTurnstile t;
+      t.id = id;
+      units.push_back(t);
+    }
+  }
+
+  // Engancha el bus a Serial2 y al reloj (tras hostReset(), que quita ganchos)
+  void attach()
+  {
+    Serial2.hostTx = [this](const uint8_t *b, size_t n)
+    { onMasterTx(b, n); };
+    hostOnTick([this]()
+               { deliver(); });
+  }
+  void detach() { Serial2.hostTx = nullptr; }
+
+  EmuTurnstile &unit(uint8_t id)
+  {
+    for (auto &u : units)
+      if (u.id == id)
+        return u;
+    return units.front();
+  }
+
+  // Trama de estado espontánea de un torno que empieza a salir dentro de 'inUs'
+  void spontaneous(uint8_t id, uint64_t inUs)
+  {
+    schedule(unit(id), id, hostNowUs() + inUs);
+  }
+
+  // Tramas del maestro con esta orden (0 = todas)
+  std::vector<EmuTx> sentCmd(uint8_t cmd = 0, uint8_t machine = 0) const
+  {
+    std::vector<EmuTx> r;
+    for (auto &t : tx)
+      if ((!cmd || t.cmd() == cmd) && (!machine || t.machine() == machine))
+        r.push_back(t);
+    return r;
+  }
+
+  void clearLog()
+  {
+    tx.clear();
+    sent.clear();
+    collisions = 0;
+  }
+
+  // Cable libre (nada del maestro ni de los tornos) desde cuándo
+  uint64_t lastActivityEndUs() const
+  {
+    uint64_t end = 0;
+    for (auto &t : tx)
+      end = std::max(end, t.endUs);
+    for (auto &r : sent)
+      end = std::max(end, r.endUs);
+    return end;
+  }
+
+private:
+  bool busy(uint64_t startUs, uint64_t endUs) const
+  {
+    if (!tx.empty() && startUs < tx.back().endUs)
+      return true;
+    for (auto &r : pending)
+      if (startUs < r.endUs && r.startUs < endUs)
+        return true;
+    return false;
+  }
+
+  void onMasterTx(const uint8_t *b, size_t n)
+  {
+    EmuTx t = {};
+    t.startUs = hostNowUs();
+    t.endUs = t.startUs + emuWireUs(n);
+    memcpy(t.b, b, n < 8 ? n : 8);
+    if (busy(t.startUs, t.endUs))
+      collisions++;
+    tx.push_back(t);
+    if (n != 8 || b[0] != 0x7E)
+      return;
+
+    uint8_t sum = 0;
+    for (int i = 0; i < 7; i++)
+      sum += b[i];
+    if ((uint8_t)~sum != b[7])
+      return; // trama rota: el torno la ignora
+
+    for (auto &u : units)
+      if (u.id == t.machine())
+        onCommand(u, t);
+  }
+
+  void onCommand(EmuTurnstile &u, const EmuTx &t)
+  {
+    const uint8_t cmd = t.cmd();
+    if (cmd == 0x10)
+    {
+      u.queries++;
+      if (u.mute)
+        return;
+      if (u.dropReplies > 0)
+      {
+        u.dropReplies--;
+        return;
+      }
+      schedule(u, u.replyAs ? u.replyAs : u.id, t.endUs + u.replyDelayUs);
+      if (u.corruptReplies > 0)
+      {
+        u.corruptReplies--;
+        pending.back().b[17] ^= 0x5A;
+      }
+      return;
+    }
+
+    if (u.ignoreCmds > 0)
+    {
+      u.ignoreCmds--;
+      return;
+    }
+    switch (cmd)
+    {
+    case 0x80:
+    case 0x82:
+      u.opens++;
+      u.gate = 1;
+      if (cmd == 0x80)
+        u.left++;
+      else
+        u.right++;
+      break;
+    case 0x84:
+      u.closes++;
+      u.gate = 0;
+      break;
+    case 0x96:
+      u.paramWrites++;
+      if (t.b[4] < 64)
+        u.params[t.b[4]] = u.corruptParams ? (uint8_t)(t.b[5] ^ 1) : t.b[5];
+      break;
+    case 0x97:
+      u.paramReads++;
+      if (t.b[4] < 64)
+        u.lastRead = u.params[t.b[4]];
+      break;
+    default:
+      break;
+    }
+    u.cmdExec = u.noEcho ? 0 : cmd;
+  }
+
+  void schedule(EmuTurnstile &u, uint8_t id, uint64_t atUs)
+  {
+    EmuReply r;
+    r.b.assign(18, 0);
+    r.b[0] = 0x7F;
+    r.b[1] = 0x01;
+    r.b[2] = id;
+    r.b[4] = u.gate;
+    r.b[6] = (uint8_t)(u.left >> 16);
+    r.b[7] = (uint8_t)(u.left >> 8);
+    r.b[8] = (uint8_t)u.left;
+    r.b[9] = (uint8_t)(u.right >> 16);
+    r.b[10] = (uint8_t)(u.right >> 8);
+    r.b[11] = (uint8_t)u.right;
+    r.b[13] = u.cmdExec;
+    r.b[14] = 0xE0;
+    r.b[15] = u.lastRead;
+    uint8_t sum = 0;
+    for (int i = 0; i < 17; i++)
+      sum += r.b[i];
+    r.b[17] = (uint8_t)~sum;
+
+    // Después de lo que ya esté en el cable (el bus es uno)
+    if (!pending.empty() && atUs < pending.back().endUs)
+      atUs = pending.back().endUs;
+    r.startUs = atUs;
+    r.endUs = atUs + emuWireUs(18);
+    pending.push_back(r);
+    u.replies++;
+  }
+
+  void deliver()
+  {
+    while (!pending.empty() && pending.front().endUs <= hostNowUs())
+    {
+      EmuReply r = pending.front();
+      pending.pop_front();
+      sent.push_back(r);
+      Serial2.hostRx(r.b.data(), r.b.size());
+    }
+  }
+};
@@ -3,6 +3,7 @@ package com.qualicard.museo_elder_backend.controller;
 import com.qualicard.museo_elder_backend.config.domain.Direction;
 import com.qualicard.museo_elder_backend.config.domain.StatusCode;
 import com.qualicard.museo_elder_backend.service.CoreService;
+import com.qualicard.museo_elder_backend.service.RolloutService;
 import com.qualicard.museo_elder_backend.service.dto.StatusInicioReq;
 import com.qualicard.museo_elder_backend.service.dto.ValidatePassReq;
 import com.qualicard.museo_elder_backend.service.dto.ValidateQRReq;
@@ -30,10 +31,12 @@ public class ESPController {
 
     private final CoreService core;
     private final TicketMemory ticketMemory;
+    private final RolloutService rollout;
 
-    public ESPController(CoreService core, TicketMemory ticketMemory) {
+    public ESPController(CoreService core, TicketMemory ticketMemory, RolloutService rollout) {
         this.core = core;
         this.ticketMemory = ticketMemory;
+        this.rollout = rollout;
     }
 
     // =================== Helpers comunes ===================
@@ -68,8 +71,10 @@ public class ESPController {
     private enum Kind { TEC, ODOO, MAGE, UNKNOWN }
 
     // =========================================================
-    // 1) /status  -> SOLO exige id; ignora el resto y responde fijo
+    // 1) /status  -> SOLO exige id; responde fijo salvo franja de actualización
     //    Respuesta: {"r":"ok","id":"<ID>","status":"200","ec":"CMD_READY"}
+    //    Con despliegue activo (RolloutService), al equipo que le toca:
+    //    {"r":"ok","id":"<ID>","status":"310","ec":"CMD_UPDATE","slot":"<s>","window":"<s>"}
     // =========================================================
     @PostMapping(path = "/status", consumes = MediaType.APPLICATION_JSON_VALUE)
     public ResponseEntity<Map<String,String>> status(@RequestBody(required = false) Map<String, Object> body){
@@ -84,10 +89,22 @@ public class ESPController {
             log.info("[STATUS][REQ] ERROR id vacío");
             return ResponseEntity.badRequest().body(ko("400","id vacío"));
         }
-        log.info("[STATUS][RES] id={} status_tx=200 ec_tx=CMD_READY", id);
-
         Map<String,String> resp = ok(null);
         resp.put("id", id);
+
+        Object ota = body.get("ota");
+        Optional<RolloutService.Slot> slot = rollout.onHeartbeat(id, ota instanceof Map<?, ?> m ? m : null);
+        if (slot.isPresent()) {
+            log.info("[STATUS][RES] id={} status_tx=310 ec_tx=CMD_UPDATE slot={}s window={}s",
+                    id, slot.get().delayS(), slot.get().windowS());
+            resp.put("status", StatusCode.UPDATE);
+            resp.put("ec", StatusCode.EC_UPDATE);
+            resp.put("slot", String.valueOf(slot.get().delayS()));
+            resp.put("window", String.valueOf(slot.get().windowS()));
+            return ResponseEntity.ok(resp);
+        }
+
+        log.info("[STATUS][RES] id={} status_tx=200 ec_tx=CMD_READY", id);
         resp.put("status", "200");
         resp.put("ec", "CMD_READY");
         return ResponseEntity.ok(resp);
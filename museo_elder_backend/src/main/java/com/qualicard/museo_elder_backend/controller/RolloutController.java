@@ -0,0 +1,151 @@
+package com.qualicard.museo_elder_backend.controller;
+
+import com.qualicard.museo_elder_backend.service.RolloutService;
+import org.slf4j.Logger;
+import org.slf4j.LoggerFactory;
+import org.springframework.beans.factory.annotation.Value;
+import org.springframework.http.HttpHeaders;
+import org.springframework.http.HttpStatus;
+import org.springframework.http.MediaType;
+import org.springframework.http.ResponseEntity;
+import org.springframework.web.bind.annotation.*;
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.Paths;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * Despliegue escalonado de firmware (ver RolloutService).
+ *
+ *   POST /QRDService/rollout/start  {"version":"V.1.9","maxParallel":2}
+ *   POST /QRDService/rollout/stop
+ *   GET  /QRDService/rollout        estado por carril
+ *   GET  /QRDService/rollout/firmware   (urlActualiza de los equipos)
+ *
+ * La imagen sale de app.rollout.firmware-dir según lo que acepte el equipo
+ * (X-Firmware-Accept) y la versión que tiene (X-Firmware-Version):
+ *   &lt;target&gt;_from_&lt;version&gt;.meot   diferencial (scripts/ota_pack.py --base)
+ *   &lt;target&gt;.meot                  comprimida
+ *   &lt;target&gt;.bin                   completa
+ * Con Range/If-Range para que el equipo reanude tras un corte.
+ */
+@RestController
+@RequestMapping(path = "/QRDService/rollout")
+public class RolloutController {
+
+    private static final Logger log = LoggerFactory.getLogger(RolloutController.class);
+
+    private final RolloutService rollout;
+
+    @Value("${app.rollout.firmware-dir:./firmware}")
+    private String firmwareDir;
+
+    public RolloutController(RolloutService rollout) {
+        this.rollout = rollout;
+    }
+
+    @PostMapping(path = "/start", consumes = MediaType.APPLICATION_JSON_VALUE, produces = MediaType.APPLICATION_JSON_VALUE)
+    public ResponseEntity<Map<String, Object>> start(@RequestBody Map<String, Object> body) {
+        String version = body == null ? "" : String.valueOf(body.getOrDefault("version", "")).trim();
+        if (version.isEmpty()) {
+            Map<String, Object> ko = new HashMap<>();
+            ko.put("r", "ko");
+            ko.put("ed", "version vacía");
+            return ResponseEntity.badRequest().body(ko);
+        }
+        if (!Files.isRegularFile(Paths.get(firmwareDir, version + ".bin"))) {
+            Map<String, Object> ko = new HashMap<>();
+            ko.put("r", "ko");
+            ko.put("ed", "falta " + Paths.get(firmwareDir, version + ".bin"));
+            return ResponseEntity.status(HttpStatus.NOT_FOUND).body(ko);
+        }
+        Integer parallel = null;
+        Object p = body.get("maxParallel");
+        if (p != null) {
+            try { parallel = Integer.parseInt(String.valueOf(p)); } catch (NumberFormatException ignore) {}
+        }
+        rollout.start(version, parallel);
+        return ResponseEntity.ok(rollout.snapshot());
+    }
+
+    @PostMapping(path = "/stop", produces = MediaType.APPLICATION_JSON_VALUE)
+    public Map<String, Object> stop() {
+        rollout.stop();
+        return rollout.snapshot();
+    }
+
+    @GetMapping(produces = MediaType.APPLICATION_JSON_VALUE)
+    public Map<String, Object> status() {
+        return rollout.snapshot();
+    }
+
+    @GetMapping(path = "/firmware")
+    public ResponseEntity<byte[]> firmware(
+            @RequestHeader(value = "X-Firmware-Version", required = false) String version,
+            @RequestHeader(value = "X-Firmware-Accept", required = false) String accept,
+            @RequestHeader(value = HttpHeaders.RANGE, required = false) String range,
+            @RequestHeader(value = HttpHeaders.IF_RANGE, required = false) String ifRange) throws IOException {
+
+        String target = rollout.target();
+        if (target == null) {
+            log.info("[FIRMWARE][RES] http=404 sin despliegue activo (version={})", version);
+            return ResponseEntity.notFound().build();
+        }
+
+        // Lo mejor que acepte el equipo
+        String acc = accept == null ? "bin" : accept;
+        Path file = Paths.get(firmwareDir, target + ".bin");
+        String kind = "bin";
+        Path delta = Paths.get(firmwareDir, target + "_from_" + version + ".meot");
+        Path lz = Paths.get(firmwareDir, target + ".meot");
+        if (version != null && acc.contains("delta") && Files.isRegularFile(delta)) {
+            file = delta;
+            kind = "delta";
+        } else if (acc.contains("lz") && Files.isRegularFile(lz)) {
+            file = lz;
+            kind = "lz";
+        }
+        if (!Files.isRegularFile(file)) {
+            log.warn("[FIRMWARE][RES] http=404 falta {}", file);
+            return ResponseEntity.notFound().build();
+        }
+
+        byte[] data = Files.readAllBytes(file);
+        String etag = "\"" + file.getFileName() + "-" + data.length + "-"
+                + Files.getLastModifiedTime(file).toMillis() + "\"";
+
+        HttpHeaders h = new HttpHeaders();
+        h.setContentType(MediaType.APPLICATION_OCTET_STREAM);
+        h.setETag(etag);
+        h.set(HttpHeaders.ACCEPT_RANGES, "bytes");
+        h.set("X-Firmware-Kind", kind);
+
+        // Range: "bytes=<desde>-[<hasta>]" (If-Range distinto = fichero cambiado → completo)
+        long from = -1, to = data.length - 1L;
+        if (range != null && range.startsWith("bytes=") && (ifRange == null || ifRange.equals(etag))) {
+            String[] r = range.substring(6).split("-", 2);
+            try {
+                from = Long.parseLong(r[0].trim());
+                if (r.length > 1 && !r[1].isBlank()) to = Math.min(to, Long.parseLong(r[1].trim()));
+            } catch (NumberFormatException e) {
+                from = -1;
+            }
+        }
+
+        if (from < 0) {
+            log.info("[FIRMWARE][RES] http=200 version={} -> {} kind={} bytes={}", version, target, kind, data.length);
+            return new ResponseEntity<>(data, h, HttpStatus.OK);
+        }
+        if (from >= data.length || from > to) {
+            h.set(HttpHeaders.CONTENT_RANGE, "bytes */" + data.length);
+            return new ResponseEntity<>(h, HttpStatus.REQUESTED_RANGE_NOT_SATISFIABLE);
+        }
+        h.set(HttpHeaders.CONTENT_RANGE, "bytes " + from + "-" + to + "/" + data.length);
+        log.info("[FIRMWARE][RES] http=206 version={} -> {} kind={} range={}-{}/{}", version, target, kind, from, to, data.length);
+        return new ResponseEntity<>(Arrays.copyOfRange(data, (int) from, (int) to + 1), h, HttpStatus.PARTIAL_CONTENT);
+    }
+}
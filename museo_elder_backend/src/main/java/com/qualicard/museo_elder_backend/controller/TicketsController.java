@@ -62,6 +62,7 @@ public class TicketsController {
     // =========================================================
     // A2) POST /entries   (NUEVO) — recibe JSON {id,status,ec} y
     //      responde TEXTO PLANO en formato v2: "OK\n<code>:HH:MM;\n..."
+    //      (entradas de grupo: "<code>:HH:MM;<pasos>", el firmware guarda los pasos)
     //      1) Si existe entradas/entradas.txt en classpath => lo sirve tal cual
     //      2) Si no, genera desde EntryStore a formato v2
     // =========================================================
@@ -92,8 +93,9 @@ public class TicketsController {
             sb.append(e.key).append(':')
                     .append(String.format("%02d", e.time.getHour())).append(':')
                     .append(String.format("%02d", e.time.getMinute()))
-                    .append(';')
-                    .append('\n');
+                    .append(';');
+            if (e.pasos > 1) sb.append(e.pasos);
+            sb.append('\n');
         }
         String body = sb.toString();
         log.info("[ENTRIES][POST][BUILT] id={} bytes={}", req.id, body.getBytes(StandardCharsets.UTF_8).length);
@@ -0,0 +1,343 @@
+package com.qualicard.museo_elder_backend.service;
+
+import org.slf4j.Logger;
+import org.slf4j.LoggerFactory;
+import org.springframework.beans.factory.annotation.Value;
+import org.springframework.stereotype.Service;
+
+import java.time.Clock;
+import java.time.Duration;
+import java.time.Instant;
+import java.util.*;
+
+/**
+ * Despliegue escalonado de firmware (mock).
+ *
+ * Cada latido /status trae un bloque "ota" con disponibilidad, carga y avance
+ * del equipo. Con eso se decide a quién se le da franja (status 310 + "slot"
+ * y "window" en segundos):
+ *  - nunca dos carriles del mismo torno a la vez: el otro carril tiene que
+ *    estar en línea y sin actualización en curso o a prueba;
+ *  - como mucho maxParallel equipos actualizando en toda la flota;
+ *  - las franjas se separan slotSpacing segundos entre sí;
+ *  - solo equipos que se declaran listos y en reposo ("load":"idle").
+ * El primer fallo (descarga abandonada, vuelta a la versión anterior o sin
+ * noticias tras la franja) detiene el despliegue hasta un nuevo /start.
+ */
+@Service
+public class RolloutService {
+
+    private static final Logger log = LoggerFactory.getLogger(RolloutService.class);
+
+    public enum Phase { PENDING, SCHEDULED, UPDATING, VERIFYING, DONE, FAILED }
+
+    /** Franja asignada: empieza dentro de delayS segundos y dura windowS */
+    public record Slot(long delayS, long windowS) {}
+
+    /** Estado de un carril (un equipo) */
+    private static final class Lane {
+        final String id;
+        final String turnstile;
+        String version = "";
+        boolean ready = false;
+        String load = "?";
+        String fwPhase = "?";     // fase que anuncia el firmware
+        int pct = 0;
+        String fwError = "";
+        Instant lastSeen = Instant.EPOCH;
+
+        Phase phase = Phase.PENDING;
+        Instant slotAt;
+        Instant slotEnd;
+        Instant startedAt;
+        int attempts = 0;
+        String reason = "";
+
+        Lane(String id, String turnstile) {
+            this.id = id;
+            this.turnstile = turnstile;
+        }
+    }
+
+    @Value("${app.rollout.max-parallel:2}")
+    private int maxParallel;
+
+    @Value("${app.rollout.slot-spacing-s:20}")
+    private long slotSpacingS;
+
+    @Value("${app.rollout.window-s:300}")
+    private long windowS;
+
+    @Value("${app.rollout.offline-s:30}")
+    private long offlineS;
+
+    @Value("${app.rollout.update-timeout-s:900}")
+    private long updateTimeoutS;
+
+    /** "ME001+ME002,ME003+ME004": carriles de cada torno (los no listados van solos) */
+    @Value("${app.rollout.turnstiles:}")
+    private String turnstilesCsv;
+
+    /** Reloj de franjas y plazos (las pruebas lo sustituyen) */
+    private Clock clock = Clock.systemUTC();
+
+    private final Map<String, Lane> lanes = new TreeMap<>();
+    private Map<String, String> turnstileOf;
+
+    private String target = null;     // versión objetivo (null = sin despliegue)
+    private boolean halted = false;
+    private String haltReason = "";
+    private Instant nextSlot = Instant.EPOCH;
+
+    // =================== API ===================
+
+    /** Arranca (o reanuda) el despliegue hacia 'version'. Los fallidos vuelven a la cola. */
+    public synchronized void start(String version, Integer parallel) {
+        target = version;
+        if (parallel != null && parallel > 0) maxParallel = parallel;
+        halted = false;
+        haltReason = "";
+        nextSlot = Instant.now(clock);
+        for (Lane l : lanes.values()) {
+            if (target.equals(l.version)) {
+                l.phase = "verify".equals(l.fwPhase) ? Phase.VERIFYING : Phase.DONE;
+            } else if (l.phase == Phase.FAILED || l.phase == Phase.DONE) {
+                l.phase = Phase.PENDING;
+                l.reason = "";
+            }
+        }
+        log.info("[ROLLOUT] start target={} maxParallel={} spacing={}s window={}s",
+                target, maxParallel, slotSpacingS, windowS);
+    }
+
+    /** Deja de asignar franjas. Las ya asignadas siguen su curso en el equipo. */
+    public synchronized void stop() {
+        log.info("[ROLLOUT] stop target={}", target);
+        target = null;
+    }
+
+    public synchronized String target() {
+        return target;
+    }
+
+    /**
+     * Latido de un equipo. 'ota' es el bloque "ota" del /status (null si el
+     * firmware no lo envía: ese equipo nunca recibe franja).
+     */
+    public synchronized Optional<Slot> onHeartbeat(String id, Map<?, ?> ota) {
+        final Instant now = Instant.now(clock);
+        Lane l = lanes.computeIfAbsent(id, k -> new Lane(k, turnstileOf(k)));
+        l.lastSeen = now;
+        if (ota != null) {
+            l.version = str(ota.get("v"), l.version);
+            l.ready = Boolean.parseBoolean(str(ota.get("ready"), "false"));
+            l.load = str(ota.get("load"), "?");
+            l.fwPhase = str(ota.get("phase"), "?");
+            l.pct = safeInt(str(ota.get("pct"), "0"));
+            l.fwError = str(ota.get("err"), "");
+        } else {
+            l.ready = false;
+            l.fwPhase = "?";
+        }
+
+        if (target == null) return Optional.empty();
+        advance(l, now);
+        expire(now);
+        if (halted) return Optional.empty();
+
+        // Franja asignada que el equipo aún no ha anunciado (respuesta perdida): se repite
+        if (l.phase == Phase.SCHEDULED && "idle".equals(l.fwPhase) && now.isBefore(l.slotEnd)) {
+            return Optional.of(slotFor(l, now));
+        }
+        return tryAssign(l, now);
+    }
+
+    /** Estado del despliegue para GET /QRDService/rollout */
+    public synchronized Map<String, Object> snapshot() {
+        final Instant now = Instant.now(clock);
+        if (target != null) expire(now);
+        Map<String, Object> out = new LinkedHashMap<>();
+        out.put("target", target);
+        out.put("halted", halted);
+        out.put("haltReason", haltReason);
+        out.put("maxParallel", maxParallel);
+        out.put("inFlight", inFlight());
+
+        List<Map<String, Object>> list = new ArrayList<>();
+        for (Lane l : lanes.values()) {
+            Map<String, Object> m = new LinkedHashMap<>();
+            m.put("id", l.id);
+            m.put("turnstile", l.turnstile);
+            m.put("phase", l.phase.name());
+            m.put("version", l.version);
+            m.put("online", online(l, now));
+            m.put("fwPhase", l.fwPhase);
+            m.put("pct", l.pct);
+            m.put("load", l.load);
+            m.put("ready", l.ready);
+            m.put("slotIn", l.phase == Phase.SCHEDULED ? Math.max(0, Duration.between(now, l.slotAt).getSeconds()) : -1);
+            m.put("attempts", l.attempts);
+            m.put("reason", l.reason.isEmpty() ? l.fwError : l.reason);
+            m.put("lastSeenS", Duration.between(l.lastSeen, now).getSeconds());
+            list.add(m);
+        }
+        out.put("lanes", list);
+        return out;
+    }
+
+    // =================== Lógica ===================
+
+    /** Avanza el carril con lo que anuncia el firmware */
+    private void advance(Lane l, Instant now) {
+        if (target.equals(l.version)) {
+            Phase p = "verify".equals(l.fwPhase) ? Phase.VERIFYING : Phase.DONE;
+            if (p != l.phase) log.info("[ROLLOUT] {} {} -> {} (versión {})", l.id, l.phase, p, l.version);
+            l.phase = p;
+            return;
+        }
+
+        switch (l.phase) {
+            case SCHEDULED:
+                if ("download".equals(l.fwPhase) || "reboot".equals(l.fwPhase)) {
+                    l.phase = Phase.UPDATING;
+                    l.startedAt = now;
+                    log.info("[ROLLOUT] {} SCHEDULED -> UPDATING", l.id);
+                } else if ("failed".equals(l.fwPhase)) {
+                    fail(l, "descarga abandonada: " + l.fwError);
+                } else if ("missed".equals(l.fwPhase)) {
+                    requeue(l);
+                }
+                break;
+
+            case UPDATING:
+                if ("failed".equals(l.fwPhase)) {
+                    fail(l, "descarga abandonada: " + l.fwError);
+                } else if ("idle".equals(l.fwPhase) || "missed".equals(l.fwPhase)) {
+                    // Reinició y sigue con la versión anterior (rollback)
+                    fail(l, "sigue en " + l.version + " tras actualizar");
+                }
+                break;
+
+            case VERIFYING:
+                // La imagen nueva no se confirmó y volvió a la anterior
+                fail(l, "rollback a " + l.version);
+                break;
+
+            case DONE:
+                // Otra versión que la objetivo (p.ej. reinstalada a mano)
+                l.phase = Phase.PENDING;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    /**
+     * Plazos de todos los carriles, manden latido o no: un equipo que calla
+     * con franja asignada o a media actualización no se queda su hueco.
+     */
+    private void expire(Instant now) {
+        for (Lane l : lanes.values()) {
+            if (target.equals(l.version)) continue;
+            if (l.phase == Phase.SCHEDULED && now.isAfter(l.slotEnd.plusSeconds(offlineS))) {
+                requeue(l);
+            } else if (l.phase == Phase.UPDATING && now.isAfter(l.startedAt.plusSeconds(updateTimeoutS))) {
+                fail(l, "sin terminar en " + updateTimeoutS + " s");
+            }
+        }
+    }
+
+    /** No estuvo en reposo (o no se supo de él) durante la franja: vuelve a la cola */
+    private void requeue(Lane l) {
+        l.phase = Phase.PENDING;
+        l.reason = "franja perdida";
+        log.info("[ROLLOUT] {} franja perdida -> PENDING", l.id);
+    }
+
+    private Optional<Slot> tryAssign(Lane l, Instant now) {
+        if (l.phase != Phase.PENDING || !l.ready || !"idle".equals(l.load)) return Optional.empty();
+        if (inFlight() >= maxParallel) return Optional.empty();
+
+        // El otro carril del torno tiene que estar dando servicio
+        for (String other : partners(l)) {
+            Lane o = lanes.get(other);
+            if (o == null || !online(o, now) || busy(o)) {
+                l.reason = "esperando a " + other;
+                return Optional.empty();
+            }
+        }
+
+        Instant start = nextSlot.isAfter(now) ? nextSlot : now;
+        nextSlot = start.plusSeconds(slotSpacingS);
+        l.slotAt = start;
+        l.slotEnd = start.plusSeconds(windowS);
+        l.phase = Phase.SCHEDULED;
+        l.attempts++;
+        l.reason = "";
+        Slot s = slotFor(l, now);
+        log.info("[ROLLOUT] {} franja en {}s durante {}s (intento {})", l.id, s.delayS(), s.windowS(), l.attempts);
+        return Optional.of(s);
+    }
+
+    private Slot slotFor(Lane l, Instant now) {
+        long delay = Math.max(0, Duration.between(now, l.slotAt).getSeconds());
+        long window = Math.max(1, Duration.between(now.isAfter(l.slotAt) ? now : l.slotAt, l.slotEnd).getSeconds());
+        return new Slot(delay, window);
+    }
+
+    private void fail(Lane l, String reason) {
+        l.phase = Phase.FAILED;
+        l.reason = reason;
+        halted = true;
+        haltReason = l.id + ": " + reason;
+        log.warn("[ROLLOUT] {} FAILED ({}): despliegue detenido", l.id, reason);
+    }
+
+    /** Fuera de servicio o a punto de estarlo por la actualización */
+    private static boolean busy(Lane l) {
+        return l.phase == Phase.SCHEDULED || l.phase == Phase.UPDATING || l.phase == Phase.VERIFYING;
+    }
+
+    private long inFlight() {
+        return lanes.values().stream().filter(RolloutService::busy).count();
+    }
+
+    private boolean online(Lane l, Instant now) {
+        return Duration.between(l.lastSeen, now).getSeconds() <= offlineS;
+    }
+
+    private List<String> partners(Lane l) {
+        List<String> out = new ArrayList<>();
+        for (Map.Entry<String, String> e : turnstiles().entrySet()) {
+            if (e.getValue().equals(l.turnstile) && !e.getKey().equals(l.id)) out.add(e.getKey());
+        }
+        return out;
+    }
+
+    private String turnstileOf(String id) {
+        return turnstiles().getOrDefault(id, id);
+    }
+
+    /** id del equipo → nombre del torno (el primer carril de la lista) */
+    private Map<String, String> turnstiles() {
+        if (turnstileOf == null) {
+            turnstileOf = new HashMap<>();
+            for (String group : turnstilesCsv.replace(" ", "").split(",")) {
+                if (group.isEmpty()) continue;
+                String[] ids = group.split("\\+");
+                for (String id : ids) turnstileOf.put(id, ids[0]);
+            }
+        }
+        return turnstileOf;
+    }
+
+    private static String str(Object o, String fallback) {
+        return o == null ? fallback : String.valueOf(o);
+    }
+
+    private static int safeInt(String s) {
+        try { return Integer.parseInt(s); }
+        catch (Exception e) { return 0; }
+    }
+}
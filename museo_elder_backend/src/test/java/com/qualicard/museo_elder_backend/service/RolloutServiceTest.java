@@ -0,0 +1,311 @@
+package com.qualicard.museo_elder_backend.service;
+
+import org.junit.jupiter.api.BeforeEach;
+import org.junit.jupiter.api.Test;
+import org.springframework.test.util.ReflectionTestUtils;
+
+import java.time.Clock;
+import java.time.Instant;
+import java.time.ZoneOffset;
+import java.util.*;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * RolloutService sin contexto de Spring: equipos simulados que mandan su
+ * latido con el bloque "ota" y avanzan por las fases del firmware cuando
+ * reciben franja. En cada paso se comprueba que dos carriles del mismo torno
+ * nunca están a la vez fuera de servicio (franja asignada, actualizando o a
+ * prueba) y que no hay más de max-parallel equipos en vuelo.
+ */
+class RolloutServiceTest {
+
+    private static final String OLD = "V.1.8";
+    private static final String TARGET = "V.1.9";
+    private static final String TURNSTILES = "ME001+ME002,ME003+ME004,ME005+ME006,ME007+ME008,ME009+ME010";
+
+    private RolloutService svc;
+
+    /** Lo que anuncia un equipo en su /status */
+    private static final class Equipo {
+        final String id;
+        String version = OLD;
+        String phase = "idle";
+        String load = "idle";
+        boolean ready = true;
+        boolean slot = false;
+        int slots = 0;
+
+        Equipo(String id) {
+            this.id = id;
+        }
+
+        Map<String, Object> ota() {
+            Map<String, Object> m = new HashMap<>();
+            m.put("v", version);
+            m.put("ready", ready);
+            m.put("load", load);
+            m.put("phase", phase);
+            m.put("pct", 0);
+            m.put("err", "");
+            return m;
+        }
+
+        /** Un paso del firmware tras recibir franja: descarga, reinicio, prueba y confirmación */
+        void avanzar() {
+            if (!slot) return;
+            switch (phase) {
+                case "idle" -> phase = "download";
+                case "download" -> phase = "reboot";
+                case "reboot" -> {
+                    version = TARGET;
+                    phase = "verify";
+                }
+                case "verify" -> {
+                    phase = "idle";
+                    slot = false;
+                }
+                default -> { }
+            }
+        }
+    }
+
+    private final Map<String, Equipo> equipos = new TreeMap<>();
+
+    @BeforeEach
+    void setUp() {
+        svc = new RolloutService();
+        ReflectionTestUtils.setField(svc, "maxParallel", 2);
+        ReflectionTestUtils.setField(svc, "slotSpacingS", 20L);
+        ReflectionTestUtils.setField(svc, "windowS", 300L);
+        ReflectionTestUtils.setField(svc, "offlineS", 30L);
+        ReflectionTestUtils.setField(svc, "updateTimeoutS", 900L);
+        ReflectionTestUtils.setField(svc, "turnstilesCsv", TURNSTILES);
+        equipos.clear();
+        for (int i = 1; i <= 10; i++) {
+            String id = String.format("ME%03d", i);
+            equipos.put(id, new Equipo(id));
+        }
+    }
+
+    private Instant ahora = Instant.parse("2026-01-01T08:00:00Z");
+
+    /** Reloj fijo del servicio, adelantado 's' segundos */
+    private void reloj(long s) {
+        ahora = ahora.plusSeconds(s);
+        ReflectionTestUtils.setField(svc, "clock", Clock.fixed(ahora, ZoneOffset.UTC));
+    }
+
+    private Optional<RolloutService.Slot> latido(Equipo e) {
+        Optional<RolloutService.Slot> s = svc.onHeartbeat(e.id, e.ota());
+        if (s.isPresent() && !e.slot) {
+            e.slot = true;
+            e.slots++;
+        }
+        return s;
+    }
+
+    private void todosLatido() {
+        for (Equipo e : equipos.values()) latido(e);
+    }
+
+    @SuppressWarnings("unchecked")
+    private List<Map<String, Object>> carriles() {
+        return (List<Map<String, Object>>) svc.snapshot().get("lanes");
+    }
+
+    private static boolean enVuelo(Map<String, Object> lane) {
+        String p = (String) lane.get("phase");
+        return p.equals("SCHEDULED") || p.equals("UPDATING") || p.equals("VERIFYING");
+    }
+
+    /** Las dos garantías, sobre el estado publicado */
+    private void comprobarInvariantes(int maxParallel) {
+        Map<String, String> ocupado = new HashMap<>();
+        int total = 0;
+        for (Map<String, Object> l : carriles()) {
+            if (!enVuelo(l)) continue;
+            total++;
+            String torno = (String) l.get("turnstile");
+            String otro = ocupado.put(torno, (String) l.get("id"));
+            assertNull(otro, "dos carriles del torno " + torno + " en vuelo: " + otro + " y " + l.get("id"));
+        }
+        assertTrue(total <= maxParallel, "en vuelo " + total + " > max-parallel " + maxParallel);
+        assertEquals((long) total, svc.snapshot().get("inFlight"));
+    }
+
+    @Test
+    void sinDespliegueNoHayFranjas() {
+        todosLatido();
+        for (Equipo e : equipos.values()) assertTrue(latido(e).isEmpty());
+        assertNull(svc.target());
+    }
+
+    @Test
+    void elOtroCarrilEsperaHastaQueElPrimeroTermine() {
+        Equipo a = equipos.get("ME001"), b = equipos.get("ME002");
+        latido(a);
+        latido(b);
+        svc.start(TARGET, 2);
+
+        assertTrue(latido(a).isPresent());
+        // Mientras ME001 tiene franja, actualiza o está a prueba, ME002 no recibe nada
+        for (int i = 0; i < 4; i++) {
+            assertTrue(latido(b).isEmpty(), "ME002 con franja en la fase " + a.phase);
+            comprobarInvariantes(2);
+            a.avanzar();
+            latido(a);
+        }
+        assertEquals(TARGET, a.version);
+        assertFalse(a.slot);
+        assertEquals("DONE", carriles().get(0).get("phase"));
+
+        // ME001 ya da servicio con la versión nueva: ahora sí
+        assertTrue(latido(b).isPresent());
+        comprobarInvariantes(2);
+    }
+
+    @Test
+    void sinNoticiasDelOtroCarrilNoSeActualiza() {
+        Equipo a = equipos.get("ME003");
+        svc.start(TARGET, 2);
+        assertTrue(latido(a).isEmpty()); // ME004 nunca se ha visto
+        Map<String, Object> lane = carriles().get(0);
+        assertEquals("esperando a ME004", lane.get("reason"));
+
+        // ME004 aparece ocupado: no se lleva la franja y ME003 ya puede
+        Equipo b = equipos.get("ME004");
+        b.load = "busy";
+        assertTrue(latido(b).isEmpty());
+        assertTrue(latido(a).isPresent());
+    }
+
+    @Test
+    void maxParallelSeRespeta() {
+        todosLatido();
+        svc.start(TARGET, 2);
+        todosLatido();
+        comprobarInvariantes(2);
+        assertEquals(2L, svc.snapshot().get("inFlight"));
+        long conFranja = equipos.values().stream().filter(e -> e.slot).count();
+        assertEquals(2, conFranja);
+
+        // Con más paralelismo entran más, uno por torno como mucho
+        svc.start(TARGET, 4);
+        todosLatido();
+        comprobarInvariantes(4);
+        assertEquals(4L, svc.snapshot().get("inFlight"));
+    }
+
+    @Test
+    void soloEquiposListosYEnReposo() {
+        Equipo a = equipos.get("ME005"), b = equipos.get("ME006");
+        a.load = "busy";
+        b.ready = false;
+        latido(a);
+        latido(b);
+        svc.start(TARGET, 2);
+        assertTrue(latido(a).isEmpty());
+        assertTrue(latido(b).isEmpty());
+        a.load = "idle";
+        assertTrue(latido(a).isPresent());
+    }
+
+    /**
+     * Flota entera con latidos en orden aleatorio, equipos que a ratos están
+     * ocupados y avances del firmware a destiempo: las invariantes se cumplen
+     * en cada paso y al final todos terminan en la versión objetivo.
+     */
+    @Test
+    void flotaAleatoriaSinSolapesNiExcesos() {
+        for (long semilla = 1; semilla <= 20; semilla++) {
+            setUp();
+            Random rnd = new Random(semilla);
+            int maxParallel = 1 + rnd.nextInt(4);
+            todosLatido();
+            svc.start(TARGET, maxParallel);
+
+            List<Equipo> lista = new ArrayList<>(equipos.values());
+            int pasos = 0;
+            while (equipos.values().stream().anyMatch(e -> !TARGET.equals(e.version) || e.slot) && pasos < 20000) {
+                Equipo e = lista.get(rnd.nextInt(lista.size()));
+                e.load = rnd.nextInt(5) == 0 ? "busy" : "idle";
+                if (rnd.nextBoolean()) e.avanzar();
+                latido(e);
+                comprobarInvariantes(maxParallel);
+                pasos++;
+            }
+            assertTrue(pasos < 20000, "semilla " + semilla + ": el despliegue no terminó");
+            for (Map<String, Object> l : carriles()) assertEquals("DONE", l.get("phase"), "semilla " + semilla);
+            for (Equipo e : equipos.values()) assertEquals(1, e.slots, e.id + " con más de una franja");
+            assertFalse((Boolean) svc.snapshot().get("halted"));
+        }
+    }
+
+    @Test
+    void unFalloDetieneElDespliegue() {
+        todosLatido();
+        svc.start(TARGET, 2);
+        todosLatido();
+        Equipo a = equipos.values().stream().filter(e -> e.slot).findFirst().orElseThrow();
+        a.phase = "download";
+        latido(a);
+        a.phase = "idle"; // reinició con la versión anterior
+        latido(a);
+
+        Map<String, Object> snap = svc.snapshot();
+        assertTrue((Boolean) snap.get("halted"));
+        assertTrue(((String) snap.get("haltReason")).startsWith(a.id));
+        for (Equipo e : equipos.values()) {
+            if (!e.slot) assertTrue(latido(e).isEmpty(), e.id + " con franja tras el fallo");
+        }
+        comprobarInvariantes(2);
+    }
+
+    /**
+     * Un equipo que deja de mandar latidos con la franja asignada o a media
+     * descarga no se queda su hueco de max-parallel: los plazos se revisan en
+     * cualquier latido y al consultar el estado, no solo en los suyos.
+     */
+    @Test
+    void carrilQueCallaNoBloqueaElDespliegue() {
+        reloj(0);
+        todosLatido();
+        svc.start(TARGET, 1);
+        Equipo a = equipos.get("ME001");
+        assertTrue(latido(a).isPresent());
+        todosLatido();
+        assertEquals(1L, svc.snapshot().get("inFlight"));
+
+        // ME001 calla. Dentro de la franja y la tolerancia conserva su hueco;
+        // pasadas, el siguiente entra sin esperar a que ME001 vuelva
+        Equipo b = equipos.get("ME003");
+        reloj(320);
+        for (Equipo e : equipos.values()) {
+            if (e != a) assertTrue(latido(e).isEmpty());
+        }
+        reloj(11);
+        for (Equipo e : equipos.values()) {
+            if (e != a) latido(e);
+        }
+        assertTrue(b.slot, "ME003 sin franja con ME001 callado");
+        assertEquals(1, equipos.values().stream().filter(e -> e.slot && e != a).count());
+        Map<String, Object> lane = carriles().get(0);
+        assertEquals("PENDING", lane.get("phase"));
+        assertEquals("franja perdida", lane.get("reason"));
+        // Su compañero no puede entrar mientras ME001 no dé señales
+        assertEquals("esperando a ME001", carriles().get(1).get("reason"));
+        comprobarInvariantes(1);
+
+        // ME003 empieza a descargar y calla: el plazo vence sin más latidos
+        b.phase = "download";
+        latido(b);
+        assertEquals("UPDATING", carriles().get(2).get("phase"));
+        reloj(900 + 1);
+        Map<String, Object> snap = svc.snapshot();
+        assertTrue((Boolean) snap.get("halted"));
+        assertEquals(0L, snap.get("inFlight"));
+        assertEquals("FAILED", carriles().get(2).get("phase"));
+        assertEquals("ME003: sin terminar en 900 s", snap.get("haltReason"));
+    }
+}